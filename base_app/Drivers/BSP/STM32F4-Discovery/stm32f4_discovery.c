@@ -18,6 +18,7 @@
   */
 /* Includes ------------------------------------------------------------------*/
 #include "stm32f4_discovery.h"
+#include "i2c_bus.h"
 
 /** @defgroup BSP BSP
   * @{
@@ -83,11 +84,14 @@ GPIO_TypeDef* BUTTON_PORT[BUTTONn] = {KEY_BUTTON_GPIO_PORT};
 const uint16_t BUTTON_PIN[BUTTONn] = {KEY_BUTTON_PIN}; 
 const uint8_t BUTTON_IRQn[BUTTONn] = {KEY_BUTTON_EXTI_IRQn};
 
-uint32_t I2cxTimeout = I2Cx_TIMEOUT_MAX;    /*<! Value of Timeout when I2C communication fails */ 
 uint32_t SpixTimeout = SPIx_TIMEOUT_MAX;    /*<! Value of Timeout when SPI communication fails */
+uint32_t I2cxErrors = 0;                    /*<! I2C transactions failed, posted writes included */
+uint8_t  I2cxErrorAddr = 0;                 /*<! Device of the last failed transaction */
 
 static SPI_HandleTypeDef    SpiHandle;
-static I2C_HandleTypeDef    I2cHandle;
+static I2CQ_XferTypeDef     I2cxWriteXfer[I2Cx_WRITE_SLOTS];
+static uint8_t              I2cxWriteValue[I2Cx_WRITE_SLOTS];
+static uint32_t             I2cxWriteNext;
 /**
   * @}
   */ 
@@ -105,7 +109,7 @@ static I2C_HandleTypeDef    I2cHandle;
 static void     I2Cx_Init(void);
 static void     I2Cx_WriteData(uint8_t Addr, uint8_t Reg, uint8_t Value);
 static uint8_t  I2Cx_ReadData(uint8_t Addr, uint8_t Reg);
-static void     I2Cx_MspInit(void);
+static void     I2Cx_WriteDone(I2CQ_XferTypeDef *xfer);
 static void     I2Cx_Error(uint8_t Addr);
 
 static void     SPIx_Init(void);
@@ -367,116 +371,90 @@ static void SPIx_MspInit(void)
 }
 
 /******************************* I2C Routines**********************************/
+/* The routines below keep their original synchronous signatures but go through
+   the queued I2C1 engine (i2c_bus.c): writes are posted and return at once,
+   reads wait for their own transaction only. Bus errors are recovered by the
+   engine, so I2Cx_Error() only counts what failed after the retries, for a
+   posted write from its completion callback. */
+
 /**
   * @brief  Configures I2C interface.
   */
 static void I2Cx_Init(void)
 {
-  if(HAL_I2C_GetState(&I2cHandle) == HAL_I2C_STATE_RESET)
-  {
-    /* DISCOVERY_I2Cx peripheral configuration */
-    I2cHandle.Init.ClockSpeed = BSP_I2C_SPEED;
-    I2cHandle.Init.DutyCycle = I2C_DUTYCYCLE_2;
-    I2cHandle.Init.OwnAddress1 = 0x33;
-    I2cHandle.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
-    I2cHandle.Instance = DISCOVERY_I2Cx;
-      
-    /* Init the I2C */
-    I2Cx_MspInit();
-    HAL_I2C_Init(&I2cHandle);
-  }
+  (void)I2C_BUS_Init();
 }
 
 /**
   * @brief  Write a value in a register of the device through BUS.
+  *         Posted: the write is queued and completes in the background.
   * @param  Addr: Device address on BUS Bus.  
   * @param  Reg: The target register address to write
   * @param  Value: The target register value to be written 
-  * @retval HAL status
   */
 static void I2Cx_WriteData(uint8_t Addr, uint8_t Reg, uint8_t Value)
 {
-  HAL_StatusTypeDef status = HAL_OK;
-  
-  status = HAL_I2C_Mem_Write(&I2cHandle, Addr, (uint16_t)Reg, I2C_MEMADD_SIZE_8BIT, &Value, 1, I2cxTimeout); 
-
-  /* Check the communication status */
-  if(status != HAL_OK)
+  uint32_t slot = I2cxWriteNext;
+  I2CQ_XferTypeDef *xfer = &I2cxWriteXfer[slot];
+
+  /* Only waits if every posted write slot is still in flight */
+  (void)I2C_BUS_Wait(xfer);
+  I2cxWriteNext = (slot + 1U) % I2Cx_WRITE_SLOTS;
+
+  I2cxWriteValue[slot] = Value;
+  I2CQ_SetWrite(xfer, Addr, Reg, &I2cxWriteValue[slot], 1U);
+  xfer->Retries = 1U;
+  xfer->Callback = I2Cx_WriteDone;
+  while (I2C_BUS_Submit(xfer, 1U) == I2CQ_FULL)
   {
-    /* Execute user timeout callback */
-    I2Cx_Error(Addr);
   }
 }
 
 /**
-  * @brief  Read a register of the device through BUS
+  * @brief  Read a register of the device through BUS.
+  *         Queued behind any posted write, so it sees their effect.
   * @param  Addr: Device address on BUS  
   * @param  Reg: The target register address to read
-  * @retval HAL status
+  * @retval Register value, 0 if the transaction failed
   */
 static uint8_t  I2Cx_ReadData(uint8_t Addr, uint8_t Reg)
 {
-  HAL_StatusTypeDef status = HAL_OK;
+  I2CQ_XferTypeDef xfer;
   uint8_t value = 0;
   
-  status = HAL_I2C_Mem_Read(&I2cHandle, Addr, (uint16_t)Reg, I2C_MEMADD_SIZE_8BIT, &value, 1,I2cxTimeout);
-  
-  /* Check the communication status */
-  if(status != HAL_OK)
+  I2CQ_SetRead(&xfer, Addr, Reg, &value, 1U);
+  xfer.Retries = 1U;
+  while (I2C_BUS_Submit(&xfer, 1U) == I2CQ_FULL)
   {
-    /* Execute user timeout callback */
+  }
+  if (I2C_BUS_Wait(&xfer) != I2CQ_OK)
+  {
+    value = 0;
     I2Cx_Error(Addr);
   }
   return value;
 }
 
 /**
-  * @brief  Manages error callback by re-initializing I2C.
-  * @param  Addr: I2C Address 
+  * @brief  Completion of a posted write, from the I2C interrupt.
+  * @param  xfer: The write
   */
-static void I2Cx_Error(uint8_t Addr)
+static void I2Cx_WriteDone(I2CQ_XferTypeDef *xfer)
 {
-  /* De-initialize the I2C communication bus */
-  HAL_I2C_DeInit(&I2cHandle);
-  
-  /* Re-Initialize the I2C communication bus */
-  I2Cx_Init();
+  if (xfer->Status != I2CQ_OK)
+  {
+    I2Cx_Error(xfer->DevAddr);
+  }
 }
 
 /**
-  * @brief I2C MSP Initialization
+  * @brief  Counts a failed transaction (NACK, bus error or timeout).
+  * @param  Addr: I2C Address 
   */
-static void I2Cx_MspInit(void)
+static void I2Cx_Error(uint8_t Addr)
 {
-  GPIO_InitTypeDef  GPIO_InitStruct;
-
-  /* Enable I2C GPIO clocks */
-  DISCOVERY_I2Cx_SCL_SDA_GPIO_CLK_ENABLE();
-
-  /* DISCOVERY_I2Cx SCL and SDA pins configuration ---------------------------*/
-  GPIO_InitStruct.Pin = DISCOVERY_I2Cx_SCL_PIN | DISCOVERY_I2Cx_SDA_PIN; 
-  GPIO_InitStruct.Mode = GPIO_MODE_AF_OD;
-  GPIO_InitStruct.Speed = GPIO_SPEED_FAST;
-  GPIO_InitStruct.Pull  = GPIO_NOPULL;
-  GPIO_InitStruct.Alternate  = DISCOVERY_I2Cx_SCL_SDA_AF;
-  HAL_GPIO_Init(DISCOVERY_I2Cx_SCL_SDA_GPIO_PORT, &GPIO_InitStruct);     
-
-  /* Enable the DISCOVERY_I2Cx peripheral clock */
-  DISCOVERY_I2Cx_CLK_ENABLE();
-
-  /* Force the I2C peripheral clock reset */
-  DISCOVERY_I2Cx_FORCE_RESET();
-
-  /* Release the I2C peripheral clock reset */
-  DISCOVERY_I2Cx_RELEASE_RESET();
-
-  /* Enable and set I2Cx Interrupt to the highest priority */
-  HAL_NVIC_SetPriority(DISCOVERY_I2Cx_EV_IRQn, 0, 0);
-  HAL_NVIC_EnableIRQ(DISCOVERY_I2Cx_EV_IRQn);
-
-  /* Enable and set I2Cx Interrupt to the highest priority */
-  HAL_NVIC_SetPriority(DISCOVERY_I2Cx_ER_IRQn, 0, 0);
-  HAL_NVIC_EnableIRQ(DISCOVERY_I2Cx_ER_IRQn); 
+  I2cxErrorAddr = Addr;
+  I2cxErrors++;
 }
 
 /*******************************************************************************
@@ -184,12 +184,10 @@ typedef enum
 #define DISCOVERY_I2Cx_EV_IRQn                    I2C1_EV_IRQn
 #define DISCOVERY_I2Cx_ER_IRQn                    I2C1_ER_IRQn
 
-/* Maximum Timeout values for flags waiting loops. These timeouts are not based
-   on accurate values, they just guarantee that the application will not remain
-   stuck if the SPI communication is corrupted.
-   You may modify these timeout values depending on CPU frequency and application
-   conditions (interrupts routines ...). */   
-#define I2Cx_TIMEOUT_MAX    0x1000 /*<! The value of the maximal timeout for BUS waiting loops */
+/* I2C transactions are queued (i2c_bus.c) and time out in the engine, so there
+   is no polling timeout any more. Posted register writes need their value kept
+   until they complete: this is how many can be in flight at once. */
+#define I2Cx_WRITE_SLOTS    8U /*<! Register writes queued without waiting */
 
 
 /*############################# ACCELEROMETER ################################*/
@@ -0,0 +1,74 @@
+/**
+  ******************************************************************************
+  * @file    accel_input.h
+  * @brief   Header for accel_input.c file.
+  *          On-board accelerometer on SPI1, sampled at its data rate into
+  *          the tilt and vibration filter (fusion.h).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ACCEL_INPUT_H
+#define __ACCEL_INPUT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "fusion.h"
+#include "dvfs.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Tilt mode: the application reads the accelerometer. Its SPI1 clock is
+  * PA5, the DAC output, so the signal generator stays off in this build */
+#ifndef ACCEL_FUSION
+#define ACCEL_FUSION            0
+#endif
+
+#define ACCEL_INPUT_ODR_HZ      100U
+#define ACCEL_INPUT_SPI_HZ      10000000U   /*!< Both sensors' maximum        */
+
+/* Filter tuning, see fusion.h */
+#define ACCEL_INPUT_RATE_DPS    90.0f       /*!< Followed without lag         */
+#define ACCEL_INPUT_WINDOW_S    1.0f        /*!< Vibration statistics         */
+
+#define ACCEL_INPUT_TASK_PRIORITY 6U
+#define ACCEL_INPUT_TASK_WORDS  256U
+
+/* WHO_AM_I */
+#define ACCEL_INPUT_LIS3DSH     0x3FU       /*!< Discovery MB997C and later   */
+#define ACCEL_INPUT_LIS302DL    0x3BU       /*!< Discovery MB997B             */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  FUSION_TiltTypeDef Tilt;    /*!< Filtered                               */
+  float    Vibration;         /*!< g RMS                                  */
+  uint32_t Samples;
+} ACCEL_InputResultTypeDef;
+
+typedef struct
+{
+  uint8_t  Chip;              /*!< WHO_AM_I, 0 before init                */
+  uint32_t Samples;
+  uint32_t Overruns;          /*!< Times the sensor overwrote unread data */
+  uint32_t Errors;            /*!< SPI transfers that did not complete    */
+  uint32_t CyclesMin;         /*!< Per filter update                      */
+  uint32_t CyclesAvg;
+  uint32_t CyclesMax;
+} ACCEL_InputStatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef  ACCEL_INPUT_Init(void);
+void               ACCEL_INPUT_Read(ACCEL_InputResultTypeDef *result);
+void               ACCEL_INPUT_GetStats(ACCEL_InputStatsTypeDef *stats);
+DVFS_StatusTypeDef ACCEL_INPUT_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                           const DVFS_PointTypeDef *point);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ACCEL_INPUT_H */
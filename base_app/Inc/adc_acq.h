@@ -0,0 +1,91 @@
+/**
+  ******************************************************************************
+  * @file    adc_acq.h
+  * @brief   Header for adc_acq.c file.
+  *          Analog acquisition on ADC1/2/3: a timer-triggered scan of the
+  *          channel table, or one channel triple interleaved, into a DMA
+  *          double buffer that is decimated half by half.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ADC_ACQ_H
+#define __ADC_ACQ_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "adc_scan.h"
+#include "dvfs.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Samples in the DMA buffer, both halves; 1024 a half is 0.24 ms when
+  * interleaved at 4.2 Msps */
+#ifndef ADC_ACQ_SAMPLES
+#define ADC_ACQ_SAMPLES         2048U
+#endif
+
+#define ADC_ACQ_TICK_HZ         1000000U   /*!< TIM2 count rate, kept across DVFS */
+#define ADC_ACQ_ADCCLK_DIV      4U         /*!< ADCCLK = PCLK2 / 4, 21 MHz at 84  */
+
+/** Decimation runs in the DMA interrupt, every 0.24 ms when interleaved;
+  * at the DAC refills' level, so neither delays the other by preempting */
+#define ADC_ACQ_IRQ_PRIORITY    7U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  A row of the scan table: one regular sequence entry.
+  */
+typedef struct
+{
+  const char   *Name;
+  GPIO_TypeDef *Port;           /*!< NULL for an internal channel          */
+  uint16_t      Pin;
+  uint8_t       Channel;        /*!< ADC_INx                               */
+  uint8_t       Smp;            /*!< ADC_SMPRx code, see ADC_SCAN_SampleCycles() */
+} ADC_ACQ_ChannelTypeDef;
+
+typedef enum
+{
+  ADC_ACQ_STOPPED     = 0x00U,
+  ADC_ACQ_SCAN        = 0x01U,  /*!< The table on ADC1, on TIM2 TRGO      */
+  ADC_ACQ_INTERLEAVED = 0x02U   /*!< The fast channel on ADC1/2/3, free running */
+} ADC_ACQ_ModeTypeDef;
+
+typedef struct
+{
+  ADC_ACQ_ModeTypeDef Mode;
+  uint32_t Channels;      /*!< Samples per frame                          */
+  uint32_t FrameHz;       /*!< Frames per second asked for, 0 interleaved */
+  uint32_t Samples;       /*!< Samples the DMA has delivered              */
+  uint32_t Outputs;       /*!< Decimated frames made                      */
+  uint32_t Overruns;      /*!< Halves the decimation did not keep up with */
+  uint32_t AdcOverruns;   /*!< Conversions the DMA did not keep up with   */
+  uint32_t DmaErrors;     /*!< DMA transfer error interrupts              */
+} ADC_AcqStatsTypeDef;
+
+/* Exported variables --------------------------------------------------------*/
+extern DMA_HandleTypeDef hdma_adc1;
+extern TIM_HandleTypeDef htim2;
+extern const ADC_ACQ_ChannelTypeDef AdcAcqChannels[];
+extern const uint32_t               AdcAcqChannelCount;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef  ADC_ACQ_Init(void);
+HAL_StatusTypeDef  ADC_ACQ_StartScan(uint32_t frame_hz, uint32_t ratio);
+HAL_StatusTypeDef  ADC_ACQ_StartInterleaved(uint32_t ratio);
+void               ADC_ACQ_Stop(void);
+uint32_t           ADC_ACQ_Read(uint16_t *values);
+void               ADC_ACQ_GetStats(ADC_AcqStatsTypeDef *stats);
+DVFS_StatusTypeDef ADC_ACQ_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                       const DVFS_PointTypeDef *point);
+void               ADC_ACQ_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ADC_ACQ_H */
@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file    adc_scan.h
+  * @brief   Header for adc_scan.c file.
+  *          Double buffer, decimating filter and timing for DMA-fed ADC scans.
+  ******************************************************************************
+  * A scan lands in memory as frames, one sample per channel in scan order;
+  * an interleaved run is frames of one channel. The DMA fills half 0, then
+  * half 1, in a circle, and the software takes each half as it completes.
+  *
+  * The decimator sums Ratio frames per channel and dumps the mean scaled
+  * to 16 bits. Noise of about an LSB or more decorrelates the samples, so
+  * averaging 4^n of them gains n bits: a ratio of 256 makes the 16 bits
+  * real. The sum of Ratio consecutive samples is also a first order CIC,
+  * whose nulls at multiples of the output rate reject mains and the like
+  * when the rate is picked for it.
+  *
+  * Nothing in here touches hardware; adc_acq.c runs the ADCs.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ADC_SCAN_H
+#define __ADC_SCAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define ADC_SCAN_MAX_CHANNELS 16U           /*!< Regular sequence length        */
+#define ADC_SCAN_MAX_RATIO    (1UL << 20)   /*!< Keeps a 12-bit sum in 32 bits  */
+#define ADC_SCAN_IN_BITS      12U
+#define ADC_SCAN_OUT_SHIFT    (16U - ADC_SCAN_IN_BITS)
+#define ADC_SCAN_CONV_CYCLES  12U           /*!< ADCCLK cycles per 12-bit conversion */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  ADC_SCAN_OK      = 0x00U,
+  ADC_SCAN_INVALID = 0x01U    /*!< No channels, too many, or a ratio of 0   */
+} ADC_SCAN_StatusTypeDef;
+
+/**
+  * @brief  Circular DMA buffer the ADC writes and the software reads.
+  *         A half is Ready from the DMA's half or full transfer event until
+  *         the software releases it.
+  */
+typedef struct
+{
+  const uint16_t   *Buffer;     /*!< 2 * HalfSamples samples                  */
+  uint32_t          HalfSamples;
+  volatile uint8_t  Ready[2];
+  volatile uint8_t  Next;       /*!< Oldest half not yet taken                */
+  volatile uint32_t Overruns;   /*!< Halves written again before they were read */
+  uint32_t          Halves;     /*!< Halves released                          */
+} ADC_SCAN_RingTypeDef;
+
+typedef struct
+{
+  uint32_t Channels;            /*!< Samples per frame                        */
+  uint32_t Ratio;               /*!< Frames per output                        */
+  uint32_t Count;               /*!< Frames summed so far                     */
+  uint32_t Sum[ADC_SCAN_MAX_CHANNELS];
+  uint16_t Out[ADC_SCAN_MAX_CHANNELS];  /*!< Last outputs, 16-bit full scale  */
+  uint32_t Outputs;             /*!< Outputs made since init                  */
+} ADC_SCAN_DecimatorTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void                   ADC_SCAN_RingInit(ADC_SCAN_RingTypeDef *ring, const uint16_t *buffer, uint32_t half_samples);
+void                   ADC_SCAN_HalfDone(ADC_SCAN_RingTypeDef *ring, uint32_t half);
+const uint16_t        *ADC_SCAN_Acquire(ADC_SCAN_RingTypeDef *ring, uint32_t *half);
+void                   ADC_SCAN_Release(ADC_SCAN_RingTypeDef *ring, uint32_t half, uint32_t write_sample);
+
+ADC_SCAN_StatusTypeDef ADC_SCAN_DecimatorInit(ADC_SCAN_DecimatorTypeDef *dec, uint32_t channels, uint32_t ratio);
+uint32_t               ADC_SCAN_Decimate(ADC_SCAN_DecimatorTypeDef *dec, const uint16_t *samples, uint32_t frames);
+
+uint32_t               ADC_SCAN_SampleCycles(uint32_t smp);
+uint32_t               ADC_SCAN_FrameCycles(const uint8_t *smp, uint32_t channels);
+uint32_t               ADC_SCAN_Rate(uint32_t samples, uint32_t ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ADC_SCAN_H */
@@ -0,0 +1,127 @@
+/**
+  ******************************************************************************
+  * @file    audio_mixer.h
+  * @brief   Header for audio_mixer.c file.
+  *          Portable PCM mixer, resampler and DMA double-buffer bookkeeping
+  *          used by the I2S audio stream.
+  ******************************************************************************
+  * Nothing in here touches hardware, so the module builds both for the target
+  * and for the host unit tests (tests/test_audio.c).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __AUDIO_MIXER_H
+#define __AUDIO_MIXER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "placement.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Number of sources that can be mixed at the same time */
+#ifndef AUDIO_MIXER_MAX_VOICES
+#define AUDIO_MIXER_MAX_VOICES    4U
+#endif
+
+/** Output is always interleaved 16-bit stereo */
+#define AUDIO_OUT_CHANNELS        2U
+
+/** Unity gain (1.0 in Q15, held in an int32_t) */
+#define AUDIO_GAIN_UNITY          32768
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  AUDIO_OK    = 0x00U,
+  AUDIO_ERROR = 0x01U
+} AUDIO_StatusTypeDef;
+
+/**
+  * @brief  Read-only PCM clip, typically a WAV file linked into flash
+  */
+typedef struct
+{
+  const int16_t *Samples;     /*!< Interleaved signed 16-bit PCM            */
+  uint32_t       Frames;      /*!< Number of frames in Samples              */
+  uint32_t       SampleRate;  /*!< Native sample rate of the clip in Hz     */
+  uint8_t        Channels;    /*!< 1 (mono) or 2 (stereo)                   */
+} AUDIO_SourceTypeDef;
+
+/**
+  * @brief  Playback state of one source inside the mixer
+  */
+typedef struct
+{
+  const AUDIO_SourceTypeDef *Source;
+  uint32_t Position;          /*!< Integer part of the read position (frames) */
+  uint32_t Phase;             /*!< Fractional part, in 1/OutRate frames       */
+  uint32_t StepInt;           /*!< Whole source frames per output frame       */
+  uint32_t StepRem;           /*!< Remainder of SampleRate / OutRate          */
+  int32_t  Gain;              /*!< Linear gain, Q15                           */
+  uint8_t  Loop;              /*!< Restart at the end of the clip             */
+  uint8_t  Active;
+} AUDIO_VoiceTypeDef;
+
+typedef struct
+{
+  AUDIO_VoiceTypeDef Voice[AUDIO_MIXER_MAX_VOICES];
+  uint32_t OutRate;           /*!< Output sample rate in Hz                   */
+  uint32_t PhaseScale;        /*!< 2^32 / OutRate, turns Phase into a Q15     */
+  uint32_t Clipped;           /*!< Output samples that had to be saturated    */
+} AUDIO_MixerTypeDef;
+
+/**
+  * @brief  Ping-pong buffer shared between the DMA and the mixer.
+  *         The DMA plays half 0 then half 1 in a circle; whichever half it is
+  *         not reading is owned by the software and must be refilled before
+  *         the DMA wraps around to it again.
+  */
+typedef struct
+{
+  int16_t          *Buffer;     /*!< 2 * HalfFrames stereo frames             */
+  uint32_t          HalfFrames; /*!< Frames per half buffer                   */
+  volatile uint8_t  State[2];   /*!< Ownership of each half, see .c file      */
+  volatile uint8_t  Last;       /*!< 1 + half the DMA left last, 0 = idle     */
+  volatile uint32_t Underruns;  /*!< Halves played before they were refilled  */
+  uint32_t          Fills;      /*!< Halves committed by the software         */
+} AUDIO_RingTypeDef;
+
+/**
+  * @brief  PLLI2S and I2S prescaler settings for one sample rate
+  */
+typedef struct
+{
+  uint32_t PLLI2SN;
+  uint32_t PLLI2SR;
+  uint32_t I2SDIV;
+  uint32_t I2SODD;
+  uint32_t ActualRate;        /*!< Sample rate the settings really produce    */
+} AUDIO_ClockTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+AUDIO_StatusTypeDef AUDIO_WAV_Parse(const uint8_t *data, uint32_t size, AUDIO_SourceTypeDef *source);
+
+void     AUDIO_Mixer_Init(AUDIO_MixerTypeDef *mixer, uint32_t out_rate);
+int32_t  AUDIO_Mixer_Play(AUDIO_MixerTypeDef *mixer, const AUDIO_SourceTypeDef *source, int32_t gain, uint8_t loop);
+void     AUDIO_Mixer_Stop(AUDIO_MixerTypeDef *mixer, int32_t voice);
+uint32_t AUDIO_Mixer_ActiveVoices(const AUDIO_MixerTypeDef *mixer);
+void     AUDIO_Mixer_Render(AUDIO_MixerTypeDef *mixer, int16_t *out, uint32_t frames) CODE_FAST;
+
+void     AUDIO_Ring_Init(AUDIO_RingTypeDef *ring, int16_t *buffer, uint32_t half_frames);
+void     AUDIO_Ring_HalfDone(AUDIO_RingTypeDef *ring, uint32_t half);
+int16_t *AUDIO_Ring_Acquire(AUDIO_RingTypeDef *ring, uint32_t *half);
+void     AUDIO_Ring_Commit(AUDIO_RingTypeDef *ring, uint32_t half, uint32_t read_frame);
+uint32_t AUDIO_Ring_LatencyUs(const AUDIO_RingTypeDef *ring, uint32_t rate);
+
+AUDIO_StatusTypeDef AUDIO_I2S_SolveClock(uint32_t pll_in_hz, uint32_t rate, AUDIO_ClockTypeDef *clock);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AUDIO_MIXER_H */
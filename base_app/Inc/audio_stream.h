@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+  * @file    audio_stream.h
+  * @brief   Header for audio_stream.c file.
+  *          Continuous I2S3 output to the CS43L22 codec fed by circular DMA.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __AUDIO_STREAM_H
+#define __AUDIO_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "audio_mixer.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Frames per DMA half buffer; 240 frames is 5 ms at 48 kHz */
+#ifndef AUDIO_STREAM_HALF_FRAMES
+#define AUDIO_STREAM_HALF_FRAMES    240U
+#endif
+
+/** 1: render the free half straight from the DMA interrupt.
+  * 0: the application calls AUDIO_STREAM_Process() from its own loop. */
+#ifndef AUDIO_STREAM_FILL_IN_ISR
+#define AUDIO_STREAM_FILL_IN_ISR    1U
+#endif
+
+#define AUDIO_STREAM_IRQ_PRIORITY   5U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t SampleRate;    /*!< Rate the I2S clock really runs at          */
+  uint32_t LatencyUs;     /*!< Depth of the double buffer                 */
+  uint32_t Underruns;     /*!< Halves played before they were refilled    */
+  uint32_t Fills;         /*!< Halves rendered by the mixer               */
+  uint32_t Clipped;       /*!< Samples saturated by the mixer             */
+  uint32_t DmaErrors;     /*!< DMA transfer error interrupts              */
+} AUDIO_StreamStatsTypeDef;
+
+/* Exported variables --------------------------------------------------------*/
+extern DMA_HandleTypeDef hdma_spi3_tx;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef   AUDIO_STREAM_Init(uint32_t sample_rate);
+HAL_StatusTypeDef   AUDIO_STREAM_Start(void);
+void                AUDIO_STREAM_Stop(void);
+void                AUDIO_STREAM_Process(void);
+AUDIO_MixerTypeDef *AUDIO_STREAM_GetMixer(void);
+void                AUDIO_STREAM_GetStats(AUDIO_StreamStatsTypeDef *stats);
+void                AUDIO_STREAM_CodecConfig(uint32_t sample_rate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AUDIO_STREAM_H */
@@ -0,0 +1,42 @@
+/**
+  ******************************************************************************
+  * @file    board.h
+  * @brief   STM32F4-Discovery pins, as pin.h descriptors.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BOARD_H
+#define __BOARD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "pin.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define BOARD_LED_GREEN       (1UL << 12)   /*!< LD4, PD12 */
+#define BOARD_LED_ORANGE      (1UL << 13)   /*!< LD3, PD13 */
+#define BOARD_LED_RED         (1UL << 14)   /*!< LD5, PD14 */
+#define BOARD_LED_BLUE        (1UL << 15)   /*!< LD6, PD15 */
+#define BOARD_LEDS            (BOARD_LED_GREEN | BOARD_LED_ORANGE | BOARD_LED_RED | BOARD_LED_BLUE)
+
+/* Exported functions --------------------------------------------------------*/
+PIN_DEFINE(LED_GREEN, GPIOD, 12U)
+PIN_DEFINE(LED_ORANGE, GPIOD, 13U)
+PIN_DEFINE(LED_RED, GPIOD, 14U)
+PIN_DEFINE(LED_BLUE, GPIOD, 15U)
+PIN_GROUP_DEFINE(LEDS, GPIOD, BOARD_LEDS)
+
+PIN_DEFINE(BUTTON_USER, GPIOA, 0U)          /* B1, high while pressed */
+
+PIN_DEFINE(ACCEL_CS, GPIOE, 3U)             /* U5 accelerometer, low selects */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOARD_H */
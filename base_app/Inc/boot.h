@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+  * @file    boot.h
+  * @brief   Header for boot.c file.
+  *          Boot phase timestamps: record layout, per-phase durations and
+  *          the text breakdown.
+  ******************************************************************************
+  * The startup code starts the DWT cycle counter from zero as the first
+  * thing in Reset_Handler and stamps the end of each phase into the record.
+  * The core clock changes during boot, so every stamp also keeps the clock
+  * it was taken at: an interval is converted at the clock in force when it
+  * began (the switch to the PLL falls at the very end of BOOT_PH_CLOCK).
+  *
+  * Reset_Handler writes Cycles[] by offset (startup_stm32f407xx.s); keep
+  * BOOT_CYCLES_OFFSET and the phase numbers in step with it.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BOOT_H
+#define __BOOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define BOOT_MAGIC            0x544F4F42U   /*!< "BOOT" in a little-endian dump */
+#define BOOT_CYCLES_OFFSET    8U            /*!< Byte offset of Cycles[0]        */
+
+/** Phases, each stamped when it ends */
+#define BOOT_PH_RESET         0U            /*!< Reset_Handler entry, cycle 0    */
+#define BOOT_PH_SYSTEMINIT    1U            /*!< SystemInit() (startup code)     */
+#define BOOT_PH_DATA          2U            /*!< .data copy (startup code)       */
+#define BOOT_PH_BSS           3U            /*!< .bss zero fill (startup code)   */
+#define BOOT_PH_MAIN          4U            /*!< Constructors, entry of main()   */
+#define BOOT_PH_HAL           5U            /*!< HAL_Init()                      */
+#define BOOT_PH_EARLY         6U            /*!< Clock independent peripherals   */
+#define BOOT_PH_CLOCK         7U            /*!< PLL lock and switch             */
+#define BOOT_PH_PERIPH        8U            /*!< Remaining peripherals, drivers  */
+#define BOOT_PH_READY         9U            /*!< Kernel about to start           */
+#define BOOT_PHASES           10U
+
+#define BOOT_LINE_MAX         48U           /*!< Longest BOOT_Format() line      */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Magic;
+  uint32_t Count;                   /*!< Stamps taken, phases 0..Count-1   */
+  uint32_t Cycles[BOOT_PHASES];     /*!< CYCCNT at the end of each phase   */
+  uint32_t Hz[BOOT_PHASES];         /*!< Core clock when it was stamped    */
+} BOOT_RecordTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void        BOOT_Start(BOOT_RecordTypeDef *record, uint32_t cycles, uint32_t hz);
+void        BOOT_Mark(BOOT_RecordTypeDef *record, uint32_t phase, uint32_t cycles, uint32_t hz);
+uint8_t     BOOT_IsValid(const BOOT_RecordTypeDef *record);
+uint32_t    BOOT_PhaseUs(const BOOT_RecordTypeDef *record, uint32_t phase);
+uint32_t    BOOT_TotalUs(const BOOT_RecordTypeDef *record, uint32_t phase);
+const char *BOOT_PhaseName(uint32_t phase);
+uint32_t    BOOT_Format(const BOOT_RecordTypeDef *record, uint32_t phase, char *out, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOOT_H */
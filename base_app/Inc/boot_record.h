@@ -0,0 +1,35 @@
+/**
+  ******************************************************************************
+  * @file    boot_record.h
+  * @brief   Header for boot_record.c file.
+  *          Boot phase stamps in .noinit RAM, early PLL start and the
+  *          boot-time report.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BOOT_RECORD_H
+#define __BOOT_RECORD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "boot.h"
+
+/* Exported variables --------------------------------------------------------*/
+extern BOOT_RecordTypeDef BootRecord;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void BOOT_RECORD_Start(void);
+void BOOT_RECORD_Mark(uint32_t phase);
+void BOOT_RECORD_StartClocks(void);
+void BOOT_RECORD_Report(UART_HandleTypeDef *huart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BOOT_RECORD_H */
@@ -0,0 +1,100 @@
+/**
+  ******************************************************************************
+  * @file    button.h
+  * @brief   Header for button.c file.
+  *          Debounced push button gestures and their event queue.
+  ******************************************************************************
+  * The button is driven by two calls, both from interrupt context:
+  *
+  *   BUTTON_Edge()     on every raw edge of the pin (EXTI)
+  *   BUTTON_Service()  when the delay returned by either call has elapsed
+  *                     (one-shot timer), with the pin level read then
+  *
+  * Each returns the milliseconds until BUTTON_Service() must run next, or 0
+  * if nothing is pending, so a single one-shot timer per button covers the
+  * debounce interval and the gesture timeouts. Nothing is polled.
+  *
+  * Gestures go to a single-producer single-consumer ring: the interrupts
+  * post, one task reads. Neither side locks.
+  *
+  * Nothing in here touches hardware; button_input.c wires it to B1 on PA0,
+  * the host tests (tests/test_button.c) script the edge timings.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BUTTON_H
+#define __BUTTON_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/** Events that can wait for the reader (power of two) */
+#ifndef BUTTON_QUEUE_DEPTH
+#define BUTTON_QUEUE_DEPTH    16U
+#endif
+
+#define BUTTON_DEBOUNCE_MS    20U   /*!< Pin must be quiet this long          */
+#define BUTTON_LONG_MS        800U  /*!< Held this long: LONG_PRESS           */
+#define BUTTON_DOUBLE_MS      300U  /*!< Release to next press for a double   */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  BUTTON_PRESS        = 0x00U,  /*!< Pressed, every time                     */
+  BUTTON_RELEASE      = 0x01U,  /*!< Released, every time                    */
+  BUTTON_CLICK        = 0x02U,  /*!< Short press, no second one followed     */
+  BUTTON_DOUBLE_CLICK = 0x03U,  /*!< Two short presses, on the second release */
+  BUTTON_LONG_PRESS   = 0x04U   /*!< Held for LongMs, while still held       */
+} BUTTON_GestureTypeDef;
+
+typedef struct
+{
+  uint8_t  Button;              /*!< Id given to BUTTON_Init()               */
+  uint8_t  Gesture;             /*!< BUTTON_GestureTypeDef                   */
+  uint32_t Time;                /*!< When it happened, ms                    */
+} BUTTON_EventTypeDef;
+
+typedef struct
+{
+  BUTTON_EventTypeDef Events[BUTTON_QUEUE_DEPTH];
+  volatile uint32_t   Head;     /*!< Next slot BUTTON_Post() writes          */
+  volatile uint32_t   Tail;     /*!< Next slot BUTTON_Get() reads            */
+  volatile uint32_t   Dropped;  /*!< Events lost to a full queue             */
+} BUTTON_QueueTypeDef;
+
+typedef struct
+{
+  BUTTON_QueueTypeDef *Queue;
+  uint8_t  Id;
+  uint8_t  State;               /*!< See button.c                            */
+  uint8_t  Level;               /*!< Debounced, 1 = pressed                  */
+  uint8_t  Bouncing;            /*!< Edge seen, waiting for the pin to settle */
+  uint8_t  Timing;              /*!< Deadline is armed                       */
+  uint32_t EdgeAt;              /*!< First edge of the current bounce        */
+  uint32_t SettleAt;            /*!< Last edge + DebounceMs                  */
+  uint32_t Deadline;            /*!< Long press or double click timeout      */
+  uint16_t DebounceMs;
+  uint16_t LongMs;
+  uint16_t DoubleMs;
+} BUTTON_HandleTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void     BUTTON_Init(BUTTON_HandleTypeDef *btn, uint8_t id, BUTTON_QueueTypeDef *queue, uint32_t level);
+uint32_t BUTTON_Edge(BUTTON_HandleTypeDef *btn, uint32_t now);
+uint32_t BUTTON_Service(BUTTON_HandleTypeDef *btn, uint32_t level, uint32_t now);
+
+void     BUTTON_QueueInit(BUTTON_QueueTypeDef *queue);
+uint8_t  BUTTON_Post(BUTTON_QueueTypeDef *queue, const BUTTON_EventTypeDef *event);
+uint8_t  BUTTON_Get(BUTTON_QueueTypeDef *queue, BUTTON_EventTypeDef *event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BUTTON_H */
@@ -0,0 +1,47 @@
+/**
+  ******************************************************************************
+  * @file    button_input.h
+  * @brief   Header for button_input.c file.
+  *          User button B1 on EXTI0 with a TIM7 one-shot for debouncing.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BUTTON_INPUT_H
+#define __BUTTON_INPUT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "button.h"
+#include "dvfs.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define BUTTON_INPUT_USER         0U      /*!< Id of B1 in its events          */
+
+#define BUTTON_INPUT_TICK_HZ      10000U  /*!< TIM7 counter, kept across clock switches */
+
+/** EXTI0 and TIM7 share one level so the button only ever runs in one
+  * context; below the audio and I2C interrupts, above the SysTick. */
+#define BUTTON_INPUT_IRQ_PRIORITY 10U
+
+/* Exported variables --------------------------------------------------------*/
+extern TIM_HandleTypeDef htim7;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef  BUTTON_INPUT_Init(void);
+HAL_StatusTypeDef  BUTTON_INPUT_Read(BUTTON_EventTypeDef *event, uint32_t timeout);
+uint32_t           BUTTON_INPUT_Dropped(void);
+DVFS_StatusTypeDef BUTTON_INPUT_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                            const DVFS_PointTypeDef *point);
+void               BUTTON_INPUT_EXTI_IRQHandler(void);
+void               BUTTON_INPUT_TIM_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BUTTON_INPUT_H */
@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file    can_bus.h
+  * @brief   Header for can_bus.c file.
+  *          bxCAN1 driver: planned filter banks, per-rule receive queues and
+  *          a transmit priority queue (can_filter.h, can_queue.h).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CAN_BUS_H
+#define __CAN_BUS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "can_filter.h"
+#include "can_queue.h"
+#include "dvfs.h"
+
+/* Exported constants --------------------------------------------------------*/
+#ifndef CAN_BUS_BITRATE
+#define CAN_BUS_BITRATE         500000U
+#endif
+
+/** TX, RX0, RX1 and SCE share one level, so the driver state is only ever
+  * touched from one context. A receive FIFO is three frames deep, 150 us at
+  * 1 Mbit/s, so it sits with the I2C bus above the DMA refills. */
+#define CAN_BUS_IRQ_PRIORITY    6U
+
+#define CAN_BUS_TIMEOUT_MS      10U     /*!< Initialization mode handshake  */
+#define CAN_BUS_SELFTEST_MAX    1024U   /*!< Frames one self-test can send  */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  CAN_BUS_NORMAL   = 0x00U,
+  CAN_BUS_LOOPBACK = 0x01U      /*!< Silent loopback: TX pin stays recessive */
+} CAN_BusModeTypeDef;
+
+typedef struct
+{
+  uint32_t Bitrate;
+  uint32_t Banks;               /*!< Filter banks in use                     */
+  uint32_t TxFrames;            /*!< Mailboxes sent                          */
+  uint32_t TxAborted;           /*!< Mailboxes completed without TXOK        */
+  uint32_t RxFrames;            /*!< Frames taken from the FIFOs             */
+  uint32_t RxDropped;           /*!< Frames lost to full queues              */
+  uint32_t RxOverruns;          /*!< Frames lost to full hardware FIFOs      */
+  uint32_t BusOffs;
+  uint32_t ErrorPassives;
+  uint8_t  Tec;                 /*!< Transmit error counter                  */
+  uint8_t  Rec;                 /*!< Receive error counter                   */
+} CAN_BusStatsTypeDef;
+
+typedef struct
+{
+  uint32_t Sent;                /*!< Frames the filters should accept        */
+  uint32_t Received;
+  uint32_t Errors;              /*!< Wrong queue, payload or duplicate       */
+  uint8_t  Leaked;              /*!< A frame no rule accepts got through     */
+  uint32_t Ms;
+  uint32_t FramesPerSec;
+  uint32_t WireFramesPerSec;    /*!< Bit rate over the unstuffed frame length */
+} CAN_BusSelfTestTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef  CAN_BUS_Init(const CANF_RuleTypeDef *rules, uint32_t count,
+                                CANQ_RxQueueTypeDef *queues, uint32_t queue_count);
+HAL_StatusTypeDef  CAN_BUS_SetMode(CAN_BusModeTypeDef mode);
+HAL_StatusTypeDef  CAN_BUS_Send(const CANQ_FrameTypeDef *frame);
+uint8_t            CAN_BUS_Receive(uint32_t queue, CANQ_FrameTypeDef *frame);
+void               CAN_BUS_GetStats(CAN_BusStatsTypeDef *stats);
+HAL_StatusTypeDef  CAN_BUS_SelfTest(uint32_t frames, CAN_BusSelfTestTypeDef *result);
+DVFS_StatusTypeDef CAN_BUS_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                       const DVFS_PointTypeDef *point);
+void               CAN_BUS_TX_IRQHandler(void);
+void               CAN_BUS_RX0_IRQHandler(void);
+void               CAN_BUS_RX1_IRQHandler(void);
+void               CAN_BUS_SCE_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CAN_BUS_H */
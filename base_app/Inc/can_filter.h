@@ -0,0 +1,96 @@
+/**
+  ******************************************************************************
+  * @file    can_filter.h
+  * @brief   Header for can_filter.c file.
+  *          bxCAN filter bank allocation from a list of accepted identifiers.
+  ******************************************************************************
+  * A rule accepts the identifiers that equal Id in every bit set in Mask;
+  * the CANQ_EXT and CANQ_RTR flags of Id always have to match. Each rule
+  * names the receive FIFO and the queue its frames go to.
+  *
+  * A filter bank holds one of:
+  *
+  *   32-bit mask   1 rule, any
+  *   32-bit list   2 exact identifiers
+  *   16-bit mask   2 rules on STID[10:0] and EXID[17:15] only
+  *   16-bit list   4 exact standard identifiers
+  *
+  * CANF_Plan() first drops rules another one covers and merges rules that
+  * differ in one identifier bit, then fills the fewest banks those rules
+  * fit in, and numbers the filters the way the hardware reports them in
+  * FMI, so the receive interrupt finds the queue by index. A plan accepts
+  * exactly the frames the rules do; a frame that two rules for different
+  * queues accept goes where the hardware's filter priority sends it.
+  *
+  * Nothing in here touches hardware; can_bus.c loads the plan.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CAN_FILTER_H
+#define __CAN_FILTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "can_queue.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Banks CAN1 owns with CAN2SB at its reset value */
+#ifndef CANF_MAX_BANKS
+#define CANF_MAX_BANKS      14U
+#endif
+
+#ifndef CANF_MAX_RULES
+#define CANF_MAX_RULES      32U
+#endif
+
+#define CANF_MAX_FILTERS    (CANF_MAX_BANKS * 4U)   /*!< Per FIFO            */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  CANF_OK        = 0x00U,
+  CANF_NO_BANKS  = 0x01U,   /*!< The rules need more than CANF_MAX_BANKS      */
+  CANF_INVALID   = 0x02U    /*!< Too many rules, bad FIFO or identifier       */
+} CANF_StatusTypeDef;
+
+typedef struct
+{
+  uint32_t Id;              /*!< Identifier with CANQ_EXT and CANQ_RTR        */
+  uint32_t Mask;            /*!< Identifier bits that must match              */
+  uint8_t  Fifo;            /*!< 0 or 1                                       */
+  uint8_t  Queue;           /*!< Caller's receive queue index                 */
+} CANF_RuleTypeDef;
+
+/**
+  * @brief  Register values for banks 0 to Banks-1, and the queue of every
+  *         filter match index
+  */
+typedef struct
+{
+  uint32_t Banks;
+  uint32_t Mode;                        /*!< FM1R: set for identifier list   */
+  uint32_t Scale;                       /*!< FS1R: set for 32-bit            */
+  uint32_t Fifo;                        /*!< FFA1R: set for FIFO 1           */
+  uint32_t Fr1[CANF_MAX_BANKS];
+  uint32_t Fr2[CANF_MAX_BANKS];
+  uint8_t  Filters[2];                  /*!< Filter numbers used per FIFO    */
+  uint8_t  Queue[2][CANF_MAX_FILTERS];  /*!< By FIFO and FMI                 */
+  uint32_t RuleCount;                   /*!< After reduction                 */
+  CANF_RuleTypeDef Rules[CANF_MAX_RULES];
+} CANF_PlanTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+CANF_StatusTypeDef CANF_Plan(const CANF_RuleTypeDef *rules, uint32_t count, CANF_PlanTypeDef *plan);
+uint8_t            CANF_Match(const CANF_PlanTypeDef *plan, uint32_t id, uint8_t *fifo, uint8_t *fmi);
+uint8_t            CANF_RuleMatch(const CANF_RuleTypeDef *rule, uint32_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CAN_FILTER_H */
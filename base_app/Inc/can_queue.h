@@ -0,0 +1,94 @@
+/**
+  ******************************************************************************
+  * @file    can_queue.h
+  * @brief   Header for can_queue.c file.
+  *          CAN frames, per-identifier receive rings and the transmit
+  *          priority queue.
+  ******************************************************************************
+  * Receive: the FIFO interrupt sorts each frame into the ring of the filter
+  * that accepted it (can_filter.h), and one task reads each ring. Producer
+  * and consumer never lock.
+  *
+  * Transmit: frames wait in a binary heap ordered the way the bus would
+  * arbitrate them, lowest identifier first, oldest first among equals, and
+  * the mailbox interrupt takes them from the top. Tasks push under a short
+  * critical section.
+  *
+  * Nothing in here touches hardware; can_bus.c runs bxCAN.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CAN_QUEUE_H
+#define __CAN_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/** Frames each receive ring holds (power of two) */
+#ifndef CANQ_RX_DEPTH
+#define CANQ_RX_DEPTH       16U
+#endif
+
+/** Frames the transmit queue holds */
+#ifndef CANQ_TX_DEPTH
+#define CANQ_TX_DEPTH       32U
+#endif
+
+#define CANQ_EXT            0x80000000U   /*!< Id flag: 29-bit identifier   */
+#define CANQ_RTR            0x40000000U   /*!< Id flag: remote frame        */
+#define CANQ_STD_MASK       0x000007FFU
+#define CANQ_EXT_MASK       0x1FFFFFFFU
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Id;                  /*!< Identifier, with CANQ_EXT and CANQ_RTR  */
+  uint8_t  Dlc;                 /*!< 0 to 8                                  */
+  uint8_t  Data[8];
+} CANQ_FrameTypeDef;
+
+typedef struct
+{
+  CANQ_FrameTypeDef Frames[CANQ_RX_DEPTH];
+  volatile uint32_t Head;       /*!< Next slot CANQ_Post() writes            */
+  volatile uint32_t Tail;       /*!< Next slot CANQ_Get() reads              */
+  volatile uint32_t Dropped;    /*!< Frames lost to a full ring              */
+} CANQ_RxQueueTypeDef;
+
+typedef struct
+{
+  uint32_t          Key;        /*!< CANQ_Key() of the frame                 */
+  uint32_t          Seq;        /*!< Push order, for equal keys              */
+  CANQ_FrameTypeDef Frame;
+} CANQ_TxEntryTypeDef;
+
+typedef struct
+{
+  CANQ_TxEntryTypeDef Entries[CANQ_TX_DEPTH];
+  uint32_t            Count;
+  uint32_t            Seq;
+} CANQ_TxQueueTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint32_t CANQ_Key(uint32_t id);
+
+void     CANQ_RxInit(CANQ_RxQueueTypeDef *queue);
+uint8_t  CANQ_Post(CANQ_RxQueueTypeDef *queue, const CANQ_FrameTypeDef *frame);
+uint8_t  CANQ_Get(CANQ_RxQueueTypeDef *queue, CANQ_FrameTypeDef *frame);
+
+void     CANQ_TxInit(CANQ_TxQueueTypeDef *queue);
+uint8_t  CANQ_Push(CANQ_TxQueueTypeDef *queue, const CANQ_FrameTypeDef *frame);
+const CANQ_TxEntryTypeDef *CANQ_Peek(const CANQ_TxQueueTypeDef *queue);
+void     CANQ_Pop(CANQ_TxQueueTypeDef *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CAN_QUEUE_H */
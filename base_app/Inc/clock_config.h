@@ -0,0 +1,122 @@
+/**
+  ******************************************************************************
+  * @file    clock_config.h
+  * @brief   Clock configuration of the application, solved at compile time
+  *          by clock_tree.h.
+  ******************************************************************************
+  * Change the source or a target frequency here; PLL, flash latency and bus
+  * prescalers follow, and the build fails if the tree has no exact solution
+  * or leaves a datasheet limit. SystemClock_Config() uses CLOCK_CONFIG_OSC_INIT,
+  * CLOCK_CONFIG_CLK_INIT and CLOCK_CONFIG_FLASH_LATENCY; peripheral set-up
+  * uses the derived CLOCK_CONFIG_*_HZ constants.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLOCK_CONFIG_H
+#define __CLOCK_CONFIG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "clock_tree.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** PLL source: 0 for the 16 MHz HSI, 1 for the 8 MHz crystal on the HSE */
+#ifndef CLOCK_CONFIG_USE_HSE
+#define CLOCK_CONFIG_USE_HSE      0
+#endif
+
+#define CLOCK_CONFIG_SYSCLK_HZ    168000000UL
+#define CLOCK_CONFIG_USB_HZ       CLOCK_USB_HZ  /*!< 0 if no 48 MHz peripheral is used */
+#define CLOCK_CONFIG_UART_BAUD    115200UL      /*!< USART3 console              */
+
+#if CLOCK_CONFIG_USE_HSE
+#define CLOCK_CONFIG_SOURCE_HZ    ((unsigned long)HSE_VALUE)
+#else
+#define CLOCK_CONFIG_SOURCE_HZ    ((unsigned long)HSI_VALUE)
+#endif
+
+/* Solved tree */
+#define CLOCK_CONFIG_PLLM   CLOCK_PLLM(CLOCK_CONFIG_SOURCE_HZ)
+#define CLOCK_CONFIG_PLLN   CLOCK_PLLN(CLOCK_CONFIG_SOURCE_HZ, CLOCK_CONFIG_SYSCLK_HZ, CLOCK_CONFIG_USB_HZ)
+#define CLOCK_CONFIG_PLLP   CLOCK_PLLP(CLOCK_CONFIG_SOURCE_HZ, CLOCK_CONFIG_SYSCLK_HZ, CLOCK_CONFIG_USB_HZ)
+#define CLOCK_CONFIG_PLLQ   CLOCK_PLLQ(CLOCK_CONFIG_SOURCE_HZ, CLOCK_CONFIG_SYSCLK_HZ, CLOCK_CONFIG_USB_HZ)
+#define CLOCK_CONFIG_VCO_HZ CLOCK_VCO_OUT(CLOCK_CONFIG_SOURCE_HZ, CLOCK_CONFIG_SYSCLK_HZ, CLOCK_CONFIG_USB_HZ)
+
+#define CLOCK_CONFIG_FLASH_LATENCY  CLOCK_FLASH_LATENCY(CLOCK_CONFIG_HCLK_HZ)
+#define CLOCK_CONFIG_APB1_DIV       CLOCK_APB_DIV(CLOCK_CONFIG_HCLK_HZ, CLOCK_PCLK1_MAX)
+#define CLOCK_CONFIG_APB2_DIV       CLOCK_APB_DIV(CLOCK_CONFIG_HCLK_HZ, CLOCK_PCLK2_MAX)
+
+/* Derived peripheral clocks */
+#define CLOCK_CONFIG_HCLK_HZ        CLOCK_CONFIG_SYSCLK_HZ
+#define CLOCK_CONFIG_PCLK1_HZ       (CLOCK_CONFIG_HCLK_HZ / CLOCK_CONFIG_APB1_DIV)
+#define CLOCK_CONFIG_PCLK2_HZ       (CLOCK_CONFIG_HCLK_HZ / CLOCK_CONFIG_APB2_DIV)
+#define CLOCK_CONFIG_TIM_APB1_HZ    CLOCK_TIM_CLK(CLOCK_CONFIG_HCLK_HZ, CLOCK_CONFIG_APB1_DIV)
+#define CLOCK_CONFIG_TIM_APB2_HZ    CLOCK_TIM_CLK(CLOCK_CONFIG_HCLK_HZ, CLOCK_CONFIG_APB2_DIV)
+#define CLOCK_CONFIG_PLL48_HZ       (CLOCK_CONFIG_VCO_HZ / CLOCK_CONFIG_PLLQ)
+
+/* Exported macro ------------------------------------------------------------*/
+#define CLOCK_CONFIG_APB_REG(div)                                             \
+  (((div) == 1UL) ? RCC_HCLK_DIV1 : ((div) == 2UL) ? RCC_HCLK_DIV2 :          \
+   ((div) == 4UL) ? RCC_HCLK_DIV4 : ((div) == 8UL) ? RCC_HCLK_DIV8 : RCC_HCLK_DIV16)
+
+/** Initialiser for the RCC_OscInitTypeDef of SystemClock_Config() */
+#if CLOCK_CONFIG_USE_HSE
+#define CLOCK_CONFIG_OSC_INIT                                                 \
+  {                                                                           \
+    .OscillatorType = RCC_OSCILLATORTYPE_HSE,                                 \
+    .HSEState       = RCC_HSE_ON,                                             \
+    .PLL = { RCC_PLL_ON, RCC_PLLSOURCE_HSE, CLOCK_CONFIG_PLLM, CLOCK_CONFIG_PLLN, \
+             CLOCK_CONFIG_PLLP, CLOCK_CONFIG_PLLQ }                           \
+  }
+#else
+#define CLOCK_CONFIG_OSC_INIT                                                 \
+  {                                                                           \
+    .OscillatorType      = RCC_OSCILLATORTYPE_HSI,                            \
+    .HSIState            = RCC_HSI_ON,                                        \
+    .HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT,                        \
+    .PLL = { RCC_PLL_ON, RCC_PLLSOURCE_HSI, CLOCK_CONFIG_PLLM, CLOCK_CONFIG_PLLN, \
+             CLOCK_CONFIG_PLLP, CLOCK_CONFIG_PLLQ }                           \
+  }
+#endif
+
+/** Initialiser for the RCC_ClkInitTypeDef of SystemClock_Config() */
+#define CLOCK_CONFIG_CLK_INIT                                                 \
+  {                                                                           \
+    .ClockType      = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK |             \
+                      RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2,              \
+    .SYSCLKSource   = RCC_SYSCLKSOURCE_PLLCLK,                                \
+    .AHBCLKDivider  = RCC_SYSCLK_DIV1,                                        \
+    .APB1CLKDivider = CLOCK_CONFIG_APB_REG(CLOCK_CONFIG_APB1_DIV),            \
+    .APB2CLKDivider = CLOCK_CONFIG_APB_REG(CLOCK_CONFIG_APB2_DIV)             \
+  }
+
+/* Static checks -------------------------------------------------------------*/
+_Static_assert(CLOCK_CONFIG_PLLP != 0UL, "no exact PLL setting for SYSCLK (and USB) from this source");
+_Static_assert((CLOCK_CONFIG_SOURCE_HZ / CLOCK_CONFIG_PLLM >= CLOCK_VCO_IN_MIN) &&
+               (CLOCK_CONFIG_SOURCE_HZ / CLOCK_CONFIG_PLLM <= CLOCK_VCO_IN_MAX), "VCO input out of range");
+_Static_assert((CLOCK_CONFIG_VCO_HZ >= CLOCK_VCO_OUT_MIN) && (CLOCK_CONFIG_VCO_HZ <= CLOCK_VCO_OUT_MAX),
+               "VCO output out of range");
+_Static_assert((CLOCK_CONFIG_PLLN >= CLOCK_PLLN_MIN) && (CLOCK_CONFIG_PLLN <= CLOCK_PLLN_MAX), "PLLN out of range");
+_Static_assert((CLOCK_CONFIG_PLLQ >= CLOCK_PLLQ_MIN) && (CLOCK_CONFIG_PLLQ <= CLOCK_PLLQ_MAX), "PLLQ out of range");
+_Static_assert(CLOCK_CONFIG_SOURCE_HZ / CLOCK_CONFIG_PLLM * CLOCK_CONFIG_PLLN / CLOCK_CONFIG_PLLP ==
+               CLOCK_CONFIG_SYSCLK_HZ, "SYSCLK is not exact");
+_Static_assert((CLOCK_CONFIG_USB_HZ == 0UL) || (CLOCK_CONFIG_PLL48_HZ == CLOCK_CONFIG_USB_HZ),
+               "48 MHz clock is not exact");
+_Static_assert(CLOCK_CONFIG_PLL48_HZ <= CLOCK_USB_HZ, "48 MHz domain over 48 MHz");
+_Static_assert((CLOCK_CONFIG_APB1_DIV != 0UL) && (CLOCK_CONFIG_PCLK1_HZ <= CLOCK_PCLK1_MAX), "APB1 too fast");
+_Static_assert((CLOCK_CONFIG_APB2_DIV != 0UL) && (CLOCK_CONFIG_PCLK2_HZ <= CLOCK_PCLK2_MAX), "APB2 too fast");
+_Static_assert(CLOCK_CONFIG_FLASH_LATENCY <= 7UL, "flash latency out of range");
+_Static_assert(FLASH_LATENCY_5 == 5U, "FLASH_LATENCY_x is not the wait state count");
+_Static_assert(CLOCK_UART_ERROR_PPM(CLOCK_CONFIG_PCLK1_HZ, CLOCK_CONFIG_UART_BAUD) < 10000ULL,
+               "console baud rate error over 1 %");
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCK_CONFIG_H */
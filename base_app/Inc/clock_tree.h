@@ -0,0 +1,115 @@
+/**
+  ******************************************************************************
+  * @file    clock_tree.h
+  * @brief   STM32F407 clock tree solver in constant expressions.
+  ******************************************************************************
+  * Every macro here is a plain integer expression of its arguments, so the
+  * same solver folds to constants in the firmware (clock_config.h, checked
+  * with _Static_assert) and is swept exhaustively on the host
+  * (tests/test_clock_tree.c). A result of 0 means "no solution".
+  *
+  * Main PLL, RM0090 6.3.2:
+  *
+  *   VCO in  = source / M          1 to 2 MHz, 2 MHz preferred (lower jitter)
+  *   VCO out = VCO in * N          100 to 432 MHz, N 50 to 432
+  *   SYSCLK  = VCO out / P         P 2, 4, 6 or 8
+  *   USB     = VCO out / Q         Q 2 to 15, exactly 48 MHz for USB OTG FS
+  *
+  * The solver takes the 2 MHz VCO input when the source divides to it, else
+  * 1 MHz, then the smallest P that makes SYSCLK exactly and, when a USB
+  * clock is asked for, 48 MHz exactly too. With no USB clock (usb = 0) Q is
+  * the smallest that keeps the 48 MHz domain at or below 48 MHz.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLOCK_TREE_H
+#define __CLOCK_TREE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define CLOCK_VCO_IN_MIN      1000000UL
+#define CLOCK_VCO_IN_MAX      2000000UL
+#define CLOCK_VCO_OUT_MIN     100000000UL
+#define CLOCK_VCO_OUT_MAX     432000000UL
+#define CLOCK_PLLN_MIN        50UL
+#define CLOCK_PLLN_MAX        432UL
+#define CLOCK_PLLQ_MIN        2UL
+#define CLOCK_PLLQ_MAX        15UL
+#define CLOCK_SYSCLK_MAX      168000000UL
+#define CLOCK_USB_HZ          48000000UL
+#define CLOCK_PCLK1_MAX       42000000UL
+#define CLOCK_PCLK2_MAX       84000000UL
+#define CLOCK_FLASH_WS_HZ     30000000UL    /*!< Per wait state at 2.7 to 3.6 V */
+
+/* Exported macro ------------------------------------------------------------*/
+
+/** VCO input: 2 MHz if the source divides to it, else 1 MHz, else 0 */
+#define CLOCK_VCO_IN(src)                                                     \
+  ((((src) % 2000000UL) == 0UL) && (((src) / 2000000UL) >= 2UL) ? 2000000UL : \
+   (((src) % 1000000UL) == 0UL) && (((src) / 1000000UL) >= 2UL) &&           \
+   (((src) / 1000000UL) <= 63UL) ? 1000000UL : 0UL)
+
+#define CLOCK_PLLM(src)       ((CLOCK_VCO_IN(src) != 0UL) ? ((src) / CLOCK_VCO_IN(src)) : 0UL)
+
+/** Q for a VCO output: exact for a USB clock, else the 48 MHz ceiling */
+#define CLOCK_Q_FOR(vco, usb)                                                 \
+  (((usb) != 0UL) ? ((vco) / (usb)) :                                         \
+   ((((vco) + CLOCK_USB_HZ - 1UL) / CLOCK_USB_HZ) < CLOCK_PLLQ_MIN) ?         \
+     CLOCK_PLLQ_MIN : (((vco) + CLOCK_USB_HZ - 1UL) / CLOCK_USB_HZ))
+
+/** Non-zero if P = p gives an exact, in-range configuration */
+#define CLOCK_FITS(src, sys, usb, p)                                          \
+  ((CLOCK_VCO_IN(src) != 0UL) && ((sys) != 0UL) && ((sys) <= CLOCK_SYSCLK_MAX) && \
+   ((sys) * (p) >= CLOCK_VCO_OUT_MIN) && ((sys) * (p) <= CLOCK_VCO_OUT_MAX) && \
+   (((sys) * (p)) % CLOCK_VCO_IN(src) == 0UL) &&                              \
+   (((usb) == 0UL) || (((sys) * (p)) % (usb) == 0UL)) &&                      \
+   (CLOCK_Q_FOR((sys) * (p), usb) >= CLOCK_PLLQ_MIN) &&                       \
+   (CLOCK_Q_FOR((sys) * (p), usb) <= CLOCK_PLLQ_MAX))
+
+#define CLOCK_PLLP(src, sys, usb)                                             \
+  (CLOCK_FITS(src, sys, usb, 2UL) ? 2UL :                                     \
+   CLOCK_FITS(src, sys, usb, 4UL) ? 4UL :                                     \
+   CLOCK_FITS(src, sys, usb, 6UL) ? 6UL :                                     \
+   CLOCK_FITS(src, sys, usb, 8UL) ? 8UL : 0UL)
+
+#define CLOCK_VCO_OUT(src, sys, usb)  ((sys) * CLOCK_PLLP(src, sys, usb))
+
+#define CLOCK_PLLN(src, sys, usb)                                             \
+  ((CLOCK_PLLP(src, sys, usb) != 0UL) ? (CLOCK_VCO_OUT(src, sys, usb) / CLOCK_VCO_IN(src)) : 0UL)
+
+#define CLOCK_PLLQ(src, sys, usb)                                             \
+  ((CLOCK_PLLP(src, sys, usb) != 0UL) ? CLOCK_Q_FOR(CLOCK_VCO_OUT(src, sys, usb), usb) : 0UL)
+
+/** Flash wait states for an HCLK */
+#define CLOCK_FLASH_LATENCY(hclk)     (((hclk) - 1UL) / CLOCK_FLASH_WS_HZ)
+
+/** Smallest APB prescaler (1 to 16) keeping the bus at or below max, else 0 */
+#define CLOCK_APB_DIV(hclk, max)                                              \
+  (((hclk) <= (max)) ? 1UL : ((hclk) <= 2UL * (max)) ? 2UL :                  \
+   ((hclk) <= 4UL * (max)) ? 4UL : ((hclk) <= 8UL * (max)) ? 8UL :            \
+   ((hclk) <= 16UL * (max)) ? 16UL : 0UL)
+
+/** Timer kernel clock: twice the bus clock unless the prescaler is 1 */
+#define CLOCK_TIM_CLK(hclk, div)      (((div) == 1UL) ? (hclk) : (2UL * (hclk) / (div)))
+
+/** Timer prescaler register value for a tick rate, exact when
+  * CLOCK_TIM_EXACT() holds */
+#define CLOCK_TIM_PSC(tim, tick)      (((tim) / (tick)) - 1UL)
+#define CLOCK_TIM_EXACT(tim, tick)    (((tim) % (tick)) == 0UL)
+
+/** USART BRR at 16x oversampling, and the resulting baud error in ppm */
+#define CLOCK_UART_BRR(pclk, baud)    (((pclk) + (baud) / 2UL) / (baud))
+#define CLOCK_UART_ERROR_PPM(pclk, baud)                                      \
+  ((((pclk) / CLOCK_UART_BRR(pclk, baud)) > (baud)) ?                         \
+   ((((pclk) / CLOCK_UART_BRR(pclk, baud)) - (baud)) * 1000000ULL / (baud)) : \
+   (((baud) - ((pclk) / CLOCK_UART_BRR(pclk, baud))) * 1000000ULL / (baud)))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCK_TREE_H */
@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file    console_lz.h
+  * @brief   Header for console_lz.c file.
+  *          printMsg() output on USART3 compressed with LZSS (lzss.h).
+  ******************************************************************************
+  * The console text goes out as frames between the raw writes of the other
+  * modules (boot, crash and supervisor reports, benches), which text alone
+  * tells apart: it never contains 0x00, 0x01 or 0x02. Binary dumps (the
+  * trace of a crash report or of TRACE_RECORDER_Dump()) would, so they go
+  * through CONSOLE_LZ_Binary() in blocks of their own:
+  *
+  *   0x00 len payload        continues the stream
+  *   0x01 bits len payload   restarts it, window of "bits" bits
+  *   0x02 lo hi data         lo + 256 * hi bytes of binary, passed through
+  *
+  * The payload is up to 255 bytes of LZSS_Frame() output. A restart comes
+  * every CONSOLE_LZ_RESTART_FRAMES frames, so a terminal attached late
+  * syncs up within a few seconds; tools/lzcat.c decodes a capture or a
+  * serial port on the host and passes everything else through.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CONSOLE_LZ_H
+#define __CONSOLE_LZ_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "lzss.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Compress printMsg() output on USART3; the USB console stays plain */
+#ifndef CONSOLE_LZ
+#define CONSOLE_LZ                  0
+#endif
+
+/** History kept on both sides, 8 (256 bytes) to 11 (2 KB) */
+#ifndef CONSOLE_LZ_WINDOW_BITS
+#define CONSOLE_LZ_WINDOW_BITS      11U
+#endif
+
+#define CONSOLE_LZ_RESTART_FRAMES   64U       /*!< Frames between restarts    */
+
+/* Frame markers */
+#define CONSOLE_LZ_CONTINUE         0x00U
+#define CONSOLE_LZ_RESTART          0x01U
+#define CONSOLE_LZ_BINARY           0x02U
+#define CONSOLE_LZ_PAYLOAD_MAX      255U
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef CONSOLE_LZ_Init(UART_HandleTypeDef *huart);
+void              CONSOLE_LZ_Write(const char *text, uint32_t length);
+HAL_StatusTypeDef CONSOLE_LZ_Binary(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONSOLE_LZ_H */
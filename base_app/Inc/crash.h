@@ -0,0 +1,112 @@
+/**
+  ******************************************************************************
+  * @file    crash.h
+  * @brief   Header for crash.c file.
+  *          Fault capture record: stacked frame, fault status registers and
+  *          the tail of the event trace, decoded into a report on next boot.
+  ******************************************************************************
+  * The record lives in .noinit RAM (crash_handler.c) so it survives the
+  * reset issued right after the capture. A checksum tells a record written
+  * by a fault from power-on garbage.
+  *
+  * Trace and Trace header are laid out as a trace dump (trace.h), so the
+  * record can be fed to tools/trace2json as is.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CRASH_H
+#define __CRASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "trace.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define CRASH_MAGIC             0x48535243U   /*!< "CRSH": captured, not reported */
+#define CRASH_MAGIC_REPORTED    0x44505243U   /*!< "CRPD": already reported      */
+#define CRASH_TRACE_RECORDS     32U           /*!< Newest trace records kept     */
+#define CRASH_LINE_MAX          78U           /*!< Report line buffer size       */
+#define CRASH_GUARD_NAME_MAX    12U           /*!< Guard name, with terminator   */
+
+/** Exception numbers (IPSR) of the fault handlers */
+#define CRASH_EXC_HARDFAULT     3U
+#define CRASH_EXC_MEMMANAGE     4U
+#define CRASH_EXC_BUSFAULT      5U
+#define CRASH_EXC_USAGEFAULT    6U
+
+/** Record flags */
+#define CRASH_FLAG_FRAME        0x01U         /*!< Frame holds the stacked registers  */
+#define CRASH_FLAG_PSP          0x02U         /*!< Faulting code ran on the process stack */
+#define CRASH_FLAG_FPU          0x04U         /*!< Extended frame with FP registers   */
+#define CRASH_FLAG_GUARD        0x08U         /*!< An MPU guard region was hit        */
+#define CRASH_FLAG_STACK        0x10U         /*!< ... guarding the end of a stack    */
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Registers pushed by the core on exception entry
+  */
+typedef struct
+{
+  uint32_t R0;
+  uint32_t R1;
+  uint32_t R2;
+  uint32_t R3;
+  uint32_t R12;
+  uint32_t Lr;
+  uint32_t Pc;
+  uint32_t Xpsr;
+} CRASH_FrameTypeDef;
+
+/**
+  * @brief  System control block fault status and address registers
+  */
+typedef struct
+{
+  uint32_t Cfsr;
+  uint32_t Hfsr;
+  uint32_t Mmfar;
+  uint32_t Bfar;
+} CRASH_FaultRegsTypeDef;
+
+typedef struct
+{
+  uint32_t Magic;
+  uint32_t Checksum;          /*!< Over every following word                */
+  uint32_t Count;             /*!< Faults since power-on                    */
+  uint32_t Exception;         /*!< CRASH_EXC_xxx                            */
+  uint32_t ExcReturn;         /*!< LR on handler entry                      */
+  uint32_t Sp;                /*!< Stack pointer before the exception       */
+  uint32_t Flags;             /*!< CRASH_FLAG_xxx                           */
+  CRASH_FrameTypeDef      Frame;
+  CRASH_FaultRegsTypeDef  Regs;
+  char                    Guard[CRASH_GUARD_NAME_MAX]; /*!< Guard hit, CRASH_FLAG_GUARD */
+  uint32_t                GuardAddress;
+  TRACE_DumpHeaderTypeDef TraceHeader;
+  TRACE_RecordTypeDef     Trace[CRASH_TRACE_RECORDS];
+} CRASH_RecordTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void     CRASH_Capture(CRASH_RecordTypeDef *record, uint32_t exception, uint32_t exc_return,
+                       uint32_t sp, const uint32_t *frame, const CRASH_FaultRegsTypeDef *regs);
+void     CRASH_CaptureGuard(CRASH_RecordTypeDef *record, const char *name, uint8_t stack,
+                            uint32_t address);
+void     CRASH_CaptureTrace(CRASH_RecordTypeDef *record, const TRACE_RingTypeDef *ring);
+void     CRASH_Seal(CRASH_RecordTypeDef *record);
+uint8_t  CRASH_IsValid(const CRASH_RecordTypeDef *record);
+uint8_t  CRASH_IsPending(const CRASH_RecordTypeDef *record);
+void     CRASH_MarkReported(CRASH_RecordTypeDef *record);
+
+const char *CRASH_ExceptionName(uint32_t exception);
+uint32_t CRASH_Causes(const CRASH_FaultRegsTypeDef *regs, char *out, uint32_t size);
+uint32_t CRASH_FormatLine(const CRASH_RecordTypeDef *record, uint32_t line, char *out, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CRASH_H */
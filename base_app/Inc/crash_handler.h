@@ -0,0 +1,57 @@
+/**
+  ******************************************************************************
+  * @file    crash_handler.h
+  * @brief   Header for crash_handler.c file.
+  *          Fault handler entry: capture a crash record and reset at once.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CRASH_HANDLER_H
+#define __CRASH_HANDLER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "crash.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Private stack for the capture, so a stack overflow fault can be recorded.
+  * Plain number: it is pasted into the entry assembly. */
+#define CRASH_STACK_SIZE      512
+
+/* Exported variables --------------------------------------------------------*/
+extern CRASH_RecordTypeDef CrashRecord;
+
+/* Exported macro ------------------------------------------------------------*/
+#define CRASH_STR_(x)         #x
+#define CRASH_STR(x)          CRASH_STR_(x)
+
+/**
+  * @brief  Entry sequence for a naked fault handler: pick the stack the core
+  *         pushed the frame on, switch to the crash stack and hand over to
+  *         CRASH_HandleFault(), which never returns.
+  */
+#define CRASH_FAULT_ENTRY()                                     \
+  __ASM volatile ("tst   lr, #4                          \n"    \
+                  "ite   eq                              \n"    \
+                  "mrseq r0, msp                         \n"    \
+                  "mrsne r0, psp                         \n"    \
+                  "mov   r1, lr                          \n"    \
+                  "ldr   r2, =CrashStack+" CRASH_STR(CRASH_STACK_SIZE) "\n" \
+                  "mov   sp, r2                          \n"    \
+                  "b     CRASH_HandleFault               \n")
+
+/* Exported functions prototypes ---------------------------------------------*/
+void    CRASH_HANDLER_Init(void);
+void    CRASH_HandleFault(const uint32_t *sp, uint32_t exc_return) __attribute__((noreturn));
+uint8_t CRASH_HANDLER_Report(UART_HandleTypeDef *huart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CRASH_HANDLER_H */
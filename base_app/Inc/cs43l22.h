@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file    cs43l22.h
+  * @brief   Header for cs43l22.c file.
+  *          Non-blocking control of the CS43L22 audio codec over I2C1.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CS43L22_H
+#define __CS43L22_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "i2c_queue.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define CS43L22_I2C_ADDRESS       0x94U
+#define CS43L22_CHIP_ID_MASK      0xF8U
+#define CS43L22_CHIP_ID           0xE0U
+
+#ifndef CS43L22_DEFAULT_VOLUME
+#define CS43L22_DEFAULT_VOLUME    70U     /*!< Percent */
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  CS43L22_RESET = 0x00U,    /*!< Not configured yet                     */
+  CS43L22_BUSY  = 0x01U,    /*!< Power-up sequence on the bus           */
+  CS43L22_READY = 0x02U,
+  CS43L22_ERROR = 0x03U     /*!< A register access failed for good      */
+} CS43L22_StateTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+I2CQ_StatusTypeDef   CS43L22_Init(void);
+I2CQ_StatusTypeDef   CS43L22_SetVolume(uint8_t percent);
+I2CQ_StatusTypeDef   CS43L22_Poll(void);
+CS43L22_StateTypeDef CS43L22_GetState(void);
+uint8_t              CS43L22_GetChipId(void);
+uint8_t              CS43L22_GetStatus(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CS43L22_H */
@@ -0,0 +1,75 @@
+/**
+  ******************************************************************************
+  * @file    dac_stream.h
+  * @brief   Header for dac_stream.c file.
+  *          Signal generator on DAC channel 2, clocked by TIM6 TRGO and fed
+  *          by circular DMA.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DAC_STREAM_H
+#define __DAC_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "dac_wave.h"
+#include "dvfs.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Samples in the driver's own buffer: one sine table, or two halves of a
+  * stream; 512 samples a half is 0.5 ms at the 1 MHz limit */
+#ifndef DAC_STREAM_SAMPLES
+#define DAC_STREAM_SAMPLES      1024U
+#endif
+#define DAC_STREAM_HALF         (DAC_STREAM_SAMPLES / 2U)
+
+#define DAC_STREAM_MIN_CYCLE    4U      /*!< Fewest samples a sine cycle gets  */
+
+/** Half-buffer refills; below the audio and I2C interrupts, whose deadlines
+  * are tighter than a stream's half buffer, above the button. */
+#define DAC_STREAM_IRQ_PRIORITY 7U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Renders the next samples of a stream, 12-bit codes. Runs in the
+  *         DMA interrupt and must finish within a half buffer's time.
+  */
+typedef void (*DAC_STREAM_FillTypeDef)(void *context, uint16_t *block, uint32_t samples);
+
+typedef struct
+{
+  uint32_t SampleHz;      /*!< Rate asked for, 0 when stopped             */
+  uint32_t ActualHz;      /*!< Rate TIM6 runs at                          */
+  int32_t  ErrorPpm;      /*!< Actual against asked                       */
+  uint32_t Samples;       /*!< Length of the loop the DMA plays           */
+  uint32_t Fills;         /*!< Stream halves rendered                     */
+  uint32_t Underruns;     /*!< Triggers the DMA missed                    */
+  uint32_t DmaErrors;     /*!< DMA transfer error interrupts              */
+} DAC_StreamStatsTypeDef;
+
+/* Exported variables --------------------------------------------------------*/
+extern DMA_HandleTypeDef hdma_dac2;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef  DAC_STREAM_Init(void);
+HAL_StatusTypeDef  DAC_STREAM_PlayTable(const uint16_t *table, uint32_t samples, uint32_t sample_hz);
+HAL_StatusTypeDef  DAC_STREAM_PlaySine(uint32_t hz, uint16_t amplitude, uint16_t offset);
+HAL_StatusTypeDef  DAC_STREAM_PlayChirp(uint32_t f0_hz, uint32_t f1_hz, uint32_t sweep_ms,
+                                        uint16_t amplitude, uint16_t offset, uint32_t sample_hz);
+HAL_StatusTypeDef  DAC_STREAM_PlayStream(DAC_STREAM_FillTypeDef fill, void *context, uint32_t sample_hz);
+void               DAC_STREAM_Stop(void);
+void               DAC_STREAM_GetStats(DAC_StreamStatsTypeDef *stats);
+DVFS_StatusTypeDef DAC_STREAM_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                          const DVFS_PointTypeDef *point);
+void               DAC_STREAM_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DAC_STREAM_H */
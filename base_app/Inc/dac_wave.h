@@ -0,0 +1,91 @@
+/**
+  ******************************************************************************
+  * @file    dac_wave.h
+  * @brief   Header for dac_wave.c file.
+  *          Waveform synthesis and conversion-rate solving for the DAC.
+  ******************************************************************************
+  * Samples are 12-bit right-aligned DAC codes, the layout of DHR12Rx, so a
+  * table goes to the DAC by DMA as it is.
+  *
+  * Phase is a 32-bit fraction of a turn, wrapping on overflow. The
+  * oscillator (DAC_WAVE_Osc) keeps phase and step with 32 more fractional
+  * bits, so it can stream a sine of any frequency, or a linear chirp
+  * sweeping from F0 to F1, block by block with no discontinuity between
+  * blocks. A sweep restarts at F0 with its phase carried on.
+  *
+  * DAC_WAVE_SolveRate() picks the prescaler and auto-reload of the trigger
+  * timer closest to a sample rate.
+  *
+  * Nothing in here touches hardware; dac_stream.c plays the tables.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DAC_WAVE_H
+#define __DAC_WAVE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define DAC_WAVE_FULL       4095U           /*!< Largest 12-bit code            */
+#define DAC_WAVE_MID        2048U           /*!< Mid-scale, VREF+ / 2           */
+#define DAC_WAVE_MAX_RATE   1000000UL       /*!< DAC conversion rate limit, Hz  */
+#define DAC_WAVE_TIM_MAX    0x10000UL       /*!< 16-bit prescaler and reload    */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  DAC_WAVE_OK      = 0x00U,
+  DAC_WAVE_INVALID = 0x01U    /*!< Zero size, rate above the limit or Nyquist */
+} DAC_WAVE_StatusTypeDef;
+
+/**
+  * @brief  Trigger timer setting for a sample rate
+  */
+typedef struct
+{
+  uint32_t Prescaler;         /*!< PSC register value                         */
+  uint32_t Period;            /*!< ARR register value                         */
+  uint32_t ActualHz;          /*!< Rate it gives, rounded                     */
+  int32_t  ErrorPpm;          /*!< Actual against wanted                      */
+} DAC_WAVE_RateTypeDef;
+
+/**
+  * @brief  Sine oscillator, optionally sweeping linearly in frequency
+  */
+typedef struct
+{
+  uint64_t Phase;             /*!< Turns, 32.32 fixed point                   */
+  uint64_t Step;              /*!< Phase advance per sample                   */
+  uint64_t StartStep;         /*!< Step at F0                                 */
+  int64_t  Sweep;             /*!< Step change per sample, 0 for a tone       */
+  uint32_t Length;            /*!< Samples per sweep                          */
+  uint32_t Position;          /*!< Samples into the current sweep             */
+  uint16_t Amplitude;         /*!< Peak, DAC codes                            */
+  uint16_t Offset;            /*!< Centre, DAC codes                          */
+} DAC_WAVE_OscTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+DAC_WAVE_StatusTypeDef DAC_WAVE_SolveRate(uint32_t timer_hz, uint32_t sample_hz, DAC_WAVE_RateTypeDef *rate);
+
+int32_t                DAC_WAVE_Sin(uint32_t phase);
+DAC_WAVE_StatusTypeDef DAC_WAVE_Sine(uint16_t *table, uint32_t samples, uint32_t cycles,
+                                     uint16_t amplitude, uint16_t offset);
+DAC_WAVE_StatusTypeDef DAC_WAVE_Shape(uint16_t *table, uint32_t samples, const uint16_t *points,
+                                      uint32_t count);
+
+DAC_WAVE_StatusTypeDef DAC_WAVE_OscInit(DAC_WAVE_OscTypeDef *osc, uint32_t sample_hz, uint32_t f0_hz,
+                                        uint32_t f1_hz, uint32_t sweep_ms, uint16_t amplitude,
+                                        uint16_t offset);
+void                   DAC_WAVE_OscRender(DAC_WAVE_OscTypeDef *osc, uint16_t *block, uint32_t samples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DAC_WAVE_H */
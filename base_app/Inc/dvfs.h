@@ -0,0 +1,135 @@
+/**
+  ******************************************************************************
+  * @file    dvfs.h
+  * @brief   Header for dvfs.c file.
+  *          Operating points, peripheral re-timing math, switch sequencing,
+  *          driver notification and the load governor.
+  ******************************************************************************
+  * An operating point fixes the whole clock tree: SYSCLK from the main PLL
+  * (always the one solved in clock_config.h) or straight from the HSI, the
+  * AHB/APB prescalers, flash wait states and the regulator scale. Points
+  * are listed fastest first.
+  *
+  * The regulator scale of the STM32F407 can only change while the main PLL
+  * is off, so PLL points run at scale 1 and only PLL-less points may use
+  * scale 2 (HCLK up to 144 MHz).
+  *
+  * Everything here is portable; power.c applies it to the RCC and to the
+  * peripherals.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DVFS_H
+#define __DVFS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define DVFS_MAX_NOTIFIERS    8U
+#define DVFS_MAX_STEPS        4U
+#define DVFS_SCALE2_MAX_HZ    144000000UL   /*!< HCLK limit at regulator scale 2 */
+#define DVFS_SYSTICK_MAX      0x00FFFFFFUL
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  DVFS_OK      = 0x00U,
+  DVFS_BUSY    = 0x01U,     /*!< A driver vetoed the switch            */
+  DVFS_INEXACT = 0x02U,     /*!< Rate not reachable without error      */
+  DVFS_FULL    = 0x03U,
+  DVFS_INVALID = 0x04U
+} DVFS_StatusTypeDef;
+
+typedef enum
+{
+  DVFS_EV_PRE  = 0x00U,     /*!< About to switch; return DVFS_BUSY to veto, change nothing */
+  DVFS_EV_POST = 0x01U      /*!< Switched; re-time the peripheral      */
+} DVFS_EventTypeDef;
+
+/** Switch steps, in the order they must run */
+typedef enum
+{
+  DVFS_STEP_SCALE_UP   = 0x00U,   /*!< Regulator to scale 1 (PLL off)   */
+  DVFS_STEP_PLL_ON     = 0x01U,
+  DVFS_STEP_CLOCKS     = 0x02U,   /*!< SYSCLK source, prescalers, flash latency */
+  DVFS_STEP_PLL_OFF    = 0x03U,
+  DVFS_STEP_SCALE_DOWN = 0x04U    /*!< Regulator to scale 2 (PLL off)   */
+} DVFS_StepTypeDef;
+
+typedef struct
+{
+  const char *Name;
+  uint32_t    SysclkHz;       /*!< PLL output or HSI                     */
+  uint16_t    AhbDiv;         /*!< 1, 2, 4, 8, 16, 64, 128, 256 or 512   */
+  uint8_t     UsePll;
+  uint8_t     Apb1Div;        /*!< 1, 2, 4, 8 or 16                      */
+  uint8_t     Apb2Div;
+  uint8_t     FlashLatency;   /*!< Wait states                           */
+  uint8_t     VoltageScale;   /*!< 1 or 2                                */
+} DVFS_PointTypeDef;
+
+typedef DVFS_StatusTypeDef (*DVFS_CallbackTypeDef)(void *context, DVFS_EventTypeDef event,
+                                                   const DVFS_PointTypeDef *point);
+
+typedef struct
+{
+  DVFS_CallbackTypeDef Callback;
+  void                *Context;
+} DVFS_NotifierTypeDef;
+
+typedef struct
+{
+  const DVFS_PointTypeDef *Points;
+  uint32_t             Count;
+  uint32_t             Current;       /*!< Index of the active point        */
+  DVFS_NotifierTypeDef Notifiers[DVFS_MAX_NOTIFIERS];
+  uint32_t             NotifierCount;
+  uint32_t             Switches;
+  uint32_t             Vetoes;
+} DVFS_HandleTypeDef;
+
+/**
+  * @brief  Load governor: jump to the fastest point under load, step down
+  *         one point per quiet window, never below Floor
+  */
+typedef struct
+{
+  uint16_t UpPermille;        /*!< Load at or above which to go fastest  */
+  uint16_t DownPermille;      /*!< Load below which to step down         */
+  uint32_t Floor;             /*!< Slowest point index allowed           */
+  uint32_t LastTotal;
+  uint32_t LastIdle;
+  uint16_t Load;              /*!< Load of the last window, permille     */
+} DVFS_GovernorTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint32_t           DVFS_Hclk(const DVFS_PointTypeDef *point);
+uint32_t           DVFS_Pclk(const DVFS_PointTypeDef *point, uint32_t apb);
+uint32_t           DVFS_TimerClock(const DVFS_PointTypeDef *point, uint32_t apb);
+DVFS_StatusTypeDef DVFS_TimerPrescaler(uint32_t timer_hz, uint32_t tick_hz, uint32_t *psc);
+uint32_t           DVFS_UartBrr(uint32_t pclk, uint32_t baud);
+DVFS_StatusTypeDef DVFS_SysTickReload(uint32_t hclk, uint32_t tick_hz, uint32_t *reload);
+DVFS_StatusTypeDef DVFS_Validate(const DVFS_PointTypeDef *point);
+uint32_t           DVFS_Plan(const DVFS_PointTypeDef *from, const DVFS_PointTypeDef *to,
+                             DVFS_StepTypeDef steps[DVFS_MAX_STEPS]);
+
+DVFS_StatusTypeDef DVFS_Init(DVFS_HandleTypeDef *hdvfs, const DVFS_PointTypeDef *points,
+                             uint32_t count, uint32_t current);
+DVFS_StatusTypeDef DVFS_Register(DVFS_HandleTypeDef *hdvfs, DVFS_CallbackTypeDef callback, void *context);
+DVFS_StatusTypeDef DVFS_Notify(DVFS_HandleTypeDef *hdvfs, DVFS_EventTypeDef event, uint32_t index);
+
+void     DVFS_GovernorInit(DVFS_GovernorTypeDef *gov, uint16_t up_permille, uint16_t down_permille,
+                           uint32_t floor);
+uint32_t DVFS_GovernorUpdate(DVFS_GovernorTypeDef *gov, uint32_t current, uint32_t total, uint32_t idle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DVFS_H */
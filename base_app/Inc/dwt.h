@@ -0,0 +1,63 @@
+/**
+  ******************************************************************************
+  * @file    dwt.h
+  * @brief   DWT cycle counter helpers for timestamps and cycle benchmarks.
+  ******************************************************************************
+  * CYCCNT counts core clock cycles and wraps every 2^32 cycles (about 25 s at
+  * 168 MHz); unsigned subtraction of two readings is correct across one wrap.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DWT_H
+#define __DWT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Enable the trace block and start the cycle counter from zero.
+  *         Reset_Handler normally has it running since reset already (boot
+  *         stamps, boot.h); it is then left counting.
+  * @retval None
+  */
+static inline void DWT_Init(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0U)
+  {
+    DWT->CYCCNT = 0U;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+}
+
+/**
+  * @brief  Current cycle count.
+  * @retval CYCCNT
+  */
+static inline uint32_t DWT_Cycles(void)
+{
+  return DWT->CYCCNT;
+}
+
+/**
+  * @brief  Convert a cycle count to microseconds at the current core clock.
+  * @param  cycles: Cycle count, typically the difference of two readings
+  * @retval Microseconds, rounded down
+  */
+static inline uint32_t DWT_CyclesToUs(uint32_t cycles)
+{
+  return cycles / (SystemCoreClock / 1000000U);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DWT_H */
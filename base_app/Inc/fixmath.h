@@ -0,0 +1,80 @@
+/**
+  ******************************************************************************
+  * @file    fixmath.h
+  * @brief   Header for fixmath.c file.
+  *          Q15/Q31 trigonometry, square root and reciprocal without libm.
+  ******************************************************************************
+  * Angles are binary: a 32-bit fraction of a turn that wraps on overflow,
+  * the phase of dac_wave.h, so 0x40000000 is 90 degrees and, read as
+  * int32_t, 0x80000000 is -180.
+  *
+  *   FIX_SinCos()   sine and cosine in Q31 by CORDIC rotation
+  *   FIX_Atan2()    angle of (x, y) by CORDIC vectoring, any scale of input
+  *   FIX_Sin15()    sine and cosine in Q15 from an interpolated table, for
+  *   FIX_Cos15()    loops that need speed more than the last bits
+  *   FIX_Lookup()   linear interpolation in any table of that layout
+  *   FIX_Sqrt()     integer square root, bit by bit; the root of a Q30
+  *                  (a sum of Q15 squares) is Q15
+  *   FIX_SqrtQ31()  Q31 square root, Newton on the reciprocal root
+  *   FIX_Recip()    2^32 / x, Newton on the reciprocal; the reciprocal of a
+  *                  Q16.16 is Q16.16
+  *
+  * The square roots and the reciprocal are exact (rounded down); the error
+  * bounds of the others are FIX_*_ERROR, checked against double precision by
+  * tests/test_fixmath.c.
+  *
+  * The tables (CORDIC arctangents and gain, the quarter sine, the Newton
+  * seeds) are not in the sources: tools/fixmath_gen.c computes them in
+  * double precision from the sizes below and writes fixmath_tables.c into
+  * the build directory, for the firmware and the tests alike, where they
+  * end up as const data in flash.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FIXMATH_H
+#define __FIXMATH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define FIX_ANGLE_90            0x40000000UL
+#define FIX_ANGLE_180           0x80000000UL
+
+#define FIX_CORDIC_STEPS        30U         /*!< Iterations, one bit each     */
+#define FIX_SIN_BITS            8U          /*!< 256 segments per quarter     */
+#define FIX_SEED_BITS           8U          /*!< Newton seed index            */
+
+/* Error bounds against double precision, in LSB of the result */
+#define FIX_SINCOS_ERROR        32          /*!< Q31, 3 per unit of angle     */
+#define FIX_ATAN2_ERROR         24          /*!< Binary angle                 */
+#define FIX_SIN15_ERROR         1           /*!< Q15                          */
+
+/* Exported variables --------------------------------------------------------*/
+/* Generated by tools/fixmath_gen.c */
+extern const uint32_t FIX_AtanTable[FIX_CORDIC_STEPS];         /*!< atan(2^-i)      */
+extern const int32_t  FIX_CordicGain;                          /*!< 1/K, Q30        */
+extern const int16_t  FIX_SinTable[(1UL << FIX_SIN_BITS) + 1U]; /*!< Quarter, Q15   */
+extern const uint16_t FIX_RecipSeed[1UL << FIX_SEED_BITS];     /*!< 1/m, UQ1.15     */
+extern const uint16_t FIX_RsqrtSeed[3UL << (FIX_SEED_BITS - 2U)]; /*!< 1/sqrt(m)    */
+
+/* Exported functions prototypes ---------------------------------------------*/
+void     FIX_SinCos(uint32_t angle, int32_t *sine, int32_t *cosine);
+int32_t  FIX_Atan2(int32_t y, int32_t x);
+int16_t  FIX_Sin15(uint32_t angle);
+int16_t  FIX_Cos15(uint32_t angle);
+int32_t  FIX_Lookup(const int16_t *table, uint32_t bits, uint32_t position);
+uint32_t FIX_Sqrt(uint32_t x);
+int32_t  FIX_SqrtQ31(int32_t x);
+uint32_t FIX_Recip(uint32_t x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FIXMATH_H */
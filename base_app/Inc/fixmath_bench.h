@@ -0,0 +1,36 @@
+/**
+  ******************************************************************************
+  * @file    fixmath_bench.h
+  * @brief   Header for fixmath_bench.c file.
+  *          Cycles per call of the fixed-point math (fixmath.h) against the
+  *          libm float functions it replaces.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FIXMATH_BENCH_H
+#define __FIXMATH_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Run the math benchmark once at start-up; off in production builds */
+#ifndef FIXMATH_BENCH
+#define FIXMATH_BENCH             0
+#endif
+
+#define FIXMATH_BENCH_CALLS       256U      /*!< Per function, distinct inputs */
+
+/* Exported functions prototypes ---------------------------------------------*/
+void FIXMATH_BENCH_Run(UART_HandleTypeDef *huart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FIXMATH_BENCH_H */
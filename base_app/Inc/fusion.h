@@ -0,0 +1,78 @@
+/**
+  ******************************************************************************
+  * @file    fusion.h
+  * @brief   Header for fusion.c file.
+  *          Tilt and vibration from a 3-axis accelerometer: a Kalman filter
+  *          on the gravity vector with a measurement noise learnt online.
+  ******************************************************************************
+  * The state is gravity in the sensor frame, x = (gx, gy, gz) in g. Without
+  * a gyroscope nothing predicts how it turns, so it is a random walk whose
+  * step variance Q comes from the fastest rotation the filter should follow,
+  * and every sample measures it directly (H = I):
+  *
+  *   predict   P = P + Q I
+  *   update    r = a - x,  S = P + R,  K = P S^-1
+  *             x = x + K r,  P = P - K P
+  *
+  * Whatever is not gravity in a sample is vibration or motion. R is the
+  * covariance of the innovation r over a window of samples (its mean taken
+  * out, so a change of tilt does not count) plus the sensor noise floor; it
+  * is a full matrix, so vibration along one axis only slows the filter down
+  * along that axis. Its trace is the vibration power, reported as an RMS.
+  *
+  * All matrices are 3x3, symmetric ones stored as their upper triangle, and
+  * every product and the inverse are written out element by element: no
+  * loops, no pivoting, nothing but single-precision multiply-adds and two
+  * divisions for the FPU.
+  *
+  * The filter state (the covariances above all) is plain data the caller
+  * places; nothing in here touches hardware, accel_input.c runs the sensor.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FUSION_H
+#define __FUSION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define FUSION_P0               0.01f       /*!< Initial variance, g^2        */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  float    X[3];              /*!< Gravity estimate, g                    */
+  float    P[6];              /*!< Its covariance: xx xy xz yy yz zz      */
+  float    Mean[3];           /*!< Innovation mean                        */
+  float    Moment[6];         /*!< Innovation second moment               */
+  float    Q;                 /*!< Random walk variance per update, g^2   */
+  float    R0;                /*!< Sensor noise variance, g^2             */
+  uint32_t Window;            /*!< Innovation statistics, samples         */
+  uint32_t Updates;
+} FUSION_TypeDef;
+
+typedef struct
+{
+  float Roll;                 /*!< About X, degrees, -180..180            */
+  float Pitch;                /*!< About Y, degrees, -90..90              */
+  float Tilt;                 /*!< Z axis from vertical, degrees, 0..180  */
+} FUSION_TiltTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void  FUSION_Init(FUSION_TypeDef *f, float odr_hz, float noise_g, float rate_dps, float window_s);
+void  FUSION_Update(FUSION_TypeDef *f, float ax, float ay, float az);
+void  FUSION_Tilt(const FUSION_TypeDef *f, FUSION_TiltTypeDef *tilt);
+void  FUSION_TiltOf(float gx, float gy, float gz, FUSION_TiltTypeDef *tilt);
+float FUSION_Vibration(const FUSION_TypeDef *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FUSION_H */
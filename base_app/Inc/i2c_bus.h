@@ -0,0 +1,49 @@
+/**
+  ******************************************************************************
+  * @file    i2c_bus.h
+  * @brief   Header for i2c_bus.c file.
+  *          I2C1 port of the queued transaction engine (i2c_queue.h).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __I2C_BUS_H
+#define __I2C_BUS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "i2c_queue.h"
+#include "dvfs.h"
+
+/* Exported constants --------------------------------------------------------*/
+#ifndef I2C_BUS_SPEED
+#define I2C_BUS_SPEED           100000U
+#endif
+
+/** Event, error and RX DMA interrupts share one level so the engine only
+  * ever runs in one context; below the audio DMA, above the SysTick. */
+#define I2C_BUS_IRQ_PRIORITY    6U
+
+/* Exported variables --------------------------------------------------------*/
+extern I2CQ_HandleTypeDef hi2cq1;
+extern DMA_HandleTypeDef  hdma_i2c1_rx;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef  I2C_BUS_Init(void);
+I2CQ_StatusTypeDef I2C_BUS_Submit(I2CQ_XferTypeDef *xfers, uint32_t count);
+I2CQ_StatusTypeDef I2C_BUS_Wait(I2CQ_XferTypeDef *xfer);
+void               I2C_BUS_Tick(void);
+DVFS_StatusTypeDef I2C_BUS_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                       const DVFS_PointTypeDef *point);
+void               I2C_BUS_EV_IRQHandler(void);
+void               I2C_BUS_ER_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __I2C_BUS_H */
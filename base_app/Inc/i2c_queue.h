@@ -0,0 +1,140 @@
+/**
+  ******************************************************************************
+  * @file    i2c_queue.h
+  * @brief   Header for i2c_queue.c file.
+  *          Queued, event-driven I2C register transaction engine.
+  ******************************************************************************
+  * The engine owns the transaction order and the error policy; everything
+  * that touches the peripheral is behind I2CQ_PortTypeDef. On the target the
+  * port is I2C1 (src/i2c_bus.c), in the host tests it is a scripted bus
+  * simulator (tests/test_i2c_queue.c).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __I2C_QUEUE_H
+#define __I2C_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/** Transactions that can wait behind the active one (power of two) */
+#ifndef I2CQ_DEPTH
+#define I2CQ_DEPTH              16U
+#endif
+
+/** Ticks a transaction may stay on the bus before it is aborted */
+#ifndef I2CQ_TIMEOUT_TICKS
+#define I2CQ_TIMEOUT_TICKS      10U
+#endif
+
+#define I2CQ_WRITE              0x00U
+#define I2CQ_READ               0x01U
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  I2CQ_OK        = 0x00U,
+  I2CQ_PENDING   = 0x01U,   /*!< Queued or on the bus                        */
+  I2CQ_NACK      = 0x02U,   /*!< Address or data byte not acknowledged       */
+  I2CQ_BUS_ERROR = 0x03U,   /*!< Misplaced START/STOP, arbitration, overrun  */
+  I2CQ_TIMEOUT   = 0x04U,   /*!< Not done within I2CQ_TIMEOUT_TICKS          */
+  I2CQ_FULL      = 0x05U,   /*!< Submit: not enough room for the batch       */
+  I2CQ_INVALID   = 0x06U    /*!< Submit: malformed descriptor                */
+} I2CQ_StatusTypeDef;
+
+/**
+  * @brief  Events the port reports back to the engine
+  */
+typedef enum
+{
+  I2CQ_EV_START = 0U,       /*!< START or repeated START is on the bus (SB)  */
+  I2CQ_EV_ADDR_ACK,         /*!< Write address acknowledged (ADDR)           */
+  I2CQ_EV_TX_DONE,          /*!< Byte shifted out and acknowledged (BTF)     */
+  I2CQ_EV_RX_DONE,          /*!< PrepareRead buffer filled, STOP issued      */
+  I2CQ_EV_NACK,             /*!< Acknowledge failure (AF)                    */
+  I2CQ_EV_BUS_ERROR         /*!< BERR, ARLO or OVR                           */
+} I2CQ_EventTypeDef;
+
+/**
+  * @brief  One register read or write. The descriptor belongs to the caller
+  *         and must stay valid until Status leaves I2CQ_PENDING.
+  */
+typedef struct I2CQ_Xfer
+{
+  uint8_t   DevAddr;        /*!< 8-bit bus address, R/W bit ignored          */
+  uint8_t   Reg;            /*!< Register (sub-address) byte                 */
+  uint8_t   Dir;            /*!< I2CQ_WRITE or I2CQ_READ                     */
+  uint8_t   Retries;        /*!< Extra attempts after a NACK/bus error       */
+  uint8_t  *Data;
+  uint16_t  Len;            /*!< Data bytes after Reg, 0 allowed for writes  */
+  volatile uint8_t Status;  /*!< I2CQ_StatusTypeDef                          */
+  void    (*Callback)(struct I2CQ_Xfer *xfer); /*!< Called on completion, may be NULL */
+  void     *Context;        /*!< Free for the owner of the descriptor        */
+} I2CQ_XferTypeDef;
+
+/**
+  * @brief  Bus operations the engine drives. Every operation only starts an
+  *         action; its outcome comes back later through I2CQ_Event().
+  */
+typedef struct
+{
+  void (*Start)(void);                              /*!< (Re)START -> EV_START          */
+  void (*SendAddress)(uint8_t addr);                /*!< -> EV_ADDR_ACK, EV_RX_DONE, EV_NACK */
+  void (*WriteByte)(uint8_t value);                 /*!< -> EV_TX_DONE or EV_NACK       */
+  void (*PrepareRead)(uint8_t *data, uint16_t len); /*!< Arm reception before the read address */
+  void (*Stop)(void);
+  void (*Recover)(void);                            /*!< Reset the peripheral, free SDA */
+  void (*Kick)(void);                               /*!< Run I2CQ_Service() in bus context */
+  uint32_t (*Lock)(void);                           /*!< Mask the bus interrupts        */
+  void (*Unlock)(uint32_t state);
+} I2CQ_PortTypeDef;
+
+typedef struct
+{
+  uint32_t Completed;       /*!< Transactions finished with I2CQ_OK          */
+  uint32_t Failed;          /*!< Transactions finished with an error         */
+  uint32_t Nacks;
+  uint32_t BusErrors;
+  uint32_t Timeouts;
+  uint32_t Retries;
+  uint32_t Recoveries;
+  uint32_t MaxQueued;       /*!< High-water mark of the queue                */
+} I2CQ_StatsTypeDef;
+
+typedef struct
+{
+  const I2CQ_PortTypeDef *Port;
+  I2CQ_XferTypeDef  *Queue[I2CQ_DEPTH];
+  volatile uint32_t  Head;          /*!< Next slot Submit writes             */
+  volatile uint32_t  Tail;          /*!< Next slot the engine takes          */
+  I2CQ_XferTypeDef  *Active;        /*!< Transaction on the bus, NULL = idle */
+  uint8_t            State;         /*!< See i2c_queue.c                     */
+  uint8_t            Attempt;       /*!< Attempts used by Active             */
+  uint16_t           Index;         /*!< Next data byte of a write           */
+  volatile uint32_t  Ticks;         /*!< Ticks since Active went on the bus  */
+  volatile uint8_t   TimedOut;      /*!< Set by Tick, consumed by Service    */
+  I2CQ_StatsTypeDef  Stats;
+} I2CQ_HandleTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void               I2CQ_Init(I2CQ_HandleTypeDef *q, const I2CQ_PortTypeDef *port);
+I2CQ_StatusTypeDef I2CQ_Submit(I2CQ_HandleTypeDef *q, I2CQ_XferTypeDef *xfers, uint32_t count);
+void               I2CQ_Event(I2CQ_HandleTypeDef *q, I2CQ_EventTypeDef event);
+void               I2CQ_Service(I2CQ_HandleTypeDef *q);
+void               I2CQ_Tick(I2CQ_HandleTypeDef *q);
+uint32_t           I2CQ_Pending(const I2CQ_HandleTypeDef *q);
+
+void I2CQ_SetWrite(I2CQ_XferTypeDef *xfer, uint8_t dev, uint8_t reg, uint8_t *data, uint16_t len);
+void I2CQ_SetRead(I2CQ_XferTypeDef *xfer, uint8_t dev, uint8_t reg, uint8_t *data, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __I2C_QUEUE_H */
@@ -0,0 +1,167 @@
+/**
+  ******************************************************************************
+  * @file    kernel.h
+  * @brief   Header for kernel.c file.
+  *          Preemptive fixed-priority kernel: tasks, semaphores and mutexes
+  *          with priority inheritance.
+  ******************************************************************************
+  * Priority 0 is the highest, KERNEL_PRIORITIES - 1 the lowest (idle). The
+  * highest ready task always runs; tasks of equal priority take turns only
+  * when one of them calls KERNEL_Yield() or blocks.
+  *
+  * The scheduler is portable C. Everything the CPU has to do goes through a
+  * KERNEL_PortTypeDef: the firmware port (kernel_port.c) pends PendSV and
+  * switches stacks there, the unit tests record the switch request and call
+  * KERNEL_Switch() themselves.
+  *
+  * Blocking calls return once the task runs again. Where the port cannot
+  * switch synchronously (host tests) they return KERNEL_PENDING and the
+  * outcome appears later in the task's WaitResult.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __KERNEL_H
+#define __KERNEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define KERNEL_PRIORITIES       32U           /*!< One ready bitmap word        */
+#define KERNEL_MAX_TASKS        16U
+#define KERNEL_STACK_MIN        64U           /*!< Words, frames plus margin    */
+#define KERNEL_STACK_FILL       0xA5A5A5A5U   /*!< Pattern for stack high-water */
+#define KERNEL_FOREVER          0xFFFFFFFFU   /*!< Timeout: wait without limit  */
+
+/** Initial stack frame, from the saved stack pointer upwards. The software
+  * part is what PendSV saves and restores; the hardware part is what the core
+  * unstacks on exception return. */
+#define KERNEL_FRAME_R4         0U            /*!< R4..R11 at 0..7              */
+#define KERNEL_FRAME_EXC_RETURN 8U
+#define KERNEL_FRAME_R0         9U            /*!< R0..R3 at 9..12              */
+#define KERNEL_FRAME_R12        13U
+#define KERNEL_FRAME_LR         14U
+#define KERNEL_FRAME_PC         15U
+#define KERNEL_FRAME_XPSR       16U
+#define KERNEL_FRAME_WORDS      17U
+
+#define KERNEL_EXC_RETURN_TASK  0xFFFFFFFDU   /*!< Thread mode, PSP, no FP frame */
+#define KERNEL_XPSR_THUMB       0x01000000U
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  KERNEL_OK      = 0x00U,
+  KERNEL_PENDING = 0x01U,     /*!< Blocked, the result comes later       */
+  KERNEL_TIMEOUT = 0x02U,
+  KERNEL_FULL    = 0x03U,     /*!< Semaphore at its maximum count        */
+  KERNEL_INVALID = 0x04U
+} KERNEL_StatusTypeDef;
+
+typedef enum
+{
+  KERNEL_TASK_READY    = 0x00U,   /*!< Ready or running                  */
+  KERNEL_TASK_BLOCKED  = 0x01U,   /*!< On a semaphore or mutex           */
+  KERNEL_TASK_SLEEPING = 0x02U,
+  KERNEL_TASK_DEAD     = 0x03U    /*!< Entry function returned           */
+} KERNEL_TaskStateTypeDef;
+
+struct KERNEL_Task;
+struct KERNEL_Mutex;
+
+/**
+  * @brief  Tasks blocked on an object, highest priority first
+  */
+typedef struct
+{
+  struct KERNEL_Task *Head;
+} KERNEL_WaitQueueTypeDef;
+
+/**
+  * @brief  Task control block. Sp must stay the first member.
+  */
+typedef struct KERNEL_Task
+{
+  uint32_t              *Sp;          /*!< Saved stack pointer                  */
+  struct KERNEL_Task    *Next;        /*!< Ready ring or wait queue links       */
+  struct KERNEL_Task    *Prev;
+  const char            *Name;
+  uint32_t              *Stack;       /*!< Lowest word of the stack             */
+  uint32_t               StackWords;
+  uint8_t                Id;
+  uint8_t                Priority;    /*!< Effective, raised by inheritance     */
+  uint8_t                BasePriority;
+  uint8_t                State;       /*!< KERNEL_TaskStateTypeDef              */
+  uint8_t                Timed;       /*!< Blocked with a timeout               */
+  volatile uint8_t       WaitResult;  /*!< KERNEL_StatusTypeDef of the last wait */
+  uint32_t               Wake;        /*!< Tick to wake up or time out at       */
+  KERNEL_WaitQueueTypeDef *WaitQueue; /*!< Queue the task is blocked on         */
+  struct KERNEL_Mutex   *WaitMutex;   /*!< Mutex the task is blocked on         */
+  struct KERNEL_Mutex   *Held;        /*!< Mutexes owned, most recent first     */
+  uint32_t               Runs;        /*!< Times switched in                    */
+  uint32_t               Ticks;       /*!< Kernel ticks that found it running   */
+} KERNEL_TaskTypeDef;
+
+typedef struct
+{
+  KERNEL_WaitQueueTypeDef Waiters;
+  volatile uint32_t       Count;
+  uint32_t                Max;
+} KERNEL_SemTypeDef;
+
+typedef struct KERNEL_Mutex
+{
+  KERNEL_WaitQueueTypeDef Waiters;
+  KERNEL_TaskTypeDef     *Owner;
+  struct KERNEL_Mutex    *NextHeld;   /*!< Owner's list of held mutexes         */
+} KERNEL_MutexTypeDef;
+
+/**
+  * @brief  CPU operations of the kernel
+  */
+typedef struct
+{
+  void     (*Switch)(void);           /*!< Request KERNEL_Switch() once unlocked */
+  void     (*Exit)(void);             /*!< Return address of task entry functions */
+  uint32_t (*Lock)(void);             /*!< Mask every interrupt using the kernel */
+  void     (*Unlock)(uint32_t state);
+} KERNEL_PortTypeDef;
+
+typedef void (*KERNEL_EntryTypeDef)(void *argument);
+
+/* Exported functions prototypes ---------------------------------------------*/
+void                 KERNEL_Init(const KERNEL_PortTypeDef *port);
+KERNEL_StatusTypeDef KERNEL_TaskCreate(KERNEL_TaskTypeDef *task, const char *name, KERNEL_EntryTypeDef entry,
+                                       void *argument, uint32_t priority, uint32_t *stack, uint32_t words);
+KERNEL_TaskTypeDef  *KERNEL_Start(void);
+uint32_t            *KERNEL_Switch(uint32_t *sp);
+void                 KERNEL_Tick(void);
+void                 KERNEL_TaskExit(void);
+
+KERNEL_TaskTypeDef  *KERNEL_Current(void);
+KERNEL_TaskTypeDef  *KERNEL_TaskAt(uint32_t id);
+uint32_t             KERNEL_Ticks(void);
+uint32_t             KERNEL_Switches(void);
+uint32_t             KERNEL_StackUnused(const KERNEL_TaskTypeDef *task);
+
+void                 KERNEL_Yield(void);
+void                 KERNEL_Sleep(uint32_t ticks);
+
+void                 KERNEL_SemInit(KERNEL_SemTypeDef *sem, uint32_t count, uint32_t max);
+KERNEL_StatusTypeDef KERNEL_SemTake(KERNEL_SemTypeDef *sem, uint32_t timeout);
+KERNEL_StatusTypeDef KERNEL_SemGive(KERNEL_SemTypeDef *sem);
+
+void                 KERNEL_MutexInit(KERNEL_MutexTypeDef *mutex);
+KERNEL_StatusTypeDef KERNEL_MutexLock(KERNEL_MutexTypeDef *mutex, uint32_t timeout);
+KERNEL_StatusTypeDef KERNEL_MutexUnlock(KERNEL_MutexTypeDef *mutex);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __KERNEL_H */
@@ -0,0 +1,86 @@
+/**
+  ******************************************************************************
+  * @file    kernel_port.h
+  * @brief   Header for kernel_port.c file.
+  *          Cortex-M4F port of the kernel (kernel.h): PendSV context switch,
+  *          SVC start, idle task and the context switch benchmark.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __KERNEL_PORT_H
+#define __KERNEL_PORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "kernel.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define KERNEL_PORT_IDLE_PRIORITY   (KERNEL_PRIORITIES - 1U)
+#define KERNEL_PORT_IDLE_WORDS      128U
+#define KERNEL_PORT_BENCH_PRIORITY  0U
+#define KERNEL_PORT_BENCH_WORDS     256U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Context switch latency, from KERNEL_SemGive() in a low priority
+  *         task to the woken high priority task running, in core cycles
+  */
+typedef struct
+{
+  uint32_t Runs;
+  uint32_t Min;
+  uint32_t Max;
+  uint32_t Avg;
+} KERNEL_PORT_BenchTypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+/**
+  * @brief  Body of the naked PendSV handler. Saves R4-R11 and EXC_RETURN of
+  *         the outgoing task on its process stack, plus S16-S31 when it has
+  *         an FP frame (bit 4 of EXC_RETURN clear). The core stacks S0-S15
+  *         lazily, so tasks that never touch the FPU pay nothing for it.
+  */
+#define KERNEL_PORT_PENDSV()                                    \
+  __ASM volatile ("mrs      r0, psp                      \n"    \
+                  "tst      lr, #0x10                    \n"    \
+                  "it       eq                           \n"    \
+                  "vstmdbeq r0!, {s16-s31}               \n"    \
+                  "stmdb    r0!, {r4-r11, lr}            \n"    \
+                  "bl       KERNEL_PORT_SwitchContext    \n"    \
+                  "ldmia    r0!, {r4-r11, lr}            \n"    \
+                  "tst      lr, #0x10                    \n"    \
+                  "it       eq                           \n"    \
+                  "vldmiaeq r0!, {s16-s31}               \n"    \
+                  "msr      psp, r0                      \n"    \
+                  "bx       lr                           \n")
+
+/**
+  * @brief  Body of the naked SVC handler, only used by KERNEL_PORT_Start():
+  *         drop the main stack and return into the first task on the PSP.
+  */
+#define KERNEL_PORT_SVC()                                       \
+  __ASM volatile ("bl       KERNEL_PORT_FirstContext     \n"    \
+                  "ldmia    r0!, {r4-r11, lr}            \n"    \
+                  "msr      psp, r0                      \n"    \
+                  "ldr      r1, =_estack                 \n"    \
+                  "msr      msp, r1                      \n"    \
+                  "bx       lr                           \n")
+
+/* Exported functions prototypes ---------------------------------------------*/
+void      KERNEL_PORT_Init(void);
+void      KERNEL_PORT_Start(void) __attribute__((noreturn));
+uint32_t *KERNEL_PORT_SwitchContext(uint32_t *sp);
+uint32_t *KERNEL_PORT_FirstContext(void);
+uint32_t  KERNEL_PORT_IdleTicks(void);
+void      KERNEL_PORT_Bench(uint32_t runs, KERNEL_PORT_BenchTypeDef *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __KERNEL_PORT_H */
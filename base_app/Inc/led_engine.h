@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file    led_engine.h
+  * @brief   Header for led_engine.c file.
+  *          The four Discovery LEDs on TIM4 PWM, their patterns streamed
+  *          into the compare registers by DMA.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LED_ENGINE_H
+#define __LED_ENGINE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "led_pattern.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Channels, TIM4 CH1 to CH4 on PD12 to PD15 */
+#define LED_ENGINE_GREEN      0U
+#define LED_ENGINE_ORANGE     1U
+#define LED_ENGINE_RED        2U
+#define LED_ENGINE_BLUE       3U
+#define LED_ENGINE_CHANNELS   4U
+
+#define LED_ENGINE_TICK_HZ    1000000U      /*!< TIM4 counter, kept across clock switches */
+#define LED_ENGINE_PWM_HZ     200U          /*!< One table frame per period */
+
+/** Longest pattern cycle: 512 frames is 2.56 s, 4 KB of table */
+#ifndef LED_ENGINE_MAX_FRAMES
+#define LED_ENGINE_MAX_FRAMES 512U
+#endif
+
+/* Exported variables --------------------------------------------------------*/
+extern TIM_HandleTypeDef htim4;
+extern DMA_HandleTypeDef hdma_tim4_ch2;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef LED_ENGINE_Init(void);
+HAL_StatusTypeDef LED_ENGINE_Play(const LED_PatternTypeDef patterns[LED_ENGINE_CHANNELS], uint32_t cycle_ms);
+void              LED_ENGINE_Stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LED_ENGINE_H */
@@ -0,0 +1,66 @@
+/**
+  ******************************************************************************
+  * @file    led_pattern.h
+  * @brief   Header for led_pattern.c file.
+  *          PWM timing and precomputed brightness tables for the LED engine.
+  ******************************************************************************
+  * A table holds one compare value per channel per PWM period, interleaved
+  * (CCR1..CCRn of period 0, then of period 1, ...), which is the order a
+  * timer DMA burst writes them in on each update event. The table plays in
+  * a loop, so its length is the cycle of the whole pattern set.
+  *
+  * Brightness is given in permille of perceived brightness and mapped to a
+  * duty cycle with a gamma of 2, so a breathing LED fades evenly.
+  *
+  * Nothing in here touches hardware; led_engine.c drives TIM4 with it.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LED_PATTERN_H
+#define __LED_PATTERN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define LED_PATTERN_FULL      1000U         /*!< Brightness, duty and phase scale */
+#define LED_PATTERN_MAX_TICKS 65535UL       /*!< Full on is CCR = ARR + 1, in 16 bits */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  LED_SHAPE_OFF     = 0x00U,
+  LED_SHAPE_ON      = 0x01U,  /*!< Steady at Level                           */
+  LED_SHAPE_BLINK   = 0x02U,  /*!< Level for Duty of each repeat, then off   */
+  LED_SHAPE_BREATHE = 0x03U   /*!< Smooth rise to Level and back, per repeat */
+} LED_ShapeTypeDef;
+
+/**
+  * @brief  What one channel plays over a table cycle
+  */
+typedef struct
+{
+  LED_ShapeTypeDef Shape;
+  uint16_t Level;             /*!< Peak brightness, permille                */
+  uint16_t Duty;              /*!< BLINK: on time, permille of a repeat     */
+  uint16_t Phase;             /*!< Delay, permille of a repeat              */
+  uint16_t Repeat;            /*!< Repeats per table cycle, 0 counts as 1   */
+} LED_PatternTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint32_t LED_PATTERN_Period(uint32_t tick_hz, uint32_t pwm_hz);
+uint32_t LED_PATTERN_Frames(uint32_t pwm_hz, uint32_t cycle_ms);
+uint16_t LED_PATTERN_Gamma(uint32_t level, uint32_t period);
+void     LED_PATTERN_Render(uint16_t *table, uint32_t frames, uint32_t channels, uint32_t channel,
+                            const LED_PatternTypeDef *pattern, uint32_t period);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LED_PATTERN_H */
@@ -0,0 +1,130 @@
+/**
+  ******************************************************************************
+  * @file    logfs.h
+  * @brief   Header for logfs.c file.
+  *          Append-only log filesystem over a 512-byte block device.
+  ******************************************************************************
+  * Layout, in blocks:
+  *
+  *   0, 1            superblock, two copies written in turn
+  *   LOGFS_ALIGN...  file extents, contiguous, allocated in creation order
+  *
+  * A file is one extent reserved at creation, so appending never allocates
+  * and data is always written sequentially. Extents start on a
+  * LOGFS_ALIGN_BLOCKS boundary (32 KB), the allocation unit of most cards,
+  * and an appending file writes whole batches of its buffer in one
+  * multi-block transfer.
+  *
+  * The superblock holds the file table and the committed length of every
+  * file, with a sequence number and a CRC-32. LOGFS_Sync() writes the
+  * data first, then the superblock into the older of the two copies;
+  * LOGFS_Mount() takes the valid copy with the newer sequence. A power cut
+  * at any point leaves each file at its last synced length with the data
+  * it had then: appended data lands beyond the committed length, and the
+  * one block written again (the partial tail of the last sync) gets the
+  * same committed bytes back, so even a torn write keeps them.
+  *
+  * Nothing in here touches hardware: the device is a pair of callbacks,
+  * an SD card on the target (sd_card.c) and a file on the host
+  * (tests/test_logfs.c). One writer per file.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LOGFS_H
+#define __LOGFS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define LOGFS_BLOCK_SIZE      512U
+#define LOGFS_ALIGN_BLOCKS    64U       /*!< Extent alignment, 32 KB          */
+#define LOGFS_BATCH_SIZE      (LOGFS_ALIGN_BLOCKS * LOGFS_BLOCK_SIZE)
+#define LOGFS_MAX_FILES       16U
+#define LOGFS_NAME_MAX        15U       /*!< Characters, without the NUL      */
+#define LOGFS_MAX_BYTES       0xFFFFFE00UL  /*!< Largest file                 */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  LOGFS_OK        = 0x00U,
+  LOGFS_ERROR     = 0x01U,    /*!< The device failed                       */
+  LOGFS_CORRUPT   = 0x02U,    /*!< No valid superblock                     */
+  LOGFS_FULL      = 0x03U,    /*!< No room on the device or in the extent  */
+  LOGFS_NOT_FOUND = 0x04U,
+  LOGFS_EXISTS    = 0x05U,
+  LOGFS_INVALID   = 0x06U     /*!< Bad name, size, buffer or handle        */
+} LOGFS_StatusTypeDef;
+
+/**
+  * @brief  Block device: count blocks of LOGFS_BLOCK_SIZE from block. Data
+  *         is word aligned (DMA); blocks are the device's own numbering.
+  */
+typedef struct
+{
+  LOGFS_StatusTypeDef (*Read)(void *context, uint32_t block, void *data, uint32_t count);
+  LOGFS_StatusTypeDef (*Write)(void *context, uint32_t block, const void *data, uint32_t count);
+  void     *Context;
+  uint32_t  Blocks;           /*!< Device size                            */
+} LOGFS_DeviceTypeDef;
+
+typedef struct
+{
+  char     Name[LOGFS_NAME_MAX + 1U];
+  uint32_t Start;             /*!< First block of the extent              */
+  uint32_t Blocks;            /*!< Extent size                            */
+  uint32_t Length;            /*!< Committed bytes                        */
+} LOGFS_EntryTypeDef;
+
+typedef struct
+{
+  const LOGFS_DeviceTypeDef *Device;
+  uint32_t           Sequence;      /*!< Of the newest superblock           */
+  uint32_t           Next;          /*!< First free block                   */
+  uint32_t           Count;         /*!< Files                              */
+  LOGFS_EntryTypeDef Files[LOGFS_MAX_FILES];
+  uint32_t           Block[LOGFS_BLOCK_SIZE / 4U];  /*!< Scratch, word aligned */
+  uint32_t           Commits;
+  uint32_t           BlocksWritten;
+  uint32_t           Writes;        /*!< Device write calls                 */
+} LOGFS_TypeDef;
+
+/**
+  * @brief  An open file. The batch buffer holds everything not yet written
+  *         from the block containing Length - Fill onwards.
+  */
+typedef struct
+{
+  LOGFS_TypeDef *Fs;
+  uint32_t       Index;       /*!< In Fs->Files                           */
+  uint32_t       Length;      /*!< Bytes appended, synced or not          */
+  uint32_t       Capacity;    /*!< Extent size in bytes                   */
+  uint8_t       *Batch;       /*!< NULL: read-only                        */
+  uint32_t       BatchSize;
+  uint32_t       BatchBlock;  /*!< Extent block of Batch[0]               */
+  uint32_t       Fill;        /*!< Bytes in Batch                         */
+} LOGFS_FileTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+LOGFS_StatusTypeDef LOGFS_Format(LOGFS_TypeDef *fs, const LOGFS_DeviceTypeDef *device);
+LOGFS_StatusTypeDef LOGFS_Mount(LOGFS_TypeDef *fs, const LOGFS_DeviceTypeDef *device);
+LOGFS_StatusTypeDef LOGFS_Create(LOGFS_TypeDef *fs, const char *name, uint32_t bytes);
+LOGFS_StatusTypeDef LOGFS_Open(LOGFS_TypeDef *fs, LOGFS_FileTypeDef *file, const char *name,
+                               uint8_t *batch, uint32_t batch_size);
+LOGFS_StatusTypeDef LOGFS_Append(LOGFS_FileTypeDef *file, const void *data, uint32_t length);
+LOGFS_StatusTypeDef LOGFS_Sync(LOGFS_FileTypeDef *file);
+LOGFS_StatusTypeDef LOGFS_Truncate(LOGFS_FileTypeDef *file);
+LOGFS_StatusTypeDef LOGFS_Read(LOGFS_FileTypeDef *file, uint32_t offset, void *data,
+                               uint32_t length, uint32_t *read);
+uint32_t            LOGFS_Crc32(const void *data, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LOGFS_H */
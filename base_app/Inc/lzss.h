@@ -0,0 +1,108 @@
+/**
+  ******************************************************************************
+  * @file    lzss.h
+  * @brief   Header for lzss.c file.
+  *          Streaming LZSS compressor and decompressor for console and
+  *          telemetry output over a slow link.
+  ******************************************************************************
+  * The stream is byte-aligned LZSS: a flag byte, then up to eight items,
+  * flag bit 0 (LSB first) for the first item, and so on:
+  *
+  *   bit 0   literal   one byte
+  *   bit 1   match     two bytes, little-endian: the low W bits are the
+  *                     distance back minus 1, the rest the length minus 3
+  *
+  * W is the window size in bits, 8 to 11 (256 bytes to 2 KB), fixed for a
+  * stream; the encoder and the decoder each keep that much history in a
+  * buffer the caller provides, so both sides stay in static memory. The
+  * encoder finds matches through a table of 2^LZSS_HASH_BITS positions
+  * indexed by a hash of the next three bytes, one candidate per position,
+  * which is what keeps it fast at the cost of a few percent of ratio.
+  *
+  * Compression is incremental: LZSS_Compress() takes input as it comes and
+  * holds back the last few bytes for a longer match, LZSS_Flush() encodes
+  * those too, and LZSS_Frame() hands over what has been written so far.
+  * Every frame decodes on its own as far as the format goes, but matches
+  * reach back into earlier frames, so the decoder must see all of them
+  * since the last LZSS_EncoderReset() in order.
+  *
+  * Nothing in here touches hardware; console_lz.c frames the output on
+  * USART3 and tools/lzcat.c decodes it on the host.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LZSS_H
+#define __LZSS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define LZSS_WINDOW_BITS_MIN    8U          /*!< 256 bytes                    */
+#define LZSS_WINDOW_BITS_MAX    11U         /*!< 2 KB                         */
+#define LZSS_MIN_MATCH          3U
+#define LZSS_HASH_BITS          10U         /*!< Match table, 2 bytes each    */
+#define LZSS_ITEM_MAX           3U          /*!< Output bytes of one item     */
+
+/** History buffer size for a window */
+#define LZSS_WINDOW_SIZE(bits)  (1UL << (bits))
+
+/** Worst case output for n input bytes: all literals, a flag byte per 8 */
+#define LZSS_BOUND(n)           ((n) + (((n) + 7U) / 8U))
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  LZSS_OK      = 0x00U,
+  LZSS_INVALID = 0x01U,       /*!< Window size out of range                 */
+  LZSS_CORRUPT = 0x02U,       /*!< Match before the start of the stream     */
+  LZSS_FULL    = 0x03U        /*!< Output buffer too small                  */
+} LZSS_StatusTypeDef;
+
+typedef struct
+{
+  uint8_t  *Window;           /*!< LZSS_WINDOW_SIZE(WindowBits) bytes       */
+  uint8_t  *Out;              /*!< Compressed output                        */
+  uint32_t OutSize;
+  uint32_t OutLength;         /*!< Bytes written to Out                     */
+  uint32_t FlagPos;           /*!< Flag byte of the open group in Out       */
+  uint32_t Pos;               /*!< Next byte to encode, since the reset     */
+  uint32_t End;               /*!< Bytes taken in, since the reset          */
+  uint32_t MaxMatch;
+  uint32_t In;                /*!< Totals, for the ratio                    */
+  uint32_t Produced;
+  uint16_t Hash[1UL << LZSS_HASH_BITS]; /*!< Last position of each hash     */
+  uint8_t  WindowBits;
+  uint8_t  FlagBit;           /*!< Next flag bit, 0 when no group is open   */
+} LZSS_EncoderTypeDef;
+
+typedef struct
+{
+  uint8_t  *Window;
+  uint32_t Pos;               /*!< Bytes decoded since the reset            */
+  uint8_t  WindowBits;
+} LZSS_DecoderTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+LZSS_StatusTypeDef LZSS_EncoderInit(LZSS_EncoderTypeDef *enc, uint8_t *window, uint32_t window_bits,
+                                    uint8_t *out, uint32_t out_size);
+void               LZSS_EncoderReset(LZSS_EncoderTypeDef *enc);
+uint32_t           LZSS_Compress(LZSS_EncoderTypeDef *enc, const uint8_t *data, uint32_t length);
+uint32_t           LZSS_Flush(LZSS_EncoderTypeDef *enc);
+uint32_t           LZSS_Frame(LZSS_EncoderTypeDef *enc);
+
+LZSS_StatusTypeDef LZSS_DecoderInit(LZSS_DecoderTypeDef *dec, uint8_t *window, uint32_t window_bits);
+void               LZSS_DecoderReset(LZSS_DecoderTypeDef *dec);
+LZSS_StatusTypeDef LZSS_Decode(LZSS_DecoderTypeDef *dec, const uint8_t *frame, uint32_t length,
+                               uint8_t *out, uint32_t out_size, uint32_t *produced);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LZSS_H */
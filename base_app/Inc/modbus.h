@@ -0,0 +1,115 @@
+/**
+  ******************************************************************************
+  * @file    modbus.h
+  * @brief   Header for modbus.c file.
+  *          Modbus RTU slave protocol engine: one request frame in, one
+  *          response frame out.
+  ******************************************************************************
+  * A frame is everything between two silences of 3.5 characters; the UART
+  * driver finds them (modbus_rtu.c). MODBUS_Process() checks the CRC and
+  * address, runs the function and builds the response, or returns 0 when
+  * nothing is to be sent: a bad CRC, another slave's frame or a broadcast.
+  *
+  *   0x03, 0x04  Read holding / input registers (one map serves both)
+  *   0x06        Write single register
+  *   0x10        Write multiple registers
+  *   0x08        Diagnostics: echo, clear and read the counters below
+  *
+  * Registers live in a constant table of regions sorted by address, found
+  * by binary search. A region serves Count consecutive registers through
+  * its Read and Write callbacks; with no Write it is read-only. A request
+  * is checked against the whole map before any register is touched, so an
+  * illegal address never leaves a write half done.
+  *
+  * Nothing in here touches hardware, and any byte string is a valid input.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MODBUS_H
+#define __MODBUS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define MODBUS_ADU_MAX          256U    /*!< Longest RTU frame, CRC included  */
+#define MODBUS_BROADCAST        0x00U
+#define MODBUS_ADDRESS_MAX      247U
+
+#define MODBUS_READ_MAX         125U    /*!< Registers per 0x03/0x04          */
+#define MODBUS_WRITE_MAX        123U    /*!< Registers per 0x10               */
+
+/* Exception codes */
+#define MODBUS_EX_FUNCTION      0x01U
+#define MODBUS_EX_ADDRESS       0x02U
+#define MODBUS_EX_VALUE         0x03U
+#define MODBUS_EX_FAILURE       0x04U
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  MODBUS_OK      = 0x00U,
+  MODBUS_INVALID = 0x01U    /*!< Bad address, or regions unsorted or empty  */
+} MODBUS_StatusTypeDef;
+
+/**
+  * @brief  Consecutive registers Address to Address+Count-1. The callbacks
+  *         get the index within the region and run in the caller's context
+  *         (the UART driver calls from its interrupt).
+  */
+typedef struct
+{
+  uint16_t Address;
+  uint16_t Count;
+  uint16_t (*Read)(uint16_t index);
+  uint8_t  (*Write)(uint16_t index, uint16_t value);  /*!< 0 or an exception
+                                                           code; NULL: read-only */
+} MODBUS_RegionTypeDef;
+
+/**
+  * @brief  One slave. The counters are the ones function 0x08 reports and
+  *         wrap at 16 bits like the standard's.
+  */
+typedef struct
+{
+  uint8_t  Address;
+  const MODBUS_RegionTypeDef *Regions;
+  uint32_t RegionCount;
+  uint16_t BusMessages;     /*!< Frames with a good CRC                   */
+  uint16_t CrcErrors;       /*!< Frames too short or with a bad CRC        */
+  uint16_t Exceptions;      /*!< Exception responses                       */
+  uint16_t SlaveMessages;   /*!< Frames for this address or broadcast      */
+  uint16_t NoResponses;     /*!< Broadcasts executed                       */
+  uint16_t Overruns;        /*!< Characters lost, counted by the driver    */
+} MODBUS_SlaveTypeDef;
+
+/**
+  * @brief  Silent intervals at a bit rate. Above 19200 bit/s the standard
+  *         fixes them at 750 and 1750 us.
+  */
+typedef struct
+{
+  uint32_t CharUs;          /*!< One character on the wire                */
+  uint32_t T15Us;           /*!< Longest gap inside a frame               */
+  uint32_t T35Us;           /*!< Shortest gap between frames              */
+} MODBUS_TimingTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+MODBUS_StatusTypeDef        MODBUS_Init(MODBUS_SlaveTypeDef *slave, uint8_t address,
+                                        const MODBUS_RegionTypeDef *regions, uint32_t count);
+uint32_t                    MODBUS_Process(MODBUS_SlaveTypeDef *slave, const uint8_t *request,
+                                           uint32_t length, uint8_t *response);
+const MODBUS_RegionTypeDef *MODBUS_Find(const MODBUS_SlaveTypeDef *slave, uint16_t address);
+uint16_t                    MODBUS_Crc16(const uint8_t *data, uint32_t length);
+void                        MODBUS_Timing(uint32_t baud, uint32_t char_bits, MODBUS_TimingTypeDef *timing);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MODBUS_H */
@@ -0,0 +1,78 @@
+/**
+  ******************************************************************************
+  * @file    modbus_rtu.h
+  * @brief   Header for modbus_rtu.c file.
+  *          Modbus RTU slave on USART3: circular DMA reception, frame
+  *          boundaries from the idle line and TIM3, interrupt-driven reply.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MODBUS_RTU_H
+#define __MODBUS_RTU_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "modbus.h"
+#include "dvfs.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Slave mode: USART3 stops being the console once the application task has
+  * printed its start-up report, and serves the register map in main.c */
+#ifndef MODBUS_SLAVE
+#define MODBUS_SLAVE              0
+#endif
+
+#ifndef MODBUS_RTU_BAUD
+#define MODBUS_RTU_BAUD           19200U
+#endif
+#define MODBUS_RTU_CHAR_BITS      11U       /*!< 8E1: start, 8 data, parity, stop */
+
+/** Bytes in the DMA ring, a power of two, two frames at least */
+#define MODBUS_RTU_RING           512U
+
+/** TIM3 count rate, kept across DVFS: 1 us ticks for the silent intervals */
+#define MODBUS_RTU_TICK_HZ        1000000U
+
+/** USART3 and TIM3 share one level; the reply is built in the interrupt.
+  * Below the DMA refills, above the button */
+#define MODBUS_RTU_IRQ_PRIORITY   9U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Baud;
+  uint32_t Frames;          /*!< Frames delimited by a t3.5 silence        */
+  uint32_t Responses;
+  uint32_t GapErrors;       /*!< Silences of t1.5 to t3.5 inside a frame   */
+  uint32_t CharErrors;      /*!< Parity, framing and noise errors          */
+  uint32_t TooLong;         /*!< Frames over MODBUS_ADU_MAX                */
+  uint32_t LatencyUs;       /*!< Last request byte to first reply byte     */
+  uint32_t LatencyMinUs;
+  uint32_t LatencyMaxUs;
+  MODBUS_SlaveTypeDef Slave;  /*!< Protocol counters                       */
+} MODBUS_RtuStatsTypeDef;
+
+/* Exported variables --------------------------------------------------------*/
+extern DMA_HandleTypeDef hdma_usart3_rx;
+extern TIM_HandleTypeDef htim3;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef  MODBUS_RTU_Init(void);
+HAL_StatusTypeDef  MODBUS_RTU_Start(uint8_t address, const MODBUS_RegionTypeDef *regions,
+                                    uint32_t count);
+void               MODBUS_RTU_GetStats(MODBUS_RtuStatsTypeDef *stats);
+DVFS_StatusTypeDef MODBUS_RTU_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                          const DVFS_PointTypeDef *point);
+void               MODBUS_RTU_UART_IRQHandler(void);
+void               MODBUS_RTU_TIM_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MODBUS_RTU_H */
@@ -0,0 +1,39 @@
+/**
+  ******************************************************************************
+  * @file    mpu_guard.h
+  * @brief   Header for mpu_guard.c file.
+  *          MPU guard regions at address 0 and below the main stack and every
+  *          task stack.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MPU_GUARD_H
+#define __MPU_GUARD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "mpu_region.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define MPU_GUARD_NULL_SIZE     1024U   /*!< NULL plus any member offset below 1 KB */
+
+/** Guard at the bottom of each stack. It takes this much, plus up to 24
+  * bytes of alignment, from the stack it guards, and must be larger than
+  * any single frame so an overflow cannot step over it. */
+#define MPU_GUARD_STACK_SIZE    128U
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef MPU_GUARD_Init(void);
+HAL_StatusTypeDef MPU_GUARD_AddTasks(void);
+const MPU_REGION_EntryTypeDef *MPU_GUARD_Find(uint32_t address);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPU_GUARD_H */
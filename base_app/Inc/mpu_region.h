@@ -0,0 +1,117 @@
+/**
+  ******************************************************************************
+  * @file    mpu_region.h
+  * @brief   Header for mpu_region.c file.
+  *          ARMv7-M MPU guard regions: placement and register values.
+  ******************************************************************************
+  * An ARMv7-M region is a power of two from 32 bytes up, aligned to its
+  * size; regions of 256 bytes and more split into eight subregions that can
+  * be disabled one by one. MPU_REGION_Fit() finds the guard of a given size
+  * that starts lowest in a block of memory, using subregions when they waste
+  * less than a whole aligned region would. MPU_REGION_Add() builds a table
+  * of RBAR/RASR pairs that the firmware (mpu_guard.c) loads as is.
+  *
+  * Two kinds of guard:
+  *   NULL   no access, catches dereferences of NULL plus a small offset
+  *   STACK  read-only at the bottom of a stack: the first push past the end
+  *          faults, while stack usage scans can still read the fill pattern
+  * Both are execute-never.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MPU_REGION_H
+#define __MPU_REGION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define MPU_REGION_COUNT        8U          /*!< Regions of the Cortex-M4 MPU    */
+#define MPU_REGION_MIN_SIZE     32U
+#define MPU_REGION_SUB_MIN_SIZE 256U        /*!< Smallest region with subregions */
+
+/** Largest frame the core pushes (with FP state): a failed stacking leaves
+  * SP up to this far below a stack guard */
+#define MPU_REGION_FRAME_MAX    0x68U
+
+/** RBAR fields */
+#define MPU_REGION_RBAR_VALID   (1UL << 4)
+
+/** RASR fields */
+#define MPU_REGION_RASR_ENABLE  (1UL << 0)
+#define MPU_REGION_RASR_SIZE(log2)  ((uint32_t)((log2) - 1U) << 1)
+#define MPU_REGION_RASR_SRD(mask)   ((uint32_t)(mask) << 8)
+#define MPU_REGION_RASR_B       (1UL << 16)
+#define MPU_REGION_RASR_C       (1UL << 17)
+#define MPU_REGION_RASR_S       (1UL << 18)
+#define MPU_REGION_RASR_TEX(x)  ((uint32_t)(x) << 19)
+#define MPU_REGION_RASR_AP(x)   ((uint32_t)(x) << 24)
+#define MPU_REGION_RASR_XN      (1UL << 28)
+
+#define MPU_REGION_AP_NONE      0U          /*!< No access                      */
+#define MPU_REGION_AP_RO        6U          /*!< Read-only, any privilege       */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  MPU_REGION_OK       = 0x00U,
+  MPU_REGION_FULL     = 0x01U,    /*!< All MPU_REGION_COUNT regions used      */
+  MPU_REGION_INVALID  = 0x02U,    /*!< Guard size 0 or not a multiple of 32   */
+  MPU_REGION_NO_FIT   = 0x03U,    /*!< Guard does not fit in the block        */
+  MPU_REGION_OVERLAP  = 0x04U     /*!< Guard overlaps one already in the table */
+} MPU_REGION_StatusTypeDef;
+
+typedef enum
+{
+  MPU_REGION_NULL  = 0x00U,
+  MPU_REGION_STACK = 0x01U
+} MPU_REGION_KindTypeDef;
+
+/**
+  * @brief  A guard placed in memory
+  */
+typedef struct
+{
+  uint32_t Base;                  /*!< Region base, aligned to its size       */
+  uint8_t  SizeLog2;              /*!< Region size is 1 << SizeLog2           */
+  uint8_t  Disabled;              /*!< Subregions left out, bit n for n       */
+  uint32_t Start;                 /*!< What the guard covers, [Start, End)    */
+  uint32_t End;
+} MPU_REGION_FitTypeDef;
+
+typedef struct
+{
+  const char *Name;
+  uint8_t     Kind;               /*!< MPU_REGION_KindTypeDef                 */
+  uint32_t    Start;              /*!< Covered, [Start, End)                  */
+  uint32_t    End;
+  uint32_t    Rbar;               /*!< Register values, region number in RBAR */
+  uint32_t    Rasr;
+} MPU_REGION_EntryTypeDef;
+
+typedef struct
+{
+  MPU_REGION_EntryTypeDef Entries[MPU_REGION_COUNT];
+  uint32_t                Count;
+} MPU_REGION_TableTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+MPU_REGION_StatusTypeDef MPU_REGION_Fit(uint32_t start, uint32_t end, uint32_t size,
+                                        MPU_REGION_FitTypeDef *fit);
+
+void                     MPU_REGION_Init(MPU_REGION_TableTypeDef *table);
+MPU_REGION_StatusTypeDef MPU_REGION_Add(MPU_REGION_TableTypeDef *table, const char *name,
+                                        MPU_REGION_KindTypeDef kind, uint32_t start, uint32_t end,
+                                        uint32_t size);
+const MPU_REGION_EntryTypeDef *MPU_REGION_Find(const MPU_REGION_TableTypeDef *table, uint32_t address);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPU_REGION_H */
@@ -0,0 +1,181 @@
+/**
+  ******************************************************************************
+  * @file    pin.h
+  * @brief   Header-only GPIO pin layer with compile-time pin descriptors.
+  ******************************************************************************
+  * PIN_DEFINE(LED, GPIOD, 12) generates static inline LED_Set(), LED_Reset(),
+  * LED_Write(), LED_Read(), LED_Toggle() and LED_Init() for one pin. Port and
+  * pin are constants, so each call folds to a single store of a constant
+  * into BSRR (no read-modify-write of ODR, safe against interrupts driving
+  * other pins of the port), or, with PIN_BITBAND, a single load or store on
+  * the bit-band alias of IDR/ODR.
+  *
+  * PIN_GROUP_DEFINE(LEDS, GPIOD, 0xF000) does the same for several pins of a
+  * port: LEDS_Write(bits) sets and clears all of them in one BSRR store.
+  *
+  * The header needs only GPIO_TypeDef and the port pointer where the pins
+  * are defined: the CMSIS device header on the target, a mock in the host
+  * tests (tests/test_pin.c), which run without bit-banding.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PIN_H
+#define __PIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/** Read and toggle single pins through the bit-band alias (Cortex-M3/M4) */
+#ifndef PIN_BITBAND
+#if defined(__arm__)
+#define PIN_BITBAND           1
+#else
+#define PIN_BITBAND           0
+#endif
+#endif
+
+#define PIN_PERIPH_BASE       0x40000000UL  /*!< Bit-banded peripheral region */
+#define PIN_PERIPH_BB_BASE    0x42000000UL  /*!< Its alias, a word per bit    */
+
+/** MODER field */
+#define PIN_MODE_INPUT        0U
+#define PIN_MODE_OUTPUT       1U
+#define PIN_MODE_AF           2U
+#define PIN_MODE_ANALOG       3U
+
+/** PUPDR field */
+#define PIN_PULL_NONE         0U
+#define PIN_PULL_UP           1U
+#define PIN_PULL_DOWN         2U
+
+/** OSPEEDR field */
+#define PIN_SPEED_LOW         0U
+#define PIN_SPEED_MEDIUM      1U
+#define PIN_SPEED_HIGH        2U
+#define PIN_SPEED_VERY_HIGH   3U
+
+/** OTYPER bit */
+#define PIN_OTYPE_PP          0U
+#define PIN_OTYPE_OD          1U
+
+/* Exported macro ------------------------------------------------------------*/
+#define PIN_MASK(pin)         (1UL << (pin))
+
+/** BSRR value that sets the pins of set and clears those of reset */
+#define PIN_BSRR(set, reset)  ((uint32_t)(set) | ((uint32_t)(reset) << 16))
+
+/** Bit-band alias word of bit bit of the peripheral register at addr */
+#define PIN_BB_ADDR(addr, bit) \
+  (PIN_PERIPH_BB_BASE + (((uint32_t)(addr) - PIN_PERIPH_BASE) * 32UL) + ((uint32_t)(bit) * 4UL))
+#define PIN_BB(reg, bit)      (*(volatile uint32_t *)PIN_BB_ADDR(&(reg), bit))
+
+/** 16-bit pin mask to a 2-bit field mask: pin n sets bit 2n */
+#define PIN_SPREAD_8(x)       (((x) | ((x) << 8)) & 0x00FF00FFUL)
+#define PIN_SPREAD_4(x)       (((x) | ((x) << 4)) & 0x0F0F0F0FUL)
+#define PIN_SPREAD_2(x)       (((x) | ((x) << 2)) & 0x33333333UL)
+#define PIN_SPREAD_1(x)       (((x) | ((x) << 1)) & 0x55555555UL)
+#define PIN_SPREAD(mask)      PIN_SPREAD_1(PIN_SPREAD_2(PIN_SPREAD_4(PIN_SPREAD_8((uint32_t)(mask) & 0xFFFFUL))))
+
+/** Write value into the 2-bit fields of the pins in mask */
+#define PIN_FIELD2(reg, mask, value)                                          \
+  ((reg) = ((reg) & ~(PIN_SPREAD(mask) * 3UL)) | (PIN_SPREAD(mask) * (uint32_t)(value)))
+
+#if PIN_BITBAND
+#define PIN_READ_(port, pin)     PIN_BB((port)->IDR, pin)
+#define PIN_TOGGLE_(port, pin)   (PIN_BB((port)->ODR, pin) ^= 1UL)
+#else
+#define PIN_READ_(port, pin)     (((port)->IDR >> (pin)) & 1UL)
+#define PIN_TOGGLE_(port, pin)   ((port)->BSRR = (((port)->ODR & PIN_MASK(pin)) != 0UL) ? \
+                                  PIN_BSRR(0UL, PIN_MASK(pin)) : PIN_BSRR(PIN_MASK(pin), 0UL))
+#endif
+
+/**
+  * @brief  Define name_Set/Reset/Write/Read/Toggle/Init for one pin.
+  * @param  name: Prefix of the generated functions
+  * @param  port: GPIOx
+  * @param  pin: 0 to 15
+  */
+#define PIN_DEFINE(name, port, pin)                                           \
+  static inline void name##_Set(void)                                         \
+  {                                                                           \
+    (port)->BSRR = PIN_BSRR(PIN_MASK(pin), 0UL);                              \
+  }                                                                           \
+  static inline void name##_Reset(void)                                       \
+  {                                                                           \
+    (port)->BSRR = PIN_BSRR(0UL, PIN_MASK(pin));                              \
+  }                                                                           \
+  static inline void name##_Write(uint32_t on)                                \
+  {                                                                           \
+    (port)->BSRR = PIN_MASK(pin) << ((on != 0U) ? 0U : 16U);                  \
+  }                                                                           \
+  static inline uint32_t name##_Read(void)                                    \
+  {                                                                           \
+    return PIN_READ_(port, pin);                                              \
+  }                                                                           \
+  static inline void name##_Toggle(void)                                      \
+  {                                                                           \
+    PIN_TOGGLE_(port, pin);                                                   \
+  }                                                                           \
+  static inline void name##_Init(uint32_t mode, uint32_t pull, uint32_t speed, uint32_t otype) \
+  {                                                                           \
+    PIN_FIELD2((port)->OSPEEDR, PIN_MASK(pin), speed);                        \
+    (port)->OTYPER = ((port)->OTYPER & ~PIN_MASK(pin)) | ((otype) << (pin));  \
+    PIN_FIELD2((port)->PUPDR, PIN_MASK(pin), pull);                           \
+    PIN_FIELD2((port)->MODER, PIN_MASK(pin), mode);                           \
+  }                                                                           \
+  static inline void name##_Alternate(uint32_t af)                            \
+  {                                                                           \
+    (port)->AFR[(pin) >> 3] = ((port)->AFR[(pin) >> 3] & ~(0xFUL << (((pin) & 7U) * 4U))) | \
+                              ((af) << (((pin) & 7U) * 4U));                  \
+  }
+
+/**
+  * @brief  Define name_Set/Reset/Write/Read/Toggle/Init for pins of a port.
+  *         Bits are port bits; those outside mask are ignored.
+  * @param  name: Prefix of the generated functions
+  * @param  port: GPIOx
+  * @param  mask: Pins of the group, bit n for pin n
+  */
+#define PIN_GROUP_DEFINE(name, port, mask)                                    \
+  static inline void name##_Set(uint32_t bits)                                \
+  {                                                                           \
+    (port)->BSRR = PIN_BSRR((bits) & (mask), 0UL);                            \
+  }                                                                           \
+  static inline void name##_Reset(uint32_t bits)                              \
+  {                                                                           \
+    (port)->BSRR = PIN_BSRR(0UL, (bits) & (mask));                            \
+  }                                                                           \
+  static inline void name##_Write(uint32_t bits)                              \
+  {                                                                           \
+    (port)->BSRR = PIN_BSRR((bits) & (mask), ~(bits) & (mask));               \
+  }                                                                           \
+  static inline uint32_t name##_Read(void)                                    \
+  {                                                                           \
+    return (port)->IDR & (mask);                                              \
+  }                                                                           \
+  static inline void name##_Toggle(uint32_t bits)                             \
+  {                                                                           \
+    uint32_t odr = (port)->ODR & (bits) & (mask);                             \
+                                                                              \
+    (port)->BSRR = PIN_BSRR(~odr & (bits) & (mask), odr);                     \
+  }                                                                           \
+  static inline void name##_Init(uint32_t mode, uint32_t pull, uint32_t speed, uint32_t otype) \
+  {                                                                           \
+    PIN_FIELD2((port)->OSPEEDR, mask, speed);                                 \
+    (port)->OTYPER = ((port)->OTYPER & ~(uint32_t)(mask)) |                   \
+                     (((otype) != 0U) ? (uint32_t)(mask) : 0UL);              \
+    PIN_FIELD2((port)->PUPDR, mask, pull);                                    \
+    PIN_FIELD2((port)->MODER, mask, mode);                                    \
+  }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PIN_H */
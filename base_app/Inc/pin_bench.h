@@ -0,0 +1,35 @@
+/**
+  ******************************************************************************
+  * @file    pin_bench.h
+  * @brief   Header for pin_bench.c file.
+  *          Toggle rate of an LED pin through the HAL and through pin.h.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PIN_BENCH_H
+#define __PIN_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Run the toggle benchmark once at start-up; off in production builds */
+#ifndef PIN_BENCH
+#define PIN_BENCH             0
+#endif
+
+#define PIN_BENCH_TOGGLES     1024U         /*!< Per method, a multiple of 8 */
+
+/* Exported functions prototypes ---------------------------------------------*/
+void PIN_BENCH_Run(UART_HandleTypeDef *huart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PIN_BENCH_H */
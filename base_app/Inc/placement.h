@@ -0,0 +1,73 @@
+/**
+  ******************************************************************************
+  * @file    placement.h
+  * @brief   Code placement attributes for the flash accelerator (ART).
+  ******************************************************************************
+  * The ART caches 64 lines of 128 bits of flash. At 168 MHz a miss costs the
+  * 5 wait states, so code run on every audio block or tick should share as
+  * few lines as possible with code that runs once:
+  *
+  *   CODE_HOT   ISR and scheduler paths; GCC's hot attribute, which puts
+  *              each in .text.hot.<function>, gathered by the linker script
+  *              in one contiguous, line-aligned block at the start of .text.
+  *   CODE_FAST  The few innermost loops (DSP); as CODE_HOT, or copied to
+  *              SRAM with CODE_PLACEMENT 2. Also needed on the prototype, as
+  *              callers in flash reach SRAM with a long call.
+  *   CODE_COLD  Init, report and error paths; built for size and grouped in
+  *              .text.unlikely.<function>, ahead of the hot block.
+  *
+  * A section per function, not one per file, so --gc-sections still drops
+  * each unused one on its own.
+  *
+  * CODE_PLACEMENT selects the layout (make CODE_PLACEMENT=n):
+  *   0  none, hot code stays wherever the linker puts it
+  *   1  hot and fast code contiguous in flash (default)
+  *   2  as 1, with fast code in SRAM
+  * SRAM code is fetched over the S-bus, shared with the DMA streams; CCM RAM
+  * is not on the instruction bus and stays data-only. Host builds ignore all
+  * of this.
+  *
+  *   DATA_CCM   Data the CPU alone works on, in CCM RAM: zero wait states
+  *              and off the bus matrix, but out of reach of the DMA. The
+  *              start-up code neither copies nor clears it, so the owner
+  *              initialises it before use.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PLACEMENT_H
+#define __PLACEMENT_H
+
+/* Exported constants --------------------------------------------------------*/
+#ifndef CODE_PLACEMENT
+#define CODE_PLACEMENT      1
+#endif
+
+/* Exported macro ------------------------------------------------------------*/
+#if defined(__arm__) && defined(__GNUC__)
+
+#define CODE_COLD           __attribute__((cold, noinline))
+#define DATA_CCM            __attribute__((section(".ccmram")))
+
+#if (CODE_PLACEMENT >= 1)
+#define CODE_HOT            __attribute__((hot))
+#else
+#define CODE_HOT
+#endif
+
+#if (CODE_PLACEMENT >= 2)
+#define CODE_FAST           __attribute__((section(".RamFunc"), long_call, noinline))
+#else
+#define CODE_FAST           CODE_HOT
+#endif
+
+#else
+
+#define CODE_COLD
+#define CODE_HOT
+#define CODE_FAST
+#define DATA_CCM
+
+#endif
+
+#endif /* __PLACEMENT_H */
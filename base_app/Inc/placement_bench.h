@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @file    placement_bench.h
+  * @brief   Header for placement_bench.c file.
+  *          Cycle cost of the DSP and audio ISR paths under each code
+  *          placement (placement.h).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PLACEMENT_BENCH_H
+#define __PLACEMENT_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Run the placement benchmark once at start-up; off in production builds */
+#ifndef PLACEMENT_BENCH
+#define PLACEMENT_BENCH           0
+#endif
+
+#define PLACEMENT_BENCH_RUNS      16U       /*!< Warm runs, the best is kept */
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Cycles of one routine
+  */
+typedef struct
+{
+  uint32_t Cold;      /*!< First run after the ART caches were flushed */
+  uint32_t Warm;      /*!< Best of PLACEMENT_BENCH_RUNS repeated runs  */
+} PLACEMENT_BENCH_ResultTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void PLACEMENT_BENCH_Run(UART_HandleTypeDef *huart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PLACEMENT_BENCH_H */
@@ -0,0 +1,67 @@
+/**
+  ******************************************************************************
+  * @file    power.h
+  * @brief   Header for power.c file.
+  *          Dynamic frequency and voltage scaling between operating points
+  *          (dvfs.h), with peripheral re-timing and a load governor task.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __POWER_H
+#define __POWER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "dvfs.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Operating points, fastest first */
+#define POWER_POINT_FULL      0U            /*!< PLL, SYSCLK of clock_config.h */
+#define POWER_POINT_HALF      1U            /*!< PLL, AHB / 2                  */
+#define POWER_POINT_QUARTER   2U            /*!< PLL, AHB / 4                  */
+#define POWER_POINT_HSI       3U            /*!< HSI, PLL off, scale 2, 0 WS   */
+#define POWER_POINTS          4U
+
+/** Slowest point the governor picks. The HSI point turns the PLL off,
+  * which also stops the 48 MHz clock. */
+#ifndef POWER_FLOOR
+#define POWER_FLOOR           POWER_POINT_QUARTER
+#endif
+
+#define POWER_UP_PERMILLE     700U          /*!< Load to jump to full speed */
+#define POWER_DOWN_PERMILLE   250U          /*!< Load to step down          */
+#define POWER_WINDOW_MS       100U
+#define POWER_TASK_PRIORITY   4U
+#define POWER_TASK_WORDS      256U
+#define POWER_MAX_UARTS       2U
+#define POWER_MAX_TIMERS      5U
+#define POWER_UART_ERROR_PPM  20000U        /*!< Worst baud error accepted  */
+
+/** Benchmark mode: at start-up, run a fixed workload at every point and hold
+  * each one busy, then idle, so board current can be read on the IDD jumper */
+#ifndef POWER_BENCH
+#define POWER_BENCH           0
+#endif
+#define POWER_BENCH_HOLD_MS   2000U
+
+/* Exported variables --------------------------------------------------------*/
+extern DVFS_HandleTypeDef hdvfs;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void               POWER_Init(void);
+HAL_StatusTypeDef  POWER_AddUart(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef  POWER_AddTimer(TIM_HandleTypeDef *htim, uint32_t tick_hz);
+DVFS_StatusTypeDef POWER_Register(DVFS_CallbackTypeDef callback, void *context);
+DVFS_StatusTypeDef POWER_SetPoint(uint32_t index);
+void               POWER_Bench(UART_HandleTypeDef *huart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __POWER_H */
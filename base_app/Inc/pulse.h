@@ -0,0 +1,101 @@
+/**
+  ******************************************************************************
+  * @file    pulse.h
+  * @brief   Header for pulse.c file.
+  *          Frequency, period jitter and duty cycle from DMA-captured edge
+  *          timestamps, in batches.
+  ******************************************************************************
+  * The capture timer free-runs and, on every rising edge, the DMA stores a
+  * record of two timestamps: the last falling edge, then the rising edge.
+  * From two consecutive records:
+  *
+  *   period = rise[k] - rise[k-1]
+  *   high   = fall[k] - rise[k-1]    (valid when 0 < high < period)
+  *
+  * Unsigned differences are right across one wrap of the 32-bit counter.
+  * A gap longer than MaxPeriod ticks (a stalled input, the counter reset by
+  * a clock switch, or more than a wrap) breaks the chain instead of giving
+  * a period, as do records the DMA overwrote before they were read.
+  *
+  * Nothing in here touches hardware; pulse_input.c runs the timer.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PULSE_H
+#define __PULSE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define PULSE_RECORD_WORDS    2U        /*!< {fall, rise} per rising edge     */
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief  Circular record buffer the DMA writes. Counts are totals since
+  *         init and wrap with uint32_t, so Records must be a power of two.
+  */
+typedef struct
+{
+  const uint32_t *Buffer;     /*!< Records * PULSE_RECORD_WORDS words       */
+  uint32_t        Records;
+  uint32_t        Guard;      /*!< Records left to the DMA as a margin      */
+  uint32_t        MaxPeriod;  /*!< Longest period accepted, ticks           */
+  uint32_t        Read;       /*!< Records taken                            */
+  uint32_t        LastRise;
+  uint8_t         HaveRise;   /*!< LastRise starts a period                 */
+  uint32_t        Lost;       /*!< Records overwritten before they were read */
+  uint32_t        Breaks;     /*!< Gaps longer than MaxPeriod               */
+} PULSE_RingTypeDef;
+
+/**
+  * @brief  Running sums of one batch. Deviations are taken from the first
+  *         period so the squares stay small.
+  */
+typedef struct
+{
+  uint32_t Periods;
+  uint32_t Min;
+  uint32_t Max;
+  uint64_t Sum;
+  uint32_t Ref;               /*!< First period of the batch              */
+  int64_t  DevSum;
+  uint64_t DevSq;
+  uint32_t Highs;             /*!< Periods with a falling edge inside     */
+  uint64_t HighSum;
+  uint64_t HighPeriodSum;     /*!< Sum of those periods                   */
+} PULSE_BatchTypeDef;
+
+typedef struct
+{
+  uint32_t Periods;           /*!< Periods in the batch, 0: no result     */
+  uint32_t MilliHz;           /*!< Mean frequency, mHz                    */
+  uint32_t Mean;              /*!< Mean period, ticks                     */
+  uint32_t Min;
+  uint32_t Max;
+  uint32_t Jitter;            /*!< RMS deviation of the period, ticks     */
+  uint16_t DutyPermille;      /*!< High time over period, 0 without falls */
+} PULSE_ResultTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void     PULSE_RingInit(PULSE_RingTypeDef *ring, const uint32_t *buffer, uint32_t records,
+                        uint32_t guard, uint32_t max_period);
+uint32_t PULSE_Take(PULSE_RingTypeDef *ring, PULSE_BatchTypeDef *batch, uint32_t written);
+void     PULSE_Resync(PULSE_RingTypeDef *ring, uint32_t written);
+uint32_t PULSE_Idle(const PULSE_RingTypeDef *ring, uint32_t now);
+
+void     PULSE_BatchInit(PULSE_BatchTypeDef *batch);
+void     PULSE_BatchAdd(PULSE_BatchTypeDef *batch, uint32_t period, uint32_t high);
+void     PULSE_Result(const PULSE_BatchTypeDef *batch, uint32_t tick_hz, PULSE_ResultTypeDef *result);
+uint32_t PULSE_Sqrt(uint64_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PULSE_H */
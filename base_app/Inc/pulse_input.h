@@ -0,0 +1,67 @@
+/**
+  ******************************************************************************
+  * @file    pulse_input.h
+  * @brief   Header for pulse_input.c file.
+  *          Tachometer / flow-sensor input: TIM5 input capture on PA1 with
+  *          DMA-captured timestamps, measured in batches.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PULSE_INPUT_H
+#define __PULSE_INPUT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "pulse.h"
+#include "dvfs.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Records (rising edges) in the DMA ring, a power of two; a half is 1.28 ms
+  * of edges at 100 kHz */
+#ifndef PULSE_INPUT_RECORDS
+#define PULSE_INPUT_RECORDS       256U
+#endif
+#define PULSE_INPUT_GUARD         8U        /*!< Records left to the DMA       */
+
+/** TIM5 count rate, kept across DVFS: the largest that divides the timer
+  * clock at every operating point, 16 MHz on the HSI included */
+#define PULSE_INPUT_TICK_HZ       2000000U
+#define PULSE_INPUT_MAX_PERIOD_MS 2000U     /*!< Slower than 0.5 Hz is no signal */
+#define PULSE_INPUT_FILTER        3U        /*!< ICxF: 8 samples at the timer clock */
+
+/** Half-ring processing; below the DAC and ADC, above the button */
+#define PULSE_INPUT_IRQ_PRIORITY  8U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  PULSE_ResultTypeDef Result;       /*!< Batch since the previous measure   */
+  uint8_t  Stalled;                 /*!< No edge for PULSE_INPUT_MAX_PERIOD_MS */
+  uint32_t Edges;                   /*!< Rising edges taken                 */
+  uint32_t Lost;                    /*!< Edges overwritten before they were read */
+  uint32_t Breaks;                  /*!< Gaps too long to be a period       */
+  uint32_t Overcaptures;            /*!< Edges the DMA was too late for     */
+  uint32_t DmaErrors;               /*!< DMA transfer error interrupts      */
+} PULSE_InputStatsTypeDef;
+
+/* Exported variables --------------------------------------------------------*/
+extern DMA_HandleTypeDef hdma_tim5_ch2;
+extern TIM_HandleTypeDef htim5;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef  PULSE_INPUT_Init(void);
+void               PULSE_INPUT_Measure(PULSE_InputStatsTypeDef *stats);
+DVFS_StatusTypeDef PULSE_INPUT_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                           const DVFS_PointTypeDef *point);
+void               PULSE_INPUT_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PULSE_INPUT_H */
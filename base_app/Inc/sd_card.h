@@ -0,0 +1,70 @@
+/**
+  ******************************************************************************
+  * @file    sd_card.h
+  * @brief   Header for sd_card.c file.
+  *          SD card on SDIO: 4-bit bus, multi-block DMA transfers, and the
+  *          block device of the log filesystem (logfs.h).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SD_CARD_H
+#define __SD_CARD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "logfs.h"
+#include "dvfs.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Log mode: the application task logs to an SD card. SDIO has one pin
+  * mapping, and its PC10/PC12 are the codec's I2S3 clock and data on the
+  * Discovery board, so audio stays off in this build */
+#ifndef SD_LOG
+#define SD_LOG                  0
+#endif
+
+#define SD_CARD_INIT_HZ         400000U     /*!< Identification clock        */
+#define SD_CARD_HZ              24000000U   /*!< PLL48CLK / 2, bypass off    */
+
+/** SDIO raises one interrupt per transfer, at its end */
+#define SD_CARD_IRQ_PRIORITY    8U
+
+#define SD_CARD_POWERUP_MS      1000U       /*!< ACMD41 busy, at most        */
+#define SD_CARD_READ_MS         100U        /*!< Per transfer, SD spec Nac   */
+#define SD_CARD_WRITE_MS        500U        /*!< Per transfer and busy wait  */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t Blocks;            /*!< Capacity in 512-byte blocks            */
+  uint32_t Rca;               /*!< Relative card address                  */
+  uint8_t  HighCapacity;      /*!< SDHC/SDXC: block, not byte, addressing */
+  uint8_t  Version2;          /*!< Answered CMD8                          */
+  uint32_t ClockHz;
+  uint32_t ReadBlocks;
+  uint32_t WriteBlocks;
+  uint32_t Transfers;
+  uint32_t Errors;
+  uint32_t BusyMaxMs;         /*!< Longest programming wait after a write */
+} SD_CardStatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef          SD_CARD_Init(void);
+HAL_StatusTypeDef          SD_CARD_Read(uint32_t block, void *data, uint32_t count);
+HAL_StatusTypeDef          SD_CARD_Write(uint32_t block, const void *data, uint32_t count);
+const LOGFS_DeviceTypeDef *SD_CARD_Device(void);
+void                       SD_CARD_GetStats(SD_CardStatsTypeDef *stats);
+DVFS_StatusTypeDef         SD_CARD_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                               const DVFS_PointTypeDef *point);
+void                       SD_CARD_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SD_CARD_H */
@@ -0,0 +1,45 @@
+/**
+  ******************************************************************************
+  * @file    supervisor.h
+  * @brief   Header for supervisor.c file.
+  *          IWDG driven by the watchdog supervisor (watchdog.h).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SUPERVISOR_H
+#define __SUPERVISOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "watchdog.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Supervisor check and IWDG refresh period */
+#define SUPERVISOR_CHECK_MS     100U
+
+/** IWDG timeout: LSI (~32 kHz) / 32 counts 1 ms, reload 1000 ~ 1 s.
+  * The LSI spread (17 to 47 kHz) keeps this well above the check period. */
+#define SUPERVISOR_IWDG_PR      3U            /*!< Prescaler /32               */
+#define SUPERVISOR_IWDG_RELOAD  1000U
+
+/* Exported variables --------------------------------------------------------*/
+extern WDOG_HandleTypeDef hwdog;
+extern WDOG_RecordTypeDef WdogRecord;
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint32_t SUPERVISOR_Register(const char *name, uint32_t deadline_ms);
+void     SUPERVISOR_Heartbeat(uint32_t id);
+void     SUPERVISOR_Start(void);
+void     SUPERVISOR_Tick(void);
+uint8_t  SUPERVISOR_Report(UART_HandleTypeDef *huart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SUPERVISOR_H */
@@ -0,0 +1,189 @@
+/**
+  ******************************************************************************
+  * @file    trace.h
+  * @brief   Header for trace.c file.
+  *          Binary event trace: record encoder, dump decoder and Chrome trace
+  *          JSON writer.
+  ******************************************************************************
+  * A record is two little-endian words:
+  *
+  *   Header   [31:24] event ID   [23:0] cycles since the previous record
+  *   Payload  event specific (IRQ number, task ID, value ...)
+  *
+  * A gap longer than 2^24 cycles (100 ms at 168 MHz) is written as a
+  * TRACE_EV_SYNC record carrying the full 32-bit delta, followed by the event
+  * itself with a zero delta.
+  *
+  * The cycle counter runs at HCLK, which frequency scaling changes. A
+  * TRACE_EV_CLOCK record carries the new rate, and the records after it
+  * count at that rate. The ring keeps the rate in force at its oldest record
+  * for the dump header, also once the change that set it is overwritten.
+  *
+  * The encoder is used by the firmware recorder (trace_recorder.h), the
+  * decoder and JSON writer by the host converter (tools/trace2json.c); all of
+  * it builds for both and is tested in tests/test_trace.c.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TRACE_H
+#define __TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define TRACE_MAGIC           0x31435254U   /*!< "TRC1" in a little-endian dump */
+#define TRACE_DELTA_MAX       0x00FFFFFFU
+#define TRACE_RECORD_SIZE     8U
+#define TRACE_HEADER_SIZE     16U
+#define TRACE_JSON_MAX        512U          /*!< Longest output of one writer call */
+
+/** Event IDs. 0x80 and up are free for the application. */
+#define TRACE_EV_SYNC         0x00U         /*!< Payload: cycles since previous record */
+#define TRACE_EV_ISR_ENTER    0x01U         /*!< Payload: IRQn (signed)        */
+#define TRACE_EV_ISR_EXIT     0x02U         /*!< Payload: IRQn (signed)        */
+#define TRACE_EV_TASK_SWITCH  0x03U         /*!< Payload: ID of the task now running */
+#define TRACE_EV_UART_TX      0x04U         /*!< Payload: USART base address   */
+#define TRACE_EV_UART_RX      0x05U         /*!< Payload: USART base address   */
+#define TRACE_EV_UART_ERROR   0x06U         /*!< Payload: HAL error code       */
+#define TRACE_EV_MARK         0x07U         /*!< Payload: free value           */
+#define TRACE_EV_CLOCK        0x08U         /*!< Payload: new timestamp clock in Hz */
+#define TRACE_EV_USER         0x80U
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  TRACE_OK    = 0x00U,
+  TRACE_ERROR = 0x01U
+} TRACE_StatusTypeDef;
+
+typedef struct
+{
+  uint32_t Header;
+  uint32_t Payload;
+} TRACE_RecordTypeDef;
+
+/**
+  * @brief  Ring of the most recent records. Head counts every record ever
+  *         written; once it passes the capacity the oldest are overwritten.
+  */
+typedef struct
+{
+  TRACE_RecordTypeDef *Records;
+  uint32_t Mask;              /*!< Capacity - 1, capacity is a power of two */
+  uint32_t Head;
+  uint32_t Last;              /*!< Timestamp of the newest record           */
+  uint32_t CpuHz;             /*!< Timestamp clock at the oldest record     */
+  uint32_t ClockHz;           /*!< Timestamp clock now                      */
+} TRACE_RingTypeDef;
+
+/**
+  * @brief  Dump header, followed by Count records oldest first
+  */
+typedef struct
+{
+  uint32_t Magic;
+  uint32_t CpuHz;             /*!< Timestamp clock at the first record      */
+  uint32_t Count;             /*!< Records in the dump                      */
+  uint32_t Lost;              /*!< Records overwritten before the dump      */
+} TRACE_DumpHeaderTypeDef;
+
+/**
+  * @brief  One decoded event
+  */
+typedef struct
+{
+  uint8_t  Id;
+  uint32_t Payload;
+  uint64_t Cycles;            /*!< Since the first record of the dump, or since
+                                   TRACE_Init() if nothing was lost          */
+} TRACE_EventTypeDef;
+
+typedef void (*TRACE_SinkTypeDef)(void *context, const TRACE_EventTypeDef *event);
+
+/**
+  * @brief  Chrome trace writer state
+  */
+typedef struct
+{
+  uint32_t CpuHz;             /*!< Clock since the last TRACE_EV_CLOCK      */
+  uint32_t Written;           /*!< JSON objects emitted so far              */
+  int32_t  Task;              /*!< Task with an open slice, -1 for none     */
+  uint64_t Cycles;            /*!< Time of the last event                   */
+  uint64_t ClockCycles;       /*!< Time of the last TRACE_EV_CLOCK ...      */
+  uint64_t ClockNs;           /*!< ... in nanoseconds                       */
+} TRACE_JsonTypeDef;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Next slot of a ring. Once the ring is full this overwrites the
+  *         oldest record; when that was a clock change, the oldest record
+  *         left runs at its rate.
+  * @param  ring: Trace ring
+  * @retval Record to fill in
+  */
+static inline TRACE_RecordTypeDef *TRACE_Slot(TRACE_RingTypeDef *ring)
+{
+  TRACE_RecordTypeDef *record = &ring->Records[ring->Head & ring->Mask];
+
+  if ((ring->Head++ > ring->Mask) && ((record->Header >> 24) == TRACE_EV_CLOCK))
+  {
+    ring->CpuHz = record->Payload;
+  }
+  return record;
+}
+
+/**
+  * @brief  Append one record. This is the hot path: no locking, the caller
+  *         keeps other writers out.
+  * @param  ring: Trace ring
+  * @param  now: Current timestamp
+  * @param  id: Event ID
+  * @param  payload: Event payload
+  * @retval None
+  */
+static inline void TRACE_Encode(TRACE_RingTypeDef *ring, uint32_t now, uint32_t id, uint32_t payload)
+{
+  uint32_t delta = now - ring->Last;
+  TRACE_RecordTypeDef *record;
+
+  ring->Last = now;
+  if (delta > TRACE_DELTA_MAX)
+  {
+    record = TRACE_Slot(ring);
+    record->Header = TRACE_EV_SYNC << 24;
+    record->Payload = delta;
+    delta = 0U;
+  }
+  record = TRACE_Slot(ring);
+  record->Header = (id << 24) | delta;
+  record->Payload = payload;
+}
+
+/* Exported functions prototypes ---------------------------------------------*/
+TRACE_StatusTypeDef TRACE_Init(TRACE_RingTypeDef *ring, TRACE_RecordTypeDef *records,
+                               uint32_t capacity, uint32_t cpu_hz, uint32_t now);
+void     TRACE_Reset(TRACE_RingTypeDef *ring, uint32_t now);
+void     TRACE_Clock(TRACE_RingTypeDef *ring, uint32_t now, uint32_t cpu_hz);
+void     TRACE_DumpHeader(const TRACE_RingTypeDef *ring, TRACE_DumpHeaderTypeDef *header);
+const TRACE_RecordTypeDef *TRACE_Span(const TRACE_RingTypeDef *ring, uint32_t part, uint32_t *count);
+
+TRACE_StatusTypeDef TRACE_Decode(const uint8_t *dump, uint32_t size, TRACE_DumpHeaderTypeDef *header,
+                                 TRACE_SinkTypeDef sink, void *context);
+const char *TRACE_IrqName(int32_t irqn);
+
+uint32_t TRACE_JsonBegin(TRACE_JsonTypeDef *json, uint32_t cpu_hz, char *out, uint32_t size);
+uint32_t TRACE_JsonEvent(TRACE_JsonTypeDef *json, const TRACE_EventTypeDef *event, char *out, uint32_t size);
+uint32_t TRACE_JsonEnd(TRACE_JsonTypeDef *json, char *out, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TRACE_H */
@@ -0,0 +1,96 @@
+/**
+  ******************************************************************************
+  * @file    trace_recorder.h
+  * @brief   Header for trace_recorder.c file.
+  *          Firmware side of the event trace: one global ring stamped with the
+  *          DWT cycle counter, and the hooks placed in interrupt handlers.
+  ******************************************************************************
+  * Recording an event masks interrupts for the few instructions of
+  * TRACE_Encode(); TRACE_RECORDER_Cost() reports the measured cycles per
+  * event. Build with -DTRACE_ENABLE=0 to compile every hook away.
+  *
+  * Pull the buffer out with TRACE_RECORDER_Dump() (UART) or by dumping
+  * TraceRing.Records from the debugger, then convert it on the host:
+  *
+  *   make -f test.mk trace2json
+  *   build/test/trace2json capture.bin capture.json
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TRACE_RECORDER_H
+#define __TRACE_RECORDER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "trace.h"
+
+/* Exported constants --------------------------------------------------------*/
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE          1
+#endif
+
+/** Ring capacity in records, a power of two (8 bytes each) */
+#ifndef TRACE_RECORDS
+#define TRACE_RECORDS         512U
+#endif
+
+/* Exported variables --------------------------------------------------------*/
+extern TRACE_RingTypeDef TraceRing;
+extern volatile uint8_t  TraceEnabled;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Record one event from any context.
+  * @param  id: Event ID
+  * @param  payload: Event payload
+  * @retval None
+  */
+static inline void TRACE_Event(uint32_t id, uint32_t payload)
+{
+  uint32_t primask;
+
+  if (TraceEnabled != 0U)
+  {
+    primask = __get_PRIMASK();
+    __disable_irq();
+    TRACE_Encode(&TraceRing, DWT->CYCCNT, id, payload);
+    __set_PRIMASK(primask);
+  }
+}
+
+/* Exported macro ------------------------------------------------------------*/
+#if TRACE_ENABLE
+#define TRACE_ISR_ENTER(irqn)     TRACE_Event(TRACE_EV_ISR_ENTER, (uint32_t)(irqn))
+#define TRACE_ISR_EXIT(irqn)      TRACE_Event(TRACE_EV_ISR_EXIT, (uint32_t)(irqn))
+#define TRACE_TASK_SWITCH(task)   TRACE_Event(TRACE_EV_TASK_SWITCH, (uint32_t)(task))
+#define TRACE_MARK(value)         TRACE_Event(TRACE_EV_MARK, (uint32_t)(value))
+#define TRACE_CLOCK(hz)           TRACE_RECORDER_Clock((uint32_t)(hz))
+#define TRACE_USER(id, value)     TRACE_Event(TRACE_EV_USER | (uint32_t)(id), (uint32_t)(value))
+#else
+#define TRACE_ISR_ENTER(irqn)     ((void)0)
+#define TRACE_ISR_EXIT(irqn)      ((void)0)
+#define TRACE_TASK_SWITCH(task)   ((void)0)
+#define TRACE_MARK(value)         ((void)0)
+#define TRACE_CLOCK(hz)           ((void)0)
+#define TRACE_USER(id, value)     ((void)0)
+#endif
+
+/* Exported functions prototypes ---------------------------------------------*/
+void     TRACE_RECORDER_Init(void);
+void     TRACE_RECORDER_Start(void);
+void     TRACE_RECORDER_Stop(void);
+void     TRACE_RECORDER_Clock(uint32_t cpu_hz);
+uint32_t TRACE_RECORDER_Cost(void);
+HAL_StatusTypeDef TRACE_RECORDER_Dump(UART_HandleTypeDef *huart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TRACE_RECORDER_H */
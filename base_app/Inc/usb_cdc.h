@@ -0,0 +1,154 @@
+/**
+  ******************************************************************************
+  * @file    usb_cdc.h
+  * @brief   Header for usb_cdc.c file.
+  *          USB full-speed device with one CDC-ACM (virtual COM port)
+  *          function: descriptors, control transfers and the data path.
+  ******************************************************************************
+  * The device logic owns the descriptors, enumeration and the CDC class
+  * requests; everything that touches the controller is behind
+  * USB_CDC_PcdTypeDef. On the target the controller is OTG_FS
+  * (src/usb_fs.c), in the host tests it is a simulated controller
+  * (tests/test_usb_cdc.c) driven like a host would drive the bus.
+  *
+  * Outgoing data goes through a ring of USB_CDC_TX_SIZE bytes. The bulk IN
+  * endpoint transmits straight out of the ring, at most one half at a time,
+  * so one half drains while the writer fills the other; a transfer that
+  * ends on a full packet with nothing behind it is closed with a
+  * zero-length packet so the host's read returns.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USB_CDC_H
+#define __USB_CDC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/** Transmit ring in bytes, a power of two; one transfer is at most half */
+#ifndef USB_CDC_TX_SIZE
+#define USB_CDC_TX_SIZE         4096U
+#endif
+
+/** Receive ring in bytes, a power of two */
+#ifndef USB_CDC_RX_SIZE
+#define USB_CDC_RX_SIZE         256U
+#endif
+
+#define USB_CDC_VID             0x0483U     /*!< STMicroelectronics           */
+#define USB_CDC_PID             0x5740U     /*!< Virtual COM port             */
+
+#define USB_CDC_EP0_SIZE        64U
+#define USB_CDC_DATA_SIZE       64U         /*!< Full-speed bulk maximum      */
+#define USB_CDC_NOTIFY_SIZE     8U
+#define USB_CDC_EP_OUT          0x01U
+#define USB_CDC_EP_IN           0x81U
+#define USB_CDC_EP_NOTIFY       0x82U
+
+/* Endpoint types, as in the endpoint descriptor */
+#define USB_CDC_EP_CONTROL      0x00U
+#define USB_CDC_EP_BULK         0x02U
+#define USB_CDC_EP_INTERRUPT    0x03U
+
+/* Line state bits (SET_CONTROL_LINE_STATE) */
+#define USB_CDC_DTR             0x01U
+#define USB_CDC_RTS             0x02U
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  USB_CDC_DEFAULT    = 0x00U,   /*!< Reset, address 0                        */
+  USB_CDC_ADDRESSED  = 0x01U,
+  USB_CDC_CONFIGURED = 0x02U,   /*!< Data endpoints open                     */
+  USB_CDC_SUSPENDED  = 0x03U
+} USB_CDC_StateTypeDef;
+
+/**
+  * @brief  Controller operations. Transfers only start here; each one ends
+  *         with USB_CDC_DataIn() or USB_CDC_DataOut() from the controller.
+  *         Endpoint addresses carry the direction in bit 7.
+  */
+typedef struct
+{
+  void     (*SetAddress)(uint8_t address);
+  void     (*Open)(uint8_t ep, uint8_t type, uint16_t size);
+  void     (*Transmit)(uint8_t ep, const uint8_t *data, uint32_t length); /*!< 0: zero-length packet */
+  void     (*Receive)(uint8_t ep, uint8_t *data, uint32_t length);        /*!< One packet, up to length */
+  void     (*Stall)(uint8_t ep);
+  void     (*ClearStall)(uint8_t ep);                                    /*!< Also resets the data toggle */
+  uint32_t (*Lock)(void);                                                /*!< Mask the controller interrupt */
+  void     (*Unlock)(uint32_t state);
+} USB_CDC_PcdTypeDef;
+
+typedef struct
+{
+  uint32_t Setups;
+  uint32_t Stalls;            /*!< Requests refused                        */
+  uint32_t Resets;
+  uint32_t TxBytes;
+  uint32_t TxTransfers;
+  uint32_t TxZlps;
+  uint32_t TxDropped;         /*!< Bytes refused: not configured or full   */
+  uint32_t RxBytes;
+  uint32_t RxPaused;          /*!< OUT endpoint left NAKing, ring full     */
+} USB_CDC_StatsTypeDef;
+
+typedef struct
+{
+  const USB_CDC_PcdTypeDef *Pcd;
+  const char        *Serial;        /*!< Serial number string, ASCII       */
+  volatile uint8_t   State;         /*!< USB_CDC_StateTypeDef              */
+  uint8_t            Resume;        /*!< State to return to from suspend   */
+  uint8_t            Config;
+  uint8_t            LineState;     /*!< USB_CDC_DTR | USB_CDC_RTS         */
+  uint8_t            LineCoding[7]; /*!< Rate, stop bits, parity, data bits */
+  uint8_t            Halted;        /*!< Bit per data endpoint, see .c     */
+  /* Control endpoint */
+  uint8_t            Ep0Stage;
+  uint8_t            Ep0Zlp;        /*!< Close the data stage with a ZLP   */
+  uint8_t            Ep0Request;    /*!< Class request awaiting its data   */
+  const uint8_t     *Ep0Data;
+  uint16_t           Ep0Left;
+  uint8_t            Ep0Buf[USB_CDC_EP0_SIZE];
+  /* Bulk IN: Head belongs to the writer, Tail to the controller side */
+  volatile uint32_t  TxHead;
+  volatile uint32_t  TxTail;
+  uint32_t           TxLength;      /*!< Bytes of the transfer in flight   */
+  volatile uint8_t   TxBusy;
+  uint8_t            TxBuf[USB_CDC_TX_SIZE];
+  /* Bulk OUT */
+  volatile uint32_t  RxHead;
+  volatile uint32_t  RxTail;
+  volatile uint8_t   RxArmed;
+  uint8_t            RxPacket[USB_CDC_DATA_SIZE];
+  uint8_t            RxBuf[USB_CDC_RX_SIZE];
+  USB_CDC_StatsTypeDef Stats;
+} USB_CDC_HandleTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void     USB_CDC_Init(USB_CDC_HandleTypeDef *h, const USB_CDC_PcdTypeDef *pcd, const char *serial);
+uint32_t USB_CDC_Write(USB_CDC_HandleTypeDef *h, const void *data, uint32_t length);
+uint32_t USB_CDC_Read(USB_CDC_HandleTypeDef *h, void *data, uint32_t length);
+uint32_t USB_CDC_TxFree(const USB_CDC_HandleTypeDef *h);
+uint8_t  USB_CDC_Connected(const USB_CDC_HandleTypeDef *h);
+uint32_t USB_CDC_Descriptor(USB_CDC_HandleTypeDef *h, uint16_t value, const uint8_t **data);
+
+/* Controller events, all from one context (the controller interrupt) */
+void     USB_CDC_Reset(USB_CDC_HandleTypeDef *h);
+void     USB_CDC_Setup(USB_CDC_HandleTypeDef *h, const uint8_t *setup);
+void     USB_CDC_DataIn(USB_CDC_HandleTypeDef *h, uint8_t ep);
+void     USB_CDC_DataOut(USB_CDC_HandleTypeDef *h, uint8_t ep, uint32_t length);
+void     USB_CDC_Suspend(USB_CDC_HandleTypeDef *h);
+void     USB_CDC_Resume(USB_CDC_HandleTypeDef *h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USB_CDC_H */
@@ -0,0 +1,57 @@
+/**
+  ******************************************************************************
+  * @file    usb_fs.h
+  * @brief   Header for usb_fs.c file.
+  *          OTG_FS in device mode, the controller behind the USB virtual COM
+  *          port (usb_cdc.h).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USB_FS_H
+#define __USB_FS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "usb_cdc.h"
+#include "dvfs.h"
+
+/* Exported constants --------------------------------------------------------*/
+/** Console on USB: printMsg() goes to the virtual COM port while a terminal
+  * holds it open (DTR set), to USART3 otherwise */
+#ifndef USB_CONSOLE
+#define USB_CONSOLE             0
+#endif
+
+/** One interrupt per packet at most, the core buffers the rest */
+#define USB_FS_IRQ_PRIORITY     8U
+
+/** Slowest HCLK the core keeps up with at full speed (RM0090, TRDT) */
+#define USB_FS_HCLK_MIN_HZ      14200000U
+
+/* FIFO RAM in words, 320 in all: receive, then one transmit FIFO per IN
+ * endpoint in use */
+#define USB_FS_RX_WORDS         128U
+#define USB_FS_TX0_WORDS        32U         /*!< Control, two packets         */
+#define USB_FS_TX1_WORDS        128U        /*!< Bulk data, eight packets     */
+#define USB_FS_TX2_WORDS        16U         /*!< Notification                 */
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef  USB_FS_Init(void);
+uint32_t           USB_FS_Write(const void *data, uint32_t length);
+uint32_t           USB_FS_Read(void *data, uint32_t length);
+uint8_t            USB_FS_Connected(void);
+void               USB_FS_GetStats(USB_CDC_StatsTypeDef *stats);
+DVFS_StatusTypeDef USB_FS_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                      const DVFS_PointTypeDef *point);
+void               USB_FS_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USB_FS_H */
@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+  * @file    watchdog.h
+  * @brief   Header for watchdog.c file.
+  *          Watchdog supervisor: per-task heartbeat deadlines that gate the
+  *          hardware watchdog refresh.
+  ******************************************************************************
+  * Every registered task calls WDOG_Heartbeat() at least once per deadline.
+  * WDOG_Check() runs periodically and allows a watchdog refresh only while
+  * all tasks are within their deadlines. The first task to miss is latched,
+  * refreshes stop for good and the hardware watchdog resets the MCU; the
+  * culprit is kept in a WDOG_RecordTypeDef in .noinit RAM for the next boot.
+  *
+  * Times are in ticks of the caller's clock; the firmware uses HAL ticks
+  * (1 ms), the tests a virtual clock.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __WATCHDOG_H
+#define __WATCHDOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define WDOG_MAX_TASKS          8U
+#define WDOG_NAME_MAX           12U           /*!< Name bytes kept in the record */
+#define WDOG_MAGIC              0x474F4457U   /*!< "WDOG": starved, not reported */
+#define WDOG_MAGIC_REPORTED     0x50474457U   /*!< "WDGP": already reported      */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  WDOG_OK      = 0x00U,
+  WDOG_STARVED = 0x01U,       /*!< A task missed its deadline            */
+  WDOG_FULL    = 0x02U,
+  WDOG_INVALID = 0x03U
+} WDOG_StatusTypeDef;
+
+typedef struct
+{
+  const char       *Name;
+  uint32_t          Deadline;   /*!< Longest allowed gap between heartbeats */
+  volatile uint32_t LastBeat;
+  uint32_t          Beats;
+  uint32_t          WorstGap;   /*!< Longest gap between two heartbeats     */
+  volatile uint8_t  Suspended;
+} WDOG_TaskTypeDef;
+
+typedef struct
+{
+  WDOG_TaskTypeDef Tasks[WDOG_MAX_TASKS];
+  uint32_t Count;
+  int32_t  Starved;           /*!< Task that missed its deadline, -1 if none */
+  uint32_t Overdue;           /*!< Ticks past that task's deadline           */
+  uint32_t Refreshes;         /*!< Checks that allowed a refresh             */
+} WDOG_HandleTypeDef;
+
+/**
+  * @brief  Starvation record, kept across the watchdog reset
+  */
+typedef struct
+{
+  uint32_t Magic;
+  uint32_t Count;             /*!< Watchdog resets since power-on           */
+  uint32_t Task;
+  uint32_t Overdue;
+  char     Name[WDOG_NAME_MAX];
+  uint32_t Check;
+} WDOG_RecordTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void               WDOG_Init(WDOG_HandleTypeDef *hwdog);
+WDOG_StatusTypeDef WDOG_Register(WDOG_HandleTypeDef *hwdog, const char *name, uint32_t deadline,
+                                 uint32_t now, uint32_t *id);
+void               WDOG_Heartbeat(WDOG_HandleTypeDef *hwdog, uint32_t id, uint32_t now);
+void               WDOG_Suspend(WDOG_HandleTypeDef *hwdog, uint32_t id);
+void               WDOG_Resume(WDOG_HandleTypeDef *hwdog, uint32_t id, uint32_t now);
+WDOG_StatusTypeDef WDOG_Check(WDOG_HandleTypeDef *hwdog, uint32_t now);
+
+void     WDOG_Record(const WDOG_HandleTypeDef *hwdog, WDOG_RecordTypeDef *record);
+uint8_t  WDOG_RecordIsPending(const WDOG_RecordTypeDef *record);
+void     WDOG_RecordMarkReported(WDOG_RecordTypeDef *record);
+uint32_t WDOG_FormatRecord(const WDOG_RecordTypeDef *record, char *out, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WATCHDOG_H */
@@ -0,0 +1,429 @@
+/**
+  ******************************************************************************
+  * @file    accel_input.c
+  * @brief   On-board accelerometer on SPI1, sampled at its data rate into
+  *          the tilt and vibration filter.
+  ******************************************************************************
+  * The Discovery board carries a LIS3DSH (MB997C on) or a LIS302DL (MB997B),
+  * both on SPI1 in mode 3:
+  *
+  *   PA5 SPI1_SCK    PA6 SPI1_MISO    PA7 SPI1_MOSI  (AF5)    PE3 CS
+  *
+  * The BSP's ACCELERO_IO_Read() needs the HAL SPI driver, which is not in
+  * this tree, so SPI1 is programmed directly: polled byte transfers at up to
+  * 10 MHz, re-divided on a clock switch. Neither sensor's data-ready line
+  * is usable (INT1 is PE0, and EXTI line 0 belongs to the user button):
+  *
+  *   LIS3DSH   100 Hz into its 32-sample FIFO in stream mode; the task
+  *             drains it every 100 ms.
+  *   LIS302DL  100 Hz, no FIFO; the task polls the status every 5 ms.
+  *
+  * Either way every sample goes through FUSION_Update() in turn, so the
+  * filter runs at the sensor's data rate. Its state, the covariances
+  * included, is in CCM RAM. Each update is timed with the cycle counter.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "accel_input.h"
+#include "board.h"
+#include "dwt.h"
+#include "kernel.h"
+#include "placement.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define ACCEL_INPUT_SPI_LOOPS   1000U   /* Per byte, several byte times       */
+#define ACCEL_INPUT_FIFO        32U
+
+/* SPI address byte */
+#define ACCEL_READ              0x80U
+#define ACCEL_MULTI             0x40U   /* LIS302DL address increment         */
+
+/* Common registers */
+#define ACCEL_WHO_AM_I          0x0FU
+#define ACCEL_CTRL1             0x20U   /* LIS3DSH CTRL_REG4, LIS302DL CTRL_REG1 */
+
+/* LIS3DSH */
+#define LIS3DSH_CTRL4_VALUE     0x6FU   /* 100 Hz, block update, X Y Z        */
+#define LIS3DSH_CTRL5           0x24U
+#define LIS3DSH_CTRL5_VALUE     0xC0U   /* 50 Hz anti-aliasing, +-2 g         */
+#define LIS3DSH_CTRL6           0x25U
+#define LIS3DSH_CTRL6_VALUE     0x50U   /* FIFO, address increment            */
+#define LIS3DSH_OUT_X_L         0x28U
+#define LIS3DSH_FIFO_CTRL       0x2EU
+#define LIS3DSH_FIFO_STREAM     0x40U
+#define LIS3DSH_FIFO_SRC        0x2FU
+#define LIS3DSH_FIFO_OVRN       0x40U
+#define LIS3DSH_FIFO_FSS        0x1FU
+#define LIS3DSH_G_PER_LSB       0.00006f
+#define LIS3DSH_NOISE_G         0.002f
+#define LIS3DSH_PERIOD_MS       100U
+
+/* LIS302DL */
+#define LIS302DL_CTRL1_VALUE    0x47U   /* 100 Hz, active, +-2.3 g, X Y Z     */
+#define LIS302DL_STATUS         0x27U
+#define LIS302DL_ZYXDA          0x08U
+#define LIS302DL_ZYXOR          0x80U
+#define LIS302DL_G_PER_LSB      0.018f
+#define LIS302DL_NOISE_G        0.01f   /* Mostly the 18 mg step              */
+#define LIS302DL_PERIOD_MS      5U
+
+_Static_assert((ACCEL_INPUT_ODR_HZ * LIS3DSH_PERIOD_MS) < (ACCEL_INPUT_FIFO * 1000U),
+               "LIS3DSH_PERIOD_MS: the FIFO would overflow");
+
+/* Private variables ---------------------------------------------------------*/
+/* The filter works on it on every sample and nothing else touches it */
+static FUSION_TypeDef           AccelFusion DATA_CCM;
+
+static int16_t                  AccelSamples[ACCEL_INPUT_FIFO][3];
+static float                    AccelScale;
+static uint32_t                 AccelPeriodMs;
+static volatile uint8_t         AccelBusy;
+static uint8_t                  AccelReady;
+static uint64_t                 AccelCycles;
+static ACCEL_InputResultTypeDef AccelResult;
+static ACCEL_InputStatsTypeDef  AccelStats;
+static KERNEL_MutexTypeDef      AccelLock;
+static KERNEL_TaskTypeDef       AccelTask;
+static uint64_t                 AccelStack[ACCEL_INPUT_TASK_WORDS / 2U];
+
+/* Private function prototypes -----------------------------------------------*/
+static void              ACCEL_INPUT_Task(void *argument);
+static void              ACCEL_INPUT_MspInit(void);
+static void              ACCEL_INPUT_SetClock(uint32_t pclk2);
+static HAL_StatusTypeDef ACCEL_INPUT_Transfer(uint8_t address, uint8_t *data, uint32_t length, uint8_t write);
+static HAL_StatusTypeDef ACCEL_INPUT_WriteReg(uint8_t reg, uint8_t value);
+static uint32_t          ACCEL_INPUT_TakeLis3dsh(void);
+static uint32_t          ACCEL_INPUT_TakeLis302dl(void);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Find the sensor, start it at ACCEL_INPUT_ODR_HZ and create the
+  *         task that feeds the filter. Call after KERNEL_PORT_Init().
+  * @retval HAL_OK, HAL_ERROR if no known sensor answers, HAL_TIMEOUT
+  */
+HAL_StatusTypeDef ACCEL_INPUT_Init(void)
+{
+  uint8_t chip = 0U;
+  HAL_StatusTypeDef status;
+
+  AccelReady = 0U;
+  memset(&AccelStats, 0, sizeof(AccelStats));
+  memset(&AccelResult, 0, sizeof(AccelResult));
+  AccelCycles = 0U;
+  ACCEL_INPUT_MspInit();
+  ACCEL_INPUT_SetClock(HAL_RCC_GetPCLK2Freq());
+
+  status = ACCEL_INPUT_Transfer(ACCEL_WHO_AM_I, &chip, 1U, 0U);
+  if (status != HAL_OK)
+  {
+    return status;
+  }
+  if (chip == ACCEL_INPUT_LIS3DSH)
+  {
+    if ((ACCEL_INPUT_WriteReg(ACCEL_CTRL1, LIS3DSH_CTRL4_VALUE) != HAL_OK) ||
+        (ACCEL_INPUT_WriteReg(LIS3DSH_CTRL5, LIS3DSH_CTRL5_VALUE) != HAL_OK) ||
+        (ACCEL_INPUT_WriteReg(LIS3DSH_CTRL6, LIS3DSH_CTRL6_VALUE) != HAL_OK) ||
+        (ACCEL_INPUT_WriteReg(LIS3DSH_FIFO_CTRL, LIS3DSH_FIFO_STREAM) != HAL_OK))
+    {
+      return HAL_TIMEOUT;
+    }
+    AccelScale = LIS3DSH_G_PER_LSB;
+    AccelPeriodMs = LIS3DSH_PERIOD_MS;
+    FUSION_Init(&AccelFusion, (float)ACCEL_INPUT_ODR_HZ, LIS3DSH_NOISE_G,
+                ACCEL_INPUT_RATE_DPS, ACCEL_INPUT_WINDOW_S);
+  }
+  else if (chip == ACCEL_INPUT_LIS302DL)
+  {
+    if (ACCEL_INPUT_WriteReg(ACCEL_CTRL1, LIS302DL_CTRL1_VALUE) != HAL_OK)
+    {
+      return HAL_TIMEOUT;
+    }
+    AccelScale = LIS302DL_G_PER_LSB;
+    AccelPeriodMs = LIS302DL_PERIOD_MS;
+    FUSION_Init(&AccelFusion, (float)ACCEL_INPUT_ODR_HZ, LIS302DL_NOISE_G,
+                ACCEL_INPUT_RATE_DPS, ACCEL_INPUT_WINDOW_S);
+  }
+  else
+  {
+    return HAL_ERROR;
+  }
+  AccelStats.Chip = chip;
+  AccelStats.CyclesMin = UINT32_MAX;
+
+  DWT_Init();
+  KERNEL_MutexInit(&AccelLock);
+  if (KERNEL_TaskCreate(&AccelTask, "accel", ACCEL_INPUT_Task, NULL, ACCEL_INPUT_TASK_PRIORITY,
+                        (uint32_t *)AccelStack, ACCEL_INPUT_TASK_WORDS) != KERNEL_OK)
+  {
+    return HAL_ERROR;
+  }
+  AccelReady = 1U;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Latest filter output.
+  * @param  result: Destination
+  * @retval None
+  */
+void ACCEL_INPUT_Read(ACCEL_InputResultTypeDef *result)
+{
+  (void)KERNEL_MutexLock(&AccelLock, KERNEL_FOREVER);
+  *result = AccelResult;
+  (void)KERNEL_MutexUnlock(&AccelLock);
+}
+
+/**
+  * @brief  Copy the counters and the update timing.
+  * @param  stats: Destination
+  * @retval None
+  */
+void ACCEL_INPUT_GetStats(ACCEL_InputStatsTypeDef *stats)
+{
+  (void)KERNEL_MutexLock(&AccelLock, KERNEL_FOREVER);
+  *stats = AccelStats;
+  (void)KERNEL_MutexUnlock(&AccelLock);
+  if (stats->Samples == 0U)
+  {
+    stats->CyclesMin = 0U;
+  }
+}
+
+/**
+  * @brief  DVFS: hold a switch while a transfer is on the bus, then divide
+  *         the new PCLK2 down to the sensor's clock limit again.
+  * @param  context: Unused
+  * @param  event: Before or after the switch
+  * @param  point: The new operating point
+  * @retval DVFS_OK, DVFS_BUSY
+  */
+DVFS_StatusTypeDef ACCEL_INPUT_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                           const DVFS_PointTypeDef *point)
+{
+  (void)context;
+  if (AccelReady == 0U)
+  {
+    return DVFS_OK;
+  }
+  if (event == DVFS_EV_PRE)
+  {
+    return (AccelBusy != 0U) ? DVFS_BUSY : DVFS_OK;
+  }
+  ACCEL_INPUT_SetClock(DVFS_Pclk(point, 2U));
+  return DVFS_OK;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Task: take what the sensor has, filter it sample by sample and
+  *         publish the result.
+  * @param  argument: Unused
+  * @retval None
+  */
+static void ACCEL_INPUT_Task(void *argument)
+{
+  FUSION_TiltTypeDef tilt;
+  uint32_t count;
+  uint32_t cycles;
+  uint32_t start;
+  uint32_t i;
+
+  (void)argument;
+  for (;;)
+  {
+    KERNEL_Sleep(AccelPeriodMs);
+    count = (AccelStats.Chip == ACCEL_INPUT_LIS3DSH) ? ACCEL_INPUT_TakeLis3dsh() :
+                                                       ACCEL_INPUT_TakeLis302dl();
+    if (count == 0U)
+    {
+      continue;
+    }
+    (void)KERNEL_MutexLock(&AccelLock, KERNEL_FOREVER);
+    for (i = 0U; i < count; i++)
+    {
+      start = DWT_Cycles();
+      FUSION_Update(&AccelFusion, (float)AccelSamples[i][0] * AccelScale,
+                    (float)AccelSamples[i][1] * AccelScale, (float)AccelSamples[i][2] * AccelScale);
+      cycles = DWT_Cycles() - start;
+      AccelStats.CyclesMin = (cycles < AccelStats.CyclesMin) ? cycles : AccelStats.CyclesMin;
+      AccelStats.CyclesMax = (cycles > AccelStats.CyclesMax) ? cycles : AccelStats.CyclesMax;
+      AccelCycles += cycles;
+    }
+    AccelStats.Samples += count;
+    AccelStats.CyclesAvg = (uint32_t)(AccelCycles / AccelStats.Samples);
+    FUSION_Tilt(&AccelFusion, &tilt);
+    AccelResult.Tilt = tilt;
+    AccelResult.Vibration = FUSION_Vibration(&AccelFusion);
+    AccelResult.Samples = AccelStats.Samples;
+    (void)KERNEL_MutexUnlock(&AccelLock);
+  }
+}
+
+/**
+  * @brief  Clocks and pins; SPI1 master, mode 3, 8 bits, software NSS.
+  * @retval None
+  */
+static void ACCEL_INPUT_MspInit(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  __HAL_RCC_SPI1_CLK_ENABLE();
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  __HAL_RCC_GPIOE_CLK_ENABLE();
+
+  ACCEL_CS_Set();
+  ACCEL_CS_Init(PIN_MODE_OUTPUT, PIN_PULL_NONE, PIN_SPEED_MEDIUM, PIN_OTYPE_PP);
+
+  GPIO_InitStruct.Pin = GPIO_PIN_5 | GPIO_PIN_6 | GPIO_PIN_7;
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct.Alternate = GPIO_AF5_SPI1;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+}
+
+/**
+  * @brief  Smallest SPI1 prescaler that keeps SCK at or below
+  *         ACCEL_INPUT_SPI_HZ. Only between transfers.
+  * @param  pclk2: APB2 clock in Hz
+  * @retval None
+  */
+static void ACCEL_INPUT_SetClock(uint32_t pclk2)
+{
+  uint32_t br = 0U;
+
+  while ((br < 7U) && ((pclk2 >> (br + 1U)) > ACCEL_INPUT_SPI_HZ))
+  {
+    br++;
+  }
+  SPI1->CR1 = 0U;
+  SPI1->CR1 = SPI_CR1_MSTR | SPI_CR1_SSM | SPI_CR1_SSI | SPI_CR1_CPOL | SPI_CR1_CPHA |
+              (br << SPI_CR1_BR_Pos);
+  SPI1->CR1 |= SPI_CR1_SPE;
+}
+
+/**
+  * @brief  One register access with chip select around it.
+  * @param  address: Register, with ACCEL_MULTI for a LIS302DL burst
+  * @param  data: Bytes to write or read
+  * @param  length: Byte count
+  * @param  write: 1 to write data, 0 to read into it
+  * @retval HAL_OK, HAL_TIMEOUT
+  */
+static HAL_StatusTypeDef ACCEL_INPUT_Transfer(uint8_t address, uint8_t *data, uint32_t length, uint8_t write)
+{
+  HAL_StatusTypeDef status = HAL_OK;
+  uint32_t loops;
+  uint32_t i;
+  uint8_t byte;
+
+  AccelBusy = 1U;
+  ACCEL_CS_Reset();
+  for (i = 0U; (i <= length) && (status == HAL_OK); i++)
+  {
+    byte = (i == 0U) ? ((write != 0U) ? address : (uint8_t)(address | ACCEL_READ)) :
+                       ((write != 0U) ? data[i - 1U] : 0U);
+    loops = ACCEL_INPUT_SPI_LOOPS;
+    while (((SPI1->SR & SPI_SR_TXE) == 0U) && (--loops != 0U))
+    {
+    }
+    *(__IO uint8_t *)&SPI1->DR = byte;
+    while (((SPI1->SR & SPI_SR_RXNE) == 0U) && (--loops != 0U))
+    {
+    }
+    if (loops == 0U)
+    {
+      status = HAL_TIMEOUT;
+      break;
+    }
+    byte = *(__IO uint8_t *)&SPI1->DR;
+    if ((i != 0U) && (write == 0U))
+    {
+      data[i - 1U] = byte;
+    }
+  }
+  while ((SPI1->SR & SPI_SR_BSY) != 0U)
+  {
+  }
+  ACCEL_CS_Set();
+  AccelBusy = 0U;
+  if (status != HAL_OK)
+  {
+    AccelStats.Errors++;
+  }
+  return status;
+}
+
+/**
+  * @brief  Write one register.
+  * @param  reg: Register
+  * @param  value: Value
+  * @retval HAL_OK, HAL_TIMEOUT
+  */
+static HAL_StatusTypeDef ACCEL_INPUT_WriteReg(uint8_t reg, uint8_t value)
+{
+  return ACCEL_INPUT_Transfer(reg, &value, 1U, 1U);
+}
+
+/**
+  * @brief  LIS3DSH: drain the FIFO into AccelSamples.
+  * @retval Samples taken
+  */
+static uint32_t ACCEL_INPUT_TakeLis3dsh(void)
+{
+  uint8_t src;
+  uint8_t raw[6];
+  uint32_t count;
+  uint32_t i;
+
+  if (ACCEL_INPUT_Transfer(LIS3DSH_FIFO_SRC, &src, 1U, 0U) != HAL_OK)
+  {
+    return 0U;
+  }
+  if ((src & LIS3DSH_FIFO_OVRN) != 0U)
+  {
+    AccelStats.Overruns++;
+  }
+  count = src & LIS3DSH_FIFO_FSS;
+  for (i = 0U; i < count; i++)
+  {
+    if (ACCEL_INPUT_Transfer(LIS3DSH_OUT_X_L, raw, sizeof(raw), 0U) != HAL_OK)
+    {
+      break;
+    }
+    AccelSamples[i][0] = (int16_t)((uint16_t)raw[0] | ((uint16_t)raw[1] << 8));
+    AccelSamples[i][1] = (int16_t)((uint16_t)raw[2] | ((uint16_t)raw[3] << 8));
+    AccelSamples[i][2] = (int16_t)((uint16_t)raw[4] | ((uint16_t)raw[5] << 8));
+  }
+  return i;
+}
+
+/**
+  * @brief  LIS302DL: take the current sample if it is new.
+  * @retval 0 or 1
+  */
+static uint32_t ACCEL_INPUT_TakeLis302dl(void)
+{
+  uint8_t raw[7];             /* STATUS, -, X, -, Y, -, Z */
+
+  if (ACCEL_INPUT_Transfer(LIS302DL_STATUS | ACCEL_MULTI, raw, sizeof(raw), 0U) != HAL_OK)
+  {
+    return 0U;
+  }
+  if ((raw[0] & LIS302DL_ZYXOR) != 0U)
+  {
+    AccelStats.Overruns++;
+  }
+  if ((raw[0] & LIS302DL_ZYXDA) == 0U)
+  {
+    return 0U;
+  }
+  AccelSamples[0][0] = (int8_t)raw[2];
+  AccelSamples[0][1] = (int8_t)raw[4];
+  AccelSamples[0][2] = (int8_t)raw[6];
+  return 1U;
+}
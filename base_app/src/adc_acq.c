@@ -0,0 +1,553 @@
+/**
+  ******************************************************************************
+  * @file    adc_acq.c
+  * @brief   Analog acquisition on ADC1/2/3: a timer-triggered scan of the
+  *          channel table, or one channel triple interleaved, into a DMA
+  *          double buffer that is decimated half by half.
+  ******************************************************************************
+  * Data path on the STM32F4-Discovery:
+  *
+  *   scan:        TIM2 TRGO -> ADC1 regular sequence (AdcAcqChannels[])
+  *                  -> ADC1_DR -> DMA2 Stream0 ch0, halfwords, circular
+  *   interleaved: ADC1, ADC2, ADC3 on the fast channel, 5 ADCCLK apart
+  *                  -> ADC_CDR -> DMA2 Stream0 ch0, two samples a word
+  *
+  *   -> AdcBuffer, two halves -> ADC_SCAN ring and decimator -> ADC_ACQ_Read()
+  *
+  * A scan converts the whole table once per TIM2 update; TIM2 counts at
+  * ADC_ACQ_TICK_HZ at every operating point (POWER_AddTimer()), so the
+  * frame rate survives a clock switch. A switch that would make ADCCLK too
+  * slow for the frame rate is vetoed.
+  *
+  * Interleaved, each ADC samples for 3 cycles and converts for 12, and the
+  * three start 5 cycles apart: a sample every 5 ADCCLK, 4.2 Msps at 21 MHz.
+  * DMA mode 2 packs two samples a word and they land in conversion order.
+  * ADCCLK follows PCLK2, so this rate drops with a slower operating point.
+  *
+  * The half-transfer and transfer-complete interrupts run the decimator on
+  * the half the DMA just left, so the CPU sees one interrupt per half, not
+  * per sample. A conversion the DMA missed sets OVR and stops the requests;
+  * the ADC interrupt counts it and restarts the transfer. There is no HAL
+  * ADC driver in this tree, so the ADCs are programmed directly; DMA and
+  * TIM2 go through the HAL.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "adc_acq.h"
+#include "clock_config.h"
+#include "clock_tree.h"
+#include "dwt.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define ADC_ACQ_FAST_CHANNEL  11U         /*!< PC1, ADC123_IN11                  */
+#define ADC_ACQ_FAST_SMP      0U          /*!< 3 cycles                          */
+#define ADC_ACQ_STAB_US       3U          /*!< tSTAB after ADON                  */
+
+/** CCR MULTI = 10111: triple mode, regular interleaved only */
+#define ADC_ACQ_CCR_TRIPLE    (ADC_CCR_MULTI_4 | ADC_CCR_MULTI_2 | ADC_CCR_MULTI_1 | ADC_CCR_MULTI_0)
+/** CR2 EXTSEL = 0110: TIM2 TRGO, on rising edges */
+#define ADC_ACQ_CR2_TIM2      (ADC_CR2_EXTSEL_2 | ADC_CR2_EXTSEL_1 | ADC_CR2_EXTEN_0)
+
+/* Private variables ---------------------------------------------------------*/
+DMA_HandleTypeDef hdma_adc1;
+TIM_HandleTypeDef htim2;
+
+/** Scan sequence, in conversion order. The temperature sensor wants 10 us
+  * of sampling, 480 cycles at 21 MHz. */
+const ADC_ACQ_ChannelTypeDef AdcAcqChannels[] =
+{
+  {"PC1",     GPIOC, GPIO_PIN_1, 11U, 3U},
+  {"PC2",     GPIOC, GPIO_PIN_2, 12U, 3U},
+  {"PC4",     GPIOC, GPIO_PIN_4, 14U, 3U},
+  {"PC5",     GPIOC, GPIO_PIN_5, 15U, 3U},
+  {"temp",    NULL,  0U,         16U, 7U},
+  {"vrefint", NULL,  0U,         17U, 7U},
+};
+const uint32_t AdcAcqChannelCount = sizeof(AdcAcqChannels) / sizeof(AdcAcqChannels[0]);
+
+_Static_assert(sizeof(AdcAcqChannels) / sizeof(AdcAcqChannels[0]) <= ADC_SCAN_MAX_CHANNELS,
+               "ADC scan table longer than a regular sequence");
+
+__ALIGNED(4) static uint16_t      AdcBuffer[ADC_ACQ_SAMPLES];
+static ADC_SCAN_RingTypeDef       AdcRing;
+static ADC_SCAN_DecimatorTypeDef  AdcDec;
+static ADC_ACQ_ModeTypeDef        AdcMode;
+static uint32_t                   AdcFrameHz;
+static uint32_t                   AdcClockHz;
+static uint32_t                   AdcFrameCycles;
+static uint16_t                   AdcOut[ADC_SCAN_MAX_CHANNELS];
+static uint32_t                   AdcOutputs;
+static volatile uint32_t          AdcSeq;
+static volatile uint32_t          AdcSamples;
+static volatile uint32_t          AdcOverruns;
+static volatile uint32_t          AdcDmaErrors;
+
+/* Private function prototypes -----------------------------------------------*/
+static void              ADC_ACQ_MspInit(void);
+static void              ADC_ACQ_PowerDown(void);
+static HAL_StatusTypeDef ADC_ACQ_InitDma(uint32_t align);
+static HAL_StatusTypeDef ADC_ACQ_StartDma(void);
+static uint32_t          ADC_ACQ_WriteSample(void);
+static void              ADC_ACQ_Process(uint32_t half);
+static void              ADC_ACQ_HalfCplt(DMA_HandleTypeDef *hdma);
+static void              ADC_ACQ_Cplt(DMA_HandleTypeDef *hdma);
+static void              ADC_ACQ_Error(DMA_HandleTypeDef *hdma);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Configure the scan pins, TIM2 and the DMA stream; the ADCs stay
+  *         off until a start. Call before POWER_AddTimer(&htim2, ...).
+  * @retval HAL status
+  */
+HAL_StatusTypeDef ADC_ACQ_Init(void)
+{
+  TIM_MasterConfigTypeDef sMasterConfig = {0};
+
+  ADC_ACQ_MspInit();
+  DWT_Init();
+
+  htim2.Instance = TIM2;
+  htim2.Init.Prescaler = CLOCK_TIM_PSC(CLOCK_CONFIG_TIM_APB1_HZ, ADC_ACQ_TICK_HZ);
+  htim2.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim2.Init.Period = 0xFFFFFFFFU;
+  htim2.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+  if (HAL_TIM_Base_Init(&htim2) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  sMasterConfig.MasterOutputTrigger = TIM_TRGO_UPDATE;
+  sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+  if (HAL_TIMEx_MasterConfigSynchronization(&htim2, &sMasterConfig) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  /* DMA2 Stream0 channel 0 is ADC1, and ADC_CDR in multi mode */
+  hdma_adc1.Instance = DMA2_Stream0;
+  hdma_adc1.Init.Channel = DMA_CHANNEL_0;
+  hdma_adc1.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_adc1.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_adc1.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_adc1.Init.Mode = DMA_CIRCULAR;
+  hdma_adc1.Init.Priority = DMA_PRIORITY_HIGH;
+  hdma_adc1.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (ADC_ACQ_InitDma(DMA_PDATAALIGN_HALFWORD) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  hdma_adc1.XferHalfCpltCallback = ADC_ACQ_HalfCplt;
+  hdma_adc1.XferCpltCallback = ADC_ACQ_Cplt;
+  hdma_adc1.XferErrorCallback = ADC_ACQ_Error;
+
+  AdcMode = ADC_ACQ_STOPPED;
+  AdcClockHz = CLOCK_CONFIG_PCLK2_HZ / ADC_ACQ_ADCCLK_DIV;
+  AdcSeq = 0U;
+  AdcOutputs = 0U;
+  AdcSamples = 0U;
+  AdcOverruns = 0U;
+  AdcDmaErrors = 0U;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Scan the channel table on ADC1 frame_hz times a second and
+  *         average ratio frames per output.
+  * @param  frame_hz: Scans per second; one scan must fit in a period
+  * @param  ratio: Frames per output, 1 to ADC_SCAN_MAX_RATIO
+  * @retval HAL_ERROR for a rate or ratio that cannot be run
+  */
+HAL_StatusTypeDef ADC_ACQ_StartScan(uint32_t frame_hz, uint32_t ratio)
+{
+  ADC_TypeDef *adc = ADC1;
+  uint8_t smp[ADC_SCAN_MAX_CHANNELS];
+  uint32_t sqr[3] = {0U, 0U, 0U};
+  uint32_t smpr[2] = {0U, 0U};
+  uint32_t ch;
+  uint32_t i;
+
+  ADC_ACQ_Stop();
+  for (i = 0U; i < AdcAcqChannelCount; i++)
+  {
+    smp[i] = AdcAcqChannels[i].Smp;
+  }
+  AdcFrameCycles = ADC_SCAN_FrameCycles(smp, AdcAcqChannelCount);
+  if ((frame_hz == 0U) || (frame_hz > ADC_ACQ_TICK_HZ) || (AdcFrameCycles == 0U) ||
+      ((uint64_t)AdcFrameCycles * frame_hz > AdcClockHz) ||
+      (ADC_SCAN_DecimatorInit(&AdcDec, AdcAcqChannelCount, ratio) != ADC_SCAN_OK) ||
+      (ADC_ACQ_InitDma(DMA_PDATAALIGN_HALFWORD) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+
+  /* Sequence and sampling times from the table: SQR3 holds SQ1..6, SQR2
+   * SQ7..12, SQR1 SQ13..16 and the length; SMPR2 channels 0..9, SMPR1
+   * 10..18 */
+  for (i = 0U; i < AdcAcqChannelCount; i++)
+  {
+    ch = AdcAcqChannels[i].Channel;
+    sqr[i / 6U] |= ch << (5U * (i % 6U));
+    if (ch < 10U)
+    {
+      smpr[1] |= (uint32_t)AdcAcqChannels[i].Smp << (3U * ch);
+    }
+    else
+    {
+      smpr[0] |= (uint32_t)AdcAcqChannels[i].Smp << (3U * (ch - 10U));
+    }
+  }
+  ADC->CCR = ADC_CCR_ADCPRE_0 | ADC_CCR_TSVREFE;
+  adc->CR1 = ADC_CR1_SCAN | ADC_CR1_OVRIE;
+  adc->SQR3 = sqr[0];
+  adc->SQR2 = sqr[1];
+  adc->SQR1 = sqr[2] | ((AdcAcqChannelCount - 1U) << ADC_SQR1_L_Pos);
+  adc->SMPR1 = smpr[0];
+  adc->SMPR2 = smpr[1];
+  adc->CR2 = ADC_CR2_ADON;
+
+  /* Whole frames in each half */
+  ADC_SCAN_RingInit(&AdcRing, AdcBuffer, ((ADC_ACQ_SAMPLES / 2U) / AdcAcqChannelCount) * AdcAcqChannelCount);
+  AdcMode = ADC_ACQ_SCAN;
+  AdcFrameHz = frame_hz;
+  if (ADC_ACQ_StartDma() != HAL_OK)
+  {
+    ADC_ACQ_Stop();
+    return HAL_ERROR;
+  }
+
+  /* The first trigger comes a frame period from now, long after tSTAB */
+  htim2.Instance->ARR = (ADC_ACQ_TICK_HZ / frame_hz) - 1U;
+  htim2.Instance->CNT = 0U;
+  htim2.Instance->CR1 |= TIM_CR1_URS;
+  htim2.Instance->EGR = TIM_EGR_UG;
+  htim2.Instance->CR1 &= ~TIM_CR1_URS;
+  htim2.Instance->CR1 |= TIM_CR1_CEN;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Run ADC1/2/3 interleaved on the fast channel, PC1, as fast as
+  *         they go, and average ratio samples per output.
+  * @param  ratio: Samples per output, 1 to ADC_SCAN_MAX_RATIO
+  * @retval HAL_ERROR for a ratio out of range
+  */
+HAL_StatusTypeDef ADC_ACQ_StartInterleaved(uint32_t ratio)
+{
+  ADC_TypeDef *const adcs[3] = {ADC1, ADC2, ADC3};
+  uint32_t start;
+  uint32_t i;
+
+  ADC_ACQ_Stop();
+  if ((ADC_SCAN_DecimatorInit(&AdcDec, 1U, ratio) != ADC_SCAN_OK) ||
+      (ADC_ACQ_InitDma(DMA_PDATAALIGN_WORD) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+
+  /* DMA mode 2 with DDS: two samples a request, for as long as it runs.
+   * DELAY = 0 is 5 cycles, the least that keeps sampling phases apart. */
+  ADC->CCR = ADC_CCR_ADCPRE_0 | ADC_CCR_DMA_1 | ADC_CCR_DDS | ADC_ACQ_CCR_TRIPLE;
+  for (i = 0U; i < 3U; i++)
+  {
+    adcs[i]->CR1 = ADC_CR1_OVRIE;
+    adcs[i]->SQR1 = 0U;
+    adcs[i]->SQR2 = 0U;
+    adcs[i]->SQR3 = ADC_ACQ_FAST_CHANNEL;
+    adcs[i]->SMPR1 = (uint32_t)ADC_ACQ_FAST_SMP << (3U * (ADC_ACQ_FAST_CHANNEL - 10U));
+    adcs[i]->SMPR2 = 0U;
+    adcs[i]->CR2 = ADC_CR2_ADON | ADC_CR2_CONT;
+  }
+
+  ADC_SCAN_RingInit(&AdcRing, AdcBuffer, ADC_ACQ_SAMPLES / 2U);
+  AdcMode = ADC_ACQ_INTERLEAVED;
+  AdcFrameHz = 0U;
+
+  start = DWT_Cycles();
+  while (DWT_CyclesToUs(DWT_Cycles() - start) < ADC_ACQ_STAB_US)
+  {
+  }
+  if (ADC_ACQ_StartDma() != HAL_OK)
+  {
+    ADC_ACQ_Stop();
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Stop the trigger, the ADCs and the DMA. Read() keeps returning
+  *         the last outputs.
+  * @retval None
+  */
+void ADC_ACQ_Stop(void)
+{
+  htim2.Instance->CR1 &= ~TIM_CR1_CEN;
+  AdcMode = ADC_ACQ_STOPPED;
+  ADC_ACQ_PowerDown();
+  if (hdma_adc1.State == HAL_DMA_STATE_BUSY)
+  {
+    (void)HAL_DMA_Abort(&hdma_adc1);
+  }
+  AdcFrameHz = 0U;
+}
+
+/**
+  * @brief  Copy the latest decimated frame, one value per channel at 16-bit
+  *         full scale. Safe against the DMA interrupt updating it.
+  * @param  values: Receives ADC_AcqStatsTypeDef.Channels values
+  * @retval Outputs made since the last start; values is unchanged when 0
+  */
+uint32_t ADC_ACQ_Read(uint16_t *values)
+{
+  uint32_t seq;
+  uint32_t outputs;
+
+  do
+  {
+    seq = AdcSeq;
+    outputs = AdcOutputs;
+    if (outputs != 0U)
+    {
+      memcpy(values, AdcOut, AdcDec.Channels * sizeof(AdcOut[0]));
+    }
+  } while (((seq & 1U) != 0U) || (seq != AdcSeq));
+  return outputs;
+}
+
+/**
+  * @brief  Snapshot of the mode and counters.
+  * @param  stats: Filled in
+  * @retval None
+  */
+void ADC_ACQ_GetStats(ADC_AcqStatsTypeDef *stats)
+{
+  stats->Mode        = AdcMode;
+  stats->Channels    = (AdcMode != ADC_ACQ_STOPPED) ? AdcDec.Channels : 0U;
+  stats->FrameHz     = AdcFrameHz;
+  stats->Samples     = AdcSamples;
+  stats->Outputs     = AdcDec.Outputs;
+  stats->Overruns    = AdcRing.Overruns;
+  stats->AdcOverruns = AdcOverruns;
+  stats->DmaErrors   = AdcDmaErrors;
+}
+
+/**
+  * @brief  DVFS callback: refuse a point whose ADCCLK cannot keep up with
+  *         the scan, and note the new ADCCLK after a switch. TIM2 itself is
+  *         re-timed by POWER_AddTimer(). Register with POWER_Register().
+  * @retval DVFS_BUSY to veto the switch
+  */
+DVFS_StatusTypeDef ADC_ACQ_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                       const DVFS_PointTypeDef *point)
+{
+  uint32_t adcclk = DVFS_Pclk(point, 2U) / ADC_ACQ_ADCCLK_DIV;
+
+  (void)context;
+  if (event == DVFS_EV_PRE)
+  {
+    return ((AdcMode == ADC_ACQ_SCAN) && ((uint64_t)AdcFrameCycles * AdcFrameHz > adcclk)) ?
+           DVFS_BUSY : DVFS_OK;
+  }
+  AdcClockHz = adcclk;
+  return DVFS_OK;
+}
+
+/**
+  * @brief  ADC interrupt: a conversion was overwritten before the DMA took
+  *         it, and the ADC stopped requesting. Count it and restart; a scan
+  *         resumes at the next trigger.
+  * @retval None
+  */
+void ADC_ACQ_IRQHandler(void)
+{
+  ADC_TypeDef *const adcs[3] = {ADC1, ADC2, ADC3};
+  uint32_t overrun = 0U;
+  uint32_t i;
+
+  for (i = 0U; i < 3U; i++)
+  {
+    if ((adcs[i]->SR & ADC_SR_OVR) != 0U)
+    {
+      adcs[i]->SR = ~ADC_SR_OVR;
+      overrun = 1U;
+    }
+  }
+  if (overrun == 0U)
+  {
+    return;
+  }
+  AdcOverruns++;
+  if (AdcMode != ADC_ACQ_STOPPED)
+  {
+    (void)HAL_DMA_Abort(&hdma_adc1);
+    (void)ADC_ACQ_StartDma();
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Clocks, pins and interrupts for the ADCs, TIM2 and the DMA
+  *         stream.
+  * @retval None
+  */
+static void ADC_ACQ_MspInit(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+  uint32_t i;
+
+  __HAL_RCC_ADC1_CLK_ENABLE();
+  __HAL_RCC_ADC2_CLK_ENABLE();
+  __HAL_RCC_ADC3_CLK_ENABLE();
+  __HAL_RCC_TIM2_CLK_ENABLE();
+  __HAL_RCC_DMA2_CLK_ENABLE();
+  __HAL_RCC_GPIOC_CLK_ENABLE();
+
+  /**ADC GPIO Configuration
+  PC1     ------> ADC123_IN11
+  PC2     ------> ADC123_IN12
+  PC4     ------> ADC12_IN14
+  PC5     ------> ADC12_IN15
+  */
+  GPIO_InitStruct.Mode = GPIO_MODE_ANALOG;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  for (i = 0U; i < AdcAcqChannelCount; i++)
+  {
+    if (AdcAcqChannels[i].Port != NULL)
+    {
+      GPIO_InitStruct.Pin = AdcAcqChannels[i].Pin;
+      HAL_GPIO_Init(AdcAcqChannels[i].Port, &GPIO_InitStruct);
+    }
+  }
+
+  HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, ADC_ACQ_IRQ_PRIORITY, 0);
+  HAL_NVIC_SetPriority(ADC_IRQn, ADC_ACQ_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+  HAL_NVIC_EnableIRQ(ADC_IRQn);
+}
+
+/**
+  * @brief  Turn all three ADCs off and back to independent mode.
+  * @retval None
+  */
+static void ADC_ACQ_PowerDown(void)
+{
+  ADC1->CR2 = 0U;
+  ADC2->CR2 = 0U;
+  ADC3->CR2 = 0U;
+  ADC1->CR1 = 0U;
+  ADC2->CR1 = 0U;
+  ADC3->CR1 = 0U;
+  ADC->CCR = ADC_CCR_ADCPRE_0;
+}
+
+/**
+  * @brief  Set the DMA transfer size: halfwords from ADC1_DR for a scan,
+  *         words from ADC_CDR interleaved.
+  * @param  align: DMA_PDATAALIGN_HALFWORD or DMA_PDATAALIGN_WORD
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef ADC_ACQ_InitDma(uint32_t align)
+{
+  hdma_adc1.Init.PeriphDataAlignment = align;
+  hdma_adc1.Init.MemDataAlignment = (align == DMA_PDATAALIGN_WORD) ? DMA_MDATAALIGN_WORD : DMA_MDATAALIGN_HALFWORD;
+  return HAL_DMA_Init(&hdma_adc1);
+}
+
+/**
+  * @brief  Start the DMA on an empty ring and let the ADCs request; an
+  *         interleaved run is started here too.
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef ADC_ACQ_StartDma(void)
+{
+  uint32_t samples = 2U * AdcRing.HalfSamples;
+  HAL_StatusTypeDef status;
+
+  ADC_SCAN_RingInit(&AdcRing, AdcBuffer, AdcRing.HalfSamples);
+  if (AdcMode == ADC_ACQ_INTERLEAVED)
+  {
+    /* DMA must be cleared and set again to restart after an overrun */
+    ADC->CCR &= ~ADC_CCR_DMA;
+    status = HAL_DMA_Start_IT(&hdma_adc1, (uint32_t)&ADC->CDR, (uint32_t)AdcBuffer, samples / 2U);
+    if (status == HAL_OK)
+    {
+      ADC->CCR |= ADC_CCR_DMA_1;
+      ADC1->CR2 |= ADC_CR2_SWSTART;
+    }
+  }
+  else
+  {
+    ADC1->CR2 &= ~ADC_CR2_DMA;
+    status = HAL_DMA_Start_IT(&hdma_adc1, (uint32_t)&ADC1->DR, (uint32_t)AdcBuffer, samples);
+    if (status == HAL_OK)
+    {
+      ADC1->CR2 |= ADC_CR2_DMA | ADC_CR2_DDS | ADC_ACQ_CR2_TIM2;
+    }
+  }
+  return status;
+}
+
+/**
+  * @brief  Sample the DMA is writing, from the stream's remaining count.
+  * @retval Index into AdcBuffer
+  */
+static uint32_t ADC_ACQ_WriteSample(void)
+{
+  uint32_t samples = 2U * AdcRing.HalfSamples;
+  uint32_t left = __HAL_DMA_GET_COUNTER(&hdma_adc1);
+
+  if (AdcMode == ADC_ACQ_INTERLEAVED)
+  {
+    left *= 2U;
+  }
+  return (left >= samples) ? 0U : (samples - left);
+}
+
+/**
+  * @brief  A half is full: decimate every half ready, oldest first, and
+  *         publish the latest outputs.
+  * @param  half: 0 from the half-transfer event, 1 from transfer-complete
+  * @retval None
+  */
+static void ADC_ACQ_Process(uint32_t half)
+{
+  const uint16_t *samples;
+  uint32_t ready;
+  uint32_t made = 0U;
+
+  ADC_SCAN_HalfDone(&AdcRing, half);
+  AdcSamples += AdcRing.HalfSamples;
+  while ((samples = ADC_SCAN_Acquire(&AdcRing, &ready)) != NULL)
+  {
+    made += ADC_SCAN_Decimate(&AdcDec, samples, AdcRing.HalfSamples / AdcDec.Channels);
+    ADC_SCAN_Release(&AdcRing, ready, ADC_ACQ_WriteSample());
+  }
+  if (made != 0U)
+  {
+    AdcSeq++;
+    memcpy(AdcOut, AdcDec.Out, AdcDec.Channels * sizeof(AdcOut[0]));
+    AdcOutputs = AdcDec.Outputs;
+    AdcSeq++;
+  }
+}
+
+static void ADC_ACQ_HalfCplt(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+  ADC_ACQ_Process(0U);
+}
+
+static void ADC_ACQ_Cplt(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+  ADC_ACQ_Process(1U);
+}
+
+static void ADC_ACQ_Error(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+  AdcDmaErrors++;
+}
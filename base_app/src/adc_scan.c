@@ -0,0 +1,213 @@
+/**
+  ******************************************************************************
+  * @file    adc_scan.c
+  * @brief   Double buffer, decimating filter and timing for DMA-fed ADC scans.
+  ******************************************************************************
+  * The ring is the capture side of the audio ring: the DMA writes, the
+  * software reads. Ready[] bytes are written with single stores, so the DMA
+  * interrupt and a reader in another context need no lock. A half completed
+  * while still Ready means the reader fell behind a whole buffer; the other
+  * half then holds the older data and is taken first. A reader also learns
+  * it was too slow when, at release, the DMA is already writing into the
+  * half it was reading.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "adc_scan.h"
+#include <stddef.h>
+
+/* Private variables ---------------------------------------------------------*/
+/** ADC_SMPRx codes 0 to 7 in ADCCLK cycles */
+static const uint16_t AdcSampleCycles[8] = {3U, 15U, 28U, 56U, 84U, 112U, 144U, 480U};
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Attach a circular DMA buffer; nothing is ready until the DMA
+  *         completes a half.
+  * @param  ring: Ring instance
+  * @param  buffer: 2 * half_samples samples
+  * @param  half_samples: Samples per half
+  * @retval None
+  */
+void ADC_SCAN_RingInit(ADC_SCAN_RingTypeDef *ring, const uint16_t *buffer, uint32_t half_samples)
+{
+  ring->Buffer      = buffer;
+  ring->HalfSamples = half_samples;
+  ring->Ready[0]    = 0U;
+  ring->Ready[1]    = 0U;
+  ring->Next        = 0U;
+  ring->Overruns    = 0U;
+  ring->Halves      = 0U;
+}
+
+/**
+  * @brief  Called from the DMA half/full transfer interrupt: @p half is
+  *         full and the DMA moves on to the other one.
+  * @param  ring: Ring instance
+  * @param  half: 0 from the half-transfer event, 1 from transfer-complete
+  * @retval None
+  */
+void ADC_SCAN_HalfDone(ADC_SCAN_RingTypeDef *ring, uint32_t half)
+{
+  if (ring->Ready[half] != 0U)
+  {
+    /* Unread data overwritten: the other half is now the older one */
+    ring->Overruns++;
+    ring->Next = (uint8_t)(half ^ 1U);
+  }
+  ring->Ready[half] = 1U;
+}
+
+/**
+  * @brief  Get the oldest full half.
+  * @param  ring: Ring instance
+  * @param  half: Set to the half index on success
+  * @retval Pointer to the first sample of the half, or NULL if none is ready
+  */
+const uint16_t *ADC_SCAN_Acquire(ADC_SCAN_RingTypeDef *ring, uint32_t *half)
+{
+  uint32_t h = ring->Next;
+
+  if (ring->Ready[h] == 0U)
+  {
+    return NULL;
+  }
+  *half = h;
+  return &ring->Buffer[h * ring->HalfSamples];
+}
+
+/**
+  * @brief  Give a half back to the DMA once its samples are used.
+  * @param  ring: Ring instance
+  * @param  half: Half returned by ADC_SCAN_Acquire
+  * @param  write_sample: Sample the DMA is writing right now
+  *         (0..2*HalfSamples-1). If it already points into @p half, part of
+  *         what was read had been overwritten.
+  * @retval None
+  */
+void ADC_SCAN_Release(ADC_SCAN_RingTypeDef *ring, uint32_t half, uint32_t write_sample)
+{
+  if ((write_sample / ring->HalfSamples) == half)
+  {
+    ring->Overruns++;
+  }
+  ring->Ready[half] = 0U;
+  ring->Next = (uint8_t)(half ^ 1U);
+  ring->Halves++;
+}
+
+/**
+  * @brief  Set up a decimator with all sums cleared.
+  * @param  dec: Decimator
+  * @param  channels: Samples per frame, 1 to ADC_SCAN_MAX_CHANNELS
+  * @param  ratio: Frames per output, 1 to ADC_SCAN_MAX_RATIO
+  * @retval ADC_SCAN_INVALID for a size out of range
+  */
+ADC_SCAN_StatusTypeDef ADC_SCAN_DecimatorInit(ADC_SCAN_DecimatorTypeDef *dec, uint32_t channels, uint32_t ratio)
+{
+  uint32_t i;
+
+  if ((channels == 0U) || (channels > ADC_SCAN_MAX_CHANNELS) || (ratio == 0U) || (ratio > ADC_SCAN_MAX_RATIO))
+  {
+    return ADC_SCAN_INVALID;
+  }
+  dec->Channels = channels;
+  dec->Ratio    = ratio;
+  dec->Count    = 0U;
+  dec->Outputs  = 0U;
+  for (i = 0U; i < ADC_SCAN_MAX_CHANNELS; i++)
+  {
+    dec->Sum[i] = 0U;
+    dec->Out[i] = 0U;
+  }
+  return ADC_SCAN_OK;
+}
+
+/**
+  * @brief  Run frames through the decimator. Every Ratio frames Out[] gets
+  *         the means, (sum << ADC_SCAN_OUT_SHIFT) / Ratio rounded, and
+  *         the sums restart.
+  * @param  dec: Decimator
+  * @param  samples: frames * Channels samples, right-aligned 12-bit
+  * @param  frames: Whole frames only
+  * @retval Outputs made by this call
+  */
+uint32_t ADC_SCAN_Decimate(ADC_SCAN_DecimatorTypeDef *dec, const uint16_t *samples, uint32_t frames)
+{
+  uint32_t channels = dec->Channels;
+  uint32_t count = dec->Count;
+  uint32_t made = 0U;
+  uint32_t ch;
+
+  while (frames-- > 0U)
+  {
+    for (ch = 0U; ch < channels; ch++)
+    {
+      dec->Sum[ch] += *samples++;
+    }
+    if (++count == dec->Ratio)
+    {
+      for (ch = 0U; ch < channels; ch++)
+      {
+        dec->Out[ch] = (uint16_t)((((uint64_t)dec->Sum[ch] << ADC_SCAN_OUT_SHIFT) + (dec->Ratio / 2U)) /
+                                  dec->Ratio);
+        dec->Sum[ch] = 0U;
+      }
+      count = 0U;
+      dec->Outputs++;
+      made++;
+    }
+  }
+  dec->Count = count;
+  return made;
+}
+
+/**
+  * @brief  Sampling time of an ADC_SMPRx code.
+  * @param  smp: Code, 0 to 7
+  * @retval ADCCLK cycles, 0 for an invalid code
+  */
+uint32_t ADC_SCAN_SampleCycles(uint32_t smp)
+{
+  return (smp < 8U) ? AdcSampleCycles[smp] : 0U;
+}
+
+/**
+  * @brief  ADCCLK cycles one scan of a sequence takes: sampling plus
+  *         conversion for each channel. A trigger must not come sooner.
+  * @param  smp: ADC_SMPRx code per channel
+  * @param  channels: Sequence length
+  * @retval Cycles, 0 if a code is invalid
+  */
+uint32_t ADC_SCAN_FrameCycles(const uint8_t *smp, uint32_t channels)
+{
+  uint32_t cycles = 0U;
+  uint32_t i;
+
+  for (i = 0U; i < channels; i++)
+  {
+    if (smp[i] >= 8U)
+    {
+      return 0U;
+    }
+    cycles += AdcSampleCycles[smp[i]] + ADC_SCAN_CONV_CYCLES;
+  }
+  return cycles;
+}
+
+/**
+  * @brief  Sustained rate from a sample count over a time window.
+  * @param  samples: Samples taken in the window
+  * @param  ms: Window length
+  * @retval Samples per second, rounded; 0 for an empty window
+  */
+uint32_t ADC_SCAN_Rate(uint32_t samples, uint32_t ms)
+{
+  if (ms == 0U)
+  {
+    return 0U;
+  }
+  return (uint32_t)(((uint64_t)samples * 1000U + ms / 2U) / ms);
+}
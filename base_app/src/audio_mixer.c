@@ -0,0 +1,488 @@
+/**
+  ******************************************************************************
+  * @file    audio_mixer.c
+  * @brief   Portable PCM mixer, resampler and DMA double-buffer bookkeeping
+  ******************************************************************************
+  * The mixer renders any number of PCM clips (mono or stereo, any native
+  * rate) into interleaved 16-bit stereo at the I2S output rate. Rate
+  * conversion is linear interpolation. The read position advances by the
+  * exact ratio SampleRate / OutRate (integer step plus a remainder counted
+  * in 1/OutRate units), so long clips do not drift the way a truncated
+  * fixed-point step would. It is cheap enough to run from the DMA
+  * half-transfer interrupt.
+  *
+  * The ring keeps track of which half of the circular DMA buffer is owned by
+  * software and counts every half the DMA had to replay because it was not
+  * refilled in time.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "audio_mixer.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define WAV_FORMAT_PCM        1U
+
+/* Ring half states */
+#define RING_OWNED_BY_DMA     0U  /* Filled, waiting to be played             */
+#define RING_PENDING          1U  /* Played, waiting for the software         */
+#define RING_REPLAYED         2U  /* Played again before it was refilled      */
+
+/* I2S master clock is 256 * Fs, prescaler range is 2..255 (x2 + odd) */
+#define I2S_MCLK_RATIO        256U
+#define I2S_DIV_MIN           4U
+#define I2S_DIV_MAX           511U
+
+/* PLLI2S limits from the STM32F407 reference manual */
+#define PLLI2S_VCO_MIN        100000000U
+#define PLLI2S_VCO_MAX        432000000U
+#define PLLI2S_N_MIN          50U
+#define PLLI2S_N_MAX          432U
+#define PLLI2S_R_MIN          2U
+#define PLLI2S_R_MAX          7U
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t ReadLE32(const uint8_t *p);
+static uint16_t ReadLE16(const uint8_t *p);
+CODE_FAST static int16_t Saturate16(int32_t value, uint32_t *clipped);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Describe a RIFF/WAVE image as a playable source.
+  *         Only uncompressed 16-bit mono or stereo PCM is accepted.
+  * @param  data: Start of the WAV image (must be 2-byte aligned)
+  * @param  size: Size of the image in bytes
+  * @param  source: Filled in on success
+  * @retval AUDIO_OK if the image is usable
+  */
+CODE_COLD AUDIO_StatusTypeDef AUDIO_WAV_Parse(const uint8_t *data, uint32_t size, AUDIO_SourceTypeDef *source)
+{
+  uint32_t offset = 12U;
+  uint16_t channels = 0U;
+  uint16_t bits = 0U;
+  uint32_t rate = 0U;
+  uint8_t  have_fmt = 0U;
+
+  if ((data == NULL) || (source == NULL) || (size < 12U))
+  {
+    return AUDIO_ERROR;
+  }
+  if ((memcmp(data, "RIFF", 4U) != 0) || (memcmp(data + 8, "WAVE", 4U) != 0))
+  {
+    return AUDIO_ERROR;
+  }
+
+  while (offset + 8U <= size)
+  {
+    const uint8_t *chunk = data + offset;
+    uint32_t chunk_size = ReadLE32(chunk + 4);
+
+    if (chunk_size > size - offset - 8U)
+    {
+      return AUDIO_ERROR;
+    }
+
+    if (memcmp(chunk, "fmt ", 4U) == 0)
+    {
+      if (chunk_size < 16U || ReadLE16(chunk + 8) != WAV_FORMAT_PCM)
+      {
+        return AUDIO_ERROR;
+      }
+      channels = ReadLE16(chunk + 10);
+      rate     = ReadLE32(chunk + 12);
+      bits     = ReadLE16(chunk + 22);
+      have_fmt = 1U;
+    }
+    else if (memcmp(chunk, "data", 4U) == 0)
+    {
+      if (!have_fmt || bits != 16U || channels < 1U || channels > 2U || rate == 0U)
+      {
+        return AUDIO_ERROR;
+      }
+      source->Samples    = (const int16_t *)(const void *)(chunk + 8);
+      source->Channels   = (uint8_t)channels;
+      source->SampleRate = rate;
+      source->Frames     = chunk_size / (2U * channels);
+      return AUDIO_OK;
+    }
+
+    /* Chunks are padded to an even length */
+    offset += 8U + chunk_size + (chunk_size & 1U);
+  }
+
+  return AUDIO_ERROR;
+}
+
+/**
+  * @brief  Reset the mixer, all voices stopped.
+  * @param  mixer: Mixer instance
+  * @param  out_rate: Output sample rate in Hz
+  * @retval None
+  */
+void AUDIO_Mixer_Init(AUDIO_MixerTypeDef *mixer, uint32_t out_rate)
+{
+  memset(mixer, 0, sizeof(*mixer));
+  mixer->OutRate = out_rate;
+  mixer->PhaseScale = (out_rate != 0U) ? (uint32_t)(((uint64_t)1U << 32) / out_rate) : 0U;
+}
+
+/**
+  * @brief  Start playing a clip on the first free voice.
+  * @param  mixer: Mixer instance
+  * @param  source: Clip to play, must stay valid while the voice is active
+  * @param  gain: Linear gain in Q15 (AUDIO_GAIN_UNITY for 0 dB)
+  * @param  loop: Non-zero to restart the clip when it ends
+  * @retval Voice index, or -1 if the clip is invalid or no voice is free
+  */
+int32_t AUDIO_Mixer_Play(AUDIO_MixerTypeDef *mixer, const AUDIO_SourceTypeDef *source, int32_t gain, uint8_t loop)
+{
+  uint32_t i;
+
+  if ((source == NULL) || (source->Frames == 0U) || (source->SampleRate == 0U) ||
+      (source->Channels < 1U) || (source->Channels > 2U) || (mixer->OutRate == 0U))
+  {
+    return -1;
+  }
+
+  for (i = 0U; i < AUDIO_MIXER_MAX_VOICES; i++)
+  {
+    AUDIO_VoiceTypeDef *voice = &mixer->Voice[i];
+
+    if (!voice->Active)
+    {
+      voice->Source   = source;
+      voice->Position = 0U;
+      voice->Phase    = 0U;
+      voice->StepInt  = source->SampleRate / mixer->OutRate;
+      voice->StepRem  = source->SampleRate % mixer->OutRate;
+      voice->Gain     = gain;
+      voice->Loop     = loop;
+      /* Publish last so an interrupt-driven render never sees half a voice */
+      voice->Active   = 1U;
+      return (int32_t)i;
+    }
+  }
+
+  return -1;
+}
+
+/**
+  * @brief  Stop a voice returned by AUDIO_Mixer_Play.
+  * @param  mixer: Mixer instance
+  * @param  voice: Voice index
+  * @retval None
+  */
+void AUDIO_Mixer_Stop(AUDIO_MixerTypeDef *mixer, int32_t voice)
+{
+  if ((voice >= 0) && ((uint32_t)voice < AUDIO_MIXER_MAX_VOICES))
+  {
+    mixer->Voice[voice].Active = 0U;
+  }
+}
+
+/**
+  * @brief  Number of voices still playing.
+  * @param  mixer: Mixer instance
+  * @retval Active voice count
+  */
+uint32_t AUDIO_Mixer_ActiveVoices(const AUDIO_MixerTypeDef *mixer)
+{
+  uint32_t i;
+  uint32_t count = 0U;
+
+  for (i = 0U; i < AUDIO_MIXER_MAX_VOICES; i++)
+  {
+    count += mixer->Voice[i].Active ? 1U : 0U;
+  }
+  return count;
+}
+
+/**
+  * @brief  Render interleaved stereo frames from all active voices.
+  *         Mono clips are copied to both channels. Silence is written when
+  *         nothing is playing so the output buffer is always fully defined.
+  * @param  mixer: Mixer instance
+  * @param  out: Destination, 2 * frames samples
+  * @param  frames: Number of stereo frames to produce
+  * @retval None
+  */
+CODE_FAST void AUDIO_Mixer_Render(AUDIO_MixerTypeDef *mixer, int16_t *out, uint32_t frames)
+{
+  uint32_t f;
+  uint32_t i;
+
+  for (f = 0U; f < frames; f++)
+  {
+    int32_t left = 0;
+    int32_t right = 0;
+
+    for (i = 0U; i < AUDIO_MIXER_MAX_VOICES; i++)
+    {
+      AUDIO_VoiceTypeDef *voice = &mixer->Voice[i];
+      const AUDIO_SourceTypeDef *src;
+      const int16_t *s0;
+      const int16_t *s1;
+      uint32_t next;
+      int32_t frac;
+      int32_t l;
+      int32_t r;
+
+      if (!voice->Active)
+      {
+        continue;
+      }
+      src = voice->Source;
+
+      /* Interpolate between the current frame and the next one */
+      next = voice->Position + 1U;
+      if (next >= src->Frames)
+      {
+        next = voice->Loop ? 0U : voice->Position;
+      }
+      s0 = &src->Samples[voice->Position * src->Channels];
+      s1 = &src->Samples[next * src->Channels];
+      frac = (int32_t)(((uint64_t)voice->Phase * mixer->PhaseScale) >> 17);
+
+      l = s0[0] + ((((int32_t)s1[0] - s0[0]) * frac) >> 15);
+      if (src->Channels == 2U)
+      {
+        r = s0[1] + ((((int32_t)s1[1] - s0[1]) * frac) >> 15);
+      }
+      else
+      {
+        r = l;
+      }
+
+      left  += (l * voice->Gain) >> 15;
+      right += (r * voice->Gain) >> 15;
+
+      /* Advance the read position */
+      voice->Position += voice->StepInt;
+      voice->Phase    += voice->StepRem;
+      if (voice->Phase >= mixer->OutRate)
+      {
+        voice->Phase -= mixer->OutRate;
+        voice->Position++;
+      }
+      if (voice->Position >= src->Frames)
+      {
+        if (voice->Loop)
+        {
+          voice->Position %= src->Frames;
+        }
+        else
+        {
+          voice->Active = 0U;
+        }
+      }
+    }
+
+    out[2U * f]      = Saturate16(left, &mixer->Clipped);
+    out[2U * f + 1U] = Saturate16(right, &mixer->Clipped);
+  }
+}
+
+/**
+  * @brief  Attach a circular DMA buffer. Both halves start out owned by the
+  *         software, so they must be rendered before the DMA is started.
+  * @param  ring: Ring instance
+  * @param  buffer: 4 * half_frames samples (two halves of stereo frames)
+  * @param  half_frames: Frames per half
+  * @retval None
+  */
+void AUDIO_Ring_Init(AUDIO_RingTypeDef *ring, int16_t *buffer, uint32_t half_frames)
+{
+  ring->Buffer     = buffer;
+  ring->HalfFrames = half_frames;
+  ring->State[0]   = RING_PENDING;
+  ring->State[1]   = RING_PENDING;
+  ring->Last       = 0U;
+  ring->Underruns  = 0U;
+  ring->Fills      = 0U;
+}
+
+/**
+  * @brief  Called from the DMA half/full transfer interrupt: the DMA has
+  *         finished reading @p half and starts on the other one.
+  *         Each State[] byte is written with a single store, so the
+  *         interrupt and the thread filling the buffer need no lock.
+  * @param  ring: Ring instance
+  * @param  half: 0 from the half-transfer event, 1 from transfer-complete
+  * @retval None
+  */
+CODE_HOT void AUDIO_Ring_HalfDone(AUDIO_RingTypeDef *ring, uint32_t half)
+{
+  uint32_t next = half ^ 1U;
+
+  /* The DMA is about to play a half nobody refilled */
+  if (ring->State[next] != RING_OWNED_BY_DMA)
+  {
+    ring->Underruns++;
+    ring->State[next] = RING_REPLAYED;
+  }
+  ring->State[half] = RING_PENDING;
+  ring->Last = (uint8_t)(half + 1U);
+}
+
+/**
+  * @brief  Get the half the software should fill next.
+  *         This is the half the DMA left most recently, i.e. the one with the
+  *         most time until it is played again.
+  * @param  ring: Ring instance
+  * @param  half: Set to the half index on success
+  * @retval Pointer to the first sample of the half, or NULL if nothing to do
+  */
+CODE_HOT int16_t *AUDIO_Ring_Acquire(AUDIO_RingTypeDef *ring, uint32_t *half)
+{
+  uint32_t last = ring->Last;
+  uint32_t h;
+
+  if (last == 0U)
+  {
+    /* DMA not started yet: prime half 0 first, then half 1 */
+    h = (ring->State[0] != RING_OWNED_BY_DMA) ? 0U : 1U;
+  }
+  else
+  {
+    h = last - 1U;
+  }
+
+  if (ring->State[h] == RING_OWNED_BY_DMA)
+  {
+    return NULL;
+  }
+
+  *half = h;
+  return &ring->Buffer[h * ring->HalfFrames * AUDIO_OUT_CHANNELS];
+}
+
+/**
+  * @brief  Hand a refilled half back to the DMA.
+  * @param  ring: Ring instance
+  * @param  half: Half returned by AUDIO_Ring_Acquire
+  * @param  read_frame: Frame the DMA is reading right now (0..2*HalfFrames-1).
+  *         If it already points into @p half the data came too late.
+  * @retval None
+  */
+CODE_HOT void AUDIO_Ring_Commit(AUDIO_RingTypeDef *ring, uint32_t half, uint32_t read_frame)
+{
+  /* A replayed half was already counted by AUDIO_Ring_HalfDone */
+  if ((ring->State[half] == RING_PENDING) && (ring->Last != 0U) &&
+      ((read_frame / ring->HalfFrames) == half))
+  {
+    ring->Underruns++;
+  }
+
+  ring->State[half] = RING_OWNED_BY_DMA;
+  ring->Fills++;
+}
+
+/**
+  * @brief  Output latency added by the double buffer.
+  * @param  ring: Ring instance
+  * @param  rate: Output sample rate in Hz
+  * @retval Buffer depth in microseconds
+  */
+uint32_t AUDIO_Ring_LatencyUs(const AUDIO_RingTypeDef *ring, uint32_t rate)
+{
+  if (rate == 0U)
+  {
+    return 0U;
+  }
+  return (uint32_t)(((uint64_t)ring->HalfFrames * 2U * 1000000U) / rate);
+}
+
+/**
+  * @brief  Search PLLI2SN/PLLI2SR and the I2S prescaler for a sample rate.
+  *         The master clock output is assumed enabled (MCLK = 256 * Fs), as
+  *         the CS43L22 needs it.
+  * @param  pll_in_hz: PLL input clock after the shared M divider (1-2 MHz)
+  * @param  rate: Requested sample rate in Hz
+  * @param  clock: Best settings found
+  * @retval AUDIO_OK if the rate can be reached within 0.1 %
+  */
+CODE_COLD AUDIO_StatusTypeDef AUDIO_I2S_SolveClock(uint32_t pll_in_hz, uint32_t rate, AUDIO_ClockTypeDef *clock)
+{
+  uint64_t best_err = UINT64_MAX;
+  uint32_t n;
+  uint32_t r;
+
+  if ((rate == 0U) || (pll_in_hz == 0U))
+  {
+    return AUDIO_ERROR;
+  }
+
+  for (n = PLLI2S_N_MIN; n <= PLLI2S_N_MAX; n++)
+  {
+    uint64_t vco = (uint64_t)pll_in_hz * n;
+
+    if ((vco < PLLI2S_VCO_MIN) || (vco > PLLI2S_VCO_MAX))
+    {
+      continue;
+    }
+
+    for (r = PLLI2S_R_MIN; r <= PLLI2S_R_MAX; r++)
+    {
+      uint64_t i2sclk = vco / r;
+      uint64_t div = (i2sclk + (uint64_t)I2S_MCLK_RATIO * rate / 2U) / ((uint64_t)I2S_MCLK_RATIO * rate);
+      uint64_t actual_mhz;
+      uint64_t err;
+
+      if ((div < I2S_DIV_MIN) || (div > I2S_DIV_MAX))
+      {
+        continue;
+      }
+
+      /* Compare in milli-Hz so near-equal candidates are ranked correctly */
+      actual_mhz = (i2sclk * 1000U) / (I2S_MCLK_RATIO * div);
+      err = (actual_mhz > (uint64_t)rate * 1000U) ? actual_mhz - (uint64_t)rate * 1000U
+                                                  : (uint64_t)rate * 1000U - actual_mhz;
+      if (err < best_err)
+      {
+        best_err = err;
+        clock->PLLI2SN    = n;
+        clock->PLLI2SR    = r;
+        clock->I2SDIV     = (uint32_t)(div / 2U);
+        clock->I2SODD     = (uint32_t)(div & 1U);
+        clock->ActualRate = (uint32_t)((actual_mhz + 500U) / 1000U);
+      }
+    }
+  }
+
+  /* Accept up to 0.1 % deviation */
+  if (best_err > (uint64_t)rate)
+  {
+    return AUDIO_ERROR;
+  }
+  return AUDIO_OK;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t ReadLE32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t ReadLE16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+CODE_FAST static int16_t Saturate16(int32_t value, uint32_t *clipped)
+{
+  if (value > INT16_MAX)
+  {
+    (*clipped)++;
+    return INT16_MAX;
+  }
+  if (value < INT16_MIN)
+  {
+    (*clipped)++;
+    return INT16_MIN;
+  }
+  return (int16_t)value;
+}
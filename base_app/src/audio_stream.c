@@ -0,0 +1,285 @@
+/**
+  ******************************************************************************
+  * @file    audio_stream.c
+  * @brief   Continuous I2S3 output to the CS43L22 codec fed by circular DMA.
+  ******************************************************************************
+  * Data path on the STM32F4-Discovery:
+  *
+  *   mixer -> ping-pong buffer -> DMA1 Stream5 ch0 (circular) -> SPI3/I2S3
+  *
+  *   PC7  I2S3_MCK    PC10 I2S3_CK    PC12 I2S3_SD    PA4 I2S3_WS
+  *   PD4  codec RESET (active low)
+  *
+  * The half-transfer and transfer-complete interrupts hand the half the DMA
+  * just left back to the software, which renders the next block into it
+  * while the DMA plays the other half. There is no HAL I2S driver in this
+  * tree, so the SPI3 peripheral is programmed directly; DMA and the PLLI2S
+  * go through the HAL.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "audio_stream.h"
+
+/* Private define ------------------------------------------------------------*/
+#define AUDIO_BUFFER_SAMPLES  (2U * AUDIO_STREAM_HALF_FRAMES * AUDIO_OUT_CHANNELS)
+
+/* Private variables ---------------------------------------------------------*/
+DMA_HandleTypeDef hdma_spi3_tx;
+
+static int16_t            AudioBuffer[AUDIO_BUFFER_SAMPLES];
+static AUDIO_RingTypeDef  AudioRing;
+static AUDIO_MixerTypeDef AudioMixer;
+static uint32_t           AudioRate;
+static volatile uint32_t  AudioDmaErrors;
+
+/* Private function prototypes -----------------------------------------------*/
+static void     AUDIO_STREAM_MspInit(void);
+static uint32_t AUDIO_STREAM_PllInputHz(void);
+static uint32_t AUDIO_STREAM_ReadFrame(void);
+static void     AUDIO_STREAM_HalfCplt(DMA_HandleTypeDef *hdma);
+static void     AUDIO_STREAM_Cplt(DMA_HandleTypeDef *hdma);
+static void     AUDIO_STREAM_Error(DMA_HandleTypeDef *hdma);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Configure PLLI2S, I2S3 and the TX DMA for a sample rate.
+  *         The stream is left stopped; both buffer halves are pre-rendered.
+  * @param  sample_rate: Output sample rate in Hz
+  * @retval HAL status
+  */
+HAL_StatusTypeDef AUDIO_STREAM_Init(uint32_t sample_rate)
+{
+  RCC_PeriphCLKInitTypeDef PeriphClkInit = {0};
+  AUDIO_ClockTypeDef clock;
+  uint32_t half;
+  int16_t *block;
+
+  if (AUDIO_I2S_SolveClock(AUDIO_STREAM_PllInputHz(), sample_rate, &clock) != AUDIO_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  /* I2S clock from PLLI2S */
+  PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_I2S;
+  PeriphClkInit.PLLI2S.PLLI2SN = clock.PLLI2SN;
+  PeriphClkInit.PLLI2S.PLLI2SR = clock.PLLI2SR;
+  if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  AUDIO_STREAM_MspInit();
+
+  /* I2S3 master transmit, Philips standard, 16-bit data in 16-bit frames */
+  SPI3->I2SCFGR = 0U;
+  SPI3->I2SPR   = clock.I2SDIV | (clock.I2SODD ? SPI_I2SPR_ODD : 0U) | SPI_I2SPR_MCKOE;
+  SPI3->I2SCFGR = SPI_I2SCFGR_I2SMOD | SPI_I2SCFGR_I2SCFG_1;
+  SPI3->CR2     = SPI_CR2_TXDMAEN;
+
+  /* DMA1 Stream5 channel 0 is SPI3_TX */
+  hdma_spi3_tx.Instance = DMA1_Stream5;
+  hdma_spi3_tx.Init.Channel = DMA_CHANNEL_0;
+  hdma_spi3_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_spi3_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_spi3_tx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_spi3_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_spi3_tx.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  hdma_spi3_tx.Init.Mode = DMA_CIRCULAR;
+  hdma_spi3_tx.Init.Priority = DMA_PRIORITY_HIGH;
+  hdma_spi3_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_spi3_tx) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  hdma_spi3_tx.XferHalfCpltCallback = AUDIO_STREAM_HalfCplt;
+  hdma_spi3_tx.XferCpltCallback = AUDIO_STREAM_Cplt;
+  hdma_spi3_tx.XferErrorCallback = AUDIO_STREAM_Error;
+
+  AudioRate = clock.ActualRate;
+  AudioDmaErrors = 0U;
+  AUDIO_Mixer_Init(&AudioMixer, AudioRate);
+  AUDIO_Ring_Init(&AudioRing, AudioBuffer, AUDIO_STREAM_HALF_FRAMES);
+
+  /* Prime both halves so the first DMA pass plays defined data */
+  while ((block = AUDIO_Ring_Acquire(&AudioRing, &half)) != NULL)
+  {
+    AUDIO_Mixer_Render(&AudioMixer, block, AUDIO_STREAM_HALF_FRAMES);
+    AUDIO_Ring_Commit(&AudioRing, half, 0U);
+  }
+
+  AUDIO_STREAM_CodecConfig(AudioRate);
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  Start the circular DMA and the I2S clocks.
+  * @retval HAL status
+  */
+HAL_StatusTypeDef AUDIO_STREAM_Start(void)
+{
+  if (HAL_DMA_Start_IT(&hdma_spi3_tx, (uint32_t)AudioBuffer, (uint32_t)&SPI3->DR,
+                       AUDIO_BUFFER_SAMPLES) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  SPI3->I2SCFGR |= SPI_I2SCFGR_I2SE;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Stop the I2S clocks and the DMA.
+  * @retval None
+  */
+void AUDIO_STREAM_Stop(void)
+{
+  SPI3->I2SCFGR &= ~SPI_I2SCFGR_I2SE;
+  (void)HAL_DMA_Abort(&hdma_spi3_tx);
+}
+
+/**
+  * @brief  Render the half buffer the DMA released, if any.
+  *         Called from the DMA interrupt when AUDIO_STREAM_FILL_IN_ISR is set,
+  *         otherwise it must be polled at least once per half buffer.
+  * @retval None
+  */
+CODE_HOT void AUDIO_STREAM_Process(void)
+{
+  uint32_t half;
+  int16_t *block = AUDIO_Ring_Acquire(&AudioRing, &half);
+
+  if (block != NULL)
+  {
+    AUDIO_Mixer_Render(&AudioMixer, block, AUDIO_STREAM_HALF_FRAMES);
+    AUDIO_Ring_Commit(&AudioRing, half, AUDIO_STREAM_ReadFrame());
+  }
+}
+
+/**
+  * @brief  Mixer feeding the stream, to start and stop clips on.
+  * @retval Mixer instance
+  */
+AUDIO_MixerTypeDef *AUDIO_STREAM_GetMixer(void)
+{
+  return &AudioMixer;
+}
+
+/**
+  * @brief  Snapshot of the stream counters.
+  * @param  stats: Filled in
+  * @retval None
+  */
+void AUDIO_STREAM_GetStats(AUDIO_StreamStatsTypeDef *stats)
+{
+  stats->SampleRate = AudioRate;
+  stats->LatencyUs  = AUDIO_Ring_LatencyUs(&AudioRing, AudioRate);
+  stats->Underruns  = AudioRing.Underruns;
+  stats->Fills      = AudioRing.Fills;
+  stats->Clipped    = AudioMixer.Clipped;
+  stats->DmaErrors  = AudioDmaErrors;
+}
+
+/**
+  * @brief  Program the codec for the new stream over its control bus.
+  * @note   The default only releases the codec from reset; the board layer
+  *         overrides it with the CS43L22 register sequence.
+  * @param  sample_rate: Rate the I2S clock runs at
+  * @retval None
+  */
+__weak void AUDIO_STREAM_CodecConfig(uint32_t sample_rate)
+{
+  UNUSED(sample_rate);
+  HAL_GPIO_WritePin(GPIOD, GPIO_PIN_4, GPIO_PIN_SET);
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Clocks, pins and interrupt for I2S3 and its DMA stream.
+  * @retval None
+  */
+static void AUDIO_STREAM_MspInit(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  __HAL_RCC_SPI3_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  __HAL_RCC_GPIOC_CLK_ENABLE();
+  __HAL_RCC_GPIOD_CLK_ENABLE();
+
+  /**I2S3 GPIO Configuration
+  PA4     ------> I2S3_WS
+  PC7     ------> I2S3_MCK
+  PC10    ------> I2S3_CK
+  PC12    ------> I2S3_SD
+  */
+  GPIO_InitStruct.Pin = GPIO_PIN_4;
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+  GPIO_InitStruct.Alternate = GPIO_AF6_SPI3;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+  GPIO_InitStruct.Pin = GPIO_PIN_7|GPIO_PIN_10|GPIO_PIN_12;
+  HAL_GPIO_Init(GPIOC, &GPIO_InitStruct);
+
+  /* Codec held in reset until AUDIO_STREAM_CodecConfig */
+  HAL_GPIO_WritePin(GPIOD, GPIO_PIN_4, GPIO_PIN_RESET);
+  GPIO_InitStruct.Pin = GPIO_PIN_4;
+  GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+  GPIO_InitStruct.Alternate = 0U;
+  HAL_GPIO_Init(GPIOD, &GPIO_InitStruct);
+
+  HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, AUDIO_STREAM_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+}
+
+/**
+  * @brief  Main PLL input frequency (after /M), shared with PLLI2S.
+  * @retval Frequency in Hz
+  */
+static uint32_t AUDIO_STREAM_PllInputHz(void)
+{
+  uint32_t pllm = RCC->PLLCFGR & RCC_PLLCFGR_PLLM;
+  uint32_t source = ((RCC->PLLCFGR & RCC_PLLCFGR_PLLSRC) != 0U) ? HSE_VALUE : HSI_VALUE;
+
+  return (pllm != 0U) ? source / pllm : 0U;
+}
+
+/**
+  * @brief  Stereo frame the DMA is currently reading.
+  * @retval Frame index in the whole circular buffer
+  */
+CODE_HOT static uint32_t AUDIO_STREAM_ReadFrame(void)
+{
+  uint32_t remaining = __HAL_DMA_GET_COUNTER(&hdma_spi3_tx);
+
+  return ((AUDIO_BUFFER_SAMPLES - remaining) / AUDIO_OUT_CHANNELS) % (2U * AUDIO_STREAM_HALF_FRAMES);
+}
+
+CODE_HOT static void AUDIO_STREAM_HalfCplt(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+  AUDIO_Ring_HalfDone(&AudioRing, 0U);
+#if (AUDIO_STREAM_FILL_IN_ISR == 1U)
+  AUDIO_STREAM_Process();
+#endif
+}
+
+CODE_HOT static void AUDIO_STREAM_Cplt(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+  AUDIO_Ring_HalfDone(&AudioRing, 1U);
+#if (AUDIO_STREAM_FILL_IN_ISR == 1U)
+  AUDIO_STREAM_Process();
+#endif
+}
+
+static void AUDIO_STREAM_Error(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+  AudioDmaErrors++;
+}
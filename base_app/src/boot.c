@@ -0,0 +1,159 @@
+/**
+  ******************************************************************************
+  * @file    boot.c
+  * @brief   Boot phase timestamps and their breakdown.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "boot.h"
+#include <stddef.h>
+#include <stdio.h>
+
+/* Private variables ---------------------------------------------------------*/
+static const char *const BootPhaseNames[BOOT_PHASES] =
+{
+  "reset", "sysinit", "data", "bss", "main", "hal", "early", "clock", "periph", "ready"
+};
+
+_Static_assert(offsetof(BOOT_RecordTypeDef, Cycles) == BOOT_CYCLES_OFFSET,
+               "startup code stamps Cycles[] at BOOT_CYCLES_OFFSET");
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Open the record at the entry of main(). The stamps the startup
+  *         code already wrote are kept; they ran at the reset clock.
+  * @param  record: Boot record
+  * @param  cycles: Cycle counter now
+  * @param  hz: Core clock now, the one out of reset
+  * @retval None
+  */
+void BOOT_Start(BOOT_RecordTypeDef *record, uint32_t cycles, uint32_t hz)
+{
+  uint32_t i;
+
+  record->Magic = BOOT_MAGIC;
+  record->Cycles[BOOT_PH_RESET] = 0U;
+  for (i = BOOT_PH_RESET; i < BOOT_PH_MAIN; i++)
+  {
+    record->Hz[i] = hz;
+  }
+  record->Count = BOOT_PH_MAIN;
+  BOOT_Mark(record, BOOT_PH_MAIN, cycles, hz);
+}
+
+/**
+  * @brief  Stamp the end of a phase. Phases are stamped in order.
+  * @param  record: Boot record
+  * @param  phase: BOOT_PH_x
+  * @param  cycles: Cycle counter now
+  * @param  hz: Core clock now
+  * @retval None
+  */
+void BOOT_Mark(BOOT_RecordTypeDef *record, uint32_t phase, uint32_t cycles, uint32_t hz)
+{
+  if ((phase >= BOOT_PHASES) || (phase != record->Count))
+  {
+    return;
+  }
+  record->Cycles[phase] = cycles;
+  record->Hz[phase]     = hz;
+  record->Count         = phase + 1U;
+}
+
+/**
+  * @brief  Check a record left in RAM, e.g. read back over the debugger.
+  * @param  record: Boot record
+  * @retval 1 if it holds at least the stamps up to main()
+  */
+uint8_t BOOT_IsValid(const BOOT_RecordTypeDef *record)
+{
+  uint32_t i;
+
+  if ((record->Magic != BOOT_MAGIC) || (record->Count <= BOOT_PH_MAIN) || (record->Count > BOOT_PHASES))
+  {
+    return 0U;
+  }
+  for (i = 1U; i < record->Count; i++)
+  {
+    if ((record->Hz[i - 1U] == 0U) || (record->Cycles[i] < record->Cycles[i - 1U]))
+    {
+      return 0U;
+    }
+  }
+  return 1U;
+}
+
+/**
+  * @brief  Duration of one phase.
+  * @param  record: Boot record
+  * @param  phase: BOOT_PH_x, stamped
+  * @retval Microseconds, 0 for BOOT_PH_RESET or a phase not stamped
+  */
+uint32_t BOOT_PhaseUs(const BOOT_RecordTypeDef *record, uint32_t phase)
+{
+  uint32_t cycles;
+
+  if ((phase == BOOT_PH_RESET) || (phase >= record->Count) || (record->Hz[phase - 1U] == 0U))
+  {
+    return 0U;
+  }
+  cycles = record->Cycles[phase] - record->Cycles[phase - 1U];
+  return (uint32_t)(((uint64_t)cycles * 1000000U) / record->Hz[phase - 1U]);
+}
+
+/**
+  * @brief  Time from reset to the end of a phase.
+  * @param  record: Boot record
+  * @param  phase: BOOT_PH_x, stamped
+  * @retval Microseconds
+  */
+uint32_t BOOT_TotalUs(const BOOT_RecordTypeDef *record, uint32_t phase)
+{
+  uint32_t total = 0U;
+  uint32_t i;
+
+  for (i = 1U; (i <= phase) && (i < record->Count); i++)
+  {
+    total += BOOT_PhaseUs(record, i);
+  }
+  return total;
+}
+
+/**
+  * @brief  Name of a phase.
+  * @param  phase: BOOT_PH_x
+  * @retval Static string
+  */
+const char *BOOT_PhaseName(uint32_t phase)
+{
+  return (phase < BOOT_PHASES) ? BootPhaseNames[phase] : "?";
+}
+
+/**
+  * @brief  One line of the breakdown: phase, its duration and the time since
+  *         reset at its end, without line ending.
+  * @param  record: Boot record
+  * @param  phase: BOOT_PH_x, stamped
+  * @param  out: Output buffer, BOOT_LINE_MAX is enough
+  * @param  size: Size of out
+  * @retval Length written, excluding the terminator
+  */
+uint32_t BOOT_Format(const BOOT_RecordTypeDef *record, uint32_t phase, char *out, uint32_t size)
+{
+  int n;
+
+  if (size == 0U)
+  {
+    return 0U;
+  }
+  n = snprintf(out, size, "boot: %-8s %7lu us %8lu us", BOOT_PhaseName(phase),
+               (unsigned long)BOOT_PhaseUs(record, phase), (unsigned long)BOOT_TotalUs(record, phase));
+  if (n < 0)
+  {
+    out[0] = '\0';
+    return 0U;
+  }
+  return ((uint32_t)n < size) ? (uint32_t)n : (size - 1U);
+}
@@ -0,0 +1,98 @@
+/**
+  ******************************************************************************
+  * @file    boot_record.c
+  * @brief   Boot phase stamps, early PLL start and boot-time report.
+  ******************************************************************************
+  * Reset_Handler starts CYCCNT and stamps SystemInit, the .data copy and the
+  * .bss fill; main() stamps the rest with BOOT_RECORD_Mark(). The record
+  * sits in .noinit so the startup code may write it before .bss is cleared,
+  * and so "make boottime" can read it back over the debugger.
+  *
+  * BOOT_RECORD_StartClocks() turns the PLL on (HSE: the crystal) without
+  * waiting, so it locks while GPIO and TIM6 are set up from the reset clock;
+  * SystemClock_Config() then only waits for what is left of the lock.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "boot_record.h"
+#include "clock_config.h"
+#include <stdio.h>
+
+/* Private define ------------------------------------------------------------*/
+#define BOOT_RECORD_LINE_MAX  78U
+
+/* Private variables ---------------------------------------------------------*/
+/* Not cleared by the startup code, which writes it before .bss is zeroed */
+BOOT_RecordTypeDef BootRecord __attribute__((section(".noinit")));
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Open the record: first statement of main().
+  * @retval None
+  */
+void BOOT_RECORD_Start(void)
+{
+  BOOT_Start(&BootRecord, DWT->CYCCNT, SystemCoreClock);
+}
+
+/**
+  * @brief  Stamp the end of a boot phase.
+  * @param  phase: BOOT_PH_x, in order
+  * @retval None
+  */
+void BOOT_RECORD_Mark(uint32_t phase)
+{
+  BOOT_Mark(&BootRecord, phase, DWT->CYCCNT, SystemCoreClock);
+}
+
+/**
+  * @brief  Start the oscillators of clock_config.h without waiting for them.
+  *         The regulator scale is set first: it cannot change once the PLL
+  *         runs.
+  * @retval None
+  */
+void BOOT_RECORD_StartClocks(void)
+{
+  __HAL_RCC_PWR_CLK_ENABLE();
+  __HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE1);
+#if CLOCK_CONFIG_USE_HSE
+  /* The PLL input must be stable before PLLON; SystemClock_Config() starts it */
+  __HAL_RCC_HSE_CONFIG(RCC_HSE_ON);
+#else
+  __HAL_RCC_PLL_CONFIG(RCC_PLLSOURCE_HSI, CLOCK_CONFIG_PLLM, CLOCK_CONFIG_PLLN,
+                       CLOCK_CONFIG_PLLP, CLOCK_CONFIG_PLLQ);
+  __HAL_RCC_PLL_ENABLE();
+#endif
+}
+
+/**
+  * @brief  Print the boot-time breakdown, one line per phase stamped, and
+  *         the reset-to-main time.
+  * @param  huart: Initialised UART handle
+  * @retval None
+  */
+void BOOT_RECORD_Report(UART_HandleTypeDef *huart)
+{
+  char line[BOOT_RECORD_LINE_MAX + 2U];
+  uint32_t phase;
+  uint32_t len;
+  int n;
+
+  for (phase = BOOT_PH_SYSTEMINIT; phase < BootRecord.Count; phase++)
+  {
+    len = BOOT_Format(&BootRecord, phase, line, BOOT_RECORD_LINE_MAX);
+    line[len++] = '\r';
+    line[len++] = '\n';
+    (void)HAL_UART_Transmit(huart, (uint8_t *)line, (uint16_t)len, HAL_MAX_DELAY);
+  }
+
+  n = snprintf(line, BOOT_RECORD_LINE_MAX, "boot: reset to main %lu us, to ready %lu us",
+               (unsigned long)BOOT_TotalUs(&BootRecord, BOOT_PH_MAIN),
+               (unsigned long)BOOT_TotalUs(&BootRecord, BOOT_PH_READY));
+  len = (n < 0) ? 0U : (((uint32_t)n < BOOT_RECORD_LINE_MAX) ? (uint32_t)n : (BOOT_RECORD_LINE_MAX - 1U));
+  line[len++] = '\r';
+  line[len++] = '\n';
+  (void)HAL_UART_Transmit(huart, (uint8_t *)line, (uint16_t)len, HAL_MAX_DELAY);
+}
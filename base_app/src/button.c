@@ -0,0 +1,281 @@
+/**
+  ******************************************************************************
+  * @file    button.c
+  * @brief   Debounced push button gestures and their event queue.
+  ******************************************************************************
+  * A raw edge starts (or extends) a bounce; the pin is only read once it has
+  * been quiet for DebounceMs, and a level that differs from the debounced
+  * one is taken as a press or release at the time of the first edge of the
+  * bounce. Gesture timeouts that fall inside a bounce wait for it to settle,
+  * then run first if they came before that edge:
+  *
+  *   IDLE -press-> DOWN -release-> GAP -DoubleMs-> CLICK, IDLE
+  *                  |               |
+  *                  |             press-> DOWN2 -release-> DOUBLE_CLICK, IDLE
+  *                  |                       |
+  *                LongMs -> LONG_PRESS <- LongMs (CLICK first), HELD
+  *
+  *   HELD -release-> IDLE
+  *
+  * PRESS and RELEASE are posted on every debounced change as well.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "button.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BUTTON_MASK         (BUTTON_QUEUE_DEPTH - 1U)
+
+#define BUTTON_ST_IDLE      0U
+#define BUTTON_ST_DOWN      1U      /*!< First press, long press timing      */
+#define BUTTON_ST_GAP       2U      /*!< Released, double click timing       */
+#define BUTTON_ST_DOWN2     3U      /*!< Second press, long press timing     */
+#define BUTTON_ST_HELD      4U      /*!< Long press posted, waiting release  */
+
+#if (BUTTON_QUEUE_DEPTH & BUTTON_MASK) != 0U
+#error "BUTTON_QUEUE_DEPTH must be a power of two"
+#endif
+
+/** Keeps the compiler from moving slot accesses across the index update;
+    the core itself does not reorder them */
+#if defined(__GNUC__)
+#define BUTTON_BARRIER()    __asm volatile ("" ::: "memory")
+#else
+#define BUTTON_BARRIER()
+#endif
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t BUTTON_Reached(uint32_t now, uint32_t time);
+static void    BUTTON_Change(BUTTON_HandleTypeDef *btn, uint32_t time);
+static void    BUTTON_Timeout(BUTTON_HandleTypeDef *btn);
+static void    BUTTON_Emit(BUTTON_HandleTypeDef *btn, BUTTON_GestureTypeDef gesture, uint32_t time);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Reset a button with the default timings.
+  * @param  btn: Button handle
+  * @param  id: Reported in its events
+  * @param  queue: Where its events go
+  * @param  level: Current pin level, 1 = pressed; a button held at reset
+  *         reports its release only
+  * @retval None
+  */
+void BUTTON_Init(BUTTON_HandleTypeDef *btn, uint8_t id, BUTTON_QueueTypeDef *queue, uint32_t level)
+{
+  btn->Queue      = queue;
+  btn->Id         = id;
+  btn->Level      = (level != 0U) ? 1U : 0U;
+  btn->State      = (btn->Level != 0U) ? BUTTON_ST_HELD : BUTTON_ST_IDLE;
+  btn->Bouncing   = 0U;
+  btn->Timing     = 0U;
+  btn->EdgeAt     = 0U;
+  btn->SettleAt   = 0U;
+  btn->Deadline   = 0U;
+  btn->DebounceMs = BUTTON_DEBOUNCE_MS;
+  btn->LongMs     = BUTTON_LONG_MS;
+  btn->DoubleMs   = BUTTON_DOUBLE_MS;
+}
+
+/**
+  * @brief  Raw edge on the pin, either direction.
+  * @param  btn: Button handle
+  * @param  now: Time, ms
+  * @retval ms until BUTTON_Service() is due
+  */
+uint32_t BUTTON_Edge(BUTTON_HandleTypeDef *btn, uint32_t now)
+{
+  if (btn->Bouncing == 0U)
+  {
+    btn->Bouncing = 1U;
+    btn->EdgeAt   = now;
+  }
+  btn->SettleAt = now + btn->DebounceMs;
+  return btn->DebounceMs;
+}
+
+/**
+  * @brief  Take a settled level and run the gesture timeouts that are due.
+  *         Early or extra calls are harmless.
+  * @param  btn: Button handle
+  * @param  level: Pin level now, 1 = pressed
+  * @param  now: Time, ms
+  * @retval ms until BUTTON_Service() is due again, 0 if nothing is pending
+  */
+uint32_t BUTTON_Service(BUTTON_HandleTypeDef *btn, uint32_t level, uint32_t now)
+{
+  level = (level != 0U) ? 1U : 0U;
+
+  if (btn->Bouncing != 0U)
+  {
+    if (BUTTON_Reached(now, btn->SettleAt) == 0U)
+    {
+      return btn->SettleAt - now;
+    }
+    btn->Bouncing = 0U;
+    if (level != btn->Level)
+    {
+      if ((btn->Timing != 0U) && (BUTTON_Reached(btn->EdgeAt, btn->Deadline) != 0U))
+      {
+        BUTTON_Timeout(btn);
+      }
+      btn->Level = (uint8_t)level;
+      BUTTON_Change(btn, btn->EdgeAt);
+    }
+  }
+  if ((btn->Timing != 0U) && (BUTTON_Reached(now, btn->Deadline) != 0U))
+  {
+    BUTTON_Timeout(btn);
+  }
+  return (btn->Timing != 0U) ? (btn->Deadline - now) : 0U;
+}
+
+/**
+  * @brief  Empty a queue.
+  * @param  queue: Event queue
+  * @retval None
+  */
+void BUTTON_QueueInit(BUTTON_QueueTypeDef *queue)
+{
+  queue->Head    = 0U;
+  queue->Tail    = 0U;
+  queue->Dropped = 0U;
+}
+
+/**
+  * @brief  Append an event. Producer side, one context only.
+  * @param  queue: Event queue
+  * @param  event: Copied into the queue
+  * @retval 0 if the queue was full and the event dropped
+  */
+uint8_t BUTTON_Post(BUTTON_QueueTypeDef *queue, const BUTTON_EventTypeDef *event)
+{
+  uint32_t head = queue->Head;
+
+  if ((head - queue->Tail) >= BUTTON_QUEUE_DEPTH)
+  {
+    queue->Dropped++;
+    return 0U;
+  }
+  queue->Events[head & BUTTON_MASK] = *event;
+  BUTTON_BARRIER();
+  queue->Head = head + 1U;
+  return 1U;
+}
+
+/**
+  * @brief  Take the oldest event. Consumer side, one context only.
+  * @param  queue: Event queue
+  * @param  event: Receives it
+  * @retval 0 if the queue was empty
+  */
+uint8_t BUTTON_Get(BUTTON_QueueTypeDef *queue, BUTTON_EventTypeDef *event)
+{
+  uint32_t tail = queue->Tail;
+
+  if (tail == queue->Head)
+  {
+    return 0U;
+  }
+  BUTTON_BARRIER();
+  *event = queue->Events[tail & BUTTON_MASK];
+  BUTTON_BARRIER();
+  queue->Tail = tail + 1U;
+  return 1U;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Whether now is at or past time, across the 32-bit wrap.
+  * @retval 1 if reached
+  */
+static uint8_t BUTTON_Reached(uint32_t now, uint32_t time)
+{
+  return ((int32_t)(now - time) >= 0) ? 1U : 0U;
+}
+
+/**
+  * @brief  Debounced press or release, after btn->Level was updated.
+  * @param  btn: Button handle
+  * @param  time: When the pin changed
+  * @retval None
+  */
+static void BUTTON_Change(BUTTON_HandleTypeDef *btn, uint32_t time)
+{
+  if (btn->Level != 0U)
+  {
+    BUTTON_Emit(btn, BUTTON_PRESS, time);
+    if ((btn->State == BUTTON_ST_IDLE) || (btn->State == BUTTON_ST_GAP))
+    {
+      btn->State    = (btn->State == BUTTON_ST_IDLE) ? BUTTON_ST_DOWN : BUTTON_ST_DOWN2;
+      btn->Deadline = time + btn->LongMs;
+      btn->Timing   = 1U;
+    }
+    return;
+  }
+
+  BUTTON_Emit(btn, BUTTON_RELEASE, time);
+  btn->Timing = 0U;
+  switch (btn->State)
+  {
+    case BUTTON_ST_DOWN:
+      btn->State    = BUTTON_ST_GAP;
+      btn->Deadline = time + btn->DoubleMs;
+      btn->Timing   = 1U;
+      break;
+    case BUTTON_ST_DOWN2:
+      BUTTON_Emit(btn, BUTTON_DOUBLE_CLICK, time);
+      btn->State = BUTTON_ST_IDLE;
+      break;
+    default:
+      btn->State = BUTTON_ST_IDLE;
+      break;
+  }
+}
+
+/**
+  * @brief  The armed deadline has passed.
+  * @param  btn: Button handle
+  * @retval None
+  */
+static void BUTTON_Timeout(BUTTON_HandleTypeDef *btn)
+{
+  uint32_t time = btn->Deadline;
+
+  btn->Timing = 0U;
+  switch (btn->State)
+  {
+    case BUTTON_ST_GAP:
+      BUTTON_Emit(btn, BUTTON_CLICK, time);
+      btn->State = BUTTON_ST_IDLE;
+      break;
+    case BUTTON_ST_DOWN2:
+      /* The first press was a click after all */
+      BUTTON_Emit(btn, BUTTON_CLICK, time);
+      BUTTON_Emit(btn, BUTTON_LONG_PRESS, time);
+      btn->State = BUTTON_ST_HELD;
+      break;
+    case BUTTON_ST_DOWN:
+      BUTTON_Emit(btn, BUTTON_LONG_PRESS, time);
+      btn->State = BUTTON_ST_HELD;
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+  * @brief  Post an event of this button.
+  * @retval None
+  */
+static void BUTTON_Emit(BUTTON_HandleTypeDef *btn, BUTTON_GestureTypeDef gesture, uint32_t time)
+{
+  BUTTON_EventTypeDef event;
+
+  event.Button  = btn->Id;
+  event.Gesture = (uint8_t)gesture;
+  event.Time    = time;
+  (void)BUTTON_Post(btn->Queue, &event);
+}
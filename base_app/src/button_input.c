@@ -0,0 +1,209 @@
+/**
+  ******************************************************************************
+  * @file    button_input.c
+  * @brief   User button B1 on EXTI0 with a TIM7 one-shot for debouncing.
+  ******************************************************************************
+  * B1 (PA0, high while pressed, external pull-down) interrupts on both edges.
+  * Each edge goes to BUTTON_Edge() and (re)arms TIM7 in one-pulse mode for
+  * the delay it returns; the TIM7 update reads the pin and runs
+  * BUTTON_Service(), which arms it again while a gesture timeout is pending.
+  * Between gestures neither interrupt fires and nothing polls.
+  *
+  * Events go to a lock-free queue; a semaphore wakes the reading task when
+  * the interrupts posted something. power.c keeps TIM7 at
+  * BUTTON_INPUT_TICK_HZ across clock switches; the re-timing restarts the
+  * counter, so BUTTON_INPUT_ClockNotify() re-arms it afterwards.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "button_input.h"
+#include "board.h"
+#include "clock_config.h"
+#include "kernel.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BUTTON_INPUT_TICKS_PER_MS (BUTTON_INPUT_TICK_HZ / 1000U)
+#define BUTTON_INPUT_MAX_MS       (0x10000UL / BUTTON_INPUT_TICKS_PER_MS)
+
+/* Private variables ---------------------------------------------------------*/
+TIM_HandleTypeDef htim7;
+
+static EXTI_HandleTypeDef   hexti0;
+static BUTTON_QueueTypeDef  ButtonQueue;
+static BUTTON_HandleTypeDef ButtonUser;
+static KERNEL_SemTypeDef    ButtonReady;
+
+/* Private function prototypes -----------------------------------------------*/
+static void BUTTON_INPUT_Arm(uint32_t ms);
+static void BUTTON_INPUT_Service(void);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Configure PA0 on EXTI0, both edges, and TIM7 as a one-shot.
+  *         Call after KERNEL_PORT_Init(): the interrupts give a semaphore.
+  * @retval HAL status
+  */
+HAL_StatusTypeDef BUTTON_INPUT_Init(void)
+{
+  EXTI_ConfigTypeDef sConfig = {0};
+
+  BUTTON_QueueInit(&ButtonQueue);
+  KERNEL_SemInit(&ButtonReady, 0U, 1U);
+
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  __HAL_RCC_SYSCFG_CLK_ENABLE();
+  __HAL_RCC_TIM7_CLK_ENABLE();
+
+  /**B1 GPIO Configuration
+  PA0-WKUP ------> EXTI0, pulled down on the board
+  */
+  BUTTON_USER_Init(PIN_MODE_INPUT, PIN_PULL_NONE, PIN_SPEED_LOW, PIN_OTYPE_PP);
+  BUTTON_Init(&ButtonUser, BUTTON_INPUT_USER, &ButtonQueue, BUTTON_USER_Read());
+
+  htim7.Instance = TIM7;
+  htim7.Init.Prescaler = CLOCK_TIM_PSC(CLOCK_CONFIG_TIM_APB1_HZ, BUTTON_INPUT_TICK_HZ);
+  htim7.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim7.Init.Period = 0xFFFFU;
+  htim7.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  if (HAL_TIM_Base_Init(&htim7) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  htim7.Instance->CR1 |= TIM_CR1_OPM;
+  __HAL_TIM_CLEAR_FLAG(&htim7, TIM_FLAG_UPDATE);
+  __HAL_TIM_ENABLE_IT(&htim7, TIM_IT_UPDATE);
+
+  sConfig.Line = EXTI_LINE_0;
+  sConfig.Mode = EXTI_MODE_INTERRUPT;
+  sConfig.Trigger = EXTI_TRIGGER_RISING_FALLING;
+  sConfig.GPIOSel = EXTI_GPIOA;
+  if (HAL_EXTI_SetConfigLine(&hexti0, &sConfig) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  HAL_EXTI_ClearPending(&hexti0, EXTI_TRIGGER_RISING_FALLING);
+
+  HAL_NVIC_SetPriority(TIM7_IRQn, BUTTON_INPUT_IRQ_PRIORITY, 0U);
+  HAL_NVIC_SetPriority(EXTI0_IRQn, BUTTON_INPUT_IRQ_PRIORITY, 0U);
+  HAL_NVIC_EnableIRQ(TIM7_IRQn);
+  HAL_NVIC_EnableIRQ(EXTI0_IRQn);
+  return HAL_OK;
+}
+
+/**
+  * @brief  Take the next button event, waiting for one if there is none.
+  *         One task only.
+  * @param  event: Receives it
+  * @param  timeout: Ticks to wait, 0 to only look, KERNEL_FOREVER
+  * @retval HAL_TIMEOUT if no event came
+  */
+HAL_StatusTypeDef BUTTON_INPUT_Read(BUTTON_EventTypeDef *event, uint32_t timeout)
+{
+  if (BUTTON_Get(&ButtonQueue, event) != 0U)
+  {
+    return HAL_OK;
+  }
+  if ((timeout == 0U) || (KERNEL_SemTake(&ButtonReady, timeout) != KERNEL_OK))
+  {
+    return HAL_TIMEOUT;
+  }
+  /* A wake-up left over from events already read finds the queue empty */
+  return (BUTTON_Get(&ButtonQueue, event) != 0U) ? HAL_OK : HAL_TIMEOUT;
+}
+
+/**
+  * @brief  Events lost because the reader fell behind.
+  * @retval Count since BUTTON_INPUT_Init()
+  */
+uint32_t BUTTON_INPUT_Dropped(void)
+{
+  return ButtonQueue.Dropped;
+}
+
+/**
+  * @brief  DVFS callback: after a switch, re-arm the timer the re-timing
+  *         stopped. Register with POWER_Register().
+  * @retval DVFS_OK, never vetoes
+  */
+DVFS_StatusTypeDef BUTTON_INPUT_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                            const DVFS_PointTypeDef *point)
+{
+  (void)context;
+  (void)point;
+  if (event == DVFS_EV_POST)
+  {
+    HAL_NVIC_DisableIRQ(EXTI0_IRQn);
+    HAL_NVIC_DisableIRQ(TIM7_IRQn);
+    BUTTON_INPUT_Service();
+    HAL_NVIC_EnableIRQ(TIM7_IRQn);
+    HAL_NVIC_EnableIRQ(EXTI0_IRQn);
+  }
+  return DVFS_OK;
+}
+
+/**
+  * @brief  EXTI0: an edge on B1, bounce or not.
+  * @retval None
+  */
+void BUTTON_INPUT_EXTI_IRQHandler(void)
+{
+  HAL_EXTI_ClearPending(&hexti0, EXTI_TRIGGER_RISING_FALLING);
+  BUTTON_INPUT_Arm(BUTTON_Edge(&ButtonUser, HAL_GetTick()));
+}
+
+/**
+  * @brief  TIM7 update: the one-shot expired.
+  * @retval None
+  */
+void BUTTON_INPUT_TIM_IRQHandler(void)
+{
+  __HAL_TIM_CLEAR_FLAG(&htim7, TIM_FLAG_UPDATE);
+  BUTTON_INPUT_Service();
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Run the button, arm the timer for its next deadline and wake the
+  *         reader if it posted anything.
+  * @retval None
+  */
+static void BUTTON_INPUT_Service(void)
+{
+  uint32_t head = ButtonQueue.Head;
+
+  BUTTON_INPUT_Arm(BUTTON_Service(&ButtonUser, BUTTON_USER_Read(), HAL_GetTick()));
+  if (ButtonQueue.Head != head)
+  {
+    (void)KERNEL_SemGive(&ButtonReady);
+  }
+}
+
+/**
+  * @brief  Start TIM7 to expire once, ms from now.
+  * @param  ms: Delay, 0 to leave it stopped; clamped to the counter range
+  * @retval None
+  */
+static void BUTTON_INPUT_Arm(uint32_t ms)
+{
+  TIM_TypeDef *tim = htim7.Instance;
+
+  tim->CR1 &= ~TIM_CR1_CEN;
+  if (ms == 0U)
+  {
+    return;
+  }
+  if (ms > BUTTON_INPUT_MAX_MS)
+  {
+    ms = BUTTON_INPUT_MAX_MS;
+  }
+  tim->ARR = (ms * BUTTON_INPUT_TICKS_PER_MS) - 1U;
+
+  /* Restart the count without an update interrupt; power.c clears URS */
+  tim->CR1 |= TIM_CR1_URS;
+  tim->EGR  = TIM_EGR_UG;
+  __HAL_TIM_CLEAR_FLAG(&htim7, TIM_FLAG_UPDATE);
+  tim->CR1 |= TIM_CR1_CEN;
+}
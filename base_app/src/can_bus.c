@@ -0,0 +1,687 @@
+/**
+  ******************************************************************************
+  * @file    can_bus.c
+  * @brief   bxCAN1 driver: planned filter banks, per-rule receive queues and
+  *          a transmit priority queue.
+  ******************************************************************************
+  * CAN1 on the STM32F4-Discovery, to an external transceiver:
+  *
+  *   PD0 CAN1_RX (pulled up)    PD1 CAN1_TX    (AF9)
+  *
+  * There is no HAL CAN driver in this tree, so the peripheral is programmed
+  * directly. CAN_BUS_Init() turns the caller's rules into filter banks
+  * (can_filter.c). The FIFO interrupts hand each frame to the queue of the
+  * filter that accepted it, found from the filter match index with no
+  * identifier comparisons; one task reads each queue.
+  *
+  * Frames to send wait in a heap in bus arbitration order (can_queue.c).
+  * The mailbox-empty interrupt moves the top of the heap into every free
+  * mailbox, so all three stay loaded while there is anything to send, and
+  * the controller picks among them by identifier as the bus would. Frames
+  * with equal identifiers leave in mailbox order, so one only goes into a
+  * mailbox above any pending mailbox holding the same identifier.
+  * CAN_BUS_Send() pends the interrupt to get a frame going.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "can_bus.h"
+#include "clock_config.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CAN_BUS_RX_PIN      GPIO_PIN_0
+#define CAN_BUS_TX_PIN      GPIO_PIN_1
+#define CAN_BUS_BANK_MASK   ((1UL << CANF_MAX_BANKS) - 1UL)
+#define CAN_BUS_MODE_BITS   (CAN_BTR_LBKM | CAN_BTR_SILM)
+
+/* Private variables ---------------------------------------------------------*/
+static CANF_PlanTypeDef     CanPlan;
+static CANQ_TxQueueTypeDef  CanTxQueue;
+static CANQ_RxQueueTypeDef *CanQueues;
+static uint32_t             CanQueueCount;
+static CAN_BusStatsTypeDef  CanStats;
+static uint8_t              CanBusReady;
+
+/* Private function prototypes -----------------------------------------------*/
+static void              CAN_BUS_MspInit(void);
+static uint32_t          CAN_BUS_Timing(uint32_t pclk, uint32_t bitrate);
+static HAL_StatusTypeDef CAN_BUS_Wait(uint8_t init);
+static HAL_StatusTypeDef CAN_BUS_Configure(uint32_t btr);
+static void              CAN_BUS_LoadFilters(void);
+static void              CAN_BUS_Refill(void);
+static void              CAN_BUS_Fifo(uint32_t fifo);
+static void              CAN_BUS_Flush(void);
+static uint32_t          CAN_BUS_FrameBits(const CANQ_FrameTypeDef *frame);
+static uint8_t           CAN_BUS_Owns(uint32_t queue, uint32_t id);
+static uint32_t          CAN_BUS_Word(const uint8_t *data);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Plan the filters, bring up CAN1 at CAN_BUS_BITRATE and join the
+  *         bus in normal mode.
+  * @param  rules: Accepted identifiers (can_filter.h), Queue < queue_count
+  * @param  count: Rules
+  * @param  queues: One receive queue per Queue index, kept by the driver
+  * @param  queue_count: Queues
+  * @retval HAL_OK, HAL_ERROR for rules that do not fit, HAL_TIMEOUT if the
+  *         controller did not answer
+  */
+HAL_StatusTypeDef CAN_BUS_Init(const CANF_RuleTypeDef *rules, uint32_t count,
+                               CANQ_RxQueueTypeDef *queues, uint32_t queue_count)
+{
+  uint32_t btr = CAN_BUS_Timing(CLOCK_CONFIG_PCLK1_HZ, CAN_BUS_BITRATE);
+  uint32_t i;
+
+  if ((btr == 0U) || (queue_count == 0U) || (queue_count > 0xFFU))
+  {
+    return HAL_ERROR;
+  }
+  for (i = 0U; i < count; i++)
+  {
+    if (rules[i].Queue >= queue_count)
+    {
+      return HAL_ERROR;
+    }
+  }
+  if (CANF_Plan(rules, count, &CanPlan) != CANF_OK)
+  {
+    return HAL_ERROR;
+  }
+  CanQueues = queues;
+  CanQueueCount = queue_count;
+  for (i = 0U; i < queue_count; i++)
+  {
+    CANQ_RxInit(&queues[i]);
+  }
+  CANQ_TxInit(&CanTxQueue);
+  memset(&CanStats, 0, sizeof(CanStats));
+  CanStats.Bitrate = CAN_BUS_BITRATE;
+  CanStats.Banks = CanPlan.Banks;
+
+  CAN_BUS_MspInit();
+
+  /* Out of sleep, into initialization */
+  if (CAN_BUS_Wait(1U) != HAL_OK)
+  {
+    return HAL_TIMEOUT;
+  }
+  /* Automatic bus-off recovery, automatic retransmission, identifier
+   * priority between mailboxes, FIFOs overwrite their last frame */
+  CAN1->MCR = CAN_MCR_INRQ | CAN_MCR_ABOM;
+  CAN1->BTR = btr;
+  CAN_BUS_LoadFilters();
+  CAN1->IER = CAN_IER_TMEIE | CAN_IER_FMPIE0 | CAN_IER_FOVIE0 | CAN_IER_FMPIE1 | CAN_IER_FOVIE1 |
+              CAN_IER_EPVIE | CAN_IER_BOFIE | CAN_IER_ERRIE;
+  CanBusReady = 1U;
+  return CAN_BUS_Wait(0U);
+}
+
+/**
+  * @brief  Switch between the bus and silent loopback. Frames queued or in
+  *         the mailboxes are sent in the new mode.
+  * @param  mode: CAN_BUS_NORMAL or CAN_BUS_LOOPBACK
+  * @retval HAL status
+  */
+HAL_StatusTypeDef CAN_BUS_SetMode(CAN_BusModeTypeDef mode)
+{
+  if (CanBusReady == 0U)
+  {
+    return HAL_ERROR;
+  }
+  return CAN_BUS_Configure((CAN1->BTR & ~CAN_BUS_MODE_BITS) |
+                           ((mode == CAN_BUS_LOOPBACK) ? CAN_BUS_MODE_BITS : 0U));
+}
+
+/**
+  * @brief  Queue a frame. It goes out after every queued frame that would
+  *         win arbitration against it and every older one with its identifier.
+  * @param  frame: Copied in; Dlc above 8 is sent as 8
+  * @retval HAL_OK, HAL_BUSY if the queue is full
+  */
+HAL_StatusTypeDef CAN_BUS_Send(const CANQ_FrameTypeDef *frame)
+{
+  uint32_t primask;
+  uint8_t queued;
+
+  if (CanBusReady == 0U)
+  {
+    return HAL_ERROR;
+  }
+  primask = __get_PRIMASK();
+  __disable_irq();
+  queued = CANQ_Push(&CanTxQueue, frame);
+  __set_PRIMASK(primask);
+  if (queued == 0U)
+  {
+    return HAL_BUSY;
+  }
+  NVIC_SetPendingIRQ(CAN1_TX_IRQn);
+  return HAL_OK;
+}
+
+/**
+  * @brief  Take the oldest frame of a receive queue. One task per queue.
+  * @param  queue: Queue index of the rules
+  * @param  frame: Receives it
+  * @retval 0 if the queue was empty
+  */
+uint8_t CAN_BUS_Receive(uint32_t queue, CANQ_FrameTypeDef *frame)
+{
+  if (queue >= CanQueueCount)
+  {
+    return 0U;
+  }
+  return CANQ_Get(&CanQueues[queue], frame);
+}
+
+/**
+  * @brief  Snapshot of the counters and error state.
+  * @param  stats: Filled in
+  * @retval None
+  */
+void CAN_BUS_GetStats(CAN_BusStatsTypeDef *stats)
+{
+  uint32_t esr = CAN1->ESR;
+  uint32_t i;
+
+  *stats = CanStats;
+  stats->RxDropped = 0U;
+  for (i = 0U; i < CanQueueCount; i++)
+  {
+    stats->RxDropped += CanQueues[i].Dropped;
+  }
+  stats->Tec = (uint8_t)(esr >> CAN_ESR_TEC_Pos);
+  stats->Rec = (uint8_t)(esr >> CAN_ESR_REC_Pos);
+}
+
+/**
+  * @brief  Silent loopback self-test and throughput benchmark: send frames
+  *         round the data rules, check each arrives once, intact and in its
+  *         rule's queue, and that an identifier no rule accepts does not.
+  *         Discards whatever the queues held. Not with another reader.
+  * @param  frames: Up to CAN_BUS_SELFTEST_MAX
+  * @param  result: Filled in
+  * @retval HAL_OK if everything came back, HAL_TIMEOUT, or HAL_ERROR
+  */
+HAL_StatusTypeDef CAN_BUS_SelfTest(uint32_t frames, CAN_BusSelfTestTypeDef *result)
+{
+  uint8_t seen[CAN_BUS_SELFTEST_MAX / 8U];
+  const CANF_RuleTypeDef *rule = NULL;
+  CANQ_FrameTypeDef frame;
+  uint32_t reject = 0xFFFFFFFFU;
+  uint32_t bits = 0U;
+  uint32_t next = 0U;
+  uint32_t start;
+  uint32_t seq;
+  uint32_t q;
+  uint32_t i;
+
+  memset(result, 0, sizeof(*result));
+  memset(seen, 0, sizeof(seen));
+  if ((frames == 0U) || (frames > CAN_BUS_SELFTEST_MAX) || (CAN_BUS_SetMode(CAN_BUS_LOOPBACK) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+  for (q = 0U; q < CanQueueCount; q++)
+  {
+    while (CANQ_Get(&CanQueues[q], &frame) != 0U)
+    {
+    }
+  }
+
+  /* The probe that must stay out goes first */
+  for (i = CANQ_STD_MASK + 1U; (i > 0U) && (reject == 0xFFFFFFFFU); i--)
+  {
+    reject = (CANF_Match(&CanPlan, i - 1U, NULL, NULL) == 0U) ? (i - 1U) : 0xFFFFFFFFU;
+  }
+  memset(&frame, 0, sizeof(frame));
+  if (reject != 0xFFFFFFFFU)
+  {
+    frame.Id = reject;
+    (void)CAN_BUS_Send(&frame);
+  }
+
+  start = HAL_GetTick();
+  while ((result->Received < frames) && ((HAL_GetTick() - start) < (frames + 100U)))
+  {
+    /* Payload: sequence number and its complement */
+    while ((result->Sent < frames) && (next < (frames * CANF_MAX_RULES)))
+    {
+      rule = &CanPlan.Rules[next++ % CanPlan.RuleCount];
+      if ((rule->Id & CANQ_RTR) != 0U)
+      {
+        continue;
+      }
+      seq = result->Sent;
+      frame.Id = rule->Id | (seq & ~rule->Mask & (((rule->Id & CANQ_EXT) != 0U) ? CANQ_EXT_MASK : CANQ_STD_MASK));
+      frame.Dlc = 8U;
+      for (i = 0U; i < 4U; i++)
+      {
+        frame.Data[i] = (uint8_t)(seq >> (8U * i));
+        frame.Data[4U + i] = (uint8_t)(~seq >> (8U * i));
+      }
+      if (CAN_BUS_Send(&frame) != HAL_OK)
+      {
+        next--;
+        break;
+      }
+      bits += CAN_BUS_FrameBits(&frame);
+      result->Sent++;
+    }
+    if (result->Sent == 0U)
+    {
+      break;
+    }
+
+    for (q = 0U; q < CanQueueCount; q++)
+    {
+      while (CANQ_Get(&CanQueues[q], &frame) != 0U)
+      {
+        seq = CAN_BUS_Word(&frame.Data[0]);
+        if (frame.Id == reject)
+        {
+          result->Leaked = 1U;
+        }
+        else if ((frame.Dlc != 8U) || (seq >= frames) || ((seen[seq / 8U] & (1U << (seq % 8U))) != 0U) ||
+                 (CAN_BUS_Word(&frame.Data[4]) != ~seq) || (CAN_BUS_Owns(q, frame.Id) == 0U))
+        {
+          result->Errors++;
+        }
+        else
+        {
+          seen[seq / 8U] |= (uint8_t)(1U << (seq % 8U));
+          result->Received++;
+        }
+      }
+    }
+  }
+  result->Ms = HAL_GetTick() - start;
+  if (result->Received < result->Sent)
+  {
+    CAN_BUS_Flush();
+  }
+  if (CAN_BUS_SetMode(CAN_BUS_NORMAL) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  result->FramesPerSec = (uint32_t)(((uint64_t)result->Received * 1000U) / ((result->Ms != 0U) ? result->Ms : 1U));
+  result->WireFramesPerSec = (bits != 0U) ? (uint32_t)(((uint64_t)CAN_BUS_BITRATE * result->Sent) / bits) : 0U;
+  if ((result->Sent == 0U) || (result->Received < result->Sent))
+  {
+    return (result->Sent == 0U) ? HAL_ERROR : HAL_TIMEOUT;
+  }
+  return ((result->Errors == 0U) && (result->Leaked == 0U)) ? HAL_OK : HAL_ERROR;
+}
+
+/**
+  * @brief  Operating point notifier (power.h): hold the switch off while a
+  *         mailbox is pending or the new PCLK1 cannot make the bit rate,
+  *         then load the bit timing for it.
+  * @param  context: Not used
+  * @param  event: DVFS_EV_PRE or DVFS_EV_POST
+  * @param  point: Target point
+  * @retval DVFS_OK or DVFS_BUSY
+  */
+DVFS_StatusTypeDef CAN_BUS_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                       const DVFS_PointTypeDef *point)
+{
+  uint32_t btr;
+
+  (void)context;
+  if (CanBusReady == 0U)
+  {
+    return DVFS_OK;
+  }
+  btr = CAN_BUS_Timing(DVFS_Pclk(point, 1U), CAN_BUS_BITRATE);
+  if (event == DVFS_EV_PRE)
+  {
+    return ((btr == 0U) || ((CAN1->TSR & CAN_TSR_TME) != CAN_TSR_TME)) ? DVFS_BUSY : DVFS_OK;
+  }
+  (void)CAN_BUS_Configure(btr | (CAN1->BTR & CAN_BUS_MODE_BITS));
+  NVIC_SetPendingIRQ(CAN1_TX_IRQn);
+  return DVFS_OK;
+}
+
+/**
+  * @brief  Mailbox interrupt: count the finished mailboxes and load every
+  *         free one from the queue. Also runs after CAN_BUS_Send() pended it.
+  * @retval None
+  */
+void CAN_BUS_TX_IRQHandler(void)
+{
+  uint32_t tsr = CAN1->TSR;
+  uint32_t m;
+
+  for (m = 0U; m < 3U; m++)
+  {
+    if ((tsr & (CAN_TSR_RQCP0 << (8U * m))) != 0U)
+    {
+      if ((tsr & (CAN_TSR_TXOK0 << (8U * m))) != 0U)
+      {
+        CanStats.TxFrames++;
+      }
+      else
+      {
+        CanStats.TxAborted++;
+      }
+      /* Clears TXOK, ALST and TERR with it */
+      CAN1->TSR = CAN_TSR_RQCP0 << (8U * m);
+    }
+  }
+  CAN_BUS_Refill();
+}
+
+/**
+  * @brief  FIFO 0 interrupt: frames pending or overrun.
+  * @retval None
+  */
+void CAN_BUS_RX0_IRQHandler(void)
+{
+  CAN_BUS_Fifo(0U);
+}
+
+/**
+  * @brief  FIFO 1 interrupt: frames pending or overrun.
+  * @retval None
+  */
+void CAN_BUS_RX1_IRQHandler(void)
+{
+  CAN_BUS_Fifo(1U);
+}
+
+/**
+  * @brief  Status change interrupt: entered error passive or bus-off.
+  *         Bus-off recovers on its own (ABOM).
+  * @retval None
+  */
+void CAN_BUS_SCE_IRQHandler(void)
+{
+  uint32_t esr = CAN1->ESR;
+
+  if ((esr & CAN_ESR_BOFF) != 0U)
+  {
+    CanStats.BusOffs++;
+  }
+  else if ((esr & CAN_ESR_EPVF) != 0U)
+  {
+    CanStats.ErrorPassives++;
+  }
+  CAN1->MSR = CAN_MSR_ERRI;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Clocks, pins and interrupts for CAN1.
+  * @retval None
+  */
+static void CAN_BUS_MspInit(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  __HAL_RCC_CAN1_CLK_ENABLE();
+  __HAL_RCC_GPIOD_CLK_ENABLE();
+
+  /**CAN1 GPIO Configuration
+  PD0     ------> CAN1_RX, pulled up: recessive with no transceiver fitted
+  PD1     ------> CAN1_TX
+  */
+  GPIO_InitStruct.Pin = CAN_BUS_RX_PIN | CAN_BUS_TX_PIN;
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct.Pull = GPIO_PULLUP;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct.Alternate = GPIO_AF9_CAN1;
+  HAL_GPIO_Init(GPIOD, &GPIO_InitStruct);
+
+  HAL_NVIC_SetPriority(CAN1_TX_IRQn, CAN_BUS_IRQ_PRIORITY, 0);
+  HAL_NVIC_SetPriority(CAN1_RX0_IRQn, CAN_BUS_IRQ_PRIORITY, 0);
+  HAL_NVIC_SetPriority(CAN1_RX1_IRQn, CAN_BUS_IRQ_PRIORITY, 0);
+  HAL_NVIC_SetPriority(CAN1_SCE_IRQn, CAN_BUS_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(CAN1_TX_IRQn);
+  HAL_NVIC_EnableIRQ(CAN1_RX0_IRQn);
+  HAL_NVIC_EnableIRQ(CAN1_RX1_IRQn);
+  HAL_NVIC_EnableIRQ(CAN1_SCE_IRQn);
+}
+
+/**
+  * @brief  Bit timing for a bit rate: the most time quanta per bit (8 to 25)
+  *         that divide PCLK1 exactly, sampling at 87.5 %, SJW of 1.
+  * @param  pclk: APB1 clock
+  * @param  bitrate: Bits per second
+  * @retval BTR value without the mode bits, 0 if there is none
+  */
+static uint32_t CAN_BUS_Timing(uint32_t pclk, uint32_t bitrate)
+{
+  uint32_t tq;
+  uint32_t brp;
+  uint32_t ts1;
+  uint32_t ts2;
+
+  for (tq = 25U; tq >= 8U; tq--)
+  {
+    if ((pclk % (bitrate * tq)) != 0U)
+    {
+      continue;
+    }
+    brp = pclk / (bitrate * tq);
+    ts1 = (((tq * 7U) + 4U) / 8U) - 1U;
+    ts2 = tq - 1U - ts1;
+    if ((brp <= 1024U) && (ts1 <= 16U) && (ts2 >= 1U) && (ts2 <= 8U))
+    {
+      return (brp - 1U) | ((ts1 - 1U) << CAN_BTR_TS1_Pos) | ((ts2 - 1U) << CAN_BTR_TS2_Pos);
+    }
+  }
+  return 0U;
+}
+
+/**
+  * @brief  Request or leave initialization mode and wait for the controller
+  *         to follow; leaving takes 11 recessive bits on CAN1_RX.
+  * @param  init: 1 to enter
+  * @retval HAL_OK or HAL_TIMEOUT
+  */
+static HAL_StatusTypeDef CAN_BUS_Wait(uint8_t init)
+{
+  uint32_t start = HAL_GetTick();
+  uint32_t want = (init != 0U) ? CAN_MSR_INAK : 0U;
+
+  if (init != 0U)
+  {
+    CAN1->MCR = (CAN1->MCR & ~CAN_MCR_SLEEP) | CAN_MCR_INRQ;
+  }
+  else
+  {
+    CAN1->MCR &= ~CAN_MCR_INRQ;
+  }
+  while ((CAN1->MSR & (CAN_MSR_INAK | CAN_MSR_SLAK)) != want)
+  {
+    if ((HAL_GetTick() - start) > CAN_BUS_TIMEOUT_MS)
+    {
+      return HAL_TIMEOUT;
+    }
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Load a bit timing and mode through initialization mode.
+  * @param  btr: Full BTR value
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef CAN_BUS_Configure(uint32_t btr)
+{
+  if (CAN_BUS_Wait(1U) != HAL_OK)
+  {
+    return HAL_TIMEOUT;
+  }
+  CAN1->BTR = btr;
+  return CAN_BUS_Wait(0U);
+}
+
+/**
+  * @brief  Write the plan into banks 0 to Banks-1 and activate them only.
+  * @retval None
+  */
+static void CAN_BUS_LoadFilters(void)
+{
+  uint32_t b;
+
+  CAN1->FMR |= CAN_FMR_FINIT;
+  CAN1->FA1R &= ~CAN_BUS_BANK_MASK;
+  CAN1->FM1R = (CAN1->FM1R & ~CAN_BUS_BANK_MASK) | CanPlan.Mode;
+  CAN1->FS1R = (CAN1->FS1R & ~CAN_BUS_BANK_MASK) | CanPlan.Scale;
+  CAN1->FFA1R = (CAN1->FFA1R & ~CAN_BUS_BANK_MASK) | CanPlan.Fifo;
+  for (b = 0U; b < CanPlan.Banks; b++)
+  {
+    CAN1->sFilterRegister[b].FR1 = CanPlan.Fr1[b];
+    CAN1->sFilterRegister[b].FR2 = CanPlan.Fr2[b];
+  }
+  CAN1->FA1R |= (1UL << CanPlan.Banks) - 1UL;
+  CAN1->FMR &= ~CAN_FMR_FINIT;
+}
+
+/**
+  * @brief  Move frames from the top of the queue into free mailboxes.
+  * @retval None
+  */
+static void CAN_BUS_Refill(void)
+{
+  const CANQ_TxEntryTypeDef *entry;
+  CAN_TxMailBox_TypeDef *box;
+  uint32_t tsr;
+  uint32_t m;
+  uint32_t n;
+
+  while ((entry = CANQ_Peek(&CanTxQueue)) != NULL)
+  {
+    tsr = CAN1->TSR;
+    m = 0U;
+    for (n = 3U; n > 0U; n--)
+    {
+      if (((tsr & (CAN_TSR_TME0 << (n - 1U))) == 0U) &&
+          ((CAN1->sTxMailBox[n - 1U].TIR & ~CAN_TI0R_TXRQ) == entry->Key))
+      {
+        m = n;
+        break;
+      }
+    }
+    while ((m < 3U) && ((tsr & (CAN_TSR_TME0 << m)) == 0U))
+    {
+      m++;
+    }
+    if (m >= 3U)
+    {
+      break;
+    }
+    box = &CAN1->sTxMailBox[m];
+    box->TDTR = (entry->Frame.Dlc > 8U) ? 8U : entry->Frame.Dlc;
+    box->TDLR = CAN_BUS_Word(&entry->Frame.Data[0]);
+    box->TDHR = CAN_BUS_Word(&entry->Frame.Data[4]);
+    box->TIR = entry->Key | CAN_TI0R_TXRQ;
+    CANQ_Pop(&CanTxQueue);
+  }
+}
+
+/**
+  * @brief  Empty a receive FIFO into the queues by filter match index.
+  *         RF0R and RF1R share their bit layout.
+  * @param  fifo: 0 or 1
+  * @retval None
+  */
+static void CAN_BUS_Fifo(uint32_t fifo)
+{
+  __IO uint32_t *rfr = (fifo == 0U) ? &CAN1->RF0R : &CAN1->RF1R;
+  CAN_FIFOMailBox_TypeDef *box = &CAN1->sFIFOMailBox[fifo];
+  CANQ_FrameTypeDef frame;
+  uint32_t rir;
+  uint32_t rdtr;
+  uint32_t low;
+  uint32_t high;
+  uint32_t fmi;
+  uint32_t i;
+
+  while ((*rfr & CAN_RF0R_FMP0) != 0U)
+  {
+    rir = box->RIR;
+    rdtr = box->RDTR;
+    low = box->RDLR;
+    high = box->RDHR;
+    *rfr = CAN_RF0R_RFOM0;
+
+    frame.Id = ((rir & CAN_RI0R_IDE) != 0U) ? (CANQ_EXT | (rir >> 3)) : (rir >> 21);
+    frame.Id |= ((rir & CAN_RI0R_RTR) != 0U) ? CANQ_RTR : 0U;
+    frame.Dlc = (uint8_t)(rdtr & CAN_RDT0R_DLC);
+    frame.Dlc = (frame.Dlc > 8U) ? 8U : frame.Dlc;
+    for (i = 0U; i < 4U; i++)
+    {
+      frame.Data[i] = (uint8_t)(low >> (8U * i));
+      frame.Data[4U + i] = (uint8_t)(high >> (8U * i));
+    }
+    CanStats.RxFrames++;
+
+    fmi = (rdtr & CAN_RDT0R_FMI) >> CAN_RDT0R_FMI_Pos;
+    if (fmi < CanPlan.Filters[fifo])
+    {
+      (void)CANQ_Post(&CanQueues[CanPlan.Queue[fifo][fmi]], &frame);
+    }
+  }
+  if ((*rfr & CAN_RF0R_FOVR0) != 0U)
+  {
+    *rfr = CAN_RF0R_FOVR0;
+    CanStats.RxOverruns++;
+  }
+}
+
+/**
+  * @brief  Drop the queued frames and abort the pending mailboxes.
+  * @retval None
+  */
+static void CAN_BUS_Flush(void)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  CANQ_TxInit(&CanTxQueue);
+  CAN1->TSR = CAN_TSR_ABRQ0 | CAN_TSR_ABRQ1 | CAN_TSR_ABRQ2;
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Bits a frame takes on the bus without stuff bits, interframe
+  *         space included.
+  */
+static uint32_t CAN_BUS_FrameBits(const CANQ_FrameTypeDef *frame)
+{
+  uint32_t data = ((frame->Id & CANQ_RTR) != 0U) ? 0U : (8U * frame->Dlc);
+
+  return (((frame->Id & CANQ_EXT) != 0U) ? 67U : 47U) + data;
+}
+
+/**
+  * @brief  Whether a rule of the plan sends an identifier to a queue.
+  */
+static uint8_t CAN_BUS_Owns(uint32_t queue, uint32_t id)
+{
+  uint32_t i;
+
+  for (i = 0U; i < CanPlan.RuleCount; i++)
+  {
+    if ((CanPlan.Rules[i].Queue == queue) && (CANF_RuleMatch(&CanPlan.Rules[i], id) != 0U))
+    {
+      return 1U;
+    }
+  }
+  return 0U;
+}
+
+/**
+  * @brief  Four payload bytes as the little-endian word the data registers
+  *         hold.
+  */
+static uint32_t CAN_BUS_Word(const uint8_t *data)
+{
+  return data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
@@ -0,0 +1,434 @@
+/**
+  ******************************************************************************
+  * @file    can_filter.c
+  * @brief   bxCAN filter bank allocation from a list of accepted identifiers.
+  ******************************************************************************
+  * After reduction each rule is one of four kinds, by the narrowest filter
+  * that holds it exactly:
+  *
+  *   LIST16  standard, all 11 bits      1/4 bank, or a spare slot below
+  *   MASK16  STID and EXID[17:15] only  1/2 bank
+  *   LIST32  extended, all 29 bits      1/2 bank
+  *   MASK32  anything else              1 bank
+  *
+  * Per FIFO, MASK32 rules get a bank each, LIST32 and MASK16 rules go in
+  * pairs, and an odd one out leaves a slot a LIST16 rule can take; the rest
+  * of the LIST16 rules go four to a bank. Slots left over repeat the last
+  * entry of their bank, so they accept nothing new.
+  *
+  * Merging two rules into one never costs more slots, but can cost a bank
+  * when the halves no longer pair up, so the plan is counted both ways and
+  * the smaller kept.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "can_filter.h"
+
+/* Private define ------------------------------------------------------------*/
+#define CANF_FLAGS          (CANQ_EXT | CANQ_RTR)
+
+#define CANF_LIST16         0U
+#define CANF_MASK16         1U
+#define CANF_LIST32         2U
+#define CANF_MASK32         3U
+#define CANF_KINDS          4U
+
+/** Filter registers compare IDE and RTR exactly */
+#define CANF_MASK16_FLAGS   0x18U
+#define CANF_MASK32_FLAGS   0x06U
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t CANF_Width(uint32_t id);
+static uint32_t CANF_Kind(const CANF_RuleTypeDef *rule);
+static uint32_t CANF_Reg16(uint32_t id);
+static uint32_t CANF_Mask16(const CANF_RuleTypeDef *rule);
+static uint32_t CANF_Mask32(const CANF_RuleTypeDef *rule);
+static void     CANF_Load(CANF_PlanTypeDef *plan, const CANF_RuleTypeDef *rules, uint32_t count);
+static uint32_t CANF_Reduce(CANF_RuleTypeDef *rules, uint32_t count, uint8_t merge);
+static uint32_t CANF_Banks(const CANF_RuleTypeDef *rules, uint32_t count);
+static void     CANF_Emit(CANF_PlanTypeDef *plan, uint8_t fifo);
+static void     CANF_Bank(CANF_PlanTypeDef *plan, uint8_t fifo, uint8_t list, uint8_t wide,
+                          uint32_t fr1, uint32_t fr2, const uint8_t *queues, uint32_t filters);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Reduce the rules and lay them out over the fewest filter banks.
+  * @param  rules: Accepted identifiers, any order
+  * @param  count: Rules, up to CANF_MAX_RULES
+  * @param  plan: Filled in
+  * @retval CANF_OK, CANF_INVALID or CANF_NO_BANKS
+  */
+CANF_StatusTypeDef CANF_Plan(const CANF_RuleTypeDef *rules, uint32_t count, CANF_PlanTypeDef *plan)
+{
+  uint32_t width;
+  uint32_t plain;
+  uint32_t i;
+
+  if (count > CANF_MAX_RULES)
+  {
+    return CANF_INVALID;
+  }
+  for (i = 0U; i < count; i++)
+  {
+    width = CANF_Width(rules[i].Id);
+    if ((rules[i].Fifo > 1U) || ((rules[i].Id & ~(CANF_FLAGS | width)) != 0U) ||
+        ((rules[i].Mask & ~width) != 0U))
+    {
+      return CANF_INVALID;
+    }
+  }
+
+  CANF_Load(plan, rules, count);
+  plain = CANF_Banks(plan->Rules, plan->RuleCount);
+  plan->RuleCount = CANF_Reduce(plan->Rules, plan->RuleCount, 1U);
+  plan->Banks = CANF_Banks(plan->Rules, plan->RuleCount);
+  if (plan->Banks > plain)
+  {
+    CANF_Load(plan, rules, count);
+    plan->Banks = plain;
+  }
+  if (plan->Banks > CANF_MAX_BANKS)
+  {
+    return CANF_NO_BANKS;
+  }
+
+  plan->Banks = 0U;
+  plan->Mode = 0U;
+  plan->Scale = 0U;
+  plan->Fifo = 0U;
+  plan->Filters[0] = 0U;
+  plan->Filters[1] = 0U;
+  CANF_Emit(plan, 0U);
+  CANF_Emit(plan, 1U);
+  return CANF_OK;
+}
+
+/**
+  * @brief  Run a received identifier through the plan as bxCAN would: a
+  *         32-bit filter before a 16-bit one, a list before a mask, then the
+  *         lowest bank.
+  * @param  plan: Plan from CANF_Plan()
+  * @param  id: Identifier with CANQ_EXT and CANQ_RTR
+  * @param  fifo: Receives the FIFO, may be NULL
+  * @param  fmi: Receives the filter match index, may be NULL
+  * @retval 1 if accepted
+  */
+uint8_t CANF_Match(const CANF_PlanTypeDef *plan, uint32_t id, uint8_t *fifo, uint8_t *fmi)
+{
+  uint32_t key = CANQ_Key(id);
+  uint32_t r16 = CANF_Reg16(id);
+  uint32_t number[2] = {0U, 0U};
+  uint32_t best = CANF_KINDS;
+  uint32_t rank;
+  uint32_t hit;
+  uint32_t reg;
+  uint32_t f;
+  uint32_t b;
+  uint32_t k;
+
+  for (b = 0U; b < plan->Banks; b++)
+  {
+    f = (plan->Fifo >> b) & 1U;
+    rank = (((plan->Scale >> b) & 1U) != 0U) ? 0U : 2U;
+    rank += (((plan->Mode >> b) & 1U) != 0U) ? 0U : 1U;
+    hit = 4U;
+    switch (rank)
+    {
+      case 0U:    /* 32-bit list */
+        hit = (key == plan->Fr1[b]) ? 0U : ((key == plan->Fr2[b]) ? 1U : 4U);
+        k = 2U;
+        break;
+      case 1U:    /* 32-bit mask */
+        hit = (((key ^ plan->Fr1[b]) & plan->Fr2[b]) == 0U) ? 0U : 4U;
+        k = 1U;
+        break;
+      case 2U:    /* 16-bit list, FR1 low half first */
+        for (k = 0U; (k < 4U) && (hit == 4U); k++)
+        {
+          reg = ((k < 2U) ? plan->Fr1[b] : plan->Fr2[b]) >> ((k & 1U) * 16U);
+          hit = (r16 == (reg & 0xFFFFU)) ? k : 4U;
+        }
+        k = 4U;
+        break;
+      default:    /* 16-bit mask, mask in the high half */
+        for (k = 0U; (k < 2U) && (hit == 4U); k++)
+        {
+          reg = (k == 0U) ? plan->Fr1[b] : plan->Fr2[b];
+          hit = ((((r16 ^ reg) & (reg >> 16)) & 0xFFFFU) == 0U) ? k : 4U;
+        }
+        k = 2U;
+        break;
+    }
+    if ((hit != 4U) && (rank < best))
+    {
+      best = rank;
+      if (fifo != (uint8_t *)0)
+      {
+        *fifo = (uint8_t)f;
+      }
+      if (fmi != (uint8_t *)0)
+      {
+        *fmi = (uint8_t)(number[f] + hit);
+      }
+    }
+    number[f] += k;
+  }
+  return (best != CANF_KINDS) ? 1U : 0U;
+}
+
+/**
+  * @brief  Whether a rule accepts an identifier.
+  * @param  rule: Rule
+  * @param  id: Identifier with CANQ_EXT and CANQ_RTR
+  * @retval 1 if accepted
+  */
+uint8_t CANF_RuleMatch(const CANF_RuleTypeDef *rule, uint32_t id)
+{
+  return (((id ^ rule->Id) & (CANF_FLAGS | rule->Mask)) == 0U) ? 1U : 0U;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Identifier bits of a standard or extended identifier.
+  */
+static uint32_t CANF_Width(uint32_t id)
+{
+  return ((id & CANQ_EXT) != 0U) ? CANQ_EXT_MASK : CANQ_STD_MASK;
+}
+
+/**
+  * @brief  Narrowest filter that holds the rule exactly.
+  */
+static uint32_t CANF_Kind(const CANF_RuleTypeDef *rule)
+{
+  uint32_t width = CANF_Width(rule->Id);
+
+  if ((rule->Id & CANQ_EXT) == 0U)
+  {
+    return (rule->Mask == width) ? CANF_LIST16 : CANF_MASK16;
+  }
+  if (rule->Mask == width)
+  {
+    return CANF_LIST32;
+  }
+  /* A 16-bit filter sees EXID[17:15] and nothing below */
+  return ((rule->Mask & 0x7FFFU) == 0U) ? CANF_MASK16 : CANF_MASK32;
+}
+
+/**
+  * @brief  16-bit filter image: STID[10:0] RTR IDE EXID[17:15].
+  */
+static uint32_t CANF_Reg16(uint32_t id)
+{
+  uint32_t reg = ((id & CANQ_RTR) != 0U) ? 0x10U : 0U;
+
+  if ((id & CANQ_EXT) != 0U)
+  {
+    reg |= (((id & CANQ_EXT_MASK) >> 18) << 5) | 0x8U | ((id >> 15) & 0x7U);
+  }
+  else
+  {
+    reg |= (id & CANQ_STD_MASK) << 5;
+  }
+  return reg;
+}
+
+static uint32_t CANF_Mask16(const CANF_RuleTypeDef *rule)
+{
+  if ((rule->Id & CANQ_EXT) != 0U)
+  {
+    return ((rule->Mask >> 18) << 5) | ((rule->Mask >> 15) & 0x7U) | CANF_MASK16_FLAGS;
+  }
+  return (rule->Mask << 5) | CANF_MASK16_FLAGS;
+}
+
+static uint32_t CANF_Mask32(const CANF_RuleTypeDef *rule)
+{
+  if ((rule->Id & CANQ_EXT) != 0U)
+  {
+    return (rule->Mask << 3) | CANF_MASK32_FLAGS;
+  }
+  return (rule->Mask << 21) | CANF_MASK32_FLAGS;
+}
+
+/**
+  * @brief  Copy the rules in with the don't-care identifier bits cleared,
+  *         and drop the ones another rule covers.
+  */
+static void CANF_Load(CANF_PlanTypeDef *plan, const CANF_RuleTypeDef *rules, uint32_t count)
+{
+  uint32_t i;
+
+  for (i = 0U; i < count; i++)
+  {
+    plan->Rules[i] = rules[i];
+    plan->Rules[i].Id = (rules[i].Id & CANF_FLAGS) | (rules[i].Id & rules[i].Mask);
+  }
+  plan->RuleCount = CANF_Reduce(plan->Rules, count, 0U);
+}
+
+/**
+  * @brief  Drop covered rules and, if asked, merge pairs that differ in a
+  *         single identifier bit, until nothing changes. Only rules with
+  *         the same flags, FIFO and queue are combined.
+  * @retval Rules left
+  */
+static uint32_t CANF_Reduce(CANF_RuleTypeDef *rules, uint32_t count, uint8_t merge)
+{
+  uint8_t changed = 1U;
+  uint32_t diff;
+  uint32_t i;
+  uint32_t j;
+
+  while (changed != 0U)
+  {
+    changed = 0U;
+    for (i = 0U; (i < count) && (changed == 0U); i++)
+    {
+      for (j = 0U; (j < count) && (changed == 0U); j++)
+      {
+        if ((i == j) || (((rules[i].Id ^ rules[j].Id) & CANF_FLAGS) != 0U) ||
+            (rules[i].Fifo != rules[j].Fifo) || (rules[i].Queue != rules[j].Queue))
+        {
+          continue;
+        }
+        diff = rules[i].Id ^ rules[j].Id;
+        if (((rules[j].Mask & ~rules[i].Mask) == 0U) && ((diff & rules[j].Mask) == 0U))
+        {
+          /* j accepts everything i does */
+          rules[i] = rules[--count];
+          changed = 1U;
+        }
+        else if ((merge != 0U) && (rules[i].Mask == rules[j].Mask) && ((diff & (diff - 1U)) == 0U))
+        {
+          rules[i].Mask &= ~diff;
+          rules[i].Id &= ~diff;
+          rules[j] = rules[--count];
+          changed = 1U;
+        }
+      }
+    }
+  }
+  return count;
+}
+
+/**
+  * @brief  Banks a rule set needs, FIFOs counted apart.
+  */
+static uint32_t CANF_Banks(const CANF_RuleTypeDef *rules, uint32_t count)
+{
+  uint32_t n[2][CANF_KINDS] = {{0U}};
+  uint32_t banks = 0U;
+  uint32_t list16;
+  uint32_t f;
+  uint32_t i;
+
+  for (i = 0U; i < count; i++)
+  {
+    n[rules[i].Fifo][CANF_Kind(&rules[i])]++;
+  }
+  for (f = 0U; f < 2U; f++)
+  {
+    list16 = n[f][CANF_LIST16];
+    if (((n[f][CANF_LIST32] & 1U) != 0U) && (list16 != 0U))
+    {
+      list16--;
+    }
+    if (((n[f][CANF_MASK16] & 1U) != 0U) && (list16 != 0U))
+    {
+      list16--;
+    }
+    banks += n[f][CANF_MASK32] + ((n[f][CANF_LIST32] + 1U) / 2U) +
+             ((n[f][CANF_MASK16] + 1U) / 2U) + ((list16 + 3U) / 4U);
+  }
+  return banks;
+}
+
+/**
+  * @brief  Append the banks of one FIFO, in the order CANF_Banks() counts.
+  */
+static void CANF_Emit(CANF_PlanTypeDef *plan, uint8_t fifo)
+{
+  uint8_t kind[CANF_KINDS][CANF_MAX_RULES];
+  const CANF_RuleTypeDef *slot[4];
+  uint32_t n[CANF_KINDS] = {0U};
+  uint8_t queues[4];
+  uint32_t used[CANF_KINDS] = {0U};
+  uint32_t t;
+  uint32_t i;
+  uint32_t k;
+
+  for (i = 0U; i < plan->RuleCount; i++)
+  {
+    if (plan->Rules[i].Fifo == fifo)
+    {
+      t = CANF_Kind(&plan->Rules[i]);
+      kind[t][n[t]++] = (uint8_t)i;
+    }
+  }
+
+  for (i = 0U; i < n[CANF_MASK32]; i++)
+  {
+    slot[0] = &plan->Rules[kind[CANF_MASK32][i]];
+    queues[0] = slot[0]->Queue;
+    CANF_Bank(plan, fifo, 0U, 1U, CANQ_Key(slot[0]->Id), CANF_Mask32(slot[0]), queues, 1U);
+  }
+
+  /* Pairs; an odd one out shares with a LIST16 rule, else with itself */
+  for (t = CANF_LIST32; t >= CANF_MASK16; t--)
+  {
+    for (i = 0U; i < n[t]; i += 2U)
+    {
+      slot[0] = &plan->Rules[kind[t][i]];
+      slot[1] = ((i + 1U) < n[t]) ? &plan->Rules[kind[t][i + 1U]] :
+                ((used[CANF_LIST16] < n[CANF_LIST16]) ? &plan->Rules[kind[CANF_LIST16][used[CANF_LIST16]++]] :
+                 slot[0]);
+      queues[0] = slot[0]->Queue;
+      queues[1] = slot[1]->Queue;
+      if (t == CANF_LIST32)
+      {
+        CANF_Bank(plan, fifo, 1U, 1U, CANQ_Key(slot[0]->Id), CANQ_Key(slot[1]->Id), queues, 2U);
+      }
+      else
+      {
+        CANF_Bank(plan, fifo, 0U, 0U, (CANF_Mask16(slot[0]) << 16) | CANF_Reg16(slot[0]->Id),
+                  (CANF_Mask16(slot[1]) << 16) | CANF_Reg16(slot[1]->Id), queues, 2U);
+      }
+    }
+  }
+
+  while (used[CANF_LIST16] < n[CANF_LIST16])
+  {
+    for (k = 0U; k < 4U; k++)
+    {
+      slot[k] = (used[CANF_LIST16] < n[CANF_LIST16]) ? &plan->Rules[kind[CANF_LIST16][used[CANF_LIST16]++]] :
+                slot[k - 1U];
+      queues[k] = slot[k]->Queue;
+    }
+    CANF_Bank(plan, fifo, 1U, 0U, (CANF_Reg16(slot[1]->Id) << 16) | CANF_Reg16(slot[0]->Id),
+              (CANF_Reg16(slot[3]->Id) << 16) | CANF_Reg16(slot[2]->Id), queues, 4U);
+  }
+}
+
+/**
+  * @brief  Append one bank and number its filters.
+  */
+static void CANF_Bank(CANF_PlanTypeDef *plan, uint8_t fifo, uint8_t list, uint8_t wide,
+                      uint32_t fr1, uint32_t fr2, const uint8_t *queues, uint32_t filters)
+{
+  uint32_t b = plan->Banks++;
+  uint32_t i;
+
+  plan->Fr1[b] = fr1;
+  plan->Fr2[b] = fr2;
+  plan->Mode  |= (uint32_t)list << b;
+  plan->Scale |= (uint32_t)wide << b;
+  plan->Fifo  |= (uint32_t)fifo << b;
+  for (i = 0U; i < filters; i++)
+  {
+    plan->Queue[fifo][plan->Filters[fifo]++] = queues[i];
+  }
+}
@@ -0,0 +1,231 @@
+/**
+  ******************************************************************************
+  * @file    can_queue.c
+  * @brief   CAN frames, per-identifier receive rings and the transmit
+  *          priority queue.
+  ******************************************************************************
+  * The heap key is the identifier register bxCAN transmits from (TIxR
+  * without TXRQ):
+  *
+  *   STID[10:0] EXID[17:0] IDE RTR 0
+  *
+  * Comparing it as a number gives the bus arbitration order: a standard
+  * data frame beats its remote frame, which beats every extended frame with
+  * the same base identifier.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "can_queue.h"
+
+/* Private define ------------------------------------------------------------*/
+#define CANQ_RX_MASK        (CANQ_RX_DEPTH - 1U)
+
+#if (CANQ_RX_DEPTH & CANQ_RX_MASK) != 0U
+#error "CANQ_RX_DEPTH must be a power of two"
+#endif
+
+/** Keeps the compiler from moving slot accesses across the index update;
+    the core itself does not reorder them */
+#if defined(__GNUC__)
+#define CANQ_BARRIER()      __asm volatile ("" ::: "memory")
+#else
+#define CANQ_BARRIER()
+#endif
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t CANQ_Before(const CANQ_TxEntryTypeDef *a, const CANQ_TxEntryTypeDef *b);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Arbitration key of an identifier, also its TIxR value.
+  * @param  id: Identifier with CANQ_EXT and CANQ_RTR
+  * @retval Key, lower wins the bus
+  */
+uint32_t CANQ_Key(uint32_t id)
+{
+  uint32_t key;
+
+  if ((id & CANQ_EXT) != 0U)
+  {
+    key = ((id & CANQ_EXT_MASK) << 3) | 0x4U;
+  }
+  else
+  {
+    key = (id & CANQ_STD_MASK) << 21;
+  }
+  if ((id & CANQ_RTR) != 0U)
+  {
+    key |= 0x2U;
+  }
+  return key;
+}
+
+/**
+  * @brief  Empty a receive ring.
+  * @param  queue: Ring
+  * @retval None
+  */
+void CANQ_RxInit(CANQ_RxQueueTypeDef *queue)
+{
+  queue->Head = 0U;
+  queue->Tail = 0U;
+  queue->Dropped = 0U;
+}
+
+/**
+  * @brief  Add a frame. Producer side, one context only.
+  * @param  queue: Ring
+  * @param  frame: Copied in
+  * @retval 0 if the ring was full and the frame dropped
+  */
+uint8_t CANQ_Post(CANQ_RxQueueTypeDef *queue, const CANQ_FrameTypeDef *frame)
+{
+  uint32_t head = queue->Head;
+
+  if ((head - queue->Tail) >= CANQ_RX_DEPTH)
+  {
+    queue->Dropped++;
+    return 0U;
+  }
+  queue->Frames[head & CANQ_RX_MASK] = *frame;
+  CANQ_BARRIER();
+  queue->Head = head + 1U;
+  return 1U;
+}
+
+/**
+  * @brief  Take the oldest frame. Consumer side, one context only.
+  * @param  queue: Ring
+  * @param  frame: Receives it
+  * @retval 0 if the ring was empty
+  */
+uint8_t CANQ_Get(CANQ_RxQueueTypeDef *queue, CANQ_FrameTypeDef *frame)
+{
+  uint32_t tail = queue->Tail;
+
+  if (tail == queue->Head)
+  {
+    return 0U;
+  }
+  CANQ_BARRIER();
+  *frame = queue->Frames[tail & CANQ_RX_MASK];
+  CANQ_BARRIER();
+  queue->Tail = tail + 1U;
+  return 1U;
+}
+
+/**
+  * @brief  Empty the transmit queue.
+  * @param  queue: Queue
+  * @retval None
+  */
+void CANQ_TxInit(CANQ_TxQueueTypeDef *queue)
+{
+  queue->Count = 0U;
+  queue->Seq = 0U;
+}
+
+/**
+  * @brief  Queue a frame behind every frame that would win arbitration
+  *         against it, and behind older frames with the same identifier.
+  * @param  queue: Queue
+  * @param  frame: Copied in
+  * @retval 0 if the queue was full
+  */
+uint8_t CANQ_Push(CANQ_TxQueueTypeDef *queue, const CANQ_FrameTypeDef *frame)
+{
+  CANQ_TxEntryTypeDef entry;
+  uint32_t i = queue->Count;
+  uint32_t parent;
+
+  if (i >= CANQ_TX_DEPTH)
+  {
+    return 0U;
+  }
+  entry.Key = CANQ_Key(frame->Id);
+  entry.Seq = queue->Seq++;
+  entry.Frame = *frame;
+
+  /* Sift up */
+  while (i > 0U)
+  {
+    parent = (i - 1U) / 2U;
+    if (CANQ_Before(&entry, &queue->Entries[parent]) == 0U)
+    {
+      break;
+    }
+    queue->Entries[i] = queue->Entries[parent];
+    i = parent;
+  }
+  queue->Entries[i] = entry;
+  queue->Count++;
+  return 1U;
+}
+
+/**
+  * @brief  The frame to transmit next.
+  * @param  queue: Queue
+  * @retval Top entry, NULL if the queue is empty
+  */
+const CANQ_TxEntryTypeDef *CANQ_Peek(const CANQ_TxQueueTypeDef *queue)
+{
+  return (queue->Count != 0U) ? &queue->Entries[0] : (const CANQ_TxEntryTypeDef *)0;
+}
+
+/**
+  * @brief  Remove the top entry; does nothing on an empty queue.
+  * @param  queue: Queue
+  * @retval None
+  */
+void CANQ_Pop(CANQ_TxQueueTypeDef *queue)
+{
+  CANQ_TxEntryTypeDef last;
+  uint32_t i = 0U;
+  uint32_t child;
+
+  if (queue->Count == 0U)
+  {
+    return;
+  }
+  queue->Count--;
+  last = queue->Entries[queue->Count];
+
+  /* Sift the last entry down from the root */
+  for (;;)
+  {
+    child = (2U * i) + 1U;
+    if (child >= queue->Count)
+    {
+      break;
+    }
+    if (((child + 1U) < queue->Count) &&
+        (CANQ_Before(&queue->Entries[child + 1U], &queue->Entries[child]) != 0U))
+    {
+      child++;
+    }
+    if (CANQ_Before(&queue->Entries[child], &last) == 0U)
+    {
+      break;
+    }
+    queue->Entries[i] = queue->Entries[child];
+    i = child;
+  }
+  queue->Entries[i] = last;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Heap order: lower key first, then older first across the wrap.
+  * @retval 1 if a goes before b
+  */
+static uint8_t CANQ_Before(const CANQ_TxEntryTypeDef *a, const CANQ_TxEntryTypeDef *b)
+{
+  if (a->Key != b->Key)
+  {
+    return (a->Key < b->Key) ? 1U : 0U;
+  }
+  return ((int32_t)(a->Seq - b->Seq) < 0) ? 1U : 0U;
+}
@@ -0,0 +1,150 @@
+/**
+  ******************************************************************************
+  * @file    console_lz.c
+  * @brief   printMsg() output on USART3 compressed with LZSS.
+  ******************************************************************************
+  * Every write is compressed and flushed before it returns, so the console
+  * and the raw writes of other modules still come out in the order they
+  * were made; the window carries over between writes, which is where the
+  * ratio comes from on a console that repeats itself line after line. A
+  * frame is sent with one blocking transmit from a buffer that has room for
+  * the header in front of the payload.
+  *
+  * Not reentrant: printMsg() runs in the application task only. The window
+  * and the encoder take 4.3 KB of SRAM at the default window.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "console_lz.h"
+
+/* Private define ------------------------------------------------------------*/
+#define CONSOLE_LZ_HEADER           3U        /* Marker, window, length */
+
+/* Private variables ---------------------------------------------------------*/
+static UART_HandleTypeDef  *ConsoleLzUart;
+static LZSS_EncoderTypeDef ConsoleLzEncoder;
+static uint8_t             ConsoleLzWindow[LZSS_WINDOW_SIZE(CONSOLE_LZ_WINDOW_BITS)];
+static uint8_t             ConsoleLzFrame[CONSOLE_LZ_HEADER + CONSOLE_LZ_PAYLOAD_MAX];
+static uint32_t            ConsoleLzFrames;
+
+/* Private function prototypes -----------------------------------------------*/
+static void CONSOLE_LZ_Send(void);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Sets up the encoder; the first frame restarts the stream.
+  * @param  huart: Initialised UART handle
+  * @retval HAL_OK, or HAL_ERROR for a window out of range
+  */
+HAL_StatusTypeDef CONSOLE_LZ_Init(UART_HandleTypeDef *huart)
+{
+  if (LZSS_EncoderInit(&ConsoleLzEncoder, ConsoleLzWindow, CONSOLE_LZ_WINDOW_BITS,
+                       &ConsoleLzFrame[CONSOLE_LZ_HEADER], CONSOLE_LZ_PAYLOAD_MAX) != LZSS_OK)
+  {
+    return HAL_ERROR;
+  }
+  ConsoleLzUart = huart;
+  ConsoleLzFrames = 0U;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Compresses text and sends it, blocking until the last frame is out.
+  * @param  text: Console text, no 0x00 or 0x01 in it
+  * @param  length: Its length
+  * @retval None
+  */
+void CONSOLE_LZ_Write(const char *text, uint32_t length)
+{
+  const uint8_t *data = (const uint8_t *)text;
+  uint32_t taken;
+
+  if (ConsoleLzUart == NULL)
+  {
+    return;
+  }
+  if (ConsoleLzFrames >= CONSOLE_LZ_RESTART_FRAMES)
+  {
+    LZSS_EncoderReset(&ConsoleLzEncoder);
+    ConsoleLzFrames = 0U;
+  }
+
+  while (length != 0U)
+  {
+    taken = LZSS_Compress(&ConsoleLzEncoder, data, length);
+    data += taken;
+    length -= taken;
+    if (length != 0U)
+    {
+      CONSOLE_LZ_Send();
+    }
+  }
+  while (LZSS_Flush(&ConsoleLzEncoder) != 0U)
+  {
+    CONSOLE_LZ_Send();
+  }
+  CONSOLE_LZ_Send();
+}
+
+/**
+  * @brief  Sends binary the host decoder passes through as it is, behind a
+  *         CONSOLE_LZ_BINARY header; without CONSOLE_LZ just the data.
+  *         Works before CONSOLE_LZ_Init() too.
+  * @param  huart: Initialised UART handle
+  * @param  data: Bytes to send
+  * @param  length: Their number
+  * @retval HAL status of the first failing transmit
+  */
+HAL_StatusTypeDef CONSOLE_LZ_Binary(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t length)
+{
+#if CONSOLE_LZ
+  uint8_t header[3];
+  HAL_StatusTypeDef status;
+
+  header[0] = CONSOLE_LZ_BINARY;
+  header[1] = (uint8_t)length;
+  header[2] = (uint8_t)(length >> 8);
+  status = HAL_UART_Transmit(huart, header, sizeof(header), HAL_MAX_DELAY);
+  if (status != HAL_OK)
+  {
+    return status;
+  }
+#endif
+  return HAL_UART_Transmit(huart, (uint8_t *)data, length, HAL_MAX_DELAY);
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Sends the frame in the encoder's output buffer, if any.
+  * @retval None
+  */
+static void CONSOLE_LZ_Send(void)
+{
+  uint32_t length = LZSS_Frame(&ConsoleLzEncoder);
+  uint8_t *frame;
+
+  if (length == 0U)
+  {
+    return;
+  }
+
+  /* Header right in front of the payload */
+  ConsoleLzFrame[CONSOLE_LZ_HEADER - 1U] = (uint8_t)length;
+  if (ConsoleLzFrames == 0U)
+  {
+    frame = &ConsoleLzFrame[0];
+    frame[0] = CONSOLE_LZ_RESTART;
+    frame[1] = (uint8_t)CONSOLE_LZ_WINDOW_BITS;
+  }
+  else
+  {
+    frame = &ConsoleLzFrame[1];
+    frame[0] = CONSOLE_LZ_CONTINUE;
+  }
+  ConsoleLzFrames++;
+  (void)HAL_UART_Transmit(ConsoleLzUart, frame,
+                          (uint16_t)(&ConsoleLzFrame[CONSOLE_LZ_HEADER + length] - frame), HAL_MAX_DELAY);
+}
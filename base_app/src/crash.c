@@ -0,0 +1,460 @@
+/**
+  ******************************************************************************
+  * @file    crash.c
+  * @brief   Fault capture record: frame unwinding, integrity check and the
+  *          boot-time crash report.
+  ******************************************************************************
+  * A report reads, one line at a time:
+  *
+  *   crash 2: BusFault, PRECISERR BFARVALID
+  *   guard: app stack overflow at 0x20001F9C
+  *   pc 0x08000F3A lr 0x08000E11 msp 0x2001FFB8 psr 0x21000000
+  *   r0 0x40021000 r1 0x00000000 r2 0x00000001 r3 0x2000001C r12 0x00000000
+  *   cfsr 0x00008200 hfsr 0x00000000 mmfar 0xE000EDF4 bfar 0x40021000
+  *   trace: 32 events kept, 7 earlier lost
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "crash.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CRASH_EXC_RETURN_PSP    0x04U         /* Return to thread mode, PSP     */
+#define CRASH_EXC_RETURN_BASIC  0x10U         /* Clear: extended FP frame       */
+#define CRASH_XPSR_ALIGNED      0x00000200U   /* Frame was padded to 8 bytes    */
+
+#define CRASH_FRAME_BASIC       0x20U         /* R0-R3, R12, LR, PC, xPSR       */
+#define CRASH_FRAME_EXTENDED    0x68U         /* ... plus S0-S15, FPSCR, pad    */
+
+/* Report lines */
+#define CRASH_LINE_HEAD         0U
+#define CRASH_LINE_GUARD        1U
+#define CRASH_LINE_PC           2U
+#define CRASH_LINE_REGS         3U
+#define CRASH_LINE_NOFRAME      4U
+#define CRASH_LINE_FAULT        5U
+#define CRASH_LINE_TRACE        6U
+#define CRASH_LINE_END          7U
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t    Mask;
+  const char *Name;
+} CRASH_BitTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static const CRASH_BitTypeDef CrashHfsrBits[] =
+{
+  { 0x00000002U, "VECTTBL"     },
+  { 0x40000000U, "FORCED"      },
+  { 0x80000000U, "DEBUGEVT"    }
+};
+
+static const CRASH_BitTypeDef CrashCfsrBits[] =
+{
+  /* MemManage */
+  { 0x00000001U, "IACCVIOL"    },
+  { 0x00000002U, "DACCVIOL"    },
+  { 0x00000008U, "MUNSTKERR"   },
+  { 0x00000010U, "MSTKERR"     },
+  { 0x00000020U, "MLSPERR"     },
+  { 0x00000080U, "MMARVALID"   },
+  /* BusFault */
+  { 0x00000100U, "IBUSERR"     },
+  { 0x00000200U, "PRECISERR"   },
+  { 0x00000400U, "IMPRECISERR" },
+  { 0x00000800U, "UNSTKERR"    },
+  { 0x00001000U, "STKERR"      },
+  { 0x00002000U, "LSPERR"      },
+  { 0x00008000U, "BFARVALID"   },
+  /* UsageFault */
+  { 0x00010000U, "UNDEFINSTR"  },
+  { 0x00020000U, "INVSTATE"    },
+  { 0x00040000U, "INVPC"       },
+  { 0x00080000U, "NOCP"        },
+  { 0x01000000U, "UNALIGNED"   },
+  { 0x02000000U, "DIVBYZERO"   }
+};
+
+static const uint8_t CrashLinesFrame[]   = { CRASH_LINE_HEAD, CRASH_LINE_GUARD, CRASH_LINE_PC,
+                                             CRASH_LINE_REGS, CRASH_LINE_FAULT, CRASH_LINE_TRACE,
+                                             CRASH_LINE_END };
+static const uint8_t CrashLinesNoFrame[] = { CRASH_LINE_HEAD, CRASH_LINE_GUARD, CRASH_LINE_NOFRAME,
+                                             CRASH_LINE_FAULT, CRASH_LINE_TRACE, CRASH_LINE_END };
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t CRASH_Checksum(const CRASH_RecordTypeDef *record);
+static uint8_t  CRASH_HasLine(const CRASH_RecordTypeDef *record, uint8_t line);
+static uint32_t CRASH_AppendBits(uint32_t value, const CRASH_BitTypeDef *bits, uint32_t count,
+                                 char *out, uint32_t size, uint32_t len);
+static uint32_t CRASH_Length(int n, uint32_t size);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Fill a record from the state found on fault handler entry.
+  *         The fault counter carries on from a valid previous record.
+  * @param  record: Record to overwrite
+  * @param  exception: Active exception number (IPSR)
+  * @param  exc_return: LR on handler entry
+  * @param  sp: Address of the stacked frame
+  * @param  frame: The stacked frame, NULL if it could not be read
+  * @param  regs: Fault status and address registers
+  * @retval None
+  */
+void CRASH_Capture(CRASH_RecordTypeDef *record, uint32_t exception, uint32_t exc_return,
+                   uint32_t sp, const uint32_t *frame, const CRASH_FaultRegsTypeDef *regs)
+{
+  uint32_t count = (CRASH_IsValid(record) != 0U) ? record->Count + 1U : 1U;
+
+  memset(record, 0, sizeof(*record));
+  record->Magic     = CRASH_MAGIC;
+  record->Count     = count;
+  record->Exception = exception;
+  record->ExcReturn = exc_return;
+  record->Sp        = sp;
+  record->Regs      = *regs;
+
+  if ((exc_return & CRASH_EXC_RETURN_PSP) != 0U)
+  {
+    record->Flags |= CRASH_FLAG_PSP;
+  }
+  if ((exc_return & CRASH_EXC_RETURN_BASIC) == 0U)
+  {
+    record->Flags |= CRASH_FLAG_FPU;
+  }
+  if (frame != NULL)
+  {
+    memcpy(&record->Frame, frame, sizeof(record->Frame));
+    record->Flags |= CRASH_FLAG_FRAME;
+
+    /* Unwind to the stack pointer the faulting code was using */
+    record->Sp += ((record->Flags & CRASH_FLAG_FPU) != 0U) ? CRASH_FRAME_EXTENDED : CRASH_FRAME_BASIC;
+    if ((record->Frame.Xpsr & CRASH_XPSR_ALIGNED) != 0U)
+    {
+      record->Sp += 4U;
+    }
+  }
+}
+
+/**
+  * @brief  Name the MPU guard region the fault hit.
+  * @param  record: Record filled by CRASH_Capture()
+  * @param  name: Guard name, truncated to CRASH_GUARD_NAME_MAX - 1 characters
+  * @param  stack: 1 for a stack guard, 0 for the NULL guard
+  * @param  address: Faulting address, or the stack pointer of a stacking fault
+  * @retval None
+  */
+void CRASH_CaptureGuard(CRASH_RecordTypeDef *record, const char *name, uint8_t stack,
+                        uint32_t address)
+{
+  (void)strncpy(record->Guard, name, sizeof(record->Guard) - 1U);
+  record->Guard[sizeof(record->Guard) - 1U] = '\0';
+  record->GuardAddress = address;
+  record->Flags |= (stack != 0U) ? (CRASH_FLAG_GUARD | CRASH_FLAG_STACK) : CRASH_FLAG_GUARD;
+}
+
+/**
+  * @brief  Copy the newest trace records into the record, oldest first.
+  * @param  record: Record filled by CRASH_Capture()
+  * @param  ring: Trace ring, may never have been initialised
+  * @retval None
+  */
+void CRASH_CaptureTrace(CRASH_RecordTypeDef *record, const TRACE_RingTypeDef *ring)
+{
+  TRACE_DumpHeaderTypeDef header;
+  const TRACE_RecordTypeDef *span;
+  uint32_t keep;
+  uint32_t skip;
+  uint32_t count;
+  uint32_t part;
+  uint32_t i;
+  uint32_t n = 0U;
+
+  if (ring->Records == NULL)
+  {
+    return;
+  }
+  TRACE_DumpHeader(ring, &header);
+  keep = (header.Count < CRASH_TRACE_RECORDS) ? header.Count : CRASH_TRACE_RECORDS;
+  skip = header.Count - keep;
+
+  for (part = 0U; part < 2U; part++)
+  {
+    span = TRACE_Span(ring, part, &count);
+    /* A clock change left out still sets the rate of the records kept */
+    for (i = 0U; (i < count) && (i < skip); i++)
+    {
+      if ((span[i].Header >> 24) == TRACE_EV_CLOCK)
+      {
+        header.CpuHz = span[i].Payload;
+      }
+    }
+    if (skip >= count)
+    {
+      skip -= count;
+      continue;
+    }
+    memcpy(&record->Trace[n], span + skip, (count - skip) * sizeof(*span));
+    n += count - skip;
+    skip = 0U;
+  }
+
+  record->TraceHeader = header;
+  record->TraceHeader.Count = keep;
+  record->TraceHeader.Lost += header.Count - keep;
+}
+
+/**
+  * @brief  Seal a record after writing it.
+  * @param  record: Record
+  * @retval None
+  */
+void CRASH_Seal(CRASH_RecordTypeDef *record)
+{
+  record->Checksum = CRASH_Checksum(record);
+}
+
+/**
+  * @brief  Check that a record was written by CRASH_Seal(), reported or not.
+  * @param  record: Record
+  * @retval 1 if valid, 0 for garbage
+  */
+uint8_t CRASH_IsValid(const CRASH_RecordTypeDef *record)
+{
+  if ((record->Magic != CRASH_MAGIC) && (record->Magic != CRASH_MAGIC_REPORTED))
+  {
+    return 0U;
+  }
+  return (record->Checksum == CRASH_Checksum(record)) ? 1U : 0U;
+}
+
+/**
+  * @brief  Check for a crash that has not been reported yet.
+  * @param  record: Record
+  * @retval 1 if a report is due
+  */
+uint8_t CRASH_IsPending(const CRASH_RecordTypeDef *record)
+{
+  return ((record->Magic == CRASH_MAGIC) && (CRASH_IsValid(record) != 0U)) ? 1U : 0U;
+}
+
+/**
+  * @brief  Keep the record, and its fault count, but stop reporting it.
+  * @param  record: Valid record
+  * @retval None
+  */
+void CRASH_MarkReported(CRASH_RecordTypeDef *record)
+{
+  record->Magic = CRASH_MAGIC_REPORTED;
+  CRASH_Seal(record);
+}
+
+/**
+  * @brief  Name of a fault exception.
+  * @param  exception: Exception number
+  * @retval Name
+  */
+const char *CRASH_ExceptionName(uint32_t exception)
+{
+  switch (exception)
+  {
+    case CRASH_EXC_HARDFAULT:
+      return "HardFault";
+    case CRASH_EXC_MEMMANAGE:
+      return "MemManage";
+    case CRASH_EXC_BUSFAULT:
+      return "BusFault";
+    case CRASH_EXC_USAGEFAULT:
+      return "UsageFault";
+    default:
+      return "exception";
+  }
+}
+
+/**
+  * @brief  Names of the status bits set in HFSR and CFSR, space separated.
+  * @param  regs: Fault registers
+  * @param  out: Output buffer
+  * @param  size: Size of out
+  * @retval Number of characters written
+  */
+uint32_t CRASH_Causes(const CRASH_FaultRegsTypeDef *regs, char *out, uint32_t size)
+{
+  uint32_t len;
+
+  out[0] = '\0';
+  len = CRASH_AppendBits(regs->Hfsr, CrashHfsrBits, sizeof(CrashHfsrBits) / sizeof(CrashHfsrBits[0]),
+                         out, size, 0U);
+  len = CRASH_AppendBits(regs->Cfsr, CrashCfsrBits, sizeof(CrashCfsrBits) / sizeof(CrashCfsrBits[0]),
+                         out, size, len);
+  if (len == 0U)
+  {
+    len = CRASH_Length(snprintf(out, size, "no status"), size);
+  }
+  return len;
+}
+
+/**
+  * @brief  One line of the crash report, without line terminator.
+  * @param  record: Valid record
+  * @param  line: Line number, from 0
+  * @param  out: Output buffer, CRASH_LINE_MAX bytes hold any line
+  * @param  size: Size of out
+  * @retval Number of characters written, 0 past the last line
+  */
+uint32_t CRASH_FormatLine(const CRASH_RecordTypeDef *record, uint32_t line, char *out, uint32_t size)
+{
+  const uint8_t *lines = ((record->Flags & CRASH_FLAG_FRAME) != 0U) ? CrashLinesFrame : CrashLinesNoFrame;
+  const char *stack = ((record->Flags & CRASH_FLAG_PSP) != 0U) ? "psp" : "msp";
+  const CRASH_FrameTypeDef *f = &record->Frame;
+  char causes[CRASH_LINE_MAX];
+  uint32_t i;
+  int n;
+
+  /* Walk the line list, skipping lines with nothing to say, so a short
+     list never indexes past its end */
+  for (i = 0U; lines[i] != CRASH_LINE_END; i++)
+  {
+    if (CRASH_HasLine(record, lines[i]) != 0U)
+    {
+      if (line == 0U)
+      {
+        break;
+      }
+      line--;
+    }
+  }
+
+  switch (lines[i])
+  {
+    case CRASH_LINE_HEAD:
+      (void)CRASH_Causes(&record->Regs, causes, sizeof(causes));
+      n = snprintf(out, size, "crash %lu: %s, %s", (unsigned long)record->Count,
+                   CRASH_ExceptionName(record->Exception), causes);
+      break;
+    case CRASH_LINE_GUARD:
+      if ((record->Flags & CRASH_FLAG_STACK) != 0U)
+      {
+        n = snprintf(out, size, "guard: %s stack overflow at 0x%08lX", record->Guard,
+                     (unsigned long)record->GuardAddress);
+      }
+      else
+      {
+        n = snprintf(out, size, "guard: null pointer access at 0x%08lX", (unsigned long)record->GuardAddress);
+      }
+      break;
+    case CRASH_LINE_PC:
+      n = snprintf(out, size, "pc 0x%08lX lr 0x%08lX %s 0x%08lX psr 0x%08lX",
+                   (unsigned long)f->Pc, (unsigned long)f->Lr, stack,
+                   (unsigned long)record->Sp, (unsigned long)f->Xpsr);
+      break;
+    case CRASH_LINE_REGS:
+      n = snprintf(out, size, "r0 0x%08lX r1 0x%08lX r2 0x%08lX r3 0x%08lX r12 0x%08lX",
+                   (unsigned long)f->R0, (unsigned long)f->R1, (unsigned long)f->R2,
+                   (unsigned long)f->R3, (unsigned long)f->R12);
+      break;
+    case CRASH_LINE_NOFRAME:
+      n = snprintf(out, size, "stacked frame unreadable, %s 0x%08lX", stack, (unsigned long)record->Sp);
+      break;
+    case CRASH_LINE_FAULT:
+      n = snprintf(out, size, "cfsr 0x%08lX hfsr 0x%08lX mmfar 0x%08lX bfar 0x%08lX",
+                   (unsigned long)record->Regs.Cfsr, (unsigned long)record->Regs.Hfsr,
+                   (unsigned long)record->Regs.Mmfar, (unsigned long)record->Regs.Bfar);
+      break;
+    case CRASH_LINE_TRACE:
+      n = snprintf(out, size, "trace: %lu events kept, %lu earlier lost",
+                   (unsigned long)record->TraceHeader.Count, (unsigned long)record->TraceHeader.Lost);
+      break;
+    default:
+      out[0] = '\0';
+      n = 0;
+      break;
+  }
+  return CRASH_Length(n, size);
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  FNV-1a over the record after its Checksum field.
+  * @param  record: Record
+  * @retval Checksum
+  */
+static uint32_t CRASH_Checksum(const CRASH_RecordTypeDef *record)
+{
+  const uint8_t *p = (const uint8_t *)&record->Count;
+  const uint8_t *end = (const uint8_t *)(record + 1);
+  uint32_t hash = 2166136261U;
+
+  while (p < end)
+  {
+    hash ^= *p++;
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+/**
+  * @brief  Check that a report line has something to say.
+  * @param  record: Record
+  * @param  line: CRASH_LINE_xxx
+  * @retval 1 to print it, 0 to leave it out
+  */
+static uint8_t CRASH_HasLine(const CRASH_RecordTypeDef *record, uint8_t line)
+{
+  switch (line)
+  {
+    case CRASH_LINE_GUARD:
+      return ((record->Flags & CRASH_FLAG_GUARD) != 0U) ? 1U : 0U;
+    case CRASH_LINE_TRACE:
+      return (record->TraceHeader.Count != 0U) ? 1U : 0U;
+    default:
+      return 1U;
+  }
+}
+
+/**
+  * @brief  Append the names of the bits set in a register.
+  * @param  value: Register value
+  * @param  bits: Bit table
+  * @param  count: Entries in the table
+  * @param  out: Output buffer
+  * @param  size: Size of out
+  * @param  len: Characters already in out
+  * @retval New length
+  */
+static uint32_t CRASH_AppendBits(uint32_t value, const CRASH_BitTypeDef *bits, uint32_t count,
+                                 char *out, uint32_t size, uint32_t len)
+{
+  uint32_t i;
+
+  for (i = 0U; (i < count) && (len + 1U < size); i++)
+  {
+    if ((value & bits[i].Mask) != 0U)
+    {
+      len += CRASH_Length(snprintf(out + len, size - len, "%s%s", (len != 0U) ? " " : "", bits[i].Name),
+                          size - len);
+    }
+  }
+  return len;
+}
+
+/**
+  * @brief  Characters actually stored by a possibly truncated snprintf().
+  * @param  n: snprintf() return value
+  * @param  size: Buffer size passed to it
+  * @retval Length
+  */
+static uint32_t CRASH_Length(int n, uint32_t size)
+{
+  if ((n < 0) || (size == 0U))
+  {
+    return 0U;
+  }
+  return ((uint32_t)n < size) ? (uint32_t)n : (size - 1U);
+}
@@ -0,0 +1,154 @@
+/**
+  ******************************************************************************
+  * @file    crash_handler.c
+  * @brief   Fault capture into .noinit RAM, immediate reset, report on the
+  *          next boot.
+  ******************************************************************************
+  * The four fault handlers in stm32f4xx_it.c start with CRASH_FAULT_ENTRY().
+  * CRASH_HandleFault() runs on its own stack, copies the stacked frame only
+  * when it lies in RAM (a failed stacking leaves SP pointing anywhere),
+  * stores the fault registers and the tail of the trace ring, and resets.
+  * A MemManage status names the MPU guard (mpu_guard.c) that was hit.
+  * The whole capture takes a few microseconds instead of a power cycle.
+  *
+  * MemManage, BusFault and UsageFault are enabled so they are reported as
+  * themselves rather than escalated to HardFault, and division by zero
+  * traps instead of returning 0.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "crash_handler.h"
+#include "console_lz.h"
+#include "mpu_guard.h"
+#include "placement.h"
+#include "trace_recorder.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CRASH_FRAME_BYTES    0x20U
+#define CRASH_CFSR_MMFSR     0x000000FFU   /* MemManage status bits          */
+#define CRASH_CFSR_MMARVALID 0x00000080U
+
+/* Private variables ---------------------------------------------------------*/
+/* Not cleared by the startup code: survives the reset */
+CRASH_RecordTypeDef CrashRecord __attribute__((section(".noinit")));
+
+/* Referenced by name from CRASH_FAULT_ENTRY() */
+uint64_t CrashStack[CRASH_STACK_SIZE / 8];
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t CRASH_IsRam(uint32_t address, uint32_t size);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Route configurable faults to their own handlers.
+  * @retval None
+  */
+void CRASH_HANDLER_Init(void)
+{
+  SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk | SCB_SHCSR_BUSFAULTENA_Msk | SCB_SHCSR_USGFAULTENA_Msk;
+  SCB->CCR |= SCB_CCR_DIV_0_TRP_Msk;
+}
+
+/**
+  * @brief  Capture the crash record and reset. Entered from
+  *         CRASH_FAULT_ENTRY() only.
+  * @param  sp: Stack pointer holding the exception frame
+  * @param  exc_return: LR on handler entry
+  * @retval None
+  */
+CODE_COLD void CRASH_HandleFault(const uint32_t *sp, uint32_t exc_return)
+{
+  const MPU_REGION_EntryTypeDef *guard;
+  CRASH_FaultRegsTypeDef regs;
+  uint32_t address = (uint32_t)sp;
+
+  __disable_irq();
+  TraceEnabled = 0U;
+
+  regs.Cfsr  = SCB->CFSR;
+  regs.Hfsr  = SCB->HFSR;
+  regs.Mmfar = SCB->MMFAR;
+  regs.Bfar  = SCB->BFAR;
+
+  CRASH_Capture(&CrashRecord, __get_IPSR() & 0x1FFU, exc_return, address,
+                CRASH_IsRam(address, CRASH_FRAME_BYTES) ? sp : NULL, &regs);
+  if ((regs.Cfsr & CRASH_CFSR_MMFSR) != 0U)
+  {
+    /* A data access has an address; a failed push leaves SP at or below
+       the guard instead */
+    if ((regs.Cfsr & CRASH_CFSR_MMARVALID) != 0U)
+    {
+      address = regs.Mmfar;
+    }
+    guard = MPU_GUARD_Find(address);
+    if (guard != NULL)
+    {
+      CRASH_CaptureGuard(&CrashRecord, guard->Name, (guard->Kind == MPU_REGION_STACK) ? 1U : 0U, address);
+    }
+  }
+  CRASH_CaptureTrace(&CrashRecord, &TraceRing);
+  CRASH_Seal(&CrashRecord);
+
+  NVIC_SystemReset();
+}
+
+/**
+  * @brief  Report a crash captured before the last reset, once.
+  *         Sends the text report, then the saved trace as a dump for
+  *         tools/trace2json (in a pass-through block, console_lz.h).
+  * @param  huart: Initialised UART handle
+  * @retval 1 if a crash was reported
+  */
+uint8_t CRASH_HANDLER_Report(UART_HandleTypeDef *huart)
+{
+  char line[CRASH_LINE_MAX + 2U];
+  uint32_t len;
+  uint32_t i;
+
+  if (CRASH_IsPending(&CrashRecord) == 0U)
+  {
+    return 0U;
+  }
+  for (i = 0U; (len = CRASH_FormatLine(&CrashRecord, i, line, CRASH_LINE_MAX)) != 0U; i++)
+  {
+    line[len++] = '\r';
+    line[len++] = '\n';
+    (void)HAL_UART_Transmit(huart, (uint8_t *)line, (uint16_t)len, HAL_MAX_DELAY);
+  }
+  if (CrashRecord.TraceHeader.Count != 0U)
+  {
+    (void)CONSOLE_LZ_Binary(huart, (const uint8_t *)&CrashRecord.TraceHeader,
+                            (uint16_t)(sizeof(CrashRecord.TraceHeader) +
+                                       CrashRecord.TraceHeader.Count * sizeof(CrashRecord.Trace[0])));
+  }
+  CRASH_MarkReported(&CrashRecord);
+  return 1U;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Check that a block lies in SRAM1/SRAM2 or CCM RAM.
+  * @param  address: Start
+  * @param  size: Length in bytes
+  * @retval 1 if readable without a bus fault
+  */
+static uint8_t CRASH_IsRam(uint32_t address, uint32_t size)
+{
+  if ((address & 3U) != 0U)
+  {
+    return 0U;
+  }
+  if ((address >= SRAM1_BASE) && (address + size <= SRAM1_BASE + 0x20000U))
+  {
+    return 1U;
+  }
+  if ((address >= CCMDATARAM_BASE) && (address + size <= CCMDATARAM_END + 1U))
+  {
+    return 1U;
+  }
+  return 0U;
+}
@@ -0,0 +1,304 @@
+/**
+  ******************************************************************************
+  * @file    cs43l22.c
+  * @brief   Non-blocking control of the CS43L22 audio codec over I2C1.
+  ******************************************************************************
+  * The power-up sequence runs as two queued batches. The first one holds the
+  * codec powered down, applies the "required initialization settings" of the
+  * datasheet and reads register 0x32; its completion callback patches bit 7
+  * of that value into the second batch (configuration and power-up). The
+  * caller never waits: CS43L22_GetState() tells when the codec is ready.
+  *
+  * This file also provides the AUDIO_STREAM_CodecConfig() hook, replacing
+  * the weak default of audio_stream.c that only releases the reset line.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "cs43l22.h"
+#include "i2c_bus.h"
+#include "audio_stream.h"
+
+/* Private define ------------------------------------------------------------*/
+#define CS43L22_REG_ID            0x01U
+#define CS43L22_REG_POWER_CTL1    0x02U
+#define CS43L22_REG_POWER_CTL2    0x04U
+#define CS43L22_REG_CLOCKING_CTL  0x05U
+#define CS43L22_REG_INTERFACE1    0x06U
+#define CS43L22_REG_ANALOG_ZC_SR  0x0AU
+#define CS43L22_REG_PCMA_VOL      0x1AU
+#define CS43L22_REG_PCMB_VOL      0x1BU
+#define CS43L22_REG_TONE_CTL      0x1FU
+#define CS43L22_REG_MASTER_A_VOL  0x20U
+#define CS43L22_REG_MASTER_B_VOL  0x21U
+#define CS43L22_REG_LIMIT_CTL1    0x27U
+#define CS43L22_REG_STATUS        0x2EU
+#define CS43L22_REG_MAP_INCR      0x80U   /* Auto-increment the register map */
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+  uint8_t Reg;
+  uint8_t Value;
+} CS43L22_RegTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+/* Phase 1: powered down, datasheet 4.11 unlock, then read 0x32 */
+static const CS43L22_RegTypeDef CodecPhase1[] =
+{
+  { CS43L22_REG_POWER_CTL1,   0x01U },
+  { 0x00U,                    0x99U },
+  { 0x47U,                    0x80U }
+};
+
+/* Phase 2: 0x32 bit 7 pulse, relock, configuration, power-up */
+static const CS43L22_RegTypeDef CodecPhase2[] =
+{
+  { 0x32U,                    0x00U },  /* read value | 0x80, patched      */
+  { 0x32U,                    0x00U },  /* read value & ~0x80, patched     */
+  { 0x00U,                    0x00U },
+  { CS43L22_REG_POWER_CTL2,   0xAFU },  /* headphone on, speaker off       */
+  { CS43L22_REG_CLOCKING_CTL, 0x81U },  /* auto-detect speed, MCLK / 2     */
+  { CS43L22_REG_INTERFACE1,   0x04U },  /* slave, I2S Philips, 16-bit      */
+  { CS43L22_REG_ANALOG_ZC_SR, 0x00U },
+  { CS43L22_REG_LIMIT_CTL1,   0x00U },
+  { CS43L22_REG_TONE_CTL,     0x0FU },
+  { CS43L22_REG_PCMA_VOL,     0x0AU },
+  { CS43L22_REG_PCMB_VOL,     0x0AU },
+  { CS43L22_REG_MASTER_A_VOL, 0x00U },  /* default volume, patched         */
+  { CS43L22_REG_MASTER_B_VOL, 0x00U },  /* default volume, patched         */
+  { CS43L22_REG_POWER_CTL1,   0x9EU }   /* power up                        */
+};
+
+#define CODEC_PHASE1_WRITES   (sizeof(CodecPhase1) / sizeof(CodecPhase1[0]))
+#define CODEC_PHASE2_WRITES   (sizeof(CodecPhase2) / sizeof(CodecPhase2[0]))
+
+static I2CQ_XferTypeDef CodecInit1[CODEC_PHASE1_WRITES + 1U];
+static I2CQ_XferTypeDef CodecInit2[CODEC_PHASE2_WRITES];
+static uint8_t          CodecValue1[CODEC_PHASE1_WRITES];
+static uint8_t          CodecValue2[CODEC_PHASE2_WRITES];
+static uint8_t          CodecReg32;
+
+static I2CQ_XferTypeDef CodecVolumeXfer;
+static uint8_t          CodecVolume[2];
+
+static I2CQ_XferTypeDef CodecPollXfer[2];
+static uint8_t          CodecChipId;
+static uint8_t          CodecStatus;
+
+static volatile uint8_t CodecState = CS43L22_RESET;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t CS43L22_VolumeRaw(uint8_t percent);
+static void CS43L22_Build(I2CQ_XferTypeDef *xfers, uint8_t *values,
+                          const CS43L22_RegTypeDef *regs, uint32_t count);
+static void CS43L22_XferDone(I2CQ_XferTypeDef *xfer);
+static void CS43L22_Phase1Done(I2CQ_XferTypeDef *xfer);
+static void CS43L22_Phase2Done(I2CQ_XferTypeDef *xfer);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Queue the power-up sequence. Returns immediately; the codec is
+  *         usable once CS43L22_GetState() reports CS43L22_READY.
+  * @retval I2CQ status of the first batch
+  */
+I2CQ_StatusTypeDef CS43L22_Init(void)
+{
+  I2CQ_StatusTypeDef status;
+
+  if (CodecState == CS43L22_BUSY)
+  {
+    return I2CQ_PENDING;
+  }
+
+  CS43L22_Build(CodecInit1, CodecValue1, CodecPhase1, CODEC_PHASE1_WRITES);
+  /* The codec may still be coming out of reset */
+  CodecInit1[0].Retries = 3U;
+  I2CQ_SetRead(&CodecInit1[CODEC_PHASE1_WRITES], CS43L22_I2C_ADDRESS, 0x32U, &CodecReg32, 1U);
+  CodecInit1[CODEC_PHASE1_WRITES].Retries = 1U;
+  CodecInit1[CODEC_PHASE1_WRITES].Callback = CS43L22_Phase1Done;
+
+  CodecState = CS43L22_BUSY;
+  status = I2C_BUS_Submit(CodecInit1, CODEC_PHASE1_WRITES + 1U);
+  if (status != I2CQ_OK)
+  {
+    CodecState = CS43L22_ERROR;
+  }
+  return status;
+}
+
+/**
+  * @brief  Set both master volume channels in one auto-increment write.
+  * @param  percent: 0..100
+  * @retval I2CQ status, I2CQ_INVALID while the previous change is on the bus
+  */
+I2CQ_StatusTypeDef CS43L22_SetVolume(uint8_t percent)
+{
+  if (CodecVolumeXfer.Status == I2CQ_PENDING)
+  {
+    return I2CQ_INVALID;
+  }
+
+  CodecVolume[0] = CS43L22_VolumeRaw(percent);
+  CodecVolume[1] = CodecVolume[0];
+  I2CQ_SetWrite(&CodecVolumeXfer, CS43L22_I2C_ADDRESS,
+                CS43L22_REG_MASTER_A_VOL | CS43L22_REG_MAP_INCR, CodecVolume, 2U);
+  CodecVolumeXfer.Retries = 1U;
+  CodecVolumeXfer.Callback = CS43L22_XferDone;
+  return I2C_BUS_Submit(&CodecVolumeXfer, 1U);
+}
+
+/**
+  * @brief  Queue a read of the chip ID and status registers, for a main
+  *         loop that wants to watch the codec. A poll still on the bus is
+  *         left alone.
+  * @retval I2CQ status
+  */
+I2CQ_StatusTypeDef CS43L22_Poll(void)
+{
+  if ((CodecPollXfer[0].Status == I2CQ_PENDING) || (CodecPollXfer[1].Status == I2CQ_PENDING))
+  {
+    return I2CQ_PENDING;
+  }
+
+  I2CQ_SetRead(&CodecPollXfer[0], CS43L22_I2C_ADDRESS, CS43L22_REG_ID, &CodecChipId, 1U);
+  I2CQ_SetRead(&CodecPollXfer[1], CS43L22_I2C_ADDRESS, CS43L22_REG_STATUS, &CodecStatus, 1U);
+  return I2C_BUS_Submit(CodecPollXfer, 2U);
+}
+
+/**
+  * @brief  Progress of the power-up sequence.
+  * @retval Codec state
+  */
+CS43L22_StateTypeDef CS43L22_GetState(void)
+{
+  return (CS43L22_StateTypeDef)CodecState;
+}
+
+/**
+  * @brief  Chip ID register as of the last completed poll.
+  * @retval Register 0x01, CS43L22_CHIP_ID in the top five bits
+  */
+uint8_t CS43L22_GetChipId(void)
+{
+  return CodecChipId;
+}
+
+/**
+  * @brief  Status register as of the last completed poll.
+  * @retval Register 0x2E (clock and overflow flags)
+  */
+uint8_t CS43L22_GetStatus(void)
+{
+  return CodecStatus;
+}
+
+/**
+  * @brief  Codec hook of the audio stream: take the codec out of reset and
+  *         queue its configuration, which completes in the background.
+  * @param  sample_rate: Unused, the codec detects the speed mode itself
+  * @retval None
+  */
+void AUDIO_STREAM_CodecConfig(uint32_t sample_rate)
+{
+  UNUSED(sample_rate);
+
+  HAL_GPIO_WritePin(GPIOD, GPIO_PIN_4, GPIO_PIN_SET);
+  if (I2C_BUS_Init() != HAL_OK)
+  {
+    CodecState = CS43L22_ERROR;
+    return;
+  }
+  (void)CS43L22_Init();
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Master volume register value for a percentage.
+  * @param  percent: 0..100
+  * @retval 0x00 is 0 dB, 0x19..0xFF count up from -102 dB in 0.5 dB steps
+  */
+static uint8_t CS43L22_VolumeRaw(uint8_t percent)
+{
+  uint32_t raw = (percent > 100U) ? 255U : ((uint32_t)percent * 255U) / 100U;
+
+  return (raw > 0xE6U) ? (uint8_t)(raw - 0xE7U) : (uint8_t)(raw + 0x19U);
+}
+
+/**
+  * @brief  Turn a register table into single-byte write descriptors.
+  * @param  xfers: Descriptors to fill
+  * @param  values: Writable copies of the register values
+  * @param  regs: Register table
+  * @param  count: Number of entries
+  * @retval None
+  */
+static void CS43L22_Build(I2CQ_XferTypeDef *xfers, uint8_t *values,
+                          const CS43L22_RegTypeDef *regs, uint32_t count)
+{
+  uint32_t i;
+
+  for (i = 0U; i < count; i++)
+  {
+    values[i] = regs[i].Value;
+    I2CQ_SetWrite(&xfers[i], CS43L22_I2C_ADDRESS, regs[i].Reg, &values[i], 1U);
+    xfers[i].Retries = 1U;
+    xfers[i].Callback = CS43L22_XferDone;
+  }
+}
+
+/**
+  * @brief  Any codec transaction: a final failure marks the codec broken.
+  * @param  xfer: Completed descriptor
+  * @retval None
+  */
+static void CS43L22_XferDone(I2CQ_XferTypeDef *xfer)
+{
+  if (xfer->Status != I2CQ_OK)
+  {
+    CodecState = CS43L22_ERROR;
+  }
+}
+
+/**
+  * @brief  Register 0x32 is in: queue phase 2 with its bit 7 pulse.
+  *         Runs in the I2C interrupt.
+  * @param  xfer: The read descriptor
+  * @retval None
+  */
+static void CS43L22_Phase1Done(I2CQ_XferTypeDef *xfer)
+{
+  CS43L22_XferDone(xfer);
+  if (CodecState == CS43L22_ERROR)
+  {
+    return;
+  }
+
+  CS43L22_Build(CodecInit2, CodecValue2, CodecPhase2, CODEC_PHASE2_WRITES);
+  CodecValue2[0] = CodecReg32 | 0x80U;
+  CodecValue2[1] = CodecReg32 & (uint8_t)~0x80U;
+  CodecValue2[CODEC_PHASE2_WRITES - 3U] = CS43L22_VolumeRaw(CS43L22_DEFAULT_VOLUME);
+  CodecValue2[CODEC_PHASE2_WRITES - 2U] = CodecValue2[CODEC_PHASE2_WRITES - 3U];
+  CodecInit2[CODEC_PHASE2_WRITES - 1U].Callback = CS43L22_Phase2Done;
+
+  if (I2C_BUS_Submit(CodecInit2, CODEC_PHASE2_WRITES) != I2CQ_OK)
+  {
+    CodecState = CS43L22_ERROR;
+  }
+}
+
+/**
+  * @brief  Power-up write done: the codec is ready unless something failed.
+  * @param  xfer: The power-up descriptor
+  * @retval None
+  */
+static void CS43L22_Phase2Done(I2CQ_XferTypeDef *xfer)
+{
+  CS43L22_XferDone(xfer);
+  if (CodecState == CS43L22_BUSY)
+  {
+    CodecState = CS43L22_READY;
+  }
+}
@@ -0,0 +1,417 @@
+/**
+  ******************************************************************************
+  * @file    dac_stream.c
+  * @brief   Signal generator on DAC channel 2, clocked by TIM6 TRGO and fed
+  *          by circular DMA.
+  ******************************************************************************
+  * Data path on the STM32F4-Discovery:
+  *
+  *   table or stream buffer -> DMA1 Stream6 ch7 (DAC2, circular)
+  *     -> DAC_DHR12R2 -> PA5 (DAC_OUT2, buffered)
+  *
+  * TIM6 runs at the sample rate and its update event is TRGO; each trigger
+  * moves the held sample to the output and requests the next one by DMA.
+  * Channel 1 is left alone: its pin, PA4, is the codec's I2S3_WS.
+  *
+  * A table (a sine cycle, an arbitrary shape) loops with no interrupt at
+  * all. A stream (a chirp, or any fill function) refills the half buffer
+  * the DMA just left from its half-transfer and transfer-complete
+  * interrupts, so the CPU works once per DAC_STREAM_HALF samples, never
+  * per sample. A trigger the DMA misses sets DMAUDR2, which halts the
+  * channel's requests; the TIM6_DAC interrupt counts it and restarts the
+  * transfer.
+  *
+  * On a clock switch DAC_STREAM_ClockNotify() solves TIM6 again for the
+  * new clock. PSC and ARR are preloaded, so the rate changes at an update
+  * event and no sample period is cut short. There is no HAL DAC driver in
+  * this tree, so the DAC is programmed directly; DMA goes through the HAL.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "dac_stream.h"
+#include "clock_config.h"
+
+/* Private define ------------------------------------------------------------*/
+#define DAC_STREAM_CCM_START  0x10000000UL    /*!< No DMA access to CCM RAM   */
+#define DAC_STREAM_CCM_END    0x10010000UL
+
+/* Private variables ---------------------------------------------------------*/
+DMA_HandleTypeDef hdma_dac2;
+
+static uint16_t               DacBuffer[DAC_STREAM_SAMPLES];
+static const uint16_t        *DacTable;
+static DAC_STREAM_FillTypeDef DacFill;
+static void                  *DacContext;
+static DAC_WAVE_OscTypeDef    DacOsc;
+static DAC_WAVE_RateTypeDef   DacRate;
+static uint32_t               DacTimerHz;
+static uint32_t               DacSampleHz;
+static uint32_t               DacSamples;
+static volatile uint32_t      DacFills;
+static volatile uint32_t      DacUnderruns;
+static volatile uint32_t      DacDmaErrors;
+
+/* External variables --------------------------------------------------------*/
+extern TIM_HandleTypeDef htim6;
+
+/* Private function prototypes -----------------------------------------------*/
+static void              DAC_STREAM_MspInit(void);
+static HAL_StatusTypeDef DAC_STREAM_Start(const uint16_t *table, uint32_t samples, uint32_t sample_hz);
+static HAL_StatusTypeDef DAC_STREAM_StartDma(void);
+static void              DAC_STREAM_Retime(void);
+static void              DAC_STREAM_OscFill(void *context, uint16_t *block, uint32_t samples);
+static void              DAC_STREAM_HalfCplt(DMA_HandleTypeDef *hdma);
+static void              DAC_STREAM_Cplt(DMA_HandleTypeDef *hdma);
+static void              DAC_STREAM_Error(DMA_HandleTypeDef *hdma);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Configure DAC channel 2 on PA5 and its DMA stream. The output
+  *         holds mid-scale until something plays. Call after MX_TIM6_Init().
+  * @retval HAL status
+  */
+HAL_StatusTypeDef DAC_STREAM_Init(void)
+{
+  DAC_STREAM_MspInit();
+
+  /* DMA1 Stream6 channel 7 is DAC2 */
+  hdma_dac2.Instance = DMA1_Stream6;
+  hdma_dac2.Init.Channel = DMA_CHANNEL_7;
+  hdma_dac2.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_dac2.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_dac2.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_dac2.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_dac2.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  hdma_dac2.Init.Mode = DMA_CIRCULAR;
+  hdma_dac2.Init.Priority = DMA_PRIORITY_MEDIUM;
+  hdma_dac2.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_dac2) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  hdma_dac2.XferHalfCpltCallback = DAC_STREAM_HalfCplt;
+  hdma_dac2.XferCpltCallback = DAC_STREAM_Cplt;
+  hdma_dac2.XferErrorCallback = DAC_STREAM_Error;
+
+  DacTimerHz = CLOCK_CONFIG_TIM_APB1_HZ;
+  DacSampleHz = 0U;
+  DacFills = 0U;
+  DacUnderruns = 0U;
+  DacDmaErrors = 0U;
+
+  /* TIM6 reloads from the preload registers, so a new rate waits for an
+   * update event */
+  htim6.Instance->CR1 |= TIM_CR1_ARPE;
+
+  /* Untriggered for now, so mid-scale reaches the pin at once; TSEL2 = 000
+   * picks TIM6 TRGO when TEN2 is set. Output buffer on. */
+  DAC->DHR12R2 = DAC_WAVE_MID;
+  DAC->CR = DAC_CR_EN2;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Loop a table of samples with no CPU involvement.
+  * @param  table: 12-bit codes, right-aligned; not in CCM RAM, which the
+  *         DMA cannot reach. Must stay valid until stopped.
+  * @param  samples: Table length, 1 to 65535
+  * @param  sample_hz: Conversion rate, up to DAC_WAVE_MAX_RATE
+  * @retval HAL_ERROR for a table or rate that cannot be played
+  */
+HAL_StatusTypeDef DAC_STREAM_PlayTable(const uint16_t *table, uint32_t samples, uint32_t sample_hz)
+{
+  if (((uint32_t)table >= DAC_STREAM_CCM_START) && ((uint32_t)table < DAC_STREAM_CCM_END))
+  {
+    return HAL_ERROR;
+  }
+  DAC_STREAM_Stop();
+  return DAC_STREAM_Start(table, samples, sample_hz);
+}
+
+/**
+  * @brief  Loop one cycle of a sine, as many samples as the buffer and the
+  *         conversion rate allow.
+  * @param  hz: Frequency, up to DAC_WAVE_MAX_RATE / DAC_STREAM_MIN_CYCLE
+  * @param  amplitude: Peak, DAC codes
+  * @param  offset: Centre, DAC codes
+  * @retval HAL_ERROR for a frequency out of range
+  */
+HAL_StatusTypeDef DAC_STREAM_PlaySine(uint32_t hz, uint16_t amplitude, uint16_t offset)
+{
+  uint32_t samples;
+
+  if (hz == 0U)
+  {
+    return HAL_ERROR;
+  }
+  samples = DAC_WAVE_MAX_RATE / hz;
+  if (samples > DAC_STREAM_SAMPLES)
+  {
+    samples = DAC_STREAM_SAMPLES;
+  }
+  if (samples < DAC_STREAM_MIN_CYCLE)
+  {
+    return HAL_ERROR;
+  }
+  DAC_STREAM_Stop();
+  (void)DAC_WAVE_Sine(DacBuffer, samples, 1U, amplitude, offset);
+  return DAC_STREAM_Start(DacBuffer, samples, hz * samples);
+}
+
+/**
+  * @brief  Stream a linear chirp from f0_hz to f1_hz, repeating every
+  *         sweep_ms; a steady tone when the two are equal.
+  * @param  f0_hz: Start frequency
+  * @param  f1_hz: End frequency
+  * @param  sweep_ms: Sweep length
+  * @param  amplitude: Peak, DAC codes
+  * @param  offset: Centre, DAC codes
+  * @param  sample_hz: Conversion rate; both frequencies at most half of it
+  * @retval HAL_ERROR for a rate or frequency out of range
+  */
+HAL_StatusTypeDef DAC_STREAM_PlayChirp(uint32_t f0_hz, uint32_t f1_hz, uint32_t sweep_ms,
+                                       uint16_t amplitude, uint16_t offset, uint32_t sample_hz)
+{
+  DAC_STREAM_Stop();
+  if (DAC_WAVE_OscInit(&DacOsc, sample_hz, f0_hz, f1_hz, sweep_ms, amplitude, offset) != DAC_WAVE_OK)
+  {
+    return HAL_ERROR;
+  }
+  return DAC_STREAM_PlayStream(DAC_STREAM_OscFill, &DacOsc, sample_hz);
+}
+
+/**
+  * @brief  Stream samples from a fill function, DAC_STREAM_HALF at a time.
+  *         Both halves are filled before the DMA starts.
+  * @param  fill: Renders the next samples, from the DMA interrupt
+  * @param  context: Passed to fill
+  * @param  sample_hz: Conversion rate, up to DAC_WAVE_MAX_RATE
+  * @retval HAL_ERROR for a rate out of range
+  */
+HAL_StatusTypeDef DAC_STREAM_PlayStream(DAC_STREAM_FillTypeDef fill, void *context, uint32_t sample_hz)
+{
+  if (fill == NULL)
+  {
+    return HAL_ERROR;
+  }
+  DAC_STREAM_Stop();
+  DacContext = context;
+  fill(context, DacBuffer, DAC_STREAM_SAMPLES);
+  DacFill = fill;
+  return DAC_STREAM_Start(DacBuffer, DAC_STREAM_SAMPLES, sample_hz);
+}
+
+/**
+  * @brief  Stop the trigger and the DMA. The output keeps the last sample.
+  * @retval None
+  */
+void DAC_STREAM_Stop(void)
+{
+  htim6.Instance->CR1 &= ~TIM_CR1_CEN;
+  DAC->CR &= ~(DAC_CR_DMAEN2 | DAC_CR_DMAUDRIE2 | DAC_CR_TEN2);
+  if (hdma_dac2.State == HAL_DMA_STATE_BUSY)
+  {
+    (void)HAL_DMA_Abort(&hdma_dac2);
+  }
+  DacFill = NULL;
+  DacSampleHz = 0U;
+}
+
+/**
+  * @brief  Snapshot of the generator's rate and counters.
+  * @param  stats: Filled in
+  * @retval None
+  */
+void DAC_STREAM_GetStats(DAC_StreamStatsTypeDef *stats)
+{
+  stats->SampleHz  = DacSampleHz;
+  stats->ActualHz  = (DacSampleHz != 0U) ? DacRate.ActualHz : 0U;
+  stats->ErrorPpm  = (DacSampleHz != 0U) ? DacRate.ErrorPpm : 0;
+  stats->Samples   = (DacSampleHz != 0U) ? DacSamples : 0U;
+  stats->Fills     = DacFills;
+  stats->Underruns = DacUnderruns;
+  stats->DmaErrors = DacDmaErrors;
+}
+
+/**
+  * @brief  DVFS callback: after a switch, solve TIM6 for the new timer
+  *         clock. Register with POWER_Register().
+  * @retval DVFS_OK, never vetoes
+  */
+DVFS_StatusTypeDef DAC_STREAM_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                          const DVFS_PointTypeDef *point)
+{
+  (void)context;
+  if (event == DVFS_EV_POST)
+  {
+    DacTimerHz = DVFS_TimerClock(point, 1U);
+    if (DacSampleHz != 0U)
+    {
+      (void)DAC_WAVE_SolveRate(DacTimerHz, DacSampleHz, &DacRate);
+      DAC_STREAM_Retime();
+    }
+  }
+  return DVFS_OK;
+}
+
+/**
+  * @brief  DAC half of the TIM6_DAC interrupt: a trigger found no sample
+  *         waiting. The channel stops requesting until the transfer is
+  *         restarted.
+  * @retval None
+  */
+void DAC_STREAM_IRQHandler(void)
+{
+  if ((DAC->SR & DAC_SR_DMAUDR2) == 0U)
+  {
+    return;
+  }
+  DAC->CR &= ~DAC_CR_DMAEN2;
+  DAC->SR = DAC_SR_DMAUDR2;
+  DacUnderruns++;
+  if (DacSampleHz != 0U)
+  {
+    (void)HAL_DMA_Abort(&hdma_dac2);
+    (void)DAC_STREAM_StartDma();
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Clocks, pin and interrupt for DAC channel 2 and its DMA stream.
+  *         TIM6 and its interrupt are set up by MX_TIM6_Init().
+  * @retval None
+  */
+static void DAC_STREAM_MspInit(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  __HAL_RCC_DAC_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+
+  /**DAC GPIO Configuration
+  PA5     ------> DAC_OUT2
+  */
+  GPIO_InitStruct.Pin = GPIO_PIN_5;
+  GPIO_InitStruct.Mode = GPIO_MODE_ANALOG;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+  HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, DAC_STREAM_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+}
+
+/**
+  * @brief  Set TIM6 to the rate and start the DMA and the trigger.
+  *         Everything is stopped on entry.
+  * @param  table: Samples to loop
+  * @param  samples: Loop length
+  * @param  sample_hz: Conversion rate
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef DAC_STREAM_Start(const uint16_t *table, uint32_t samples, uint32_t sample_hz)
+{
+  TIM_TypeDef *tim = htim6.Instance;
+
+  if ((samples == 0U) || (samples > 0xFFFFU) ||
+      (DAC_WAVE_SolveRate(DacTimerHz, sample_hz, &DacRate) != DAC_WAVE_OK))
+  {
+    DacFill = NULL;
+    return HAL_ERROR;
+  }
+  DacTable = table;
+  DacSamples = samples;
+  DacSampleHz = sample_hz;
+
+  /* Load the new rate now and start counting from zero */
+  DAC_STREAM_Retime();
+  tim->CR1 |= TIM_CR1_URS;
+  tim->EGR  = TIM_EGR_UG;
+  tim->CR1 &= ~TIM_CR1_URS;
+
+  if (DAC_STREAM_StartDma() != HAL_OK)
+  {
+    DacFill = NULL;
+    DacSampleHz = 0U;
+    return HAL_ERROR;
+  }
+  tim->CR1 |= TIM_CR1_CEN;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Start the DMA on the current loop and let the DAC request.
+  *         Streams get the half-transfer and transfer-complete interrupts.
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef DAC_STREAM_StartDma(void)
+{
+  HAL_StatusTypeDef status;
+
+  DAC->SR = DAC_SR_DMAUDR2;
+  if (DacFill != NULL)
+  {
+    status = HAL_DMA_Start_IT(&hdma_dac2, (uint32_t)DacTable, (uint32_t)&DAC->DHR12R2, DacSamples);
+  }
+  else
+  {
+    status = HAL_DMA_Start(&hdma_dac2, (uint32_t)DacTable, (uint32_t)&DAC->DHR12R2, DacSamples);
+  }
+  if (status == HAL_OK)
+  {
+    DAC->CR |= DAC_CR_TEN2 | DAC_CR_DMAEN2 | DAC_CR_DMAUDRIE2;
+  }
+  return status;
+}
+
+/**
+  * @brief  Write the solved prescaler and reload to TIM6's preload
+  *         registers; they take effect at the next update event.
+  * @retval None
+  */
+static void DAC_STREAM_Retime(void)
+{
+  htim6.Instance->PSC = DacRate.Prescaler;
+  htim6.Instance->ARR = DacRate.Period;
+  htim6.Init.Prescaler = DacRate.Prescaler;
+  htim6.Init.Period = DacRate.Period;
+}
+
+/**
+  * @brief  Stream fill for DAC_STREAM_PlayChirp(): the next oscillator block.
+  * @retval None
+  */
+static void DAC_STREAM_OscFill(void *context, uint16_t *block, uint32_t samples)
+{
+  DAC_WAVE_OscRender((DAC_WAVE_OscTypeDef *)context, block, samples);
+}
+
+static void DAC_STREAM_HalfCplt(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+  if (DacFill != NULL)
+  {
+    DacFill(DacContext, DacBuffer, DAC_STREAM_HALF);
+    DacFills++;
+  }
+}
+
+static void DAC_STREAM_Cplt(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+  if (DacFill != NULL)
+  {
+    DacFill(DacContext, &DacBuffer[DAC_STREAM_HALF], DAC_STREAM_HALF);
+    DacFills++;
+  }
+}
+
+static void DAC_STREAM_Error(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+  DacDmaErrors++;
+}
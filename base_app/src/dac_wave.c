@@ -0,0 +1,285 @@
+/**
+  ******************************************************************************
+  * @file    dac_wave.c
+  * @brief   Waveform synthesis and conversion-rate solving for the DAC.
+  ******************************************************************************
+  * The sine is a quarter wave folded into all four quadrants: an odd 7th
+  * order polynomial in Q30, fitted for the least maximum error on the
+  * quarter, stays within 1 LSB of Q15 with no table and no floating point.
+  *
+  * The trigger timer divides its clock by (PSC + 1) * (ARR + 1). The solver
+  * walks up to DAC_WAVE_PSC_TRIES prescalers from the smallest that lets the
+  * reload reach the divisor, rounds the reload for each and keeps the
+  * closest rate; a smaller prescaler wins a tie, and an exact rate ends the
+  * search. The first prescaler alone is within 1 / (2 * ARR) of the rate.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "dac_wave.h"
+
+/* Private define ------------------------------------------------------------*/
+#define DAC_WAVE_QUARTER    0x40000000UL    /*!< Quarter turn, also Q30 one   */
+#define DAC_WAVE_PSC_TRIES  4096U           /*!< Bounds the solver's run time */
+
+/** sin(x * pi / 2) = x * (C1 + C3 x^2 + C5 x^4 + C7 x^6) on [0, 1], Q30 */
+#define DAC_WAVE_C1         1686624006LL
+#define DAC_WAVE_C3         (-693522168LL)
+#define DAC_WAVE_C5         85291981LL
+#define DAC_WAVE_C7         (-4652627LL)
+
+/* Private function prototypes -----------------------------------------------*/
+static uint64_t DAC_WAVE_Step(uint32_t hz, uint32_t sample_hz);
+static uint16_t DAC_WAVE_Code(int32_t value);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Trigger timer prescaler and reload closest to a sample rate.
+  * @param  timer_hz: Timer kernel clock
+  * @param  sample_hz: Wanted conversion rate
+  * @param  rate: Receives the setting
+  * @retval DAC_WAVE_INVALID for 0, above DAC_WAVE_MAX_RATE or above half
+  *         the timer clock
+  */
+DAC_WAVE_StatusTypeDef DAC_WAVE_SolveRate(uint32_t timer_hz, uint32_t sample_hz, DAC_WAVE_RateTypeDef *rate)
+{
+  uint64_t best_error = 0U;
+  uint64_t best_divisor = 1U;
+  uint64_t divisor;
+  uint64_t error;
+  uint64_t reload;
+  uint32_t psc;
+  uint32_t first;
+  uint8_t found = 0U;
+
+  if ((sample_hz == 0U) || (sample_hz > DAC_WAVE_MAX_RATE) || (sample_hz > (timer_hz / 2U)))
+  {
+    return DAC_WAVE_INVALID;
+  }
+  first = (uint32_t)(((uint64_t)timer_hz / sample_hz + DAC_WAVE_TIM_MAX - 1U) / DAC_WAVE_TIM_MAX);
+  first = (first == 0U) ? 1U : first;
+  for (psc = first; (psc <= DAC_WAVE_TIM_MAX) && ((psc - first) < DAC_WAVE_PSC_TRIES); psc++)
+  {
+    /* Reload for this prescaler, rounded; the counter needs at least 2 */
+    reload = ((uint64_t)timer_hz + ((uint64_t)sample_hz * psc) / 2U) / ((uint64_t)sample_hz * psc);
+    if (reload < 2U)
+    {
+      break;
+    }
+    if (reload > DAC_WAVE_TIM_MAX)
+    {
+      reload = DAC_WAVE_TIM_MAX;
+    }
+    divisor = reload * psc;
+    error = (divisor * sample_hz > timer_hz) ? (divisor * sample_hz - timer_hz) : (timer_hz - divisor * sample_hz);
+
+    /* Relative error error / divisor, compared without dividing */
+    if ((found == 0U) || ((error * best_divisor) < (best_error * divisor)))
+    {
+      best_error = error;
+      best_divisor = divisor;
+      rate->Prescaler = psc - 1U;
+      rate->Period = (uint32_t)reload - 1U;
+      found = 1U;
+      if (error == 0U)
+      {
+        break;
+      }
+    }
+  }
+
+  rate->ActualHz = (uint32_t)(((uint64_t)timer_hz + best_divisor / 2U) / best_divisor);
+  rate->ErrorPpm = (int32_t)(((int64_t)timer_hz - (int64_t)(best_divisor * sample_hz)) * 1000000LL /
+                             (int64_t)(best_divisor * sample_hz));
+  return DAC_WAVE_OK;
+}
+
+/**
+  * @brief  Sine of a phase.
+  * @param  phase: Fraction of a turn, 2^32 per turn
+  * @retval Q15, -32767 to 32767
+  */
+int32_t DAC_WAVE_Sin(uint32_t phase)
+{
+  uint32_t quadrant = phase >> 30;
+  int64_t x = (int64_t)(phase & (DAC_WAVE_QUARTER - 1U));
+  int64_t x2;
+  int64_t t;
+  int32_t value;
+
+  /* The second and fourth quarters run the first one backwards */
+  if ((quadrant & 1U) != 0U)
+  {
+    x = (int64_t)DAC_WAVE_QUARTER - x;
+  }
+  x2 = (x * x) >> 30;
+  t = DAC_WAVE_C5 + ((DAC_WAVE_C7 * x2) >> 30);
+  t = DAC_WAVE_C3 + ((t * x2) >> 30);
+  t = DAC_WAVE_C1 + ((t * x2) >> 30);
+  value = (int32_t)((((t * x) >> 30) + (1 << 14)) >> 15);
+  if (value > 32767)
+  {
+    value = 32767;
+  }
+  return ((quadrant & 2U) != 0U) ? -value : value;
+}
+
+/**
+  * @brief  Whole cycles of a sine in a table that loops seamlessly.
+  * @param  table: Output, samples codes
+  * @param  samples: Table length
+  * @param  cycles: Cycles over the table; at most samples / 2
+  * @param  amplitude: Peak, DAC codes
+  * @param  offset: Centre, DAC codes; the sum is clipped to the code range
+  * @retval DAC_WAVE_INVALID for an empty table or too many cycles
+  */
+DAC_WAVE_StatusTypeDef DAC_WAVE_Sine(uint16_t *table, uint32_t samples, uint32_t cycles,
+                                     uint16_t amplitude, uint16_t offset)
+{
+  uint32_t i;
+
+  if ((samples == 0U) || (cycles == 0U) || (cycles > (samples / 2U)))
+  {
+    return DAC_WAVE_INVALID;
+  }
+  for (i = 0U; i < samples; i++)
+  {
+    /* Exact phase per sample: no error builds up over the table */
+    table[i] = DAC_WAVE_Code((int32_t)offset +
+                             ((amplitude * DAC_WAVE_Sin((uint32_t)((((uint64_t)i * cycles) << 32) / samples))) >> 15));
+  }
+  return DAC_WAVE_OK;
+}
+
+/**
+  * @brief  An arbitrary waveform from points spaced evenly over one cycle,
+  *         joined by straight lines, the last back to the first.
+  * @param  table: Output, samples codes
+  * @param  samples: Table length
+  * @param  points: Codes, the first at the start of the table
+  * @param  count: Number of points, at most samples
+  * @retval DAC_WAVE_INVALID for an empty table or too many points
+  */
+DAC_WAVE_StatusTypeDef DAC_WAVE_Shape(uint16_t *table, uint32_t samples, const uint16_t *points,
+                                      uint32_t count)
+{
+  uint64_t position;
+  uint32_t index;
+  uint32_t frac;
+  int32_t from;
+  int32_t to;
+  uint32_t i;
+
+  if ((samples == 0U) || (count == 0U) || (count > samples))
+  {
+    return DAC_WAVE_INVALID;
+  }
+  for (i = 0U; i < samples; i++)
+  {
+    /* Position in points, 16.16 */
+    position = (((uint64_t)i * count) << 16) / samples;
+    index = (uint32_t)(position >> 16);
+    frac = (uint32_t)(position & 0xFFFFU);
+    from = (int32_t)points[index];
+    to = (int32_t)points[(index + 1U) % count];
+    table[i] = DAC_WAVE_Code(from + (int32_t)(((int64_t)(to - from) * frac) >> 16));
+  }
+  return DAC_WAVE_OK;
+}
+
+/**
+  * @brief  Set up an oscillator: a tone when f0_hz equals f1_hz or
+  *         sweep_ms is 0, a chirp from f0_hz to f1_hz over sweep_ms otherwise.
+  * @param  osc: Oscillator
+  * @param  sample_hz: Rate the blocks are played at
+  * @param  f0_hz: Start frequency
+  * @param  f1_hz: End frequency
+  * @param  sweep_ms: Sweep length
+  * @param  amplitude: Peak, DAC codes
+  * @param  offset: Centre, DAC codes
+  * @retval DAC_WAVE_INVALID for a frequency above half the sample rate
+  */
+DAC_WAVE_StatusTypeDef DAC_WAVE_OscInit(DAC_WAVE_OscTypeDef *osc, uint32_t sample_hz, uint32_t f0_hz,
+                                        uint32_t f1_hz, uint32_t sweep_ms, uint16_t amplitude,
+                                        uint16_t offset)
+{
+  uint64_t length = ((uint64_t)sample_hz * sweep_ms) / 1000U;
+
+  if ((sample_hz == 0U) || (f0_hz > (sample_hz / 2U)) || (f1_hz > (sample_hz / 2U)) ||
+      (length > 0xFFFFFFFFUL))
+  {
+    return DAC_WAVE_INVALID;
+  }
+  osc->Phase = 0U;
+  osc->StartStep = DAC_WAVE_Step(f0_hz, sample_hz);
+  osc->Step = osc->StartStep;
+  osc->Sweep = 0;
+  osc->Length = 0U;
+  osc->Position = 0U;
+  osc->Amplitude = amplitude;
+  osc->Offset = offset;
+  if ((f0_hz != f1_hz) && (length != 0U))
+  {
+    osc->Length = (uint32_t)length;
+    osc->Sweep = ((int64_t)DAC_WAVE_Step(f1_hz, sample_hz) - (int64_t)osc->StartStep) / (int64_t)length;
+  }
+  return DAC_WAVE_OK;
+}
+
+/**
+  * @brief  Next block of an oscillator.
+  * @param  osc: Oscillator
+  * @param  block: Output, samples codes
+  * @param  samples: Block length
+  * @retval None
+  */
+void DAC_WAVE_OscRender(DAC_WAVE_OscTypeDef *osc, uint16_t *block, uint32_t samples)
+{
+  uint32_t i;
+
+  for (i = 0U; i < samples; i++)
+  {
+    block[i] = DAC_WAVE_Code((int32_t)osc->Offset +
+                             ((osc->Amplitude * DAC_WAVE_Sin((uint32_t)(osc->Phase >> 32))) >> 15));
+    osc->Phase += osc->Step;
+    if (osc->Length != 0U)
+    {
+      osc->Step = (uint64_t)((int64_t)osc->Step + osc->Sweep);
+      if (++osc->Position >= osc->Length)
+      {
+        osc->Position = 0U;
+        osc->Step = osc->StartStep;
+      }
+    }
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Phase step of a frequency, 32.32 turns per sample.
+  * @param  hz: Frequency, below sample_hz
+  * @param  sample_hz: Sample rate
+  * @retval Step
+  */
+static uint64_t DAC_WAVE_Step(uint32_t hz, uint32_t sample_hz)
+{
+  uint64_t whole = ((uint64_t)hz << 32) / sample_hz;
+  uint64_t rest = ((uint64_t)hz << 32) % sample_hz;
+
+  return (whole << 32) | ((rest << 32) / sample_hz);
+}
+
+/**
+  * @brief  Clip to the 12-bit code range.
+  * @retval Code
+  */
+static uint16_t DAC_WAVE_Code(int32_t value)
+{
+  if (value < 0)
+  {
+    return 0U;
+  }
+  return (value > (int32_t)DAC_WAVE_FULL) ? (uint16_t)DAC_WAVE_FULL : (uint16_t)value;
+}
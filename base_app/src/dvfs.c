@@ -0,0 +1,307 @@
+/**
+  ******************************************************************************
+  * @file    dvfs.c
+  * @brief   Operating points: clock math, switch plan, notifiers, governor.
+  ******************************************************************************
+  * Peripherals keep their rates across a switch by being re-derived from the
+  * new point: timer prescalers and the SysTick reload must divide exactly,
+  * the USART BRR is rounded (its error is what clock_tree.h reports).
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "dvfs.h"
+#include "clock_tree.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  AHB clock of an operating point.
+  * @param  point: Operating point
+  * @retval HCLK in Hz
+  */
+uint32_t DVFS_Hclk(const DVFS_PointTypeDef *point)
+{
+  return point->SysclkHz / point->AhbDiv;
+}
+
+/**
+  * @brief  APB clock of an operating point.
+  * @param  point: Operating point
+  * @param  apb: 1 or 2
+  * @retval PCLK in Hz
+  */
+uint32_t DVFS_Pclk(const DVFS_PointTypeDef *point, uint32_t apb)
+{
+  return DVFS_Hclk(point) / ((apb == 1U) ? point->Apb1Div : point->Apb2Div);
+}
+
+/**
+  * @brief  Timer kernel clock on an APB bus of an operating point.
+  * @param  point: Operating point
+  * @param  apb: 1 or 2
+  * @retval Timer clock in Hz
+  */
+uint32_t DVFS_TimerClock(const DVFS_PointTypeDef *point, uint32_t apb)
+{
+  return CLOCK_TIM_CLK(DVFS_Hclk(point), (uint32_t)((apb == 1U) ? point->Apb1Div : point->Apb2Div));
+}
+
+/**
+  * @brief  Timer prescaler for a counter tick rate.
+  * @param  timer_hz: Timer kernel clock
+  * @param  tick_hz: Wanted counter rate
+  * @param  psc: Receives the PSC register value
+  * @retval DVFS_INEXACT if the rate does not divide the clock, DVFS_INVALID
+  *         if it is out of the prescaler's range
+  */
+DVFS_StatusTypeDef DVFS_TimerPrescaler(uint32_t timer_hz, uint32_t tick_hz, uint32_t *psc)
+{
+  if ((tick_hz == 0U) || (tick_hz > timer_hz) || ((timer_hz / tick_hz) > 0x10000U))
+  {
+    return DVFS_INVALID;
+  }
+  *psc = CLOCK_TIM_PSC(timer_hz, tick_hz);
+  return CLOCK_TIM_EXACT(timer_hz, tick_hz) ? DVFS_OK : DVFS_INEXACT;
+}
+
+/**
+  * @brief  USART BRR at 16x oversampling, rounded to nearest.
+  * @param  pclk: USART bus clock
+  * @param  baud: Baud rate
+  * @retval BRR register value
+  */
+uint32_t DVFS_UartBrr(uint32_t pclk, uint32_t baud)
+{
+  return CLOCK_UART_BRR(pclk, baud);
+}
+
+/**
+  * @brief  SysTick reload for a tick rate on the processor clock.
+  * @param  hclk: Processor clock
+  * @param  tick_hz: Tick rate
+  * @param  reload: Receives the LOAD register value
+  * @retval DVFS_INEXACT if the rate does not divide the clock, DVFS_INVALID
+  *         if it does not fit the 24-bit counter
+  */
+DVFS_StatusTypeDef DVFS_SysTickReload(uint32_t hclk, uint32_t tick_hz, uint32_t *reload)
+{
+  if ((tick_hz == 0U) || (tick_hz > hclk) || ((hclk / tick_hz) - 1U > DVFS_SYSTICK_MAX))
+  {
+    return DVFS_INVALID;
+  }
+  *reload = (hclk / tick_hz) - 1U;
+  return ((hclk % tick_hz) == 0U) ? DVFS_OK : DVFS_INEXACT;
+}
+
+/**
+  * @brief  Check an operating point against the device limits.
+  * @param  point: Operating point
+  * @retval DVFS_INVALID if any limit is broken
+  */
+DVFS_StatusTypeDef DVFS_Validate(const DVFS_PointTypeDef *point)
+{
+  uint32_t hclk;
+  uint32_t ahb = point->AhbDiv;
+
+  if ((point->Name == NULL) || (point->SysclkHz == 0U) || (point->SysclkHz > CLOCK_SYSCLK_MAX) ||
+      (ahb == 0U) || ((ahb & (ahb - 1U)) != 0U) || (ahb == 32U) || (ahb > 512U) ||
+      (point->Apb1Div == 0U) || ((point->Apb1Div & (point->Apb1Div - 1U)) != 0U) || (point->Apb1Div > 16U) ||
+      (point->Apb2Div == 0U) || ((point->Apb2Div & (point->Apb2Div - 1U)) != 0U) || (point->Apb2Div > 16U))
+  {
+    return DVFS_INVALID;
+  }
+  hclk = DVFS_Hclk(point);
+  if ((DVFS_Pclk(point, 1U) > CLOCK_PCLK1_MAX) || (DVFS_Pclk(point, 2U) > CLOCK_PCLK2_MAX) ||
+      (point->FlashLatency < CLOCK_FLASH_LATENCY(hclk)) || (point->FlashLatency > 7U))
+  {
+    return DVFS_INVALID;
+  }
+  if ((point->VoltageScale == 2U) && ((point->UsePll != 0U) || (hclk > DVFS_SCALE2_MAX_HZ)))
+  {
+    return DVFS_INVALID;
+  }
+  return ((point->VoltageScale == 1U) || (point->VoltageScale == 2U)) ? DVFS_OK : DVFS_INVALID;
+}
+
+/**
+  * @brief  Order the steps of a switch: the regulator only changes with the
+  *         PLL off, and is raised before and lowered after the clocks.
+  * @param  from: Active point
+  * @param  to: Target point
+  * @param  steps: Receives the steps in execution order
+  * @retval Number of steps
+  */
+uint32_t DVFS_Plan(const DVFS_PointTypeDef *from, const DVFS_PointTypeDef *to,
+                   DVFS_StepTypeDef steps[DVFS_MAX_STEPS])
+{
+  uint32_t count = 0U;
+
+  if ((to->VoltageScale < from->VoltageScale) && (from->UsePll == 0U))
+  {
+    steps[count++] = DVFS_STEP_SCALE_UP;
+  }
+  if ((to->UsePll != 0U) && (from->UsePll == 0U))
+  {
+    steps[count++] = DVFS_STEP_PLL_ON;
+  }
+  steps[count++] = DVFS_STEP_CLOCKS;
+  if ((to->UsePll == 0U) && (from->UsePll != 0U))
+  {
+    steps[count++] = DVFS_STEP_PLL_OFF;
+  }
+  if (to->VoltageScale > from->VoltageScale)
+  {
+    steps[count++] = DVFS_STEP_SCALE_DOWN;
+  }
+  return count;
+}
+
+/**
+  * @brief  Set up the operating point table.
+  * @param  hdvfs: DVFS handle
+  * @param  points: Operating points, fastest first, must stay valid
+  * @param  count: Number of points
+  * @param  current: Index of the point the clocks are in now
+  * @retval DVFS_INVALID if a point breaks a device limit
+  */
+DVFS_StatusTypeDef DVFS_Init(DVFS_HandleTypeDef *hdvfs, const DVFS_PointTypeDef *points,
+                             uint32_t count, uint32_t current)
+{
+  uint32_t i;
+
+  memset(hdvfs, 0, sizeof(*hdvfs));
+  if ((points == NULL) || (current >= count))
+  {
+    return DVFS_INVALID;
+  }
+  for (i = 0U; i < count; i++)
+  {
+    if (DVFS_Validate(&points[i]) != DVFS_OK)
+    {
+      return DVFS_INVALID;
+    }
+  }
+  hdvfs->Points  = points;
+  hdvfs->Count   = count;
+  hdvfs->Current = current;
+  return DVFS_OK;
+}
+
+/**
+  * @brief  Add a driver to be told about every switch.
+  * @param  hdvfs: DVFS handle
+  * @param  callback: Called with DVFS_EV_PRE and DVFS_EV_POST
+  * @param  context: Passed to the callback
+  * @retval DVFS_FULL with DVFS_MAX_NOTIFIERS drivers
+  */
+DVFS_StatusTypeDef DVFS_Register(DVFS_HandleTypeDef *hdvfs, DVFS_CallbackTypeDef callback, void *context)
+{
+  if (callback == NULL)
+  {
+    return DVFS_INVALID;
+  }
+  if (hdvfs->NotifierCount >= DVFS_MAX_NOTIFIERS)
+  {
+    return DVFS_FULL;
+  }
+  hdvfs->Notifiers[hdvfs->NotifierCount].Callback = callback;
+  hdvfs->Notifiers[hdvfs->NotifierCount].Context  = context;
+  hdvfs->NotifierCount++;
+  return DVFS_OK;
+}
+
+/**
+  * @brief  Tell the drivers about a switch. DVFS_EV_PRE stops at the first
+  *         veto; DVFS_EV_POST, sent once the clocks are in the new point,
+  *         makes it the current one.
+  * @param  hdvfs: DVFS handle
+  * @param  event: DVFS_EV_PRE or DVFS_EV_POST
+  * @param  index: Target point
+  * @retval DVFS_BUSY if a driver vetoed
+  */
+DVFS_StatusTypeDef DVFS_Notify(DVFS_HandleTypeDef *hdvfs, DVFS_EventTypeDef event, uint32_t index)
+{
+  const DVFS_PointTypeDef *point;
+  uint32_t i;
+
+  if (index >= hdvfs->Count)
+  {
+    return DVFS_INVALID;
+  }
+  point = &hdvfs->Points[index];
+  if (event == DVFS_EV_POST)
+  {
+    hdvfs->Current = index;
+    hdvfs->Switches++;
+  }
+  for (i = 0U; i < hdvfs->NotifierCount; i++)
+  {
+    if ((hdvfs->Notifiers[i].Callback(hdvfs->Notifiers[i].Context, event, point) != DVFS_OK) &&
+        (event == DVFS_EV_PRE))
+    {
+      hdvfs->Vetoes++;
+      return DVFS_BUSY;
+    }
+  }
+  return DVFS_OK;
+}
+
+/**
+  * @brief  Set up the load governor.
+  * @param  gov: Governor
+  * @param  up_permille: Load at or above which to go to point 0
+  * @param  down_permille: Load below which to step one point down
+  * @param  floor: Slowest point index to use
+  * @retval None
+  */
+void DVFS_GovernorInit(DVFS_GovernorTypeDef *gov, uint16_t up_permille, uint16_t down_permille,
+                       uint32_t floor)
+{
+  memset(gov, 0, sizeof(*gov));
+  gov->UpPermille   = up_permille;
+  gov->DownPermille = down_permille;
+  gov->Floor        = floor;
+}
+
+/**
+  * @brief  Pick the point for the next window from the load of the last.
+  * @param  gov: Governor
+  * @param  current: Active point index
+  * @param  total: Free-running count of load samples (e.g. ticks)
+  * @param  idle: Free-running count of samples that found the CPU idle
+  * @retval Point index to switch to, current to stay
+  */
+uint32_t DVFS_GovernorUpdate(DVFS_GovernorTypeDef *gov, uint32_t current, uint32_t total, uint32_t idle)
+{
+  uint32_t window = total - gov->LastTotal;
+  uint32_t quiet = idle - gov->LastIdle;
+
+  gov->LastTotal = total;
+  gov->LastIdle  = idle;
+  if (window == 0U)
+  {
+    return current;
+  }
+  if (quiet > window)
+  {
+    quiet = window;
+  }
+  gov->Load = (uint16_t)(1000U - (uint32_t)(((uint64_t)quiet * 1000U) / window));
+
+  if (gov->Load >= gov->UpPermille)
+  {
+    return 0U;
+  }
+  if (current > gov->Floor)
+  {
+    return gov->Floor;
+  }
+  if ((gov->Load < gov->DownPermille) && (current < gov->Floor))
+  {
+    return current + 1U;
+  }
+  return current;
+}
@@ -0,0 +1,358 @@
+/**
+  ******************************************************************************
+  * @file    fixmath.c
+  * @brief   Q15/Q31 trigonometry, square root and reciprocal without libm.
+  ******************************************************************************
+  * Everything is 32-bit integer arithmetic plus 32x32->64 multiplies, which
+  * the Cortex-M4 does in one cycle (SMULL/UMULL), and CLZ to normalise.
+  *
+  * CORDIC runs in Q30 so the vector can grow without overflow: rotation
+  * starts at the gain-compensated (1/K, 0) with the angle folded into
+  * +-45 degrees, vectoring starts with the input scaled to 29 bits and
+  * folded into the first quadrant. What limits both is the angle itself:
+  * one unit of a binary angle moves a Q31 sine by up to 3 LSB, and each
+  * arctangent in the table is half a unit off at most. Rotation rounds its
+  * shifts, which keeps the truncation from adding a bias of its own.
+  *
+  * The Newton iterations normalise the argument to [0.5, 1) or [0.25, 1),
+  * take a 16-bit seed for its top bits from a table and iterate twice, which
+  * leaves a few LSB of truncation error; a last multiply-and-compare step
+  * makes the result exact.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "fixmath.h"
+
+/* Private define ------------------------------------------------------------*/
+#define FIX_CLZ(x)              ((uint32_t)__builtin_clz(x))  /* x != 0 */
+
+#define FIX_Q30_ONE             0x40000000L
+#define FIX_NEWTON_STEPS        2U
+
+/* Private function prototypes -----------------------------------------------*/
+static int32_t FIX_Q30ToQ31(int32_t value);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Sine and cosine by CORDIC rotation.
+  * @param  angle: Binary angle
+  * @param  sine: Result, Q31
+  * @param  cosine: Result, Q31
+  * @retval None
+  */
+void FIX_SinCos(uint32_t angle, int32_t *sine, int32_t *cosine)
+{
+  uint32_t quadrant = (angle + (FIX_ANGLE_90 / 2U)) >> 30;
+  int32_t z = (int32_t)(angle - (quadrant << 30));
+  int32_t x = FIX_CordicGain;
+  int32_t y = 0;
+  int32_t r;
+  int32_t t;
+  uint32_t i;
+
+  /* Rotate (1/K, 0) by z, +-45 degrees at most */
+  for (i = 0U; i < FIX_CORDIC_STEPS; i++)
+  {
+    r = (int32_t)((1UL << i) >> 1);
+    if (z >= 0)
+    {
+      t = x - ((y + r) >> i);
+      y += (x + r) >> i;
+      z -= (int32_t)FIX_AtanTable[i];
+    }
+    else
+    {
+      t = x + ((y + r) >> i);
+      y -= (x + r) >> i;
+      z += (int32_t)FIX_AtanTable[i];
+    }
+    x = t;
+  }
+
+  /* Then by the quadrant */
+  switch (quadrant & 3U)
+  {
+    case 0U:
+      *sine = FIX_Q30ToQ31(y);
+      *cosine = FIX_Q30ToQ31(x);
+      break;
+    case 1U:
+      *sine = FIX_Q30ToQ31(x);
+      *cosine = FIX_Q30ToQ31(-y);
+      break;
+    case 2U:
+      *sine = FIX_Q30ToQ31(-y);
+      *cosine = FIX_Q30ToQ31(-x);
+      break;
+    default:
+      *sine = FIX_Q30ToQ31(-x);
+      *cosine = FIX_Q30ToQ31(y);
+      break;
+  }
+}
+
+/**
+  * @brief  Angle of the vector (x, y) by CORDIC vectoring.
+  * @param  y: Y component, any scale
+  * @param  x: X component, the same scale
+  * @retval Binary angle, -180 (0x80000000) to 180 degrees; 0 for (0, 0)
+  */
+int32_t FIX_Atan2(int32_t y, int32_t x)
+{
+  uint32_t ux = (x < 0) ? (0U - (uint32_t)x) : (uint32_t)x;
+  uint32_t uy = (y < 0) ? (0U - (uint32_t)y) : (uint32_t)y;
+  uint32_t angle = 0U;
+  int32_t shift;
+  int32_t vx;
+  int32_t vy;
+  int32_t t;
+  uint32_t i;
+
+  if ((ux | uy) == 0U)
+  {
+    return 0;
+  }
+
+  /* Larger component to 29 bits: |v| * 1.65 still fits */
+  shift = (int32_t)FIX_CLZ(ux | uy) - 3;
+  if (shift >= 0)
+  {
+    vx = (int32_t)(ux << shift);
+    vy = (int32_t)(uy << shift);
+  }
+  else
+  {
+    vx = (int32_t)(ux >> -shift);
+    vy = (int32_t)(uy >> -shift);
+  }
+
+  /* Rotate onto the X axis, adding up the angle, 0 to 90 degrees */
+  for (i = 0U; i < FIX_CORDIC_STEPS; i++)
+  {
+    if (vy > 0)
+    {
+      t = vx + (vy >> i);
+      vy -= vx >> i;
+      angle += FIX_AtanTable[i];
+    }
+    else
+    {
+      t = vx - (vy >> i);
+      vy += vx >> i;
+      angle -= FIX_AtanTable[i];
+    }
+    vx = t;
+  }
+
+  /* Unfold the quadrant */
+  if (x < 0)
+  {
+    angle = FIX_ANGLE_180 - angle;
+  }
+  if (y < 0)
+  {
+    angle = 0U - angle;
+  }
+  return (int32_t)angle;
+}
+
+/**
+  * @brief  Sine from the interpolated quarter wave.
+  * @param  angle: Binary angle
+  * @retval Q15, within FIX_SIN15_ERROR
+  */
+int16_t FIX_Sin15(uint32_t angle)
+{
+  uint32_t position = angle << 2;
+  int32_t value;
+
+  /* Second and fourth quadrants run the table backwards */
+  if ((angle & FIX_ANGLE_90) != 0U)
+  {
+    position = 0U - position;
+    value = (position == 0U) ? FIX_SinTable[1UL << FIX_SIN_BITS] :
+                               FIX_Lookup(FIX_SinTable, FIX_SIN_BITS, position);
+  }
+  else
+  {
+    value = FIX_Lookup(FIX_SinTable, FIX_SIN_BITS, position);
+  }
+  return (int16_t)(((angle & FIX_ANGLE_180) != 0U) ? -value : value);
+}
+
+/**
+  * @brief  Cosine from the interpolated quarter wave.
+  * @param  angle: Binary angle
+  * @retval Q15, within FIX_SIN15_ERROR
+  */
+int16_t FIX_Cos15(uint32_t angle)
+{
+  return FIX_Sin15(angle + FIX_ANGLE_90);
+}
+
+/**
+  * @brief  Linear interpolation in a table of 2^bits segments.
+  * @param  table: 2^bits + 1 values, the function at the segment ends
+  * @param  bits: Segment count, 1 to 16 bits
+  * @param  position: Across the table, fraction of its span (0.32)
+  * @retval Interpolated value, rounded
+  */
+int32_t FIX_Lookup(const int16_t *table, uint32_t bits, uint32_t position)
+{
+  uint32_t index = position >> (32U - bits);
+  int32_t fraction = (int32_t)((position << bits) >> 17);
+  int32_t from = table[index];
+
+  /* 16-bit difference times 15-bit fraction fits */
+  return from + ((((int32_t)table[index + 1U] - from) * fraction + 0x4000) >> 15);
+}
+
+/**
+  * @brief  Integer square root, one result bit per step.
+  * @param  x: Radicand
+  * @retval floor(sqrt(x))
+  */
+uint32_t FIX_Sqrt(uint32_t x)
+{
+  uint32_t root = 0U;
+  uint32_t bit;
+
+  if (x == 0U)
+  {
+    return 0U;
+  }
+  /* Highest power of four not above x */
+  bit = 1UL << ((31U - FIX_CLZ(x)) & ~1U);
+  while (bit != 0U)
+  {
+    if (x >= (root + bit))
+    {
+      x -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+    {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+/**
+  * @brief  Square root of a Q31 value.
+  * @param  x: Q31, 0 or above
+  * @retval Q31, floor(sqrt(x * 2^31)); 0 for x <= 0
+  */
+int32_t FIX_SqrtQ31(int32_t x)
+{
+  uint64_t target;
+  uint64_t root;
+  uint32_t shift;
+  uint32_t m;
+  uint32_t y;
+  uint32_t my;
+  uint32_t i;
+
+  if (x <= 0)
+  {
+    return 0;
+  }
+
+  /* x = m * 4^k with m in [0.25, 1): an odd shift, as x is Q31 */
+  shift = FIX_CLZ((uint32_t)x);
+  shift -= ((shift & 1U) == 0U) ? 1U : 0U;
+  m = (uint32_t)x << shift;
+
+  /* y -> 1 / sqrt(m), UQ2.30: y = y (3 - m y^2) / 2 */
+  y = (uint32_t)FIX_RsqrtSeed[(m >> (32U - FIX_SEED_BITS)) - (1UL << (FIX_SEED_BITS - 2U))] << 15;
+  for (i = 0U; i < FIX_NEWTON_STEPS; i++)
+  {
+    my = (uint32_t)(((uint64_t)m * y) >> 32);
+    my = (uint32_t)(((uint64_t)my * y) >> 30);
+    y = (uint32_t)(((uint64_t)y * ((3UL * (uint32_t)FIX_Q30_ONE) - my)) >> 31);
+  }
+
+  /* sqrt(m) = m y, then back by 2^k */
+  root = (((uint64_t)m * y) >> 30) >> ((shift + 1U) / 2U);
+  target = (uint64_t)(uint32_t)x << 31;
+  while ((root * root) > target)
+  {
+    root--;
+  }
+  while (((root + 1U) * (root + 1U)) <= target)
+  {
+    root++;
+  }
+  return (int32_t)root;
+}
+
+/**
+  * @brief  Reciprocal, 2^32 / x.
+  * @param  x: Divisor
+  * @retval floor(2^32 / x); UINT32_MAX for 0 and 1
+  */
+uint32_t FIX_Recip(uint32_t x)
+{
+  int64_t remainder;
+  uint32_t shift;
+  uint32_t quotient;
+  uint32_t m;
+  uint32_t r;
+  uint32_t mr;
+  uint32_t i;
+
+  if (x <= 1U)
+  {
+    return UINT32_MAX;
+  }
+
+  /* x = m * 2^k with m in [0.5, 1) */
+  shift = FIX_CLZ(x);
+  m = x << shift;
+
+  /* r -> 1 / m, UQ1.31, from below: r = r (2 - m r) */
+  r = (uint32_t)FIX_RecipSeed[(m >> (31U - FIX_SEED_BITS)) & ((1UL << FIX_SEED_BITS) - 1U)] << 16;
+  for (i = 0U; i < FIX_NEWTON_STEPS; i++)
+  {
+    mr = (uint32_t)(((uint64_t)m * r) >> 32);
+    r = (uint32_t)(((uint64_t)r * (uint32_t)(0x100000000ULL - mr)) >> 31);
+  }
+
+  /* Back by 2^k, then the last few units from the remainder */
+  quotient = r >> (31U - shift);
+  remainder = (int64_t)0x100000000LL - ((int64_t)quotient * x);
+  while (remainder < 0)
+  {
+    quotient--;
+    remainder += x;
+  }
+  while (remainder >= (int64_t)x)
+  {
+    quotient++;
+    remainder -= x;
+  }
+  return quotient;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Q30 to Q31, saturating at +-1.0.
+  * @param  value: Q30
+  * @retval Q31
+  */
+static int32_t FIX_Q30ToQ31(int32_t value)
+{
+  if (value >= FIX_Q30_ONE)
+  {
+    return INT32_MAX;
+  }
+  if (value < -FIX_Q30_ONE)
+  {
+    return INT32_MIN;
+  }
+  return (int32_t)((uint32_t)value << 1);
+}
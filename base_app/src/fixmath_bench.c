@@ -0,0 +1,132 @@
+/**
+  ******************************************************************************
+  * @file    fixmath_bench.c
+  * @brief   Cycles per call of the fixed-point math (fixmath.h) against the
+  *          libm float functions it replaces.
+  ******************************************************************************
+  * Each function runs FIXMATH_BENCH_CALLS times over as many pseudo-random
+  * arguments, with interrupts masked, and the loop itself (an empty pass
+  * over the same arguments) is taken off. The float arguments are the same
+  * values converted beforehand, so only the calls are timed. The reciprocal
+  * is set against the 64-bit division it saves, which the M4 has no
+  * instruction for.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "fixmath_bench.h"
+#include "fixmath.h"
+#include "dwt.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+/* Private define ------------------------------------------------------------*/
+#define FIXMATH_BENCH_LINE_MAX    78U
+#define FIXMATH_BENCH_RADIANS     1.46291808e-9f    /* 2 pi / 2^32 */
+
+/* Time "body" over all arguments, interrupts masked, into "cycles" */
+#define FIXMATH_BENCH_TIME(cycles, body)                                      \
+  do                                                                          \
+  {                                                                           \
+    uint32_t primask_ = __get_PRIMASK();                                      \
+    uint32_t start_;                                                          \
+    uint32_t n;                                                               \
+                                                                              \
+    __disable_irq();                                                          \
+    start_ = DWT_Cycles();                                                    \
+    for (n = 0U; n < FIXMATH_BENCH_CALLS; n++)                                \
+    {                                                                         \
+      body;                                                                   \
+    }                                                                         \
+    (cycles) = DWT_Cycles() - start_;                                         \
+    __set_PRIMASK(primask_);                                                  \
+  } while (0)
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t BenchWords[FIXMATH_BENCH_CALLS];
+static float    BenchFloats[FIXMATH_BENCH_CALLS];
+static volatile int32_t BenchSink;
+static volatile float   BenchSinkF;
+
+/* Private function prototypes -----------------------------------------------*/
+static void FIXMATH_BENCH_Print(UART_HandleTypeDef *huart, const char *name, uint32_t fixed,
+                                const char *reference, uint32_t libm, uint32_t loop);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  One result line, cycles per call.
+  * @param  huart: Initialised UART handle
+  * @param  name: Function
+  * @param  fixed: Cycles of all fixed-point calls
+  * @param  reference: What it replaces
+  * @param  libm: Cycles of all its calls
+  * @param  loop: Cycles of the empty loop
+  * @retval None
+  */
+static void FIXMATH_BENCH_Print(UART_HandleTypeDef *huart, const char *name, uint32_t fixed,
+                                const char *reference, uint32_t libm, uint32_t loop)
+{
+  char line[FIXMATH_BENCH_LINE_MAX + 2U];
+  int n;
+
+  fixed = (fixed > loop) ? (fixed - loop) : 0U;
+  libm = (libm > loop) ? (libm - loop) : 0U;
+  n = snprintf(line, FIXMATH_BENCH_LINE_MAX, "fixmath: %-7s %5lu cycles/call, %-9s %5lu",
+               name, (unsigned long)(fixed / FIXMATH_BENCH_CALLS), reference,
+               (unsigned long)(libm / FIXMATH_BENCH_CALLS));
+  n = (n < 0) ? 0 : ((n >= (int)FIXMATH_BENCH_LINE_MAX) ? (int)FIXMATH_BENCH_LINE_MAX - 1 : n);
+  line[n++] = '\r';
+  line[n++] = '\n';
+  (void)HAL_UART_Transmit(huart, (uint8_t *)line, (uint16_t)n, HAL_MAX_DELAY);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Time each function and its float counterpart and print them.
+  * @param  huart: Initialised UART handle
+  * @retval None
+  */
+void FIXMATH_BENCH_Run(UART_HandleTypeDef *huart)
+{
+  int32_t s;
+  int32_t c;
+  uint32_t loop;
+  uint32_t fixed;
+  uint32_t libm;
+  uint32_t i;
+
+  DWT_Init();
+  for (i = 0U; i < FIXMATH_BENCH_CALLS; i++)
+  {
+    BenchWords[i] = (i + 1U) * 2654435761U;
+    BenchFloats[i] = (float)BenchWords[i] * FIXMATH_BENCH_RADIANS;
+  }
+
+  FIXMATH_BENCH_TIME(loop, BenchSink = (int32_t)BenchWords[n]);
+
+  FIXMATH_BENCH_TIME(fixed, FIX_SinCos(BenchWords[n], &s, &c); BenchSink = s + c);
+  FIXMATH_BENCH_TIME(libm, BenchSinkF = sinf(BenchFloats[n]) + cosf(BenchFloats[n]));
+  FIXMATH_BENCH_Print(huart, "sincos", fixed, "sinf+cosf", libm, loop);
+
+  FIXMATH_BENCH_TIME(fixed, BenchSink = FIX_Atan2((int32_t)BenchWords[n], (int32_t)(BenchWords[n] << 7)));
+  FIXMATH_BENCH_TIME(libm, BenchSinkF = atan2f(BenchFloats[n], BenchFloats[n ^ 1U] - 3.0f));
+  FIXMATH_BENCH_Print(huart, "atan2", fixed, "atan2f", libm, loop);
+
+  FIXMATH_BENCH_TIME(fixed, BenchSink = FIX_Sin15(BenchWords[n]));
+  FIXMATH_BENCH_TIME(libm, BenchSinkF = sinf(BenchFloats[n]));
+  FIXMATH_BENCH_Print(huart, "sin15", fixed, "sinf", libm, loop);
+
+  FIXMATH_BENCH_TIME(fixed, BenchSink = (int32_t)FIX_Sqrt(BenchWords[n]));
+  FIXMATH_BENCH_TIME(libm, BenchSinkF = sqrtf(BenchFloats[n]));
+  FIXMATH_BENCH_Print(huart, "sqrt", fixed, "sqrtf", libm, loop);
+
+  FIXMATH_BENCH_TIME(fixed, BenchSink = FIX_SqrtQ31((int32_t)(BenchWords[n] >> 1)));
+  FIXMATH_BENCH_Print(huart, "sqrtq31", fixed, "sqrtf", libm, loop);
+
+  FIXMATH_BENCH_TIME(fixed, BenchSink = (int32_t)FIX_Recip(BenchWords[n]));
+  FIXMATH_BENCH_TIME(libm, BenchSink = (int32_t)(0x100000000ULL / BenchWords[n]));
+  FIXMATH_BENCH_Print(huart, "recip", fixed, "u64 div", libm, loop);
+}
@@ -0,0 +1,201 @@
+/**
+  ******************************************************************************
+  * @file    fusion.c
+  * @brief   Tilt and vibration from a 3-axis accelerometer: a Kalman filter
+  *          on the gravity vector with a measurement noise learnt online.
+  ******************************************************************************
+  * One update is about 120 single-precision operations and two divisions,
+  * straight-line code the compiler keeps in FPU registers. The innovation
+  * statistics are a running mean until Window samples have been seen and
+  * an exponential one with weight 1/Window after, so they start unbiased.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "fusion.h"
+#include <math.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+/* Upper triangle of a symmetric 3x3 */
+#define XX                      0
+#define XY                      1
+#define XZ                      2
+#define YY                      3
+#define YZ                      4
+#define ZZ                      5
+
+#define FUSION_DEG              57.2957795f
+#define FUSION_RAD              0.0174532925f
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Set the filter up; the first sample then initialises the state.
+  * @param  f: Filter
+  * @param  odr_hz: Sample rate
+  * @param  noise_g: RMS noise of one axis at that rate, g
+  * @param  rate_dps: Fastest rotation to follow without lag, degrees/s
+  * @param  window_s: Span of the vibration statistics, s
+  * @retval None
+  */
+void FUSION_Init(FUSION_TypeDef *f, float odr_hz, float noise_g, float rate_dps, float window_s)
+{
+  float step = rate_dps * FUSION_RAD / odr_hz;
+  float window = window_s * odr_hz;
+
+  memset(f, 0, sizeof(*f));
+  f->P[XX] = FUSION_P0;
+  f->P[YY] = FUSION_P0;
+  f->P[ZZ] = FUSION_P0;
+  f->Q = step * step;
+  f->R0 = noise_g * noise_g;
+  f->Window = (window >= 1.0f) ? (uint32_t)window : 1U;
+}
+
+/**
+  * @brief  Take one sample.
+  * @param  f: Filter
+  * @param  ax: X acceleration, g
+  * @param  ay: Y acceleration, g
+  * @param  az: Z acceleration, g
+  * @retval None
+  */
+void FUSION_Update(FUSION_TypeDef *f, float ax, float ay, float az)
+{
+  float *x = f->X;
+  float *p = f->P;
+  float *e = f->Mean;
+  float *m = f->Moment;
+  float r0, r1, r2;
+  float s[6];
+  float i[6];
+  float k[9];
+  float q[6];
+  float w;
+
+  if (f->Updates == 0U)
+  {
+    x[0] = ax;
+    x[1] = ay;
+    x[2] = az;
+    f->Updates = 1U;
+    return;
+  }
+
+  /* Predict: gravity wanders */
+  p[XX] += f->Q;
+  p[YY] += f->Q;
+  p[ZZ] += f->Q;
+
+  /* Innovation and its statistics */
+  r0 = ax - x[0];
+  r1 = ay - x[1];
+  r2 = az - x[2];
+  w = 1.0f / (float)((f->Updates < f->Window) ? f->Updates : f->Window);
+  e[0] += w * (r0 - e[0]);
+  e[1] += w * (r1 - e[1]);
+  e[2] += w * (r2 - e[2]);
+  m[XX] += w * ((r0 * r0) - m[XX]);
+  m[XY] += w * ((r0 * r1) - m[XY]);
+  m[XZ] += w * ((r0 * r2) - m[XZ]);
+  m[YY] += w * ((r1 * r1) - m[YY]);
+  m[YZ] += w * ((r1 * r2) - m[YZ]);
+  m[ZZ] += w * ((r2 * r2) - m[ZZ]);
+
+  /* S = P + R, R the innovation covariance over the noise floor */
+  s[XX] = p[XX] + (m[XX] - (e[0] * e[0])) + f->R0;
+  s[XY] = p[XY] + (m[XY] - (e[0] * e[1]));
+  s[XZ] = p[XZ] + (m[XZ] - (e[0] * e[2]));
+  s[YY] = p[YY] + (m[YY] - (e[1] * e[1])) + f->R0;
+  s[YZ] = p[YZ] + (m[YZ] - (e[1] * e[2]));
+  s[ZZ] = p[ZZ] + (m[ZZ] - (e[2] * e[2])) + f->R0;
+
+  /* S^-1 from the cofactors; S is positive definite */
+  i[XX] = (s[YY] * s[ZZ]) - (s[YZ] * s[YZ]);
+  i[XY] = (s[XZ] * s[YZ]) - (s[XY] * s[ZZ]);
+  i[XZ] = (s[XY] * s[YZ]) - (s[XZ] * s[YY]);
+  w = 1.0f / ((s[XX] * i[XX]) + (s[XY] * i[XY]) + (s[XZ] * i[XZ]));
+  i[YY] = ((s[XX] * s[ZZ]) - (s[XZ] * s[XZ])) * w;
+  i[YZ] = ((s[XY] * s[XZ]) - (s[XX] * s[YZ])) * w;
+  i[ZZ] = ((s[XX] * s[YY]) - (s[XY] * s[XY])) * w;
+  i[XX] *= w;
+  i[XY] *= w;
+  i[XZ] *= w;
+
+  /* K = P S^-1, row by row */
+  k[0] = (p[XX] * i[XX]) + (p[XY] * i[XY]) + (p[XZ] * i[XZ]);
+  k[1] = (p[XX] * i[XY]) + (p[XY] * i[YY]) + (p[XZ] * i[YZ]);
+  k[2] = (p[XX] * i[XZ]) + (p[XY] * i[YZ]) + (p[XZ] * i[ZZ]);
+  k[3] = (p[XY] * i[XX]) + (p[YY] * i[XY]) + (p[YZ] * i[XZ]);
+  k[4] = (p[XY] * i[XY]) + (p[YY] * i[YY]) + (p[YZ] * i[YZ]);
+  k[5] = (p[XY] * i[XZ]) + (p[YY] * i[YZ]) + (p[YZ] * i[ZZ]);
+  k[6] = (p[XZ] * i[XX]) + (p[YZ] * i[XY]) + (p[ZZ] * i[XZ]);
+  k[7] = (p[XZ] * i[XY]) + (p[YZ] * i[YY]) + (p[ZZ] * i[YZ]);
+  k[8] = (p[XZ] * i[XZ]) + (p[YZ] * i[YZ]) + (p[ZZ] * i[ZZ]);
+
+  /* x += K r */
+  x[0] += (k[0] * r0) + (k[1] * r1) + (k[2] * r2);
+  x[1] += (k[3] * r0) + (k[4] * r1) + (k[5] * r2);
+  x[2] += (k[6] * r0) + (k[7] * r1) + (k[8] * r2);
+
+  /* P -= K P; the product P S^-1 P is symmetric, so the upper triangle */
+  q[XX] = p[XX] - ((k[0] * p[XX]) + (k[1] * p[XY]) + (k[2] * p[XZ]));
+  q[XY] = p[XY] - ((k[0] * p[XY]) + (k[1] * p[YY]) + (k[2] * p[YZ]));
+  q[XZ] = p[XZ] - ((k[0] * p[XZ]) + (k[1] * p[YZ]) + (k[2] * p[ZZ]));
+  q[YY] = p[YY] - ((k[3] * p[XY]) + (k[4] * p[YY]) + (k[5] * p[YZ]));
+  q[YZ] = p[YZ] - ((k[3] * p[XZ]) + (k[4] * p[YZ]) + (k[5] * p[ZZ]));
+  q[ZZ] = p[ZZ] - ((k[6] * p[XZ]) + (k[7] * p[YZ]) + (k[8] * p[ZZ]));
+  p[XX] = q[XX];
+  p[XY] = q[XY];
+  p[XZ] = q[XZ];
+  p[YY] = q[YY];
+  p[YZ] = q[YZ];
+  p[ZZ] = q[ZZ];
+
+  if (f->Updates != UINT32_MAX)
+  {
+    f->Updates++;
+  }
+}
+
+/**
+  * @brief  Tilt of the gravity estimate.
+  * @param  f: Filter
+  * @param  tilt: Result
+  * @retval None
+  */
+void FUSION_Tilt(const FUSION_TypeDef *f, FUSION_TiltTypeDef *tilt)
+{
+  FUSION_TiltOf(f->X[0], f->X[1], f->X[2], tilt);
+}
+
+/**
+  * @brief  Tilt of a gravity vector, e.g. of a raw sample. Roll and pitch
+  *         in the aerospace order (roll first); the magnitude does not matter.
+  * @param  gx: X component
+  * @param  gy: Y component
+  * @param  gz: Z component
+  * @param  tilt: Result
+  * @retval None
+  */
+void FUSION_TiltOf(float gx, float gy, float gz, FUSION_TiltTypeDef *tilt)
+{
+  tilt->Roll = atan2f(gy, gz) * FUSION_DEG;
+  tilt->Pitch = atan2f(-gx, sqrtf((gy * gy) + (gz * gz))) * FUSION_DEG;
+  tilt->Tilt = atan2f(sqrtf((gx * gx) + (gy * gy)), gz) * FUSION_DEG;
+}
+
+/**
+  * @brief  Vibration: RMS magnitude of what is not gravity, over the window.
+  * @param  f: Filter
+  * @retval g RMS
+  */
+float FUSION_Vibration(const FUSION_TypeDef *f)
+{
+  const float *e = f->Mean;
+  const float *m = f->Moment;
+  float power = (m[XX] - (e[0] * e[0])) + (m[YY] - (e[1] * e[1])) + (m[ZZ] - (e[2] * e[2]));
+
+  return (power > 0.0f) ? sqrtf(power) : 0.0f;
+}
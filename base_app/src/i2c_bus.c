@@ -0,0 +1,486 @@
+/**
+  ******************************************************************************
+  * @file    i2c_bus.c
+  * @brief   I2C1 port of the queued transaction engine.
+  ******************************************************************************
+  * I2C1 on the STM32F4-Discovery carries the CS43L22 audio codec:
+  *
+  *   PB6 I2C1_SCL    PB9 I2C1_SDA    (AF4, open drain, external pull-ups)
+  *
+  * There is no HAL I2C driver in this tree, so the peripheral is programmed
+  * directly. Transmission is interrupt driven on BTF, one event per byte.
+  * Reception always goes through DMA1 Stream0 channel 1: with LAST set the
+  * peripheral NACKs the final byte on its own, and the DMA transfer-complete
+  * interrupt issues the STOP, which sidesteps the N=1/N=2/N>2 reception
+  * sequences of the F4 I2C block.
+  *
+  * The event, error and DMA interrupts share I2C_BUS_IRQ_PRIORITY, so the
+  * engine state is only ever touched from one context. I2C_BUS_Submit() pends
+  * the event interrupt to get a transaction going.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "i2c_bus.h"
+
+/* Private define ------------------------------------------------------------*/
+#define I2C_BUS_SCL_PIN     GPIO_PIN_6
+#define I2C_BUS_SDA_PIN     GPIO_PIN_9
+#define I2C_BUS_ERRORS      (I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_OVR | \
+                             I2C_SR1_PECERR | I2C_SR1_TIMEOUT)
+
+#if I2C_BUS_SPEED > 100000U
+#error "I2C_BUS_SPEED: only standard mode is configured"
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+I2CQ_HandleTypeDef hi2cq1;
+DMA_HandleTypeDef  hdma_i2c1_rx;
+
+static uint8_t          I2cBusReady;
+static volatile uint8_t I2cBusTxBusy;   /* a written byte still awaits its BTF */
+static volatile uint8_t I2cBusRxArmed;  /* next ADDR is the read address      */
+
+/* Private function prototypes -----------------------------------------------*/
+static void     I2C_BUS_MspInit(void);
+static void     I2C_BUS_Configure(void);
+static void     I2C_BUS_Unstick(void);
+static void     I2C_BUS_Disarm(void);
+static void     I2C_BUS_RxCplt(DMA_HandleTypeDef *hdma);
+static void     I2C_BUS_RxError(DMA_HandleTypeDef *hdma);
+
+static void     I2C_BUS_Start(void);
+static void     I2C_BUS_SendAddress(uint8_t addr);
+static void     I2C_BUS_WriteByte(uint8_t value);
+static void     I2C_BUS_PrepareRead(uint8_t *data, uint16_t len);
+static void     I2C_BUS_Stop(void);
+static void     I2C_BUS_Recover(void);
+static void     I2C_BUS_Kick(void);
+static uint32_t I2C_BUS_Lock(void);
+static void     I2C_BUS_Unlock(uint32_t state);
+
+static const I2CQ_PortTypeDef I2cBusPort =
+{
+  I2C_BUS_Start,
+  I2C_BUS_SendAddress,
+  I2C_BUS_WriteByte,
+  I2C_BUS_PrepareRead,
+  I2C_BUS_Stop,
+  I2C_BUS_Recover,
+  I2C_BUS_Kick,
+  I2C_BUS_Lock,
+  I2C_BUS_Unlock
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Bring up I2C1, its RX DMA and the transaction queue.
+  *         Safe to call more than once.
+  * @retval HAL status
+  */
+HAL_StatusTypeDef I2C_BUS_Init(void)
+{
+  if (I2cBusReady != 0U)
+  {
+    return HAL_OK;
+  }
+
+  I2C_BUS_MspInit();
+
+  /* DMA1 Stream0 channel 1 is I2C1_RX */
+  hdma_i2c1_rx.Instance = DMA1_Stream0;
+  hdma_i2c1_rx.Init.Channel = DMA_CHANNEL_1;
+  hdma_i2c1_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_i2c1_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_i2c1_rx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_i2c1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_i2c1_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_i2c1_rx.Init.Mode = DMA_NORMAL;
+  hdma_i2c1_rx.Init.Priority = DMA_PRIORITY_LOW;
+  hdma_i2c1_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_i2c1_rx) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  hdma_i2c1_rx.XferCpltCallback = I2C_BUS_RxCplt;
+  hdma_i2c1_rx.XferErrorCallback = I2C_BUS_RxError;
+
+  I2CQ_Init(&hi2cq1, &I2cBusPort);
+  I2C_BUS_Unstick();
+  I2C_BUS_Configure();
+  I2cBusReady = 1U;
+
+  HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+  HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+  HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  Queue a batch of transactions on I2C1, see I2CQ_Submit().
+  * @param  xfers: Descriptors, valid until each one completes
+  * @param  count: Number of descriptors
+  * @retval I2CQ status
+  */
+I2CQ_StatusTypeDef I2C_BUS_Submit(I2CQ_XferTypeDef *xfers, uint32_t count)
+{
+  return I2CQ_Submit(&hi2cq1, xfers, count);
+}
+
+/**
+  * @brief  Spin until a submitted transaction completes. Only for callers
+  *         with a synchronous contract (the BSP read routines); never call it
+  *         from a completion callback or an interrupt at or above
+  *         I2C_BUS_IRQ_PRIORITY. Bounded by I2CQ_TIMEOUT_TICKS per attempt.
+  * @param  xfer: Submitted descriptor
+  * @retval Final status of the transaction
+  */
+I2CQ_StatusTypeDef I2C_BUS_Wait(I2CQ_XferTypeDef *xfer)
+{
+  while (xfer->Status == I2CQ_PENDING)
+  {
+  }
+  return (I2CQ_StatusTypeDef)xfer->Status;
+}
+
+/**
+  * @brief  Transaction timeout clock, called from the 1 ms SysTick.
+  * @retval None
+  */
+void I2C_BUS_Tick(void)
+{
+  if (I2cBusReady != 0U)
+  {
+    I2CQ_Tick(&hi2cq1);
+  }
+}
+
+/**
+  * @brief  Operating point notifier (power.h): hold the switch off while a
+  *         transaction is queued, then redo the SCL timing from the new PCLK1.
+  * @param  context: Not used
+  * @param  event: DVFS_EV_PRE or DVFS_EV_POST
+  * @param  point: Target point
+  * @retval DVFS_BUSY to veto the switch
+  */
+DVFS_StatusTypeDef I2C_BUS_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                       const DVFS_PointTypeDef *point)
+{
+  (void)context;
+  (void)point;
+  if (I2cBusReady == 0U)
+  {
+    return DVFS_OK;
+  }
+  if (event == DVFS_EV_PRE)
+  {
+    return ((hi2cq1.Active != NULL) || (I2CQ_Pending(&hi2cq1) != 0U)) ? DVFS_BUSY : DVFS_OK;
+  }
+  I2C_BUS_Configure();
+  return DVFS_OK;
+}
+
+/**
+  * @brief  I2C1 event interrupt: SB, ADDR and BTF become engine events.
+  *         Also runs the queue after I2C_BUS_Kick() pended this vector.
+  * @retval None
+  */
+void I2C_BUS_EV_IRQHandler(void)
+{
+  uint32_t sr1 = I2C1->SR1;
+
+  if ((sr1 & I2C_SR1_SB) != 0U)
+  {
+    /* Cleared by the address write the engine answers with */
+    I2CQ_Event(&hi2cq1, I2CQ_EV_START);
+  }
+  else if ((sr1 & I2C_SR1_ADDR) != 0U)
+  {
+    (void)I2C1->SR2;
+    if (I2cBusRxArmed == 0U)
+    {
+      I2CQ_Event(&hi2cq1, I2CQ_EV_ADDR_ACK);
+    }
+    /* Reading: the DMA takes over until the last byte */
+  }
+  else if (((sr1 & I2C_SR1_BTF) != 0U) && (I2cBusTxBusy != 0U))
+  {
+    I2cBusTxBusy = 0U;
+    I2CQ_Event(&hi2cq1, I2CQ_EV_TX_DONE);
+  }
+
+  I2CQ_Service(&hi2cq1);
+}
+
+/**
+  * @brief  I2C1 error interrupt: AF becomes a NACK, the rest a bus error.
+  * @retval None
+  */
+void I2C_BUS_ER_IRQHandler(void)
+{
+  uint32_t sr1 = I2C1->SR1;
+
+  if ((sr1 & I2C_SR1_AF) != 0U)
+  {
+    I2C1->SR1 = ~I2C_SR1_AF & 0xFFFFU;
+    I2C_BUS_Disarm();
+    I2CQ_Event(&hi2cq1, I2CQ_EV_NACK);
+  }
+  else if ((sr1 & I2C_BUS_ERRORS) != 0U)
+  {
+    I2C1->SR1 = ~I2C_BUS_ERRORS & 0xFFFFU;
+    I2C_BUS_Disarm();
+    I2CQ_Event(&hi2cq1, I2CQ_EV_BUS_ERROR);
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Clocks, pins and interrupt priorities for I2C1 and its RX DMA.
+  * @retval None
+  */
+static void I2C_BUS_MspInit(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+  __HAL_RCC_I2C1_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /**I2C1 GPIO Configuration
+  PB6     ------> I2C1_SCL
+  PB9     ------> I2C1_SDA
+  */
+  GPIO_InitStruct.Pin = I2C_BUS_SCL_PIN|I2C_BUS_SDA_PIN;
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_OD;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+  GPIO_InitStruct.Alternate = GPIO_AF4_I2C1;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+  __HAL_RCC_I2C1_FORCE_RESET();
+  __HAL_RCC_I2C1_RELEASE_RESET();
+
+  HAL_NVIC_SetPriority(I2C1_EV_IRQn, I2C_BUS_IRQ_PRIORITY, 0);
+  HAL_NVIC_SetPriority(I2C1_ER_IRQn, I2C_BUS_IRQ_PRIORITY, 0);
+  HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, I2C_BUS_IRQ_PRIORITY, 0);
+}
+
+/**
+  * @brief  Program I2C1 for standard-mode master operation with interrupts.
+  * @retval None
+  */
+static void I2C_BUS_Configure(void)
+{
+  uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+  uint32_t ccr = pclk1 / (2U * I2C_BUS_SPEED);
+
+  I2C1->CR1   = I2C_CR1_SWRST;
+  I2C1->CR1   = 0U;
+  I2C1->CR2   = (pclk1 / 1000000U) | I2C_CR2_ITEVTEN | I2C_CR2_ITERREN;
+  I2C1->CCR   = (ccr < 4U) ? 4U : ccr;
+  I2C1->TRISE = (pclk1 / 1000000U) + 1U;
+  I2C1->CR1   = I2C_CR1_PE;
+
+  I2cBusTxBusy  = 0U;
+  I2cBusRxArmed = 0U;
+}
+
+/**
+  * @brief  Clock a slave that holds SDA low out of its byte, then send a
+  *         STOP by hand. Takes at most ten SCL periods.
+  * @retval None
+  */
+static void I2C_BUS_Unstick(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+  uint32_t half = SystemCoreClock / (8U * I2C_BUS_SPEED);
+  volatile uint32_t spin;
+  uint32_t pulse;
+
+  HAL_GPIO_WritePin(GPIOB, I2C_BUS_SCL_PIN|I2C_BUS_SDA_PIN, GPIO_PIN_SET);
+  GPIO_InitStruct.Pin = I2C_BUS_SCL_PIN|I2C_BUS_SDA_PIN;
+  GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_OD;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+  for (pulse = 0U; (pulse < 9U) && (HAL_GPIO_ReadPin(GPIOB, I2C_BUS_SDA_PIN) == GPIO_PIN_RESET); pulse++)
+  {
+    HAL_GPIO_WritePin(GPIOB, I2C_BUS_SCL_PIN, GPIO_PIN_RESET);
+    for (spin = 0U; spin < half; spin++) {}
+    HAL_GPIO_WritePin(GPIOB, I2C_BUS_SCL_PIN, GPIO_PIN_SET);
+    for (spin = 0U; spin < half; spin++) {}
+  }
+
+  /* STOP: SDA rises while SCL is high */
+  HAL_GPIO_WritePin(GPIOB, I2C_BUS_SDA_PIN, GPIO_PIN_RESET);
+  for (spin = 0U; spin < half; spin++) {}
+  HAL_GPIO_WritePin(GPIOB, I2C_BUS_SDA_PIN, GPIO_PIN_SET);
+
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_OD;
+  GPIO_InitStruct.Alternate = GPIO_AF4_I2C1;
+  HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+}
+
+/**
+  * @brief  Drop a reception that was armed or is in flight.
+  * @retval None
+  */
+static void I2C_BUS_Disarm(void)
+{
+  I2C1->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_LAST);
+  if (hdma_i2c1_rx.State == HAL_DMA_STATE_BUSY)
+  {
+    (void)HAL_DMA_Abort(&hdma_i2c1_rx);
+  }
+  I2cBusRxArmed = 0U;
+  I2cBusTxBusy  = 0U;
+}
+
+/**
+  * @brief  All bytes are in: the last one was NACKed, finish with a STOP.
+  * @param  hdma: RX DMA handle
+  * @retval None
+  */
+static void I2C_BUS_RxCplt(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+  I2C1->CR1 |= I2C_CR1_STOP;
+  I2C1->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_LAST);
+  I2cBusRxArmed = 0U;
+  I2CQ_Event(&hi2cq1, I2CQ_EV_RX_DONE);
+}
+
+/**
+  * @brief  RX DMA transfer error.
+  * @param  hdma: RX DMA handle
+  * @retval None
+  */
+static void I2C_BUS_RxError(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+  I2C_BUS_Disarm();
+  I2CQ_Event(&hi2cq1, I2CQ_EV_BUS_ERROR);
+}
+
+/**
+  * @brief  Port: START or repeated START. A STOP still being sent is let
+  *         out first (under one SCL period).
+  * @retval None
+  */
+static void I2C_BUS_Start(void)
+{
+  uint32_t guard = SystemCoreClock / I2C_BUS_SPEED;
+
+  while (((I2C1->CR1 & I2C_CR1_STOP) != 0U) && (guard-- != 0U))
+  {
+  }
+  I2C1->CR1 |= I2C_CR1_START;
+}
+
+/**
+  * @brief  Port: address byte; writing DR also clears SB.
+  * @param  addr: 8-bit address including the R/W bit
+  * @retval None
+  */
+static void I2C_BUS_SendAddress(uint8_t addr)
+{
+  I2cBusTxBusy = 0U;
+  I2C1->DR = addr;
+}
+
+/**
+  * @brief  Port: one data byte, completion is reported on BTF.
+  * @param  value: Byte to send
+  * @retval None
+  */
+static void I2C_BUS_WriteByte(uint8_t value)
+{
+  I2cBusTxBusy = 1U;
+  I2C1->DR = value;
+}
+
+/**
+  * @brief  Port: arm the RX DMA before the read address goes out. A single
+  *         byte is NACKed by clearing ACK up front, longer reads use LAST.
+  * @param  data: Destination buffer
+  * @param  len: Number of bytes, at least 1
+  * @retval None
+  */
+static void I2C_BUS_PrepareRead(uint8_t *data, uint16_t len)
+{
+  if (len == 1U)
+  {
+    I2C1->CR1 &= ~I2C_CR1_ACK;
+    I2C1->CR2 &= ~I2C_CR2_LAST;
+  }
+  else
+  {
+    I2C1->CR1 |= I2C_CR1_ACK;
+    I2C1->CR2 |= I2C_CR2_LAST;
+  }
+  I2cBusRxArmed = 1U;
+  if (HAL_DMA_Start_IT(&hdma_i2c1_rx, (uint32_t)&I2C1->DR, (uint32_t)data, len) != HAL_OK)
+  {
+    /* Leave the transaction to the timeout */
+    return;
+  }
+  I2C1->CR2 |= I2C_CR2_DMAEN;
+}
+
+/**
+  * @brief  Port: STOP after the current byte.
+  * @retval None
+  */
+static void I2C_BUS_Stop(void)
+{
+  I2cBusTxBusy = 0U;
+  I2C1->CR1 |= I2C_CR1_STOP;
+}
+
+/**
+  * @brief  Port: reset the peripheral and free the bus.
+  * @retval None
+  */
+static void I2C_BUS_Recover(void)
+{
+  I2C_BUS_Disarm();
+  I2C1->CR1 = I2C_CR1_SWRST;
+  I2C_BUS_Unstick();
+  I2C_BUS_Configure();
+}
+
+/**
+  * @brief  Port: run the queue from the event interrupt.
+  * @retval None
+  */
+static void I2C_BUS_Kick(void)
+{
+  NVIC_SetPendingIRQ(I2C1_EV_IRQn);
+}
+
+/**
+  * @brief  Port: enter a short critical section.
+  * @retval Previous PRIMASK
+  */
+static uint32_t I2C_BUS_Lock(void)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  return primask;
+}
+
+/**
+  * @brief  Port: leave the critical section.
+  * @param  state: Value returned by I2C_BUS_Lock()
+  * @retval None
+  */
+static void I2C_BUS_Unlock(uint32_t state)
+{
+  __set_PRIMASK(state);
+}
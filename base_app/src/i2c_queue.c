@@ -0,0 +1,373 @@
+/**
+  ******************************************************************************
+  * @file    i2c_queue.c
+  * @brief   Queued, event-driven I2C register transaction engine.
+  ******************************************************************************
+  * Every transaction has the shape of a HAL_I2C_Mem_Write/Read call:
+  *
+  *   write: S addr+W A reg A data0 A ... dataN A P
+  *   read:  S addr+W A reg A Sr addr+R A data0 A ... dataN NA P
+  *
+  * and walks the states below, one port event per step:
+  *
+  *   IDLE -Start-> START -EV_START-> ADDR_W -EV_ADDR_ACK-> REG -EV_TX_DONE->
+  *     write: DATA -EV_TX_DONE x Len-> Stop, done
+  *     read:  RESTART -EV_START-> READ -EV_RX_DONE-> done
+  *
+  * A NACK stops the bus, a bus error or timeout resets it through the port;
+  * either way the transaction is retried up to Retries times, completed with
+  * the error and the queue moves on. Nothing ever waits for the bus: Submit
+  * only enqueues and kicks, the port events and I2CQ_Service() run in the bus
+  * interrupt and the callbacks are called from there.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "i2c_queue.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define I2CQ_MASK           (I2CQ_DEPTH - 1U)
+
+#define I2CQ_ST_IDLE        0U
+#define I2CQ_ST_START       1U
+#define I2CQ_ST_ADDR_W      2U
+#define I2CQ_ST_REG         3U
+#define I2CQ_ST_DATA        4U
+#define I2CQ_ST_RESTART     5U
+#define I2CQ_ST_READ        6U
+
+#if (I2CQ_DEPTH & I2CQ_MASK) != 0U
+#error "I2CQ_DEPTH must be a power of two"
+#endif
+
+/* Private function prototypes -----------------------------------------------*/
+static void I2CQ_Begin(I2CQ_HandleTypeDef *q);
+static void I2CQ_Fail(I2CQ_HandleTypeDef *q, I2CQ_StatusTypeDef status);
+static void I2CQ_Finish(I2CQ_HandleTypeDef *q, I2CQ_StatusTypeDef status);
+static void I2CQ_Recover(I2CQ_HandleTypeDef *q);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Reset the queue and bind it to a bus port.
+  * @param  q: Queue handle
+  * @param  port: Bus operations, must outlive the queue
+  * @retval None
+  */
+void I2CQ_Init(I2CQ_HandleTypeDef *q, const I2CQ_PortTypeDef *port)
+{
+  memset(q, 0, sizeof(*q));
+  q->Port = port;
+}
+
+/**
+  * @brief  Fill in a register write descriptor.
+  * @param  xfer: Descriptor to fill
+  * @param  dev: 8-bit device address
+  * @param  reg: First register
+  * @param  data: Bytes written after the register, may be NULL if len is 0
+  * @param  len: Number of data bytes
+  * @retval None
+  */
+void I2CQ_SetWrite(I2CQ_XferTypeDef *xfer, uint8_t dev, uint8_t reg, uint8_t *data, uint16_t len)
+{
+  memset(xfer, 0, sizeof(*xfer));
+  xfer->DevAddr = dev;
+  xfer->Reg     = reg;
+  xfer->Dir     = I2CQ_WRITE;
+  xfer->Data    = data;
+  xfer->Len     = len;
+}
+
+/**
+  * @brief  Fill in a register read descriptor.
+  * @param  xfer: Descriptor to fill
+  * @param  dev: 8-bit device address
+  * @param  reg: First register
+  * @param  data: Destination buffer
+  * @param  len: Number of bytes to read, at least 1
+  * @retval None
+  */
+void I2CQ_SetRead(I2CQ_XferTypeDef *xfer, uint8_t dev, uint8_t reg, uint8_t *data, uint16_t len)
+{
+  I2CQ_SetWrite(xfer, dev, reg, data, len);
+  xfer->Dir = I2CQ_READ;
+}
+
+/**
+  * @brief  Queue a batch of transactions. The batch is queued as a whole or
+  *         not at all and runs back to back in array order. Safe to call from
+  *         thread context and from completion callbacks.
+  * @param  q: Queue handle
+  * @param  xfers: Array of descriptors owned by the caller
+  * @param  count: Number of descriptors
+  * @retval I2CQ_OK, I2CQ_FULL or I2CQ_INVALID
+  */
+I2CQ_StatusTypeDef I2CQ_Submit(I2CQ_HandleTypeDef *q, I2CQ_XferTypeDef *xfers, uint32_t count)
+{
+  uint32_t i;
+  uint32_t lock;
+  uint32_t used;
+
+  for (i = 0U; i < count; i++)
+  {
+    if ((xfers[i].Dir > I2CQ_READ) ||
+        ((xfers[i].Dir == I2CQ_READ) && (xfers[i].Len == 0U)) ||
+        ((xfers[i].Len != 0U) && (xfers[i].Data == NULL)) ||
+        (xfers[i].Status == I2CQ_PENDING))
+    {
+      return I2CQ_INVALID;
+    }
+  }
+
+  lock = q->Port->Lock();
+  used = q->Head - q->Tail;
+  if (count > (I2CQ_DEPTH - used))
+  {
+    q->Port->Unlock(lock);
+    return I2CQ_FULL;
+  }
+  for (i = 0U; i < count; i++)
+  {
+    xfers[i].Status = I2CQ_PENDING;
+    q->Queue[q->Head & I2CQ_MASK] = &xfers[i];
+    q->Head++;
+  }
+  used += count;
+  if (used > q->Stats.MaxQueued)
+  {
+    q->Stats.MaxQueued = used;
+  }
+  q->Port->Unlock(lock);
+
+  q->Port->Kick();
+  return I2CQ_OK;
+}
+
+/**
+  * @brief  Advance the active transaction on a port event.
+  *         Must be called from the bus interrupt context.
+  * @param  q: Queue handle
+  * @param  event: What the bus just did
+  * @retval None
+  */
+void I2CQ_Event(I2CQ_HandleTypeDef *q, I2CQ_EventTypeDef event)
+{
+  I2CQ_XferTypeDef *x = q->Active;
+
+  if (x == NULL)
+  {
+    /* Late event of a transaction that already timed out */
+    return;
+  }
+
+  switch (event)
+  {
+    case I2CQ_EV_START:
+      if (q->State == I2CQ_ST_START)
+      {
+        q->State = I2CQ_ST_ADDR_W;
+        q->Port->SendAddress((uint8_t)(x->DevAddr & 0xFEU));
+        return;
+      }
+      if (q->State == I2CQ_ST_RESTART)
+      {
+        q->State = I2CQ_ST_READ;
+        q->Port->PrepareRead(x->Data, x->Len);
+        q->Port->SendAddress((uint8_t)(x->DevAddr | 0x01U));
+        return;
+      }
+      break;
+
+    case I2CQ_EV_ADDR_ACK:
+      if (q->State == I2CQ_ST_ADDR_W)
+      {
+        q->State = I2CQ_ST_REG;
+        q->Port->WriteByte(x->Reg);
+        return;
+      }
+      break;
+
+    case I2CQ_EV_TX_DONE:
+      if ((q->State == I2CQ_ST_REG) && (x->Dir == I2CQ_READ))
+      {
+        q->State = I2CQ_ST_RESTART;
+        q->Port->Start();
+        return;
+      }
+      if ((q->State == I2CQ_ST_REG) || (q->State == I2CQ_ST_DATA))
+      {
+        if (q->Index < x->Len)
+        {
+          q->State = I2CQ_ST_DATA;
+          q->Port->WriteByte(x->Data[q->Index++]);
+        }
+        else
+        {
+          q->Port->Stop();
+          I2CQ_Finish(q, I2CQ_OK);
+        }
+        return;
+      }
+      break;
+
+    case I2CQ_EV_RX_DONE:
+      if (q->State == I2CQ_ST_READ)
+      {
+        I2CQ_Finish(q, I2CQ_OK);
+        return;
+      }
+      break;
+
+    case I2CQ_EV_NACK:
+      q->Stats.Nacks++;
+      q->Port->Stop();
+      I2CQ_Fail(q, I2CQ_NACK);
+      return;
+
+    case I2CQ_EV_BUS_ERROR:
+    default:
+      break;
+  }
+
+  /* Bus error, or an event the current state cannot explain */
+  q->Stats.BusErrors++;
+  I2CQ_Recover(q);
+  I2CQ_Fail(q, I2CQ_BUS_ERROR);
+}
+
+/**
+  * @brief  Handle a pending timeout and start the next transaction if the
+  *         bus is idle. Called by the port in bus context after Kick().
+  * @param  q: Queue handle
+  * @retval None
+  */
+void I2CQ_Service(I2CQ_HandleTypeDef *q)
+{
+  if (q->TimedOut != 0U)
+  {
+    q->TimedOut = 0U;
+    /* The flagged transaction may have finished in the meantime */
+    if ((q->Active != NULL) && (q->Ticks >= I2CQ_TIMEOUT_TICKS))
+    {
+      q->Stats.Timeouts++;
+      I2CQ_Recover(q);
+      I2CQ_Fail(q, I2CQ_TIMEOUT);
+      return;
+    }
+  }
+
+  if ((q->Active == NULL) && (q->Tail != q->Head))
+  {
+    q->Active  = q->Queue[q->Tail & I2CQ_MASK];
+    q->Tail++;
+    q->Attempt = 0U;
+    I2CQ_Begin(q);
+  }
+}
+
+/**
+  * @brief  Timeout clock, typically called from the 1 ms SysTick.
+  *         Only flags the timeout; the recovery itself runs in bus context.
+  * @param  q: Queue handle
+  * @retval None
+  */
+void I2CQ_Tick(I2CQ_HandleTypeDef *q)
+{
+  if ((q->Active == NULL) || (q->TimedOut != 0U))
+  {
+    return;
+  }
+  if (++q->Ticks >= I2CQ_TIMEOUT_TICKS)
+  {
+    q->TimedOut = 1U;
+    q->Port->Kick();
+  }
+}
+
+/**
+  * @brief  Number of transactions queued or on the bus.
+  * @param  q: Queue handle
+  * @retval Count
+  */
+uint32_t I2CQ_Pending(const I2CQ_HandleTypeDef *q)
+{
+  return (q->Head - q->Tail) + ((q->Active != NULL) ? 1U : 0U);
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Put the active transaction on the bus from the top.
+  * @param  q: Queue handle
+  * @retval None
+  */
+static void I2CQ_Begin(I2CQ_HandleTypeDef *q)
+{
+  q->State = I2CQ_ST_START;
+  q->Index = 0U;
+  q->Ticks = 0U;
+  q->Port->Start();
+}
+
+/**
+  * @brief  Retry the active transaction or complete it with an error.
+  * @param  q: Queue handle
+  * @param  status: Error to report if no retry is left
+  * @retval None
+  */
+static void I2CQ_Fail(I2CQ_HandleTypeDef *q, I2CQ_StatusTypeDef status)
+{
+  if (q->Attempt < q->Active->Retries)
+  {
+    q->Attempt++;
+    q->Stats.Retries++;
+    I2CQ_Begin(q);
+    return;
+  }
+  I2CQ_Finish(q, status);
+}
+
+/**
+  * @brief  Complete the active transaction, notify its owner and move on.
+  * @param  q: Queue handle
+  * @param  status: Final status
+  * @retval None
+  */
+static void I2CQ_Finish(I2CQ_HandleTypeDef *q, I2CQ_StatusTypeDef status)
+{
+  I2CQ_XferTypeDef *x = q->Active;
+
+  q->Active = NULL;
+  q->State  = I2CQ_ST_IDLE;
+  if (status == I2CQ_OK)
+  {
+    q->Stats.Completed++;
+  }
+  else
+  {
+    q->Stats.Failed++;
+  }
+
+  x->Status = (uint8_t)status;
+  if (x->Callback != NULL)
+  {
+    x->Callback(x);
+  }
+
+  I2CQ_Service(q);
+}
+
+/**
+  * @brief  Reset the peripheral and release the bus.
+  * @param  q: Queue handle
+  * @retval None
+  */
+static void I2CQ_Recover(I2CQ_HandleTypeDef *q)
+{
+  q->Stats.Recoveries++;
+  q->State = I2CQ_ST_IDLE;
+  q->Port->Recover();
+}
@@ -0,0 +1,714 @@
+/**
+  ******************************************************************************
+  * @file    kernel.c
+  * @brief   Preemptive fixed-priority scheduler, semaphores and mutexes.
+  ******************************************************************************
+  * Ready tasks sit in one circular list per priority; bit (31 - p) of
+  * ReadyMask is set while list p is not empty, so the highest ready priority
+  * is a single count-leading-zeros. The running task stays at the head of
+  * its list.
+  *
+  * Wait queues are kept sorted by effective priority, FIFO among equals.
+  * A task blocked on a mutex lends its priority to the owner, and on along
+  * the chain if that owner is itself blocked on a mutex; the owner falls
+  * back to the highest priority still waiting on what it holds when it
+  * unlocks or a waiter times out.
+  *
+  * Every function runs under the port lock. Sleeping and timed tasks are
+  * found by a scan of the task table on each tick, which is fine for
+  * KERNEL_MAX_TASKS tasks.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "kernel.h"
+#include "placement.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+/* Highest ready priority. GCC emits the Cortex-M4 CLZ instruction here,
+   the same as CMSIS __CLZ(); the mask is never 0 when this is used. */
+#define KERNEL_HIGHEST(mask)    ((uint32_t)__builtin_clz(mask))
+#define KERNEL_BIT(priority)    (0x80000000U >> (priority))
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+  const KERNEL_PortTypeDef *Port;
+  KERNEL_TaskTypeDef *Current;
+  KERNEL_TaskTypeDef *Ready[KERNEL_PRIORITIES];
+  uint32_t            ReadyMask;
+  KERNEL_TaskTypeDef *Tasks[KERNEL_MAX_TASKS];
+  uint32_t            Count;
+  volatile uint32_t   Ticks;
+  uint32_t            Switches;
+  uint8_t             Started;
+} KERNEL_StateTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static KERNEL_StateTypeDef Kernel;
+
+/* Private function prototypes -----------------------------------------------*/
+static void     KERNEL_ReadyInsert(KERNEL_TaskTypeDef *task);
+static void     KERNEL_ReadyRemove(KERNEL_TaskTypeDef *task);
+static void     KERNEL_WaitInsert(KERNEL_WaitQueueTypeDef *queue, KERNEL_TaskTypeDef *task);
+static void     KERNEL_WaitRemove(KERNEL_WaitQueueTypeDef *queue, KERNEL_TaskTypeDef *task);
+static void     KERNEL_Block(KERNEL_WaitQueueTypeDef *queue, uint32_t timeout);
+static void     KERNEL_Wake(KERNEL_TaskTypeDef *task, KERNEL_StatusTypeDef result);
+static void     KERNEL_SetPriority(KERNEL_TaskTypeDef *task, uint8_t priority);
+static void     KERNEL_Reprioritize(KERNEL_TaskTypeDef *task);
+static void     KERNEL_Reschedule(void);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Forget every task and bind the kernel to a CPU port.
+  * @param  port: CPU operations, must outlive the kernel
+  * @retval None
+  */
+void KERNEL_Init(const KERNEL_PortTypeDef *port)
+{
+  memset(&Kernel, 0, sizeof(Kernel));
+  Kernel.Port = port;
+}
+
+/**
+  * @brief  Create a ready task on a static stack.
+  * @param  task: Control block, owned by the kernel from now on
+  * @param  name: Task name, must be static
+  * @param  entry: Task function; returning from it ends the task
+  * @param  argument: Passed to entry
+  * @param  priority: 0 (highest) to KERNEL_PRIORITIES - 1
+  * @param  stack: Stack memory, 8-byte aligned
+  * @param  words: Stack size in 32-bit words, at least KERNEL_STACK_MIN
+  * @retval KERNEL_FULL with KERNEL_MAX_TASKS tasks, KERNEL_INVALID for bad arguments
+  */
+KERNEL_StatusTypeDef KERNEL_TaskCreate(KERNEL_TaskTypeDef *task, const char *name, KERNEL_EntryTypeDef entry,
+                                       void *argument, uint32_t priority, uint32_t *stack, uint32_t words)
+{
+  uint32_t *frame;
+  uint32_t state;
+  uint32_t i;
+
+  if ((task == NULL) || (entry == NULL) || (stack == NULL) ||
+      (priority >= KERNEL_PRIORITIES) || (words < KERNEL_STACK_MIN))
+  {
+    return KERNEL_INVALID;
+  }
+  if (Kernel.Count >= KERNEL_MAX_TASKS)
+  {
+    return KERNEL_FULL;
+  }
+
+  memset(task, 0, sizeof(*task));
+  task->Name         = name;
+  task->Stack        = stack;
+  task->StackWords   = words;
+  task->Priority     = (uint8_t)priority;
+  task->BasePriority = (uint8_t)priority;
+
+  /* Fill for KERNEL_StackUnused(), then build the first frame at the top,
+     rounded down to the 8-byte alignment the AAPCS wants */
+  for (i = 0U; i < words; i++)
+  {
+    stack[i] = KERNEL_STACK_FILL;
+  }
+  frame = stack + ((words - KERNEL_FRAME_WORDS) & ~1U);
+  for (i = 0U; i < KERNEL_FRAME_WORDS; i++)
+  {
+    frame[i] = 0U;
+  }
+  frame[KERNEL_FRAME_EXC_RETURN] = KERNEL_EXC_RETURN_TASK;
+  frame[KERNEL_FRAME_R0]   = (uint32_t)(uintptr_t)argument;
+  frame[KERNEL_FRAME_LR]   = (uint32_t)(uintptr_t)Kernel.Port->Exit;
+  frame[KERNEL_FRAME_PC]   = (uint32_t)(uintptr_t)entry & ~1U;
+  frame[KERNEL_FRAME_XPSR] = KERNEL_XPSR_THUMB;
+  task->Sp = frame;
+
+  state = Kernel.Port->Lock();
+  task->Id = (uint8_t)Kernel.Count;
+  Kernel.Tasks[Kernel.Count++] = task;
+  KERNEL_ReadyInsert(task);
+  KERNEL_Reschedule();
+  Kernel.Port->Unlock(state);
+  return KERNEL_OK;
+}
+
+/**
+  * @brief  Pick the first task to run. The port then switches to its stack.
+  * @retval Task to start, NULL if no task is ready
+  */
+KERNEL_TaskTypeDef *KERNEL_Start(void)
+{
+  uint32_t state = Kernel.Port->Lock();
+
+  if (Kernel.ReadyMask != 0U)
+  {
+    Kernel.Current = Kernel.Ready[KERNEL_HIGHEST(Kernel.ReadyMask)];
+    Kernel.Current->Runs++;
+    Kernel.Started = 1U;
+  }
+  Kernel.Port->Unlock(state);
+  return Kernel.Current;
+}
+
+/**
+  * @brief  Context switch decision, called by the port's switch handler.
+  * @param  sp: Stack pointer of the task being switched out
+  * @retval Stack pointer of the task to switch in
+  */
+CODE_HOT uint32_t *KERNEL_Switch(uint32_t *sp)
+{
+  KERNEL_TaskTypeDef *next;
+  uint32_t state = Kernel.Port->Lock();
+
+  Kernel.Current->Sp = sp;
+  next = Kernel.Ready[KERNEL_HIGHEST(Kernel.ReadyMask)];
+  if (next != Kernel.Current)
+  {
+    Kernel.Current = next;
+    next->Runs++;
+    Kernel.Switches++;
+  }
+  Kernel.Port->Unlock(state);
+  return next->Sp;
+}
+
+/**
+  * @brief  Kernel clock: wakes sleeping tasks and times out waits.
+  * @retval None
+  */
+CODE_HOT void KERNEL_Tick(void)
+{
+  KERNEL_TaskTypeDef *task;
+  uint32_t state;
+  uint32_t i;
+
+  if (Kernel.Started == 0U)
+  {
+    return;
+  }
+  state = Kernel.Port->Lock();
+  Kernel.Ticks++;
+  Kernel.Current->Ticks++;
+  for (i = 0U; i < Kernel.Count; i++)
+  {
+    task = Kernel.Tasks[i];
+    if ((int32_t)(Kernel.Ticks - task->Wake) < 0)
+    {
+      continue;
+    }
+    if (task->State == KERNEL_TASK_SLEEPING)
+    {
+      KERNEL_Wake(task, KERNEL_OK);
+    }
+    else if ((task->State == KERNEL_TASK_BLOCKED) && (task->Timed != 0U))
+    {
+      KERNEL_Wake(task, KERNEL_TIMEOUT);
+    }
+  }
+  KERNEL_Reschedule();
+  Kernel.Port->Unlock(state);
+}
+
+/**
+  * @brief  End the running task. Reached when a task function returns.
+  * @retval None
+  */
+void KERNEL_TaskExit(void)
+{
+  uint32_t state = Kernel.Port->Lock();
+
+  KERNEL_ReadyRemove(Kernel.Current);
+  Kernel.Current->State = KERNEL_TASK_DEAD;
+  KERNEL_Reschedule();
+  Kernel.Port->Unlock(state);
+}
+
+/**
+  * @brief  Running task.
+  * @retval Task, NULL before KERNEL_Start()
+  */
+KERNEL_TaskTypeDef *KERNEL_Current(void)
+{
+  return Kernel.Current;
+}
+
+/**
+  * @brief  Task by Id, to walk every task created so far.
+  * @param  id: 0 for the first task created
+  * @retval Task, NULL past the last one
+  */
+KERNEL_TaskTypeDef *KERNEL_TaskAt(uint32_t id)
+{
+  return (id < Kernel.Count) ? Kernel.Tasks[id] : NULL;
+}
+
+/**
+  * @brief  Kernel ticks since KERNEL_Start().
+  * @retval Ticks
+  */
+uint32_t KERNEL_Ticks(void)
+{
+  return Kernel.Ticks;
+}
+
+/**
+  * @brief  Context switches since KERNEL_Start().
+  * @retval Switches
+  */
+uint32_t KERNEL_Switches(void)
+{
+  return Kernel.Switches;
+}
+
+/**
+  * @brief  Stack words never written since the task was created.
+  * @param  task: Task
+  * @retval Words at the bottom of the stack still holding KERNEL_STACK_FILL
+  */
+uint32_t KERNEL_StackUnused(const KERNEL_TaskTypeDef *task)
+{
+  uint32_t i = 0U;
+
+  while ((i < task->StackWords) && (task->Stack[i] == KERNEL_STACK_FILL))
+  {
+    i++;
+  }
+  return i;
+}
+
+/**
+  * @brief  Let the next ready task of the same priority run.
+  * @retval None
+  */
+void KERNEL_Yield(void)
+{
+  KERNEL_TaskTypeDef *self = Kernel.Current;
+  uint32_t state = Kernel.Port->Lock();
+
+  if (Kernel.Ready[self->Priority] == self)
+  {
+    Kernel.Ready[self->Priority] = self->Next;
+  }
+  KERNEL_Reschedule();
+  Kernel.Port->Unlock(state);
+}
+
+/**
+  * @brief  Block the running task for a number of ticks.
+  * @param  ticks: Ticks to sleep, 0 just yields
+  * @retval None
+  */
+void KERNEL_Sleep(uint32_t ticks)
+{
+  KERNEL_TaskTypeDef *self = Kernel.Current;
+  uint32_t state;
+
+  if (ticks == 0U)
+  {
+    KERNEL_Yield();
+    return;
+  }
+  state = Kernel.Port->Lock();
+  KERNEL_ReadyRemove(self);
+  self->State = KERNEL_TASK_SLEEPING;
+  self->Wake  = Kernel.Ticks + ticks;
+  KERNEL_Reschedule();
+  Kernel.Port->Unlock(state);
+}
+
+/**
+  * @brief  Initialise a counting semaphore.
+  * @param  sem: Semaphore
+  * @param  count: Initial count
+  * @param  max: Highest count, 1 for a binary semaphore
+  * @retval None
+  */
+void KERNEL_SemInit(KERNEL_SemTypeDef *sem, uint32_t count, uint32_t max)
+{
+  sem->Waiters.Head = NULL;
+  sem->Max   = max;
+  sem->Count = (count < max) ? count : max;
+}
+
+/**
+  * @brief  Take a semaphore, blocking while its count is 0.
+  *         With a timeout of 0 this is safe in interrupts.
+  * @param  sem: Semaphore
+  * @param  timeout: Ticks to wait, 0 to poll, KERNEL_FOREVER
+  * @retval KERNEL_OK, KERNEL_TIMEOUT (or KERNEL_PENDING, see kernel.h)
+  */
+KERNEL_StatusTypeDef KERNEL_SemTake(KERNEL_SemTypeDef *sem, uint32_t timeout)
+{
+  KERNEL_TaskTypeDef *self = Kernel.Current;
+  uint32_t state = Kernel.Port->Lock();
+
+  if (sem->Count != 0U)
+  {
+    sem->Count--;
+    Kernel.Port->Unlock(state);
+    return KERNEL_OK;
+  }
+  if (timeout == 0U)
+  {
+    Kernel.Port->Unlock(state);
+    return KERNEL_TIMEOUT;
+  }
+  KERNEL_Block(&sem->Waiters, timeout);
+  Kernel.Port->Unlock(state);
+  return (KERNEL_StatusTypeDef)self->WaitResult;
+}
+
+/**
+  * @brief  Give a semaphore: wake its highest priority waiter or count up.
+  *         Safe in interrupts.
+  * @param  sem: Semaphore
+  * @retval KERNEL_FULL if the count was already at its maximum
+  */
+KERNEL_StatusTypeDef KERNEL_SemGive(KERNEL_SemTypeDef *sem)
+{
+  KERNEL_StatusTypeDef status = KERNEL_OK;
+  uint32_t state = Kernel.Port->Lock();
+
+  if (sem->Waiters.Head != NULL)
+  {
+    KERNEL_Wake(sem->Waiters.Head, KERNEL_OK);
+    KERNEL_Reschedule();
+  }
+  else if (sem->Count < sem->Max)
+  {
+    sem->Count++;
+  }
+  else
+  {
+    status = KERNEL_FULL;
+  }
+  Kernel.Port->Unlock(state);
+  return status;
+}
+
+/**
+  * @brief  Initialise an unlocked mutex.
+  * @param  mutex: Mutex
+  * @retval None
+  */
+void KERNEL_MutexInit(KERNEL_MutexTypeDef *mutex)
+{
+  mutex->Waiters.Head = NULL;
+  mutex->Owner    = NULL;
+  mutex->NextHeld = NULL;
+}
+
+/**
+  * @brief  Lock a mutex, lending the caller's priority to its owner while
+  *         waiting. Not recursive; task context only.
+  * @param  mutex: Mutex
+  * @param  timeout: Ticks to wait, 0 to poll, KERNEL_FOREVER
+  * @retval KERNEL_OK, KERNEL_TIMEOUT, KERNEL_INVALID if already owned by the
+  *         caller (or KERNEL_PENDING, see kernel.h)
+  */
+KERNEL_StatusTypeDef KERNEL_MutexLock(KERNEL_MutexTypeDef *mutex, uint32_t timeout)
+{
+  KERNEL_TaskTypeDef *self = Kernel.Current;
+  KERNEL_StatusTypeDef status = KERNEL_OK;
+  uint32_t state = Kernel.Port->Lock();
+
+  if (mutex->Owner == NULL)
+  {
+    mutex->Owner    = self;
+    mutex->NextHeld = self->Held;
+    self->Held      = mutex;
+  }
+  else if (mutex->Owner == self)
+  {
+    status = KERNEL_INVALID;
+  }
+  else if (timeout == 0U)
+  {
+    status = KERNEL_TIMEOUT;
+  }
+  else
+  {
+    self->WaitMutex = mutex;
+    KERNEL_Block(&mutex->Waiters, timeout);
+    KERNEL_Reprioritize(mutex->Owner);
+    Kernel.Port->Unlock(state);
+    return (KERNEL_StatusTypeDef)self->WaitResult;
+  }
+  Kernel.Port->Unlock(state);
+  return status;
+}
+
+/**
+  * @brief  Unlock a mutex, handing it to its highest priority waiter, and
+  *         drop any priority the caller inherited through it.
+  * @param  mutex: Mutex owned by the caller
+  * @retval KERNEL_INVALID if the caller is not the owner
+  */
+KERNEL_StatusTypeDef KERNEL_MutexUnlock(KERNEL_MutexTypeDef *mutex)
+{
+  KERNEL_TaskTypeDef *self = Kernel.Current;
+  KERNEL_TaskTypeDef *next;
+  KERNEL_MutexTypeDef **link;
+  uint32_t state = Kernel.Port->Lock();
+
+  if (mutex->Owner != self)
+  {
+    Kernel.Port->Unlock(state);
+    return KERNEL_INVALID;
+  }
+  for (link = &self->Held; *link != mutex; link = &(*link)->NextHeld)
+  {
+  }
+  *link = mutex->NextHeld;
+
+  next = mutex->Waiters.Head;
+  mutex->Owner = next;
+  if (next != NULL)
+  {
+    KERNEL_Wake(next, KERNEL_OK);
+    mutex->NextHeld = next->Held;
+    next->Held = mutex;
+    KERNEL_Reprioritize(next);
+  }
+  KERNEL_Reprioritize(self);
+  KERNEL_Reschedule();
+  Kernel.Port->Unlock(state);
+  return KERNEL_OK;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Append a task to the ready ring of its priority.
+  * @param  task: Task not in any list
+  * @retval None
+  */
+static void KERNEL_ReadyInsert(KERNEL_TaskTypeDef *task)
+{
+  KERNEL_TaskTypeDef **head = &Kernel.Ready[task->Priority];
+
+  task->State = KERNEL_TASK_READY;
+  if (*head == NULL)
+  {
+    task->Next = task;
+    task->Prev = task;
+    *head = task;
+    Kernel.ReadyMask |= KERNEL_BIT(task->Priority);
+  }
+  else
+  {
+    task->Next = *head;
+    task->Prev = (*head)->Prev;
+    (*head)->Prev->Next = task;
+    (*head)->Prev = task;
+  }
+}
+
+/**
+  * @brief  Take a task out of the ready ring of its priority.
+  * @param  task: Ready task
+  * @retval None
+  */
+static void KERNEL_ReadyRemove(KERNEL_TaskTypeDef *task)
+{
+  KERNEL_TaskTypeDef **head = &Kernel.Ready[task->Priority];
+
+  if (task->Next == task)
+  {
+    *head = NULL;
+    Kernel.ReadyMask &= ~KERNEL_BIT(task->Priority);
+  }
+  else
+  {
+    task->Prev->Next = task->Next;
+    task->Next->Prev = task->Prev;
+    if (*head == task)
+    {
+      *head = task->Next;
+    }
+  }
+  task->Next = NULL;
+  task->Prev = NULL;
+}
+
+/**
+  * @brief  Insert a task into a wait queue behind every task of its priority.
+  * @param  queue: Wait queue
+  * @param  task: Task not in any list
+  * @retval None
+  */
+static void KERNEL_WaitInsert(KERNEL_WaitQueueTypeDef *queue, KERNEL_TaskTypeDef *task)
+{
+  KERNEL_TaskTypeDef *prev = NULL;
+  KERNEL_TaskTypeDef *at = queue->Head;
+
+  while ((at != NULL) && (at->Priority <= task->Priority))
+  {
+    prev = at;
+    at = at->Next;
+  }
+  task->Prev = prev;
+  task->Next = at;
+  if (at != NULL)
+  {
+    at->Prev = task;
+  }
+  if (prev != NULL)
+  {
+    prev->Next = task;
+  }
+  else
+  {
+    queue->Head = task;
+  }
+}
+
+/**
+  * @brief  Take a task out of a wait queue.
+  * @param  queue: Wait queue holding the task
+  * @param  task: Task
+  * @retval None
+  */
+static void KERNEL_WaitRemove(KERNEL_WaitQueueTypeDef *queue, KERNEL_TaskTypeDef *task)
+{
+  if (task->Prev != NULL)
+  {
+    task->Prev->Next = task->Next;
+  }
+  else
+  {
+    queue->Head = task->Next;
+  }
+  if (task->Next != NULL)
+  {
+    task->Next->Prev = task->Prev;
+  }
+  task->Next = NULL;
+  task->Prev = NULL;
+}
+
+/**
+  * @brief  Move the running task from its ready ring onto a wait queue.
+  * @param  queue: Wait queue
+  * @param  timeout: Ticks, or KERNEL_FOREVER
+  * @retval None
+  */
+static void KERNEL_Block(KERNEL_WaitQueueTypeDef *queue, uint32_t timeout)
+{
+  KERNEL_TaskTypeDef *self = Kernel.Current;
+
+  KERNEL_ReadyRemove(self);
+  self->State      = KERNEL_TASK_BLOCKED;
+  self->WaitResult = KERNEL_PENDING;
+  self->WaitQueue  = queue;
+  self->Timed      = (timeout != KERNEL_FOREVER) ? 1U : 0U;
+  self->Wake       = Kernel.Ticks + timeout;
+  KERNEL_WaitInsert(queue, self);
+  KERNEL_Reschedule();
+}
+
+/**
+  * @brief  Make a sleeping or blocked task ready.
+  * @param  task: Task
+  * @param  result: What its wait returns
+  * @retval None
+  */
+CODE_HOT static void KERNEL_Wake(KERNEL_TaskTypeDef *task, KERNEL_StatusTypeDef result)
+{
+  KERNEL_MutexTypeDef *mutex = task->WaitMutex;
+
+  if (task->WaitQueue != NULL)
+  {
+    KERNEL_WaitRemove(task->WaitQueue, task);
+    task->WaitQueue = NULL;
+  }
+  task->WaitMutex  = NULL;
+  task->Timed      = 0U;
+  task->WaitResult = (uint8_t)result;
+  KERNEL_ReadyInsert(task);
+
+  /* A waiter that gave up no longer lends its priority */
+  if ((mutex != NULL) && (result != KERNEL_OK))
+  {
+    KERNEL_Reprioritize(mutex->Owner);
+  }
+}
+
+/**
+  * @brief  Change a task's effective priority, keeping its list sorted.
+  * @param  task: Task
+  * @param  priority: New effective priority
+  * @retval None
+  */
+static void KERNEL_SetPriority(KERNEL_TaskTypeDef *task, uint8_t priority)
+{
+  if (task->State == KERNEL_TASK_READY)
+  {
+    KERNEL_ReadyRemove(task);
+    task->Priority = priority;
+    KERNEL_ReadyInsert(task);
+    if (task == Kernel.Current)
+    {
+      /* The running task keeps running first within its new priority */
+      Kernel.Ready[priority] = task;
+    }
+  }
+  else if (task->State == KERNEL_TASK_BLOCKED)
+  {
+    KERNEL_WaitRemove(task->WaitQueue, task);
+    task->Priority = priority;
+    KERNEL_WaitInsert(task->WaitQueue, task);
+  }
+  else
+  {
+    task->Priority = priority;
+  }
+}
+
+/**
+  * @brief  Recompute a task's effective priority from its base priority and
+  *         the waiters of the mutexes it holds, then along the chain of
+  *         owners it is itself waiting for.
+  * @param  task: Task, may be NULL
+  * @retval None
+  */
+static void KERNEL_Reprioritize(KERNEL_TaskTypeDef *task)
+{
+  KERNEL_MutexTypeDef *mutex;
+  uint8_t priority;
+
+  while (task != NULL)
+  {
+    priority = task->BasePriority;
+    for (mutex = task->Held; mutex != NULL; mutex = mutex->NextHeld)
+    {
+      if ((mutex->Waiters.Head != NULL) && (mutex->Waiters.Head->Priority < priority))
+      {
+        priority = mutex->Waiters.Head->Priority;
+      }
+    }
+    if (priority == task->Priority)
+    {
+      return;
+    }
+    KERNEL_SetPriority(task, priority);
+    task = (task->WaitMutex != NULL) ? task->WaitMutex->Owner : NULL;
+  }
+}
+
+/**
+  * @brief  Request a context switch if the running task is no longer the
+  *         one that should run.
+  * @retval None
+  */
+CODE_HOT static void KERNEL_Reschedule(void)
+{
+  if ((Kernel.Started != 0U) && (Kernel.ReadyMask != 0U) &&
+      (Kernel.Ready[KERNEL_HIGHEST(Kernel.ReadyMask)] != Kernel.Current))
+  {
+    Kernel.Port->Switch();
+  }
+}
@@ -0,0 +1,262 @@
+/**
+  ******************************************************************************
+  * @file    kernel_port.c
+  * @brief   Cortex-M4F port of the kernel.
+  ******************************************************************************
+  * Tasks run in thread mode on the process stack, interrupts on the main
+  * stack. The kernel asks for a switch by pending PendSV, which sits at the
+  * lowest priority with SysTick, so a switch always happens after every
+  * other interrupt has finished and never nests.
+  *
+  * Lazy FP state preservation (FPCCR ASPEN and LSPEN, the reset values) is
+  * set explicitly: the FP registers a task uses are only saved by PendSV
+  * when its exception frame says it has FP context.
+  *
+  * USE_RTOS stays 0 in stm32f4xx_hal_conf.h: the HAL rejects 1 at compile
+  * time and only uses it for its own handle locking. HAL_Delay() still
+  * works in a task but spins; tasks use KERNEL_Sleep() instead.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "kernel_port.h"
+#include "dwt.h"
+#include "placement.h"
+#include "trace_recorder.h"
+
+/* Private function prototypes -----------------------------------------------*/
+static void     KERNEL_PORT_Switch(void);
+static void     KERNEL_PORT_Exit(void);
+static uint32_t KERNEL_PORT_Lock(void);
+static void     KERNEL_PORT_Unlock(uint32_t state);
+static void     KERNEL_PORT_Idle(void *argument);
+static void     KERNEL_PORT_BenchTask(void *argument);
+
+/* Private variables ---------------------------------------------------------*/
+static const KERNEL_PortTypeDef KernelPort =
+{
+  KERNEL_PORT_Switch,
+  KERNEL_PORT_Exit,
+  KERNEL_PORT_Lock,
+  KERNEL_PORT_Unlock
+};
+
+static KERNEL_TaskTypeDef IdleTask;
+static uint64_t IdleStack[KERNEL_PORT_IDLE_WORDS / 2U];
+
+static KERNEL_TaskTypeDef BenchTask;
+static uint64_t BenchStack[KERNEL_PORT_BENCH_WORDS / 2U];
+static KERNEL_SemTypeDef BenchSem;
+static volatile uint32_t BenchStamp;
+static KERNEL_PORT_BenchTypeDef *BenchResult;
+static uint64_t BenchTotal;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Initialise the kernel and create the idle task.
+  * @retval None
+  */
+void KERNEL_PORT_Init(void)
+{
+  FPU->FPCCR |= FPU_FPCCR_ASPEN_Msk | FPU_FPCCR_LSPEN_Msk;
+  NVIC_SetPriority(PendSV_IRQn, (1UL << __NVIC_PRIO_BITS) - 1UL);
+
+  KERNEL_Init(&KernelPort);
+  if (KERNEL_TaskCreate(&IdleTask, "idle", KERNEL_PORT_Idle, NULL, KERNEL_PORT_IDLE_PRIORITY,
+                        (uint32_t *)IdleStack, KERNEL_PORT_IDLE_WORDS) != KERNEL_OK)
+  {
+    Error_Handler();
+  }
+}
+
+/**
+  * @brief  Start the highest priority task. main() does not continue.
+  * @retval None
+  */
+void KERNEL_PORT_Start(void)
+{
+  __ASM volatile ("svc 0");
+  while (1)
+  {
+  }
+}
+
+/**
+  * @brief  Context switch, called from PendSV with the outgoing task saved.
+  * @param  sp: Process stack pointer of the outgoing task
+  * @retval Process stack pointer of the incoming task
+  */
+CODE_HOT uint32_t *KERNEL_PORT_SwitchContext(uint32_t *sp)
+{
+  uint32_t switches = KERNEL_Switches();
+  uint32_t *next = KERNEL_Switch(sp);
+
+  if (KERNEL_Switches() != switches)
+  {
+    TRACE_TASK_SWITCH(KERNEL_Current()->Id);
+  }
+  return next;
+}
+
+/**
+  * @brief  First context, called from SVC.
+  * @retval Process stack pointer of the first task
+  */
+uint32_t *KERNEL_PORT_FirstContext(void)
+{
+  KERNEL_TaskTypeDef *task = KERNEL_Start();
+
+  if (task == NULL)
+  {
+    Error_Handler();
+  }
+  TRACE_TASK_SWITCH(task->Id);
+  return task->Sp;
+}
+
+/**
+  * @brief  Kernel ticks that found the CPU idle, for load measurement.
+  * @retval Idle ticks since KERNEL_PORT_Start()
+  */
+uint32_t KERNEL_PORT_IdleTicks(void)
+{
+  return IdleTask.Ticks;
+}
+
+/**
+  * @brief  Measure the context switch latency. Call once, from a task of
+  *         lower priority than KERNEL_PORT_BENCH_PRIORITY.
+  * @param  runs: Switches to measure
+  * @param  result: Filled with the cycle counts, Runs is 0 on failure
+  * @retval None
+  */
+void KERNEL_PORT_Bench(uint32_t runs, KERNEL_PORT_BenchTypeDef *result)
+{
+  uint32_t i;
+
+  result->Runs = 0U;
+  result->Min  = 0xFFFFFFFFU;
+  result->Max  = 0U;
+  result->Avg  = 0U;
+  if (BenchTask.Stack != NULL)
+  {
+    return;
+  }
+  BenchResult  = result;
+  BenchTotal   = 0U;
+  KERNEL_SemInit(&BenchSem, 0U, 1U);
+
+  /* Preempts us at once and blocks on the semaphore */
+  if (KERNEL_TaskCreate(&BenchTask, "bench", KERNEL_PORT_BenchTask, NULL, KERNEL_PORT_BENCH_PRIORITY,
+                        (uint32_t *)BenchStack, KERNEL_PORT_BENCH_WORDS) != KERNEL_OK)
+  {
+    return;
+  }
+  for (i = 0U; i < runs; i++)
+  {
+    BenchStamp = DWT_Cycles();
+    (void)KERNEL_SemGive(&BenchSem);
+  }
+  if (result->Runs != 0U)
+  {
+    result->Avg = (uint32_t)(BenchTotal / result->Runs);
+  }
+  else
+  {
+    result->Min = 0U;
+  }
+  /* Wake it once more to let it return */
+  BenchResult = NULL;
+  (void)KERNEL_SemGive(&BenchSem);
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Pend PendSV. It runs as soon as the kernel lock is released.
+  * @retval None
+  */
+static void KERNEL_PORT_Switch(void)
+{
+  SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+/**
+  * @brief  Return address of every task: ends the task.
+  * @retval None
+  */
+static void KERNEL_PORT_Exit(void)
+{
+  KERNEL_TaskExit();
+  while (1)
+  {
+  }
+}
+
+/**
+  * @brief  Mask interrupts.
+  * @retval Previous PRIMASK
+  */
+CODE_HOT static uint32_t KERNEL_PORT_Lock(void)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  return primask;
+}
+
+/**
+  * @brief  Restore interrupts.
+  * @param  state: PRIMASK from KERNEL_PORT_Lock()
+  * @retval None
+  */
+CODE_HOT static void KERNEL_PORT_Unlock(uint32_t state)
+{
+  __set_PRIMASK(state);
+}
+
+/**
+  * @brief  Idle task: sleep until the next interrupt.
+  * @param  argument: Unused
+  * @retval None
+  */
+static void KERNEL_PORT_Idle(void *argument)
+{
+  (void)argument;
+  while (1)
+  {
+    __WFI();
+  }
+}
+
+/**
+  * @brief  Benchmark task: time from the give to running here.
+  * @param  argument: Unused
+  * @retval None
+  */
+static void KERNEL_PORT_BenchTask(void *argument)
+{
+  uint32_t cycles;
+
+  (void)argument;
+  while (1)
+  {
+    (void)KERNEL_SemTake(&BenchSem, KERNEL_FOREVER);
+    cycles = DWT_Cycles() - BenchStamp;
+    if (BenchResult == NULL)
+    {
+      return;
+    }
+    BenchResult->Runs++;
+    BenchTotal += cycles;
+    if (cycles < BenchResult->Min)
+    {
+      BenchResult->Min = cycles;
+    }
+    if (cycles > BenchResult->Max)
+    {
+      BenchResult->Max = cycles;
+    }
+  }
+}
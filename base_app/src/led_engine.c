@@ -0,0 +1,176 @@
+/**
+  ******************************************************************************
+  * @file    led_engine.c
+  * @brief   LED patterns on TIM4 PWM, fed by DMA on the update event.
+  ******************************************************************************
+  * Data path on the STM32F4-Discovery:
+  *
+  *   pattern table -> DMA1 Stream3 ch2 (TIM4_CH2, circular) -> TIM4_DMAR
+  *     -> CCR1..CCR4 (burst of 4) -> PD12..PD15 (AF2)
+  *
+  * CCDS moves the CC2 DMA request onto the update event, leaving Stream6
+  * (TIM4_UP) to DAC channel 2. Every update event TIM4 requests a burst
+  * that writes the next frame of compare values; they are preloaded, so
+  * they take effect at the following update and a period is never cut
+  * short. Playback needs no interrupt and no CPU time. power.c keeps the
+  * counter at LED_ENGINE_TICK_HZ across clock switches, so the table stays
+  * valid.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "led_engine.h"
+#include "board.h"
+#include "clock_config.h"
+
+/* Private variables ---------------------------------------------------------*/
+TIM_HandleTypeDef htim4;
+DMA_HandleTypeDef hdma_tim4_ch2;
+
+static uint16_t LedTable[LED_ENGINE_MAX_FRAMES * LED_ENGINE_CHANNELS];
+static uint32_t LedPeriod;
+
+/* Private function prototypes -----------------------------------------------*/
+static void LED_ENGINE_MspInit(void);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Configure TIM4 PWM on all four LEDs, all off, and its DMA stream.
+  *         The LED pins are switched from GPIO outputs to TIM4.
+  * @retval HAL status
+  */
+HAL_StatusTypeDef LED_ENGINE_Init(void)
+{
+  static const uint32_t Channels[LED_ENGINE_CHANNELS] =
+  {
+    TIM_CHANNEL_1, TIM_CHANNEL_2, TIM_CHANNEL_3, TIM_CHANNEL_4
+  };
+  TIM_OC_InitTypeDef sConfigOC = {0};
+  uint32_t i;
+
+  LedPeriod = LED_PATTERN_Period(LED_ENGINE_TICK_HZ, LED_ENGINE_PWM_HZ);
+  if (LedPeriod == 0U)
+  {
+    return HAL_ERROR;
+  }
+  LED_ENGINE_MspInit();
+
+  htim4.Instance = TIM4;
+  htim4.Init.Prescaler = CLOCK_TIM_PSC(CLOCK_CONFIG_TIM_APB1_HZ, LED_ENGINE_TICK_HZ);
+  htim4.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim4.Init.Period = LedPeriod - 1U;
+  htim4.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim4.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+  if (HAL_TIM_PWM_Init(&htim4) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  sConfigOC.OCMode = TIM_OCMODE_PWM1;
+  sConfigOC.Pulse = 0U;
+  sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+  sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+  for (i = 0U; i < LED_ENGINE_CHANNELS; i++)
+  {
+    if (HAL_TIM_PWM_ConfigChannel(&htim4, &sConfigOC, Channels[i]) != HAL_OK)
+    {
+      return HAL_ERROR;
+    }
+  }
+
+  /* DMA1 Stream3 channel 2 is TIM4_CH2, requested on update (CCDS) */
+  hdma_tim4_ch2.Instance = DMA1_Stream3;
+  hdma_tim4_ch2.Init.Channel = DMA_CHANNEL_2;
+  hdma_tim4_ch2.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_tim4_ch2.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_tim4_ch2.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_tim4_ch2.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_tim4_ch2.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  hdma_tim4_ch2.Init.Mode = DMA_CIRCULAR;
+  hdma_tim4_ch2.Init.Priority = DMA_PRIORITY_LOW;
+  hdma_tim4_ch2.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_tim4_ch2) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  SET_BIT(htim4.Instance->CR2, TIM_CR2_CCDS);
+
+  for (i = 0U; i < LED_ENGINE_CHANNELS; i++)
+  {
+    if (HAL_TIM_PWM_Start(&htim4, Channels[i]) != HAL_OK)
+    {
+      return HAL_ERROR;
+    }
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Render the patterns of all four LEDs and loop them.
+  * @param  patterns: One per channel, LED_ENGINE_x order
+  * @param  cycle_ms: Length of the loop; each pattern repeats within it
+  * @retval HAL_ERROR if the cycle needs more than LED_ENGINE_MAX_FRAMES
+  */
+HAL_StatusTypeDef LED_ENGINE_Play(const LED_PatternTypeDef patterns[LED_ENGINE_CHANNELS], uint32_t cycle_ms)
+{
+  uint32_t frames = LED_PATTERN_Frames(LED_ENGINE_PWM_HZ, cycle_ms);
+  uint32_t i;
+
+  if (frames > LED_ENGINE_MAX_FRAMES)
+  {
+    return HAL_ERROR;
+  }
+  LED_ENGINE_Stop();
+  for (i = 0U; i < LED_ENGINE_CHANNELS; i++)
+  {
+    LED_PATTERN_Render(LedTable, frames, LED_ENGINE_CHANNELS, i, &patterns[i], LedPeriod);
+  }
+
+  /* A burst of four from CCR1; rewriting DCR restarts the burst at CCR1 */
+  htim4.Instance->DCR = TIM_DMABASE_CCR1 | TIM_DMABURSTLENGTH_4TRANSFERS;
+  if (HAL_DMA_Start(&hdma_tim4_ch2, (uint32_t)LedTable, (uint32_t)&htim4.Instance->DMAR,
+                    frames * LED_ENGINE_CHANNELS) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  __HAL_TIM_ENABLE_DMA(&htim4, TIM_DMA_CC2);
+  return HAL_OK;
+}
+
+/**
+  * @brief  Stop pattern playback. The LEDs keep the last frame written.
+  * @retval None
+  */
+void LED_ENGINE_Stop(void)
+{
+  __HAL_TIM_DISABLE_DMA(&htim4, TIM_DMA_CC2);
+  if (hdma_tim4_ch2.State == HAL_DMA_STATE_BUSY)
+  {
+    (void)HAL_DMA_Abort(&hdma_tim4_ch2);
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Clocks and pins for TIM4 and its DMA stream. No interrupts.
+  * @retval None
+  */
+static void LED_ENGINE_MspInit(void)
+{
+  __HAL_RCC_TIM4_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  __HAL_RCC_GPIOD_CLK_ENABLE();
+
+  /**TIM4 GPIO Configuration
+  PD12     ------> TIM4_CH1
+  PD13     ------> TIM4_CH2
+  PD14     ------> TIM4_CH3
+  PD15     ------> TIM4_CH4
+  */
+  LED_GREEN_Alternate(GPIO_AF2_TIM4);
+  LED_ORANGE_Alternate(GPIO_AF2_TIM4);
+  LED_RED_Alternate(GPIO_AF2_TIM4);
+  LED_BLUE_Alternate(GPIO_AF2_TIM4);
+  LEDS_Init(PIN_MODE_AF, PIN_PULL_NONE, PIN_SPEED_LOW, PIN_OTYPE_PP);
+}
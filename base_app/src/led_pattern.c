@@ -0,0 +1,145 @@
+/**
+  ******************************************************************************
+  * @file    led_pattern.c
+  * @brief   PWM timing and precomputed brightness tables for the LED engine.
+  ******************************************************************************
+  * Positions inside a repeat are Q16 fractions (65536 = one repeat), so the
+  * shape does not depend on how many PWM periods the table has. Breathing
+  * is a triangle eased with smoothstep, 3t^2 - 2t^3, which has no kink at
+  * the top and bottom; the gamma of 2 is then applied to the result.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "led_pattern.h"
+
+/* Private define ------------------------------------------------------------*/
+#define LED_Q16_ONE           65536UL
+
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t LED_PATTERN_Duty(uint32_t brightness, uint32_t period);
+static uint32_t LED_PATTERN_Breathe(uint32_t position);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Timer ticks per PWM period.
+  * @param  tick_hz: Counter rate (after the prescaler)
+  * @param  pwm_hz: PWM frequency
+  * @retval Ticks, ARR + 1; 0 if pwm_hz does not divide tick_hz or the period
+  *         does not fit the 16-bit counter
+  */
+uint32_t LED_PATTERN_Period(uint32_t tick_hz, uint32_t pwm_hz)
+{
+  uint32_t ticks;
+
+  if ((pwm_hz == 0U) || ((tick_hz % pwm_hz) != 0U))
+  {
+    return 0U;
+  }
+  ticks = tick_hz / pwm_hz;
+  return ((ticks < 2U) || (ticks > LED_PATTERN_MAX_TICKS)) ? 0U : ticks;
+}
+
+/**
+  * @brief  PWM periods in a table cycle, the nearest to cycle_ms.
+  * @param  pwm_hz: PWM frequency, one table frame per period
+  * @param  cycle_ms: Length of the table cycle
+  * @retval Frames, at least 1
+  */
+uint32_t LED_PATTERN_Frames(uint32_t pwm_hz, uint32_t cycle_ms)
+{
+  uint32_t frames = (uint32_t)((((uint64_t)pwm_hz * cycle_ms) + 500U) / 1000U);
+
+  return (frames == 0U) ? 1U : frames;
+}
+
+/**
+  * @brief  Compare value for a perceived brightness.
+  * @param  level: Brightness, permille (clamped)
+  * @param  period: Ticks per PWM period
+  * @retval CCR, period for full on
+  */
+uint16_t LED_PATTERN_Gamma(uint32_t level, uint32_t period)
+{
+  if (level > LED_PATTERN_FULL)
+  {
+    level = LED_PATTERN_FULL;
+  }
+  return LED_PATTERN_Duty((level * LED_Q16_ONE) / LED_PATTERN_FULL, period);
+}
+
+/**
+  * @brief  Render one channel of an interleaved table.
+  * @param  table: frames * channels compare values
+  * @param  frames: PWM periods in the table
+  * @param  channels: Values per frame
+  * @param  channel: Channel to fill, 0 to channels - 1
+  * @param  pattern: What it plays
+  * @param  period: Ticks per PWM period
+  * @retval None
+  */
+void LED_PATTERN_Render(uint16_t *table, uint32_t frames, uint32_t channels, uint32_t channel,
+                        const LED_PatternTypeDef *pattern, uint32_t period)
+{
+  uint32_t repeat = (pattern->Repeat == 0U) ? 1U : pattern->Repeat;
+  uint32_t level = (pattern->Level > LED_PATTERN_FULL) ? LED_PATTERN_FULL : pattern->Level;
+  uint32_t peak = (level * LED_Q16_ONE) / LED_PATTERN_FULL;
+  uint32_t phase = ((uint32_t)pattern->Phase * LED_Q16_ONE) / LED_PATTERN_FULL;
+  uint32_t on = ((uint32_t)pattern->Duty * LED_Q16_ONE) / LED_PATTERN_FULL;
+  uint32_t position;
+  uint32_t f;
+  uint16_t value;
+
+  for (f = 0U; f < frames; f++)
+  {
+    /* Rounded, so a shape is as symmetric as the frame count allows; Phase
+       delays it */
+    position = ((uint32_t)(((((uint64_t)f * repeat) << 16) + (frames / 2U)) / frames) + LED_Q16_ONE - phase) % LED_Q16_ONE;
+
+    switch (pattern->Shape)
+    {
+      case LED_SHAPE_ON:
+        value = LED_PATTERN_Duty(peak, period);
+        break;
+      case LED_SHAPE_BLINK:
+        value = (position < on) ? LED_PATTERN_Duty(peak, period) : 0U;
+        break;
+      case LED_SHAPE_BREATHE:
+        value = LED_PATTERN_Duty((uint32_t)(((uint64_t)LED_PATTERN_Breathe(position) * peak) >> 16), period);
+        break;
+      default:
+        value = 0U;
+        break;
+    }
+    table[(f * channels) + channel] = value;
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Duty cycle with a gamma of 2.
+  * @param  brightness: Q16, 0 to 65536
+  * @param  period: Ticks per PWM period
+  * @retval CCR, rounded
+  */
+static uint16_t LED_PATTERN_Duty(uint32_t brightness, uint32_t period)
+{
+  uint64_t square = (uint64_t)brightness * brightness;
+
+  return (uint16_t)(((square * period) + (1ULL << 31)) >> 32);
+}
+
+/**
+  * @brief  Breathing curve: 0 at the ends of a repeat, 1 in the middle.
+  * @param  position: Q16 place in the repeat
+  * @retval Q16 brightness
+  */
+static uint32_t LED_PATTERN_Breathe(uint32_t position)
+{
+  uint32_t t = (position < (LED_Q16_ONE / 2U)) ? (2U * position) : (2U * (LED_Q16_ONE - position));
+  uint64_t t2 = ((uint64_t)t * t) >> 16;
+
+  return (uint32_t)((t2 * ((3U * LED_Q16_ONE) - (2U * t))) >> 16);
+}
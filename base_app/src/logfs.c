@@ -0,0 +1,572 @@
+/**
+  ******************************************************************************
+  * @file    logfs.c
+  * @brief   Append-only log filesystem over a 512-byte block device.
+  ******************************************************************************
+  * Superblock, little endian:
+  *
+  *   0    magic "LGFS"       12   device blocks
+  *   4    version, files     16   first free block
+  *   8    sequence           20   files x { name[16], start, blocks, length }
+  *   508  CRC-32 of bytes 0-507
+  *
+  * Copy n lives in block n and takes the sequence numbers with that parity.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "logfs.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define LOGFS_MAGIC         0x5346474CUL    /* "LGFS" */
+#define LOGFS_VERSION       1U
+#define LOGFS_HEADER_SIZE   20U
+#define LOGFS_ENTRY_SIZE    28U
+#define LOGFS_CRC_OFFSET    (LOGFS_BLOCK_SIZE - 4U)
+#define LOGFS_MAX_BLOCKS    (LOGFS_MAX_BYTES / LOGFS_BLOCK_SIZE)
+
+_Static_assert(LOGFS_HEADER_SIZE + (LOGFS_MAX_FILES * LOGFS_ENTRY_SIZE) <= LOGFS_CRC_OFFSET,
+               "LOGFS_MAX_FILES do not fit the superblock");
+_Static_assert(sizeof(((LOGFS_EntryTypeDef *)0)->Name) == 16U, "LOGFS_NAME_MAX changes the layout");
+
+/* Private function prototypes -----------------------------------------------*/
+static LOGFS_StatusTypeDef LOGFS_Write(LOGFS_TypeDef *fs, uint32_t block, const void *data,
+                                       uint32_t count);
+static LOGFS_StatusTypeDef LOGFS_Commit(LOGFS_TypeDef *fs);
+static uint32_t            LOGFS_Decode(LOGFS_TypeDef *fs, const uint8_t *sb);
+static LOGFS_StatusTypeDef LOGFS_Flush(LOGFS_FileTypeDef *file);
+static int32_t             LOGFS_Find(const LOGFS_TypeDef *fs, const char *name);
+static uint32_t            LOGFS_Capacity(const LOGFS_EntryTypeDef *entry);
+static uint32_t            LOGFS_Get32(const uint8_t *p);
+static void                LOGFS_Put32(uint8_t *p, uint32_t value);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Make an empty filesystem on device, and mount it.
+  * @param  fs: Filesystem state
+  * @param  device: Block device, kept
+  * @retval LOGFS_OK, LOGFS_INVALID if the device is too small, LOGFS_ERROR
+  */
+LOGFS_StatusTypeDef LOGFS_Format(LOGFS_TypeDef *fs, const LOGFS_DeviceTypeDef *device)
+{
+  LOGFS_StatusTypeDef status;
+
+  if (device->Blocks <= LOGFS_ALIGN_BLOCKS)
+  {
+    return LOGFS_INVALID;
+  }
+  memset(fs, 0, sizeof(*fs));
+  fs->Device = device;
+  fs->Next = LOGFS_ALIGN_BLOCKS;
+
+  /* Both copies, so an older filesystem cannot come back */
+  status = LOGFS_Commit(fs);
+  return (status == LOGFS_OK) ? LOGFS_Commit(fs) : status;
+}
+
+/**
+  * @brief  Load the newer valid superblock.
+  * @param  fs: Filesystem state
+  * @param  device: Block device, kept
+  * @retval LOGFS_OK, LOGFS_CORRUPT if neither copy is valid, LOGFS_ERROR
+  */
+LOGFS_StatusTypeDef LOGFS_Mount(LOGFS_TypeDef *fs, const LOGFS_DeviceTypeDef *device)
+{
+  uint32_t sequence[2] = {0U, 0U};
+  uint8_t valid[2] = {0U, 0U};
+  uint32_t copy;
+
+  memset(fs, 0, sizeof(*fs));
+  fs->Device = device;
+  for (copy = 0U; copy < 2U; copy++)
+  {
+    if (device->Read(device->Context, copy, fs->Block, 1U) != LOGFS_OK)
+    {
+      return LOGFS_ERROR;
+    }
+    sequence[copy] = LOGFS_Get32((const uint8_t *)fs->Block + 8U);
+    valid[copy] = (uint8_t)((LOGFS_Decode(fs, (const uint8_t *)fs->Block) != 0U) &&
+                            ((sequence[copy] & 1U) == copy));
+  }
+  if ((valid[0] == 0U) && (valid[1] == 0U))
+  {
+    memset(fs, 0, sizeof(*fs));
+    return LOGFS_CORRUPT;
+  }
+
+  /* Newer by serial number arithmetic; the loop left copy 1 decoded */
+  copy = ((valid[1] != 0U) && ((valid[0] == 0U) || ((int32_t)(sequence[1] - sequence[0]) > 0))) ? 1U : 0U;
+  if (copy == 0U)
+  {
+    if (device->Read(device->Context, 0U, fs->Block, 1U) != LOGFS_OK)
+    {
+      return LOGFS_ERROR;
+    }
+    (void)LOGFS_Decode(fs, (const uint8_t *)fs->Block);
+  }
+  else if (LOGFS_Decode(fs, (const uint8_t *)fs->Block) == 0U)
+  {
+    return LOGFS_CORRUPT;
+  }
+  fs->Device = device;
+  return LOGFS_OK;
+}
+
+/**
+  * @brief  Reserve an extent for a new, empty file.
+  * @param  fs: Mounted filesystem
+  * @param  name: 1 to LOGFS_NAME_MAX characters
+  * @param  bytes: Capacity wanted, rounded up to LOGFS_ALIGN_BLOCKS
+  * @retval LOGFS_OK, LOGFS_EXISTS, LOGFS_FULL, LOGFS_INVALID, LOGFS_ERROR
+  */
+LOGFS_StatusTypeDef LOGFS_Create(LOGFS_TypeDef *fs, const char *name, uint32_t bytes)
+{
+  LOGFS_EntryTypeDef *entry;
+  LOGFS_StatusTypeDef status;
+  size_t length = strlen(name);
+  uint32_t blocks;
+
+  if ((length == 0U) || (length > LOGFS_NAME_MAX) || (bytes == 0U) || (bytes > LOGFS_MAX_BYTES))
+  {
+    return LOGFS_INVALID;
+  }
+  if (LOGFS_Find(fs, name) >= 0)
+  {
+    return LOGFS_EXISTS;
+  }
+  blocks = (bytes + LOGFS_BLOCK_SIZE - 1U) / LOGFS_BLOCK_SIZE;
+  blocks = (blocks + LOGFS_ALIGN_BLOCKS - 1U) & ~(LOGFS_ALIGN_BLOCKS - 1U);
+  if ((fs->Count >= LOGFS_MAX_FILES) || (blocks > (fs->Device->Blocks - fs->Next)))
+  {
+    return LOGFS_FULL;
+  }
+
+  entry = &fs->Files[fs->Count];
+  memset(entry, 0, sizeof(*entry));
+  memcpy(entry->Name, name, length);
+  entry->Start = fs->Next;
+  entry->Blocks = blocks;
+  fs->Count++;
+  fs->Next += blocks;
+  status = LOGFS_Commit(fs);
+  if (status != LOGFS_OK)
+  {
+    fs->Count--;
+    fs->Next -= blocks;
+  }
+  return status;
+}
+
+/**
+  * @brief  Open a file at its committed length.
+  * @param  fs: Mounted filesystem
+  * @param  file: Handle to fill in
+  * @param  name: File name
+  * @param  batch: Word-aligned append buffer, or NULL to only read
+  * @param  batch_size: A multiple of LOGFS_BLOCK_SIZE; LOGFS_BATCH_SIZE
+  *         gets whole-extent-unit transfers
+  * @retval LOGFS_OK, LOGFS_NOT_FOUND, LOGFS_INVALID, LOGFS_ERROR
+  */
+LOGFS_StatusTypeDef LOGFS_Open(LOGFS_TypeDef *fs, LOGFS_FileTypeDef *file, const char *name,
+                               uint8_t *batch, uint32_t batch_size)
+{
+  const LOGFS_EntryTypeDef *entry;
+  int32_t index = LOGFS_Find(fs, name);
+
+  if (index < 0)
+  {
+    return LOGFS_NOT_FOUND;
+  }
+  if ((batch != NULL) && ((batch_size == 0U) || ((batch_size % LOGFS_BLOCK_SIZE) != 0U) ||
+                          (((uintptr_t)batch & 3U) != 0U)))
+  {
+    return LOGFS_INVALID;
+  }
+  entry = &fs->Files[index];
+  memset(file, 0, sizeof(*file));
+  file->Fs = fs;
+  file->Index = (uint32_t)index;
+  file->Length = entry->Length;
+  file->Capacity = LOGFS_Capacity(entry);
+  file->Batch = batch;
+  file->BatchSize = (batch != NULL) ? batch_size : 0U;
+  file->BatchBlock = entry->Length / LOGFS_BLOCK_SIZE;
+  if (batch == NULL)
+  {
+    return LOGFS_OK;
+  }
+
+  /* Appends continue in the committed tail block */
+  file->Fill = entry->Length % LOGFS_BLOCK_SIZE;
+  if ((file->Fill != 0U) &&
+      (fs->Device->Read(fs->Device->Context, entry->Start + file->BatchBlock, batch, 1U) != LOGFS_OK))
+  {
+    return LOGFS_ERROR;
+  }
+  return LOGFS_OK;
+}
+
+/**
+  * @brief  Add data to the end of the file. Every full batch is written in
+  *         one transfer; nothing is committed until LOGFS_Sync().
+  * @param  file: Handle opened with a batch buffer
+  * @param  data: Bytes to add
+  * @param  length: Bytes
+  * @retval LOGFS_OK, LOGFS_FULL with nothing added, LOGFS_INVALID,
+  *         LOGFS_ERROR
+  */
+LOGFS_StatusTypeDef LOGFS_Append(LOGFS_FileTypeDef *file, const void *data, uint32_t length)
+{
+  const uint8_t *in = data;
+  LOGFS_StatusTypeDef status;
+  uint32_t n;
+
+  if (file->Batch == NULL)
+  {
+    return LOGFS_INVALID;
+  }
+  if (length > (file->Capacity - file->Length))
+  {
+    return LOGFS_FULL;
+  }
+  while (length != 0U)
+  {
+    n = file->BatchSize - file->Fill;
+    n = (length < n) ? length : n;
+    memcpy(&file->Batch[file->Fill], in, n);
+    file->Fill += n;
+    file->Length += n;
+    in += n;
+    length -= n;
+    if (file->Fill == file->BatchSize)
+    {
+      status = LOGFS_Flush(file);
+      if (status != LOGFS_OK)
+      {
+        return status;
+      }
+    }
+  }
+  return LOGFS_OK;
+}
+
+/**
+  * @brief  Write what is buffered, then commit the length in the
+  *         superblock: after a power cut the file has at least this much.
+  * @param  file: Handle opened with a batch buffer
+  * @retval LOGFS_OK, LOGFS_INVALID, LOGFS_ERROR
+  */
+LOGFS_StatusTypeDef LOGFS_Sync(LOGFS_FileTypeDef *file)
+{
+  LOGFS_EntryTypeDef *entry;
+  LOGFS_StatusTypeDef status;
+  uint32_t committed;
+
+  if (file->Batch == NULL)
+  {
+    return LOGFS_INVALID;
+  }
+  entry = &file->Fs->Files[file->Index];
+  if (entry->Length == file->Length)
+  {
+    return LOGFS_OK;
+  }
+  status = LOGFS_Flush(file);
+  if (status != LOGFS_OK)
+  {
+    return status;
+  }
+  committed = entry->Length;
+  entry->Length = file->Length;
+  status = LOGFS_Commit(file->Fs);
+  if (status != LOGFS_OK)
+  {
+    entry->Length = committed;
+  }
+  return status;
+}
+
+/**
+  * @brief  Empty the file, keeping its extent; committed at once.
+  * @param  file: Handle opened with a batch buffer
+  * @retval LOGFS_OK, LOGFS_INVALID, LOGFS_ERROR
+  */
+LOGFS_StatusTypeDef LOGFS_Truncate(LOGFS_FileTypeDef *file)
+{
+  LOGFS_EntryTypeDef *entry;
+  LOGFS_StatusTypeDef status;
+  uint32_t committed;
+
+  if (file->Batch == NULL)
+  {
+    return LOGFS_INVALID;
+  }
+  entry = &file->Fs->Files[file->Index];
+  committed = entry->Length;
+  entry->Length = 0U;
+  status = LOGFS_Commit(file->Fs);
+  if (status != LOGFS_OK)
+  {
+    entry->Length = committed;
+    return status;
+  }
+  file->Length = 0U;
+  file->BatchBlock = 0U;
+  file->Fill = 0U;
+  return LOGFS_OK;
+}
+
+/**
+  * @brief  Read from the file, buffered appends included. Whole blocks go
+  *         straight into data when it is word aligned.
+  * @param  file: Open handle
+  * @param  offset: First byte
+  * @param  data: Destination
+  * @param  length: Bytes wanted
+  * @param  read: Bytes read, short at the end of the file
+  * @retval LOGFS_OK or LOGFS_ERROR
+  */
+LOGFS_StatusTypeDef LOGFS_Read(LOGFS_FileTypeDef *file, uint32_t offset, void *data,
+                               uint32_t length, uint32_t *read)
+{
+  LOGFS_TypeDef *fs = file->Fs;
+  const LOGFS_DeviceTypeDef *device = fs->Device;
+  uint32_t start = fs->Files[file->Index].Start;
+  uint32_t stored = (file->Batch != NULL) ? (file->BatchBlock * LOGFS_BLOCK_SIZE) : file->Length;
+  uint8_t *out = data;
+  uint32_t within;
+  uint32_t n;
+
+  *read = 0U;
+  if (offset >= file->Length)
+  {
+    return LOGFS_OK;
+  }
+  length = ((file->Length - offset) < length) ? (file->Length - offset) : length;
+  *read = length;
+
+  while ((length != 0U) && (offset < stored))
+  {
+    within = offset % LOGFS_BLOCK_SIZE;
+    n = stored - offset;
+    n = (length < n) ? length : n;
+    if ((within == 0U) && (n >= LOGFS_BLOCK_SIZE) && (((uintptr_t)out & 3U) == 0U))
+    {
+      n -= n % LOGFS_BLOCK_SIZE;
+      if (device->Read(device->Context, start + (offset / LOGFS_BLOCK_SIZE), out,
+                       n / LOGFS_BLOCK_SIZE) != LOGFS_OK)
+      {
+        return LOGFS_ERROR;
+      }
+    }
+    else
+    {
+      n = ((LOGFS_BLOCK_SIZE - within) < n) ? (LOGFS_BLOCK_SIZE - within) : n;
+      if (device->Read(device->Context, start + (offset / LOGFS_BLOCK_SIZE), fs->Block, 1U) != LOGFS_OK)
+      {
+        return LOGFS_ERROR;
+      }
+      memcpy(out, (const uint8_t *)fs->Block + within, n);
+    }
+    out += n;
+    offset += n;
+    length -= n;
+  }
+  if (length != 0U)
+  {
+    memcpy(out, &file->Batch[offset - stored], length);
+  }
+  return LOGFS_OK;
+}
+
+/**
+  * @brief  CRC-32 (IEEE 802.3, reflected), nibble table.
+  * @param  data: Bytes
+  * @param  length: Bytes
+  * @retval CRC
+  */
+uint32_t LOGFS_Crc32(const void *data, uint32_t length)
+{
+  static const uint32_t Table[16] =
+  {
+    0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL,
+    0x76DC4190UL, 0x6B6B51F4UL, 0x4DB26158UL, 0x5005713CUL,
+    0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL,
+    0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL
+  };
+  const uint8_t *p = data;
+  uint32_t crc = 0xFFFFFFFFUL;
+
+  while (length-- != 0U)
+  {
+    crc ^= *p++;
+    crc = (crc >> 4) ^ Table[crc & 0x0FU];
+    crc = (crc >> 4) ^ Table[crc & 0x0FU];
+  }
+  return ~crc;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+static LOGFS_StatusTypeDef LOGFS_Write(LOGFS_TypeDef *fs, uint32_t block, const void *data,
+                                       uint32_t count)
+{
+  fs->Writes++;
+  fs->BlocksWritten += count;
+  return (fs->Device->Write(fs->Device->Context, block, data, count) == LOGFS_OK) ? LOGFS_OK
+                                                                                  : LOGFS_ERROR;
+}
+
+/**
+  * @brief  Write the table as the next superblock, over the older copy.
+  * @param  fs: Filesystem state
+  * @retval LOGFS_OK or LOGFS_ERROR
+  */
+static LOGFS_StatusTypeDef LOGFS_Commit(LOGFS_TypeDef *fs)
+{
+  uint8_t *sb = (uint8_t *)fs->Block;
+  uint32_t sequence = fs->Sequence + 1U;
+  uint32_t i;
+
+  memset(sb, 0, LOGFS_BLOCK_SIZE);
+  LOGFS_Put32(&sb[0], LOGFS_MAGIC);
+  LOGFS_Put32(&sb[4], LOGFS_VERSION | (fs->Count << 16));
+  LOGFS_Put32(&sb[8], sequence);
+  LOGFS_Put32(&sb[12], fs->Device->Blocks);
+  LOGFS_Put32(&sb[16], fs->Next);
+  for (i = 0U; i < fs->Count; i++)
+  {
+    uint8_t *p = &sb[LOGFS_HEADER_SIZE + (i * LOGFS_ENTRY_SIZE)];
+
+    memcpy(p, fs->Files[i].Name, sizeof(fs->Files[i].Name));
+    LOGFS_Put32(&p[16], fs->Files[i].Start);
+    LOGFS_Put32(&p[20], fs->Files[i].Blocks);
+    LOGFS_Put32(&p[24], fs->Files[i].Length);
+  }
+  LOGFS_Put32(&sb[LOGFS_CRC_OFFSET], LOGFS_Crc32(sb, LOGFS_CRC_OFFSET));
+
+  if (LOGFS_Write(fs, sequence & 1U, sb, 1U) != LOGFS_OK)
+  {
+    return LOGFS_ERROR;
+  }
+  fs->Sequence = sequence;
+  fs->Commits++;
+  return LOGFS_OK;
+}
+
+/**
+  * @brief  Check a superblock and load it into fs if it is sound: extents
+  *         in order, aligned, on the device, lengths within them.
+  * @param  fs: Filesystem state, Device set
+  * @param  sb: Superblock
+  * @retval 1 if loaded, 0 if not (fs unchanged)
+  */
+static uint32_t LOGFS_Decode(LOGFS_TypeDef *fs, const uint8_t *sb)
+{
+  LOGFS_EntryTypeDef files[LOGFS_MAX_FILES];
+  uint32_t header = LOGFS_Get32(&sb[4]);
+  uint32_t count = header >> 16;
+  uint32_t blocks = LOGFS_Get32(&sb[12]);
+  uint32_t next = LOGFS_Get32(&sb[16]);
+  uint32_t end = LOGFS_ALIGN_BLOCKS;
+  uint32_t i;
+
+  if ((LOGFS_Get32(&sb[0]) != LOGFS_MAGIC) || ((header & 0xFFFFU) != LOGFS_VERSION) ||
+      (LOGFS_Get32(&sb[LOGFS_CRC_OFFSET]) != LOGFS_Crc32(sb, LOGFS_CRC_OFFSET)) ||
+      (count > LOGFS_MAX_FILES) || (blocks > fs->Device->Blocks) || (next > blocks))
+  {
+    return 0U;
+  }
+  for (i = 0U; i < count; i++)
+  {
+    const uint8_t *p = &sb[LOGFS_HEADER_SIZE + (i * LOGFS_ENTRY_SIZE)];
+
+    memcpy(files[i].Name, p, sizeof(files[i].Name));
+    files[i].Start = LOGFS_Get32(&p[16]);
+    files[i].Blocks = LOGFS_Get32(&p[20]);
+    files[i].Length = LOGFS_Get32(&p[24]);
+    if ((files[i].Name[0] == '\0') || (files[i].Name[LOGFS_NAME_MAX] != '\0') ||
+        (files[i].Start != end) || (files[i].Blocks == 0U) ||
+        ((files[i].Blocks % LOGFS_ALIGN_BLOCKS) != 0U) || (files[i].Blocks > (next - end)) ||
+        (files[i].Length > LOGFS_Capacity(&files[i])))
+    {
+      return 0U;
+    }
+    end += files[i].Blocks;
+  }
+  if (end != next)
+  {
+    return 0U;
+  }
+
+  fs->Sequence = LOGFS_Get32(&sb[8]);
+  fs->Next = next;
+  fs->Count = count;
+  memcpy(fs->Files, files, count * sizeof(files[0]));
+  return 1U;
+}
+
+/**
+  * @brief  Write the buffered blocks, the last one padded, and keep the
+  *         partial tail block in the buffer for the next write.
+  * @param  file: Handle with a batch buffer
+  * @retval LOGFS_OK or LOGFS_ERROR
+  */
+static LOGFS_StatusTypeDef LOGFS_Flush(LOGFS_FileTypeDef *file)
+{
+  uint32_t blocks = (file->Fill + LOGFS_BLOCK_SIZE - 1U) / LOGFS_BLOCK_SIZE;
+  uint32_t full = file->Fill / LOGFS_BLOCK_SIZE;
+  uint32_t tail = file->Fill % LOGFS_BLOCK_SIZE;
+
+  if (blocks == 0U)
+  {
+    return LOGFS_OK;
+  }
+  memset(&file->Batch[file->Fill], 0, (blocks * LOGFS_BLOCK_SIZE) - file->Fill);
+  if (LOGFS_Write(file->Fs, file->Fs->Files[file->Index].Start + file->BatchBlock, file->Batch,
+                  blocks) != LOGFS_OK)
+  {
+    return LOGFS_ERROR;
+  }
+  if ((full != 0U) && (tail != 0U))
+  {
+    memmove(file->Batch, &file->Batch[full * LOGFS_BLOCK_SIZE], tail);
+  }
+  file->BatchBlock += full;
+  file->Fill = tail;
+  return LOGFS_OK;
+}
+
+static int32_t LOGFS_Find(const LOGFS_TypeDef *fs, const char *name)
+{
+  uint32_t i;
+
+  for (i = 0U; i < fs->Count; i++)
+  {
+    if (strncmp(fs->Files[i].Name, name, sizeof(fs->Files[i].Name)) == 0)
+    {
+      return (int32_t)i;
+    }
+  }
+  return -1;
+}
+
+static uint32_t LOGFS_Capacity(const LOGFS_EntryTypeDef *entry)
+{
+  return (entry->Blocks > LOGFS_MAX_BLOCKS) ? LOGFS_MAX_BYTES : (entry->Blocks * LOGFS_BLOCK_SIZE);
+}
+
+static uint32_t LOGFS_Get32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void LOGFS_Put32(uint8_t *p, uint32_t value)
+{
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+  p[2] = (uint8_t)(value >> 16);
+  p[3] = (uint8_t)(value >> 24);
+}
@@ -0,0 +1,355 @@
+/**
+  ******************************************************************************
+  * @file    lzss.c
+  * @brief   Streaming LZSS compressor and decompressor.
+  ******************************************************************************
+  * Both sides count bytes from the last reset (Pos, End) and keep byte p at
+  * Window[p mod window]. The encoder's window holds the history and the
+  * lookahead together: input goes in at End, encoding happens at Pos, and
+  * End - Pos never exceeds MaxMatch, so a candidate at distance d is still
+  * intact as long as d <= window - (End - Pos).
+  *
+  * The hash table stores the low 16 bits of the last position that started
+  * with each 3-byte hash. A stale or colliding entry is harmless: every
+  * candidate is checked byte by byte, and only its distance has to be in
+  * range. Matches may overlap the bytes they produce (a distance shorter
+  * than the length), which is how a run of one character compresses; the
+  * decoder copies byte by byte so that works out the same on both sides.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "lzss.h"
+
+/* Private define ------------------------------------------------------------*/
+#define LZSS_HASH_MULT          2654435761U  /* Knuth, 2^32 / phi */
+
+/* Private function prototypes -----------------------------------------------*/
+static void     LZSS_Step(LZSS_EncoderTypeDef *enc);
+static uint32_t LZSS_Hash(const LZSS_EncoderTypeDef *enc, uint32_t pos);
+static void     LZSS_Item(LZSS_EncoderTypeDef *enc, uint32_t match);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Sets up an encoder.
+  * @param  enc: Encoder
+  * @param  window: LZSS_WINDOW_SIZE(window_bits) bytes of history
+  * @param  window_bits: LZSS_WINDOW_BITS_MIN to LZSS_WINDOW_BITS_MAX
+  * @param  out: Buffer for the compressed frame
+  * @param  out_size: Its size, LZSS_ITEM_MAX at least
+  * @retval LZSS_OK, or LZSS_INVALID for a bad window or buffer size
+  */
+LZSS_StatusTypeDef LZSS_EncoderInit(LZSS_EncoderTypeDef *enc, uint8_t *window, uint32_t window_bits,
+                                    uint8_t *out, uint32_t out_size)
+{
+  uint32_t length_max;
+
+  if ((window_bits < LZSS_WINDOW_BITS_MIN) || (window_bits > LZSS_WINDOW_BITS_MAX) ||
+      (out_size < LZSS_ITEM_MAX))
+  {
+    return LZSS_INVALID;
+  }
+
+  memset(enc, 0, sizeof(*enc));
+  enc->Window = window;
+  enc->WindowBits = (uint8_t)window_bits;
+  enc->Out = out;
+  enc->OutSize = out_size;
+
+  /* Whatever the length field holds, but at most half the window, so the
+     lookahead leaves the other half for history */
+  length_max = LZSS_MIN_MATCH + (1UL << (16U - window_bits)) - 1U;
+  enc->MaxMatch = LZSS_WINDOW_SIZE(window_bits) / 2U;
+  if (enc->MaxMatch > length_max)
+  {
+    enc->MaxMatch = length_max;
+  }
+  return LZSS_OK;
+}
+
+/**
+  * @brief  Forgets the history, starting a stream that decodes on its own.
+  *         Pending input and output are dropped; the totals are kept.
+  * @param  enc: Encoder
+  * @retval None
+  */
+void LZSS_EncoderReset(LZSS_EncoderTypeDef *enc)
+{
+  enc->Pos = 0U;
+  enc->End = 0U;
+  enc->OutLength = 0U;
+  enc->FlagBit = 0U;
+  memset(enc->Hash, 0, sizeof(enc->Hash));
+}
+
+/**
+  * @brief  Takes input, encoding whatever no longer fits the lookahead.
+  * @param  enc: Encoder
+  * @param  data: Input
+  * @param  length: Its length
+  * @retval Bytes taken; fewer than length when the output buffer is full,
+  *         then LZSS_Frame() and call again with the rest
+  */
+uint32_t LZSS_Compress(LZSS_EncoderTypeDef *enc, const uint8_t *data, uint32_t length)
+{
+  uint32_t mask = LZSS_WINDOW_SIZE(enc->WindowBits) - 1U;
+  uint32_t taken = 0U;
+
+  while (taken < length)
+  {
+    if ((enc->End - enc->Pos) < enc->MaxMatch)
+    {
+      enc->Window[enc->End & mask] = data[taken];
+      enc->End++;
+      taken++;
+    }
+    else if ((enc->OutLength + LZSS_ITEM_MAX) <= enc->OutSize)
+    {
+      LZSS_Step(enc);
+    }
+    else
+    {
+      break;
+    }
+  }
+  enc->In += taken;
+  return taken;
+}
+
+/**
+  * @brief  Encodes the lookahead too, as far as the output buffer allows.
+  * @param  enc: Encoder
+  * @retval Bytes still pending: 0, or LZSS_Frame() and call again
+  */
+uint32_t LZSS_Flush(LZSS_EncoderTypeDef *enc)
+{
+  while ((enc->Pos != enc->End) && ((enc->OutLength + LZSS_ITEM_MAX) <= enc->OutSize))
+  {
+    LZSS_Step(enc);
+  }
+  return enc->End - enc->Pos;
+}
+
+/**
+  * @brief  Ends the frame in the output buffer and empties it.
+  * @param  enc: Encoder
+  * @retval Frame length, bytes from the start of the output buffer
+  */
+uint32_t LZSS_Frame(LZSS_EncoderTypeDef *enc)
+{
+  uint32_t length = enc->OutLength;
+
+  enc->Produced += length;
+  enc->OutLength = 0U;
+  enc->FlagBit = 0U;
+  return length;
+}
+
+/**
+  * @brief  Sets up a decoder.
+  * @param  dec: Decoder
+  * @param  window: LZSS_WINDOW_SIZE(window_bits) bytes of history
+  * @param  window_bits: The encoder's
+  * @retval LZSS_OK, or LZSS_INVALID for a bad window size
+  */
+LZSS_StatusTypeDef LZSS_DecoderInit(LZSS_DecoderTypeDef *dec, uint8_t *window, uint32_t window_bits)
+{
+  if ((window_bits < LZSS_WINDOW_BITS_MIN) || (window_bits > LZSS_WINDOW_BITS_MAX))
+  {
+    return LZSS_INVALID;
+  }
+  dec->Window = window;
+  dec->WindowBits = (uint8_t)window_bits;
+  dec->Pos = 0U;
+  return LZSS_OK;
+}
+
+/**
+  * @brief  Forgets the history, as the encoder did.
+  * @param  dec: Decoder
+  * @retval None
+  */
+void LZSS_DecoderReset(LZSS_DecoderTypeDef *dec)
+{
+  dec->Pos = 0U;
+}
+
+/**
+  * @brief  Decodes one frame.
+  * @param  dec: Decoder
+  * @param  frame: Frame from LZSS_Frame()
+  * @param  length: Its length
+  * @param  out: Decoded bytes
+  * @param  out_size: Room in out
+  * @param  produced: Bytes written to out, also on error
+  * @retval LZSS_OK; LZSS_CORRUPT for a match before the start of the stream
+  *         or cut short, LZSS_FULL when out is too small. The decoder is
+  *         out of step after an error and needs a reset.
+  */
+LZSS_StatusTypeDef LZSS_Decode(LZSS_DecoderTypeDef *dec, const uint8_t *frame, uint32_t length,
+                               uint8_t *out, uint32_t out_size, uint32_t *produced)
+{
+  uint32_t mask = LZSS_WINDOW_SIZE(dec->WindowBits) - 1U;
+  uint32_t in = 0U;
+  uint32_t written = 0U;
+  uint32_t flags = 0U;
+  uint32_t value;
+  uint32_t distance;
+  uint32_t count;
+  uint8_t byte;
+
+  *produced = 0U;
+  while (in < length)
+  {
+    /* A new group every eight items; the sentinel bit counts them */
+    if (flags <= 1U)
+    {
+      flags = (uint32_t)frame[in++] | 0x100U;
+      continue;
+    }
+
+    if ((flags & 1U) == 0U)
+    {
+      if (written == out_size)
+      {
+        return LZSS_FULL;
+      }
+      byte = frame[in++];
+      dec->Window[dec->Pos & mask] = byte;
+      dec->Pos++;
+      out[written++] = byte;
+      *produced = written;
+    }
+    else
+    {
+      if ((in + 2U) > length)
+      {
+        return LZSS_CORRUPT;
+      }
+      value = (uint32_t)frame[in] | ((uint32_t)frame[in + 1U] << 8);
+      in += 2U;
+      distance = (value & mask) + 1U;
+      count = (value >> dec->WindowBits) + LZSS_MIN_MATCH;
+      if (distance > dec->Pos)
+      {
+        return LZSS_CORRUPT;
+      }
+      if (count > (out_size - written))
+      {
+        return LZSS_FULL;
+      }
+      while (count != 0U)
+      {
+        byte = dec->Window[(dec->Pos - distance) & mask];
+        dec->Window[dec->Pos & mask] = byte;
+        dec->Pos++;
+        out[written++] = byte;
+        count--;
+      }
+      *produced = written;
+    }
+    flags >>= 1;
+  }
+  return LZSS_OK;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Encodes the next item at Pos: the match from the hash table if
+  *         it is long enough, a literal otherwise. Needs LZSS_ITEM_MAX bytes
+  *         of output and Pos != End.
+  * @param  enc: Encoder
+  * @retval None
+  */
+static void LZSS_Step(LZSS_EncoderTypeDef *enc)
+{
+  uint32_t mask = LZSS_WINDOW_SIZE(enc->WindowBits) - 1U;
+  uint32_t lookahead = enc->End - enc->Pos;
+  uint32_t best = 0U;
+  uint32_t distance = 0U;
+  uint32_t hash;
+  uint32_t limit;
+  uint32_t i;
+
+  if (lookahead >= LZSS_MIN_MATCH)
+  {
+    hash = LZSS_Hash(enc, enc->Pos);
+    distance = (enc->Pos - enc->Hash[hash]) & 0xFFFFU;
+    enc->Hash[hash] = (uint16_t)enc->Pos;
+
+    /* Only what the lookahead has not overwritten, and not before the start */
+    limit = (mask + 1U) - lookahead;
+    if ((distance != 0U) && (distance <= limit) && (distance <= enc->Pos))
+    {
+      while ((best < lookahead) &&
+             (enc->Window[(enc->Pos - distance + best) & mask] == enc->Window[(enc->Pos + best) & mask]))
+      {
+        best++;
+      }
+    }
+  }
+
+  if (best >= LZSS_MIN_MATCH)
+  {
+    LZSS_Item(enc, ((distance - 1U) | ((best - LZSS_MIN_MATCH) << enc->WindowBits)) | 0x10000UL);
+
+    /* The positions inside the match start strings too */
+    for (i = 1U; (i < best) && ((enc->Pos + i + LZSS_MIN_MATCH) <= enc->End); i++)
+    {
+      enc->Hash[LZSS_Hash(enc, enc->Pos + i)] = (uint16_t)(enc->Pos + i);
+    }
+    enc->Pos += best;
+  }
+  else
+  {
+    LZSS_Item(enc, enc->Window[enc->Pos & mask]);
+    enc->Pos++;
+  }
+}
+
+/**
+  * @brief  Hash of the three bytes at a position.
+  * @param  enc: Encoder
+  * @param  pos: Position, with three bytes taken in from there
+  * @retval Index into the hash table
+  */
+static uint32_t LZSS_Hash(const LZSS_EncoderTypeDef *enc, uint32_t pos)
+{
+  uint32_t mask = LZSS_WINDOW_SIZE(enc->WindowBits) - 1U;
+  uint32_t key = ((uint32_t)enc->Window[pos & mask] << 16) |
+                 ((uint32_t)enc->Window[(pos + 1U) & mask] << 8) |
+                 (uint32_t)enc->Window[(pos + 2U) & mask];
+
+  return (uint32_t)(key * LZSS_HASH_MULT) >> (32U - LZSS_HASH_BITS);
+}
+
+/**
+  * @brief  Writes an item, opening a flag group first if needed.
+  * @param  enc: Encoder
+  * @param  match: A literal byte, or bit 16 set and the 16-bit match field
+  * @retval None
+  */
+static void LZSS_Item(LZSS_EncoderTypeDef *enc, uint32_t match)
+{
+  if (enc->FlagBit == 0U)
+  {
+    enc->FlagPos = enc->OutLength;
+    enc->Out[enc->OutLength++] = 0U;
+    enc->FlagBit = 1U;
+  }
+
+  if ((match & 0x10000UL) != 0U)
+  {
+    enc->Out[enc->FlagPos] |= enc->FlagBit;
+    enc->Out[enc->OutLength++] = (uint8_t)match;
+    enc->Out[enc->OutLength++] = (uint8_t)(match >> 8);
+  }
+  else
+  {
+    enc->Out[enc->OutLength++] = (uint8_t)match;
+  }
+  enc->FlagBit = (uint8_t)(enc->FlagBit << 1);
+}
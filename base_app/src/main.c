@@ -24,6 +24,32 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
+#include "accel_input.h"
+#include "adc_acq.h"
+#include "audio_stream.h"
+#include "board.h"
+#include "boot_record.h"
+#include "button_input.h"
+#include "can_bus.h"
+#include "cs43l22.h"
+#include "clock_config.h"
+#include "console_lz.h"
+#include "crash_handler.h"
+#include "dac_stream.h"
+#include "fixmath_bench.h"
+#include "i2c_bus.h"
+#include "kernel_port.h"
+#include "led_engine.h"
+#include "modbus_rtu.h"
+#include "mpu_guard.h"
+#include "pin_bench.h"
+#include "placement_bench.h"
+#include "power.h"
+#include "pulse_input.h"
+#include "sd_card.h"
+#include "supervisor.h"
+#include "trace_recorder.h"
+#include "usb_fs.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -33,6 +59,29 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
+#define AUDIO_SAMPLE_RATE   48000U
+#define APP_PRIORITY        8U
+#define APP_STACK_WORDS     1024U
+#define KERNEL_BENCH_RUNS   1000U
+#define APP_LED_CYCLE_MS    2000U
+#define APP_PERIOD_MS       1000U
+#define APP_DAC_F0_HZ       100U
+#define APP_DAC_F1_HZ       5000U
+#define APP_DAC_SWEEP_MS    1000U
+#define APP_DAC_RATE_HZ     50000U
+#define APP_DAC_AMPLITUDE   2000U
+#define APP_ACCEL_SETTLE_MS 1000U
+#define APP_ADC_BENCH_MS    100U
+#define APP_ADC_FAST_RATIO  64U
+#define APP_ADC_FRAME_HZ    1000U
+#define APP_ADC_RATIO       100U
+#define APP_CAN_QUEUES      3U
+#define APP_CAN_SELFTEST    1000U
+#define APP_MODBUS_ADDRESS  1U
+#define APP_MODBUS_SCRATCH  8U
+#define APP_SD_LOG_BYTES    (64UL * 1024UL * 1024UL)
+#define APP_SD_BENCH_BYTES  (4UL * 1024UL * 1024UL)
+#define APP_SD_SYNC_MS      10000U
 
 /* USER CODE END PD */
 
@@ -47,7 +96,58 @@ TIM_HandleTypeDef htim6;
 UART_HandleTypeDef huart3;
 
 /* USER CODE BEGIN PV */
-
+static KERNEL_TaskTypeDef AppTask;
+static uint64_t AppStack[APP_STACK_WORDS / 2U];
+/* Green breathes, red blinks at 1 Hz */
+static const LED_PatternTypeDef AppLeds[LED_ENGINE_CHANNELS] =
+{
+  [LED_ENGINE_GREEN]  = { LED_SHAPE_BREATHE, LED_PATTERN_FULL, 0U, 0U, 1U },
+  [LED_ENGINE_ORANGE] = { LED_SHAPE_OFF, 0U, 0U, 0U, 1U },
+  [LED_ENGINE_RED]    = { LED_SHAPE_BLINK, LED_PATTERN_FULL / 2U, LED_PATTERN_FULL / 2U, 0U, 2U },
+  [LED_ENGINE_BLUE]   = { LED_SHAPE_OFF, 0U, 0U, 0U, 1U },
+};
+/* Queue 0 control 0x100-0x10F, 1 proprietary J1939 PGNs, 2 OBD diagnostics */
+static const CANF_RuleTypeDef AppCanRules[] =
+{
+  { 0x100U, 0x7F0U, 0U, 0U },
+  { CANQ_EXT | 0x00FF0000U, 0x00FF0000U, 1U, 1U },
+  { 0x7DFU, CANQ_STD_MASK, 0U, 2U },
+  { 0x7E0U, CANQ_STD_MASK, 0U, 2U },
+};
+static CANQ_RxQueueTypeDef AppCanQueues[APP_CAN_QUEUES];
+#if MODBUS_SLAVE
+/* Input/holding 0x0000 status from the loop below, 0x0100 the link itself,
+ * 0x0200 scratch registers a master can write */
+enum
+{
+  APP_MB_UPTIME_LO, APP_MB_UPTIME_HI, APP_MB_PULSE_HZ, APP_MB_PULSE_DUTY,
+  APP_MB_CAN_FRAMES, APP_MB_AUDIO_UNDERRUNS, APP_MB_DAC_UNDERRUNS, APP_MB_ADC_OVERRUNS,
+  APP_MB_STATUS
+};
+static uint16_t AppModbusStatus[APP_MB_STATUS];
+static uint16_t AppModbusScratch[APP_MODBUS_SCRATCH];
+static uint16_t APP_ModbusStatus(uint16_t index);
+static uint16_t APP_ModbusLink(uint16_t index);
+static uint16_t APP_ModbusReadScratch(uint16_t index);
+static uint8_t  APP_ModbusWriteScratch(uint16_t index, uint16_t value);
+static const MODBUS_RegionTypeDef AppModbusMap[] =
+{
+  { 0x0000U, APP_MB_STATUS, APP_ModbusStatus, NULL },
+  { 0x0100U, 8U, APP_ModbusLink, NULL },
+  { 0x0200U, APP_MODBUS_SCRATCH, APP_ModbusReadScratch, APP_ModbusWriteScratch },
+};
+#endif
+/* Set once USART3 is handed over to the Modbus slave */
+static uint8_t AppConsoleOff;
+#if SD_LOG
+/* One batch buffer, for the write benchmark first and then the log. SRAM:
+ * DMA2 cannot reach CCM */
+static LOGFS_TypeDef AppFs;
+static LOGFS_FileTypeDef AppLog;
+__ALIGNED(4) static uint8_t AppLogBatch[LOGFS_BATCH_SIZE];
+static uint8_t AppLogReady;
+static uint32_t AppLogSynced;
+#endif
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -56,7 +156,13 @@ static void MX_GPIO_Init(void);
 static void MX_TIM6_Init(void);
 static void MX_USART3_UART_Init(void);
 /* USER CODE BEGIN PFP */
-
+static void APP_Task(void *argument);
+static void APP_WaitButtons(uint32_t ms);
+static void APP_PrintAdc(const uint16_t *values, uint32_t channels);
+#if SD_LOG
+static void APP_SdLogStart(void);
+static void APP_SdLogLine(const char *line);
+#endif
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
@@ -64,13 +170,42 @@ static void MX_USART3_UART_Init(void);
 void printMsg(char* format, ...)
 {
 	char str[80];
+	int len;
 
 	/*Extract the argument list using VA APIs*/
 	va_list args;
 	va_start(args, format);
-	vsprintf(str, format, args);
-	HAL_UART_Transmit(&huart3, (uint8_t*)str, strlen(str), HAL_MAX_DELAY);
+	len = vsnprintf(str, sizeof(str), format, args);
 	va_end(args);
+	if (len < 0)
+	{
+		return;
+	}
+	/* A line cut short still ends the line */
+	if ((size_t)len >= sizeof(str))
+	{
+		len = sizeof(str) - 1;
+		str[len - 2] = '\r';
+		str[len - 1] = '\n';
+	}
+
+#if USB_CONSOLE
+	/* The virtual COM port while a terminal holds it open, USART3 otherwise */
+	if (USB_FS_Connected() != 0U)
+	{
+		(void)USB_FS_Write(str, (uint32_t)len);
+		return;
+	}
+#endif
+	if (AppConsoleOff != 0U)
+	{
+		return;
+	}
+#if CONSOLE_LZ
+	CONSOLE_LZ_Write(str, (uint32_t)len);
+#else
+	HAL_UART_Transmit(&huart3, (uint8_t*)str, (uint16_t)len, HAL_MAX_DELAY);
+#endif
 }
 /* USER CODE END 0 */
 
@@ -82,7 +217,7 @@ int main(void)
 {
 
   /* USER CODE BEGIN 1 */
-
+  BOOT_RECORD_Start();
   /* USER CODE END 1 */
 
   /* MCU Configuration--------------------------------------------------------*/
@@ -91,22 +226,130 @@ int main(void)
   HAL_Init();
 
   /* USER CODE BEGIN Init */
-
+  BOOT_RECORD_Mark(BOOT_PH_HAL);
+  CRASH_HANDLER_Init();
+  if (MPU_GUARD_Init() != HAL_OK)
+  {
+    Error_Handler();
+  }
+  BOOT_RECORD_StartClocks();
   /* USER CODE END Init */
 
+  /* Initialize the peripherals that do not depend on the bus clocks while
+   * the PLL locks */
+  MX_GPIO_Init();
+  MX_TIM6_Init();
+  BOOT_RECORD_Mark(BOOT_PH_EARLY);
+
   /* Configure the system clock */
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
-
+  BOOT_RECORD_Mark(BOOT_PH_CLOCK);
+  TRACE_RECORDER_Init();
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
-  MX_GPIO_Init();
-  MX_TIM6_Init();
   MX_USART3_UART_Init();
   /* USER CODE BEGIN 2 */
+#if !SD_LOG
+  AUDIO_StreamStatsTypeDef audio_stats;
+#endif
+
+#if CONSOLE_LZ
+  if (CONSOLE_LZ_Init(&huart3) != HAL_OK)
+  {
+    Error_Handler();
+  }
+#endif
+  (void)CRASH_HANDLER_Report(&huart3);
+  (void)SUPERVISOR_Report(&huart3);
+#if !SD_LOG
+  /* The SD card takes PC10/PC12 from I2S3 */
+  if ((AUDIO_STREAM_Init(AUDIO_SAMPLE_RATE) != HAL_OK) || (AUDIO_STREAM_Start() != HAL_OK))
+  {
+    Error_Handler();
+  }
+#endif
+#if !ACCEL_FUSION
+  /* The accelerometer takes PA5 from the DAC */
+  if (DAC_STREAM_Init() != HAL_OK)
+  {
+    Error_Handler();
+  }
+#endif
+  if ((LED_ENGINE_Init() != HAL_OK) || (ADC_ACQ_Init() != HAL_OK) || (PULSE_INPUT_Init() != HAL_OK) ||
+      (CAN_BUS_Init(AppCanRules, sizeof(AppCanRules) / sizeof(AppCanRules[0]),
+                    AppCanQueues, APP_CAN_QUEUES) != HAL_OK))
+  {
+    Error_Handler();
+  }
+#if USB_CONSOLE
+  if (USB_FS_Init() != HAL_OK)
+  {
+    Error_Handler();
+  }
+#endif
+  BOOT_RECORD_Mark(BOOT_PH_PERIPH);
+#if !SD_LOG
+  AUDIO_STREAM_GetStats(&audio_stats);
+  printMsg("audio: %lu Hz, buffer latency %lu us\r\n", audio_stats.SampleRate, audio_stats.LatencyUs);
+#endif
+  printMsg("trace: %lu records, %lu cycles per event\r\n", (uint32_t)TRACE_RECORDS, TRACE_RECORDER_Cost());
 
+  /* Everything from here on runs in tasks */
+  KERNEL_PORT_Init();
+  POWER_Init();
+  if ((BUTTON_INPUT_Init() != HAL_OK) ||
+      (POWER_AddUart(&huart3) != HAL_OK) ||
+      (POWER_AddTimer(&htim4, LED_ENGINE_TICK_HZ) != HAL_OK) ||
+      (POWER_AddTimer(&htim7, BUTTON_INPUT_TICK_HZ) != HAL_OK) ||
+      (POWER_AddTimer(&htim2, ADC_ACQ_TICK_HZ) != HAL_OK) ||
+      (POWER_AddTimer(&htim5, PULSE_INPUT_TICK_HZ) != HAL_OK) ||
+      (POWER_Register(I2C_BUS_ClockNotify, NULL) != DVFS_OK) ||
+      (POWER_Register(BUTTON_INPUT_ClockNotify, NULL) != DVFS_OK) ||
+      (POWER_Register(DAC_STREAM_ClockNotify, NULL) != DVFS_OK) ||
+      (POWER_Register(ADC_ACQ_ClockNotify, NULL) != DVFS_OK) ||
+      (POWER_Register(PULSE_INPUT_ClockNotify, NULL) != DVFS_OK) ||
+      (POWER_Register(CAN_BUS_ClockNotify, NULL) != DVFS_OK))
+  {
+    Error_Handler();
+  }
+#if MODBUS_SLAVE
+  if ((MODBUS_RTU_Init() != HAL_OK) ||
+      (POWER_AddTimer(&htim3, MODBUS_RTU_TICK_HZ) != HAL_OK) ||
+      (POWER_Register(MODBUS_RTU_ClockNotify, NULL) != DVFS_OK))
+  {
+    Error_Handler();
+  }
+#endif
+#if SD_LOG
+  if (POWER_Register(SD_CARD_ClockNotify, NULL) != DVFS_OK)
+  {
+    Error_Handler();
+  }
+#endif
+#if USB_CONSOLE
+  if (POWER_Register(USB_FS_ClockNotify, NULL) != DVFS_OK)
+  {
+    Error_Handler();
+  }
+#endif
+#if ACCEL_FUSION
+  if ((ACCEL_INPUT_Init() != HAL_OK) ||
+      (POWER_Register(ACCEL_INPUT_ClockNotify, NULL) != DVFS_OK))
+  {
+    Error_Handler();
+  }
+#endif
+  if ((KERNEL_TaskCreate(&AppTask, "app", APP_Task, NULL, APP_PRIORITY,
+                         (uint32_t *)AppStack, APP_STACK_WORDS) != KERNEL_OK) ||
+      (MPU_GUARD_AddTasks() != HAL_OK))
+  {
+    Error_Handler();
+  }
+  BOOT_RECORD_Mark(BOOT_PH_READY);
+  KERNEL_PORT_Start();
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -114,9 +357,6 @@ int main(void)
   while (1)
   {
     /* USER CODE END WHILE */
-	  printMsg("Hello World\r\n");
-    HAL_GPIO_TogglePin(GPIOD, GPIO_PIN_14);
-	  HAL_Delay(1000);
 
     /* USER CODE BEGIN 3 */
   }
@@ -129,41 +369,44 @@ int main(void)
   */
 void SystemClock_Config(void)
 {
-  RCC_OscInitTypeDef RCC_OscInitStruct = {0};
-  RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+  RCC_OscInitTypeDef RCC_OscInitStruct = CLOCK_CONFIG_OSC_INIT;
+  RCC_ClkInitTypeDef RCC_ClkInitStruct = CLOCK_CONFIG_CLK_INIT;
+  uint32_t tickstart;
 
-  /** Configure the main internal regulator output voltage
+  /** Configure the main internal regulator output voltage, unless
+  * BOOT_RECORD_StartClocks() already did and started the PLL: then the PLL
+  * is left to finish locking instead of being restarted.
   */
   __HAL_RCC_PWR_CLK_ENABLE();
-  __HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE1);
+  if (READ_BIT(RCC->CR, RCC_CR_PLLON) == 0U)
+  {
+    __HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE1);
+  }
+  else
+  {
+    RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+    RCC_OscInitStruct.PLL.PLLState   = RCC_PLL_NONE;
+  }
 
   /** Initializes the RCC Oscillators according to the specified parameters
-  * in the RCC_OscInitTypeDef structure.
+  * in the RCC_OscInitTypeDef structure, solved in clock_config.h.
   */
-  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI;
-  RCC_OscInitStruct.HSIState = RCC_HSI_ON;
-  RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
-  RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
-  RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSI;
-  RCC_OscInitStruct.PLL.PLLM = 8;
-  RCC_OscInitStruct.PLL.PLLN = 168;
-  RCC_OscInitStruct.PLL.PLLP = RCC_PLLP_DIV2;
-  RCC_OscInitStruct.PLL.PLLQ = 4;
   if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
   {
     Error_Handler();
   }
+  tickstart = HAL_GetTick();
+  while (__HAL_RCC_GET_FLAG(RCC_FLAG_PLLRDY) == RESET)
+  {
+    if ((HAL_GetTick() - tickstart) > PLL_TIMEOUT_VALUE)
+    {
+      Error_Handler();
+    }
+  }
 
   /** Initializes the CPU, AHB and APB buses clocks
   */
-  RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK
-                              |RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2;
-  RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
-  RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
-  RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV4;
-  RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV2;
-
-  if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_5) != HAL_OK)
+  if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, CLOCK_CONFIG_FLASH_LATENCY) != HAL_OK)
   {
     Error_Handler();
   }
@@ -195,7 +438,7 @@ static void MX_TIM6_Init(void)
   {
     Error_Handler();
   }
-  sMasterConfig.MasterOutputTrigger = TIM_TRGO_RESET;
+  sMasterConfig.MasterOutputTrigger = TIM_TRGO_UPDATE;
   sMasterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
   if (HAL_TIMEx_MasterConfigSynchronization(&htim6, &sMasterConfig) != HAL_OK)
   {
@@ -247,7 +490,6 @@ static void MX_USART3_UART_Init(void)
   */
 static void MX_GPIO_Init(void)
 {
-  GPIO_InitTypeDef GPIO_InitStruct = {0};
   /* USER CODE BEGIN MX_GPIO_Init_1 */
 
   /* USER CODE END MX_GPIO_Init_1 */
@@ -261,14 +503,10 @@ static void MX_GPIO_Init(void)
   __HAL_RCC_GPIOD_CLK_ENABLE();
 
   /*Configure GPIO pin Output Level */
-  HAL_GPIO_WritePin(GPIOD, GPIO_PIN_12|GPIO_PIN_13|GPIO_PIN_14|GPIO_PIN_15, GPIO_PIN_RESET);
+  LEDS_Write(0U);
 
-  /*Configure GPIO pins : PD12 PD13 PD14 PD15 */
-  GPIO_InitStruct.Pin = GPIO_PIN_12|GPIO_PIN_13|GPIO_PIN_14|GPIO_PIN_15;
-  GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
-  GPIO_InitStruct.Pull = GPIO_NOPULL;
-  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
-  HAL_GPIO_Init(GPIOD, &GPIO_InitStruct);
+  /*Configure GPIO pins : PD12 PD13 PD14 PD15 (board.h) */
+  LEDS_Init(PIN_MODE_OUTPUT, PIN_PULL_NONE, PIN_SPEED_LOW, PIN_OTYPE_PP);
 
   /* USER CODE BEGIN MX_GPIO_Init_2 */
 
@@ -276,7 +514,497 @@ static void MX_GPIO_Init(void)
 }
 
 /* USER CODE BEGIN 4 */
+/**
+  * @brief  Application task: the former superloop, once a second, and the
+  *         button events in between.
+  * @param  argument: Unused
+  * @retval None
+  */
+static void APP_Task(void *argument)
+{
+  KERNEL_PORT_BenchTypeDef bench;
+  AUDIO_StreamStatsTypeDef audio_stats;
+  DAC_StreamStatsTypeDef dac_stats;
+  ADC_AcqStatsTypeDef adc_stats;
+  PULSE_InputStatsTypeDef pulse_stats;
+  CAN_BusSelfTestTypeDef can_test;
+  CAN_BusStatsTypeDef can_stats;
+  CANQ_FrameTypeDef can_frame;
+  uint32_t can_counts[APP_CAN_QUEUES] = {0U};
+  uint32_t can_seen = 0U;
+  uint32_t can_bus_offs = 0U;
+  uint32_t q;
+  uint16_t adc_values[ADC_SCAN_MAX_CHANNELS];
+  uint32_t audio_underruns = 0U;
+  uint32_t dac_underruns = 0U;
+  uint32_t adc_overruns = 0U;
+  uint32_t adc_samples;
+  uint32_t adc_ticks;
+  uint8_t pulse_stalled = 0U;
+  CS43L22_StateTypeDef codec_state = CS43L22_RESET;
+  uint8_t codec_id = 0U;
+  uint32_t wdog_app;
+#if USB_CONSOLE
+  USB_CDC_StatsTypeDef usb_stats;
+  uint32_t usb_dropped = 0U;
+#endif
+#if ACCEL_FUSION
+  ACCEL_InputStatsTypeDef accel_stats;
+  ACCEL_InputResultTypeDef accel;
+  uint32_t accel_overruns = 0U;
+#endif
+#if SD_LOG
+  char log_line[80];
+#else
+  uint32_t audio_fills = 0U;
+  uint32_t wdog_audio;
+#endif
+
+  (void)argument;
+  BOOT_RECORD_Report(&huart3);
+  KERNEL_PORT_Bench(KERNEL_BENCH_RUNS, &bench);
+  printMsg("kernel: switch %lu/%lu/%lu cycles min/avg/max\r\n", bench.Min, bench.Avg, bench.Max);
+#if PLACEMENT_BENCH
+  PLACEMENT_BENCH_Run(&huart3);
+#endif
+#if PIN_BENCH
+  PIN_BENCH_Run(&huart3);
+#endif
+#if FIXMATH_BENCH
+  FIXMATH_BENCH_Run(&huart3);
+#endif
+#if POWER_BENCH
+  POWER_Bench(&huart3);
+#endif
+  if (LED_ENGINE_Play(AppLeds, APP_LED_CYCLE_MS) != HAL_OK)
+  {
+    Error_Handler();
+  }
+#if ACCEL_FUSION
+  /* A second of samples, so the timing covers the filter settling in */
+  KERNEL_Sleep(APP_ACCEL_SETTLE_MS);
+  ACCEL_INPUT_GetStats(&accel_stats);
+  printMsg("accel: %s, %lu/%lu/%lu cycles per update min/avg/max\r\n",
+           (accel_stats.Chip == ACCEL_INPUT_LIS3DSH) ? "LIS3DSH" : "LIS302DL",
+           accel_stats.CyclesMin, accel_stats.CyclesAvg, accel_stats.CyclesMax);
+#else
+  if (DAC_STREAM_PlayChirp(APP_DAC_F0_HZ, APP_DAC_F1_HZ, APP_DAC_SWEEP_MS, APP_DAC_AMPLITUDE,
+                           DAC_WAVE_MID, APP_DAC_RATE_HZ) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  DAC_STREAM_GetStats(&dac_stats);
+  printMsg("dac: chirp %lu-%lu Hz on PA5, %lu Hz (%ld ppm)\r\n", (uint32_t)APP_DAC_F0_HZ,
+           (uint32_t)APP_DAC_F1_HZ, dac_stats.ActualHz, dac_stats.ErrorPpm);
+#endif
+
+  /* Sustained rate of the interleaved ADCs, then the sensor scan for good */
+  if (ADC_ACQ_StartInterleaved(APP_ADC_FAST_RATIO) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  ADC_ACQ_GetStats(&adc_stats);
+  adc_samples = adc_stats.Samples;
+  adc_ticks = KERNEL_Ticks();
+  KERNEL_Sleep(APP_ADC_BENCH_MS);
+  ADC_ACQ_GetStats(&adc_stats);
+  printMsg("adc: interleaved %lu samples/s, %lu overruns\r\n",
+           ADC_SCAN_Rate(adc_stats.Samples - adc_samples, KERNEL_Ticks() - adc_ticks),
+           adc_stats.Overruns + adc_stats.AdcOverruns);
+  if (ADC_ACQ_StartScan(APP_ADC_FRAME_HZ, APP_ADC_RATIO) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  ADC_ACQ_GetStats(&adc_stats);
+  adc_overruns = adc_stats.Overruns + adc_stats.AdcOverruns;
+  printMsg("adc: scan %lu channels at %lu Hz\r\n", adc_stats.Channels, adc_stats.FrameHz);
+
+  /* Filters and queues in silent loopback before the bus is trusted */
+  (void)CAN_BUS_SelfTest(APP_CAN_SELFTEST, &can_test);
+  CAN_BUS_GetStats(&can_stats);
+  printMsg("can: loopback %lu/%lu frames, %lu errors%s, %lu banks\r\n", can_test.Received,
+           can_test.Sent, can_test.Errors, (can_test.Leaked != 0U) ? ", leak" : "", can_stats.Banks);
+  printMsg("can: %lu frames/s, wire limit %lu at %lu bit/s\r\n", can_test.FramesPerSec,
+           can_test.WireFramesPerSec, can_stats.Bitrate);
+#if SD_LOG
+  APP_SdLogStart();
+#endif
+#if MODBUS_SLAVE
+  /* Last words on the console: from here on USART3 is the Modbus line */
+  printMsg("modbus: slave %u at %lu baud 8E1, console off\r\n", APP_MODBUS_ADDRESS,
+           (uint32_t)MODBUS_RTU_BAUD);
+  AppConsoleOff = 1U;
+  if (MODBUS_RTU_Start(APP_MODBUS_ADDRESS, AppModbusMap,
+                       sizeof(AppModbusMap) / sizeof(AppModbusMap[0])) != HAL_OK)
+  {
+    Error_Handler();
+  }
+#endif
+
+  /* The loop below runs once a second; the mixer refills every few ms */
+  wdog_app = SUPERVISOR_Register("app", 2000U);
+#if !SD_LOG
+  wdog_audio = SUPERVISOR_Register("audio", 2000U);
+#endif
+  SUPERVISOR_Start();
+
+  while (1)
+  {
+    printMsg("Hello World\r\n");
+    APP_WaitButtons(APP_PERIOD_MS);
+
+    SUPERVISOR_Heartbeat(wdog_app);
+
+    AUDIO_STREAM_GetStats(&audio_stats);
+#if !SD_LOG
+    if (audio_stats.Fills != audio_fills)
+    {
+      audio_fills = audio_stats.Fills;
+      SUPERVISOR_Heartbeat(wdog_audio);
+    }
+#endif
+    if (audio_stats.Underruns != audio_underruns)
+    {
+      audio_underruns = audio_stats.Underruns;
+      printMsg("audio: %lu underruns\r\n", audio_underruns);
+    }
+    DAC_STREAM_GetStats(&dac_stats);
+    if (dac_stats.Underruns != dac_underruns)
+    {
+      dac_underruns = dac_stats.Underruns;
+      printMsg("dac: %lu underruns\r\n", dac_underruns);
+    }
+    ADC_ACQ_GetStats(&adc_stats);
+    if ((adc_stats.Overruns + adc_stats.AdcOverruns) != adc_overruns)
+    {
+      adc_overruns = adc_stats.Overruns + adc_stats.AdcOverruns;
+      printMsg("adc: %lu overruns\r\n", adc_overruns);
+    }
+    if (ADC_ACQ_Read(adc_values) != 0U)
+    {
+      APP_PrintAdc(adc_values, adc_stats.Channels);
+    }
+    PULSE_INPUT_Measure(&pulse_stats);
+    if (pulse_stats.Result.Periods != 0U)
+    {
+      printMsg("pulse: %lu.%03lu Hz, jitter %lu/%lu ticks, duty %u.%u%%\r\n",
+               pulse_stats.Result.MilliHz / 1000U, pulse_stats.Result.MilliHz % 1000U,
+               pulse_stats.Result.Jitter, pulse_stats.Result.Mean,
+               pulse_stats.Result.DutyPermille / 10U, pulse_stats.Result.DutyPermille % 10U);
+    }
+    else if (pulse_stats.Stalled != pulse_stalled)
+    {
+      printMsg("pulse: no signal on PA1\r\n");
+    }
+    pulse_stalled = pulse_stats.Stalled;
+    for (q = 0U; q < APP_CAN_QUEUES; q++)
+    {
+      while (CAN_BUS_Receive(q, &can_frame) != 0U)
+      {
+        can_counts[q]++;
+      }
+    }
+    CAN_BUS_GetStats(&can_stats);
+    if ((can_counts[0] + can_counts[1] + can_counts[2] != can_seen) || (can_stats.BusOffs != can_bus_offs))
+    {
+      can_seen = can_counts[0] + can_counts[1] + can_counts[2];
+      can_bus_offs = can_stats.BusOffs;
+      printMsg("can: %lu/%lu/%lu frames, %lu dropped, %lu bus-off, tec %u\r\n", can_counts[0],
+               can_counts[1], can_counts[2], can_stats.RxDropped + can_stats.RxOverruns,
+               can_bus_offs, can_stats.Tec);
+    }
+
+    /* Codec bring-up and polling run on the I2C queue, never blocking here */
+    if ((CS43L22_GetState() != codec_state) || (CS43L22_GetChipId() != codec_id))
+    {
+      codec_state = CS43L22_GetState();
+      codec_id = CS43L22_GetChipId();
+      printMsg("codec: state %u, id 0x%02X\r\n", (unsigned)codec_state, codec_id);
+    }
+    if (codec_state == CS43L22_READY)
+    {
+      (void)CS43L22_Poll();
+    }
+#if ACCEL_FUSION
+    ACCEL_INPUT_Read(&accel);
+    printMsg("accel: roll %ld, pitch %ld, tilt %ld (0.1 deg), vibration %lu mg\r\n",
+             (int32_t)(accel.Tilt.Roll * 10.0f), (int32_t)(accel.Tilt.Pitch * 10.0f),
+             (int32_t)(accel.Tilt.Tilt * 10.0f), (uint32_t)(accel.Vibration * 1000.0f));
+    ACCEL_INPUT_GetStats(&accel_stats);
+    if ((accel_stats.Overruns + accel_stats.Errors) != accel_overruns)
+    {
+      accel_overruns = accel_stats.Overruns + accel_stats.Errors;
+      printMsg("accel: %lu overruns, %lu errors\r\n", accel_stats.Overruns, accel_stats.Errors);
+    }
+#endif
+#if USB_CONSOLE
+    USB_FS_GetStats(&usb_stats);
+    if (usb_stats.TxDropped != usb_dropped)
+    {
+      usb_dropped = usb_stats.TxDropped;
+      printMsg("usb: %lu bytes dropped, %lu resets\r\n", usb_dropped, usb_stats.Resets);
+    }
+#endif
+#if SD_LOG
+    (void)snprintf(log_line, sizeof(log_line), "%lu,%lu,%u,%lu,%lu,%lu\n", KERNEL_Ticks(),
+                   (pulse_stats.Result.Periods != 0U) ? pulse_stats.Result.MilliHz : 0U,
+                   pulse_stats.Result.DutyPermille, can_seen, dac_underruns, adc_overruns);
+    APP_SdLogLine(log_line);
+#endif
+#if MODBUS_SLAVE
+    AppModbusStatus[APP_MB_UPTIME_LO] = (uint16_t)(KERNEL_Ticks() / 1000U);
+    AppModbusStatus[APP_MB_UPTIME_HI] = (uint16_t)((KERNEL_Ticks() / 1000U) >> 16);
+    AppModbusStatus[APP_MB_PULSE_HZ] = (uint16_t)((pulse_stats.Result.Periods != 0U) ?
+                                                  (pulse_stats.Result.MilliHz / 1000U) : 0U);
+    AppModbusStatus[APP_MB_PULSE_DUTY] = pulse_stats.Result.DutyPermille;
+    AppModbusStatus[APP_MB_CAN_FRAMES] = (uint16_t)can_seen;
+    AppModbusStatus[APP_MB_AUDIO_UNDERRUNS] = (uint16_t)audio_underruns;
+    AppModbusStatus[APP_MB_DAC_UNDERRUNS] = (uint16_t)dac_underruns;
+    AppModbusStatus[APP_MB_ADC_OVERRUNS] = (uint16_t)adc_overruns;
+#endif
+  }
+}
+
+/**
+  * @brief  Sleep for ms, reporting button events as they come.
+  * @param  ms: Time to spend
+  * @retval None
+  */
+static void APP_WaitButtons(uint32_t ms)
+{
+  static const char *const Gestures[] =
+  {
+    "press", "release", "click", "double click", "long press"
+  };
+  BUTTON_EventTypeDef event;
+  uint32_t now = KERNEL_Ticks();
+  uint32_t wake = now + ms;
+
+  while ((int32_t)(wake - now) > 0)
+  {
+    if ((BUTTON_INPUT_Read(&event, wake - now) == HAL_OK) &&
+        (event.Gesture < (sizeof(Gestures) / sizeof(Gestures[0]))))
+    {
+      printMsg("button: %s at %lu ms\r\n", Gestures[event.Gesture], event.Time);
+    }
+    now = KERNEL_Ticks();
+  }
+}
+
+/**
+  * @brief  Print a decimated scan frame on one line, in table order.
+  * @param  values: 16-bit full scale, one per channel
+  * @param  channels: Values in the frame
+  * @retval None
+  */
+static void APP_PrintAdc(const uint16_t *values, uint32_t channels)
+{
+  char line[64];
+  int used = snprintf(line, sizeof(line), "adc:");
+  uint32_t i;
+
+  for (i = 0U; (i < channels) && (used > 0) && ((size_t)used < sizeof(line)); i++)
+  {
+    used += snprintf(&line[used], sizeof(line) - (size_t)used, " %u", values[i]);
+  }
+  printMsg("%s\r\n", line);
+}
+
+#if SD_LOG
+/**
+  * @brief  Bring up the card and the filesystem, measure the sustained write
+  *         rate on the "bench" file, then open the "log" file for appending.
+  *         Without a card the application runs on without a log.
+  * @retval None
+  */
+static void APP_SdLogStart(void)
+{
+  static uint8_t chunk[1024];   /* Contents do not matter */
+  LOGFS_FileTypeDef bench;
+  SD_CardStatsTypeDef sd_stats;
+  LOGFS_StatusTypeDef status;
+  uint32_t ticks;
+  uint32_t n;
+
+  if (SD_CARD_Init() != HAL_OK)
+  {
+    printMsg("sd: no card\r\n");
+    return;
+  }
+  SD_CARD_GetStats(&sd_stats);
+  printMsg("sd: %lu MB %s, %lu Hz\r\n", sd_stats.Blocks / 2048U,
+           (sd_stats.HighCapacity != 0U) ? "SDHC" : "SDSC", sd_stats.ClockHz);
+
+  status = LOGFS_Mount(&AppFs, SD_CARD_Device());
+  if (status == LOGFS_CORRUPT)
+  {
+    printMsg("sd: formatting\r\n");
+    status = LOGFS_Format(&AppFs, SD_CARD_Device());
+  }
+  if (status == LOGFS_OK)
+  {
+    status = LOGFS_Create(&AppFs, "bench", APP_SD_BENCH_BYTES);
+    status = (status == LOGFS_EXISTS) ? LOGFS_OK : status;
+  }
+  if (status == LOGFS_OK)
+  {
+    status = LOGFS_Create(&AppFs, "log", APP_SD_LOG_BYTES);
+    status = (status == LOGFS_EXISTS) ? LOGFS_OK : status;
+  }
+  if (status != LOGFS_OK)
+  {
+    printMsg("sd: filesystem error %u\r\n", (unsigned)status);
+    return;
+  }
+
+  /* Whole batches in single transfers, one commit at the end */
+  status = LOGFS_Open(&AppFs, &bench, "bench", AppLogBatch, sizeof(AppLogBatch));
+  if (status == LOGFS_OK)
+  {
+    status = LOGFS_Truncate(&bench);
+  }
+  ticks = KERNEL_Ticks();
+  for (n = 0U; (status == LOGFS_OK) && (n < APP_SD_BENCH_BYTES); n += sizeof(chunk))
+  {
+    status = LOGFS_Append(&bench, chunk, sizeof(chunk));
+  }
+  if (status == LOGFS_OK)
+  {
+    status = LOGFS_Sync(&bench);
+  }
+  ticks = KERNEL_Ticks() - ticks;
+  SD_CARD_GetStats(&sd_stats);
+  printMsg("sd: %lu KB in %lu ms, %lu KB/s, busy max %lu ms\r\n", APP_SD_BENCH_BYTES / 1024U, ticks,
+           (status == LOGFS_OK) ? ((APP_SD_BENCH_BYTES / 1024U) * 1000U / ((ticks != 0U) ? ticks : 1U)) : 0U,
+           sd_stats.BusyMaxMs);
+
+  if (LOGFS_Open(&AppFs, &AppLog, "log", AppLogBatch, sizeof(AppLogBatch)) != LOGFS_OK)
+  {
+    printMsg("sd: log error\r\n");
+    return;
+  }
+  AppLogReady = 1U;
+  AppLogSynced = KERNEL_Ticks();
+  printMsg("sd: log at %lu bytes\r\n", AppLog.Length);
+}
 
+/**
+  * @brief  Append a line to the log; commit every APP_SD_SYNC_MS. A power
+  *         cut loses at most the lines since the last commit.
+  * @param  line: NUL-terminated
+  * @retval None
+  */
+static void APP_SdLogLine(const char *line)
+{
+  LOGFS_StatusTypeDef status;
+
+  if (AppLogReady == 0U)
+  {
+    return;
+  }
+  status = LOGFS_Append(&AppLog, line, strlen(line));
+  if ((status == LOGFS_OK) && ((KERNEL_Ticks() - AppLogSynced) >= APP_SD_SYNC_MS))
+  {
+    AppLogSynced = KERNEL_Ticks();
+    status = LOGFS_Sync(&AppLog);
+  }
+  if (status != LOGFS_OK)
+  {
+    AppLogReady = 0U;
+    printMsg("sd: log stopped, %s\r\n", (status == LOGFS_FULL) ? "full" : "error");
+  }
+}
+#endif
+
+#if MODBUS_SLAVE
+/**
+  * @brief  Modbus status registers, as the application task last left them.
+  * @param  index: Register in the region
+  * @retval Value
+  */
+static uint16_t APP_ModbusStatus(uint16_t index)
+{
+  return AppModbusStatus[index];
+}
+
+/**
+  * @brief  Modbus link registers: frames, responses, gap, character and
+  *         CRC errors, then the reply latency last/min/max in us.
+  * @param  index: Register in the region
+  * @retval Value, saturated to 16 bits
+  */
+static uint16_t APP_ModbusLink(uint16_t index)
+{
+  MODBUS_RtuStatsTypeDef stats;
+  uint32_t value;
+
+  MODBUS_RTU_GetStats(&stats);
+  switch (index)
+  {
+    case 0U:  value = stats.Frames;          break;
+    case 1U:  value = stats.Responses;       break;
+    case 2U:  value = stats.GapErrors;       break;
+    case 3U:  value = stats.CharErrors;      break;
+    case 4U:  value = stats.Slave.CrcErrors; break;
+    case 5U:  value = stats.LatencyUs;       break;
+    case 6U:  value = stats.LatencyMinUs;    break;
+    default:  value = stats.LatencyMaxUs;    break;
+  }
+  return (value > 0xFFFFU) ? 0xFFFFU : (uint16_t)value;
+}
+
+/**
+  * @brief  Modbus scratch register read.
+  * @param  index: Register in the region
+  * @retval Value
+  */
+static uint16_t APP_ModbusReadScratch(uint16_t index)
+{
+  return AppModbusScratch[index];
+}
+
+/**
+  * @brief  Modbus scratch register write; any value is taken.
+  * @param  index: Register in the region
+  * @param  value: New value
+  * @retval 0
+  */
+static uint8_t APP_ModbusWriteScratch(uint16_t index, uint16_t value)
+{
+  AppModbusScratch[index] = value;
+  return 0U;
+}
+#endif
+
+/**
+  * @brief  Tx Transfer completed callback, traced.
+  * @param  huart: UART handle
+  * @retval None
+  */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  TRACE_Event(TRACE_EV_UART_TX, (uint32_t)huart->Instance);
+}
+
+/**
+  * @brief  Rx Transfer completed callback, traced.
+  * @param  huart: UART handle
+  * @retval None
+  */
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+  TRACE_Event(TRACE_EV_UART_RX, (uint32_t)huart->Instance);
+}
+
+/**
+  * @brief  UART error callback, traced.
+  * @param  huart: UART handle
+  * @retval None
+  */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+  TRACE_Event(TRACE_EV_UART_ERROR, huart->ErrorCode);
+}
 /* USER CODE END 4 */
 
 /**
@@ -288,6 +1016,8 @@ void Error_Handler(void)
   /* USER CODE BEGIN Error_Handler_Debug */
   /* User can add his own implementation to report the HAL error return state */
   __disable_irq();
+  /* Leave the last events before the failure on the console */
+  (void)TRACE_RECORDER_Dump(&huart3);
   while (1)
   {
   }
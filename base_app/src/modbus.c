@@ -0,0 +1,505 @@
+/**
+  ******************************************************************************
+  * @file    modbus.c
+  * @brief   Modbus RTU slave protocol engine.
+  ******************************************************************************
+  * Every field of a request is checked against the frame length before it
+  * is read, and every response is bounded by MODBUS_ADU_MAX, so the engine
+  * can be fed arbitrary bytes (tools/modbus_fuzz.c does). Multi-register
+  * requests walk the map region by region: one binary search per region
+  * rather than per register.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "modbus.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define MODBUS_FAST_BAUD        19200U
+#define MODBUS_FAST_T15_US      750U
+#define MODBUS_FAST_T35_US      1750U
+
+/* Diagnostics (0x08) sub-functions */
+#define MODBUS_DIAG_ECHO        0x0000U
+#define MODBUS_DIAG_CLEAR       0x000AU
+#define MODBUS_DIAG_BUS         0x000BU
+#define MODBUS_DIAG_CRC         0x000CU
+#define MODBUS_DIAG_EXCEPTION   0x000DU
+#define MODBUS_DIAG_SLAVE       0x000EU
+#define MODBUS_DIAG_NO_RESPONSE 0x000FU
+#define MODBUS_DIAG_OVERRUN     0x0012U
+
+/* Private variables ---------------------------------------------------------*/
+/** CRC-16/MODBUS (reflected 0x8005) of every byte value */
+static const uint16_t ModbusCrcTable[256] =
+{
+  0x0000U, 0xC0C1U, 0xC181U, 0x0140U, 0xC301U, 0x03C0U, 0x0280U, 0xC241U,
+  0xC601U, 0x06C0U, 0x0780U, 0xC741U, 0x0500U, 0xC5C1U, 0xC481U, 0x0440U,
+  0xCC01U, 0x0CC0U, 0x0D80U, 0xCD41U, 0x0F00U, 0xCFC1U, 0xCE81U, 0x0E40U,
+  0x0A00U, 0xCAC1U, 0xCB81U, 0x0B40U, 0xC901U, 0x09C0U, 0x0880U, 0xC841U,
+  0xD801U, 0x18C0U, 0x1980U, 0xD941U, 0x1B00U, 0xDBC1U, 0xDA81U, 0x1A40U,
+  0x1E00U, 0xDEC1U, 0xDF81U, 0x1F40U, 0xDD01U, 0x1DC0U, 0x1C80U, 0xDC41U,
+  0x1400U, 0xD4C1U, 0xD581U, 0x1540U, 0xD701U, 0x17C0U, 0x1680U, 0xD641U,
+  0xD201U, 0x12C0U, 0x1380U, 0xD341U, 0x1100U, 0xD1C1U, 0xD081U, 0x1040U,
+  0xF001U, 0x30C0U, 0x3180U, 0xF141U, 0x3300U, 0xF3C1U, 0xF281U, 0x3240U,
+  0x3600U, 0xF6C1U, 0xF781U, 0x3740U, 0xF501U, 0x35C0U, 0x3480U, 0xF441U,
+  0x3C00U, 0xFCC1U, 0xFD81U, 0x3D40U, 0xFF01U, 0x3FC0U, 0x3E80U, 0xFE41U,
+  0xFA01U, 0x3AC0U, 0x3B80U, 0xFB41U, 0x3900U, 0xF9C1U, 0xF881U, 0x3840U,
+  0x2800U, 0xE8C1U, 0xE981U, 0x2940U, 0xEB01U, 0x2BC0U, 0x2A80U, 0xEA41U,
+  0xEE01U, 0x2EC0U, 0x2F80U, 0xEF41U, 0x2D00U, 0xEDC1U, 0xEC81U, 0x2C40U,
+  0xE401U, 0x24C0U, 0x2580U, 0xE541U, 0x2700U, 0xE7C1U, 0xE681U, 0x2640U,
+  0x2200U, 0xE2C1U, 0xE381U, 0x2340U, 0xE101U, 0x21C0U, 0x2080U, 0xE041U,
+  0xA001U, 0x60C0U, 0x6180U, 0xA141U, 0x6300U, 0xA3C1U, 0xA281U, 0x6240U,
+  0x6600U, 0xA6C1U, 0xA781U, 0x6740U, 0xA501U, 0x65C0U, 0x6480U, 0xA441U,
+  0x6C00U, 0xACC1U, 0xAD81U, 0x6D40U, 0xAF01U, 0x6FC0U, 0x6E80U, 0xAE41U,
+  0xAA01U, 0x6AC0U, 0x6B80U, 0xAB41U, 0x6900U, 0xA9C1U, 0xA881U, 0x6840U,
+  0x7800U, 0xB8C1U, 0xB981U, 0x7940U, 0xBB01U, 0x7BC0U, 0x7A80U, 0xBA41U,
+  0xBE01U, 0x7EC0U, 0x7F80U, 0xBF41U, 0x7D00U, 0xBDC1U, 0xBC81U, 0x7C40U,
+  0xB401U, 0x74C0U, 0x7580U, 0xB541U, 0x7700U, 0xB7C1U, 0xB681U, 0x7640U,
+  0x7200U, 0xB2C1U, 0xB381U, 0x7340U, 0xB101U, 0x71C0U, 0x7080U, 0xB041U,
+  0x5000U, 0x90C1U, 0x9181U, 0x5140U, 0x9301U, 0x53C0U, 0x5280U, 0x9241U,
+  0x9601U, 0x56C0U, 0x5780U, 0x9741U, 0x5500U, 0x95C1U, 0x9481U, 0x5440U,
+  0x9C01U, 0x5CC0U, 0x5D80U, 0x9D41U, 0x5F00U, 0x9FC1U, 0x9E81U, 0x5E40U,
+  0x5A00U, 0x9AC1U, 0x9B81U, 0x5B40U, 0x9901U, 0x59C0U, 0x5880U, 0x9841U,
+  0x8801U, 0x48C0U, 0x4980U, 0x8941U, 0x4B00U, 0x8BC1U, 0x8A81U, 0x4A40U,
+  0x4E00U, 0x8EC1U, 0x8F81U, 0x4F40U, 0x8D01U, 0x4DC0U, 0x4C80U, 0x8C41U,
+  0x4400U, 0x84C1U, 0x8581U, 0x4540U, 0x8701U, 0x47C0U, 0x4680U, 0x8641U,
+  0x8201U, 0x42C0U, 0x4380U, 0x8341U, 0x4100U, 0x81C1U, 0x8081U, 0x4040U,
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t  MODBUS_Check(const MODBUS_SlaveTypeDef *slave, uint32_t start, uint32_t count,
+                             uint8_t write);
+static uint8_t  MODBUS_Read(const MODBUS_SlaveTypeDef *slave, const uint8_t *pdu, uint32_t length,
+                            uint8_t *response, uint32_t *used);
+static uint8_t  MODBUS_WriteSingle(const MODBUS_SlaveTypeDef *slave, const uint8_t *pdu,
+                                   uint32_t length);
+static uint8_t  MODBUS_WriteMultiple(const MODBUS_SlaveTypeDef *slave, const uint8_t *pdu,
+                                     uint32_t length);
+static uint8_t  MODBUS_Diagnostics(MODBUS_SlaveTypeDef *slave, const uint8_t *pdu, uint32_t length,
+                                   uint8_t *response);
+static uint16_t MODBUS_Get16(const uint8_t *data);
+static void     MODBUS_Put16(uint8_t *data, uint16_t value);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Set up a slave on a register map and clear its counters.
+  * @param  slave: Slave to set up
+  * @param  address: 1 to MODBUS_ADDRESS_MAX
+  * @param  regions: Sorted by Address, none empty or overlapping or past
+  *         0xFFFF, kept by the slave
+  * @param  count: Regions
+  * @retval MODBUS_OK or MODBUS_INVALID
+  */
+MODBUS_StatusTypeDef MODBUS_Init(MODBUS_SlaveTypeDef *slave, uint8_t address,
+                                 const MODBUS_RegionTypeDef *regions, uint32_t count)
+{
+  uint32_t next = 0U;
+  uint32_t i;
+
+  if ((address == MODBUS_BROADCAST) || (address > MODBUS_ADDRESS_MAX))
+  {
+    return MODBUS_INVALID;
+  }
+  for (i = 0U; i < count; i++)
+  {
+    if ((regions[i].Count == 0U) || (regions[i].Read == NULL) || (regions[i].Address < next) ||
+        (((uint32_t)regions[i].Address + regions[i].Count) > 0x10000U))
+    {
+      return MODBUS_INVALID;
+    }
+    next = (uint32_t)regions[i].Address + regions[i].Count;
+  }
+  memset(slave, 0, sizeof(*slave));
+  slave->Address = address;
+  slave->Regions = regions;
+  slave->RegionCount = count;
+  return MODBUS_OK;
+}
+
+/**
+  * @brief  Run one request frame.
+  * @param  slave: Slave
+  * @param  request: Frame, CRC included
+  * @param  length: Bytes in the frame
+  * @param  response: MODBUS_ADU_MAX bytes for the response frame
+  * @retval Bytes of response to send, 0 for none
+  */
+uint32_t MODBUS_Process(MODBUS_SlaveTypeDef *slave, const uint8_t *request, uint32_t length,
+                        uint8_t *response)
+{
+  const uint8_t *pdu = &request[1];
+  uint32_t pdu_length;
+  uint32_t used = 0U;
+  uint16_t crc;
+  uint8_t exception;
+
+  if ((length < 4U) || (length > MODBUS_ADU_MAX) ||
+      (MODBUS_Crc16(request, length - 2U) != (request[length - 2U] | ((uint16_t)request[length - 1U] << 8))))
+  {
+    slave->CrcErrors++;
+    return 0U;
+  }
+  slave->BusMessages++;
+  if ((request[0] != slave->Address) && (request[0] != MODBUS_BROADCAST))
+  {
+    return 0U;
+  }
+  slave->SlaveMessages++;
+  pdu_length = length - 3U;
+
+  /* A broadcast runs the writes and is never answered, not even with an
+   * exception; reads and diagnostics are for one slave only */
+  if (request[0] == MODBUS_BROADCAST)
+  {
+    if (pdu[0] == 0x06U)
+    {
+      (void)MODBUS_WriteSingle(slave, pdu, pdu_length);
+    }
+    else if (pdu[0] == 0x10U)
+    {
+      (void)MODBUS_WriteMultiple(slave, pdu, pdu_length);
+    }
+    slave->NoResponses++;
+    return 0U;
+  }
+
+  response[0] = slave->Address;
+  response[1] = pdu[0];
+  switch (pdu[0])
+  {
+    case 0x03U:
+    case 0x04U:
+      exception = MODBUS_Read(slave, pdu, pdu_length, &response[2], &used);
+      break;
+
+    case 0x06U:
+      exception = MODBUS_WriteSingle(slave, pdu, pdu_length);
+      used = (exception == 0U) ? 4U : 0U;
+      memcpy(&response[2], &pdu[1], used);
+      break;
+
+    case 0x10U:
+      exception = MODBUS_WriteMultiple(slave, pdu, pdu_length);
+      used = (exception == 0U) ? 4U : 0U;
+      memcpy(&response[2], &pdu[1], used);
+      break;
+
+    case 0x08U:
+      exception = MODBUS_Diagnostics(slave, pdu, pdu_length, &response[2]);
+      used = (exception == 0U) ? (pdu_length - 1U) : 0U;
+      break;
+
+    default:
+      exception = MODBUS_EX_FUNCTION;
+      break;
+  }
+
+  if (exception != 0U)
+  {
+    slave->Exceptions++;
+    response[1] = pdu[0] | 0x80U;
+    response[2] = exception;
+    used = 1U;
+  }
+  crc = MODBUS_Crc16(response, 2U + used);
+  response[2U + used] = (uint8_t)crc;
+  response[3U + used] = (uint8_t)(crc >> 8);
+  return 4U + used;
+}
+
+/**
+  * @brief  Region serving a register, by binary search.
+  * @param  slave: Slave
+  * @param  address: Register
+  * @retval Region, or NULL if no region has it
+  */
+const MODBUS_RegionTypeDef *MODBUS_Find(const MODBUS_SlaveTypeDef *slave, uint16_t address)
+{
+  const MODBUS_RegionTypeDef *region;
+  uint32_t low = 0U;
+  uint32_t high = slave->RegionCount;
+  uint32_t mid;
+
+  /* Last region starting at or below the address */
+  while (low < high)
+  {
+    mid = (low + high) / 2U;
+    if (slave->Regions[mid].Address <= address)
+    {
+      low = mid + 1U;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+  if (low == 0U)
+  {
+    return NULL;
+  }
+  region = &slave->Regions[low - 1U];
+  return (((uint32_t)address - region->Address) < region->Count) ? region : NULL;
+}
+
+/**
+  * @brief  CRC-16/MODBUS, a byte per table lookup. Sent low byte first.
+  * @param  data: Bytes
+  * @param  length: Bytes
+  * @retval CRC
+  */
+uint16_t MODBUS_Crc16(const uint8_t *data, uint32_t length)
+{
+  uint16_t crc = 0xFFFFU;
+  uint32_t i;
+
+  for (i = 0U; i < length; i++)
+  {
+    crc = (uint16_t)((crc >> 8) ^ ModbusCrcTable[(crc ^ data[i]) & 0xFFU]);
+  }
+  return crc;
+}
+
+/**
+  * @brief  Character time and silent intervals, rounded up to whole us.
+  * @param  baud: Bit rate
+  * @param  char_bits: Bits per character: 11 for 8E1, 8O1 or 8N2
+  * @param  timing: Filled in
+  * @retval None
+  */
+void MODBUS_Timing(uint32_t baud, uint32_t char_bits, MODBUS_TimingTypeDef *timing)
+{
+  timing->CharUs = ((char_bits * 1000000U) + baud - 1U) / baud;
+  if (baud > MODBUS_FAST_BAUD)
+  {
+    timing->T15Us = MODBUS_FAST_T15_US;
+    timing->T35Us = MODBUS_FAST_T35_US;
+  }
+  else
+  {
+    timing->T15Us = ((char_bits * 3000000U) + (2U * baud) - 1U) / (2U * baud);
+    timing->T35Us = ((char_bits * 7000000U) + (2U * baud) - 1U) / (2U * baud);
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Whether the map has every register of a range, writable if asked.
+  * @param  slave: Slave
+  * @param  start: First register
+  * @param  count: Registers, start + count <= 0x10000
+  * @param  write: Nonzero to require a Write callback
+  * @retval 0 or MODBUS_EX_ADDRESS
+  */
+static uint8_t MODBUS_Check(const MODBUS_SlaveTypeDef *slave, uint32_t start, uint32_t count,
+                            uint8_t write)
+{
+  const MODBUS_RegionTypeDef *region;
+  uint32_t address = start;
+
+  while (address < (start + count))
+  {
+    region = MODBUS_Find(slave, (uint16_t)address);
+    if ((region == NULL) || ((write != 0U) && (region->Write == NULL)))
+    {
+      return MODBUS_EX_ADDRESS;
+    }
+    address = (uint32_t)region->Address + region->Count;
+  }
+  return 0U;
+}
+
+/**
+  * @brief  0x03 and 0x04: start and quantity in, byte count and values out.
+  * @param  slave: Slave
+  * @param  pdu: Function code onwards
+  * @param  length: PDU bytes
+  * @param  response: Byte count onwards
+  * @param  used: Response bytes written
+  * @retval 0 or an exception code
+  */
+static uint8_t MODBUS_Read(const MODBUS_SlaveTypeDef *slave, const uint8_t *pdu, uint32_t length,
+                           uint8_t *response, uint32_t *used)
+{
+  const MODBUS_RegionTypeDef *region = NULL;
+  uint32_t start;
+  uint32_t count;
+  uint32_t i;
+  uint8_t exception;
+
+  if (length != 5U)
+  {
+    return MODBUS_EX_VALUE;
+  }
+  start = MODBUS_Get16(&pdu[1]);
+  count = MODBUS_Get16(&pdu[3]);
+  if ((count == 0U) || (count > MODBUS_READ_MAX))
+  {
+    return MODBUS_EX_VALUE;
+  }
+  if ((start + count) > 0x10000U)
+  {
+    return MODBUS_EX_ADDRESS;
+  }
+  exception = MODBUS_Check(slave, start, count, 0U);
+  if (exception != 0U)
+  {
+    return exception;
+  }
+
+  response[0] = (uint8_t)(count * 2U);
+  for (i = 0U; i < count; i++)
+  {
+    if ((region == NULL) || ((start + i) >= ((uint32_t)region->Address + region->Count)))
+    {
+      region = MODBUS_Find(slave, (uint16_t)(start + i));
+    }
+    MODBUS_Put16(&response[1U + (2U * i)], region->Read((uint16_t)(start + i - region->Address)));
+  }
+  *used = 1U + (count * 2U);
+  return 0U;
+}
+
+/**
+  * @brief  0x06: one register. The response echoes the request.
+  * @param  slave: Slave
+  * @param  pdu: Function code onwards
+  * @param  length: PDU bytes
+  * @retval 0 or an exception code
+  */
+static uint8_t MODBUS_WriteSingle(const MODBUS_SlaveTypeDef *slave, const uint8_t *pdu,
+                                  uint32_t length)
+{
+  const MODBUS_RegionTypeDef *region;
+  uint16_t address;
+
+  if (length != 5U)
+  {
+    return MODBUS_EX_VALUE;
+  }
+  address = MODBUS_Get16(&pdu[1]);
+  region = MODBUS_Find(slave, address);
+  if ((region == NULL) || (region->Write == NULL))
+  {
+    return MODBUS_EX_ADDRESS;
+  }
+  return region->Write((uint16_t)(address - region->Address), MODBUS_Get16(&pdu[3]));
+}
+
+/**
+  * @brief  0x10: start, quantity, byte count and values. Written in address
+  *         order; a value the map refuses stops the write there.
+  * @param  slave: Slave
+  * @param  pdu: Function code onwards
+  * @param  length: PDU bytes
+  * @retval 0 or an exception code
+  */
+static uint8_t MODBUS_WriteMultiple(const MODBUS_SlaveTypeDef *slave, const uint8_t *pdu,
+                                    uint32_t length)
+{
+  const MODBUS_RegionTypeDef *region = NULL;
+  uint32_t start;
+  uint32_t count;
+  uint32_t i;
+  uint8_t exception;
+
+  if (length < 6U)
+  {
+    return MODBUS_EX_VALUE;
+  }
+  start = MODBUS_Get16(&pdu[1]);
+  count = MODBUS_Get16(&pdu[3]);
+  if ((count == 0U) || (count > MODBUS_WRITE_MAX) || (pdu[5] != (count * 2U)) ||
+      (length != (6U + (count * 2U))))
+  {
+    return MODBUS_EX_VALUE;
+  }
+  if ((start + count) > 0x10000U)
+  {
+    return MODBUS_EX_ADDRESS;
+  }
+  exception = MODBUS_Check(slave, start, count, 1U);
+  for (i = 0U; (i < count) && (exception == 0U); i++)
+  {
+    if ((region == NULL) || ((start + i) >= ((uint32_t)region->Address + region->Count)))
+    {
+      region = MODBUS_Find(slave, (uint16_t)(start + i));
+    }
+    exception = region->Write((uint16_t)(start + i - region->Address), MODBUS_Get16(&pdu[6U + (2U * i)]));
+  }
+  return exception;
+}
+
+/**
+  * @brief  0x08: the sub-function and data come back, the data replaced by
+  *         the counter asked for.
+  * @param  slave: Slave
+  * @param  pdu: Function code onwards
+  * @param  length: PDU bytes
+  * @param  response: Sub-function onwards, length - 1 bytes
+  * @retval 0 or an exception code
+  */
+static uint8_t MODBUS_Diagnostics(MODBUS_SlaveTypeDef *slave, const uint8_t *pdu, uint32_t length,
+                                  uint8_t *response)
+{
+  uint16_t sub;
+  uint16_t value;
+
+  if (length < 3U)
+  {
+    return MODBUS_EX_VALUE;
+  }
+  sub = MODBUS_Get16(&pdu[1]);
+  if (sub == MODBUS_DIAG_ECHO)
+  {
+    memcpy(response, &pdu[1], length - 1U);
+    return 0U;
+  }
+  if ((length != 5U) || (MODBUS_Get16(&pdu[3]) != 0U))
+  {
+    return MODBUS_EX_VALUE;
+  }
+  switch (sub)
+  {
+    case MODBUS_DIAG_CLEAR:
+      slave->BusMessages = 0U;
+      slave->CrcErrors = 0U;
+      slave->Exceptions = 0U;
+      slave->SlaveMessages = 0U;
+      slave->NoResponses = 0U;
+      slave->Overruns = 0U;
+      value = 0U;
+      break;
+    case MODBUS_DIAG_BUS:         value = slave->BusMessages;   break;
+    case MODBUS_DIAG_CRC:         value = slave->CrcErrors;     break;
+    case MODBUS_DIAG_EXCEPTION:   value = slave->Exceptions;    break;
+    case MODBUS_DIAG_SLAVE:       value = slave->SlaveMessages; break;
+    case MODBUS_DIAG_NO_RESPONSE: value = slave->NoResponses;   break;
+    case MODBUS_DIAG_OVERRUN:     value = slave->Overruns;      break;
+    default:
+      return MODBUS_EX_FUNCTION;
+  }
+  MODBUS_Put16(&response[0], sub);
+  MODBUS_Put16(&response[2], value);
+  return 0U;
+}
+
+/**
+  * @brief  Big-endian 16-bit field.
+  */
+static uint16_t MODBUS_Get16(const uint8_t *data)
+{
+  return (uint16_t)(((uint16_t)data[0] << 8) | data[1]);
+}
+
+/**
+  * @brief  Store a big-endian 16-bit field.
+  */
+static void MODBUS_Put16(uint8_t *data, uint16_t value)
+{
+  data[0] = (uint8_t)(value >> 8);
+  data[1] = (uint8_t)value;
+}
@@ -0,0 +1,364 @@
+/**
+  ******************************************************************************
+  * @file    modbus_rtu.c
+  * @brief   Modbus RTU slave on USART3: circular DMA reception, frame
+  *          boundaries from the idle line and TIM3, interrupt-driven reply.
+  ******************************************************************************
+  * USART3 (PB10 TX, PB11 RX), 8E1 at MODBUS_RTU_BAUD:
+  *
+  *   RX -> DMA1 Stream1 ch4, circular -> ModbusRing, no interrupt per byte
+  *   IDLE interrupt (one character of silence) -> TIM3 one-pulse from 0:
+  *     CC1 at t1.5 - 1 char   bytes since IDLE: the frame goes on, stop
+  *                            none: the frame is closed to more bytes
+  *     update at t3.5 - 1 char  no bytes since IDLE: end of frame
+  *   TX <- TXE interrupts from ModbusTx
+  *
+  * Bytes after t1.5 but before t3.5 make the frame invalid, as the standard
+  * asks; it is dropped at the next t3.5. Both USART3 transmit streams are
+  * taken (LED engine, pulse capture), so the reply goes out on TXE
+  * interrupts: at most 256 of them per reply, one per character time.
+  *
+  * The request is processed in the TIM3 interrupt at t3.5 and the first
+  * reply byte written straight away. The latency reported runs from the end
+  * of the last request byte, one character before IDLE was raised, to that
+  * write.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "modbus_rtu.h"
+#include "clock_config.h"
+#include "clock_tree.h"
+#include "dwt.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define MODBUS_RTU_MASK         (MODBUS_RTU_RING - 1U)
+#define MODBUS_RTU_CHAR_ERRORS  (USART_SR_PE | USART_SR_FE | USART_SR_NE)
+
+_Static_assert((MODBUS_RTU_RING & MODBUS_RTU_MASK) == 0U, "MODBUS_RTU_RING must be a power of two");
+_Static_assert(MODBUS_RTU_RING >= (2U * MODBUS_ADU_MAX), "MODBUS_RTU_RING must hold two frames");
+
+/* Private variables ---------------------------------------------------------*/
+DMA_HandleTypeDef hdma_usart3_rx;
+TIM_HandleTypeDef htim3;
+extern UART_HandleTypeDef huart3;
+
+static uint8_t                ModbusRing[MODBUS_RTU_RING];
+static uint8_t                ModbusFrame[MODBUS_ADU_MAX];
+static uint8_t                ModbusTx[MODBUS_ADU_MAX];
+static MODBUS_SlaveTypeDef    ModbusSlave;
+static MODBUS_TimingTypeDef   ModbusTiming;
+static MODBUS_RtuStatsTypeDef ModbusStats;
+static uint32_t               ModbusStart;      /*!< Ring index of the frame  */
+static uint32_t               ModbusIdle;       /*!< Ring index at last IDLE  */
+static uint32_t               ModbusIdleCycles;
+static uint8_t                ModbusClosed;     /*!< Past t1.5, before t3.5   */
+static uint8_t                ModbusBad;
+static volatile uint32_t      ModbusTxLength;
+static uint32_t               ModbusTxNext;
+static uint8_t                ModbusActive;
+
+/* Private function prototypes -----------------------------------------------*/
+static void     MODBUS_RTU_MspInit(void);
+static uint32_t MODBUS_RTU_Position(void);
+static void     MODBUS_RTU_Frame(void);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Set up TIM3 and the receive DMA stream. USART3 is left to the
+  *         console until MODBUS_RTU_Start(). Call before
+  *         POWER_AddTimer(&htim3, MODBUS_RTU_TICK_HZ).
+  * @retval HAL status
+  */
+HAL_StatusTypeDef MODBUS_RTU_Init(void)
+{
+  MODBUS_RTU_MspInit();
+
+  htim3.Instance = TIM3;
+  htim3.Init.Prescaler = CLOCK_TIM_PSC(CLOCK_CONFIG_TIM_APB1_HZ, MODBUS_RTU_TICK_HZ);
+  htim3.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim3.Init.Period = 0xFFFFU;
+  htim3.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim3.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  if (HAL_TIM_Base_Init(&htim3) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  TIM3->CR1 |= TIM_CR1_OPM;
+  TIM3->SR = 0U;
+  TIM3->DIER = TIM_DIER_CC1IE | TIM_DIER_UIE;
+
+  /* DMA1 Stream1 channel 4 is USART3_RX */
+  hdma_usart3_rx.Instance = DMA1_Stream1;
+  hdma_usart3_rx.Init.Channel = DMA_CHANNEL_4;
+  hdma_usart3_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_usart3_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_usart3_rx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_usart3_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_usart3_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_usart3_rx.Init.Mode = DMA_CIRCULAR;
+  hdma_usart3_rx.Init.Priority = DMA_PRIORITY_MEDIUM;
+  hdma_usart3_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  return HAL_DMA_Init(&hdma_usart3_rx);
+}
+
+/**
+  * @brief  Take USART3 over from the console and answer requests.
+  * @param  address: Slave address, 1 to MODBUS_ADDRESS_MAX
+  * @param  regions: Register map (modbus.h), kept; its callbacks run in the
+  *         TIM3 interrupt
+  * @param  count: Regions
+  * @retval HAL status
+  */
+HAL_StatusTypeDef MODBUS_RTU_Start(uint8_t address, const MODBUS_RegionTypeDef *regions,
+                                   uint32_t count)
+{
+  if ((ModbusActive != 0U) || (MODBUS_Init(&ModbusSlave, address, regions, count) != MODBUS_OK))
+  {
+    return HAL_ERROR;
+  }
+
+  /* Let the console's last byte out, then reframe the port */
+  while (__HAL_UART_GET_FLAG(&huart3, UART_FLAG_TC) == RESET)
+  {
+  }
+  huart3.Init.BaudRate = MODBUS_RTU_BAUD;
+  huart3.Init.WordLength = UART_WORDLENGTH_9B;
+  huart3.Init.StopBits = UART_STOPBITS_1;
+  huart3.Init.Parity = UART_PARITY_EVEN;
+  huart3.Init.Mode = UART_MODE_TX_RX;
+  if (HAL_UART_Init(&huart3) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  MODBUS_Timing(MODBUS_RTU_BAUD, MODBUS_RTU_CHAR_BITS, &ModbusTiming);
+  memset(&ModbusStats, 0, sizeof(ModbusStats));
+  ModbusStats.Baud = MODBUS_RTU_BAUD;
+  ModbusStats.LatencyMinUs = 0xFFFFFFFFU;
+  TIM3->CCR1 = ModbusTiming.T15Us - ModbusTiming.CharUs;
+  TIM3->ARR = ModbusTiming.T35Us - ModbusTiming.CharUs;
+
+  if (HAL_DMA_Start(&hdma_usart3_rx, (uint32_t)&USART3->DR, (uint32_t)ModbusRing, MODBUS_RTU_RING) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  ModbusStart = 0U;
+  ModbusIdle = 0U;
+  ModbusClosed = 0U;
+  ModbusBad = 0U;
+  ModbusTxLength = 0U;
+  ModbusActive = 1U;
+  (void)USART3->SR;
+  (void)USART3->DR;
+  USART3->CR3 |= USART_CR3_DMAR | USART_CR3_EIE;
+  USART3->CR1 |= USART_CR1_IDLEIE | USART_CR1_PEIE;
+  HAL_NVIC_EnableIRQ(TIM3_IRQn);
+  HAL_NVIC_EnableIRQ(USART3_IRQn);
+  return HAL_OK;
+}
+
+/**
+  * @brief  Snapshot of the link and protocol counters.
+  * @param  stats: Filled in
+  * @retval None
+  */
+void MODBUS_RTU_GetStats(MODBUS_RtuStatsTypeDef *stats)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  *stats = ModbusStats;
+  stats->Slave = ModbusSlave;
+  __set_PRIMASK(primask);
+  if (stats->LatencyMinUs == 0xFFFFFFFFU)
+  {
+    stats->LatencyMinUs = 0U;
+  }
+}
+
+/**
+  * @brief  Operating point notifier (power.h): hold the switch off while a
+  *         frame is coming in or a reply going out, so the bit rate does
+  *         not change under a character. TIM3 and the baud rate are
+  *         re-timed by power.c.
+  * @param  context: Not used
+  * @param  event: DVFS_EV_PRE or DVFS_EV_POST
+  * @param  point: Not used
+  * @retval DVFS_OK or DVFS_BUSY
+  */
+DVFS_StatusTypeDef MODBUS_RTU_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                          const DVFS_PointTypeDef *point)
+{
+  (void)context;
+  (void)point;
+  if ((event != DVFS_EV_PRE) || (ModbusActive == 0U))
+  {
+    return DVFS_OK;
+  }
+  return ((ModbusTxLength != 0U) || ((TIM3->CR1 & TIM_CR1_CEN) != 0U) ||
+          (MODBUS_RTU_Position() != ModbusStart)) ? DVFS_BUSY : DVFS_OK;
+}
+
+/**
+  * @brief  USART3 interrupt: idle line, character errors and the reply.
+  * @retval None
+  */
+void MODBUS_RTU_UART_IRQHandler(void)
+{
+  uint32_t sr = USART3->SR;
+  uint32_t cr1 = USART3->CR1;
+
+  if ((sr & (MODBUS_RTU_CHAR_ERRORS | USART_SR_ORE | USART_SR_IDLE)) != 0U)
+  {
+    /* SR then DR clears them; the DMA has taken the byte already */
+    (void)USART3->DR;
+    if ((sr & MODBUS_RTU_CHAR_ERRORS) != 0U)
+    {
+      ModbusStats.CharErrors++;
+      ModbusBad = 1U;
+    }
+    if ((sr & USART_SR_ORE) != 0U)
+    {
+      ModbusSlave.Overruns++;
+      ModbusBad = 1U;
+    }
+  }
+  if ((sr & USART_SR_IDLE) != 0U)
+  {
+    ModbusIdleCycles = DWT_Cycles();
+    ModbusIdle = MODBUS_RTU_Position();
+    if (ModbusClosed != 0U)
+    {
+      /* More bytes after t1.5 and already silent again before t3.5 */
+      ModbusStats.GapErrors++;
+      ModbusBad = 1U;
+      ModbusClosed = 0U;
+    }
+    TIM3->CR1 &= ~TIM_CR1_CEN;
+    TIM3->CNT = 0U;
+    TIM3->SR = 0U;
+    TIM3->CR1 |= TIM_CR1_CEN;
+  }
+
+  if (((cr1 & USART_CR1_TXEIE) != 0U) && ((sr & USART_SR_TXE) != 0U))
+  {
+    USART3->DR = ModbusTx[ModbusTxNext++];
+    if (ModbusTxNext >= ModbusTxLength)
+    {
+      USART3->CR1 = (cr1 & ~USART_CR1_TXEIE) | USART_CR1_TCIE;
+    }
+  }
+  else if (((cr1 & USART_CR1_TCIE) != 0U) && ((sr & USART_SR_TC) != 0U))
+  {
+    USART3->CR1 = cr1 & ~USART_CR1_TCIE;
+    ModbusTxLength = 0U;
+  }
+}
+
+/**
+  * @brief  TIM3 interrupt: t1.5 and t3.5 after the last character.
+  * @retval None
+  */
+void MODBUS_RTU_TIM_IRQHandler(void)
+{
+  uint32_t sr = TIM3->SR;
+  uint32_t position = MODBUS_RTU_Position();
+
+  TIM3->SR = ~sr;
+  if ((sr & TIM_SR_CC1IF) != 0U)
+  {
+    if (position != ModbusIdle)
+    {
+      /* Bytes within t1.5: the same frame, the next IDLE restarts the timer */
+      TIM3->CR1 &= ~TIM_CR1_CEN;
+      TIM3->SR = 0U;
+      return;
+    }
+    ModbusClosed = 1U;
+  }
+  if ((sr & TIM_SR_UIF) != 0U)
+  {
+    ModbusClosed = 0U;
+    if (position != ModbusIdle)
+    {
+      /* Bytes between t1.5 and t3.5: the frame is void, and so is what
+       * follows up to the next proper silence */
+      ModbusStats.GapErrors++;
+      ModbusBad = 1U;
+      return;
+    }
+    MODBUS_RTU_Frame();
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Interrupt priorities; pins and clocks come with the console
+  *         (HAL_UART_MspInit).
+  * @retval None
+  */
+static void MODBUS_RTU_MspInit(void)
+{
+  __HAL_RCC_TIM3_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  HAL_NVIC_SetPriority(TIM3_IRQn, MODBUS_RTU_IRQ_PRIORITY, 0);
+  HAL_NVIC_SetPriority(USART3_IRQn, MODBUS_RTU_IRQ_PRIORITY, 0);
+}
+
+/**
+  * @brief  Ring index the DMA writes next.
+  * @retval 0 to MODBUS_RTU_RING - 1
+  */
+static uint32_t MODBUS_RTU_Position(void)
+{
+  return (MODBUS_RTU_RING - hdma_usart3_rx.Instance->NDTR) & MODBUS_RTU_MASK;
+}
+
+/**
+  * @brief  A frame ended at ModbusIdle: run it and start the reply.
+  * @retval None
+  */
+static void MODBUS_RTU_Frame(void)
+{
+  uint32_t length = (ModbusIdle - ModbusStart) & MODBUS_RTU_MASK;
+  uint32_t first = MODBUS_RTU_RING - ModbusStart;
+  uint8_t bad = ModbusBad;
+
+  ModbusBad = 0U;
+  ModbusStats.Frames++;
+  if (length > MODBUS_ADU_MAX)
+  {
+    ModbusStats.TooLong++;
+    bad = 1U;
+  }
+  if (bad == 0U)
+  {
+    first = (first < length) ? first : length;
+    memcpy(ModbusFrame, &ModbusRing[ModbusStart], first);
+    memcpy(&ModbusFrame[first], ModbusRing, length - first);
+  }
+  ModbusStart = ModbusIdle;
+  if ((bad != 0U) || (ModbusTxLength != 0U))
+  {
+    return;
+  }
+
+  length = MODBUS_Process(&ModbusSlave, ModbusFrame, length, ModbusTx);
+  if (length == 0U)
+  {
+    return;
+  }
+  ModbusTxLength = length;
+  ModbusTxNext = 1U;
+  USART3->DR = ModbusTx[0];
+  ModbusStats.LatencyUs = DWT_CyclesToUs(DWT_Cycles() - ModbusIdleCycles) + ModbusTiming.CharUs;
+  ModbusStats.LatencyMinUs = (ModbusStats.LatencyUs < ModbusStats.LatencyMinUs) ? ModbusStats.LatencyUs
+                                                                                 : ModbusStats.LatencyMinUs;
+  ModbusStats.LatencyMaxUs = (ModbusStats.LatencyUs > ModbusStats.LatencyMaxUs) ? ModbusStats.LatencyUs
+                                                                                 : ModbusStats.LatencyMaxUs;
+  ModbusStats.Responses++;
+  USART3->CR1 |= (length > 1U) ? USART_CR1_TXEIE : USART_CR1_TCIE;
+}
@@ -0,0 +1,125 @@
+/**
+  ******************************************************************************
+  * @file    mpu_guard.c
+  * @brief   MPU guard regions at address 0 and below the main stack and every
+  *          task stack.
+  ******************************************************************************
+  * The regions are built by mpu_region.c once at startup and after task
+  * creation; nothing is reprogrammed on a context switch, so the guards cost
+  * no cycles at run time. Everything outside them keeps the default memory
+  * map (PRIVDEFENA).
+  *
+  * An access to the first kilobyte, where a NULL pointer points, faults.
+  * Stack guards are read-only rather than no-access: the first push into one
+  * raises MemManage, while KERNEL_StackUnused() can still read the fill
+  * pattern down to the bottom. The fault handler looks the faulting address
+  * up with MPU_GUARD_Find() to name the stack in the crash report.
+  *
+  * The main stack is the _Min_Stack_Size bytes below _estack that the linker
+  * script reserves and sysmem.c keeps the heap out of; interrupts and main()
+  * before KERNEL_PORT_Start() run on it.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "mpu_guard.h"
+#include "kernel.h"
+
+/* Private variables ---------------------------------------------------------*/
+extern uint8_t  _estack;              /* Symbols defined in the linker script */
+extern uint32_t _Min_Stack_Size;
+
+static MPU_REGION_TableTypeDef GuardTable;
+static uint32_t GuardTasks;           /* Tasks guarded so far, by Id */
+
+/* Private function prototypes -----------------------------------------------*/
+static void MPU_GUARD_Load(void);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Guard NULL and the main stack and enable the MPU.
+  * @retval HAL_ERROR if a guard does not fit
+  */
+HAL_StatusTypeDef MPU_GUARD_Init(void)
+{
+  uint32_t top = (uint32_t)&_estack;
+
+  MPU_REGION_Init(&GuardTable);
+  GuardTasks = 0U;
+  if ((MPU_REGION_Add(&GuardTable, "null", MPU_REGION_NULL, 0U, MPU_GUARD_NULL_SIZE,
+                      MPU_GUARD_NULL_SIZE) != MPU_REGION_OK) ||
+      (MPU_REGION_Add(&GuardTable, "main", MPU_REGION_STACK, top - (uint32_t)&_Min_Stack_Size, top,
+                      MPU_GUARD_STACK_SIZE) != MPU_REGION_OK))
+  {
+    return HAL_ERROR;
+  }
+  MPU_GUARD_Load();
+  return HAL_OK;
+}
+
+/**
+  * @brief  Guard the stacks of the tasks created since the last call.
+  *         Call after creating them: the guard is read-only and
+  *         KERNEL_TaskCreate() fills the whole stack.
+  * @retval HAL_ERROR if the MPU has no region left or a stack is too small;
+  *         the tasks before it stay guarded
+  */
+HAL_StatusTypeDef MPU_GUARD_AddTasks(void)
+{
+  KERNEL_TaskTypeDef *task;
+  HAL_StatusTypeDef status = HAL_OK;
+  uint32_t start;
+
+  while ((task = KERNEL_TaskAt(GuardTasks)) != NULL)
+  {
+    start = (uint32_t)task->Stack;
+    if (MPU_REGION_Add(&GuardTable, task->Name, MPU_REGION_STACK, start,
+                       start + (task->StackWords * 4U), MPU_GUARD_STACK_SIZE) != MPU_REGION_OK)
+    {
+      status = HAL_ERROR;
+      break;
+    }
+    GuardTasks++;
+  }
+  MPU_GUARD_Load();
+  return status;
+}
+
+/**
+  * @brief  Guard region a faulting address belongs to.
+  * @param  address: MMFAR, or the stack pointer of a stacking fault
+  * @retval Entry, NULL if no guard was hit
+  */
+const MPU_REGION_EntryTypeDef *MPU_GUARD_Find(uint32_t address)
+{
+  return MPU_REGION_Find(&GuardTable, address);
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Program every region from the table and enable the MPU.
+  * @retval None
+  */
+static void MPU_GUARD_Load(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t i;
+
+  __disable_irq();
+  ARM_MPU_Disable();
+  for (i = 0U; i < MPU_REGION_COUNT; i++)
+  {
+    if (i < GuardTable.Count)
+    {
+      ARM_MPU_SetRegion(GuardTable.Entries[i].Rbar, GuardTable.Entries[i].Rasr);
+    }
+    else
+    {
+      ARM_MPU_ClrRegion(i);
+    }
+  }
+  ARM_MPU_Enable(MPU_CTRL_PRIVDEFENA_Msk);
+  __set_PRIMASK(primask);
+}
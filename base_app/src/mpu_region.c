@@ -0,0 +1,220 @@
+/**
+  ******************************************************************************
+  * @file    mpu_region.c
+  * @brief   ARMv7-M MPU guard regions: placement and register values.
+  ******************************************************************************
+  * A guard of n bytes in a block that is only 8-byte aligned (a static
+  * stack array) costs up to n - 8 bytes of padding below it as a whole
+  * region. With subregions the guard only has to start on a subregion
+  * boundary: 128 bytes as four 32-byte subregions of a 256-byte region
+  * start on any 32-byte boundary that leaves them inside one 256-byte block.
+  * MPU_REGION_Fit() tries the whole region and every region size whose
+  * subregions are no larger than it, and keeps the lowest start.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "mpu_region.h"
+#include <stddef.h>
+
+/* Private define ------------------------------------------------------------*/
+#define MPU_REGION_MIN_LOG2     5U
+#define MPU_REGION_SUB_LOG2     8U
+#define MPU_REGION_MAX_LOG2     32U
+
+/** Memory attributes: flash-like for the NULL guard (the boot alias of the
+    flash), SRAM (write-back, write-allocate) for stack guards */
+#define MPU_REGION_ATTR_FLASH   (MPU_REGION_RASR_TEX(0U) | MPU_REGION_RASR_C)
+#define MPU_REGION_ATTR_SRAM    (MPU_REGION_RASR_TEX(1U) | MPU_REGION_RASR_C | MPU_REGION_RASR_B)
+
+/* Private function prototypes -----------------------------------------------*/
+static uint64_t MPU_REGION_AlignUp(uint64_t value, uint64_t align);
+static void     MPU_REGION_Try(uint64_t start, uint64_t end, uint32_t size, uint32_t log2,
+                               uint32_t sub_log2, MPU_REGION_FitTypeDef *best, uint8_t *found);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Place a guard as low as possible in a block of memory.
+  * @param  start: First byte of the block
+  * @param  end: One past its last byte, 0 for the top of the address space
+  * @param  size: Guard size in bytes, a multiple of 32
+  * @param  fit: Receives the placement
+  * @retval MPU_REGION_INVALID for a bad size, MPU_REGION_NO_FIT if no
+  *         placement lies inside the block
+  */
+MPU_REGION_StatusTypeDef MPU_REGION_Fit(uint32_t start, uint32_t end, uint32_t size,
+                                        MPU_REGION_FitTypeDef *fit)
+{
+  uint64_t top = (end == 0U) ? (1ULL << 32) : end;
+  uint32_t log2 = MPU_REGION_MIN_LOG2;
+  uint32_t r;
+  uint8_t found = 0U;
+
+  if ((size == 0U) || ((size % MPU_REGION_MIN_SIZE) != 0U))
+  {
+    return MPU_REGION_INVALID;
+  }
+  while ((1ULL << log2) < size)
+  {
+    log2++;
+  }
+
+  /* A whole region, then regions whose subregions are at most that size */
+  MPU_REGION_Try(start, top, size, log2, log2, fit, &found);
+  for (r = MPU_REGION_SUB_LOG2; ((r - 3U) <= log2) && (r <= MPU_REGION_MAX_LOG2); r++)
+  {
+    MPU_REGION_Try(start, top, size, r, r - 3U, fit, &found);
+  }
+  return (found != 0U) ? MPU_REGION_OK : MPU_REGION_NO_FIT;
+}
+
+/**
+  * @brief  Empty a table.
+  * @param  table: Region table
+  * @retval None
+  */
+void MPU_REGION_Init(MPU_REGION_TableTypeDef *table)
+{
+  table->Count = 0U;
+}
+
+/**
+  * @brief  Add a guard in [start, end) as the next region.
+  * @param  table: Region table
+  * @param  name: What it guards, reported on a fault; must outlive the table
+  * @param  kind: MPU_REGION_NULL or MPU_REGION_STACK
+  * @param  start: First byte it may cover
+  * @param  end: One past the last byte it may cover
+  * @param  size: Guard size in bytes, a multiple of 32
+  * @retval MPU_REGION_OK, or why it was not added
+  */
+MPU_REGION_StatusTypeDef MPU_REGION_Add(MPU_REGION_TableTypeDef *table, const char *name,
+                                        MPU_REGION_KindTypeDef kind, uint32_t start, uint32_t end,
+                                        uint32_t size)
+{
+  MPU_REGION_EntryTypeDef *entry;
+  MPU_REGION_FitTypeDef fit;
+  MPU_REGION_StatusTypeDef status;
+  uint32_t i;
+
+  if (table->Count >= MPU_REGION_COUNT)
+  {
+    return MPU_REGION_FULL;
+  }
+  status = MPU_REGION_Fit(start, end, size, &fit);
+  if (status != MPU_REGION_OK)
+  {
+    return status;
+  }
+  for (i = 0U; i < table->Count; i++)
+  {
+    if ((fit.Start < table->Entries[i].End) && (table->Entries[i].Start < fit.End))
+    {
+      return MPU_REGION_OVERLAP;
+    }
+  }
+
+  entry = &table->Entries[table->Count];
+  entry->Name  = name;
+  entry->Kind  = (uint8_t)kind;
+  entry->Start = fit.Start;
+  entry->End   = fit.End;
+  entry->Rbar  = fit.Base | MPU_REGION_RBAR_VALID | table->Count;
+  entry->Rasr  = MPU_REGION_RASR_XN | MPU_REGION_RASR_SRD(fit.Disabled) |
+                 MPU_REGION_RASR_SIZE(fit.SizeLog2) | MPU_REGION_RASR_ENABLE;
+  if (kind == MPU_REGION_NULL)
+  {
+    entry->Rasr |= MPU_REGION_RASR_AP(MPU_REGION_AP_NONE) | MPU_REGION_ATTR_FLASH;
+  }
+  else
+  {
+    entry->Rasr |= MPU_REGION_RASR_AP(MPU_REGION_AP_RO) | MPU_REGION_ATTR_SRAM;
+  }
+  table->Count++;
+  return MPU_REGION_OK;
+}
+
+/**
+  * @brief  Guard a faulting address belongs to. A stack guard also claims
+  *         the MPU_REGION_FRAME_MAX bytes below it, where SP ends up after
+  *         a failed exception stacking.
+  * @param  table: Region table
+  * @param  address: MMFAR, or the stack pointer of a stacking fault
+  * @retval Entry, NULL if the address is not near a guard
+  */
+const MPU_REGION_EntryTypeDef *MPU_REGION_Find(const MPU_REGION_TableTypeDef *table, uint32_t address)
+{
+  const MPU_REGION_EntryTypeDef *entry;
+  uint32_t low;
+  uint32_t i;
+
+  for (i = 0U; i < table->Count; i++)
+  {
+    entry = &table->Entries[i];
+    if ((address >= entry->Start) && ((address - entry->Start) < (entry->End - entry->Start)))
+    {
+      return entry;
+    }
+  }
+  for (i = 0U; i < table->Count; i++)
+  {
+    entry = &table->Entries[i];
+    low = (entry->Start > MPU_REGION_FRAME_MAX) ? (entry->Start - MPU_REGION_FRAME_MAX) : 0U;
+    if ((entry->Kind == MPU_REGION_STACK) && (address >= low) && (address < entry->Start))
+    {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Round up to a power of two.
+  * @retval value rounded up to a multiple of align
+  */
+static uint64_t MPU_REGION_AlignUp(uint64_t value, uint64_t align)
+{
+  return (value + align - 1U) & ~(align - 1U);
+}
+
+/**
+  * @brief  Place the guard on the first subregion boundary of a region size
+  *         and keep it if it starts lower, or as low and covers less, than
+  *         the best so far.
+  * @param  start: Block start
+  * @param  end: Block end
+  * @param  size: Guard size
+  * @param  log2: Region size
+  * @param  sub_log2: Subregion size, log2 for a whole region
+  * @param  best: Best placement so far
+  * @param  found: Set once best holds one
+  * @retval None
+  */
+static void MPU_REGION_Try(uint64_t start, uint64_t end, uint32_t size, uint32_t log2,
+                           uint32_t sub_log2, MPU_REGION_FitTypeDef *best, uint8_t *found)
+{
+  uint64_t sub = 1ULL << sub_log2;
+  uint64_t first = MPU_REGION_AlignUp(start, sub);
+  uint64_t count = MPU_REGION_AlignUp(size, sub) >> sub_log2;
+  uint64_t offset = (first & ((1ULL << log2) - 1U)) >> sub_log2;
+  uint64_t last = first + (count << sub_log2);
+
+  if ((offset + count > (1ULL << (log2 - sub_log2))) || (last > end))
+  {
+    return;
+  }
+  if ((*found != 0U) &&
+      ((first > best->Start) || ((first == best->Start) && ((last - first) >= (uint64_t)(best->End - best->Start)))))
+  {
+    return;
+  }
+  best->Base     = (uint32_t)(first & ~((1ULL << log2) - 1U));
+  best->SizeLog2 = (uint8_t)log2;
+  best->Disabled = (log2 == sub_log2) ? 0U : (uint8_t)(0xFFU & ~(((1U << count) - 1U) << offset));
+  best->Start    = (uint32_t)first;
+  best->End      = (uint32_t)last;
+  *found = 1U;
+}
@@ -0,0 +1,123 @@
+/**
+  ******************************************************************************
+  * @file    pin_bench.c
+  * @brief   Toggle rate of an LED pin through the HAL and through pin.h.
+  ******************************************************************************
+  * Toggles the blue LED (PD15) PIN_BENCH_TOGGLES times with each method,
+  * eight per loop pass, with interrupts masked, and prints cycles per toggle
+  * and toggles per second at the current core clock. PD15 is on TIM4 by
+  * then (led_engine.c), so the pin itself does not move: only the register
+  * writes are timed, which is what the rates compare.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "pin_bench.h"
+#include "board.h"
+#include "dwt.h"
+#include <stdio.h>
+
+/* Private define ------------------------------------------------------------*/
+#define PIN_BENCH_LINE_MAX    78U
+
+#define PIN_BENCH_X8(op)      do { op; op; op; op; op; op; op; op; } while (0)
+
+/* Private types -------------------------------------------------------------*/
+typedef void (*PIN_BENCH_FnTypeDef)(void);
+
+/* Private function prototypes -----------------------------------------------*/
+static void PIN_BENCH_Hal(void);
+static void PIN_BENCH_Toggle(void);
+static void PIN_BENCH_SetReset(void);
+
+/* Private functions ---------------------------------------------------------*/
+
+/* HAL_GPIO_TogglePin(): runtime port and mask, a call per toggle */
+static void PIN_BENCH_Hal(void)
+{
+  uint32_t i;
+
+  for (i = 0U; i < PIN_BENCH_TOGGLES; i += 8U)
+  {
+    PIN_BENCH_X8(HAL_GPIO_TogglePin(GPIOD, GPIO_PIN_15));
+  }
+}
+
+/* LED_BLUE_Toggle(): load and store on the ODR bit-band alias */
+static void PIN_BENCH_Toggle(void)
+{
+  uint32_t i;
+
+  for (i = 0U; i < PIN_BENCH_TOGGLES; i += 8U)
+  {
+    PIN_BENCH_X8(LED_BLUE_Toggle());
+  }
+}
+
+/* LED_BLUE_Set()/Reset(): one constant BSRR store per edge */
+static void PIN_BENCH_SetReset(void)
+{
+  uint32_t i;
+
+  for (i = 0U; i < PIN_BENCH_TOGGLES; i += 8U)
+  {
+    LED_BLUE_Set();
+    LED_BLUE_Reset();
+    LED_BLUE_Set();
+    LED_BLUE_Reset();
+    LED_BLUE_Set();
+    LED_BLUE_Reset();
+    LED_BLUE_Set();
+    LED_BLUE_Reset();
+  }
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Time each toggle method and print the rates.
+  * @param  huart: Initialised UART handle
+  * @retval None
+  */
+void PIN_BENCH_Run(UART_HandleTypeDef *huart)
+{
+  static const struct
+  {
+    const char *Name;
+    PIN_BENCH_FnTypeDef Fn;
+  } Methods[] =
+  {
+    { "hal",       PIN_BENCH_Hal },
+    { "toggle",    PIN_BENCH_Toggle },
+    { "set/reset", PIN_BENCH_SetReset },
+  };
+  char line[PIN_BENCH_LINE_MAX + 2U];
+  uint32_t primask;
+  uint32_t start;
+  uint32_t cycles;
+  uint32_t on;
+  uint32_t i;
+  int n;
+
+  DWT_Init();
+  on = LED_BLUE_Read();
+  for (i = 0U; i < (sizeof(Methods) / sizeof(Methods[0])); i++)
+  {
+    primask = __get_PRIMASK();
+    __disable_irq();
+    start = DWT_Cycles();
+    Methods[i].Fn();
+    cycles = DWT_Cycles() - start;
+    __set_PRIMASK(primask);
+
+    n = snprintf(line, PIN_BENCH_LINE_MAX, "gpio: %-9s %3lu.%02lu cycles/toggle %6lu ktoggles/s",
+                 Methods[i].Name, (unsigned long)(cycles / PIN_BENCH_TOGGLES),
+                 (unsigned long)(((cycles % PIN_BENCH_TOGGLES) * 100U) / PIN_BENCH_TOGGLES),
+                 (unsigned long)(((uint64_t)SystemCoreClock * PIN_BENCH_TOGGLES / cycles) / 1000U));
+    n = (n < 0) ? 0 : ((n >= (int)PIN_BENCH_LINE_MAX) ? (int)PIN_BENCH_LINE_MAX - 1 : n);
+    line[n++] = '\r';
+    line[n++] = '\n';
+    (void)HAL_UART_Transmit(huart, (uint8_t *)line, (uint16_t)n, HAL_MAX_DELAY);
+  }
+  LED_BLUE_Write(on);
+}
@@ -0,0 +1,223 @@
+/**
+  ******************************************************************************
+  * @file    placement_bench.c
+  * @brief   Cycle cost of the DSP and audio ISR paths under each placement.
+  ******************************************************************************
+  * The same FIR block is built three times: in plain .text, in the hot block
+  * and in SRAM, so one image compares all three for a DSP loop. The mixer
+  * render the audio DMA interrupt runs is timed where CODE_PLACEMENT put it;
+  * rebuild with "make CODE_PLACEMENT=n" to compare layouts.
+  *
+  * Each routine runs once right after the ART instruction and data caches
+  * were flushed (cold: what an ISR pays after other code evicted it), then
+  * PLACEMENT_BENCH_RUNS times back to back (warm). Interrupts are masked
+  * while timing; the mixer is a private instance, not the one on the DMA.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "placement_bench.h"
+#include "placement.h"
+#include "audio_mixer.h"
+#include "audio_stream.h"
+#include "dwt.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+/* Private define ------------------------------------------------------------*/
+#define PLACEMENT_BENCH_TAPS      16U
+#define PLACEMENT_BENCH_SAMPLES   256U
+#define PLACEMENT_BENCH_CLIP      1024U     /* Frames of the synthetic clip */
+#define PLACEMENT_BENCH_CLIP_HZ   44100U
+#define PLACEMENT_BENCH_OUT_HZ    48000U
+#define PLACEMENT_BENCH_LINE_MAX  78U
+
+/* Private types -------------------------------------------------------------*/
+typedef void (*PLACEMENT_BENCH_FnTypeDef)(void);
+
+/* Private variables ---------------------------------------------------------*/
+/* Linker script: hot block in flash, code copied to SRAM */
+extern const uint8_t _shot[];
+extern const uint8_t _ehot[];
+extern const uint8_t _sramfunc[];
+extern const uint8_t _eramfunc[];
+
+static int16_t BenchTaps[PLACEMENT_BENCH_TAPS];
+static int16_t BenchIn[PLACEMENT_BENCH_SAMPLES + PLACEMENT_BENCH_TAPS];
+static int16_t BenchOut[2U * AUDIO_STREAM_HALF_FRAMES];
+static int16_t BenchClip[PLACEMENT_BENCH_CLIP];
+static AUDIO_SourceTypeDef BenchSource;
+static AUDIO_MixerTypeDef  BenchMixer;
+
+/* Private function prototypes -----------------------------------------------*/
+static void PLACEMENT_BENCH_FirText(void);
+static void PLACEMENT_BENCH_FirHot(void);
+static void PLACEMENT_BENCH_FirRam(void);
+static void PLACEMENT_BENCH_Render(void);
+static void PLACEMENT_BENCH_Time(PLACEMENT_BENCH_FnTypeDef fn, PLACEMENT_BENCH_ResultTypeDef *result);
+static void PLACEMENT_BENCH_Print(UART_HandleTypeDef *huart, const char *format, ...);
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Q15 FIR over the bench buffers, inlined into each placement.
+  * @retval None
+  */
+static inline __attribute__((always_inline)) void PLACEMENT_BENCH_Fir(void)
+{
+  uint32_t n;
+  uint32_t k;
+
+  for (n = 0U; n < PLACEMENT_BENCH_SAMPLES; n++)
+  {
+    int32_t acc = 0;
+
+    for (k = 0U; k < PLACEMENT_BENCH_TAPS; k++)
+    {
+      acc += (int32_t)BenchTaps[k] * BenchIn[n + k];
+    }
+    BenchOut[n] = (int16_t)(acc >> 15);
+  }
+}
+
+/* The FIR block in plain .text, the hot block and SRAM. noipa keeps the
+   three identical bodies from being folded into one. */
+static __attribute__((noipa)) void PLACEMENT_BENCH_FirText(void)
+{
+  PLACEMENT_BENCH_Fir();
+}
+
+static __attribute__((noipa, hot)) void PLACEMENT_BENCH_FirHot(void)
+{
+  PLACEMENT_BENCH_Fir();
+}
+
+static __attribute__((noipa, long_call, section(".RamFunc"))) void PLACEMENT_BENCH_FirRam(void)
+{
+  PLACEMENT_BENCH_Fir();
+}
+
+/**
+  * @brief  One half buffer of the audio interrupt: two resampled voices.
+  * @retval None
+  */
+static void PLACEMENT_BENCH_Render(void)
+{
+  AUDIO_Mixer_Render(&BenchMixer, BenchOut, AUDIO_STREAM_HALF_FRAMES);
+}
+
+/**
+  * @brief  Time a routine cold, then warm, with interrupts masked.
+  * @param  fn: Routine
+  * @param  result: Cycles
+  * @retval None
+  */
+static void PLACEMENT_BENCH_Time(PLACEMENT_BENCH_FnTypeDef fn, PLACEMENT_BENCH_ResultTypeDef *result)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t start;
+  uint32_t cycles;
+  uint32_t i;
+
+  __disable_irq();
+  __HAL_FLASH_INSTRUCTION_CACHE_DISABLE();
+  __HAL_FLASH_DATA_CACHE_DISABLE();
+  __HAL_FLASH_INSTRUCTION_CACHE_RESET();
+  __HAL_FLASH_DATA_CACHE_RESET();
+  __HAL_FLASH_INSTRUCTION_CACHE_ENABLE();
+  __HAL_FLASH_DATA_CACHE_ENABLE();
+
+  start = DWT_Cycles();
+  fn();
+  result->Cold = DWT_Cycles() - start;
+
+  result->Warm = 0xFFFFFFFFU;
+  for (i = 0U; i < PLACEMENT_BENCH_RUNS; i++)
+  {
+    start = DWT_Cycles();
+    fn();
+    cycles = DWT_Cycles() - start;
+    if (cycles < result->Warm)
+    {
+      result->Warm = cycles;
+    }
+  }
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Print one line on the UART, truncated to PLACEMENT_BENCH_LINE_MAX.
+  * @param  huart: Initialised UART handle
+  * @param  format: printf format
+  * @retval None
+  */
+static void PLACEMENT_BENCH_Print(UART_HandleTypeDef *huart, const char *format, ...)
+{
+  char line[PLACEMENT_BENCH_LINE_MAX + 2U];
+  va_list args;
+  int n;
+
+  va_start(args, format);
+  n = vsnprintf(line, PLACEMENT_BENCH_LINE_MAX, format, args);
+  va_end(args);
+  n = (n < 0) ? 0 : ((n >= (int)PLACEMENT_BENCH_LINE_MAX) ? (int)PLACEMENT_BENCH_LINE_MAX - 1 : n);
+  line[n++] = '\r';
+  line[n++] = '\n';
+  (void)HAL_UART_Transmit(huart, (uint8_t *)line, (uint16_t)n, HAL_MAX_DELAY);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Time the FIR block in each placement and the mixer render in the
+  *         one this image was built with, and print the results.
+  * @param  huart: Initialised UART handle
+  * @retval None
+  */
+void PLACEMENT_BENCH_Run(UART_HandleTypeDef *huart)
+{
+  static const struct
+  {
+    const char *Name;
+    PLACEMENT_BENCH_FnTypeDef Fn;
+  } Routines[] =
+  {
+    { "fir text", PLACEMENT_BENCH_FirText },
+    { "fir hot",  PLACEMENT_BENCH_FirHot },
+    { "fir sram", PLACEMENT_BENCH_FirRam },
+    { "render",   PLACEMENT_BENCH_Render },
+  };
+  PLACEMENT_BENCH_ResultTypeDef result;
+  uint32_t i;
+
+  DWT_Init();
+  for (i = 0U; i < PLACEMENT_BENCH_TAPS; i++)
+  {
+    BenchTaps[i] = (int16_t)(32768U / PLACEMENT_BENCH_TAPS);
+  }
+  for (i = 0U; i < (PLACEMENT_BENCH_SAMPLES + PLACEMENT_BENCH_TAPS); i++)
+  {
+    BenchIn[i] = (int16_t)((i * 2654435761U) >> 16);
+  }
+  for (i = 0U; i < PLACEMENT_BENCH_CLIP; i++)
+  {
+    BenchClip[i] = (int16_t)((i & 0xFFU) << 7);
+  }
+  BenchSource.Samples    = BenchClip;
+  BenchSource.Frames     = PLACEMENT_BENCH_CLIP;
+  BenchSource.SampleRate = PLACEMENT_BENCH_CLIP_HZ;
+  BenchSource.Channels   = 1U;
+  AUDIO_Mixer_Init(&BenchMixer, PLACEMENT_BENCH_OUT_HZ);
+  (void)AUDIO_Mixer_Play(&BenchMixer, &BenchSource, AUDIO_GAIN_UNITY / 2, 1U);
+  (void)AUDIO_Mixer_Play(&BenchMixer, &BenchSource, AUDIO_GAIN_UNITY / 2, 1U);
+
+  PLACEMENT_BENCH_Print(huart, "code: placement %d, %lu MHz, hot %lu bytes, sram %lu bytes",
+                        CODE_PLACEMENT, (unsigned long)(SystemCoreClock / 1000000U),
+                        (unsigned long)(_ehot - _shot), (unsigned long)(_eramfunc - _sramfunc));
+  for (i = 0U; i < (sizeof(Routines) / sizeof(Routines[0])); i++)
+  {
+    PLACEMENT_BENCH_Time(Routines[i].Fn, &result);
+    PLACEMENT_BENCH_Print(huart, "code: %-8s cold %6lu warm %6lu cycles", Routines[i].Name,
+                          (unsigned long)result.Cold, (unsigned long)result.Warm);
+  }
+}
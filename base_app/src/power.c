@@ -0,0 +1,439 @@
+/**
+  ******************************************************************************
+  * @file    power.c
+  * @brief   Operating point switching, peripheral re-timing and governor.
+  ******************************************************************************
+  * A switch runs the DVFS_Plan() steps on the RCC, then re-times every
+  * peripheral that was added: USART BRR from the new PCLK and timer
+  * prescalers from the new timer clock. HAL_RCC_ClockConfig() raises the
+  * flash latency before and lowers it after the clocks, and reloads SysTick
+  * through HAL_InitTick(); POWER_Init() checks that reload is exact at every
+  * point. The I2S clock comes from PLLI2S and is not touched.
+  *
+  * The governor task samples kernel ticks against idle ticks every
+  * POWER_WINDOW_MS. Drivers veto a switch from their DVFS_EV_PRE callback
+  * while a transfer is in flight; the governor just tries again next window.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "power.h"
+#include "clock_config.h"
+#include "kernel_port.h"
+#include "dwt.h"
+#include "trace_recorder.h"
+#include <stdio.h>
+
+/* Private define ------------------------------------------------------------*/
+#define POWER_DRAIN_MS      5U
+#define POWER_LINE_MAX      78U
+#define POWER_BENCH_WORDS   4096U       /*!< Workload: 16 KB of flash reads   */
+
+/** Operating point on the PLL of clock_config.h, with an AHB prescaler */
+#define POWER_PLL_POINT(name, ahb)                                            \
+  {                                                                           \
+    name, CLOCK_CONFIG_SYSCLK_HZ, (ahb), 1U,                                  \
+    CLOCK_APB_DIV(CLOCK_CONFIG_SYSCLK_HZ / (ahb), CLOCK_PCLK1_MAX),           \
+    CLOCK_APB_DIV(CLOCK_CONFIG_SYSCLK_HZ / (ahb), CLOCK_PCLK2_MAX),           \
+    CLOCK_FLASH_LATENCY(CLOCK_CONFIG_SYSCLK_HZ / (ahb)), 1U                   \
+  }
+
+/* Private variables ---------------------------------------------------------*/
+DVFS_HandleTypeDef hdvfs;
+
+static const DVFS_PointTypeDef PowerPoints[POWER_POINTS] =
+{
+  POWER_PLL_POINT("full", 1U),
+  POWER_PLL_POINT("half", 2U),
+  POWER_PLL_POINT("quarter", 4U),
+  { "hsi", HSI_VALUE, 1U, 0U, 1U, 1U, CLOCK_FLASH_LATENCY(HSI_VALUE), 2U }
+};
+
+static UART_HandleTypeDef *PowerUarts[POWER_MAX_UARTS];
+static uint32_t            PowerUartCount;
+static TIM_HandleTypeDef  *PowerTimers[POWER_MAX_TIMERS];
+static uint32_t            PowerTimerRates[POWER_MAX_TIMERS];
+static uint32_t            PowerTimerCount;
+
+static KERNEL_MutexTypeDef  PowerLock;
+static DVFS_GovernorTypeDef PowerGovernor;
+static volatile uint8_t     PowerPinned;
+static KERNEL_TaskTypeDef   PowerTask;
+static uint64_t             PowerStack[POWER_TASK_WORDS / 2U];
+
+/* Private function prototypes -----------------------------------------------*/
+static void     POWER_Task(void *argument);
+static uint32_t POWER_TimerApb(const TIM_HandleTypeDef *htim);
+static uint32_t POWER_AhbReg(uint32_t div);
+static HAL_StatusTypeDef POWER_Step(DVFS_StepTypeDef step, const DVFS_PointTypeDef *point);
+static void     POWER_Retime(const DVFS_PointTypeDef *point);
+static uint8_t  POWER_UartsIdle(void);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Load the operating points, the clocks being in the first one
+  *         (SystemClock_Config()), and create the governor task. Call after
+  *         KERNEL_PORT_Init().
+  * @retval None
+  */
+void POWER_Init(void)
+{
+  uint32_t reload;
+  uint32_t i;
+
+  if (DVFS_Init(&hdvfs, PowerPoints, POWER_POINTS, POWER_POINT_FULL) != DVFS_OK)
+  {
+    Error_Handler();
+  }
+  for (i = 0U; i < POWER_POINTS; i++)
+  {
+    if (DVFS_SysTickReload(DVFS_Hclk(&PowerPoints[i]), 1000U / (uint32_t)HAL_GetTickFreq(), &reload) != DVFS_OK)
+    {
+      Error_Handler();
+    }
+  }
+
+  KERNEL_MutexInit(&PowerLock);
+  DVFS_GovernorInit(&PowerGovernor, POWER_UP_PERMILLE, POWER_DOWN_PERMILLE, POWER_FLOOR);
+  if (KERNEL_TaskCreate(&PowerTask, "power", POWER_Task, NULL, POWER_TASK_PRIORITY,
+                        (uint32_t *)PowerStack, POWER_TASK_WORDS) != KERNEL_OK)
+  {
+    Error_Handler();
+  }
+}
+
+/**
+  * @brief  Keep a UART at its baud rate across switches.
+  * @param  huart: Initialised UART handle, 16x oversampling
+  * @retval HAL_ERROR if some point cannot reach the baud rate closely enough
+  */
+HAL_StatusTypeDef POWER_AddUart(UART_HandleTypeDef *huart)
+{
+  uint32_t apb = ((huart->Instance == USART1) || (huart->Instance == USART6)) ? 2U : 1U;
+  uint32_t i;
+
+  if ((PowerUartCount >= POWER_MAX_UARTS) || (huart->Init.OverSampling != UART_OVERSAMPLING_16))
+  {
+    return HAL_ERROR;
+  }
+  for (i = 0U; i < POWER_POINTS; i++)
+  {
+    if (CLOCK_UART_ERROR_PPM(DVFS_Pclk(&PowerPoints[i], apb), huart->Init.BaudRate) > POWER_UART_ERROR_PPM)
+    {
+      return HAL_ERROR;
+    }
+  }
+  PowerUarts[PowerUartCount++] = huart;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Run a timer counter at a fixed rate at every point. The prescaler
+  *         is set now.
+  * @param  htim: Initialised timer handle
+  * @param  tick_hz: Counter rate
+  * @retval HAL_ERROR if some point cannot divide down to the rate exactly
+  */
+HAL_StatusTypeDef POWER_AddTimer(TIM_HandleTypeDef *htim, uint32_t tick_hz)
+{
+  uint32_t apb = POWER_TimerApb(htim);
+  uint32_t psc;
+  uint32_t i;
+
+  if (PowerTimerCount >= POWER_MAX_TIMERS)
+  {
+    return HAL_ERROR;
+  }
+  for (i = 0U; i < POWER_POINTS; i++)
+  {
+    if (DVFS_TimerPrescaler(DVFS_TimerClock(&PowerPoints[i], apb), tick_hz, &psc) != DVFS_OK)
+    {
+      return HAL_ERROR;
+    }
+  }
+  PowerTimers[PowerTimerCount]     = htim;
+  PowerTimerRates[PowerTimerCount] = tick_hz;
+  PowerTimerCount++;
+  POWER_Retime(&hdvfs.Points[hdvfs.Current]);
+  return HAL_OK;
+}
+
+/**
+  * @brief  Add a driver to be told about every switch.
+  * @param  callback: Called with DVFS_EV_PRE (may veto) and DVFS_EV_POST
+  * @param  context: Passed to the callback
+  * @retval DVFS_FULL with DVFS_MAX_NOTIFIERS drivers
+  */
+DVFS_StatusTypeDef POWER_Register(DVFS_CallbackTypeDef callback, void *context)
+{
+  return DVFS_Register(&hdvfs, callback, context);
+}
+
+/**
+  * @brief  Switch to an operating point. Call from a task.
+  * @param  index: POWER_POINT_x
+  * @retval DVFS_BUSY if a UART is transmitting or a driver vetoed
+  */
+DVFS_StatusTypeDef POWER_SetPoint(uint32_t index)
+{
+  DVFS_StepTypeDef steps[DVFS_MAX_STEPS];
+  const DVFS_PointTypeDef *from;
+  DVFS_StatusTypeDef status;
+  uint32_t count;
+  uint32_t i;
+
+  if (index >= hdvfs.Count)
+  {
+    return DVFS_INVALID;
+  }
+  (void)KERNEL_MutexLock(&PowerLock, KERNEL_FOREVER);
+  if (index == hdvfs.Current)
+  {
+    (void)KERNEL_MutexUnlock(&PowerLock);
+    return DVFS_OK;
+  }
+  if (POWER_UartsIdle() == 0U)
+  {
+    (void)KERNEL_MutexUnlock(&PowerLock);
+    return DVFS_BUSY;
+  }
+  status = DVFS_Notify(&hdvfs, DVFS_EV_PRE, index);
+  if (status != DVFS_OK)
+  {
+    (void)KERNEL_MutexUnlock(&PowerLock);
+    return status;
+  }
+
+  from  = &hdvfs.Points[hdvfs.Current];
+  count = DVFS_Plan(from, &hdvfs.Points[index], steps);
+  for (i = 0U; i < count; i++)
+  {
+    if (POWER_Step(steps[i], &hdvfs.Points[index]) != HAL_OK)
+    {
+      Error_Handler();
+    }
+  }
+  POWER_Retime(&hdvfs.Points[index]);
+  (void)DVFS_Notify(&hdvfs, DVFS_EV_POST, index);
+  (void)KERNEL_MutexUnlock(&PowerLock);
+  return DVFS_OK;
+}
+
+/**
+  * @brief  Power/performance benchmark: at every point, time a fixed
+  *         workload, then hold the point busy and then idle for
+  *         POWER_BENCH_HOLD_MS each so the current can be read on the IDD
+  *         jumper (JP1). The governor is held off meanwhile. Call from a task.
+  * @param  huart: Initialised UART handle for the report
+  * @retval None
+  */
+void POWER_Bench(UART_HandleTypeDef *huart)
+{
+  const volatile uint32_t *flash = (const volatile uint32_t *)FLASH_BASE;
+  char line[POWER_LINE_MAX + 2U];
+  uint32_t index;
+  uint32_t start;
+  uint32_t cycles;
+  uint32_t hash;
+  uint32_t i;
+  int n;
+
+  DWT_Init();
+  PowerPinned = 1U;
+  for (index = 0U; index < hdvfs.Count; index++)
+  {
+    while (POWER_SetPoint(index) == DVFS_BUSY)
+    {
+      KERNEL_Sleep(1U);
+    }
+
+    hash  = 2166136261U;
+    start = DWT_Cycles();
+    for (i = 0U; i < POWER_BENCH_WORDS; i++)
+    {
+      hash = (hash ^ flash[i]) * 16777619U;
+    }
+    cycles = DWT_Cycles() - start;
+
+    n = snprintf(line, POWER_LINE_MAX, "power: %-7s %3lu MHz %2u WS %7lu cycles %6lu us (%08lX)",
+                 hdvfs.Points[index].Name, (unsigned long)(SystemCoreClock / 1000000U),
+                 (unsigned)hdvfs.Points[index].FlashLatency, (unsigned long)cycles,
+                 (unsigned long)DWT_CyclesToUs(cycles), (unsigned long)hash);
+    n = (n < 0) ? 0 : ((n < (int)POWER_LINE_MAX) ? n : ((int)POWER_LINE_MAX - 1));
+    line[n++] = '\r';
+    line[n++] = '\n';
+    (void)HAL_UART_Transmit(huart, (uint8_t *)line, (uint16_t)n, HAL_MAX_DELAY);
+
+    start = HAL_GetTick();
+    while ((HAL_GetTick() - start) < POWER_BENCH_HOLD_MS)
+    {
+    }
+    KERNEL_Sleep(POWER_BENCH_HOLD_MS);
+  }
+  while (POWER_SetPoint(POWER_POINT_FULL) == DVFS_BUSY)
+  {
+    KERNEL_Sleep(1U);
+  }
+  PowerPinned = 0U;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Governor task: pick a point from the load of the last window.
+  * @param  argument: Not used
+  * @retval None
+  */
+static void POWER_Task(void *argument)
+{
+  uint32_t next;
+
+  (void)argument;
+  while (1)
+  {
+    KERNEL_Sleep(POWER_WINDOW_MS);
+    next = DVFS_GovernorUpdate(&PowerGovernor, hdvfs.Current, KERNEL_Ticks(), KERNEL_PORT_IdleTicks());
+    if ((PowerPinned == 0U) && (next != hdvfs.Current))
+    {
+      (void)POWER_SetPoint(next);
+    }
+  }
+}
+
+/**
+  * @brief  APB bus a timer sits on.
+  * @param  htim: Timer handle
+  * @retval 1 or 2
+  */
+static uint32_t POWER_TimerApb(const TIM_HandleTypeDef *htim)
+{
+  return ((htim->Instance == TIM1) || (htim->Instance == TIM8) || (htim->Instance == TIM9) ||
+          (htim->Instance == TIM10) || (htim->Instance == TIM11)) ? 2U : 1U;
+}
+
+/**
+  * @brief  RCC_SYSCLK_DIVx for an AHB prescaler.
+  * @param  div: Prescaler, validated by DVFS_Validate()
+  * @retval RCC_SYSCLK_DIVx
+  */
+static uint32_t POWER_AhbReg(uint32_t div)
+{
+  switch (div)
+  {
+    case 2U:   return RCC_SYSCLK_DIV2;
+    case 4U:   return RCC_SYSCLK_DIV4;
+    case 8U:   return RCC_SYSCLK_DIV8;
+    case 16U:  return RCC_SYSCLK_DIV16;
+    case 64U:  return RCC_SYSCLK_DIV64;
+    case 128U: return RCC_SYSCLK_DIV128;
+    case 256U: return RCC_SYSCLK_DIV256;
+    case 512U: return RCC_SYSCLK_DIV512;
+    default:   return RCC_SYSCLK_DIV1;
+  }
+}
+
+/**
+  * @brief  Run one step of a switch on the RCC and PWR.
+  * @param  step: Step from DVFS_Plan()
+  * @param  point: Target point
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef POWER_Step(DVFS_StepTypeDef step, const DVFS_PointTypeDef *point)
+{
+  RCC_OscInitTypeDef osc = CLOCK_CONFIG_OSC_INIT;
+  RCC_ClkInitTypeDef clk = CLOCK_CONFIG_CLK_INIT;
+  HAL_StatusTypeDef status;
+
+  switch (step)
+  {
+    case DVFS_STEP_SCALE_UP:
+      __HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE1);
+      return HAL_OK;
+
+    case DVFS_STEP_SCALE_DOWN:
+      __HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE2);
+      return HAL_OK;
+
+    case DVFS_STEP_PLL_ON:
+      return HAL_RCC_OscConfig(&osc);
+
+    case DVFS_STEP_PLL_OFF:
+      osc.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+      osc.PLL.PLLState   = RCC_PLL_OFF;
+      return HAL_RCC_OscConfig(&osc);
+
+    case DVFS_STEP_CLOCKS:
+      clk.SYSCLKSource   = (point->UsePll != 0U) ? RCC_SYSCLKSOURCE_PLLCLK : RCC_SYSCLKSOURCE_HSI;
+      clk.AHBCLKDivider  = POWER_AhbReg(point->AhbDiv);
+      clk.APB1CLKDivider = CLOCK_CONFIG_APB_REG((uint32_t)point->Apb1Div);
+      clk.APB2CLKDivider = CLOCK_CONFIG_APB_REG((uint32_t)point->Apb2Div);
+      status = HAL_RCC_ClockConfig(&clk, point->FlashLatency);
+      /* The cycle counter runs at the new HCLK from here */
+      TRACE_CLOCK(SystemCoreClock);
+      return status;
+
+    default:
+      return HAL_ERROR;
+  }
+}
+
+/**
+  * @brief  Re-derive the UART baud rate and timer prescalers for a point.
+  *         The prescaler is loaded by an update event with URS set, so no
+  *         update interrupt or DMA request is raised for it.
+  * @param  point: Point the clocks are in
+  * @retval None
+  */
+static void POWER_Retime(const DVFS_PointTypeDef *point)
+{
+  UART_HandleTypeDef *huart;
+  TIM_TypeDef *tim;
+  uint32_t apb;
+  uint32_t psc;
+  uint32_t i;
+
+  for (i = 0U; i < PowerUartCount; i++)
+  {
+    huart = PowerUarts[i];
+    apb = ((huart->Instance == USART1) || (huart->Instance == USART6)) ? 2U : 1U;
+    huart->Instance->BRR = DVFS_UartBrr(DVFS_Pclk(point, apb), huart->Init.BaudRate);
+  }
+  for (i = 0U; i < PowerTimerCount; i++)
+  {
+    tim = PowerTimers[i]->Instance;
+    if (DVFS_TimerPrescaler(DVFS_TimerClock(point, POWER_TimerApb(PowerTimers[i])),
+                            PowerTimerRates[i], &psc) == DVFS_OK)
+    {
+      tim->PSC  = psc;
+      tim->CR1 |= TIM_CR1_URS;
+      tim->EGR  = TIM_EGR_UG;
+      tim->CR1 &= ~TIM_CR1_URS;
+      PowerTimers[i]->Init.Prescaler = psc;
+    }
+  }
+}
+
+/**
+  * @brief  Wait for the last byte of every UART to leave the shift register.
+  * @retval 0 if a UART is still transmitting for the HAL
+  */
+static uint8_t POWER_UartsIdle(void)
+{
+  uint32_t start;
+  uint32_t i;
+
+  for (i = 0U; i < PowerUartCount; i++)
+  {
+    if (PowerUarts[i]->gState != HAL_UART_STATE_READY)
+    {
+      return 0U;
+    }
+    start = HAL_GetTick();
+    while ((__HAL_UART_GET_FLAG(PowerUarts[i], UART_FLAG_TC) == RESET) &&
+           ((HAL_GetTick() - start) < POWER_DRAIN_MS))
+    {
+    }
+  }
+  return 1U;
+}
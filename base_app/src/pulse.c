@@ -0,0 +1,260 @@
+/**
+  ******************************************************************************
+  * @file    pulse.c
+  * @brief   Frequency, period jitter and duty cycle from DMA-captured edge
+  *          timestamps, in batches.
+  ******************************************************************************
+  * The ring is read the way the ADC ring is, by position rather than by
+  * interrupt per record: the caller passes how many records the DMA has
+  * written in total and PULSE_Take() works through the new ones. Records
+  * within Guard of the DMA's write position count as lost, since the DMA
+  * may be writing them while they are read.
+  *
+  * Jitter is the RMS deviation of the period over the batch. The squares
+  * are summed as deviations from the batch's first period, which keeps them
+  * far from the 64-bit limit for any signal steady enough to be measured.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "pulse.h"
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Attach a circular record buffer the DMA has just started on.
+  * @param  ring: Ring instance
+  * @param  buffer: records * PULSE_RECORD_WORDS words
+  * @param  records: Ring length, a power of two
+  * @param  guard: Records kept clear of the write position, < records
+  * @param  max_period: Longest period taken as one, ticks; a longer gap
+  *         breaks the chain
+  * @retval None
+  */
+void PULSE_RingInit(PULSE_RingTypeDef *ring, const uint32_t *buffer, uint32_t records,
+                    uint32_t guard, uint32_t max_period)
+{
+  ring->Buffer    = buffer;
+  ring->Records   = records;
+  ring->Guard     = guard;
+  ring->MaxPeriod = max_period;
+  ring->Read      = 0U;
+  ring->LastRise  = 0U;
+  ring->HaveRise  = 0U;
+  ring->Lost      = 0U;
+  ring->Breaks    = 0U;
+}
+
+/**
+  * @brief  Add the periods of every record written since the last call to
+  *         a batch.
+  * @param  ring: Ring instance
+  * @param  batch: Batch to add to
+  * @param  written: Records the DMA has completed in total
+  * @retval Periods added
+  */
+uint32_t PULSE_Take(PULSE_RingTypeDef *ring, PULSE_BatchTypeDef *batch, uint32_t written)
+{
+  const uint32_t *record;
+  uint32_t keep = ring->Records - ring->Guard;
+  uint32_t avail = written - ring->Read;
+  uint32_t periods = 0U;
+  uint32_t period;
+  uint32_t high;
+
+  if (avail > keep)
+  {
+    /* The DMA lapped the reader: skip to the oldest record still whole */
+    ring->Lost    += avail - keep;
+    ring->Read     = written - keep;
+    ring->HaveRise = 0U;
+  }
+  while (ring->Read != written)
+  {
+    record = &ring->Buffer[(ring->Read & (ring->Records - 1U)) * PULSE_RECORD_WORDS];
+    if (ring->HaveRise != 0U)
+    {
+      period = record[1] - ring->LastRise;
+      if ((period == 0U) || (period > ring->MaxPeriod))
+      {
+        ring->Breaks++;
+      }
+      else
+      {
+        /* A fall from before the last rise is stale: no duty this period */
+        high = record[0] - ring->LastRise;
+        PULSE_BatchAdd(batch, period, (high < period) ? high : 0U);
+        periods++;
+      }
+    }
+    ring->LastRise = record[1];
+    ring->HaveRise = 1U;
+    ring->Read++;
+  }
+  return periods;
+}
+
+/**
+  * @brief  Drop everything up to the write position and start a new chain,
+  *         after the timer's count was disturbed.
+  * @param  ring: Ring instance
+  * @param  written: Records the DMA has completed in total
+  * @retval None
+  */
+void PULSE_Resync(PULSE_RingTypeDef *ring, uint32_t written)
+{
+  ring->Read     = written;
+  ring->HaveRise = 0U;
+}
+
+/**
+  * @brief  Time since the last rising edge taken.
+  * @param  ring: Ring instance
+  * @param  now: Current count of the capture timer
+  * @retval Ticks, 0xFFFFFFFF if there is no edge since init or a resync
+  */
+uint32_t PULSE_Idle(const PULSE_RingTypeDef *ring, uint32_t now)
+{
+  return (ring->HaveRise != 0U) ? (now - ring->LastRise) : 0xFFFFFFFFU;
+}
+
+/**
+  * @brief  Empty a batch.
+  * @param  batch: Batch
+  * @retval None
+  */
+void PULSE_BatchInit(PULSE_BatchTypeDef *batch)
+{
+  batch->Periods       = 0U;
+  batch->Min           = 0U;
+  batch->Max           = 0U;
+  batch->Sum           = 0U;
+  batch->Ref           = 0U;
+  batch->DevSum        = 0;
+  batch->DevSq         = 0U;
+  batch->Highs         = 0U;
+  batch->HighSum       = 0U;
+  batch->HighPeriodSum = 0U;
+}
+
+/**
+  * @brief  Add one period to a batch.
+  * @param  batch: Batch
+  * @param  period: Ticks, > 0
+  * @param  high: High time in ticks, 0 if no falling edge was seen
+  * @retval None
+  */
+void PULSE_BatchAdd(PULSE_BatchTypeDef *batch, uint32_t period, uint32_t high)
+{
+  int64_t dev;
+  uint64_t sq;
+
+  if (batch->Periods == 0U)
+  {
+    batch->Ref = period;
+    batch->Min = period;
+    batch->Max = period;
+  }
+  else if (period < batch->Min)
+  {
+    batch->Min = period;
+  }
+  else if (period > batch->Max)
+  {
+    batch->Max = period;
+  }
+  batch->Periods++;
+  batch->Sum += period;
+
+  dev = (int64_t)period - (int64_t)batch->Ref;
+  sq = (uint64_t)(dev * dev);
+  batch->DevSum += dev;
+  batch->DevSq = ((batch->DevSq + sq) < batch->DevSq) ? UINT64_MAX : (batch->DevSq + sq);
+
+  if (high != 0U)
+  {
+    batch->Highs++;
+    batch->HighSum += high;
+    batch->HighPeriodSum += period;
+  }
+}
+
+/**
+  * @brief  Reduce a batch to frequency, period spread and duty cycle.
+  * @param  batch: Batch, left unchanged
+  * @param  tick_hz: Capture timer count rate
+  * @param  result: Filled in; all zero for an empty batch
+  * @retval None
+  */
+void PULSE_Result(const PULSE_BatchTypeDef *batch, uint32_t tick_hz, PULSE_ResultTypeDef *result)
+{
+  uint64_t n = batch->Periods;
+  uint64_t num = (uint64_t)tick_hz * 1000U;
+  int64_t mean_dev;
+  uint64_t mean_sq;
+  uint64_t var;
+
+  result->Periods      = batch->Periods;
+  result->MilliHz      = 0U;
+  result->Mean         = 0U;
+  result->Min          = batch->Min;
+  result->Max          = batch->Max;
+  result->Jitter       = 0U;
+  result->DutyPermille = 0U;
+  if (n == 0U)
+  {
+    return;
+  }
+
+  result->Mean = (uint32_t)((batch->Sum + n / 2U) / n);
+  if (n <= (UINT64_MAX - batch->Sum / 2U) / num)
+  {
+    result->MilliHz = (uint32_t)((num * n + batch->Sum / 2U) / batch->Sum);
+  }
+  else
+  {
+    result->MilliHz = (uint32_t)((num + result->Mean / 2U) / result->Mean);
+  }
+
+  /* var = E[dev^2] - E[dev]^2 */
+  mean_dev = batch->DevSum / (int64_t)n;
+  mean_sq = (uint64_t)(mean_dev * mean_dev);
+  var = batch->DevSq / n;
+  result->Jitter = PULSE_Sqrt((var > mean_sq) ? (var - mean_sq) : 0U);
+
+  if (batch->HighPeriodSum != 0U)
+  {
+    result->DutyPermille = (uint16_t)((batch->HighSum * 1000U + batch->HighPeriodSum / 2U) /
+                                      batch->HighPeriodSum);
+  }
+}
+
+/**
+  * @brief  Integer square root.
+  * @param  value: Radicand
+  * @retval floor(sqrt(value))
+  */
+uint32_t PULSE_Sqrt(uint64_t value)
+{
+  uint64_t root = 0U;
+  uint64_t bit = 1ULL << 62;
+
+  while (bit > value)
+  {
+    bit >>= 2;
+  }
+  while (bit != 0U)
+  {
+    if (value >= root + bit)
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+    {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
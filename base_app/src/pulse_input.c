@@ -0,0 +1,279 @@
+/**
+  ******************************************************************************
+  * @file    pulse_input.c
+  * @brief   Tachometer / flow-sensor input: TIM5 input capture on PA1 with
+  *          DMA-captured timestamps, measured in batches.
+  ******************************************************************************
+  * Data path on the STM32F4-Discovery:
+  *
+  *   PA1 (TIM5_CH2, pulled up) -> TI2 -> IC2 rising  -> CCR2
+  *                                    -> IC1 falling -> CCR1
+  *   CC2 DMA request -> burst of CCR1, CCR2 through TIM5_DMAR
+  *     -> DMA1 Stream4 ch6, circular -> PulseRecords
+  *
+  * TIM5 is 32 bits and free-runs at PULSE_INPUT_TICK_HZ; it wraps every
+  * 36 minutes. Each rising edge stores {last fall, this rise} with no
+  * interrupt, so the edge rate is bounded by the DMA, not by the CPU. The
+  * stream's half-transfer and transfer-complete interrupts take the new
+  * records into the current batch (pulse.c); PULSE_INPUT_Measure() pends
+  * the same interrupt to take the rest, then closes the batch. All ring
+  * and batch state is therefore touched from that one interrupt.
+  *
+  * POWER_AddTimer() keeps the tick across a clock switch, but its update
+  * event restarts the count, so the records around a switch are dropped.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "pulse_input.h"
+#include "clock_config.h"
+#include "clock_tree.h"
+
+/* Private define ------------------------------------------------------------*/
+#define PULSE_INPUT_WORDS       (PULSE_INPUT_RECORDS * PULSE_RECORD_WORDS)
+#define PULSE_INPUT_MAX_PERIOD  (PULSE_INPUT_MAX_PERIOD_MS * (PULSE_INPUT_TICK_HZ / 1000U))
+
+_Static_assert((PULSE_INPUT_RECORDS & (PULSE_INPUT_RECORDS - 1U)) == 0U,
+               "PULSE_INPUT_RECORDS must be a power of two");
+
+/* Private variables ---------------------------------------------------------*/
+DMA_HandleTypeDef hdma_tim5_ch2;
+TIM_HandleTypeDef htim5;
+
+static uint32_t                PulseRecords[PULSE_INPUT_WORDS];
+static PULSE_RingTypeDef       PulseRing;
+static PULSE_BatchTypeDef      PulseBatch;
+static PULSE_ResultTypeDef     PulseResult;
+static uint8_t                 PulseStalled;
+static volatile uint32_t       PulseLaps;
+static volatile uint8_t        PulseSnap;
+static volatile uint8_t        PulseResync;
+static volatile uint32_t       PulseOvercaptures;
+static volatile uint32_t       PulseDmaErrors;
+
+/* Private function prototypes -----------------------------------------------*/
+static void     PULSE_INPUT_MspInit(void);
+static uint32_t PULSE_INPUT_Written(void);
+static void     PULSE_INPUT_HalfCplt(DMA_HandleTypeDef *hdma);
+static void     PULSE_INPUT_Cplt(DMA_HandleTypeDef *hdma);
+static void     PULSE_INPUT_Error(DMA_HandleTypeDef *hdma);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Configure PA1, TIM5 capture on both edges and the DMA ring, and
+  *         start capturing. Call before POWER_AddTimer(&htim5, ...).
+  * @retval HAL status
+  */
+HAL_StatusTypeDef PULSE_INPUT_Init(void)
+{
+  TIM_IC_InitTypeDef sConfigIC = {0};
+
+  PULSE_INPUT_MspInit();
+
+  htim5.Instance = TIM5;
+  htim5.Init.Prescaler = CLOCK_TIM_PSC(CLOCK_CONFIG_TIM_APB1_HZ, PULSE_INPUT_TICK_HZ);
+  htim5.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim5.Init.Period = 0xFFFFFFFFU;
+  htim5.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim5.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  if (HAL_TIM_IC_Init(&htim5) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  /* Both captures watch TI2: IC2 directly on the rise, IC1 on the fall */
+  sConfigIC.ICPolarity = TIM_INPUTCHANNELPOLARITY_RISING;
+  sConfigIC.ICSelection = TIM_ICSELECTION_DIRECTTI;
+  sConfigIC.ICPrescaler = TIM_ICPSC_DIV1;
+  sConfigIC.ICFilter = PULSE_INPUT_FILTER;
+  if (HAL_TIM_IC_ConfigChannel(&htim5, &sConfigIC, TIM_CHANNEL_2) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  sConfigIC.ICPolarity = TIM_INPUTCHANNELPOLARITY_FALLING;
+  sConfigIC.ICSelection = TIM_ICSELECTION_INDIRECTTI;
+  if (HAL_TIM_IC_ConfigChannel(&htim5, &sConfigIC, TIM_CHANNEL_1) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  /* DMA1 Stream4 channel 6 is TIM5_CH2 */
+  hdma_tim5_ch2.Instance = DMA1_Stream4;
+  hdma_tim5_ch2.Init.Channel = DMA_CHANNEL_6;
+  hdma_tim5_ch2.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_tim5_ch2.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_tim5_ch2.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_tim5_ch2.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+  hdma_tim5_ch2.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+  hdma_tim5_ch2.Init.Mode = DMA_CIRCULAR;
+  hdma_tim5_ch2.Init.Priority = DMA_PRIORITY_HIGH;
+  hdma_tim5_ch2.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_tim5_ch2) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  hdma_tim5_ch2.XferHalfCpltCallback = PULSE_INPUT_HalfCplt;
+  hdma_tim5_ch2.XferCpltCallback = PULSE_INPUT_Cplt;
+  hdma_tim5_ch2.XferErrorCallback = PULSE_INPUT_Error;
+
+  PulseLaps = 0U;
+  PulseSnap = 0U;
+  PulseResync = 0U;
+  PulseStalled = 0U;
+  PulseOvercaptures = 0U;
+  PulseDmaErrors = 0U;
+  PULSE_RingInit(&PulseRing, PulseRecords, PULSE_INPUT_RECORDS, PULSE_INPUT_GUARD, PULSE_INPUT_MAX_PERIOD);
+  PULSE_BatchInit(&PulseBatch);
+  if (HAL_DMA_Start_IT(&hdma_tim5_ch2, (uint32_t)&TIM5->DMAR, (uint32_t)PulseRecords,
+                       PULSE_INPUT_WORDS) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  /* Each CC2 request reads two registers from CCR1 on through DMAR */
+  TIM5->DCR = TIM_DMABASE_CCR1 | TIM_DMABURSTLENGTH_2TRANSFERS;
+  TIM5->SR = 0U;
+  TIM5->DIER |= TIM_DIER_CC2DE;
+  TIM5->CCER |= TIM_CCER_CC1E | TIM_CCER_CC2E;
+  TIM5->CR1 |= TIM_CR1_CEN;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Close the batch: take the records written so far, reduce the
+  *         batch and start a new one. Not from an interrupt, nor with
+  *         interrupts masked: it runs the stream interrupt.
+  * @param  stats: Filled in
+  * @retval None
+  */
+void PULSE_INPUT_Measure(PULSE_InputStatsTypeDef *stats)
+{
+  PulseSnap = 1U;
+  NVIC_SetPendingIRQ(DMA1_Stream4_IRQn);
+  while (PulseSnap != 0U)
+  {
+  }
+  stats->Result       = PulseResult;
+  stats->Stalled      = PulseStalled;
+  stats->Edges        = PulseRing.Read;
+  stats->Lost         = PulseRing.Lost;
+  stats->Breaks       = PulseRing.Breaks;
+  stats->Overcaptures = PulseOvercaptures;
+  stats->DmaErrors    = PulseDmaErrors;
+}
+
+/**
+  * @brief  DVFS callback: the new prescaler was loaded with an update event,
+  *         which zeroed the count, so no period may span the switch.
+  *         Register with POWER_Register().
+  * @retval DVFS_OK, never vetoes
+  */
+DVFS_StatusTypeDef PULSE_INPUT_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                           const DVFS_PointTypeDef *point)
+{
+  (void)context;
+  (void)point;
+  if (event == DVFS_EV_POST)
+  {
+    PulseResync = 1U;
+  }
+  return DVFS_OK;
+}
+
+/**
+  * @brief  Rest of the DMA1 Stream4 interrupt, after HAL_DMA_IRQHandler():
+  *         take the new records, and close the batch when Measure() asks.
+  * @retval None
+  */
+void PULSE_INPUT_IRQHandler(void)
+{
+  uint32_t written = PULSE_INPUT_Written();
+
+  if (PulseResync != 0U)
+  {
+    PulseResync = 0U;
+    PULSE_Resync(&PulseRing, written);
+  }
+  (void)PULSE_Take(&PulseRing, &PulseBatch, written);
+  if ((TIM5->SR & TIM_SR_CC2OF) != 0U)
+  {
+    TIM5->SR = ~(TIM_SR_CC1OF | TIM_SR_CC2OF);
+    PulseOvercaptures++;
+  }
+  if (PulseSnap != 0U)
+  {
+    PULSE_Result(&PulseBatch, PULSE_INPUT_TICK_HZ, &PulseResult);
+    PULSE_BatchInit(&PulseBatch);
+    PulseStalled = (PULSE_Idle(&PulseRing, TIM5->CNT) > PULSE_INPUT_MAX_PERIOD) ? 1U : 0U;
+    PulseSnap = 0U;
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Clocks, pin and interrupt for TIM5 and its DMA stream.
+  * @retval None
+  */
+static void PULSE_INPUT_MspInit(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  __HAL_RCC_TIM5_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+
+  /**TIM5 GPIO Configuration
+  PA1     ------> TIM5_CH2, pulled up for open-collector sensors
+  */
+  GPIO_InitStruct.Pin = GPIO_PIN_1;
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct.Pull = GPIO_PULLUP;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+  GPIO_InitStruct.Alternate = GPIO_AF2_TIM5;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+  HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, PULSE_INPUT_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
+}
+
+/**
+  * @brief  Records the DMA has completed since init. A transfer-complete
+  *         flag not yet handled means the count has already reloaded.
+  * @retval Total, wrapping with uint32_t
+  */
+static uint32_t PULSE_INPUT_Written(void)
+{
+  uint32_t laps = PulseLaps;
+  uint32_t left = __HAL_DMA_GET_COUNTER(&hdma_tim5_ch2);
+
+  if (__HAL_DMA_GET_FLAG(&hdma_tim5_ch2, __HAL_DMA_GET_TC_FLAG_INDEX(&hdma_tim5_ch2)) != RESET)
+  {
+    laps++;
+    left = __HAL_DMA_GET_COUNTER(&hdma_tim5_ch2);
+  }
+  return (laps * PULSE_INPUT_RECORDS) + ((PULSE_INPUT_WORDS - left) / PULSE_RECORD_WORDS);
+}
+
+/**
+  * @brief  Only set so that HAL_DMA_Start_IT() enables the half-transfer
+  *         interrupt; PULSE_INPUT_IRQHandler() takes the records.
+  * @retval None
+  */
+static void PULSE_INPUT_HalfCplt(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+}
+
+static void PULSE_INPUT_Cplt(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+  PulseLaps++;
+}
+
+static void PULSE_INPUT_Error(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+  PulseDmaErrors++;
+}
@@ -0,0 +1,564 @@
+/**
+  ******************************************************************************
+  * @file    sd_card.c
+  * @brief   SD card on SDIO: 4-bit bus, multi-block DMA transfers.
+  ******************************************************************************
+  * The card slot (not fitted on the Discovery board) takes:
+  *
+  *   PC8-PC11 SDIO_D0-D3    PC12 SDIO_CK    PD2 SDIO_CMD    (AF12)
+  *
+  * There is no HAL SD driver in this tree, so the peripheral is programmed
+  * directly. Identification runs at 400 kHz; then the bus goes to 4 bits at
+  * PLL48CLK / 2 = 24 MHz, 12 MB/s. Data moves through DMA2 Stream3
+  * channel 4 with the SDIO as flow controller and four-word bursts on both
+  * sides; hardware flow control stays off (SDIO_CK glitches on the F40x).
+  *
+  * A transfer is one CMD18/CMD25 for any number of blocks, closed by CMD12.
+  * Multi-block writes are announced with ACMD23 so the card can pre-erase.
+  * The calling task sleeps on a semaphore that the SDIO interrupt gives at
+  * DATAEND or on an error, then waits for the card to return to the
+  * transfer state, which after a write is the programming time.
+  *
+  * One task at a time; the log filesystem (logfs.c) is the user.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sd_card.h"
+#include "clock_config.h"
+#include "kernel.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define SD_CARD_CLKDIV(hz)      (((CLOCK_CONFIG_PLL48_HZ + (hz) - 1UL) / (hz)) - 2UL)
+#define SD_CARD_DMA             DMA2_Stream3
+#define SD_CARD_DMA_FLAGS       (DMA_LIFCR_CFEIF3 | DMA_LIFCR_CDMEIF3 | DMA_LIFCR_CTEIF3 | \
+                                 DMA_LIFCR_CHTIF3 | DMA_LIFCR_CTCIF3)
+#define SD_CARD_DATA_ERRORS     (SDIO_STA_DCRCFAIL | SDIO_STA_DTIMEOUT | SDIO_STA_TXUNDERR | \
+                                 SDIO_STA_RXOVERR | SDIO_STA_STBITERR)
+#define SD_CARD_FLAGS           (SDIO_ICR_CCRCFAILC | SDIO_ICR_DCRCFAILC | SDIO_ICR_CTIMEOUTC |  \
+                                 SDIO_ICR_DTIMEOUTC | SDIO_ICR_TXUNDERRC | SDIO_ICR_RXOVERRC |  \
+                                 SDIO_ICR_CMDRENDC | SDIO_ICR_CMDSENTC | SDIO_ICR_DATAENDC |    \
+                                 SDIO_ICR_STBITERRC | SDIO_ICR_DBCKENDC)
+#define SD_CARD_BLOCK_BITS      (9UL << SDIO_DCTRL_DBLOCKSIZE_Pos)
+#define SD_CARD_MAX_BLOCKS      (SDIO_DLEN_DATALENGTH / LOGFS_BLOCK_SIZE)
+#define SD_CARD_COMMAND_MS      10U
+#define SD_CARD_SPIN_MS         2U      /* Poll this long before sleeping     */
+
+/* Card status (R1) */
+#define SD_CARD_R1_ERRORS       0xFDFFE008UL
+#define SD_CARD_R1_READY        0x00000100UL    /* READY_FOR_DATA             */
+#define SD_CARD_R1_STATE(r1)    (((r1) >> 9) & 0x0FUL)
+#define SD_CARD_STATE_TRAN      4UL
+
+/* OCR */
+#define SD_CARD_OCR_BUSY        0x80000000UL    /* Set when power-up is done  */
+#define SD_CARD_OCR_CCS         0x40000000UL
+#define SD_CARD_OCR_VOLTAGE     0x00FF8000UL    /* 2.7-3.6 V                  */
+#define SD_CARD_CMD8_PATTERN    0x000001AAUL    /* 2.7-3.6 V, check 0xAA      */
+
+_Static_assert(SD_CARD_CLKDIV(SD_CARD_HZ) <= 0xFFUL, "SD_CARD_HZ: out of divider range");
+_Static_assert(SD_CARD_CLKDIV(SD_CARD_INIT_HZ) <= 0xFFUL, "SD_CARD_INIT_HZ: out of divider range");
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+  SD_RESP_NONE,
+  SD_RESP_SHORT,              /* R6, R7                                  */
+  SD_RESP_R1,                 /* Short, card status checked              */
+  SD_RESP_NOCRC,              /* R3: the CRC field is all ones           */
+  SD_RESP_LONG                /* R2                                      */
+} SD_ResponseTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static KERNEL_SemTypeDef    SdCardDone;
+static volatile uint32_t    SdCardStatus;   /* STA at the end of a transfer */
+static volatile uint8_t     SdCardBusy;
+static uint8_t              SdCardReady;
+static SD_CardStatsTypeDef  SdCardStats;
+
+/* Private function prototypes -----------------------------------------------*/
+static void                SD_CARD_MspInit(void);
+static HAL_StatusTypeDef   SD_CARD_Command(uint32_t index, uint32_t argument, SD_ResponseTypeDef response);
+static HAL_StatusTypeDef   SD_CARD_AppCommand(uint32_t index, uint32_t argument, SD_ResponseTypeDef response);
+static HAL_StatusTypeDef   SD_CARD_WaitReady(uint32_t ms);
+static uint32_t            SD_CARD_Capacity(void);
+static HAL_StatusTypeDef   SD_CARD_Transfer(uint32_t block, uint8_t *data, uint32_t count, uint8_t write);
+static LOGFS_StatusTypeDef SD_CARD_DeviceRead(void *context, uint32_t block, void *data, uint32_t count);
+static LOGFS_StatusTypeDef SD_CARD_DeviceWrite(void *context, uint32_t block, const void *data,
+                                               uint32_t count);
+
+static LOGFS_DeviceTypeDef SdCardDevice =
+{
+  SD_CARD_DeviceRead,
+  SD_CARD_DeviceWrite,
+  NULL,
+  0U
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Power the card up, identify it and switch to the 4-bit bus at
+  *         SD_CARD_HZ. Task context: sleeps while the card powers up.
+  * @retval HAL_OK, HAL_TIMEOUT with no card, HAL_ERROR
+  */
+HAL_StatusTypeDef SD_CARD_Init(void)
+{
+  uint32_t start;
+  uint32_t ocr = 0U;
+
+  SdCardReady = 0U;
+  memset(&SdCardStats, 0, sizeof(SdCardStats));
+  SD_CARD_MspInit();
+  KERNEL_SemInit(&SdCardDone, 0U, 1U);
+
+  SDIO->POWER = 0U;
+  SDIO->CLKCR = SD_CARD_CLKDIV(SD_CARD_INIT_HZ);
+  SDIO->POWER = SDIO_POWER_PWRCTRL;
+  SDIO->CLKCR |= SDIO_CLKCR_CLKEN;
+  KERNEL_Sleep(2U);                             /* 74 clocks and more */
+
+  if (SD_CARD_Command(0U, 0U, SD_RESP_NONE) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  switch (SD_CARD_Command(8U, SD_CARD_CMD8_PATTERN, SD_RESP_SHORT))
+  {
+    case HAL_OK:
+      if ((SDIO->RESP1 & 0xFFFU) != SD_CARD_CMD8_PATTERN)
+      {
+        return HAL_ERROR;
+      }
+      SdCardStats.Version2 = 1U;
+      break;
+    case HAL_TIMEOUT:
+      break;                                    /* Version 1.x card */
+    default:
+      return HAL_ERROR;
+  }
+
+  /* ACMD41 until the card leaves its power-up busy state */
+  start = KERNEL_Ticks();
+  while ((ocr & SD_CARD_OCR_BUSY) == 0U)
+  {
+    if ((KERNEL_Ticks() - start) > SD_CARD_POWERUP_MS)
+    {
+      return HAL_TIMEOUT;
+    }
+    if (SD_CARD_AppCommand(41U, SD_CARD_OCR_VOLTAGE | ((SdCardStats.Version2 != 0U) ? SD_CARD_OCR_CCS : 0U),
+                           SD_RESP_NOCRC) != HAL_OK)
+    {
+      return HAL_TIMEOUT;
+    }
+    ocr = SDIO->RESP1;
+    if ((ocr & SD_CARD_OCR_BUSY) == 0U)
+    {
+      KERNEL_Sleep(10U);
+    }
+  }
+  SdCardStats.HighCapacity = ((ocr & SD_CARD_OCR_CCS) != 0U) ? 1U : 0U;
+
+  if ((SD_CARD_Command(2U, 0U, SD_RESP_LONG) != HAL_OK) ||
+      (SD_CARD_Command(3U, 0U, SD_RESP_SHORT) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+  SdCardStats.Rca = SDIO->RESP1 >> 16;
+  if (SD_CARD_Command(9U, SdCardStats.Rca << 16, SD_RESP_LONG) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  SdCardStats.Blocks = SD_CARD_Capacity();
+  if ((SdCardStats.Blocks == 0U) ||
+      (SD_CARD_Command(7U, SdCardStats.Rca << 16, SD_RESP_R1) != HAL_OK) ||
+      ((SdCardStats.HighCapacity == 0U) && (SD_CARD_Command(16U, LOGFS_BLOCK_SIZE, SD_RESP_R1) != HAL_OK)) ||
+      (SD_CARD_AppCommand(6U, 2U, SD_RESP_R1) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+
+  SDIO->CLKCR = SDIO_CLKCR_CLKEN | SDIO_CLKCR_WIDBUS_0 | SD_CARD_CLKDIV(SD_CARD_HZ);
+  SdCardStats.ClockHz = CLOCK_CONFIG_PLL48_HZ / (SD_CARD_CLKDIV(SD_CARD_HZ) + 2UL);
+  SdCardDevice.Blocks = SdCardStats.Blocks;
+  SdCardReady = 1U;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Read blocks.
+  * @param  block: First block
+  * @param  data: Word-aligned destination, not in CCM RAM
+  * @param  count: Blocks
+  * @retval HAL status
+  */
+HAL_StatusTypeDef SD_CARD_Read(uint32_t block, void *data, uint32_t count)
+{
+  uint8_t *p = data;
+  uint32_t n;
+
+  while (count != 0U)
+  {
+    n = (count < SD_CARD_MAX_BLOCKS) ? count : SD_CARD_MAX_BLOCKS;
+    if (SD_CARD_Transfer(block, p, n, 0U) != HAL_OK)
+    {
+      return HAL_ERROR;
+    }
+    block += n;
+    p += n * LOGFS_BLOCK_SIZE;
+    count -= n;
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Write blocks; returns once the card has programmed them.
+  * @param  block: First block
+  * @param  data: Word-aligned source, not in CCM RAM
+  * @param  count: Blocks
+  * @retval HAL status
+  */
+HAL_StatusTypeDef SD_CARD_Write(uint32_t block, const void *data, uint32_t count)
+{
+  const uint8_t *p = data;
+  uint32_t n;
+
+  while (count != 0U)
+  {
+    n = (count < SD_CARD_MAX_BLOCKS) ? count : SD_CARD_MAX_BLOCKS;
+    if (SD_CARD_Transfer(block, (uint8_t *)p, n, 1U) != HAL_OK)
+    {
+      return HAL_ERROR;
+    }
+    block += n;
+    p += n * LOGFS_BLOCK_SIZE;
+    count -= n;
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  The card as a log filesystem device; Blocks is 0 before
+  *         SD_CARD_Init() succeeded.
+  * @retval Device
+  */
+const LOGFS_DeviceTypeDef *SD_CARD_Device(void)
+{
+  return &SdCardDevice;
+}
+
+/**
+  * @brief  Snapshot of the card and transfer counters.
+  * @param  stats: Filled in
+  * @retval None
+  */
+void SD_CARD_GetStats(SD_CardStatsTypeDef *stats)
+{
+  *stats = SdCardStats;
+}
+
+/**
+  * @brief  Operating point notifier (power.h). SDIO_CK comes from the PLL
+  *         and does not change with the bus dividers, but the PLL must stay
+  *         on and PCLK2 at 3/8 of SDIO_CK or more. No switch mid-transfer.
+  * @param  context: Not used
+  * @param  event: DVFS_EV_PRE or DVFS_EV_POST
+  * @param  point: Target operating point
+  * @retval DVFS_OK or DVFS_BUSY
+  */
+DVFS_StatusTypeDef SD_CARD_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                       const DVFS_PointTypeDef *point)
+{
+  (void)context;
+  if ((event != DVFS_EV_PRE) || (SdCardReady == 0U))
+  {
+    return DVFS_OK;
+  }
+  return ((SdCardBusy != 0U) || (point->UsePll == 0U) ||
+          ((DVFS_Pclk(point, 2U) * 8U) < (SdCardStats.ClockHz * 3U))) ? DVFS_BUSY : DVFS_OK;
+}
+
+/**
+  * @brief  SDIO interrupt: the data transfer ended or failed.
+  * @retval None
+  */
+void SD_CARD_IRQHandler(void)
+{
+  SdCardStatus = SDIO->STA;
+  SDIO->MASK = 0U;
+  SDIO->ICR = SD_CARD_FLAGS;
+  (void)KERNEL_SemGive(&SdCardDone);
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Clocks, pins and the interrupt.
+  * @retval None
+  */
+static void SD_CARD_MspInit(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  __HAL_RCC_SDIO_CLK_ENABLE();
+  __HAL_RCC_DMA2_CLK_ENABLE();
+  __HAL_RCC_GPIOC_CLK_ENABLE();
+  __HAL_RCC_GPIOD_CLK_ENABLE();
+
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct.Pull = GPIO_PULLUP;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  GPIO_InitStruct.Alternate = GPIO_AF12_SDIO;
+  GPIO_InitStruct.Pin = GPIO_PIN_8 | GPIO_PIN_9 | GPIO_PIN_10 | GPIO_PIN_11;
+  HAL_GPIO_Init(GPIOC, &GPIO_InitStruct);
+  GPIO_InitStruct.Pin = GPIO_PIN_2;
+  HAL_GPIO_Init(GPIOD, &GPIO_InitStruct);
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Pin = GPIO_PIN_12;
+  HAL_GPIO_Init(GPIOC, &GPIO_InitStruct);
+
+  HAL_NVIC_SetPriority(SDIO_IRQn, SD_CARD_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(SDIO_IRQn);
+}
+
+/**
+  * @brief  Send a command and wait for its response.
+  * @param  index: Command number
+  * @param  argument: Argument
+  * @param  response: What to expect
+  * @retval HAL_OK, HAL_TIMEOUT if the card did not answer, HAL_ERROR
+  */
+static HAL_StatusTypeDef SD_CARD_Command(uint32_t index, uint32_t argument, SD_ResponseTypeDef response)
+{
+  uint32_t done = (response == SD_RESP_NONE) ? SDIO_STA_CMDSENT
+                  : (SDIO_STA_CMDREND | SDIO_STA_CCRCFAIL | SDIO_STA_CTIMEOUT);
+  uint32_t start = HAL_GetTick();
+  uint32_t wait = (response == SD_RESP_NONE) ? 0U
+                  : (response == SD_RESP_LONG) ? SDIO_CMD_WAITRESP : SDIO_CMD_WAITRESP_0;
+  uint32_t status;
+
+  SDIO->ICR = SD_CARD_FLAGS & ~(SDIO_ICR_DATAENDC | SD_CARD_DATA_ERRORS);
+  SDIO->ARG = argument;
+  SDIO->CMD = index | wait | SDIO_CMD_CPSMEN;
+  do
+  {
+    status = SDIO->STA;
+    if ((HAL_GetTick() - start) > SD_CARD_COMMAND_MS)
+    {
+      return HAL_TIMEOUT;
+    }
+  } while ((status & done) == 0U);
+  SDIO->ICR = SDIO_ICR_CMDSENTC | SDIO_ICR_CMDRENDC | SDIO_ICR_CCRCFAILC | SDIO_ICR_CTIMEOUTC;
+
+  if ((status & SDIO_STA_CTIMEOUT) != 0U)
+  {
+    return HAL_TIMEOUT;
+  }
+  if (((status & SDIO_STA_CCRCFAIL) != 0U) && (response != SD_RESP_NOCRC))
+  {
+    return HAL_ERROR;
+  }
+  if ((response == SD_RESP_R1) &&
+      ((SDIO->RESPCMD != index) || ((SDIO->RESP1 & SD_CARD_R1_ERRORS) != 0U)))
+  {
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  CMD55 with the card's address, then an application command.
+  * @retval As SD_CARD_Command()
+  */
+static HAL_StatusTypeDef SD_CARD_AppCommand(uint32_t index, uint32_t argument, SD_ResponseTypeDef response)
+{
+  HAL_StatusTypeDef status = SD_CARD_Command(55U, SdCardStats.Rca << 16, SD_RESP_R1);
+
+  return (status == HAL_OK) ? SD_CARD_Command(index, argument, response) : status;
+}
+
+/**
+  * @brief  Poll CMD13 until the card is in the transfer state and ready for
+  *         data, spinning at first and then sleeping a tick at a time.
+  * @param  ms: Limit
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef SD_CARD_WaitReady(uint32_t ms)
+{
+  uint32_t start = KERNEL_Ticks();
+  uint32_t elapsed;
+  uint32_t r1;
+
+  while (1)
+  {
+    if (SD_CARD_Command(13U, SdCardStats.Rca << 16, SD_RESP_R1) != HAL_OK)
+    {
+      return HAL_ERROR;
+    }
+    r1 = SDIO->RESP1;
+    elapsed = KERNEL_Ticks() - start;
+    if (((r1 & SD_CARD_R1_READY) != 0U) && (SD_CARD_R1_STATE(r1) == SD_CARD_STATE_TRAN))
+    {
+      SdCardStats.BusyMaxMs = (elapsed > SdCardStats.BusyMaxMs) ? elapsed : SdCardStats.BusyMaxMs;
+      return HAL_OK;
+    }
+    if (elapsed > ms)
+    {
+      return HAL_TIMEOUT;
+    }
+    if (elapsed >= SD_CARD_SPIN_MS)
+    {
+      KERNEL_Sleep(1U);
+    }
+  }
+}
+
+/**
+  * @brief  Card size from the CSD (version 1.0 or 2.0) of the last CMD9.
+  * @retval Blocks of 512 bytes, 0 if the CSD version is unknown
+  */
+static uint32_t SD_CARD_Capacity(void)
+{
+  uint32_t csd0 = SDIO->RESP1;
+  uint32_t csd1 = SDIO->RESP2;
+  uint32_t csd2 = SDIO->RESP3;
+  uint32_t size;
+
+  switch (csd0 >> 30)
+  {
+    case 0U:
+      size = ((csd1 & 0x3FFU) << 2) | (csd2 >> 30);
+      return ((size + 1U) << (((csd2 >> 15) & 0x7U) + 2U + ((csd1 >> 16) & 0xFU))) / LOGFS_BLOCK_SIZE;
+    case 1U:
+      size = ((csd1 & 0x3FU) << 16) | (csd2 >> 16);
+      return (size + 1U) * 1024U;
+    default:
+      return 0U;
+  }
+}
+
+/**
+  * @brief  One multi-block (or single block) transfer through DMA.
+  * @param  block: First block
+  * @param  data: Word-aligned buffer
+  * @param  count: 1 to SD_CARD_MAX_BLOCKS
+  * @param  write: 1 to write
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef SD_CARD_Transfer(uint32_t block, uint8_t *data, uint32_t count, uint8_t write)
+{
+  uint32_t address = (SdCardStats.HighCapacity != 0U) ? block : (block * LOGFS_BLOCK_SIZE);
+  uint32_t ms = (write != 0U) ? SD_CARD_WRITE_MS : SD_CARD_READ_MS;
+  uint32_t dctrl = SD_CARD_BLOCK_BITS | SDIO_DCTRL_DMAEN | SDIO_DCTRL_DTEN;
+  HAL_StatusTypeDef status;
+  uint32_t start;
+
+  if ((SdCardReady == 0U) || (count == 0U) || (((uintptr_t)data & 3U) != 0U) ||
+      (block >= SdCardStats.Blocks) || (count > (SdCardStats.Blocks - block)))
+  {
+    return HAL_ERROR;
+  }
+  SdCardBusy = 1U;
+  status = SD_CARD_WaitReady(SD_CARD_WRITE_MS);
+  if ((status == HAL_OK) && (write != 0U) && (count > 1U))
+  {
+    status = SD_CARD_AppCommand(23U, count, SD_RESP_R1);
+  }
+  if (status != HAL_OK)
+  {
+    SdCardStats.Errors++;
+    SdCardBusy = 0U;
+    return status;
+  }
+
+  /* DMA2 Stream3 channel 4, the SDIO counts the words */
+  SD_CARD_DMA->CR = 0U;
+  while ((SD_CARD_DMA->CR & DMA_SxCR_EN) != 0U)
+  {
+  }
+  DMA2->LIFCR = SD_CARD_DMA_FLAGS;
+  SD_CARD_DMA->PAR = (uint32_t)&SDIO->FIFO;
+  SD_CARD_DMA->M0AR = (uint32_t)data;
+  SD_CARD_DMA->NDTR = count * (LOGFS_BLOCK_SIZE / 4U);
+  SD_CARD_DMA->FCR = DMA_SxFCR_DMDIS | DMA_SxFCR_FTH;
+  SD_CARD_DMA->CR = (4UL << DMA_SxCR_CHSEL_Pos) | DMA_SxCR_MBURST_0 | DMA_SxCR_PBURST_0 |
+                    DMA_SxCR_PL | DMA_SxCR_MSIZE_1 | DMA_SxCR_PSIZE_1 | DMA_SxCR_MINC |
+                    DMA_SxCR_PFCTRL | ((write != 0U) ? DMA_SxCR_DIR_0 : 0U);
+  SD_CARD_DMA->CR |= DMA_SxCR_EN;
+
+  /* The data path waits for the card; reads arm it before the command */
+  KERNEL_SemInit(&SdCardDone, 0U, 1U);
+  SdCardStatus = 0U;
+  SDIO->ICR = SD_CARD_FLAGS;
+  SDIO->DTIMER = ms * (SdCardStats.ClockHz / 1000U);
+  SDIO->DLEN = count * LOGFS_BLOCK_SIZE;
+  SDIO->MASK = SDIO_STA_DATAEND | SD_CARD_DATA_ERRORS;
+  if (write == 0U)
+  {
+    SDIO->DCTRL = dctrl | SDIO_DCTRL_DTDIR;
+    status = SD_CARD_Command((count > 1U) ? 18U : 17U, address, SD_RESP_R1);
+  }
+  else
+  {
+    status = SD_CARD_Command((count > 1U) ? 25U : 24U, address, SD_RESP_R1);
+    SDIO->DCTRL = dctrl;
+  }
+  if ((status == HAL_OK) && (KERNEL_SemTake(&SdCardDone, ms + 1U) != KERNEL_OK))
+  {
+    status = HAL_TIMEOUT;
+  }
+  if ((status == HAL_OK) && ((SdCardStatus & SD_CARD_DATA_ERRORS) != 0U))
+  {
+    status = HAL_ERROR;
+  }
+  SDIO->MASK = 0U;
+
+  /* Reads: the stream drains the FIFO after DATAEND */
+  start = HAL_GetTick();
+  while (((SD_CARD_DMA->CR & DMA_SxCR_EN) != 0U) && ((HAL_GetTick() - start) <= SD_CARD_COMMAND_MS))
+  {
+  }
+  if ((SD_CARD_DMA->CR & DMA_SxCR_EN) != 0U)
+  {
+    SD_CARD_DMA->CR &= ~DMA_SxCR_EN;
+    status = HAL_ERROR;
+  }
+  SDIO->DCTRL = 0U;
+  if ((count > 1U) && (SD_CARD_Command(12U, 0U, SD_RESP_R1) != HAL_OK))
+  {
+    status = HAL_ERROR;
+  }
+  if ((status == HAL_OK) && (write != 0U))
+  {
+    status = SD_CARD_WaitReady(SD_CARD_WRITE_MS);
+  }
+
+  SdCardStats.Transfers++;
+  if (status != HAL_OK)
+  {
+    SdCardStats.Errors++;
+  }
+  else if (write != 0U)
+  {
+    SdCardStats.WriteBlocks += count;
+  }
+  else
+  {
+    SdCardStats.ReadBlocks += count;
+  }
+  SdCardBusy = 0U;
+  return status;
+}
+
+static LOGFS_StatusTypeDef SD_CARD_DeviceRead(void *context, uint32_t block, void *data, uint32_t count)
+{
+  (void)context;
+  return (SD_CARD_Read(block, data, count) == HAL_OK) ? LOGFS_OK : LOGFS_ERROR;
+}
+
+static LOGFS_StatusTypeDef SD_CARD_DeviceWrite(void *context, uint32_t block, const void *data,
+                                               uint32_t count)
+{
+  (void)context;
+  return (SD_CARD_Write(block, data, count) == HAL_OK) ? LOGFS_OK : LOGFS_ERROR;
+}
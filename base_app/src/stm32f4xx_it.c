@@ -22,6 +22,21 @@
 #include "stm32f4xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "adc_acq.h"
+#include "pulse_input.h"
+#include "audio_stream.h"
+#include "button_input.h"
+#include "dac_stream.h"
+#include "i2c_bus.h"
+#include "can_bus.h"
+#include "modbus_rtu.h"
+#include "sd_card.h"
+#include "usb_fs.h"
+#include "trace_recorder.h"
+#include "crash_handler.h"
+#include "supervisor.h"
+#include "kernel_port.h"
+#include "placement.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -81,10 +96,10 @@ void NMI_Handler(void)
 /**
   * @brief This function handles Hard fault interrupt.
   */
-void HardFault_Handler(void)
+__attribute__((naked)) void HardFault_Handler(void)
 {
   /* USER CODE BEGIN HardFault_IRQn 0 */
-
+  CRASH_FAULT_ENTRY();
   /* USER CODE END HardFault_IRQn 0 */
   while (1)
   {
@@ -96,10 +111,10 @@ void HardFault_Handler(void)
 /**
   * @brief This function handles Memory management fault.
   */
-void MemManage_Handler(void)
+__attribute__((naked)) void MemManage_Handler(void)
 {
   /* USER CODE BEGIN MemoryManagement_IRQn 0 */
-
+  CRASH_FAULT_ENTRY();
   /* USER CODE END MemoryManagement_IRQn 0 */
   while (1)
   {
@@ -111,10 +126,10 @@ void MemManage_Handler(void)
 /**
   * @brief This function handles Pre-fetch fault, memory access fault.
   */
-void BusFault_Handler(void)
+__attribute__((naked)) void BusFault_Handler(void)
 {
   /* USER CODE BEGIN BusFault_IRQn 0 */
-
+  CRASH_FAULT_ENTRY();
   /* USER CODE END BusFault_IRQn 0 */
   while (1)
   {
@@ -126,10 +141,10 @@ void BusFault_Handler(void)
 /**
   * @brief This function handles Undefined instruction or illegal state.
   */
-void UsageFault_Handler(void)
+__attribute__((naked)) void UsageFault_Handler(void)
 {
   /* USER CODE BEGIN UsageFault_IRQn 0 */
-
+  CRASH_FAULT_ENTRY();
   /* USER CODE END UsageFault_IRQn 0 */
   while (1)
   {
@@ -141,10 +156,10 @@ void UsageFault_Handler(void)
 /**
   * @brief This function handles System service call via SWI instruction.
   */
-void SVC_Handler(void)
+__attribute__((naked)) void SVC_Handler(void)
 {
   /* USER CODE BEGIN SVCall_IRQn 0 */
-
+  KERNEL_PORT_SVC();
   /* USER CODE END SVCall_IRQn 0 */
   /* USER CODE BEGIN SVCall_IRQn 1 */
 
@@ -167,10 +182,10 @@ void DebugMon_Handler(void)
 /**
   * @brief This function handles Pendable request for system service.
   */
-void PendSV_Handler(void)
+__attribute__((naked)) CODE_HOT void PendSV_Handler(void)
 {
   /* USER CODE BEGIN PendSV_IRQn 0 */
-
+  KERNEL_PORT_PENDSV();
   /* USER CODE END PendSV_IRQn 0 */
   /* USER CODE BEGIN PendSV_IRQn 1 */
 
@@ -180,14 +195,17 @@ void PendSV_Handler(void)
 /**
   * @brief This function handles System tick timer.
   */
-void SysTick_Handler(void)
+CODE_HOT void SysTick_Handler(void)
 {
   /* USER CODE BEGIN SysTick_IRQn 0 */
-
+  TRACE_ISR_ENTER(SysTick_IRQn);
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
-
+  I2C_BUS_Tick();
+  SUPERVISOR_Tick();
+  KERNEL_Tick();
+  TRACE_ISR_EXIT(SysTick_IRQn);
   /* USER CODE END SysTick_IRQn 1 */
 }
 
@@ -198,20 +216,274 @@ void SysTick_Handler(void)
 /* please refer to the startup file (startup_stm32f4xx.s).                    */
 /******************************************************************************/
 
+/**
+  * @brief This function handles EXTI line0 interrupt (user button B1).
+  */
+void EXTI0_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI0_IRQn 0 */
+  TRACE_ISR_ENTER(EXTI0_IRQn);
+  /* USER CODE END EXTI0_IRQn 0 */
+  BUTTON_INPUT_EXTI_IRQHandler();
+  /* USER CODE BEGIN EXTI0_IRQn 1 */
+  TRACE_ISR_EXIT(EXTI0_IRQn);
+  /* USER CODE END EXTI0_IRQn 1 */
+}
+
 /**
   * @brief This function handles TIM6 global interrupt, DAC1 and DAC2 underrun error interrupts.
   */
 void TIM6_DAC_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM6_DAC_IRQn 0 */
-
+  TRACE_ISR_ENTER(TIM6_DAC_IRQn);
   /* USER CODE END TIM6_DAC_IRQn 0 */
   HAL_TIM_IRQHandler(&htim6);
   /* USER CODE BEGIN TIM6_DAC_IRQn 1 */
-
+  DAC_STREAM_IRQHandler();
+  TRACE_ISR_EXIT(TIM6_DAC_IRQn);
   /* USER CODE END TIM6_DAC_IRQn 1 */
 }
 
+/**
+  * @brief This function handles TIM7 global interrupt (button debounce one-shot).
+  */
+void TIM7_IRQHandler(void)
+{
+  /* USER CODE BEGIN TIM7_IRQn 0 */
+  TRACE_ISR_ENTER(TIM7_IRQn);
+  /* USER CODE END TIM7_IRQn 0 */
+  BUTTON_INPUT_TIM_IRQHandler();
+  /* USER CODE BEGIN TIM7_IRQn 1 */
+  TRACE_ISR_EXIT(TIM7_IRQn);
+  /* USER CODE END TIM7_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 stream5 global interrupt (I2S3 TX).
+  */
+CODE_HOT void DMA1_Stream5_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream5_IRQn 0 */
+  TRACE_ISR_ENTER(DMA1_Stream5_IRQn);
+  /* USER CODE END DMA1_Stream5_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_spi3_tx);
+  /* USER CODE BEGIN DMA1_Stream5_IRQn 1 */
+  TRACE_ISR_EXIT(DMA1_Stream5_IRQn);
+  /* USER CODE END DMA1_Stream5_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 stream6 global interrupt (DAC2).
+  */
+void DMA1_Stream6_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream6_IRQn 0 */
+  TRACE_ISR_ENTER(DMA1_Stream6_IRQn);
+  /* USER CODE END DMA1_Stream6_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_dac2);
+  /* USER CODE BEGIN DMA1_Stream6_IRQn 1 */
+  TRACE_ISR_EXIT(DMA1_Stream6_IRQn);
+  /* USER CODE END DMA1_Stream6_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA2 stream0 global interrupt (ADC1, or ADC common in multi mode).
+  */
+void DMA2_Stream0_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA2_Stream0_IRQn 0 */
+  TRACE_ISR_ENTER(DMA2_Stream0_IRQn);
+  /* USER CODE END DMA2_Stream0_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_adc1);
+  /* USER CODE BEGIN DMA2_Stream0_IRQn 1 */
+  TRACE_ISR_EXIT(DMA2_Stream0_IRQn);
+  /* USER CODE END DMA2_Stream0_IRQn 1 */
+}
+
+/**
+  * @brief This function handles ADC1, ADC2 and ADC3 global interrupts (overrun).
+  */
+void ADC_IRQHandler(void)
+{
+  /* USER CODE BEGIN ADC_IRQn 0 */
+  TRACE_ISR_ENTER(ADC_IRQn);
+  /* USER CODE END ADC_IRQn 0 */
+  ADC_ACQ_IRQHandler();
+  /* USER CODE BEGIN ADC_IRQn 1 */
+  TRACE_ISR_EXIT(ADC_IRQn);
+  /* USER CODE END ADC_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 stream4 global interrupt (TIM5 CH2 capture).
+  */
+void DMA1_Stream4_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream4_IRQn 0 */
+  TRACE_ISR_ENTER(DMA1_Stream4_IRQn);
+  /* USER CODE END DMA1_Stream4_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_tim5_ch2);
+  PULSE_INPUT_IRQHandler();
+  /* USER CODE BEGIN DMA1_Stream4_IRQn 1 */
+  TRACE_ISR_EXIT(DMA1_Stream4_IRQn);
+  /* USER CODE END DMA1_Stream4_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 stream0 global interrupt (I2C1 RX).
+  */
+void DMA1_Stream0_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream0_IRQn 0 */
+  TRACE_ISR_ENTER(DMA1_Stream0_IRQn);
+  /* USER CODE END DMA1_Stream0_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_i2c1_rx);
+  /* USER CODE BEGIN DMA1_Stream0_IRQn 1 */
+  TRACE_ISR_EXIT(DMA1_Stream0_IRQn);
+  /* USER CODE END DMA1_Stream0_IRQn 1 */
+}
+
+/**
+  * @brief This function handles I2C1 event interrupt.
+  */
+void I2C1_EV_IRQHandler(void)
+{
+  /* USER CODE BEGIN I2C1_EV_IRQn 0 */
+  TRACE_ISR_ENTER(I2C1_EV_IRQn);
+  /* USER CODE END I2C1_EV_IRQn 0 */
+  I2C_BUS_EV_IRQHandler();
+  /* USER CODE BEGIN I2C1_EV_IRQn 1 */
+  TRACE_ISR_EXIT(I2C1_EV_IRQn);
+  /* USER CODE END I2C1_EV_IRQn 1 */
+}
+
+/**
+  * @brief This function handles I2C1 error interrupt.
+  */
+void I2C1_ER_IRQHandler(void)
+{
+  /* USER CODE BEGIN I2C1_ER_IRQn 0 */
+  TRACE_ISR_ENTER(I2C1_ER_IRQn);
+  /* USER CODE END I2C1_ER_IRQn 0 */
+  I2C_BUS_ER_IRQHandler();
+  /* USER CODE BEGIN I2C1_ER_IRQn 1 */
+  TRACE_ISR_EXIT(I2C1_ER_IRQn);
+  /* USER CODE END I2C1_ER_IRQn 1 */
+}
+
+/**
+  * @brief This function handles CAN1 TX interrupt.
+  */
+void CAN1_TX_IRQHandler(void)
+{
+  /* USER CODE BEGIN CAN1_TX_IRQn 0 */
+  TRACE_ISR_ENTER(CAN1_TX_IRQn);
+  /* USER CODE END CAN1_TX_IRQn 0 */
+  CAN_BUS_TX_IRQHandler();
+  /* USER CODE BEGIN CAN1_TX_IRQn 1 */
+  TRACE_ISR_EXIT(CAN1_TX_IRQn);
+  /* USER CODE END CAN1_TX_IRQn 1 */
+}
+
+/**
+  * @brief This function handles CAN1 RX0 interrupt.
+  */
+void CAN1_RX0_IRQHandler(void)
+{
+  /* USER CODE BEGIN CAN1_RX0_IRQn 0 */
+  TRACE_ISR_ENTER(CAN1_RX0_IRQn);
+  /* USER CODE END CAN1_RX0_IRQn 0 */
+  CAN_BUS_RX0_IRQHandler();
+  /* USER CODE BEGIN CAN1_RX0_IRQn 1 */
+  TRACE_ISR_EXIT(CAN1_RX0_IRQn);
+  /* USER CODE END CAN1_RX0_IRQn 1 */
+}
+
+/**
+  * @brief This function handles CAN1 RX1 interrupt.
+  */
+void CAN1_RX1_IRQHandler(void)
+{
+  /* USER CODE BEGIN CAN1_RX1_IRQn 0 */
+  TRACE_ISR_ENTER(CAN1_RX1_IRQn);
+  /* USER CODE END CAN1_RX1_IRQn 0 */
+  CAN_BUS_RX1_IRQHandler();
+  /* USER CODE BEGIN CAN1_RX1_IRQn 1 */
+  TRACE_ISR_EXIT(CAN1_RX1_IRQn);
+  /* USER CODE END CAN1_RX1_IRQn 1 */
+}
+
+/**
+  * @brief This function handles CAN1 SCE interrupt.
+  */
+void CAN1_SCE_IRQHandler(void)
+{
+  /* USER CODE BEGIN CAN1_SCE_IRQn 0 */
+  TRACE_ISR_ENTER(CAN1_SCE_IRQn);
+  /* USER CODE END CAN1_SCE_IRQn 0 */
+  CAN_BUS_SCE_IRQHandler();
+  /* USER CODE BEGIN CAN1_SCE_IRQn 1 */
+  TRACE_ISR_EXIT(CAN1_SCE_IRQn);
+  /* USER CODE END CAN1_SCE_IRQn 1 */
+}
+
+/**
+  * @brief This function handles USART3 global interrupt (Modbus RTU slave).
+  */
+void USART3_IRQHandler(void)
+{
+  /* USER CODE BEGIN USART3_IRQn 0 */
+  TRACE_ISR_ENTER(USART3_IRQn);
+  /* USER CODE END USART3_IRQn 0 */
+  MODBUS_RTU_UART_IRQHandler();
+  /* USER CODE BEGIN USART3_IRQn 1 */
+  TRACE_ISR_EXIT(USART3_IRQn);
+  /* USER CODE END USART3_IRQn 1 */
+}
+
+/**
+  * @brief This function handles TIM3 global interrupt (Modbus RTU t1.5/t3.5).
+  */
+void TIM3_IRQHandler(void)
+{
+  /* USER CODE BEGIN TIM3_IRQn 0 */
+  TRACE_ISR_ENTER(TIM3_IRQn);
+  /* USER CODE END TIM3_IRQn 0 */
+  MODBUS_RTU_TIM_IRQHandler();
+  /* USER CODE BEGIN TIM3_IRQn 1 */
+  TRACE_ISR_EXIT(TIM3_IRQn);
+  /* USER CODE END TIM3_IRQn 1 */
+}
+
+/**
+  * @brief This function handles SDIO global interrupt (SD card transfer end).
+  */
+void SDIO_IRQHandler(void)
+{
+  /* USER CODE BEGIN SDIO_IRQn 0 */
+  TRACE_ISR_ENTER(SDIO_IRQn);
+  /* USER CODE END SDIO_IRQn 0 */
+  SD_CARD_IRQHandler();
+  /* USER CODE BEGIN SDIO_IRQn 1 */
+  TRACE_ISR_EXIT(SDIO_IRQn);
+  /* USER CODE END SDIO_IRQn 1 */
+}
+
+/**
+  * @brief This function handles USB On The Go FS global interrupt (virtual COM port).
+  */
+void OTG_FS_IRQHandler(void)
+{
+  /* USER CODE BEGIN OTG_FS_IRQn 0 */
+  TRACE_ISR_ENTER(OTG_FS_IRQn);
+  /* USER CODE END OTG_FS_IRQn 0 */
+  USB_FS_IRQHandler();
+  /* USER CODE BEGIN OTG_FS_IRQn 1 */
+  TRACE_ISR_EXIT(OTG_FS_IRQn);
+  /* USER CODE END OTG_FS_IRQn 1 */
+}
+
 /* USER CODE BEGIN 1 */
 
 /* USER CODE END 1 */
@@ -0,0 +1,153 @@
+/**
+  ******************************************************************************
+  * @file    supervisor.c
+  * @brief   Independent watchdog gated by per-task heartbeats.
+  ******************************************************************************
+  * There is no HAL IWDG driver in this tree, so the IWDG is programmed
+  * through its key register. Once started it cannot be stopped; it is only
+  * refreshed from SUPERVISOR_Tick() (SysTick) while WDOG_Check() is happy.
+  * A starved task is written to WdogRecord the moment it is detected, about
+  * one IWDG timeout before the reset. Error_Handler() spinning with
+  * interrupts off now also ends in an IWDG reset.
+  *
+  * The IWDG is frozen while the core is halted by a debugger.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "supervisor.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define SUPERVISOR_KEY_REFRESH  0xAAAAU
+#define SUPERVISOR_KEY_UNLOCK   0x5555U
+#define SUPERVISOR_KEY_START    0xCCCCU
+#define SUPERVISOR_LINE_MAX     78U
+
+/* Private variables ---------------------------------------------------------*/
+WDOG_HandleTypeDef hwdog;
+
+/* Not cleared by the startup code: survives the reset */
+WDOG_RecordTypeDef WdogRecord __attribute__((section(".noinit")));
+
+static uint8_t  SupervisorReady;
+static uint8_t  SupervisorRunning;
+static uint8_t  SupervisorRecorded;
+static uint32_t SupervisorTicks;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Add a task to the supervisor. Call before SUPERVISOR_Start().
+  * @param  name: Task name, must be static
+  * @param  deadline_ms: Longest allowed gap between heartbeats
+  * @retval Task ID for SUPERVISOR_Heartbeat()
+  */
+uint32_t SUPERVISOR_Register(const char *name, uint32_t deadline_ms)
+{
+  uint32_t id = WDOG_MAX_TASKS;
+
+  if (SupervisorReady == 0U)
+  {
+    WDOG_Init(&hwdog);
+    SupervisorReady = 1U;
+  }
+  if (WDOG_Register(&hwdog, name, deadline_ms, HAL_GetTick(), &id) != WDOG_OK)
+  {
+    Error_Handler();
+  }
+  return id;
+}
+
+/**
+  * @brief  Report progress of a task.
+  * @param  id: Task ID from SUPERVISOR_Register()
+  * @retval None
+  */
+void SUPERVISOR_Heartbeat(uint32_t id)
+{
+  WDOG_Heartbeat(&hwdog, id, HAL_GetTick());
+}
+
+/**
+  * @brief  Start the IWDG. Deadlines of all tasks restart now.
+  * @retval None
+  */
+void SUPERVISOR_Start(void)
+{
+  uint32_t id;
+
+  for (id = 0U; id < hwdog.Count; id++)
+  {
+    WDOG_Resume(&hwdog, id, HAL_GetTick());
+  }
+
+  DBGMCU->APB1FZ |= DBGMCU_APB1_FZ_DBG_IWDG_STOP;
+  IWDG->KR  = SUPERVISOR_KEY_START;
+  IWDG->KR  = SUPERVISOR_KEY_UNLOCK;
+  IWDG->PR  = SUPERVISOR_IWDG_PR;
+  IWDG->RLR = SUPERVISOR_IWDG_RELOAD;
+  while (IWDG->SR != 0U)
+  {
+  }
+  IWDG->KR  = SUPERVISOR_KEY_REFRESH;
+  SupervisorRunning = 1U;
+}
+
+/**
+  * @brief  Supervisor clock, called from SysTick_Handler() every 1 ms.
+  * @retval None
+  */
+void SUPERVISOR_Tick(void)
+{
+  if ((SupervisorRunning == 0U) || (++SupervisorTicks < SUPERVISOR_CHECK_MS))
+  {
+    return;
+  }
+  SupervisorTicks = 0U;
+
+  if (WDOG_Check(&hwdog, HAL_GetTick()) == WDOG_OK)
+  {
+    IWDG->KR = SUPERVISOR_KEY_REFRESH;
+  }
+  else if (SupervisorRecorded == 0U)
+  {
+    WDOG_Record(&hwdog, &WdogRecord);
+    SupervisorRecorded = 1U;
+  }
+}
+
+/**
+  * @brief  Report the task that starved before an IWDG reset, once.
+  *         Clears the RCC reset flags.
+  * @param  huart: Initialised UART handle
+  * @retval 1 if a watchdog reset was reported
+  */
+uint8_t SUPERVISOR_Report(UART_HandleTypeDef *huart)
+{
+  char line[SUPERVISOR_LINE_MAX + 2U];
+  uint32_t len;
+  uint8_t iwdg_reset = (__HAL_RCC_GET_FLAG(RCC_FLAG_IWDGRST) != 0U) ? 1U : 0U;
+
+  __HAL_RCC_CLEAR_RESET_FLAGS();
+  if (iwdg_reset == 0U)
+  {
+    return 0U;
+  }
+
+  if (WDOG_RecordIsPending(&WdogRecord) != 0U)
+  {
+    len = WDOG_FormatRecord(&WdogRecord, line, SUPERVISOR_LINE_MAX);
+    WDOG_RecordMarkReported(&WdogRecord);
+  }
+  else
+  {
+    /* Expired without a starved task: interrupts were off (Error_Handler) */
+    strcpy(line, "watchdog: reset with no task starved");
+    len = strlen(line);
+  }
+  line[len++] = '\r';
+  line[len++] = '\n';
+  (void)HAL_UART_Transmit(huart, (uint8_t *)line, (uint16_t)len, HAL_MAX_DELAY);
+  return 1U;
+}
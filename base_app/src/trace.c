@@ -0,0 +1,469 @@
+/**
+  ******************************************************************************
+  * @file    trace.c
+  * @brief   Binary event trace: ring bookkeeping, dump decoder and Chrome
+  *          trace JSON writer.
+  ******************************************************************************
+  * A dump is what TRACE_RECORDER_Dump() sends and tools/trace2json reads:
+  *
+  *   TRACE_DumpHeaderTypeDef (16 bytes) | Count records, oldest first
+  *
+  * all little-endian. The JSON writer produces the Trace Event Format
+  * understood by chrome://tracing and ui.perfetto.dev: interrupts become
+  * B/E slices on one track, task switches slices on a second one, everything
+  * else instant events on a third. Cycles are converted at the rate of the
+  * last TRACE_EV_CLOCK, the header's before the first.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "trace.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* Private define ------------------------------------------------------------*/
+#define TRACE_TID_ISR     1
+#define TRACE_TID_TASK    2
+#define TRACE_TID_EVENT   3
+
+#define TRACE_IRQN_FIRST  (-15)
+
+/* Private variables ---------------------------------------------------------*/
+/* STM32F407 vector names, indexed by IRQn - TRACE_IRQN_FIRST */
+static const char *const TraceIrqNames[] =
+{
+  "Reset", "NonMaskableInt", "HardFault", "MemoryManagement", "BusFault",
+  "UsageFault", NULL, NULL, NULL, NULL, "SVCall", "DebugMonitor", NULL,
+  "PendSV", "SysTick", "WWDG", "PVD", "TAMP_STAMP", "RTC_WKUP", "FLASH", "RCC",
+  "EXTI0", "EXTI1", "EXTI2", "EXTI3", "EXTI4", "DMA1_Stream0", "DMA1_Stream1",
+  "DMA1_Stream2", "DMA1_Stream3", "DMA1_Stream4", "DMA1_Stream5",
+  "DMA1_Stream6", "ADC", "CAN1_TX", "CAN1_RX0", "CAN1_RX1", "CAN1_SCE",
+  "EXTI9_5", "TIM1_BRK_TIM9", "TIM1_UP_TIM10", "TIM1_TRG_COM_TIM11", "TIM1_CC",
+  "TIM2", "TIM3", "TIM4", "I2C1_EV", "I2C1_ER", "I2C2_EV", "I2C2_ER", "SPI1",
+  "SPI2", "USART1", "USART2", "USART3", "EXTI15_10", "RTC_Alarm",
+  "OTG_FS_WKUP", "TIM8_BRK_TIM12", "TIM8_UP_TIM13", "TIM8_TRG_COM_TIM14",
+  "TIM8_CC", "DMA1_Stream7", "FSMC", "SDIO", "TIM5", "SPI3", "UART4", "UART5",
+  "TIM6_DAC", "TIM7", "DMA2_Stream0", "DMA2_Stream1", "DMA2_Stream2",
+  "DMA2_Stream3", "DMA2_Stream4", "ETH", "ETH_WKUP", "CAN2_TX", "CAN2_RX0",
+  "CAN2_RX1", "CAN2_SCE", "OTG_FS", "DMA2_Stream5", "DMA2_Stream6",
+  "DMA2_Stream7", "USART6", "I2C3_EV", "I2C3_ER", "OTG_HS_EP1_OUT",
+  "OTG_HS_EP1_IN", "OTG_HS_WKUP", "OTG_HS", "DCMI", NULL, "RNG", "FPU"
+};
+
+#define TRACE_IRQ_NAMES   (sizeof(TraceIrqNames) / sizeof(TraceIrqNames[0]))
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t TRACE_Get32(const uint8_t *p);
+static void     TRACE_Append(char *out, uint32_t size, uint32_t *len, const char *format, ...);
+static uint64_t TRACE_Nanoseconds(const TRACE_JsonTypeDef *json, uint64_t cycles);
+static void     TRACE_AppendTime(TRACE_JsonTypeDef *json, char *out, uint32_t size, uint32_t *len);
+static void     TRACE_AppendSlice(TRACE_JsonTypeDef *json, char *out, uint32_t size, uint32_t *len,
+                                  const char *name, const char *cat, char phase, int tid);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Attach storage to a ring and start the clock.
+  * @param  ring: Ring to initialise
+  * @param  records: Record storage
+  * @param  capacity: Number of records, a power of two
+  * @param  cpu_hz: Frequency of the timestamp clock
+  * @param  now: Current timestamp
+  * @retval TRACE_ERROR if the capacity is not a power of two
+  */
+TRACE_StatusTypeDef TRACE_Init(TRACE_RingTypeDef *ring, TRACE_RecordTypeDef *records,
+                               uint32_t capacity, uint32_t cpu_hz, uint32_t now)
+{
+  if ((records == NULL) || (capacity == 0U) || ((capacity & (capacity - 1U)) != 0U))
+  {
+    return TRACE_ERROR;
+  }
+  ring->Records = records;
+  ring->Mask    = capacity - 1U;
+  ring->ClockHz = cpu_hz;
+  TRACE_Reset(ring, now);
+  return TRACE_OK;
+}
+
+/**
+  * @brief  Drop every record.
+  * @param  ring: Trace ring
+  * @param  now: Current timestamp, the next record's delta starts here
+  * @retval None
+  */
+void TRACE_Reset(TRACE_RingTypeDef *ring, uint32_t now)
+{
+  ring->Head  = 0U;
+  ring->Last  = now;
+  ring->CpuHz = ring->ClockHz;
+}
+
+/**
+  * @brief  Record a change of the timestamp clock. Same locking as
+  *         TRACE_Encode().
+  * @param  ring: Trace ring
+  * @param  now: Current timestamp, the last at the old rate
+  * @param  cpu_hz: New frequency of the timestamp clock
+  * @retval None
+  */
+void TRACE_Clock(TRACE_RingTypeDef *ring, uint32_t now, uint32_t cpu_hz)
+{
+  if ((cpu_hz == 0U) || (cpu_hz == ring->ClockHz))
+  {
+    return;
+  }
+  TRACE_Encode(ring, now, TRACE_EV_CLOCK, cpu_hz);
+  ring->ClockHz = cpu_hz;
+}
+
+/**
+  * @brief  Header describing the current contents of a ring.
+  * @param  ring: Trace ring
+  * @param  header: Filled in
+  * @retval None
+  */
+void TRACE_DumpHeader(const TRACE_RingTypeDef *ring, TRACE_DumpHeaderTypeDef *header)
+{
+  uint32_t capacity = ring->Mask + 1U;
+
+  header->Magic = TRACE_MAGIC;
+  header->CpuHz = ring->CpuHz;
+  header->Count = (ring->Head < capacity) ? ring->Head : capacity;
+  header->Lost  = ring->Head - header->Count;
+}
+
+/**
+  * @brief  The ring contents, oldest first, as at most two contiguous spans.
+  * @param  ring: Trace ring
+  * @param  part: 0 for the older span, 1 for the newer one
+  * @param  count: Receives the number of records in the span
+  * @retval First record of the span
+  */
+const TRACE_RecordTypeDef *TRACE_Span(const TRACE_RingTypeDef *ring, uint32_t part, uint32_t *count)
+{
+  uint32_t capacity = ring->Mask + 1U;
+  uint32_t start = ring->Head & ring->Mask;
+
+  if (ring->Head <= capacity)
+  {
+    *count = (part == 0U) ? ring->Head : 0U;
+    return ring->Records;
+  }
+  if (part == 0U)
+  {
+    *count = capacity - start;
+    return &ring->Records[start];
+  }
+  *count = start;
+  return ring->Records;
+}
+
+/**
+  * @brief  Walk a dump and hand every event, with an absolute time, to a sink.
+  *         SYNC records are folded into the time base and not reported.
+  * @param  dump: Dump bytes, may carry trailing garbage
+  * @param  size: Number of bytes
+  * @param  header: Receives the dump header, may be NULL
+  * @param  sink: Called once per event, may be NULL to only validate
+  * @param  context: Passed to the sink
+  * @retval TRACE_ERROR for a bad magic, clock or truncated dump
+  */
+TRACE_StatusTypeDef TRACE_Decode(const uint8_t *dump, uint32_t size, TRACE_DumpHeaderTypeDef *header,
+                                 TRACE_SinkTypeDef sink, void *context)
+{
+  TRACE_DumpHeaderTypeDef h;
+  TRACE_EventTypeDef event;
+  const uint8_t *p;
+  uint64_t cycles = 0U;
+  uint32_t word;
+  uint32_t delta;
+  uint32_t i;
+
+  if ((dump == NULL) || (size < TRACE_HEADER_SIZE))
+  {
+    return TRACE_ERROR;
+  }
+  h.Magic = TRACE_Get32(dump);
+  h.CpuHz = TRACE_Get32(dump + 4);
+  h.Count = TRACE_Get32(dump + 8);
+  h.Lost  = TRACE_Get32(dump + 12);
+  if ((h.Magic != TRACE_MAGIC) || (h.CpuHz == 0U) ||
+      (h.Count > (size - TRACE_HEADER_SIZE) / TRACE_RECORD_SIZE))
+  {
+    return TRACE_ERROR;
+  }
+  if (header != NULL)
+  {
+    *header = h;
+  }
+
+  p = dump + TRACE_HEADER_SIZE;
+  for (i = 0U; i < h.Count; i++, p += TRACE_RECORD_SIZE)
+  {
+    word  = TRACE_Get32(p);
+    delta = word & TRACE_DELTA_MAX;
+    event.Id      = (uint8_t)(word >> 24);
+    event.Payload = TRACE_Get32(p + 4);
+
+    /* The first record's predecessor was overwritten: it defines time 0 */
+    if ((i == 0U) && (h.Lost != 0U))
+    {
+      delta = 0U;
+      if (event.Id == TRACE_EV_SYNC)
+      {
+        continue;
+      }
+    }
+    if (event.Id == TRACE_EV_SYNC)
+    {
+      cycles += event.Payload;
+      continue;
+    }
+
+    cycles += delta;
+    event.Cycles = cycles;
+    if (sink != NULL)
+    {
+      sink(context, &event);
+    }
+  }
+  return TRACE_OK;
+}
+
+/**
+  * @brief  Vector name of an STM32F407 interrupt number.
+  * @param  irqn: IRQn_Type value
+  * @retval Name, or NULL for an unused or unknown vector
+  */
+const char *TRACE_IrqName(int32_t irqn)
+{
+  int32_t index = irqn - TRACE_IRQN_FIRST;
+
+  if ((index < 0) || ((uint32_t)index >= TRACE_IRQ_NAMES))
+  {
+    return NULL;
+  }
+  return TraceIrqNames[index];
+}
+
+/**
+  * @brief  Open the JSON document and name the three tracks.
+  * @param  json: Writer state
+  * @param  cpu_hz: Timestamp clock of the dump
+  * @param  out: Output buffer, TRACE_JSON_MAX bytes are always enough
+  * @param  size: Size of out
+  * @retval Number of characters written
+  */
+uint32_t TRACE_JsonBegin(TRACE_JsonTypeDef *json, uint32_t cpu_hz, char *out, uint32_t size)
+{
+  uint32_t len = 0U;
+
+  json->CpuHz       = cpu_hz;
+  json->Written     = 3U;
+  json->Task        = -1;
+  json->Cycles      = 0U;
+  json->ClockCycles = 0U;
+  json->ClockNs     = 0U;
+
+  TRACE_Append(out, size, &len,
+               "{\"traceEvents\":[\n"
+               "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"interrupts\"}},\n"
+               "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"tasks\"}},\n"
+               "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"events\"}}",
+               TRACE_TID_ISR, TRACE_TID_TASK, TRACE_TID_EVENT);
+  return len;
+}
+
+/**
+  * @brief  Format one decoded event as Trace Event Format objects.
+  * @param  json: Writer state
+  * @param  event: Decoded event
+  * @param  out: Output buffer, TRACE_JSON_MAX bytes are always enough
+  * @param  size: Size of out
+  * @retval Number of characters written
+  */
+uint32_t TRACE_JsonEvent(TRACE_JsonTypeDef *json, const TRACE_EventTypeDef *event, char *out, uint32_t size)
+{
+  char name[24];
+  const char *label;
+  uint32_t len = 0U;
+
+  json->Cycles = event->Cycles;
+  out[0] = '\0';
+
+  switch (event->Id)
+  {
+    case TRACE_EV_ISR_ENTER:
+    case TRACE_EV_ISR_EXIT:
+      label = TRACE_IrqName((int32_t)event->Payload);
+      if (label == NULL)
+      {
+        snprintf(name, sizeof(name), "IRQ%ld", (long)(int32_t)event->Payload);
+        label = name;
+      }
+      TRACE_AppendSlice(json, out, size, &len, label, "isr",
+                        (event->Id == TRACE_EV_ISR_ENTER) ? 'B' : 'E', TRACE_TID_ISR);
+      return len;
+
+    case TRACE_EV_TASK_SWITCH:
+      if (json->Task >= 0)
+      {
+        snprintf(name, sizeof(name), "task %ld", (long)json->Task);
+        TRACE_AppendSlice(json, out, size, &len, name, "task", 'E', TRACE_TID_TASK);
+      }
+      json->Task = (int32_t)(event->Payload & 0x7FFFFFFFU);
+      snprintf(name, sizeof(name), "task %ld", (long)json->Task);
+      TRACE_AppendSlice(json, out, size, &len, name, "task", 'B', TRACE_TID_TASK);
+      return len;
+
+    case TRACE_EV_UART_TX:
+      label = "uart tx";
+      break;
+    case TRACE_EV_UART_RX:
+      label = "uart rx";
+      break;
+    case TRACE_EV_UART_ERROR:
+      label = "uart error";
+      break;
+    case TRACE_EV_MARK:
+      label = "mark";
+      break;
+    case TRACE_EV_CLOCK:
+      /* Later cycles count at the new rate */
+      label = "clock";
+      if (event->Payload != 0U)
+      {
+        json->ClockNs     = TRACE_Nanoseconds(json, event->Cycles);
+        json->ClockCycles = event->Cycles;
+        json->CpuHz       = event->Payload;
+      }
+      break;
+    default:
+      snprintf(name, sizeof(name), "event 0x%02X", (unsigned)event->Id);
+      label = name;
+      break;
+  }
+
+  TRACE_Append(out, size, &len, "%s{\"name\":\"%s\",\"cat\":\"event\",\"ph\":\"i\",\"s\":\"t\",\"ts\":",
+               (json->Written != 0U) ? ",\n" : "", label);
+  TRACE_AppendTime(json, out, size, &len);
+  TRACE_Append(out, size, &len, ",\"pid\":1,\"tid\":%d,\"args\":{\"value\":%lu}}",
+               TRACE_TID_EVENT, (unsigned long)event->Payload);
+  json->Written++;
+  return len;
+}
+
+/**
+  * @brief  Close a task slice still open and the JSON document.
+  * @param  json: Writer state
+  * @param  out: Output buffer, TRACE_JSON_MAX bytes are always enough
+  * @param  size: Size of out
+  * @retval Number of characters written
+  */
+uint32_t TRACE_JsonEnd(TRACE_JsonTypeDef *json, char *out, uint32_t size)
+{
+  char name[24];
+  uint32_t len = 0U;
+
+  out[0] = '\0';
+  if (json->Task >= 0)
+  {
+    snprintf(name, sizeof(name), "task %ld", (long)json->Task);
+    TRACE_AppendSlice(json, out, size, &len, name, "task", 'E', TRACE_TID_TASK);
+    json->Task = -1;
+  }
+  TRACE_Append(out, size, &len, "\n],\"displayTimeUnit\":\"ns\"}\n");
+  return len;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Little-endian 32-bit load from an unaligned byte pointer.
+  * @param  p: First byte
+  * @retval Value
+  */
+static uint32_t TRACE_Get32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+  * @brief  printf-style append that never overruns the buffer.
+  * @param  out: Output buffer
+  * @param  size: Size of out
+  * @param  len: Current length, advanced
+  * @param  format: printf format
+  * @retval None
+  */
+static void TRACE_Append(char *out, uint32_t size, uint32_t *len, const char *format, ...)
+{
+  va_list args;
+  int n;
+
+  if (*len + 1U >= size)
+  {
+    return;
+  }
+  va_start(args, format);
+  n = vsnprintf(out + *len, size - *len, format, args);
+  va_end(args);
+  if (n > 0)
+  {
+    *len += ((uint32_t)n < size - *len) ? (uint32_t)n : (size - *len - 1U);
+  }
+}
+
+/**
+  * @brief  Time of a cycle count, each stretch at the clock then in force.
+  * @param  json: Writer state
+  * @param  cycles: Cycles since time 0, not before the last clock change
+  * @retval Nanoseconds since time 0
+  */
+static uint64_t TRACE_Nanoseconds(const TRACE_JsonTypeDef *json, uint64_t cycles)
+{
+  uint64_t delta = cycles - json->ClockCycles;
+  uint32_t cpu_hz = json->CpuHz;
+
+  /* Split first: cycles * 1e9 overflows 64 bits after a few hours */
+  return json->ClockNs + (delta / cpu_hz) * 1000000000U + ((delta % cpu_hz) * 1000000000U) / cpu_hz;
+}
+
+/**
+  * @brief  Append the time of the last event as microseconds with
+  *         nanosecond resolution.
+  * @param  json: Writer state
+  * @param  out: Output buffer
+  * @param  size: Size of out
+  * @param  len: Current length, advanced
+  * @retval None
+  */
+static void TRACE_AppendTime(TRACE_JsonTypeDef *json, char *out, uint32_t size, uint32_t *len)
+{
+  uint64_t ns = TRACE_Nanoseconds(json, json->Cycles);
+
+  TRACE_Append(out, size, len, "%llu.%03u", (unsigned long long)(ns / 1000U), (unsigned)(ns % 1000U));
+}
+
+/**
+  * @brief  Append one B or E slice event.
+  * @param  json: Writer state
+  * @param  out: Output buffer
+  * @param  size: Size of out
+  * @param  len: Current length, advanced
+  * @param  name: Slice name
+  * @param  cat: Category
+  * @param  phase: 'B' or 'E'
+  * @param  tid: Track
+  * @retval None
+  */
+static void TRACE_AppendSlice(TRACE_JsonTypeDef *json, char *out, uint32_t size, uint32_t *len,
+                              const char *name, const char *cat, char phase, int tid)
+{
+  TRACE_Append(out, size, len, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":",
+               (json->Written != 0U) ? ",\n" : "", name, cat, phase);
+  TRACE_AppendTime(json, out, size, len);
+  TRACE_Append(out, size, len, ",\"pid\":1,\"tid\":%d}", tid);
+  json->Written++;
+}
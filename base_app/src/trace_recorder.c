@@ -0,0 +1,157 @@
+/**
+  ******************************************************************************
+  * @file    trace_recorder.c
+  * @brief   Firmware event trace recorder.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "trace_recorder.h"
+#include "console_lz.h"
+#include "dwt.h"
+
+/* Private define ------------------------------------------------------------*/
+#define TRACE_COST_SAMPLES  16U
+
+#if (TRACE_RECORDS & (TRACE_RECORDS - 1U)) != 0U
+#error "TRACE_RECORDS must be a power of two"
+#endif
+#if TRACE_RECORDS > 4096U
+#error "TRACE_RECORDS: a span must fit one HAL_UART_Transmit()"
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+TRACE_RingTypeDef TraceRing;
+volatile uint8_t  TraceEnabled;
+
+static TRACE_RecordTypeDef TraceRecords[TRACE_RECORDS];
+static uint32_t            TraceCost;
+static uint32_t            TraceClockHz;    /* HCLK, also while paused */
+
+/* Private function prototypes -----------------------------------------------*/
+static void TRACE_RECORDER_Resume(uint8_t enabled);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Start the cycle counter, calibrate the cost of one event and
+  *         start recording. Call once the system clock is final.
+  * @retval None
+  */
+void TRACE_RECORDER_Init(void)
+{
+  uint32_t start;
+  uint32_t i;
+
+  DWT_Init();
+  TraceClockHz = SystemCoreClock;
+  (void)TRACE_Init(&TraceRing, TraceRecords, TRACE_RECORDS, TraceClockHz, DWT_Cycles());
+  TraceEnabled = 1U;
+
+  start = DWT_Cycles();
+  for (i = 0U; i < TRACE_COST_SAMPLES; i++)
+  {
+    TRACE_Event(TRACE_EV_MARK, i);
+  }
+  TraceCost = (DWT_Cycles() - start) / TRACE_COST_SAMPLES;
+
+  TRACE_Reset(&TraceRing, DWT_Cycles());
+}
+
+/**
+  * @brief  Resume recording.
+  * @retval None
+  */
+void TRACE_RECORDER_Start(void)
+{
+  TRACE_RECORDER_Resume(1U);
+}
+
+/**
+  * @brief  Pause recording, the ring keeps its contents.
+  * @retval None
+  */
+void TRACE_RECORDER_Stop(void)
+{
+  TraceEnabled = 0U;
+}
+
+/**
+  * @brief  Record a change of HCLK, the cycle counter's clock; while paused
+  *         it is recorded on resuming.
+  * @param  cpu_hz: New HCLK
+  * @retval None
+  */
+void TRACE_RECORDER_Clock(uint32_t cpu_hz)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  TraceClockHz = cpu_hz;
+  if (TraceEnabled != 0U)
+  {
+    TRACE_Clock(&TraceRing, DWT->CYCCNT, cpu_hz);
+  }
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Cycles spent per recorded event, loop overhead included.
+  * @retval Cycles, 0 before TRACE_RECORDER_Init()
+  */
+uint32_t TRACE_RECORDER_Cost(void)
+{
+  return TraceCost;
+}
+
+/**
+  * @brief  Send the ring as a dump (trace.h) over a UART, blocking.
+  *         Recording is paused meanwhile so the dump is consistent. With
+  *         the compressed console it goes out in pass-through blocks.
+  * @param  huart: Initialised UART handle
+  * @retval HAL status of the first failing transmit
+  */
+HAL_StatusTypeDef TRACE_RECORDER_Dump(UART_HandleTypeDef *huart)
+{
+  TRACE_DumpHeaderTypeDef header;
+  const TRACE_RecordTypeDef *span;
+  HAL_StatusTypeDef status;
+  uint8_t enabled = TraceEnabled;
+  uint32_t count;
+  uint32_t part;
+
+  TraceEnabled = 0U;
+  TRACE_DumpHeader(&TraceRing, &header);
+  status = CONSOLE_LZ_Binary(huart, (const uint8_t *)&header, sizeof(header));
+  for (part = 0U; (part < 2U) && (status == HAL_OK); part++)
+  {
+    span = TRACE_Span(&TraceRing, part, &count);
+    if (count != 0U)
+    {
+      status = CONSOLE_LZ_Binary(huart, (const uint8_t *)span, (uint16_t)(count * sizeof(*span)));
+    }
+  }
+  TRACE_RECORDER_Resume(enabled);
+  return status;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Set the recording state, first catching up on a clock change
+  *         made while paused.
+  * @param  enabled: 1 to record
+  * @retval None
+  */
+static void TRACE_RECORDER_Resume(uint8_t enabled)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  if ((enabled != 0U) && (TraceRing.Records != NULL))
+  {
+    TRACE_Clock(&TraceRing, DWT->CYCCNT, TraceClockHz);
+  }
+  TraceEnabled = enabled;
+  __set_PRIMASK(primask);
+}
@@ -0,0 +1,797 @@
+/**
+  ******************************************************************************
+  * @file    usb_cdc.c
+  * @brief   USB full-speed CDC-ACM device: descriptors, enumeration, data.
+  ******************************************************************************
+  * Control transfers go through a small stage machine on endpoint 0: a
+  * request is answered from a descriptor or from Ep0Buf one packet at a
+  * time (DATA_IN), or takes up to one packet of data (DATA_OUT), and ends
+  * with the status stage in the other direction. Anything not understood
+  * stalls both halves of endpoint 0 until the next SETUP.
+  *
+  * The device advertises one configuration with the communication
+  * interface (notification endpoint 0x82, never used: the serial state
+  * does not change) and the data interface (bulk 0x01 and 0x81). Line
+  * coding is stored and echoed back; the baud rate means nothing on USB.
+  *
+  * Write() is for one writer (task) at a time; every controller event
+  * arrives from one context (the controller interrupt on the target).
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usb_cdc.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define USB_CDC_TX_MASK         (USB_CDC_TX_SIZE - 1U)
+#define USB_CDC_TX_CHUNK        (USB_CDC_TX_SIZE / 2U)
+#define USB_CDC_RX_MASK         (USB_CDC_RX_SIZE - 1U)
+#define USB_CDC_STRING_MAX      ((USB_CDC_EP0_SIZE - 2U) / 2U)
+#define USB_CDC_CONFIG_LENGTH   67U
+
+#define USB_CDC_MANUFACTURER    "STMicroelectronics"
+#define USB_CDC_PRODUCT         "STM32F4 Virtual COM Port"
+
+/* bmRequestType */
+#define USB_REQ_DIR_IN          0x80U
+#define USB_REQ_TYPE_MASK       0x60U
+#define USB_REQ_TYPE_STANDARD   0x00U
+#define USB_REQ_TYPE_CLASS      0x20U
+#define USB_REQ_RECIPIENT_MASK  0x1FU
+#define USB_REQ_DEVICE          0x00U
+#define USB_REQ_INTERFACE       0x01U
+#define USB_REQ_ENDPOINT        0x02U
+
+/* bRequest */
+#define USB_REQ_GET_STATUS      0x00U
+#define USB_REQ_CLEAR_FEATURE   0x01U
+#define USB_REQ_SET_FEATURE     0x03U
+#define USB_REQ_SET_ADDRESS     0x05U
+#define USB_REQ_GET_DESCRIPTOR  0x06U
+#define USB_REQ_GET_CONFIG      0x08U
+#define USB_REQ_SET_CONFIG      0x09U
+#define USB_REQ_GET_INTERFACE   0x0AU
+#define USB_REQ_SET_INTERFACE   0x0BU
+#define USB_FEATURE_EP_HALT     0x00U
+
+#define CDC_SET_LINE_CODING     0x20U
+#define CDC_GET_LINE_CODING     0x21U
+#define CDC_SET_LINE_STATE      0x22U
+#define CDC_SEND_BREAK          0x23U
+
+#define USB_DESC_DEVICE         0x01U
+#define USB_DESC_CONFIG         0x02U
+#define USB_DESC_STRING         0x03U
+
+#define LO(x)                   ((uint8_t)((x) & 0xFFU))
+#define HI(x)                   ((uint8_t)((x) >> 8))
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+  EP0_IDLE = 0U,
+  EP0_DATA_IN,
+  EP0_DATA_OUT,
+  EP0_STATUS_IN,
+  EP0_STATUS_OUT
+} USB_CDC_Ep0StageTypeDef;
+
+/** What a request handler wants done next */
+typedef enum
+{
+  EP0_STALL = 0U,
+  EP0_STATUS,                 /*!< No data: status stage (IN ZLP)         */
+  EP0_REPLY,                  /*!< Data stage IN from *data               */
+  EP0_RECEIVE                 /*!< Data stage OUT armed into Ep0Buf       */
+} USB_CDC_Ep0ActionTypeDef;
+
+typedef struct
+{
+  uint8_t  Type;
+  uint8_t  Request;
+  uint16_t Value;
+  uint16_t Index;
+  uint16_t Length;
+} USB_CDC_RequestTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t UsbCdcDevice[18] =
+{
+  18U, USB_DESC_DEVICE, 0x00U, 0x02U,             /* USB 2.0                 */
+  0x02U, 0x00U, 0x00U, USB_CDC_EP0_SIZE,          /* CDC at device level     */
+  LO(USB_CDC_VID), HI(USB_CDC_VID), LO(USB_CDC_PID), HI(USB_CDC_PID),
+  0x00U, 0x02U, 1U, 2U, 3U, 1U                    /* Release, strings, configs */
+};
+
+static const uint8_t UsbCdcConfig[USB_CDC_CONFIG_LENGTH] =
+{
+  9U, USB_DESC_CONFIG, USB_CDC_CONFIG_LENGTH, 0U, 2U, 1U, 0U, 0x80U, 50U,  /* 100 mA */
+  /* Interface 0: communication, abstract control model */
+  9U, 0x04U, 0U, 0U, 1U, 0x02U, 0x02U, 0x01U, 0U,
+  5U, 0x24U, 0x00U, 0x10U, 0x01U,                 /* Header, CDC 1.10        */
+  5U, 0x24U, 0x01U, 0x00U, 1U,                    /* Call management         */
+  4U, 0x24U, 0x02U, 0x02U,                        /* ACM: line coding, state */
+  5U, 0x24U, 0x06U, 0U, 1U,                       /* Union: 0 controls 1     */
+  7U, 0x05U, USB_CDC_EP_NOTIFY, USB_CDC_EP_INTERRUPT, USB_CDC_NOTIFY_SIZE, 0U, 16U,
+  /* Interface 1: data */
+  9U, 0x04U, 1U, 0U, 2U, 0x0AU, 0x00U, 0x00U, 0U,
+  7U, 0x05U, USB_CDC_EP_OUT, USB_CDC_EP_BULK, USB_CDC_DATA_SIZE, 0U, 0U,
+  7U, 0x05U, USB_CDC_EP_IN, USB_CDC_EP_BULK, USB_CDC_DATA_SIZE, 0U, 0U
+};
+
+static const uint8_t UsbCdcLanguage[4] = { 4U, USB_DESC_STRING, 0x09U, 0x04U };  /* en-US */
+
+_Static_assert((USB_CDC_TX_SIZE & USB_CDC_TX_MASK) == 0U, "USB_CDC_TX_SIZE: not a power of two");
+_Static_assert((USB_CDC_RX_SIZE & USB_CDC_RX_MASK) == 0U, "USB_CDC_RX_SIZE: not a power of two");
+_Static_assert(USB_CDC_RX_SIZE >= 2U * USB_CDC_DATA_SIZE, "USB_CDC_RX_SIZE: below two packets");
+
+/* Private function prototypes -----------------------------------------------*/
+static USB_CDC_Ep0ActionTypeDef USB_CDC_Standard(USB_CDC_HandleTypeDef *h, const USB_CDC_RequestTypeDef *req,
+                                                 const uint8_t **data, uint32_t *size);
+static USB_CDC_Ep0ActionTypeDef USB_CDC_Class(USB_CDC_HandleTypeDef *h, const USB_CDC_RequestTypeDef *req,
+                                              const uint8_t **data, uint32_t *size);
+static void     USB_CDC_Configure(USB_CDC_HandleTypeDef *h, uint8_t config);
+static uint32_t USB_CDC_String(USB_CDC_HandleTypeDef *h, const char *text, const uint8_t **data);
+static void     USB_CDC_Ep0Next(USB_CDC_HandleTypeDef *h);
+static void     USB_CDC_StallEp0(USB_CDC_HandleTypeDef *h);
+static uint8_t  USB_CDC_EpBit(uint8_t ep);
+static void     USB_CDC_StartTx(USB_CDC_HandleTypeDef *h);
+static void     USB_CDC_ArmOut(USB_CDC_HandleTypeDef *h);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Set up the device; it stays invisible until the controller
+  *         reports a bus reset.
+  * @param  h: Device
+  * @param  pcd: Controller operations
+  * @param  serial: Serial number string, kept by reference
+  * @retval None
+  */
+void USB_CDC_Init(USB_CDC_HandleTypeDef *h, const USB_CDC_PcdTypeDef *pcd, const char *serial)
+{
+  static const uint8_t coding[7] = { 0x00U, 0xC2U, 0x01U, 0x00U, 0U, 0U, 8U };  /* 115200 8N1 */
+
+  memset(h, 0, sizeof(*h));
+  h->Pcd = pcd;
+  h->Serial = serial;
+  memcpy(h->LineCoding, coding, sizeof(coding));
+}
+
+/**
+  * @brief  Queue bytes for the bulk IN endpoint, all or nothing. The bytes
+  *         are copied once, into the ring, and go out from there.
+  * @param  h: Device
+  * @param  data: Bytes
+  * @param  length: Count
+  * @retval length, or 0 if not configured or the ring lacks room
+  */
+uint32_t USB_CDC_Write(USB_CDC_HandleTypeDef *h, const void *data, uint32_t length)
+{
+  uint32_t head = h->TxHead;
+  uint32_t index = head & USB_CDC_TX_MASK;
+  uint32_t first;
+  uint32_t state;
+
+  if ((h->State != USB_CDC_CONFIGURED) || (length > (USB_CDC_TX_SIZE - (head - h->TxTail))))
+  {
+    h->Stats.TxDropped += length;
+    return 0U;
+  }
+  first = (length < (USB_CDC_TX_SIZE - index)) ? length : (USB_CDC_TX_SIZE - index);
+  memcpy(&h->TxBuf[index], data, first);
+  memcpy(h->TxBuf, (const uint8_t *)data + first, length - first);
+  h->TxHead = head + length;
+
+  state = h->Pcd->Lock();
+  if ((h->TxBusy == 0U) && (h->State == USB_CDC_CONFIGURED))
+  {
+    USB_CDC_StartTx(h);
+  }
+  h->Pcd->Unlock(state);
+  return length;
+}
+
+/**
+  * @brief  Take received bytes; makes room for the next packet.
+  * @param  h: Device
+  * @param  data: Destination
+  * @param  length: Room at data
+  * @retval Bytes copied
+  */
+uint32_t USB_CDC_Read(USB_CDC_HandleTypeDef *h, void *data, uint32_t length)
+{
+  uint8_t *out = data;
+  uint32_t tail = h->RxTail;
+  uint32_t count = h->RxHead - tail;
+  uint32_t i;
+  uint32_t state;
+
+  count = (count < length) ? count : length;
+  for (i = 0U; i < count; i++)
+  {
+    out[i] = h->RxBuf[(tail + i) & USB_CDC_RX_MASK];
+  }
+  h->RxTail = tail + count;
+
+  state = h->Pcd->Lock();
+  if ((h->RxArmed == 0U) && (h->State == USB_CDC_CONFIGURED) &&
+      ((USB_CDC_RX_SIZE - (h->RxHead - h->RxTail)) >= USB_CDC_DATA_SIZE))
+  {
+    USB_CDC_ArmOut(h);
+  }
+  h->Pcd->Unlock(state);
+  return count;
+}
+
+/**
+  * @brief  Room in the transmit ring.
+  * @param  h: Device
+  * @retval Bytes Write() would take now
+  */
+uint32_t USB_CDC_TxFree(const USB_CDC_HandleTypeDef *h)
+{
+  return USB_CDC_TX_SIZE - (h->TxHead - h->TxTail);
+}
+
+/**
+  * @brief  A host program has the port open: configured with DTR set.
+  * @param  h: Device
+  * @retval 1 if open
+  */
+uint8_t USB_CDC_Connected(const USB_CDC_HandleTypeDef *h)
+{
+  return ((h->State == USB_CDC_CONFIGURED) && ((h->LineState & USB_CDC_DTR) != 0U)) ? 1U : 0U;
+}
+
+/**
+  * @brief  Descriptor for GET_DESCRIPTOR. String descriptors are built in
+  *         Ep0Buf from ASCII, at most USB_CDC_STRING_MAX characters.
+  * @param  h: Device
+  * @param  value: wValue, type in the high byte and index in the low
+  * @param  data: Set to the descriptor
+  * @retval Length, 0 if there is no such descriptor
+  */
+uint32_t USB_CDC_Descriptor(USB_CDC_HandleTypeDef *h, uint16_t value, const uint8_t **data)
+{
+  uint8_t index = (uint8_t)(value & 0xFFU);
+
+  switch (value >> 8)
+  {
+    case USB_DESC_DEVICE:
+      *data = UsbCdcDevice;
+      return (index == 0U) ? sizeof(UsbCdcDevice) : 0U;
+    case USB_DESC_CONFIG:
+      *data = UsbCdcConfig;
+      return (index == 0U) ? sizeof(UsbCdcConfig) : 0U;
+    case USB_DESC_STRING:
+      switch (index)
+      {
+        case 0U:
+          *data = UsbCdcLanguage;
+          return sizeof(UsbCdcLanguage);
+        case 1U:
+          return USB_CDC_String(h, USB_CDC_MANUFACTURER, data);
+        case 2U:
+          return USB_CDC_String(h, USB_CDC_PRODUCT, data);
+        case 3U:
+          return USB_CDC_String(h, (h->Serial != NULL) ? h->Serial : "0", data);
+        default:
+          return 0U;
+      }
+    default:
+      return 0U;                                /* Device qualifier too: FS only */
+  }
+}
+
+/**
+  * @brief  Bus reset: back to the default state with endpoint 0 open.
+  *         Unsent data is dropped.
+  * @param  h: Device
+  * @retval None
+  */
+void USB_CDC_Reset(USB_CDC_HandleTypeDef *h)
+{
+  h->Stats.Resets++;
+  h->State = USB_CDC_DEFAULT;
+  h->Config = 0U;
+  h->LineState = 0U;
+  h->Halted = 0U;
+  h->Ep0Stage = EP0_IDLE;
+  h->TxBusy = 0U;
+  h->TxLength = 0U;
+  h->TxTail = h->TxHead;
+  h->RxArmed = 0U;
+  h->Pcd->Open(0x00U, USB_CDC_EP_CONTROL, USB_CDC_EP0_SIZE);
+  h->Pcd->Open(0x80U, USB_CDC_EP_CONTROL, USB_CDC_EP0_SIZE);
+}
+
+/**
+  * @brief  A SETUP packet arrived on endpoint 0; it cancels any control
+  *         transfer in progress.
+  * @param  h: Device
+  * @param  setup: The 8 bytes
+  * @retval None
+  */
+void USB_CDC_Setup(USB_CDC_HandleTypeDef *h, const uint8_t *setup)
+{
+  USB_CDC_RequestTypeDef req;
+  USB_CDC_Ep0ActionTypeDef action;
+  const uint8_t *data = NULL;
+  uint32_t size = 0U;
+
+  req.Type = setup[0];
+  req.Request = setup[1];
+  req.Value = (uint16_t)(setup[2] | (setup[3] << 8));
+  req.Index = (uint16_t)(setup[4] | (setup[5] << 8));
+  req.Length = (uint16_t)(setup[6] | (setup[7] << 8));
+  h->Stats.Setups++;
+  h->Ep0Stage = EP0_IDLE;
+  h->Ep0Request = 0U;
+
+  switch (req.Type & USB_REQ_TYPE_MASK)
+  {
+    case USB_REQ_TYPE_STANDARD:
+      action = USB_CDC_Standard(h, &req, &data, &size);
+      break;
+    case USB_REQ_TYPE_CLASS:
+      action = USB_CDC_Class(h, &req, &data, &size);
+      break;
+    default:
+      action = EP0_STALL;
+      break;
+  }
+  /* The direction bit has to agree with what the request does */
+  if (((action == EP0_REPLY) && (((req.Type & USB_REQ_DIR_IN) == 0U) || (req.Length == 0U))) ||
+      ((action == EP0_RECEIVE) && ((req.Type & USB_REQ_DIR_IN) != 0U)))
+  {
+    action = EP0_STALL;
+  }
+
+  switch (action)
+  {
+    case EP0_REPLY:
+      h->Ep0Data = data;
+      h->Ep0Left = (uint16_t)((size < req.Length) ? size : req.Length);
+      h->Ep0Zlp = ((size < req.Length) && ((size % USB_CDC_EP0_SIZE) == 0U)) ? 1U : 0U;
+      h->Ep0Stage = EP0_DATA_IN;
+      USB_CDC_Ep0Next(h);
+      break;
+    case EP0_RECEIVE:
+      h->Ep0Request = req.Request;
+      h->Ep0Stage = EP0_DATA_OUT;
+      h->Pcd->Receive(0x00U, h->Ep0Buf, req.Length);
+      break;
+    case EP0_STATUS:
+      h->Ep0Stage = EP0_STATUS_IN;
+      h->Pcd->Transmit(0x80U, NULL, 0U);
+      break;
+    default:
+      USB_CDC_StallEp0(h);
+      break;
+  }
+}
+
+/**
+  * @brief  An IN transfer finished: the host took all of it.
+  * @param  h: Device
+  * @param  ep: Endpoint address, bit 7 set
+  * @retval None
+  */
+void USB_CDC_DataIn(USB_CDC_HandleTypeDef *h, uint8_t ep)
+{
+  uint32_t sent;
+
+  if (ep == 0x80U)
+  {
+    switch (h->Ep0Stage)
+    {
+      case EP0_DATA_IN:
+        if (h->Ep0Left != 0U)
+        {
+          USB_CDC_Ep0Next(h);
+        }
+        else if (h->Ep0Zlp != 0U)
+        {
+          h->Ep0Zlp = 0U;
+          h->Pcd->Transmit(0x80U, NULL, 0U);
+        }
+        else
+        {
+          h->Ep0Stage = EP0_STATUS_OUT;
+          h->Pcd->Receive(0x00U, h->Ep0Buf, 0U);
+        }
+        break;
+      case EP0_STATUS_IN:
+        h->Ep0Stage = EP0_IDLE;
+        break;
+      default:
+        break;
+    }
+    return;
+  }
+  if ((ep != USB_CDC_EP_IN) || (h->TxBusy == 0U))
+  {
+    return;
+  }
+
+  /* The ring region is free again; keep the endpoint busy if there is more */
+  sent = h->TxLength;
+  h->TxTail += sent;
+  h->TxLength = 0U;
+  h->TxBusy = 0U;
+  h->Stats.TxBytes += sent;
+  if (h->State != USB_CDC_CONFIGURED)
+  {
+    return;
+  }
+  if (h->TxHead != h->TxTail)
+  {
+    USB_CDC_StartTx(h);
+  }
+  else if ((sent != 0U) && ((sent % USB_CDC_DATA_SIZE) == 0U))
+  {
+    h->TxBusy = 1U;
+    h->Stats.TxZlps++;
+    h->Pcd->Transmit(USB_CDC_EP_IN, NULL, 0U);
+  }
+}
+
+/**
+  * @brief  An OUT packet arrived in the buffer given to Receive().
+  * @param  h: Device
+  * @param  ep: Endpoint address
+  * @param  length: Bytes received
+  * @retval None
+  */
+void USB_CDC_DataOut(USB_CDC_HandleTypeDef *h, uint8_t ep, uint32_t length)
+{
+  uint32_t head;
+  uint32_t i;
+
+  if (ep == 0x00U)
+  {
+    switch (h->Ep0Stage)
+    {
+      case EP0_DATA_OUT:
+        if ((h->Ep0Request == CDC_SET_LINE_CODING) && (length >= sizeof(h->LineCoding)))
+        {
+          memcpy(h->LineCoding, h->Ep0Buf, sizeof(h->LineCoding));
+        }
+        h->Ep0Stage = EP0_STATUS_IN;
+        h->Pcd->Transmit(0x80U, NULL, 0U);
+        break;
+      case EP0_STATUS_OUT:
+        h->Ep0Stage = EP0_IDLE;
+        break;
+      default:
+        break;
+    }
+    return;
+  }
+  if ((ep != USB_CDC_EP_OUT) || (h->RxArmed == 0U))
+  {
+    return;
+  }
+
+  /* Arming needs a packet of room, so this always fits */
+  head = h->RxHead;
+  length = (length < USB_CDC_DATA_SIZE) ? length : USB_CDC_DATA_SIZE;
+  for (i = 0U; i < length; i++)
+  {
+    h->RxBuf[(head + i) & USB_CDC_RX_MASK] = h->RxPacket[i];
+  }
+  h->RxHead = head + length;
+  h->RxArmed = 0U;
+  h->Stats.RxBytes += length;
+  if ((USB_CDC_RX_SIZE - (h->RxHead - h->RxTail)) >= USB_CDC_DATA_SIZE)
+  {
+    USB_CDC_ArmOut(h);
+  }
+  else
+  {
+    h->Stats.RxPaused++;                        /* NAK until Read() */
+  }
+}
+
+/**
+  * @brief  The bus went idle for 3 ms.
+  * @param  h: Device
+  * @retval None
+  */
+void USB_CDC_Suspend(USB_CDC_HandleTypeDef *h)
+{
+  if (h->State != USB_CDC_SUSPENDED)
+  {
+    h->Resume = h->State;
+    h->State = USB_CDC_SUSPENDED;
+  }
+}
+
+/**
+  * @brief  Bus activity after a suspend.
+  * @param  h: Device
+  * @retval None
+  */
+void USB_CDC_Resume(USB_CDC_HandleTypeDef *h)
+{
+  if (h->State == USB_CDC_SUSPENDED)
+  {
+    h->State = h->Resume;
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Chapter 9 requests.
+  * @retval Next step for endpoint 0
+  */
+static USB_CDC_Ep0ActionTypeDef USB_CDC_Standard(USB_CDC_HandleTypeDef *h, const USB_CDC_RequestTypeDef *req,
+                                                 const uint8_t **data, uint32_t *size)
+{
+  uint8_t recipient = req->Type & USB_REQ_RECIPIENT_MASK;
+  uint8_t ep = (uint8_t)(req->Index & 0xFFU);
+  uint8_t bit = USB_CDC_EpBit(ep);
+  uint8_t configured = (h->State == USB_CDC_CONFIGURED) ? 1U : 0U;
+
+  *data = h->Ep0Buf;
+  switch (req->Request)
+  {
+    case USB_REQ_GET_STATUS:
+      h->Ep0Buf[0] = 0U;
+      h->Ep0Buf[1] = 0U;
+      if (recipient == USB_REQ_ENDPOINT)
+      {
+        if ((bit == 0U) && ((ep & 0x7FU) != 0U))
+        {
+          return EP0_STALL;
+        }
+        h->Ep0Buf[0] = ((h->Halted & bit) != 0U) ? 1U : 0U;
+      }
+      *size = 2U;
+      return EP0_REPLY;
+
+    case USB_REQ_CLEAR_FEATURE:
+    case USB_REQ_SET_FEATURE:
+      if ((recipient != USB_REQ_ENDPOINT) || (req->Value != USB_FEATURE_EP_HALT) ||
+          ((bit == 0U) && ((ep & 0x7FU) != 0U)))
+      {
+        return EP0_STALL;
+      }
+      if (bit == 0U)
+      {
+        return EP0_STATUS;                      /* Endpoint 0 never halts */
+      }
+      if (req->Request == USB_REQ_SET_FEATURE)
+      {
+        h->Halted |= bit;
+        h->Pcd->Stall(ep);
+        return EP0_STATUS;
+      }
+      h->Halted &= (uint8_t)~bit;
+      h->Pcd->ClearStall(ep);
+      if (ep == USB_CDC_EP_IN)
+      {
+        /* The transfer in flight was dropped; send its bytes again */
+        h->TxBusy = 0U;
+        h->TxLength = 0U;
+        if ((configured != 0U) && (h->TxHead != h->TxTail))
+        {
+          USB_CDC_StartTx(h);
+        }
+      }
+      else if ((ep == USB_CDC_EP_OUT) && (configured != 0U))
+      {
+        h->RxArmed = 0U;
+        if ((USB_CDC_RX_SIZE - (h->RxHead - h->RxTail)) >= USB_CDC_DATA_SIZE)
+        {
+          USB_CDC_ArmOut(h);
+        }
+      }
+      return EP0_STATUS;
+
+    case USB_REQ_SET_ADDRESS:
+      if ((recipient != USB_REQ_DEVICE) || (req->Value > 127U) || (configured != 0U))
+      {
+        return EP0_STALL;
+      }
+      /* OTG_FS takes it at once and still answers the status stage at 0 */
+      h->Pcd->SetAddress((uint8_t)req->Value);
+      h->State = (req->Value != 0U) ? USB_CDC_ADDRESSED : USB_CDC_DEFAULT;
+      return EP0_STATUS;
+
+    case USB_REQ_GET_DESCRIPTOR:
+      *size = USB_CDC_Descriptor(h, req->Value, data);
+      return (*size != 0U) ? EP0_REPLY : EP0_STALL;
+
+    case USB_REQ_GET_CONFIG:
+      h->Ep0Buf[0] = h->Config;
+      *size = 1U;
+      return EP0_REPLY;
+
+    case USB_REQ_SET_CONFIG:
+      if ((req->Value > 1U) || (h->State == USB_CDC_DEFAULT))
+      {
+        return EP0_STALL;
+      }
+      USB_CDC_Configure(h, (uint8_t)req->Value);
+      return EP0_STATUS;
+
+    case USB_REQ_GET_INTERFACE:
+      if ((configured == 0U) || (recipient != USB_REQ_INTERFACE) || (req->Index > 1U))
+      {
+        return EP0_STALL;
+      }
+      h->Ep0Buf[0] = 0U;
+      *size = 1U;
+      return EP0_REPLY;
+
+    case USB_REQ_SET_INTERFACE:
+      return ((configured != 0U) && (recipient == USB_REQ_INTERFACE) && (req->Index <= 1U) &&
+              (req->Value == 0U)) ? EP0_STATUS : EP0_STALL;
+
+    default:
+      return EP0_STALL;
+  }
+}
+
+/**
+  * @brief  CDC-ACM requests to the communication interface.
+  * @retval Next step for endpoint 0
+  */
+static USB_CDC_Ep0ActionTypeDef USB_CDC_Class(USB_CDC_HandleTypeDef *h, const USB_CDC_RequestTypeDef *req,
+                                              const uint8_t **data, uint32_t *size)
+{
+  if (((req->Type & USB_REQ_RECIPIENT_MASK) != USB_REQ_INTERFACE) || (req->Index != 0U))
+  {
+    return EP0_STALL;
+  }
+  switch (req->Request)
+  {
+    case CDC_SET_LINE_CODING:
+      return (req->Length == sizeof(h->LineCoding)) ? EP0_RECEIVE : EP0_STALL;
+    case CDC_GET_LINE_CODING:
+      *data = h->LineCoding;
+      *size = sizeof(h->LineCoding);
+      return EP0_REPLY;
+    case CDC_SET_LINE_STATE:
+      h->LineState = (uint8_t)(req->Value & (USB_CDC_DTR | USB_CDC_RTS));
+      return EP0_STATUS;
+    case CDC_SEND_BREAK:
+      return EP0_STATUS;
+    default:
+      return EP0_STALL;
+  }
+}
+
+/**
+  * @brief  SET_CONFIGURATION: open or close the data endpoints.
+  * @param  h: Device
+  * @param  config: 0 or 1
+  * @retval None
+  */
+static void USB_CDC_Configure(USB_CDC_HandleTypeDef *h, uint8_t config)
+{
+  h->Config = config;
+  h->Halted = 0U;
+  h->TxBusy = 0U;
+  h->TxLength = 0U;
+  h->TxTail = h->TxHead;
+  h->RxArmed = 0U;
+  if (config == 0U)
+  {
+    h->State = USB_CDC_ADDRESSED;
+    return;
+  }
+  h->Pcd->Open(USB_CDC_EP_NOTIFY, USB_CDC_EP_INTERRUPT, USB_CDC_NOTIFY_SIZE);
+  h->Pcd->Open(USB_CDC_EP_IN, USB_CDC_EP_BULK, USB_CDC_DATA_SIZE);
+  h->Pcd->Open(USB_CDC_EP_OUT, USB_CDC_EP_BULK, USB_CDC_DATA_SIZE);
+  h->RxHead = h->RxTail;
+  h->State = USB_CDC_CONFIGURED;
+  USB_CDC_ArmOut(h);
+}
+
+/**
+  * @brief  String descriptor from ASCII, UTF-16LE in Ep0Buf.
+  * @retval Length
+  */
+static uint32_t USB_CDC_String(USB_CDC_HandleTypeDef *h, const char *text, const uint8_t **data)
+{
+  uint32_t n;
+
+  for (n = 0U; (n < USB_CDC_STRING_MAX) && (text[n] != '\0'); n++)
+  {
+    h->Ep0Buf[2U + 2U * n] = (uint8_t)text[n];
+    h->Ep0Buf[3U + 2U * n] = 0U;
+  }
+  h->Ep0Buf[0] = (uint8_t)(2U + 2U * n);
+  h->Ep0Buf[1] = USB_DESC_STRING;
+  *data = h->Ep0Buf;
+  return 2U + 2U * n;
+}
+
+/**
+  * @brief  Next packet of the IN data stage.
+  * @retval None
+  */
+static void USB_CDC_Ep0Next(USB_CDC_HandleTypeDef *h)
+{
+  uint32_t n = (h->Ep0Left < USB_CDC_EP0_SIZE) ? h->Ep0Left : USB_CDC_EP0_SIZE;
+  const uint8_t *data = h->Ep0Data;
+
+  h->Ep0Data += n;
+  h->Ep0Left = (uint16_t)(h->Ep0Left - n);
+  h->Pcd->Transmit(0x80U, data, n);
+}
+
+/**
+  * @brief  Refuse the request: both halves of endpoint 0 stall until the
+  *         next SETUP clears them.
+  * @retval None
+  */
+static void USB_CDC_StallEp0(USB_CDC_HandleTypeDef *h)
+{
+  h->Stats.Stalls++;
+  h->Ep0Stage = EP0_IDLE;
+  h->Pcd->Stall(0x80U);
+  h->Pcd->Stall(0x00U);
+}
+
+/**
+  * @brief  Halt bit of a data endpoint.
+  * @retval Bit in Halted, 0 for endpoint 0 and unknown endpoints
+  */
+static uint8_t USB_CDC_EpBit(uint8_t ep)
+{
+  switch (ep)
+  {
+    case USB_CDC_EP_OUT:
+      return 0x01U;
+    case USB_CDC_EP_IN:
+      return 0x02U;
+    case USB_CDC_EP_NOTIFY:
+      return 0x04U;
+    default:
+      return 0U;
+  }
+}
+
+/**
+  * @brief  Hand the oldest contiguous bytes of the ring, up to half of it,
+  *         to the bulk IN endpoint. Caller holds the lock or is the
+  *         controller interrupt.
+  * @retval None
+  */
+static void USB_CDC_StartTx(USB_CDC_HandleTypeDef *h)
+{
+  uint32_t tail = h->TxTail;
+  uint32_t index = tail & USB_CDC_TX_MASK;
+  uint32_t n = h->TxHead - tail;
+
+  if ((n == 0U) || ((h->Halted & USB_CDC_EpBit(USB_CDC_EP_IN)) != 0U))
+  {
+    return;
+  }
+  n = (n < (USB_CDC_TX_SIZE - index)) ? n : (USB_CDC_TX_SIZE - index);
+  n = (n < USB_CDC_TX_CHUNK) ? n : USB_CDC_TX_CHUNK;
+  h->TxLength = n;
+  h->TxBusy = 1U;
+  h->Stats.TxTransfers++;
+  h->Pcd->Transmit(USB_CDC_EP_IN, &h->TxBuf[index], n);
+}
+
+/**
+  * @brief  Let the host send the next OUT packet.
+  * @retval None
+  */
+static void USB_CDC_ArmOut(USB_CDC_HandleTypeDef *h)
+{
+  if ((h->Halted & USB_CDC_EpBit(USB_CDC_EP_OUT)) != 0U)
+  {
+    return;
+  }
+  h->RxArmed = 1U;
+  h->Pcd->Receive(USB_CDC_EP_OUT, h->RxPacket, USB_CDC_DATA_SIZE);
+}
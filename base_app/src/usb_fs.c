@@ -0,0 +1,823 @@
+/**
+  ******************************************************************************
+  * @file    usb_fs.c
+  * @brief   OTG_FS in device mode, the controller behind the USB virtual COM
+  *          port.
+  ******************************************************************************
+  * The Discovery board's micro-AB socket (CN5) is wired to:
+  *
+  *   PA11 OTG_FS_DM    PA12 OTG_FS_DP    (AF10)
+  *
+  * PA9 (VBUS) and PA10 (ID) are left alone: VBUS sensing is off and the
+  * core is forced to device mode.
+  *
+  * There is no HAL PCD/LL USB driver in this tree, so the peripheral is
+  * programmed directly. The core runs on PLL48CLK from the PLL Q output,
+  * which clock_config.h keeps at exactly 48 MHz at every PLL operating
+  * point; the AHB side only has to stay above USB_FS_HCLK_MIN_HZ with the
+  * turnaround time (TRDT) matched to it, which USB_FS_ClockNotify() keeps
+  * up to date.
+  *
+  * OTG_FS has no DMA, so the CPU moves packets through the FIFOs in the
+  * interrupt: received packets are popped at RXFLVL straight into the
+  * buffer the device logic armed, and IN transfers are written into the
+  * transmit FIFO from the caller's buffer at TXFE, as much as fits. The bulk
+  * IN transfer points into the usb_cdc.c ring itself, so outgoing data is
+  * copied once, into the FIFO.
+  *
+  * All device logic (descriptors, enumeration, CDC requests) is in
+  * usb_cdc.c; this file only implements its USB_CDC_PcdTypeDef.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usb_fs.h"
+#include "clock_config.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define USB_FS                  USB_OTG_FS
+#define USB_FS_DEVICE           ((USB_OTG_DeviceTypeDef *)(USB_OTG_FS_PERIPH_BASE + USB_OTG_DEVICE_BASE))
+#define USB_FS_IN(n)            ((USB_OTG_INEndpointTypeDef *)(USB_OTG_FS_PERIPH_BASE +       \
+                                 USB_OTG_IN_ENDPOINT_BASE + ((n) * USB_OTG_EP_REG_SIZE)))
+#define USB_FS_OUT(n)           ((USB_OTG_OUTEndpointTypeDef *)(USB_OTG_FS_PERIPH_BASE +      \
+                                 USB_OTG_OUT_ENDPOINT_BASE + ((n) * USB_OTG_EP_REG_SIZE)))
+#define USB_FS_FIFO(n)          (*(__IO uint32_t *)(USB_OTG_FS_PERIPH_BASE + USB_OTG_FIFO_BASE + \
+                                 ((n) * USB_OTG_FIFO_SIZE)))
+#define USB_FS_PCGCCTL          (*(__IO uint32_t *)(USB_OTG_FS_PERIPH_BASE + USB_OTG_PCGCCTL_BASE))
+
+#define USB_FS_ENDPOINTS        4U      /* Bidirectional, EP0 included        */
+#define USB_FS_RESET_MS         10U
+#define USB_FS_MODE_MS          25U     /* Forced device mode takes effect    */
+#define USB_FS_DISABLE_LOOPS    1000U
+
+/* GRXSTSP packet status */
+#define USB_FS_RX_OUT_DATA      2U
+#define USB_FS_RX_SETUP_DATA    6U
+
+/* DCFG device speed: full speed on the internal PHY */
+#define USB_FS_DCFG_FULL_SPEED  (3UL << USB_OTG_DCFG_DSPD_Pos)
+
+_Static_assert(CLOCK_CONFIG_PLL48_HZ == 48000000UL, "OTG_FS needs PLL48CLK at exactly 48 MHz");
+_Static_assert((USB_FS_RX_WORDS + USB_FS_TX0_WORDS + USB_FS_TX1_WORDS + USB_FS_TX2_WORDS) <= 320U,
+               "USB_FS_*_WORDS: more than the 1.25 KB of FIFO RAM");
+_Static_assert(USB_FS_TX0_WORDS >= 16U, "USB_FS_TX0_WORDS: below one control packet");
+_Static_assert(USB_FS_TX1_WORDS >= 16U, "USB_FS_TX1_WORDS: below one bulk packet");
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const uint8_t *Data;        /* Next byte for the FIFO                   */
+  uint32_t       Left;        /* Bytes not yet in the FIFO                */
+  uint16_t       Size;        /* Maximum packet size                      */
+} USB_FS_InTypeDef;
+
+typedef struct
+{
+  uint8_t       *Data;
+  uint32_t       Size;        /* Room at Data                             */
+  uint32_t       Count;       /* Bytes received                           */
+  uint16_t       Packet;      /* Maximum packet size                      */
+} USB_FS_OutTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static USB_CDC_HandleTypeDef UsbFsCdc;
+static USB_FS_InTypeDef      UsbFsIn[USB_FS_ENDPOINTS];
+static USB_FS_OutTypeDef     UsbFsOut[USB_FS_ENDPOINTS];
+static uint32_t              UsbFsSetup[2];
+static char                  UsbFsSerial[25];
+static uint8_t               UsbFsReady;
+
+/* Private function prototypes -----------------------------------------------*/
+static void              USB_FS_MspInit(void);
+static void              USB_FS_MakeSerial(void);
+static HAL_StatusTypeDef USB_FS_CoreReset(void);
+static void              USB_FS_FlushTx(uint32_t fifo);
+static void              USB_FS_FlushRx(void);
+static uint32_t          USB_FS_Trdt(uint32_t hclk);
+static void              USB_FS_BusReset(void);
+static void              USB_FS_RxLevel(void);
+static void              USB_FS_ReadFifo(uint8_t *data, uint32_t room, uint32_t count);
+static void              USB_FS_OutEvents(void);
+static void              USB_FS_InEvents(void);
+static void              USB_FS_FillFifo(uint32_t n);
+static void              USB_FS_AbortIn(uint32_t n);
+static void              USB_FS_ArmSetup(void);
+static void              USB_FS_SetAddress(uint8_t address);
+static void              USB_FS_Open(uint8_t ep, uint8_t type, uint16_t size);
+static void              USB_FS_Transmit(uint8_t ep, const uint8_t *data, uint32_t length);
+static void              USB_FS_Receive(uint8_t ep, uint8_t *data, uint32_t length);
+static void              USB_FS_Stall(uint8_t ep);
+static void              USB_FS_ClearStall(uint8_t ep);
+static uint32_t          USB_FS_Lock(void);
+static void              USB_FS_Unlock(uint32_t state);
+
+static const USB_CDC_PcdTypeDef UsbFsPcd =
+{
+  USB_FS_SetAddress,
+  USB_FS_Open,
+  USB_FS_Transmit,
+  USB_FS_Receive,
+  USB_FS_Stall,
+  USB_FS_ClearStall,
+  USB_FS_Lock,
+  USB_FS_Unlock
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Bring the core up in device mode and connect to the bus. The
+  *         host sees the device from here on; data flows once a terminal
+  *         opens the port.
+  * @retval HAL_OK, HAL_TIMEOUT if the core did not come out of reset
+  */
+HAL_StatusTypeDef USB_FS_Init(void)
+{
+  USB_OTG_DeviceTypeDef *dev = USB_FS_DEVICE;
+  uint32_t start;
+  uint32_t n;
+
+  UsbFsReady = 0U;
+  memset(UsbFsIn, 0, sizeof(UsbFsIn));
+  memset(UsbFsOut, 0, sizeof(UsbFsOut));
+  USB_FS_MakeSerial();
+  USB_CDC_Init(&UsbFsCdc, &UsbFsPcd, UsbFsSerial);
+  USB_FS_MspInit();
+
+  USB_FS->GAHBCFG &= ~USB_OTG_GAHBCFG_GINT;
+  USB_FS->GUSBCFG |= USB_OTG_GUSBCFG_PHYSEL;
+  if (USB_FS_CoreReset() != HAL_OK)
+  {
+    return HAL_TIMEOUT;
+  }
+  USB_FS->GCCFG = USB_OTG_GCCFG_PWRDWN | USB_OTG_GCCFG_NOVBUSSENS;
+  USB_FS->GUSBCFG = (USB_FS->GUSBCFG & ~(USB_OTG_GUSBCFG_FHMOD | USB_OTG_GUSBCFG_TRDT)) |
+                    USB_OTG_GUSBCFG_FDMOD |
+                    (USB_FS_Trdt(HAL_RCC_GetHCLKFreq()) << USB_OTG_GUSBCFG_TRDT_Pos);
+  start = HAL_GetTick();
+  while ((HAL_GetTick() - start) < USB_FS_MODE_MS)
+  {
+  }
+
+  USB_FS_PCGCCTL = 0U;
+  dev->DCTL |= USB_OTG_DCTL_SDIS;
+  dev->DCFG = (dev->DCFG & ~USB_OTG_DCFG_DSPD) | USB_FS_DCFG_FULL_SPEED;
+
+  /* FIFO RAM, in words: receive at 0, then the transmit FIFOs */
+  USB_FS->GRXFSIZ = USB_FS_RX_WORDS;
+  USB_FS->DIEPTXF0_HNPTXFSIZ = (USB_FS_TX0_WORDS << USB_OTG_TX0FD_Pos) | USB_FS_RX_WORDS;
+  USB_FS->DIEPTXF[0] = (USB_FS_TX1_WORDS << USB_OTG_DIEPTXF_INEPTXFD_Pos) |
+                       (USB_FS_RX_WORDS + USB_FS_TX0_WORDS);
+  USB_FS->DIEPTXF[1] = (USB_FS_TX2_WORDS << USB_OTG_DIEPTXF_INEPTXFD_Pos) |
+                       (USB_FS_RX_WORDS + USB_FS_TX0_WORDS + USB_FS_TX1_WORDS);
+  USB_FS_FlushTx(0x10U);
+  USB_FS_FlushRx();
+
+  for (n = 0U; n < USB_FS_ENDPOINTS; n++)
+  {
+    USB_FS_IN(n)->DIEPCTL = 0U;
+    USB_FS_IN(n)->DIEPTSIZ = 0U;
+    USB_FS_IN(n)->DIEPINT = 0xFFFFU;
+    USB_FS_OUT(n)->DOEPCTL = 0U;
+    USB_FS_OUT(n)->DOEPTSIZ = 0U;
+    USB_FS_OUT(n)->DOEPINT = 0xFFFFU;
+  }
+  dev->DIEPMSK = USB_OTG_DIEPMSK_XFRCM;
+  dev->DOEPMSK = USB_OTG_DOEPMSK_XFRCM | USB_OTG_DOEPMSK_STUPM;
+  dev->DAINTMSK = 0U;
+  dev->DIEPEMPMSK = 0U;
+
+  USB_FS->GINTSTS = 0xFFFFFFFFU;
+  USB_FS->GINTMSK = USB_OTG_GINTMSK_USBRST | USB_OTG_GINTMSK_ENUMDNEM | USB_OTG_GINTMSK_RXFLVLM |
+                    USB_OTG_GINTMSK_IEPINT | USB_OTG_GINTMSK_OEPINT | USB_OTG_GINTMSK_USBSUSPM |
+                    USB_OTG_GINTMSK_WUIM;
+  USB_FS->GAHBCFG |= USB_OTG_GAHBCFG_GINT;
+  UsbFsReady = 1U;
+
+  /* Pull-up on DP: the host starts enumerating */
+  dev->DCTL &= ~USB_OTG_DCTL_SDIS;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Queue data for the host, all or nothing.
+  * @param  data: Bytes to send
+  * @param  length: Byte count
+  * @retval length, or 0 if the port is not open or the ring is full
+  */
+uint32_t USB_FS_Write(const void *data, uint32_t length)
+{
+  return (UsbFsReady != 0U) ? USB_CDC_Write(&UsbFsCdc, data, length) : 0U;
+}
+
+/**
+  * @brief  Take data the host sent.
+  * @param  data: Destination
+  * @param  length: Room at data
+  * @retval Bytes copied
+  */
+uint32_t USB_FS_Read(void *data, uint32_t length)
+{
+  return (UsbFsReady != 0U) ? USB_CDC_Read(&UsbFsCdc, data, length) : 0U;
+}
+
+/**
+  * @brief  Whether a terminal holds the port open.
+  * @retval 1 if configured with DTR set, 0 otherwise
+  */
+uint8_t USB_FS_Connected(void)
+{
+  return (UsbFsReady != 0U) ? USB_CDC_Connected(&UsbFsCdc) : 0U;
+}
+
+/**
+  * @brief  Copy the device counters.
+  * @param  stats: Destination
+  * @retval None
+  */
+void USB_FS_GetStats(USB_CDC_StatsTypeDef *stats)
+{
+  uint32_t state = USB_FS_Lock();
+
+  *stats = UsbFsCdc.Stats;
+  USB_FS_Unlock(state);
+}
+
+/**
+  * @brief  DVFS: refuse operating points without the PLL, which is also
+  *         PLL48CLK, or too slow for the AHB side; retune TRDT after a switch.
+  * @param  context: Unused
+  * @param  event: Before or after the switch
+  * @param  point: The new operating point
+  * @retval DVFS_OK, DVFS_BUSY
+  */
+DVFS_StatusTypeDef USB_FS_ClockNotify(void *context, DVFS_EventTypeDef event,
+                                      const DVFS_PointTypeDef *point)
+{
+  (void)context;
+  if (UsbFsReady == 0U)
+  {
+    return DVFS_OK;
+  }
+  if (event == DVFS_EV_PRE)
+  {
+    return ((point->UsePll == 0U) || (DVFS_Hclk(point) < USB_FS_HCLK_MIN_HZ)) ? DVFS_BUSY : DVFS_OK;
+  }
+  USB_FS->GUSBCFG = (USB_FS->GUSBCFG & ~USB_OTG_GUSBCFG_TRDT) |
+                    (USB_FS_Trdt(DVFS_Hclk(point)) << USB_OTG_GUSBCFG_TRDT_Pos);
+  return DVFS_OK;
+}
+
+/**
+  * @brief  OTG_FS interrupt: bus events, FIFO traffic, transfer ends.
+  * @retval None
+  */
+void USB_FS_IRQHandler(void)
+{
+  uint32_t status = USB_FS->GINTSTS & USB_FS->GINTMSK;
+
+  if ((status & USB_OTG_GINTSTS_USBRST) != 0U)
+  {
+    USB_FS->GINTSTS = USB_OTG_GINTSTS_USBRST;
+    USB_FS_BusReset();
+  }
+  if ((status & USB_OTG_GINTSTS_ENUMDNE) != 0U)
+  {
+    /* MPSIZ 0 is 64 bytes on EP0 */
+    USB_FS->GINTSTS = USB_OTG_GINTSTS_ENUMDNE;
+    USB_FS_IN(0U)->DIEPCTL &= ~USB_OTG_DIEPCTL_MPSIZ;
+    USB_FS_DEVICE->DCTL |= USB_OTG_DCTL_CGINAK;
+  }
+  if ((status & USB_OTG_GINTSTS_RXFLVL) != 0U)
+  {
+    USB_FS_RxLevel();
+  }
+  if ((status & USB_OTG_GINTSTS_OEPINT) != 0U)
+  {
+    USB_FS_OutEvents();
+  }
+  if ((status & USB_OTG_GINTSTS_IEPINT) != 0U)
+  {
+    USB_FS_InEvents();
+  }
+  if ((status & USB_OTG_GINTSTS_USBSUSP) != 0U)
+  {
+    USB_FS->GINTSTS = USB_OTG_GINTSTS_USBSUSP;
+    USB_CDC_Suspend(&UsbFsCdc);
+  }
+  if ((status & USB_OTG_GINTSTS_WKUINT) != 0U)
+  {
+    USB_FS->GINTSTS = USB_OTG_GINTSTS_WKUINT;
+    USB_CDC_Resume(&UsbFsCdc);
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Clocks, pins and the interrupt.
+  * @retval None
+  */
+static void USB_FS_MspInit(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  GPIO_InitStruct.Pin = GPIO_PIN_11 | GPIO_PIN_12;
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  GPIO_InitStruct.Alternate = GPIO_AF10_OTG_FS;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+  __HAL_RCC_USB_OTG_FS_CLK_ENABLE();
+  HAL_NVIC_SetPriority(OTG_FS_IRQn, USB_FS_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(OTG_FS_IRQn);
+}
+
+/**
+  * @brief  Serial number string: the 96-bit unique device ID in hex, so
+  *         the host keeps the same COM port per board.
+  * @retval None
+  */
+static void USB_FS_MakeSerial(void)
+{
+  static const char hex[] = "0123456789ABCDEF";
+  const uint32_t *uid = (const uint32_t *)UID_BASE;
+  uint32_t i;
+
+  for (i = 0U; i < 24U; i++)
+  {
+    UsbFsSerial[i] = hex[(uid[i / 8U] >> (28U - ((i % 8U) * 4U))) & 0x0FU];
+  }
+  UsbFsSerial[24] = '\0';
+}
+
+/**
+  * @brief  Core soft reset, once the AHB master is idle.
+  * @retval HAL_OK, HAL_TIMEOUT
+  */
+static HAL_StatusTypeDef USB_FS_CoreReset(void)
+{
+  uint32_t start = HAL_GetTick();
+
+  while ((USB_FS->GRSTCTL & USB_OTG_GRSTCTL_AHBIDL) == 0U)
+  {
+    if ((HAL_GetTick() - start) > USB_FS_RESET_MS)
+    {
+      return HAL_TIMEOUT;
+    }
+  }
+  USB_FS->GRSTCTL |= USB_OTG_GRSTCTL_CSRST;
+  while ((USB_FS->GRSTCTL & USB_OTG_GRSTCTL_CSRST) != 0U)
+  {
+    if ((HAL_GetTick() - start) > USB_FS_RESET_MS)
+    {
+      return HAL_TIMEOUT;
+    }
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Empty a transmit FIFO. Takes a few PHY clocks.
+  * @param  fifo: FIFO number, 0x10 for all
+  * @retval None
+  */
+static void USB_FS_FlushTx(uint32_t fifo)
+{
+  uint32_t loops = USB_FS_DISABLE_LOOPS;
+
+  USB_FS->GRSTCTL = USB_OTG_GRSTCTL_TXFFLSH | (fifo << USB_OTG_GRSTCTL_TXFNUM_Pos);
+  while (((USB_FS->GRSTCTL & USB_OTG_GRSTCTL_TXFFLSH) != 0U) && (loops != 0U))
+  {
+    loops--;
+  }
+}
+
+/**
+  * @brief  Empty the receive FIFO.
+  * @retval None
+  */
+static void USB_FS_FlushRx(void)
+{
+  uint32_t loops = USB_FS_DISABLE_LOOPS;
+
+  USB_FS->GRSTCTL = USB_OTG_GRSTCTL_RXFFLSH;
+  while (((USB_FS->GRSTCTL & USB_OTG_GRSTCTL_RXFFLSH) != 0U) && (loops != 0U))
+  {
+    loops--;
+  }
+}
+
+/**
+  * @brief  USB turnaround time for an AHB clock (RM0090, OTG_FS_GUSBCFG).
+  * @param  hclk: HCLK in Hz
+  * @retval TRDT field value
+  */
+static uint32_t USB_FS_Trdt(uint32_t hclk)
+{
+  static const uint32_t Limits[] =
+  {
+    15000000U, 16000000U, 17200000U, 18500000U, 20000000U,
+    21800000U, 24000000U, 27500000U, 32000000U
+  };
+  uint32_t trdt = 0x0FU;
+  uint32_t i;
+
+  for (i = 0U; i < (sizeof(Limits) / sizeof(Limits[0])); i++)
+  {
+    if (hclk >= Limits[i])
+    {
+      trdt--;
+    }
+  }
+  return trdt;
+}
+
+/**
+  * @brief  Bus reset: every endpoint but EP0 is gone, the address is 0.
+  * @retval None
+  */
+static void USB_FS_BusReset(void)
+{
+  USB_OTG_DeviceTypeDef *dev = USB_FS_DEVICE;
+  uint32_t n;
+
+  dev->DCTL &= ~USB_OTG_DCTL_RWUSIG;
+  for (n = 0U; n < USB_FS_ENDPOINTS; n++)
+  {
+    USB_FS_IN(n)->DIEPCTL &= ~USB_OTG_DIEPCTL_STALL;
+    USB_FS_IN(n)->DIEPINT = 0xFFFFU;
+    USB_FS_OUT(n)->DOEPCTL = (USB_FS_OUT(n)->DOEPCTL & ~USB_OTG_DOEPCTL_STALL) | USB_OTG_DOEPCTL_SNAK;
+    USB_FS_OUT(n)->DOEPINT = 0xFFFFU;
+  }
+  USB_FS_FlushTx(0x10U);
+  memset(UsbFsIn, 0, sizeof(UsbFsIn));
+  memset(UsbFsOut, 0, sizeof(UsbFsOut));
+  dev->DAINT = 0xFFFFFFFFU;
+  dev->DAINTMSK = (1UL << 0) | (1UL << 16);
+  dev->DIEPEMPMSK = 0U;
+  dev->DCFG &= ~USB_OTG_DCFG_DAD;
+  USB_FS_ArmSetup();
+  USB_CDC_Reset(&UsbFsCdc);
+}
+
+/**
+  * @brief  Pop one entry of the receive FIFO.
+  * @retval None
+  */
+static void USB_FS_RxLevel(void)
+{
+  uint32_t status;
+  uint32_t count;
+  USB_FS_OutTypeDef *out;
+
+  USB_FS->GINTMSK &= ~USB_OTG_GINTMSK_RXFLVLM;
+  status = USB_FS->GRXSTSP;
+  count = (status & USB_OTG_GRXSTSP_BCNT) >> USB_OTG_GRXSTSP_BCNT_Pos;
+  out = &UsbFsOut[status & USB_OTG_GRXSTSP_EPNUM];
+  switch ((status & USB_OTG_GRXSTSP_PKTSTS) >> USB_OTG_GRXSTSP_PKTSTS_Pos)
+  {
+    case USB_FS_RX_OUT_DATA:
+      USB_FS_ReadFifo((out->Data != NULL) ? &out->Data[out->Count] : NULL,
+                      out->Size - out->Count, count);
+      out->Count += (count < (out->Size - out->Count)) ? count : (out->Size - out->Count);
+      break;
+    case USB_FS_RX_SETUP_DATA:
+      USB_FS_ReadFifo((uint8_t *)UsbFsSetup, sizeof(UsbFsSetup), count);
+      break;
+    default:
+      /* Transfer or setup stage done: the endpoint interrupt follows */
+      break;
+  }
+  USB_FS->GINTMSK |= USB_OTG_GINTMSK_RXFLVLM;
+}
+
+/**
+  * @brief  Read a packet out of the receive FIFO, dropping what does not fit.
+  * @param  data: Destination, NULL to drop it all
+  * @param  room: Bytes that fit at data
+  * @param  count: Packet size
+  * @retval None
+  */
+static void USB_FS_ReadFifo(uint8_t *data, uint32_t room, uint32_t count)
+{
+  uint32_t word;
+  uint32_t i;
+
+  if (data == NULL)
+  {
+    room = 0U;
+  }
+  for (i = 0U; i < count; i += 4U)
+  {
+    word = USB_FS_FIFO(0U);
+    if ((i + 4U) <= room)
+    {
+      memcpy(&data[i], &word, 4U);
+    }
+    else if (i < room)
+    {
+      memcpy(&data[i], &word, room - i);
+    }
+  }
+}
+
+/**
+  * @brief  OUT endpoint events: transfer complete, setup stage done.
+  * @retval None
+  */
+static void USB_FS_OutEvents(void)
+{
+  USB_OTG_DeviceTypeDef *dev = USB_FS_DEVICE;
+  uint32_t pending = (dev->DAINT & dev->DAINTMSK) >> 16;
+  uint32_t events;
+  uint32_t n;
+
+  for (n = 0U; pending != 0U; n++, pending >>= 1)
+  {
+    if ((pending & 1U) == 0U)
+    {
+      continue;
+    }
+    events = USB_FS_OUT(n)->DOEPINT & dev->DOEPMSK;
+    USB_FS_OUT(n)->DOEPINT = events;
+    if ((events & USB_OTG_DOEPINT_XFRC) != 0U)
+    {
+      USB_CDC_DataOut(&UsbFsCdc, (uint8_t)n, UsbFsOut[n].Count);
+    }
+    if ((events & USB_OTG_DOEPINT_STUP) != 0U)
+    {
+      USB_CDC_Setup(&UsbFsCdc, (const uint8_t *)UsbFsSetup);
+    }
+    if (n == 0U)
+    {
+      /* Back-to-back SETUPs must always find room */
+      USB_FS_OUT(0U)->DOEPTSIZ |= (3UL << USB_OTG_DOEPTSIZ_STUPCNT_Pos);
+    }
+  }
+}
+
+/**
+  * @brief  IN endpoint events: transfer complete, FIFO has room.
+  * @retval None
+  */
+static void USB_FS_InEvents(void)
+{
+  USB_OTG_DeviceTypeDef *dev = USB_FS_DEVICE;
+  uint32_t pending = dev->DAINT & dev->DAINTMSK & 0xFFFFU;
+  uint32_t events;
+  uint32_t mask;
+  uint32_t n;
+
+  for (n = 0U; pending != 0U; n++, pending >>= 1)
+  {
+    if ((pending & 1U) == 0U)
+    {
+      continue;
+    }
+    mask = dev->DIEPMSK;
+    if ((dev->DIEPEMPMSK & (1UL << n)) != 0U)
+    {
+      mask |= USB_OTG_DIEPINT_TXFE;
+    }
+    events = USB_FS_IN(n)->DIEPINT & mask;
+    if ((events & USB_OTG_DIEPINT_XFRC) != 0U)
+    {
+      USB_FS_IN(n)->DIEPINT = USB_OTG_DIEPINT_XFRC;
+      dev->DIEPEMPMSK &= ~(1UL << n);
+      USB_CDC_DataIn(&UsbFsCdc, (uint8_t)(0x80U | n));
+    }
+    if ((events & USB_OTG_DIEPINT_TXFE) != 0U)
+    {
+      USB_FS_FillFifo(n);
+    }
+  }
+}
+
+/**
+  * @brief  Write whole packets of the current IN transfer while they fit.
+  * @param  n: Endpoint number
+  * @retval None
+  */
+static void USB_FS_FillFifo(uint32_t n)
+{
+  USB_FS_InTypeDef *in = &UsbFsIn[n];
+  uint32_t length;
+  uint32_t words;
+  uint32_t word;
+  uint32_t i;
+
+  while (in->Left != 0U)
+  {
+    length = (in->Left < in->Size) ? in->Left : in->Size;
+    words = (length + 3U) / 4U;
+    if ((USB_FS_IN(n)->DTXFSTS & USB_OTG_DTXFSTS_INEPTFSAV) < words)
+    {
+      return;
+    }
+    for (i = 0U; i < length; i += 4U)
+    {
+      word = 0U;
+      memcpy(&word, &in->Data[i], ((length - i) < 4U) ? (length - i) : 4U);
+      USB_FS_FIFO(n) = word;
+    }
+    in->Data += length;
+    in->Left -= length;
+  }
+  USB_FS_DEVICE->DIEPEMPMSK &= ~(1UL << n);
+}
+
+/**
+  * @brief  Stop an IN endpoint and drop what its FIFO holds.
+  * @param  n: Endpoint number
+  * @retval None
+  */
+static void USB_FS_AbortIn(uint32_t n)
+{
+  uint32_t loops = USB_FS_DISABLE_LOOPS;
+
+  USB_FS_DEVICE->DIEPEMPMSK &= ~(1UL << n);
+  UsbFsIn[n].Left = 0U;
+  if ((USB_FS_IN(n)->DIEPCTL & USB_OTG_DIEPCTL_EPENA) != 0U)
+  {
+    USB_FS_IN(n)->DIEPCTL |= USB_OTG_DIEPCTL_EPDIS | USB_OTG_DIEPCTL_SNAK;
+    while (((USB_FS_IN(n)->DIEPINT & USB_OTG_DIEPINT_EPDISD) == 0U) && (loops != 0U))
+    {
+      loops--;
+    }
+    USB_FS_IN(n)->DIEPINT = USB_OTG_DIEPINT_EPDISD;
+  }
+  USB_FS_FlushTx(n);
+}
+
+/**
+  * @brief  Let EP0 OUT take up to three back-to-back SETUP packets.
+  * @retval None
+  */
+static void USB_FS_ArmSetup(void)
+{
+  USB_FS_OUT(0U)->DOEPTSIZ = (3UL << USB_OTG_DOEPTSIZ_STUPCNT_Pos) |
+                             (1UL << USB_OTG_DOEPTSIZ_PKTCNT_Pos) | (3U * 8U);
+}
+
+/**
+  * @brief  Port: device address. The core uses it right away and still
+  *         answers the status stage at address 0.
+  * @param  address: New address
+  * @retval None
+  */
+static void USB_FS_SetAddress(uint8_t address)
+{
+  USB_OTG_DeviceTypeDef *dev = USB_FS_DEVICE;
+
+  dev->DCFG = (dev->DCFG & ~USB_OTG_DCFG_DAD) | ((uint32_t)address << USB_OTG_DCFG_DAD_Pos);
+}
+
+/**
+  * @brief  Port: activate an endpoint. EP0 is always active; only its
+  *         packet size is noted.
+  * @param  ep: Endpoint address
+  * @param  type: USB_CDC_EP_*
+  * @param  size: Maximum packet size
+  * @retval None
+  */
+static void USB_FS_Open(uint8_t ep, uint8_t type, uint16_t size)
+{
+  uint32_t n = ep & 0x7FU;
+  uint32_t ctl = ((uint32_t)type << USB_OTG_DIEPCTL_EPTYP_Pos) | USB_OTG_DIEPCTL_USBAEP |
+                 USB_OTG_DIEPCTL_SD0PID_SEVNFRM | USB_OTG_DIEPCTL_SNAK | size;
+
+  if ((ep & 0x80U) != 0U)
+  {
+    UsbFsIn[n].Size = size;
+    if (n != 0U)
+    {
+      USB_FS_AbortIn(n);
+      USB_FS_IN(n)->DIEPCTL = ctl | (n << USB_OTG_DIEPCTL_TXFNUM_Pos);
+      USB_FS_DEVICE->DAINTMSK |= 1UL << n;
+    }
+  }
+  else
+  {
+    UsbFsOut[n].Packet = size;
+    if (n != 0U)
+    {
+      USB_FS_OUT(n)->DOEPCTL = ctl;
+      USB_FS_DEVICE->DAINTMSK |= 1UL << (16U + n);
+    }
+  }
+}
+
+/**
+  * @brief  Port: start an IN transfer. The data stays where it is until
+  *         TXFE has moved it into the FIFO.
+  * @param  ep: Endpoint address
+  * @param  data: Bytes, NULL with length 0
+  * @param  length: Byte count, 0 for a zero-length packet
+  * @retval None
+  */
+static void USB_FS_Transmit(uint8_t ep, const uint8_t *data, uint32_t length)
+{
+  uint32_t n = ep & 0x7FU;
+  USB_FS_InTypeDef *in = &UsbFsIn[n];
+  uint32_t packets = (length == 0U) ? 1U : ((length + in->Size - 1U) / in->Size);
+
+  in->Data = data;
+  in->Left = length;
+  USB_FS_IN(n)->DIEPTSIZ = (packets << USB_OTG_DIEPTSIZ_PKTCNT_Pos) | length;
+  USB_FS_IN(n)->DIEPCTL |= USB_OTG_DIEPCTL_CNAK | USB_OTG_DIEPCTL_EPENA;
+  if (length != 0U)
+  {
+    USB_FS_DEVICE->DIEPEMPMSK |= 1UL << n;
+  }
+}
+
+/**
+  * @brief  Port: accept one packet on an OUT endpoint.
+  * @param  ep: Endpoint address
+  * @param  data: Destination
+  * @param  length: Room at data, bytes beyond it are dropped
+  * @retval None
+  */
+static void USB_FS_Receive(uint8_t ep, uint8_t *data, uint32_t length)
+{
+  uint32_t n = ep & 0x7FU;
+  USB_FS_OutTypeDef *out = &UsbFsOut[n];
+
+  out->Data = data;
+  out->Size = length;
+  out->Count = 0U;
+  USB_FS_OUT(n)->DOEPTSIZ = (USB_FS_OUT(n)->DOEPTSIZ & USB_OTG_DOEPTSIZ_STUPCNT) |
+                            (1UL << USB_OTG_DOEPTSIZ_PKTCNT_Pos) | out->Packet;
+  USB_FS_OUT(n)->DOEPCTL |= USB_OTG_DOEPCTL_CNAK | USB_OTG_DOEPCTL_EPENA;
+}
+
+/**
+  * @brief  Port: halt an endpoint. On EP0 the next SETUP clears it.
+  * @param  ep: Endpoint address
+  * @retval None
+  */
+static void USB_FS_Stall(uint8_t ep)
+{
+  uint32_t n = ep & 0x7FU;
+
+  if ((ep & 0x80U) != 0U)
+  {
+    if (n != 0U)
+    {
+      USB_FS_AbortIn(n);
+    }
+    USB_FS_IN(n)->DIEPCTL |= USB_OTG_DIEPCTL_STALL;
+  }
+  else
+  {
+    USB_FS_OUT(n)->DOEPCTL |= USB_OTG_DOEPCTL_STALL;
+  }
+}
+
+/**
+  * @brief  Port: clear a halt and restart the data toggle at DATA0.
+  * @param  ep: Endpoint address
+  * @retval None
+  */
+static void USB_FS_ClearStall(uint8_t ep)
+{
+  uint32_t n = ep & 0x7FU;
+
+  if ((ep & 0x80U) != 0U)
+  {
+    USB_FS_AbortIn(n);
+    USB_FS_IN(n)->DIEPCTL = (USB_FS_IN(n)->DIEPCTL & ~USB_OTG_DIEPCTL_STALL) |
+                            USB_OTG_DIEPCTL_SD0PID_SEVNFRM;
+  }
+  else
+  {
+    USB_FS_OUT(n)->DOEPCTL = (USB_FS_OUT(n)->DOEPCTL & ~USB_OTG_DOEPCTL_STALL) |
+                             USB_OTG_DOEPCTL_SD0PID_SEVNFRM;
+  }
+}
+
+/**
+  * @brief  Port: enter a short critical section.
+  * @retval Previous PRIMASK
+  */
+static uint32_t USB_FS_Lock(void)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  return primask;
+}
+
+/**
+  * @brief  Port: leave the critical section.
+  * @param  state: Value returned by USB_FS_Lock()
+  * @retval None
+  */
+static void USB_FS_Unlock(uint32_t state)
+{
+  __set_PRIMASK(state);
+}
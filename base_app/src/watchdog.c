@@ -0,0 +1,264 @@
+/**
+  ******************************************************************************
+  * @file    watchdog.c
+  * @brief   Watchdog supervisor: heartbeat accounting and starvation record.
+  ******************************************************************************
+  * Heartbeats come from task context, WDOG_Check() from a periodic interrupt.
+  * Both only exchange LastBeat, a single word, so no locking is needed.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "watchdog.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t WDOG_RecordCheck(const WDOG_RecordTypeDef *record);
+static uint8_t  WDOG_RecordIsValid(const WDOG_RecordTypeDef *record);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Start with no tasks and a healthy state.
+  * @param  hwdog: Supervisor handle
+  * @retval None
+  */
+void WDOG_Init(WDOG_HandleTypeDef *hwdog)
+{
+  memset(hwdog, 0, sizeof(*hwdog));
+  hwdog->Starved = -1;
+}
+
+/**
+  * @brief  Add a task. Its first deadline runs from now.
+  * @param  hwdog: Supervisor handle
+  * @param  name: Task name, must outlive the supervisor
+  * @param  deadline: Longest allowed gap between heartbeats, in ticks
+  * @param  now: Current time
+  * @param  id: Receives the task ID for WDOG_Heartbeat()
+  * @retval WDOG_FULL if WDOG_MAX_TASKS are registered
+  */
+WDOG_StatusTypeDef WDOG_Register(WDOG_HandleTypeDef *hwdog, const char *name, uint32_t deadline,
+                                 uint32_t now, uint32_t *id)
+{
+  WDOG_TaskTypeDef *task;
+
+  if ((name == NULL) || (deadline == 0U) || (id == NULL))
+  {
+    return WDOG_INVALID;
+  }
+  if (hwdog->Count >= WDOG_MAX_TASKS)
+  {
+    return WDOG_FULL;
+  }
+  task = &hwdog->Tasks[hwdog->Count];
+  memset(task, 0, sizeof(*task));
+  task->Name     = name;
+  task->Deadline = deadline;
+  task->LastBeat = now;
+  *id = hwdog->Count++;
+  return WDOG_OK;
+}
+
+/**
+  * @brief  Report that a task is making progress.
+  * @param  hwdog: Supervisor handle
+  * @param  id: Task ID from WDOG_Register()
+  * @param  now: Current time
+  * @retval None
+  */
+void WDOG_Heartbeat(WDOG_HandleTypeDef *hwdog, uint32_t id, uint32_t now)
+{
+  WDOG_TaskTypeDef *task;
+  uint32_t gap;
+
+  if (id >= hwdog->Count)
+  {
+    return;
+  }
+  task = &hwdog->Tasks[id];
+  gap = now - task->LastBeat;
+  if (gap > task->WorstGap)
+  {
+    task->WorstGap = gap;
+  }
+  task->Beats++;
+  task->LastBeat = now;
+}
+
+/**
+  * @brief  Exempt a task from checking, e.g. while it waits on purpose.
+  * @param  hwdog: Supervisor handle
+  * @param  id: Task ID
+  * @retval None
+  */
+void WDOG_Suspend(WDOG_HandleTypeDef *hwdog, uint32_t id)
+{
+  if (id < hwdog->Count)
+  {
+    hwdog->Tasks[id].Suspended = 1U;
+  }
+}
+
+/**
+  * @brief  Check a task again, with a fresh deadline from now.
+  * @param  hwdog: Supervisor handle
+  * @param  id: Task ID
+  * @param  now: Current time
+  * @retval None
+  */
+void WDOG_Resume(WDOG_HandleTypeDef *hwdog, uint32_t id, uint32_t now)
+{
+  if (id < hwdog->Count)
+  {
+    hwdog->Tasks[id].LastBeat = now;
+    hwdog->Tasks[id].Suspended = 0U;
+  }
+}
+
+/**
+  * @brief  Decide whether the hardware watchdog may be refreshed.
+  *         Starvation is latched: once a task has missed its deadline no
+  *         later heartbeat brings the supervisor back.
+  * @param  hwdog: Supervisor handle
+  * @param  now: Current time
+  * @retval WDOG_OK to refresh, WDOG_STARVED to let the watchdog expire
+  */
+WDOG_StatusTypeDef WDOG_Check(WDOG_HandleTypeDef *hwdog, uint32_t now)
+{
+  WDOG_TaskTypeDef *task;
+  uint32_t late;
+  uint32_t i;
+
+  if (hwdog->Starved >= 0)
+  {
+    return WDOG_STARVED;
+  }
+  for (i = 0U; i < hwdog->Count; i++)
+  {
+    task = &hwdog->Tasks[i];
+    if (task->Suspended != 0U)
+    {
+      continue;
+    }
+    late = now - task->LastBeat;
+    if ((late > task->Deadline) && ((hwdog->Starved < 0) || (late - task->Deadline > hwdog->Overdue)))
+    {
+      /* Blame the task furthest past its deadline */
+      hwdog->Starved = (int32_t)i;
+      hwdog->Overdue = late - task->Deadline;
+    }
+  }
+  if (hwdog->Starved >= 0)
+  {
+    return WDOG_STARVED;
+  }
+  hwdog->Refreshes++;
+  return WDOG_OK;
+}
+
+/**
+  * @brief  Save the starved task into a record that survives the reset.
+  *         The reset counter carries on from a valid previous record.
+  * @param  hwdog: Supervisor handle, starved
+  * @param  record: Record, typically in .noinit RAM
+  * @retval None
+  */
+void WDOG_Record(const WDOG_HandleTypeDef *hwdog, WDOG_RecordTypeDef *record)
+{
+  uint32_t count;
+
+  if (hwdog->Starved < 0)
+  {
+    return;
+  }
+  count = (WDOG_RecordIsValid(record) != 0U) ? record->Count + 1U : 1U;
+  memset(record, 0, sizeof(*record));
+  record->Magic   = WDOG_MAGIC;
+  record->Count   = count;
+  record->Task    = (uint32_t)hwdog->Starved;
+  record->Overdue = hwdog->Overdue;
+  strncpy(record->Name, hwdog->Tasks[hwdog->Starved].Name, WDOG_NAME_MAX - 1U);
+  record->Check = WDOG_RecordCheck(record);
+}
+
+/**
+  * @brief  Check for a starvation that has not been reported yet.
+  * @param  record: Record
+  * @retval 1 if a report is due, 0 for a reported record or garbage
+  */
+uint8_t WDOG_RecordIsPending(const WDOG_RecordTypeDef *record)
+{
+  return ((record->Magic == WDOG_MAGIC) && (WDOG_RecordIsValid(record) != 0U)) ? 1U : 0U;
+}
+
+/**
+  * @brief  Keep the record, and its reset count, but stop reporting it.
+  * @param  record: Valid record
+  * @retval None
+  */
+void WDOG_RecordMarkReported(WDOG_RecordTypeDef *record)
+{
+  record->Magic = WDOG_MAGIC_REPORTED;
+  record->Check = WDOG_RecordCheck(record);
+}
+
+/**
+  * @brief  One-line report of a record, ticks shown as milliseconds.
+  * @param  record: Valid record
+  * @param  out: Output buffer
+  * @param  size: Size of out
+  * @retval Number of characters written
+  */
+uint32_t WDOG_FormatRecord(const WDOG_RecordTypeDef *record, char *out, uint32_t size)
+{
+  char name[WDOG_NAME_MAX];
+  int n;
+
+  memcpy(name, record->Name, WDOG_NAME_MAX - 1U);
+  name[WDOG_NAME_MAX - 1U] = '\0';
+  n = snprintf(out, size, "watchdog %lu: task %lu '%s' starved, %lu ms overdue",
+               (unsigned long)record->Count, (unsigned long)record->Task, name,
+               (unsigned long)record->Overdue);
+  if ((n < 0) || (size == 0U))
+  {
+    return 0U;
+  }
+  return ((uint32_t)n < size) ? (uint32_t)n : (size - 1U);
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Check word over every other field of a record.
+  * @param  record: Record
+  * @retval Check word
+  */
+static uint32_t WDOG_RecordCheck(const WDOG_RecordTypeDef *record)
+{
+  const uint8_t *p = (const uint8_t *)record;
+  const uint8_t *end = (const uint8_t *)&record->Check;
+  uint32_t check = 0x5A5A5A5AU;
+
+  while (p < end)
+  {
+    check = ((check << 5) | (check >> 27)) ^ *p++;
+  }
+  return ~check;
+}
+
+/**
+  * @brief  Check that a record was written by WDOG_Record(), reported or not.
+  * @param  record: Record
+  * @retval 1 if valid
+  */
+static uint8_t WDOG_RecordIsValid(const WDOG_RecordTypeDef *record)
+{
+  if ((record->Magic != WDOG_MAGIC) && (record->Magic != WDOG_MAGIC_REPORTED))
+  {
+    return 0U;
+  }
+  return (record->Check == WDOG_RecordCheck(record)) ? 1U : 0U;
+}
@@ -54,45 +54,92 @@ defined in linker script */
  * @retval : None
 */
 
+/* Stamp the end of a boot phase: BootRecord.Cycles[phase] = DWT->CYCCNT.
+   Offsets follow BOOT_RecordTypeDef in boot.h. Clobbers r0, r1. */
+.macro BOOT_STAMP phase
+  ldr   r0, =0xE0001004       /* DWT->CYCCNT */
+  ldr   r1, [r0]
+  ldr   r0, =BootRecord
+  str   r1, [r0, #(8 + 4 * \phase)]
+.endm
+
     .section  .text.Reset_Handler
   .weak  Reset_Handler
   .type  Reset_Handler, %function
 Reset_Handler:  
   ldr   sp, =_estack     /* set stack pointer */
+
+/* Start the DWT cycle counter from zero: boot phases are timed with it */
+  ldr   r0, =0xE000EDFC       /* CoreDebug->DEMCR */
+  ldr   r1, [r0]
+  orr   r1, r1, #0x01000000   /* TRCENA */
+  str   r1, [r0]
+  ldr   r0, =0xE0001000       /* DWT->CTRL */
+  movs  r1, #0
+  str   r1, [r0, #4]          /* DWT->CYCCNT */
+  ldr   r1, [r0]
+  orr   r1, r1, #1            /* CYCCNTENA */
+  str   r1, [r0]
   
 /* Call the clock system initialization function.*/
   bl  SystemInit  
+  BOOT_STAMP 1
 
-/* Copy the data segment initializers from flash to SRAM */  
+/* Copy the data segment initializers from flash to SRAM, 32 bytes per
+   ldm/stm pair, then the remaining words. Both ends are word aligned. */
   ldr r0, =_sdata
   ldr r1, =_edata
   ldr r2, =_sidata
-  movs r3, #0
   b LoopCopyDataInit
 
 CopyDataInit:
-  ldr r4, [r2, r3]
-  str r4, [r0, r3]
-  adds r3, r3, #4
+  ldmia r2!, {r3-r10}
+  stmia r0!, {r3-r10}
 
 LoopCopyDataInit:
-  adds r4, r0, r3
-  cmp r4, r1
-  bcc CopyDataInit
+  sub r3, r1, r0
+  cmp r3, #32
+  bhs CopyDataInit
+  b LoopCopyDataTail
+
+CopyDataTail:
+  ldr r3, [r2], #4
+  str r3, [r0], #4
+
+LoopCopyDataTail:
+  cmp r0, r1
+  bcc CopyDataTail
+  BOOT_STAMP 2
   
-/* Zero fill the bss segment. */
+/* Zero fill the bss segment, 32 bytes per stm, then the remaining words. */
   ldr r2, =_sbss
   ldr r4, =_ebss
   movs r3, #0
+  movs r5, #0
+  movs r6, #0
+  movs r7, #0
+  mov r8, r3
+  mov r9, r3
+  mov r10, r3
+  mov r11, r3
   b LoopFillZerobss
 
 FillZerobss:
-  str  r3, [r2]
-  adds r2, r2, #4
+  stmia r2!, {r3, r5-r11}
 
 LoopFillZerobss:
+  sub r0, r4, r2
+  cmp r0, #32
+  bhs FillZerobss
+  b LoopFillZeroTail
+
+FillZeroTail:
+  str  r3, [r2], #4
+
+LoopFillZeroTail:
   cmp r2, r4
-  bcc FillZerobss
+  bcc FillZeroTail
+  BOOT_STAMP 3
 
 /* Call static constructors */
     bl __libc_init_array
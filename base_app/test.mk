@@ -2,7 +2,7 @@
 # This Makefile builds and runs unit tests for the STM32F4 project
 
 TARGET = test_main
-BUILD_DIR = build
+BUILD_DIR = build/test
 TEST_DIR = tests
 
 # ==== Compiler Settings ====
@@ -13,7 +13,8 @@ CFLAGS += -Werror=implicit-function-declaration
 # ==== Include Paths ====
 INCLUDES = \
   -I$(TEST_DIR) \
-  -IInc
+  -IInc \
+  -Itools
 
 # ==== Source Files ====
 # Unity framework sources
@@ -32,19 +33,141 @@ TESTABLE_SOURCES = \
 TEST_SOURCES = \
   $(TEST_DIR)/test_main.c
 
+# ==== Module Test Suites ====
+# Portable application modules (no HAL dependency) are tested against the
+# real sources in src/. Each suite is its own Unity runner built from
+# tests/<suite>.c plus the sources listed in <suite>_SOURCES.
+SUITES = \
+  test_audio \
+  test_i2c_queue \
+  test_trace \
+  test_crash \
+  test_watchdog \
+  test_kernel \
+  test_clock_tree \
+  test_dvfs \
+  test_boot \
+  test_pin \
+  test_led_pattern \
+  test_button \
+  test_mpu_region \
+  test_stack_depth \
+  test_dac_wave \
+  test_adc_scan \
+  test_pulse \
+  test_can_filter \
+  test_can_queue \
+  test_modbus \
+  test_logfs \
+  test_usb_cdc \
+  test_fusion \
+  test_fixmath \
+  test_lz
+
+test_audio_SOURCES = src/audio_mixer.c
+test_i2c_queue_SOURCES = src/i2c_queue.c
+test_trace_SOURCES = src/trace.c
+test_crash_SOURCES = src/crash.c src/trace.c
+test_watchdog_SOURCES = src/watchdog.c
+test_kernel_SOURCES = src/kernel.c
+test_clock_tree_SOURCES =
+test_dvfs_SOURCES = src/dvfs.c
+test_boot_SOURCES = src/boot.c
+test_pin_SOURCES =
+test_led_pattern_SOURCES = src/led_pattern.c
+test_button_SOURCES = src/button.c
+test_mpu_region_SOURCES = src/mpu_region.c
+test_stack_depth_SOURCES = tools/stack_depth.c
+test_dac_wave_SOURCES = src/dac_wave.c
+test_adc_scan_SOURCES = src/adc_scan.c
+test_pulse_SOURCES = src/pulse.c
+test_can_filter_SOURCES = src/can_filter.c src/can_queue.c
+test_can_queue_SOURCES = src/can_queue.c
+test_modbus_SOURCES = src/modbus.c
+test_logfs_SOURCES = src/logfs.c
+test_usb_cdc_SOURCES = src/usb_cdc.c
+test_fusion_SOURCES = src/fusion.c
+test_fixmath_SOURCES = src/fixmath.c $(BUILD_DIR)/fixmath_tables.c
+test_lz_SOURCES = src/lzss.c
+
+SUITE_SOURCES = $(sort $(foreach s,$(SUITES),$($(s)_SOURCES)))
+SUITE_TESTS   = $(addprefix $(TEST_DIR)/,$(addsuffix .c,$(SUITES)))
+SUITE_BINS    = $(addprefix $(BUILD_DIR)/,$(SUITES))
+
 # All sources
 SOURCES = $(UNITY_SOURCES) $(MOCK_SOURCES) $(TESTABLE_SOURCES) $(TEST_SOURCES)
 
 # ==== Object Files ====
 OBJECTS = $(addprefix $(BUILD_DIR)/,$(notdir $(SOURCES:.c=.o)))
-vpath %.c $(sort $(dir $(SOURCES)))
+SUITE_OBJECTS = $(addprefix $(BUILD_DIR)/,$(notdir $(SUITE_SOURCES:.c=.o) $(SUITE_TESTS:.c=.o)))
+vpath %.c $(sort $(dir $(SOURCES) $(SUITE_SOURCES)))
+
+LDLIBS = -lm
 
 # ==== Build Rules ====
-all: $(BUILD_DIR)/$(TARGET)
+all: $(BUILD_DIR)/$(TARGET) $(SUITE_BINS)
 
 # Build the test executable
 $(BUILD_DIR)/$(TARGET): $(OBJECTS) | $(BUILD_DIR)
-	$(CC) $(OBJECTS) $(LDFLAGS) -o $@
+	$(CC) $(OBJECTS) $(LDFLAGS) $(LDLIBS) -o $@
+	@echo "Build complete: $@"
+
+# Build one module suite runner
+define SUITE_RULE
+$(BUILD_DIR)/$(1): $(BUILD_DIR)/$(1).o $(addprefix $(BUILD_DIR)/,$(notdir $(UNITY_SOURCES:.c=.o) $($(1)_SOURCES:.c=.o))) | $(BUILD_DIR)
+	$$(CC) $$^ $$(LDFLAGS) $$(LDLIBS) -o $$@
+	@echo "Build complete: $$@"
+endef
+$(foreach s,$(SUITES),$(eval $(call SUITE_RULE,$(s))))
+
+# ==== Host Tools ====
+# Trace dump to Chrome trace JSON converter (see Inc/trace_recorder.h)
+trace2json: $(BUILD_DIR)/trace2json
+
+$(BUILD_DIR)/trace2json: tools/trace2json.c src/trace.c | $(BUILD_DIR)
+	$(CC) $(CFLAGS) $(INCLUDES) $^ -o $@
+	@echo "Build complete: $@"
+
+# Boot record decoder, fed by "make boottime" (see Inc/boot.h)
+boottime: $(BUILD_DIR)/boottime
+
+$(BUILD_DIR)/boottime: tools/boottime.c src/boot.c | $(BUILD_DIR)
+	$(CC) $(CFLAGS) $(INCLUDES) $^ -o $@
+	@echo "Build complete: $@"
+
+# Worst-case stack depth checker, run by "make" (see tools/stack_depth.h)
+stackcheck: $(BUILD_DIR)/stackcheck
+
+$(BUILD_DIR)/stackcheck: tools/stackcheck.c tools/stack_depth.c | $(BUILD_DIR)
+	$(CC) $(CFLAGS) $(INCLUDES) $^ -o $@
+	@echo "Build complete: $@"
+
+# Modbus protocol engine fuzz harness under the sanitizers (see tools/modbus_fuzz.c)
+modbus_fuzz: $(BUILD_DIR)/modbus_fuzz
+
+$(BUILD_DIR)/modbus_fuzz: tools/modbus_fuzz.c src/modbus.c | $(BUILD_DIR)
+	$(CC) $(CFLAGS) -O1 -fsanitize=address,undefined -fno-sanitize-recover=all $(INCLUDES) $^ -o $@
+	@echo "Build complete: $@"
+
+# Fixed-point math tables, computed on the host into the build directory for
+# the tests and for "make" (see Inc/fixmath.h)
+fixmath_gen: $(BUILD_DIR)/fixmath_gen
+
+$(BUILD_DIR)/fixmath_gen: tools/fixmath_gen.c Inc/fixmath.h | $(BUILD_DIR)
+	$(CC) $(CFLAGS) $(INCLUDES) $< -lm -o $@
+	@echo "Build complete: $@"
+
+$(BUILD_DIR)/fixmath_tables.c: $(BUILD_DIR)/fixmath_gen
+	./$< > $@
+
+$(BUILD_DIR)/fixmath_tables.o: $(BUILD_DIR)/fixmath_tables.c
+	$(CC) -c $(CFLAGS) $(INCLUDES) $< -o $@
+
+# Compressed console decoder (see Inc/console_lz.h)
+lzcat: $(BUILD_DIR)/lzcat
+
+$(BUILD_DIR)/lzcat: tools/lzcat.c src/lzss.c | $(BUILD_DIR)
+	$(CC) $(CFLAGS) $(INCLUDES) $^ -o $@
 	@echo "Build complete: $@"
 
 # Compile C files
@@ -56,28 +179,32 @@ $(BUILD_DIR):
 	mkdir -p $@
 
 # ==== Test Execution ====
-test: $(BUILD_DIR)/$(TARGET)
+test: $(BUILD_DIR)/$(TARGET) $(SUITE_BINS)
 	@echo "===================="
 	@echo "Running Unit Tests"
 	@echo "===================="
 	./$(BUILD_DIR)/$(TARGET)
+	@for t in $(SUITE_BINS); do ./$$t || exit 1; done
 	@echo "===================="
 
 # Run tests with verbose output
-test-verbose: $(BUILD_DIR)/$(TARGET)
+test-verbose: $(BUILD_DIR)/$(TARGET) $(SUITE_BINS)
 	@echo "===================="
 	@echo "Running Unit Tests (Verbose)"
 	@echo "===================="
 	./$(BUILD_DIR)/$(TARGET) -v
+	@for t in $(SUITE_BINS); do ./$$t -v || exit 1; done
 	@echo "===================="
 
 # Run tests with memory check (if valgrind is available)
-test-memcheck: $(BUILD_DIR)/$(TARGET)
+test-memcheck: $(BUILD_DIR)/$(TARGET) $(SUITE_BINS)
 	@if command -v valgrind >/dev/null 2>&1; then \
 		echo "===================="; \
 		echo "Running Memory Check"; \
 		echo "===================="; \
-		valgrind --leak-check=full --show-leak-kinds=all --track-origins=yes ./$(BUILD_DIR)/$(TARGET); \
+		for t in $(BUILD_DIR)/$(TARGET) $(SUITE_BINS); do \
+			valgrind --leak-check=full --show-leak-kinds=all --track-origins=yes --error-exitcode=1 ./$$t || exit 1; \
+		done; \
 		echo "===================="; \
 	else \
 		echo "Valgrind not available, running normal test"; \
@@ -88,7 +215,7 @@ test-memcheck: $(BUILD_DIR)/$(TARGET)
 # Build with coverage flags
 coverage-build: CFLAGS += --coverage
 coverage-build: LDFLAGS += --coverage
-coverage-build: clean $(BUILD_DIR)/$(TARGET)
+coverage-build: clean $(BUILD_DIR)/$(TARGET) $(SUITE_BINS)
 
 # Run tests and generate coverage report
 coverage: coverage-build
@@ -96,9 +223,10 @@ coverage: coverage-build
 	@echo "Running Coverage Analysis"
 	@echo "===================="
 	./$(BUILD_DIR)/$(TARGET)
+	@for t in $(SUITE_BINS); do ./$$t || exit 1; done
 	@if command -v gcov >/dev/null 2>&1; then \
 		echo "Generating coverage report..."; \
-		gcov $(TEST_SOURCES) $(TESTABLE_SOURCES) -o $(BUILD_DIR); \
+		gcov $(TEST_SOURCES) $(TESTABLE_SOURCES) $(SUITE_SOURCES) -o $(BUILD_DIR); \
 		echo "Coverage files generated in current directory"; \
 	else \
 		echo "gcov not available for coverage analysis"; \
@@ -128,7 +256,7 @@ static-analysis:
 		echo "====================";\
 		echo "Running Static Analysis"; \
 		echo "===================="; \
-		cppcheck --enable=all --std=c99 --platform=unix32 --suppress=missingIncludeSystem $(TEST_SOURCES) $(TESTABLE_SOURCES); \
+		cppcheck --enable=all --std=c99 --platform=unix32 --suppress=missingIncludeSystem $(TEST_SOURCES) $(TESTABLE_SOURCES) $(SUITE_SOURCES) $(SUITE_TESTS); \
 		echo "===================="; \
 	else \
 		echo "cppcheck not available for static analysis"; \
@@ -167,6 +295,9 @@ info:
 	@echo "Source Files:"
 	@for src in $(SOURCES); do echo "  $$src"; done
 	@echo ""
+	@echo "Module Suites:"
+	@for s in $(SUITES); do echo "  $$s"; done
+	@echo ""
 	@echo "Available Targets:"
 	@echo "  all          - Build test executable"
 	@echo "  test         - Run unit tests"
@@ -176,6 +307,12 @@ info:
 	@echo "  coverage-html- Generate HTML coverage report"
 	@echo "  debug        - Run tests in debugger"
 	@echo "  static-analysis - Run static code analysis"
+	@echo "  trace2json   - Build the trace dump converter"
+	@echo "  boottime     - Build the boot record decoder"
+	@echo "  stackcheck   - Build the stack depth checker"
+	@echo "  modbus_fuzz  - Build the Modbus engine fuzz harness"
+	@echo "  fixmath_gen  - Build the fixed-point math table generator"
+	@echo "  lzcat        - Build the compressed console decoder"
 	@echo "  ci           - Run all CI tests"
 	@echo "  clean        - Clean build artifacts"
 	@echo "  distclean    - Clean everything"
@@ -187,14 +324,14 @@ help: info
 
 # ==== Dependencies ====
 # Automatic dependency generation
-DEPS = $(OBJECTS:.o=.d)
+DEPS = $(OBJECTS:.o=.d) $(SUITE_OBJECTS:.o=.d)
 -include $(DEPS)
 
 $(BUILD_DIR)/%.o: %.c | $(BUILD_DIR)
 	$(CC) -c $(CFLAGS) $(INCLUDES) -MMD -MP $< -o $@
 
 # ==== Phony Targets ====
-.PHONY: all test test-verbose test-memcheck coverage coverage-build coverage-html debug static-analysis ci clean distclean info help
+.PHONY: all test trace2json boottime stackcheck modbus_fuzz fixmath_gen lzcat test-verbose test-memcheck coverage coverage-build coverage-html debug static-analysis ci clean distclean info help
 
 # Default target
 .DEFAULT_GOAL := test
\ No newline at end of file
@@ -261,6 +261,7 @@ uint16_t mock_get_last_gpio_pin(void);
 #define TIM_COUNTERMODE_UP                  0x00000000U
 #define TIM_AUTORELOAD_PRELOAD_DISABLE      0x00000000U
 #define TIM_TRGO_RESET                      0x00000000U
+#define TIM_TRGO_UPDATE                     0x00000020U
 #define TIM_MASTERSLAVEMODE_DISABLE         0x00000000U
 
 #ifdef __cplusplus
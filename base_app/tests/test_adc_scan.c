@@ -0,0 +1,279 @@
+/**
+  ******************************************************************************
+  * @file    test_adc_scan.c
+  * @author  Test Framework
+  * @brief   Unit tests for the ADC double buffer, decimator and scan timing
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "adc_scan.h"
+#include <string.h>
+
+#define HALF           8U
+#define CHANNELS       2U
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+static uint16_t buffer[2U * HALF];
+static ADC_SCAN_RingTypeDef ring;
+static ADC_SCAN_DecimatorTypeDef dec;
+static uint32_t lcg;
+
+void setUp(void)
+{
+    memset(buffer, 0, sizeof(buffer));
+    ADC_SCAN_RingInit(&ring, buffer, HALF);
+    lcg = 12345U;
+}
+
+void tearDown(void)
+{
+}
+
+/* Noise of -2..+2 LSB, the same sequence every run */
+static int32_t Noise(void)
+{
+    lcg = lcg * 1664525U + 1013904223U;
+    return (int32_t)((lcg >> 16) % 5U) - 2;
+}
+
+/* Stand-in for the DMA: fill a half with frames and signal it */
+static void DmaWrite(uint32_t half, uint16_t ch0, uint16_t ch1, uint8_t noisy)
+{
+    uint32_t i;
+
+    for (i = 0U; i < HALF; i += CHANNELS)
+    {
+        buffer[half * HALF + i]      = (uint16_t)(ch0 + (noisy ? Noise() : 0));
+        buffer[half * HALF + i + 1U] = (uint16_t)(ch1 + (noisy ? Noise() : 0));
+    }
+    ADC_SCAN_HalfDone(&ring, half);
+}
+
+/* ============================================================================ */
+/* RING TESTS */
+/* ============================================================================ */
+
+void test_ring_nothing_ready(void)
+{
+    uint32_t half = 9U;
+
+    TEST_ASSERT_NULL(ADC_SCAN_Acquire(&ring, &half));
+    TEST_ASSERT_EQUAL_UINT32(9U, half);
+}
+
+void test_ring_halves_in_order(void)
+{
+    uint32_t half = 9U;
+
+    // Act
+    DmaWrite(0U, 1U, 2U, 0U);
+
+    // Assert
+    TEST_ASSERT_TRUE(ADC_SCAN_Acquire(&ring, &half) == &buffer[0]);
+    TEST_ASSERT_EQUAL_UINT32(0U, half);
+    ADC_SCAN_Release(&ring, 0U, HALF + 1U);
+    TEST_ASSERT_NULL(ADC_SCAN_Acquire(&ring, &half));
+
+    DmaWrite(1U, 1U, 2U, 0U);
+    TEST_ASSERT_TRUE(ADC_SCAN_Acquire(&ring, &half) == &buffer[HALF]);
+    TEST_ASSERT_EQUAL_UINT32(1U, half);
+    ADC_SCAN_Release(&ring, 1U, 0U);
+
+    TEST_ASSERT_EQUAL_UINT32(2U, ring.Halves);
+    TEST_ASSERT_EQUAL_UINT32(0U, ring.Overruns);
+}
+
+void test_ring_overrun_takes_older_half_first(void)
+{
+    uint32_t half = 9U;
+
+    // The reader sleeps through three halves
+    DmaWrite(0U, 1U, 2U, 0U);
+    DmaWrite(1U, 1U, 2U, 0U);
+    DmaWrite(0U, 1U, 2U, 0U);
+
+    TEST_ASSERT_EQUAL_UINT32(1U, ring.Overruns);
+    TEST_ASSERT_NOT_NULL(ADC_SCAN_Acquire(&ring, &half));
+    TEST_ASSERT_EQUAL_UINT32(1U, half);
+    ADC_SCAN_Release(&ring, 1U, 1U);
+    TEST_ASSERT_NOT_NULL(ADC_SCAN_Acquire(&ring, &half));
+    TEST_ASSERT_EQUAL_UINT32(0U, half);
+}
+
+void test_ring_late_release_is_overrun(void)
+{
+    uint32_t half = 9U;
+
+    DmaWrite(0U, 1U, 2U, 0U);
+    TEST_ASSERT_NOT_NULL(ADC_SCAN_Acquire(&ring, &half));
+
+    // The DMA went round and is writing half 0 again
+    ADC_SCAN_Release(&ring, 0U, 3U);
+
+    TEST_ASSERT_EQUAL_UINT32(1U, ring.Overruns);
+    TEST_ASSERT_EQUAL_UINT32(1U, ring.Halves);
+}
+
+/* ============================================================================ */
+/* DECIMATOR TESTS */
+/* ============================================================================ */
+
+void test_decimator_invalid(void)
+{
+    TEST_ASSERT_EQUAL(ADC_SCAN_INVALID, ADC_SCAN_DecimatorInit(&dec, 0U, 4U));
+    TEST_ASSERT_EQUAL(ADC_SCAN_INVALID, ADC_SCAN_DecimatorInit(&dec, ADC_SCAN_MAX_CHANNELS + 1U, 4U));
+    TEST_ASSERT_EQUAL(ADC_SCAN_INVALID, ADC_SCAN_DecimatorInit(&dec, 2U, 0U));
+    TEST_ASSERT_EQUAL(ADC_SCAN_INVALID, ADC_SCAN_DecimatorInit(&dec, 2U, ADC_SCAN_MAX_RATIO + 1U));
+}
+
+void test_decimator_channels_kept_apart(void)
+{
+    const uint16_t frames[8] = {100U, 4000U, 100U, 4000U, 100U, 4000U, 100U, 4000U};
+
+    TEST_ASSERT_EQUAL(ADC_SCAN_OK, ADC_SCAN_DecimatorInit(&dec, 2U, 4U));
+
+    // Act
+    TEST_ASSERT_EQUAL_UINT32(1U, ADC_SCAN_Decimate(&dec, frames, 4U));
+
+    // Assert: 16-bit scale
+    TEST_ASSERT_EQUAL_UINT16(1600U, dec.Out[0]);
+    TEST_ASSERT_EQUAL_UINT16(64000U, dec.Out[1]);
+    TEST_ASSERT_EQUAL_UINT32(1U, dec.Outputs);
+    TEST_ASSERT_EQUAL_UINT32(0U, dec.Sum[0]);
+}
+
+void test_decimator_gains_resolution(void)
+{
+    const uint16_t dithered[4] = {1000U, 1001U, 1000U, 1000U};
+
+    // 1000.25 LSB: invisible in one sample, exact in the mean of four
+    TEST_ASSERT_EQUAL(ADC_SCAN_OK, ADC_SCAN_DecimatorInit(&dec, 1U, 4U));
+    ADC_SCAN_Decimate(&dec, dithered, 4U);
+
+    TEST_ASSERT_EQUAL_UINT16(16004U, dec.Out[0]);
+}
+
+void test_decimator_output_spans_calls(void)
+{
+    const uint16_t ramp[6] = {0U, 1U, 2U, 3U, 4U, 5U};
+
+    // Ratio 3 fed two frames at a time
+    TEST_ASSERT_EQUAL(ADC_SCAN_OK, ADC_SCAN_DecimatorInit(&dec, 1U, 3U));
+
+    TEST_ASSERT_EQUAL_UINT32(0U, ADC_SCAN_Decimate(&dec, &ramp[0], 2U));
+    TEST_ASSERT_EQUAL_UINT32(1U, ADC_SCAN_Decimate(&dec, &ramp[2], 2U));
+    TEST_ASSERT_EQUAL_UINT16(16U, dec.Out[0]);
+    TEST_ASSERT_EQUAL_UINT32(1U, ADC_SCAN_Decimate(&dec, &ramp[4], 2U));
+    TEST_ASSERT_EQUAL_UINT16(64U, dec.Out[0]);
+    TEST_ASSERT_EQUAL_UINT32(2U, dec.Outputs);
+}
+
+void test_decimator_full_scale_does_not_wrap(void)
+{
+    static uint16_t full[1024];
+    uint32_t i;
+
+    for (i = 0U; i < 1024U; i++)
+    {
+        full[i] = 4095U;
+    }
+
+    // The largest ratio, fed in 1024-frame blocks
+    TEST_ASSERT_EQUAL(ADC_SCAN_OK, ADC_SCAN_DecimatorInit(&dec, 1U, ADC_SCAN_MAX_RATIO));
+    for (i = 0U; i < ADC_SCAN_MAX_RATIO / 1024U; i++)
+    {
+        ADC_SCAN_Decimate(&dec, full, 1024U);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(1U, dec.Outputs);
+    TEST_ASSERT_EQUAL_UINT16(65520U, dec.Out[0]);
+}
+
+void test_stream_noisy_halves(void)
+{
+    const uint16_t *samples;
+    uint32_t half = 0U;
+    uint32_t outputs = 0U;
+    uint32_t i;
+
+    // 2 channels, 4 frames a half, an output every 64 frames
+    TEST_ASSERT_EQUAL(ADC_SCAN_OK, ADC_SCAN_DecimatorInit(&dec, CHANNELS, 64U));
+
+    // Act: 64 halves as the DMA would write them, each taken at once
+    for (i = 0U; i < 64U; i++)
+    {
+        DmaWrite(i & 1U, 1234U, 3000U, 1U);
+        samples = ADC_SCAN_Acquire(&ring, &half);
+        TEST_ASSERT_NOT_NULL(samples);
+        outputs += ADC_SCAN_Decimate(&dec, samples, HALF / CHANNELS);
+        ADC_SCAN_Release(&ring, half, (half ^ 1U) * HALF);
+    }
+
+    // Assert: four outputs, +-2 LSB of noise averaged to within half an LSB
+    TEST_ASSERT_EQUAL_UINT32(4U, outputs);
+    TEST_ASSERT_INT_WITHIN(8, 1234 * 16, dec.Out[0]);
+    TEST_ASSERT_INT_WITHIN(8, 3000 * 16, dec.Out[1]);
+    TEST_ASSERT_EQUAL_UINT32(0U, ring.Overruns);
+    TEST_ASSERT_EQUAL_UINT32(64U, ring.Halves);
+}
+
+/* ============================================================================ */
+/* TIMING TESTS */
+/* ============================================================================ */
+
+void test_frame_cycles(void)
+{
+    const uint8_t smp[3] = {7U, 0U, 3U};
+    const uint8_t bad[2] = {1U, 8U};
+
+    TEST_ASSERT_EQUAL_UINT32(3U, ADC_SCAN_SampleCycles(0U));
+    TEST_ASSERT_EQUAL_UINT32(480U, ADC_SCAN_SampleCycles(7U));
+    TEST_ASSERT_EQUAL_UINT32(0U, ADC_SCAN_SampleCycles(8U));
+
+    TEST_ASSERT_EQUAL_UINT32(492U + 15U + 68U, ADC_SCAN_FrameCycles(smp, 3U));
+    TEST_ASSERT_EQUAL_UINT32(0U, ADC_SCAN_FrameCycles(bad, 2U));
+    TEST_ASSERT_EQUAL_UINT32(0U, ADC_SCAN_FrameCycles(smp, 0U));
+}
+
+void test_rate(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(4200000U, ADC_SCAN_Rate(420000U, 100U));
+    TEST_ASSERT_EQUAL_UINT32(667U, ADC_SCAN_Rate(2U, 3U));
+    TEST_ASSERT_EQUAL_UINT32(0U, ADC_SCAN_Rate(1000U, 0U));
+
+    // A second of 4.2 Msps does not overflow
+    TEST_ASSERT_EQUAL_UINT32(4200000U, ADC_SCAN_Rate(4200000U, 1000U));
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Ring Tests */
+    RUN_TEST(test_ring_nothing_ready);
+    RUN_TEST(test_ring_halves_in_order);
+    RUN_TEST(test_ring_overrun_takes_older_half_first);
+    RUN_TEST(test_ring_late_release_is_overrun);
+
+    /* Decimator Tests */
+    RUN_TEST(test_decimator_invalid);
+    RUN_TEST(test_decimator_channels_kept_apart);
+    RUN_TEST(test_decimator_gains_resolution);
+    RUN_TEST(test_decimator_output_spans_calls);
+    RUN_TEST(test_decimator_full_scale_does_not_wrap);
+    RUN_TEST(test_stream_noisy_halves);
+
+    /* Timing Tests */
+    RUN_TEST(test_frame_cycles);
+    RUN_TEST(test_rate);
+
+    return UNITY_END();
+}
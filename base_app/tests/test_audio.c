@@ -0,0 +1,558 @@
+/**
+  ******************************************************************************
+  * @file    test_audio.c
+  * @author  Test Framework
+  * @brief   Unit tests for the audio mixer, resampler and DMA ring
+  ******************************************************************************
+  * The reference clips are built as real RIFF/WAVE images so the tests go
+  * through the same parser the firmware uses for clips linked into flash.
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "audio_mixer.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define PI                 3.14159265358979323846
+#define WAV_HEADER_SIZE    44U
+#define REF_RATE           8000U
+#define REF_TONE_HZ        250.0
+#define REF_AMPLITUDE      10000.0
+#define OUT_RATE           48000U
+
+static uint8_t *wav_image;
+static AUDIO_MixerTypeDef mixer;
+
+/* ============================================================================ */
+/* HELPERS */
+/* ============================================================================ */
+
+static void PutLE16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void PutLE32(uint8_t *p, uint32_t v)
+{
+    PutLE16(p, (uint16_t)v);
+    PutLE16(p + 2, (uint16_t)(v >> 16));
+}
+
+/**
+  * @brief  Build a canonical 44-byte-header PCM WAV image
+  * @retval Image size in bytes
+  */
+static uint32_t BuildWav(uint8_t *out, const int16_t *samples, uint32_t frames,
+                         uint16_t channels, uint32_t rate, uint16_t bits)
+{
+    uint32_t data_size = frames * channels * 2U;
+
+    memcpy(out, "RIFF", 4);
+    PutLE32(out + 4, 36U + data_size);
+    memcpy(out + 8, "WAVE", 4);
+    memcpy(out + 12, "fmt ", 4);
+    PutLE32(out + 16, 16U);
+    PutLE16(out + 20, 1U);
+    PutLE16(out + 22, channels);
+    PutLE32(out + 24, rate);
+    PutLE32(out + 28, rate * channels * 2U);
+    PutLE16(out + 32, (uint16_t)(channels * 2U));
+    PutLE16(out + 34, bits);
+    memcpy(out + 36, "data", 4);
+    PutLE32(out + 40, data_size);
+    memcpy(out + WAV_HEADER_SIZE, samples, data_size);
+    return WAV_HEADER_SIZE + data_size;
+}
+
+/**
+  * @brief  One second of the reference tone as a mono WAV at REF_RATE
+  */
+static uint32_t BuildReferenceTone(AUDIO_SourceTypeDef *source)
+{
+    int16_t *pcm = malloc(REF_RATE * sizeof(int16_t));
+    uint32_t size;
+    uint32_t i;
+
+    for (i = 0; i < REF_RATE; i++)
+    {
+        pcm[i] = (int16_t)lround(REF_AMPLITUDE * sin(2.0 * PI * REF_TONE_HZ * i / REF_RATE));
+    }
+    size = BuildWav(wav_image, pcm, REF_RATE, 1U, REF_RATE, 16U);
+    free(pcm);
+    TEST_ASSERT_EQUAL(AUDIO_OK, AUDIO_WAV_Parse(wav_image, size, source));
+    return size;
+}
+
+void setUp(void)
+{
+    wav_image = malloc(WAV_HEADER_SIZE + 4U * OUT_RATE);
+    AUDIO_Mixer_Init(&mixer, OUT_RATE);
+}
+
+void tearDown(void)
+{
+    free(wav_image);
+    wav_image = NULL;
+}
+
+/* ============================================================================ */
+/* WAV PARSER TESTS */
+/* ============================================================================ */
+
+void test_wav_parse_mono_pcm(void)
+{
+    /* Arrange */
+    const int16_t pcm[4] = {1, -2, 3, -4};
+    AUDIO_SourceTypeDef src;
+    uint32_t size = BuildWav(wav_image, pcm, 4U, 1U, 22050U, 16U);
+
+    /* Act / Assert */
+    TEST_ASSERT_EQUAL(AUDIO_OK, AUDIO_WAV_Parse(wav_image, size, &src));
+    TEST_ASSERT_EQUAL_UINT32(4U, src.Frames);
+    TEST_ASSERT_EQUAL_UINT32(22050U, src.SampleRate);
+    TEST_ASSERT_EQUAL_UINT8(1U, src.Channels);
+    TEST_ASSERT_EQUAL_INT16(-4, src.Samples[3]);
+}
+
+void test_wav_parse_skips_unknown_odd_chunk(void)
+{
+    /* Arrange: fmt, a 3-byte LIST chunk (padded to 4), then data */
+    const int16_t pcm[2] = {100, 200};
+    uint8_t image[WAV_HEADER_SIZE + 12U + 4U];
+    AUDIO_SourceTypeDef src;
+
+    BuildWav(wav_image, pcm, 2U, 1U, 8000U, 16U);
+    memcpy(image, wav_image, 36);
+    memcpy(image + 36, "LIST", 4);
+    PutLE32(image + 40, 3U);
+    memset(image + 44, 0, 4);
+    memcpy(image + 48, wav_image + 36, 8U + 4U);
+
+    /* Act / Assert */
+    TEST_ASSERT_EQUAL(AUDIO_OK, AUDIO_WAV_Parse(image, sizeof(image), &src));
+    TEST_ASSERT_EQUAL_UINT32(2U, src.Frames);
+    TEST_ASSERT_EQUAL_INT16(200, src.Samples[1]);
+}
+
+void test_wav_parse_rejects_unsupported(void)
+{
+    const int16_t pcm[4] = {0};
+    AUDIO_SourceTypeDef src;
+    uint32_t size;
+
+    /* 8-bit samples */
+    size = BuildWav(wav_image, pcm, 4U, 1U, 8000U, 8U);
+    TEST_ASSERT_EQUAL(AUDIO_ERROR, AUDIO_WAV_Parse(wav_image, size, &src));
+
+    /* Compressed format tag */
+    size = BuildWav(wav_image, pcm, 2U, 2U, 8000U, 16U);
+    PutLE16(wav_image + 20, 3U);
+    TEST_ASSERT_EQUAL(AUDIO_ERROR, AUDIO_WAV_Parse(wav_image, size, &src));
+
+    /* Data chunk running past the end of the image */
+    size = BuildWav(wav_image, pcm, 4U, 1U, 8000U, 16U);
+    TEST_ASSERT_EQUAL(AUDIO_ERROR, AUDIO_WAV_Parse(wav_image, size - 2U, &src));
+
+    /* Not a RIFF image */
+    TEST_ASSERT_EQUAL(AUDIO_ERROR, AUDIO_WAV_Parse((const uint8_t *)"RIFX....WAVE", 12U, &src));
+}
+
+/* ============================================================================ */
+/* MIXER TESTS */
+/* ============================================================================ */
+
+void test_mixer_idle_renders_silence(void)
+{
+    int16_t out[32];
+    uint32_t i;
+
+    memset(out, 0x55, sizeof(out));
+    AUDIO_Mixer_Render(&mixer, out, 16U);
+
+    for (i = 0; i < 32U; i++)
+    {
+        TEST_ASSERT_EQUAL_INT16(0, out[i]);
+    }
+}
+
+void test_mixer_same_rate_is_bit_exact(void)
+{
+    /* Arrange */
+    AUDIO_SourceTypeDef src;
+    int16_t out[2U * 64U];
+    uint32_t i;
+
+    BuildReferenceTone(&src);
+    src.SampleRate = OUT_RATE;
+
+    /* Act */
+    TEST_ASSERT_EQUAL_INT32(0, AUDIO_Mixer_Play(&mixer, &src, AUDIO_GAIN_UNITY, 0U));
+    AUDIO_Mixer_Render(&mixer, out, 64U);
+
+    /* Assert: mono is duplicated on both channels, unchanged */
+    for (i = 0; i < 64U; i++)
+    {
+        TEST_ASSERT_EQUAL_INT16(src.Samples[i], out[2U * i]);
+        TEST_ASSERT_EQUAL_INT16(src.Samples[i], out[2U * i + 1U]);
+    }
+}
+
+void test_mixer_resamples_reference_tone(void)
+{
+    /* Arrange: 8 kHz reference WAV played at 48 kHz */
+    AUDIO_SourceTypeDef src;
+    int16_t *out = malloc(2U * OUT_RATE * sizeof(int16_t));
+    int32_t worst = 0;
+    uint32_t i;
+
+    BuildReferenceTone(&src);
+    AUDIO_Mixer_Play(&mixer, &src, AUDIO_GAIN_UNITY, 0U);
+
+    /* Act */
+    AUDIO_Mixer_Render(&mixer, out, OUT_RATE - 6U);
+
+    /* Assert: matches the analytic tone at the output instants */
+    for (i = 0; i < OUT_RATE - 6U; i++)
+    {
+        double expected = REF_AMPLITUDE * sin(2.0 * PI * REF_TONE_HZ * i / OUT_RATE);
+        int32_t err = abs(out[2U * i] - (int32_t)lround(expected));
+        if (err > worst)
+        {
+            worst = err;
+        }
+    }
+    TEST_ASSERT_INT_WITHIN(64, 0, worst);
+    TEST_ASSERT_EQUAL_UINT32(0U, mixer.Clipped);
+    free(out);
+}
+
+void test_mixer_voice_ends_with_clip(void)
+{
+    /* 8000 source frames at a 6x ratio last 48000 output frames */
+    AUDIO_SourceTypeDef src;
+    int16_t *out = malloc(2U * OUT_RATE * sizeof(int16_t));
+
+    BuildReferenceTone(&src);
+    AUDIO_Mixer_Play(&mixer, &src, AUDIO_GAIN_UNITY, 0U);
+
+    AUDIO_Mixer_Render(&mixer, out, OUT_RATE - 6U);
+    TEST_ASSERT_EQUAL_UINT32(1U, AUDIO_Mixer_ActiveVoices(&mixer));
+
+    AUDIO_Mixer_Render(&mixer, out, 6U);
+    TEST_ASSERT_EQUAL_UINT32(0U, AUDIO_Mixer_ActiveVoices(&mixer));
+    free(out);
+}
+
+void test_mixer_loop_wraps_around(void)
+{
+    const int16_t pcm[3] = {10, 20, 30};
+    AUDIO_SourceTypeDef src;
+    int16_t out[2U * 7U];
+    uint32_t size = BuildWav(wav_image, pcm, 3U, 1U, OUT_RATE, 16U);
+    const int16_t expected[7] = {10, 20, 30, 10, 20, 30, 10};
+    uint32_t i;
+
+    AUDIO_WAV_Parse(wav_image, size, &src);
+    AUDIO_Mixer_Play(&mixer, &src, AUDIO_GAIN_UNITY, 1U);
+    AUDIO_Mixer_Render(&mixer, out, 7U);
+
+    for (i = 0; i < 7U; i++)
+    {
+        TEST_ASSERT_EQUAL_INT16(expected[i], out[2U * i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1U, AUDIO_Mixer_ActiveVoices(&mixer));
+}
+
+void test_mixer_stereo_channels_stay_separate(void)
+{
+    const int16_t pcm[4] = {1000, -1000, 2000, -2000};
+    AUDIO_SourceTypeDef src;
+    int16_t out[4];
+    uint32_t size = BuildWav(wav_image, pcm, 2U, 2U, OUT_RATE, 16U);
+
+    AUDIO_WAV_Parse(wav_image, size, &src);
+    AUDIO_Mixer_Play(&mixer, &src, AUDIO_GAIN_UNITY / 2, 0U);
+    AUDIO_Mixer_Render(&mixer, out, 2U);
+
+    TEST_ASSERT_EQUAL_INT16(500, out[0]);
+    TEST_ASSERT_EQUAL_INT16(-500, out[1]);
+    TEST_ASSERT_EQUAL_INT16(1000, out[2]);
+    TEST_ASSERT_EQUAL_INT16(-1000, out[3]);
+}
+
+void test_mixer_sums_and_saturates(void)
+{
+    const int16_t pcm[2] = {30000, -30000};
+    AUDIO_SourceTypeDef src;
+    int16_t out[4];
+    uint32_t size = BuildWav(wav_image, pcm, 2U, 1U, OUT_RATE, 16U);
+
+    AUDIO_WAV_Parse(wav_image, size, &src);
+    AUDIO_Mixer_Play(&mixer, &src, AUDIO_GAIN_UNITY, 0U);
+    AUDIO_Mixer_Play(&mixer, &src, AUDIO_GAIN_UNITY, 0U);
+    AUDIO_Mixer_Render(&mixer, out, 2U);
+
+    TEST_ASSERT_EQUAL_INT16(INT16_MAX, out[0]);
+    TEST_ASSERT_EQUAL_INT16(INT16_MIN, out[2]);
+    TEST_ASSERT_EQUAL_UINT32(4U, mixer.Clipped);
+}
+
+void test_mixer_rejects_when_full(void)
+{
+    AUDIO_SourceTypeDef src;
+    uint32_t i;
+
+    BuildReferenceTone(&src);
+    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+    {
+        TEST_ASSERT_EQUAL_INT32((int32_t)i, AUDIO_Mixer_Play(&mixer, &src, AUDIO_GAIN_UNITY, 1U));
+    }
+    TEST_ASSERT_EQUAL_INT32(-1, AUDIO_Mixer_Play(&mixer, &src, AUDIO_GAIN_UNITY, 1U));
+
+    AUDIO_Mixer_Stop(&mixer, 1);
+    TEST_ASSERT_EQUAL_INT32(1, AUDIO_Mixer_Play(&mixer, &src, AUDIO_GAIN_UNITY, 1U));
+}
+
+/* ============================================================================ */
+/* RING TESTS */
+/* ============================================================================ */
+
+void test_ring_primes_both_halves(void)
+{
+    int16_t buffer[4U * 8U];
+    AUDIO_RingTypeDef ring;
+    uint32_t half = 99U;
+
+    AUDIO_Ring_Init(&ring, buffer, 8U);
+
+    TEST_ASSERT_TRUE(AUDIO_Ring_Acquire(&ring, &half) == &buffer[0]);
+    TEST_ASSERT_EQUAL_UINT32(0U, half);
+    AUDIO_Ring_Commit(&ring, half, 0U);
+
+    TEST_ASSERT_TRUE(AUDIO_Ring_Acquire(&ring, &half) == &buffer[16]);
+    TEST_ASSERT_EQUAL_UINT32(1U, half);
+    AUDIO_Ring_Commit(&ring, half, 0U);
+
+    TEST_ASSERT_NULL(AUDIO_Ring_Acquire(&ring, &half));
+    TEST_ASSERT_EQUAL_UINT32(0U, ring.Underruns);
+    TEST_ASSERT_EQUAL_UINT32(2U, ring.Fills);
+}
+
+void test_ring_in_time_refill_has_no_underrun(void)
+{
+    int16_t buffer[4U * 8U];
+    AUDIO_RingTypeDef ring;
+    uint32_t half;
+    uint32_t cycle;
+
+    AUDIO_Ring_Init(&ring, buffer, 8U);
+    AUDIO_Ring_Acquire(&ring, &half);
+    AUDIO_Ring_Commit(&ring, half, 0U);
+    AUDIO_Ring_Acquire(&ring, &half);
+    AUDIO_Ring_Commit(&ring, half, 0U);
+
+    for (cycle = 0; cycle < 10U; cycle++)
+    {
+        uint32_t done = cycle & 1U;
+
+        AUDIO_Ring_HalfDone(&ring, done);
+        TEST_ASSERT_NOT_NULL(AUDIO_Ring_Acquire(&ring, &half));
+        TEST_ASSERT_EQUAL_UINT32(done, half);
+        /* DMA is early in the other half */
+        AUDIO_Ring_Commit(&ring, half, (done ^ 1U) * 8U + 1U);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(0U, ring.Underruns);
+    TEST_ASSERT_EQUAL_UINT32(12U, ring.Fills);
+}
+
+void test_ring_counts_missed_refill(void)
+{
+    int16_t buffer[4U * 8U];
+    AUDIO_RingTypeDef ring;
+    uint32_t half;
+
+    AUDIO_Ring_Init(&ring, buffer, 8U);
+    AUDIO_Ring_Acquire(&ring, &half);
+    AUDIO_Ring_Commit(&ring, half, 0U);
+    AUDIO_Ring_Acquire(&ring, &half);
+    AUDIO_Ring_Commit(&ring, half, 0U);
+
+    /* Half 0 is released and never refilled: the DMA wraps onto it */
+    AUDIO_Ring_HalfDone(&ring, 0U);
+    AUDIO_Ring_HalfDone(&ring, 1U);
+    TEST_ASSERT_EQUAL_UINT32(1U, ring.Underruns);
+
+    /* Software now gets the freshest half; the stale one is not recounted */
+    TEST_ASSERT_NOT_NULL(AUDIO_Ring_Acquire(&ring, &half));
+    TEST_ASSERT_EQUAL_UINT32(1U, half);
+    AUDIO_Ring_Commit(&ring, half, 2U);
+    TEST_ASSERT_EQUAL_UINT32(1U, ring.Underruns);
+
+    /* Next pass is back in time */
+    AUDIO_Ring_HalfDone(&ring, 0U);
+    TEST_ASSERT_EQUAL_UINT32(1U, ring.Underruns);
+}
+
+void test_ring_counts_late_commit(void)
+{
+    int16_t buffer[4U * 8U];
+    AUDIO_RingTypeDef ring;
+    uint32_t half;
+
+    AUDIO_Ring_Init(&ring, buffer, 8U);
+    AUDIO_Ring_Acquire(&ring, &half);
+    AUDIO_Ring_Commit(&ring, half, 0U);
+    AUDIO_Ring_Acquire(&ring, &half);
+    AUDIO_Ring_Commit(&ring, half, 0U);
+
+    /* Rendering half 0 took so long the DMA is already reading it again */
+    AUDIO_Ring_HalfDone(&ring, 0U);
+    AUDIO_Ring_Acquire(&ring, &half);
+    AUDIO_Ring_Commit(&ring, half, 3U);
+
+    TEST_ASSERT_EQUAL_UINT32(1U, ring.Underruns);
+}
+
+void test_ring_latency_figure(void)
+{
+    int16_t buffer[4U * 240U];
+    AUDIO_RingTypeDef ring;
+
+    AUDIO_Ring_Init(&ring, buffer, 240U);
+
+    TEST_ASSERT_EQUAL_UINT32(10000U, AUDIO_Ring_LatencyUs(&ring, 48000U));
+    TEST_ASSERT_EQUAL_UINT32(60000U, AUDIO_Ring_LatencyUs(&ring, 8000U));
+    TEST_ASSERT_EQUAL_UINT32(0U, AUDIO_Ring_LatencyUs(&ring, 0U));
+}
+
+void test_ring_stream_matches_direct_render(void)
+{
+    /* Arrange: render the reference tone once directly ... */
+    enum { HALF = 60U, HALVES = 40U };
+    AUDIO_SourceTypeDef src;
+    AUDIO_MixerTypeDef direct;
+    AUDIO_RingTypeDef ring;
+    int16_t buffer[4U * HALF];
+    int16_t *expected = malloc(2U * HALF * HALVES * sizeof(int16_t));
+    uint32_t played = 0U;
+    uint32_t half;
+    int16_t *block;
+    uint32_t h;
+    uint32_t i;
+
+    BuildReferenceTone(&src);
+    AUDIO_Mixer_Init(&direct, OUT_RATE);
+    AUDIO_Mixer_Play(&direct, &src, AUDIO_GAIN_UNITY, 1U);
+    AUDIO_Mixer_Render(&direct, expected, HALF * HALVES);
+
+    /* ... and once through the ping-pong buffer with a simulated DMA */
+    AUDIO_Mixer_Play(&mixer, &src, AUDIO_GAIN_UNITY, 1U);
+    AUDIO_Ring_Init(&ring, buffer, HALF);
+    while ((block = AUDIO_Ring_Acquire(&ring, &half)) != NULL)
+    {
+        AUDIO_Mixer_Render(&mixer, block, HALF);
+        AUDIO_Ring_Commit(&ring, half, 0U);
+    }
+
+    for (h = 0; h < HALVES; h++)
+    {
+        uint32_t playing = h & 1U;
+
+        /* DMA plays the half: compare with the direct render */
+        for (i = 0; i < 2U * HALF; i++)
+        {
+            TEST_ASSERT_EQUAL_INT16(expected[played + i], buffer[playing * 2U * HALF + i]);
+        }
+        played += 2U * HALF;
+
+        AUDIO_Ring_HalfDone(&ring, playing);
+        block = AUDIO_Ring_Acquire(&ring, &half);
+        TEST_ASSERT_NOT_NULL(block);
+        AUDIO_Mixer_Render(&mixer, block, HALF);
+        AUDIO_Ring_Commit(&ring, half, (playing ^ 1U) * HALF);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(0U, ring.Underruns);
+    free(expected);
+}
+
+/* ============================================================================ */
+/* I2S CLOCK TESTS */
+/* ============================================================================ */
+
+void test_i2s_clock_common_rates(void)
+{
+    /* HSI / PLLM=8 gives the 2 MHz PLL input SystemClock_Config uses */
+    const uint32_t rates[] = {8000U, 16000U, 22050U, 32000U, 44100U, 48000U, 96000U};
+    uint32_t i;
+
+    for (i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        AUDIO_ClockTypeDef clk;
+        uint32_t vco;
+        double fs;
+
+        TEST_ASSERT_EQUAL(AUDIO_OK, AUDIO_I2S_SolveClock(2000000U, rates[i], &clk));
+
+        vco = 2000000U * clk.PLLI2SN;
+        TEST_ASSERT_TRUE(vco >= 100000000U && vco <= 432000000U);
+        TEST_ASSERT_TRUE(clk.PLLI2SR >= 2U && clk.PLLI2SR <= 7U);
+        TEST_ASSERT_TRUE(clk.I2SDIV >= 2U && clk.I2SDIV <= 255U);
+
+        /* Independent evaluation of the I2S clock equation */
+        fs = (double)vco / clk.PLLI2SR / (256.0 * (2U * clk.I2SDIV + clk.I2SODD));
+        TEST_ASSERT_TRUE(fabs(fs - rates[i]) <= rates[i] * 0.001);
+        TEST_ASSERT_INT_WITHIN(1, (long)lround(fs), (long)clk.ActualRate);
+    }
+}
+
+void test_i2s_clock_rejects_impossible(void)
+{
+    AUDIO_ClockTypeDef clk;
+
+    TEST_ASSERT_EQUAL(AUDIO_ERROR, AUDIO_I2S_SolveClock(0U, 48000U, &clk));
+    TEST_ASSERT_EQUAL(AUDIO_ERROR, AUDIO_I2S_SolveClock(2000000U, 0U, &clk));
+    /* MCLK would need more than the PLLI2S can deliver */
+    TEST_ASSERT_EQUAL(AUDIO_ERROR, AUDIO_I2S_SolveClock(2000000U, 400000U, &clk));
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* WAV Parser Tests */
+    RUN_TEST(test_wav_parse_mono_pcm);
+    RUN_TEST(test_wav_parse_skips_unknown_odd_chunk);
+    RUN_TEST(test_wav_parse_rejects_unsupported);
+
+    /* Mixer Tests */
+    RUN_TEST(test_mixer_idle_renders_silence);
+    RUN_TEST(test_mixer_same_rate_is_bit_exact);
+    RUN_TEST(test_mixer_resamples_reference_tone);
+    RUN_TEST(test_mixer_voice_ends_with_clip);
+    RUN_TEST(test_mixer_loop_wraps_around);
+    RUN_TEST(test_mixer_stereo_channels_stay_separate);
+    RUN_TEST(test_mixer_sums_and_saturates);
+    RUN_TEST(test_mixer_rejects_when_full);
+
+    /* Ring Tests */
+    RUN_TEST(test_ring_primes_both_halves);
+    RUN_TEST(test_ring_in_time_refill_has_no_underrun);
+    RUN_TEST(test_ring_counts_missed_refill);
+    RUN_TEST(test_ring_counts_late_commit);
+    RUN_TEST(test_ring_latency_figure);
+    RUN_TEST(test_ring_stream_matches_direct_render);
+
+    /* I2S Clock Tests */
+    RUN_TEST(test_i2s_clock_common_rates);
+    RUN_TEST(test_i2s_clock_rejects_impossible);
+
+    return UNITY_END();
+}
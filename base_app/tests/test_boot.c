@@ -0,0 +1,182 @@
+/**
+  ******************************************************************************
+  * @file    test_boot.c
+  * @author  Test Framework
+  * @brief   Unit tests for the boot phase record
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "boot.h"
+#include <string.h>
+
+#define HSI_HZ         16000000U
+#define PLL_HZ         168000000U
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+static BOOT_RecordTypeDef record;
+
+void setUp(void)
+{
+    // .noinit RAM holds garbage at power-up
+    memset(&record, 0xA5, sizeof(record));
+}
+
+void tearDown(void)
+{
+}
+
+/* Stamps of the startup code: 16 cycles SystemInit, 1600 data, 3200 bss */
+static void StartupStamps(void)
+{
+    record.Cycles[BOOT_PH_SYSTEMINIT] = 16U;
+    record.Cycles[BOOT_PH_DATA]       = 1616U;
+    record.Cycles[BOOT_PH_BSS]        = 4816U;
+}
+
+/* ============================================================================ */
+/* RECORD TESTS */
+/* ============================================================================ */
+
+void test_start_keeps_startup_stamps(void)
+{
+    // Arrange
+    StartupStamps();
+
+    // Act
+    BOOT_Start(&record, 6416U, HSI_HZ);
+
+    // Assert
+    TEST_ASSERT_EQUAL_HEX32(BOOT_MAGIC, record.Magic);
+    TEST_ASSERT_EQUAL_UINT32(BOOT_PH_MAIN + 1U, record.Count);
+    TEST_ASSERT_EQUAL_UINT32(0U, record.Cycles[BOOT_PH_RESET]);
+    TEST_ASSERT_EQUAL_UINT32(1616U, record.Cycles[BOOT_PH_DATA]);
+    TEST_ASSERT_EQUAL_UINT32(HSI_HZ, record.Hz[BOOT_PH_BSS]);
+    TEST_ASSERT_TRUE(BOOT_IsValid(&record));
+}
+
+void test_mark_only_in_order(void)
+{
+    StartupStamps();
+    BOOT_Start(&record, 6416U, HSI_HZ);
+
+    // Skipping a phase is ignored
+    BOOT_Mark(&record, BOOT_PH_EARLY, 9000U, HSI_HZ);
+    TEST_ASSERT_EQUAL_UINT32(BOOT_PH_MAIN + 1U, record.Count);
+
+    BOOT_Mark(&record, BOOT_PH_HAL, 8000U, HSI_HZ);
+    TEST_ASSERT_EQUAL_UINT32(BOOT_PH_HAL + 1U, record.Count);
+    TEST_ASSERT_EQUAL_UINT32(8000U, record.Cycles[BOOT_PH_HAL]);
+
+    // Nor can a phase be stamped twice
+    BOOT_Mark(&record, BOOT_PH_HAL, 9000U, HSI_HZ);
+    TEST_ASSERT_EQUAL_UINT32(8000U, record.Cycles[BOOT_PH_HAL]);
+}
+
+void test_invalid_records(void)
+{
+    TEST_ASSERT_FALSE(BOOT_IsValid(&record));
+
+    StartupStamps();
+    BOOT_Start(&record, 6416U, HSI_HZ);
+    record.Cycles[BOOT_PH_DATA] = 1U;
+    TEST_ASSERT_FALSE(BOOT_IsValid(&record));
+
+    BOOT_Start(&record, 6416U, HSI_HZ);
+    record.Count = BOOT_PHASES + 1U;
+    TEST_ASSERT_FALSE(BOOT_IsValid(&record));
+}
+
+/* ============================================================================ */
+/* DURATION TESTS */
+/* ============================================================================ */
+
+void test_phases_at_reset_clock(void)
+{
+    StartupStamps();
+    BOOT_Start(&record, 6416U, HSI_HZ);
+
+    TEST_ASSERT_EQUAL_UINT32(0U, BOOT_PhaseUs(&record, BOOT_PH_RESET));
+    TEST_ASSERT_EQUAL_UINT32(1U, BOOT_PhaseUs(&record, BOOT_PH_SYSTEMINIT));
+    TEST_ASSERT_EQUAL_UINT32(100U, BOOT_PhaseUs(&record, BOOT_PH_DATA));
+    TEST_ASSERT_EQUAL_UINT32(200U, BOOT_PhaseUs(&record, BOOT_PH_BSS));
+    TEST_ASSERT_EQUAL_UINT32(401U, BOOT_TotalUs(&record, BOOT_PH_MAIN));
+
+    // Not stamped yet
+    TEST_ASSERT_EQUAL_UINT32(0U, BOOT_PhaseUs(&record, BOOT_PH_HAL));
+}
+
+void test_interval_uses_clock_it_started_at(void)
+{
+    StartupStamps();
+    BOOT_Start(&record, 6416U, HSI_HZ);
+    BOOT_Mark(&record, BOOT_PH_HAL, 6416U + 1600U, HSI_HZ);
+    BOOT_Mark(&record, BOOT_PH_EARLY, 8016U + 1600U, HSI_HZ);
+
+    // PLL lock waited at 16 MHz, stamped once at 168 MHz
+    BOOT_Mark(&record, BOOT_PH_CLOCK, 9616U + 1600U, PLL_HZ);
+    TEST_ASSERT_EQUAL_UINT32(100U, BOOT_PhaseUs(&record, BOOT_PH_CLOCK));
+
+    // Everything after runs at 168 MHz
+    BOOT_Mark(&record, BOOT_PH_PERIPH, 11216U + 16800U, PLL_HZ);
+    TEST_ASSERT_EQUAL_UINT32(100U, BOOT_PhaseUs(&record, BOOT_PH_PERIPH));
+    TEST_ASSERT_EQUAL_UINT32(801U, BOOT_TotalUs(&record, BOOT_PH_PERIPH));
+    TEST_ASSERT_EQUAL_UINT32(801U, BOOT_TotalUs(&record, BOOT_PH_READY));
+}
+
+/* ============================================================================ */
+/* FORMAT TESTS */
+/* ============================================================================ */
+
+void test_format_line(void)
+{
+    char line[BOOT_LINE_MAX];
+
+    StartupStamps();
+    BOOT_Start(&record, 6416U, HSI_HZ);
+
+    TEST_ASSERT_EQUAL_UINT32(strlen("boot: data         100 us      101 us"),
+                             BOOT_Format(&record, BOOT_PH_DATA, line, sizeof(line)));
+    TEST_ASSERT_EQUAL_STRING("boot: data         100 us      101 us", line);
+    TEST_ASSERT_EQUAL_STRING("ready", BOOT_PhaseName(BOOT_PH_READY));
+    TEST_ASSERT_EQUAL_STRING("?", BOOT_PhaseName(BOOT_PHASES));
+}
+
+void test_format_truncates(void)
+{
+    char line[10];
+
+    StartupStamps();
+    BOOT_Start(&record, 6416U, HSI_HZ);
+
+    TEST_ASSERT_EQUAL_UINT32(9U, BOOT_Format(&record, BOOT_PH_BSS, line, sizeof(line)));
+    TEST_ASSERT_EQUAL_STRING("boot: bss", line);
+    TEST_ASSERT_EQUAL_UINT32(0U, BOOT_Format(&record, BOOT_PH_BSS, line, 0U));
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Record Tests */
+    RUN_TEST(test_start_keeps_startup_stamps);
+    RUN_TEST(test_mark_only_in_order);
+    RUN_TEST(test_invalid_records);
+
+    /* Duration Tests */
+    RUN_TEST(test_phases_at_reset_clock);
+    RUN_TEST(test_interval_uses_clock_it_started_at);
+
+    /* Format Tests */
+    RUN_TEST(test_format_line);
+    RUN_TEST(test_format_truncates);
+
+    return UNITY_END();
+}
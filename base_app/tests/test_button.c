@@ -0,0 +1,310 @@
+/**
+  ******************************************************************************
+  * @file    test_button.c
+  * @author  Test Framework
+  * @brief   Unit tests for the button debouncer, gestures and event queue
+  ******************************************************************************
+  * Edges are scripted with their times, bounces included. A virtual one-shot
+  * timer stands in for TIM7: it is armed with whatever delay the last
+  * BUTTON_Edge()/BUTTON_Service() returned and calls BUTTON_Service() with
+  * the pin level when it expires, the way button_input.c does.
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "button.h"
+#include <string.h>
+
+#define MAX_EVENTS     32U
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+static BUTTON_QueueTypeDef  queue;
+static BUTTON_HandleTypeDef btn;
+static BUTTON_EventTypeDef  events[MAX_EVENTS];
+static uint32_t event_count;
+static uint32_t pin;
+static uint32_t clock_ms;
+static uint32_t timer_due;
+static uint8_t  timer_armed;
+
+void setUp(void)
+{
+    BUTTON_QueueInit(&queue);
+    BUTTON_Init(&btn, 3U, &queue, 0U);
+    memset(events, 0, sizeof(events));
+    event_count = 0U;
+    pin = 0U;
+    clock_ms = 0U;
+    timer_armed = 0U;
+}
+
+void tearDown(void)
+{
+}
+
+static void Arm(uint32_t delay)
+{
+    timer_armed = (delay != 0U) ? 1U : 0U;
+    timer_due = clock_ms + delay;
+}
+
+/* Let the virtual clock run to t, firing the timer on the way */
+static void RunTo(uint32_t t)
+{
+    while ((timer_armed != 0U) && ((int32_t)(t - timer_due) >= 0))
+    {
+        clock_ms = timer_due;
+        Arm(BUTTON_Service(&btn, pin, clock_ms));
+    }
+    clock_ms = t;
+    while (BUTTON_Get(&queue, &events[event_count]) != 0U)
+    {
+        TEST_ASSERT_TRUE(event_count < MAX_EVENTS - 1U);
+        event_count++;
+    }
+}
+
+/* Raw pin edge at t, as the EXTI interrupt sees it */
+static void EdgeAt(uint32_t t, uint32_t level)
+{
+    RunTo(t);
+    pin = level;
+    Arm(BUTTON_Edge(&btn, clock_ms));
+}
+
+static void AssertEvent(uint32_t index, BUTTON_GestureTypeDef gesture, uint32_t time)
+{
+    TEST_ASSERT_TRUE(index < event_count);
+    TEST_ASSERT_EQUAL_UINT8(3U, events[index].Button);
+    TEST_ASSERT_EQUAL_UINT8(gesture, events[index].Gesture);
+    TEST_ASSERT_EQUAL_UINT32(time, events[index].Time);
+}
+
+/* ============================================================================ */
+/* DEBOUNCE TESTS */
+/* ============================================================================ */
+
+void test_bouncy_click(void)
+{
+    // Arrange: contacts chatter on both edges
+    EdgeAt(100U, 1U);
+    EdgeAt(102U, 0U);
+    EdgeAt(104U, 1U);
+    EdgeAt(250U, 0U);
+    EdgeAt(251U, 1U);
+    EdgeAt(253U, 0U);
+
+    // Act
+    RunTo(2000U);
+
+    // Assert: one press and release, at the first edge of each bounce
+    TEST_ASSERT_EQUAL_UINT32(3U, event_count);
+    AssertEvent(0U, BUTTON_PRESS, 100U);
+    AssertEvent(1U, BUTTON_RELEASE, 250U);
+    AssertEvent(2U, BUTTON_CLICK, 250U + BUTTON_DOUBLE_MS);
+    TEST_ASSERT_FALSE(timer_armed);
+}
+
+void test_glitch_is_ignored(void)
+{
+    EdgeAt(100U, 1U);
+    EdgeAt(105U, 0U);
+    RunTo(2000U);
+
+    TEST_ASSERT_EQUAL_UINT32(0U, event_count);
+    TEST_ASSERT_FALSE(timer_armed);
+}
+
+void test_service_delays(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(BUTTON_DEBOUNCE_MS, BUTTON_Edge(&btn, 100U));
+
+    // Early: wait for the pin to settle; a later edge pushes it out
+    TEST_ASSERT_EQUAL_UINT32(15U, BUTTON_Service(&btn, 1U, 105U));
+    TEST_ASSERT_EQUAL_UINT32(BUTTON_DEBOUNCE_MS, BUTTON_Edge(&btn, 110U));
+    TEST_ASSERT_EQUAL_UINT32(1U, BUTTON_Service(&btn, 1U, 129U));
+
+    // Settled pressed: next is the long press deadline, counted from 100
+    TEST_ASSERT_EQUAL_UINT32(BUTTON_LONG_MS - 30U, BUTTON_Service(&btn, 1U, 130U));
+
+    // Released, double click expired: nothing pending
+    (void)BUTTON_Edge(&btn, 200U);
+    TEST_ASSERT_EQUAL_UINT32(BUTTON_DOUBLE_MS - 20U, BUTTON_Service(&btn, 0U, 220U));
+    TEST_ASSERT_EQUAL_UINT32(0U, BUTTON_Service(&btn, 0U, 200U + BUTTON_DOUBLE_MS));
+}
+
+/* ============================================================================ */
+/* GESTURE TESTS */
+/* ============================================================================ */
+
+void test_long_press(void)
+{
+    EdgeAt(100U, 1U);
+    RunTo(2000U);
+    EdgeAt(2000U, 0U);
+    RunTo(4000U);
+
+    TEST_ASSERT_EQUAL_UINT32(3U, event_count);
+    AssertEvent(0U, BUTTON_PRESS, 100U);
+    AssertEvent(1U, BUTTON_LONG_PRESS, 100U + BUTTON_LONG_MS);
+    AssertEvent(2U, BUTTON_RELEASE, 2000U);
+}
+
+void test_double_click(void)
+{
+    EdgeAt(100U, 1U);
+    EdgeAt(200U, 0U);
+    EdgeAt(350U, 1U);
+    EdgeAt(352U, 0U);
+    EdgeAt(354U, 1U);
+    EdgeAt(450U, 0U);
+    RunTo(4000U);
+
+    TEST_ASSERT_EQUAL_UINT32(5U, event_count);
+    AssertEvent(0U, BUTTON_PRESS, 100U);
+    AssertEvent(1U, BUTTON_RELEASE, 200U);
+    AssertEvent(2U, BUTTON_PRESS, 350U);
+    AssertEvent(3U, BUTTON_RELEASE, 450U);
+    AssertEvent(4U, BUTTON_DOUBLE_CLICK, 450U);
+}
+
+void test_slow_second_press_is_two_clicks(void)
+{
+    EdgeAt(100U, 1U);
+    EdgeAt(200U, 0U);
+    EdgeAt(200U + BUTTON_DOUBLE_MS + 20U, 1U);
+    EdgeAt(600U, 0U);
+    RunTo(4000U);
+
+    TEST_ASSERT_EQUAL_UINT32(6U, event_count);
+    AssertEvent(2U, BUTTON_CLICK, 200U + BUTTON_DOUBLE_MS);
+    AssertEvent(3U, BUTTON_PRESS, 200U + BUTTON_DOUBLE_MS + 20U);
+    AssertEvent(5U, BUTTON_CLICK, 600U + BUTTON_DOUBLE_MS);
+}
+
+void test_press_bouncing_across_double_deadline(void)
+{
+    // Arrange: the second press starts 5 ms before the double click window
+    // closes, but only settles after it
+    uint32_t second = 200U + BUTTON_DOUBLE_MS - 5U;
+
+    EdgeAt(100U, 1U);
+    EdgeAt(200U, 0U);
+    EdgeAt(second, 1U);
+    EdgeAt(second + 4U, 0U);
+    EdgeAt(second + 8U, 1U);
+
+    // Act
+    EdgeAt(600U, 0U);
+    RunTo(4000U);
+
+    // Assert: still a double click
+    TEST_ASSERT_EQUAL_UINT32(5U, event_count);
+    AssertEvent(2U, BUTTON_PRESS, second);
+    AssertEvent(4U, BUTTON_DOUBLE_CLICK, 600U);
+}
+
+void test_second_press_held_long(void)
+{
+    EdgeAt(100U, 1U);
+    EdgeAt(200U, 0U);
+    EdgeAt(350U, 1U);
+    RunTo(3000U);
+    EdgeAt(3000U, 0U);
+    RunTo(4000U);
+
+    // The first press still counts as a click, then the long press
+    TEST_ASSERT_EQUAL_UINT32(6U, event_count);
+    AssertEvent(3U, BUTTON_CLICK, 350U + BUTTON_LONG_MS);
+    AssertEvent(4U, BUTTON_LONG_PRESS, 350U + BUTTON_LONG_MS);
+    AssertEvent(5U, BUTTON_RELEASE, 3000U);
+}
+
+void test_held_at_init_reports_release_only(void)
+{
+    BUTTON_Init(&btn, 3U, &queue, 1U);
+    pin = 1U;
+
+    EdgeAt(500U, 0U);
+    RunTo(4000U);
+
+    TEST_ASSERT_EQUAL_UINT32(1U, event_count);
+    AssertEvent(0U, BUTTON_RELEASE, 500U);
+}
+
+void test_clock_wrap(void)
+{
+    uint32_t start = 0xFFFFFF00UL;
+
+    clock_ms = start;
+    EdgeAt(start, 1U);
+    RunTo(start + 2000U);
+    EdgeAt(start + 2000U, 0U);
+    RunTo(start + 4000U);
+
+    TEST_ASSERT_EQUAL_UINT32(3U, event_count);
+    AssertEvent(1U, BUTTON_LONG_PRESS, start + BUTTON_LONG_MS);
+    AssertEvent(2U, BUTTON_RELEASE, start + 2000U);
+}
+
+/* ============================================================================ */
+/* QUEUE TESTS */
+/* ============================================================================ */
+
+void test_queue_full_drops_newest(void)
+{
+    BUTTON_EventTypeDef event = {0U, BUTTON_PRESS, 0U};
+    uint32_t i;
+
+    // Arrange: indices about to wrap
+    queue.Head = 0xFFFFFFF8UL;
+    queue.Tail = 0xFFFFFFF8UL;
+
+    // Act
+    for (i = 0U; i < BUTTON_QUEUE_DEPTH + 2U; i++)
+    {
+        event.Time = i;
+        TEST_ASSERT_EQUAL_UINT8((i < BUTTON_QUEUE_DEPTH) ? 1U : 0U, BUTTON_Post(&queue, &event));
+    }
+
+    // Assert: the first DEPTH in order, the rest counted as dropped
+    TEST_ASSERT_EQUAL_UINT32(2U, queue.Dropped);
+    for (i = 0U; i < BUTTON_QUEUE_DEPTH; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(1U, BUTTON_Get(&queue, &event));
+        TEST_ASSERT_EQUAL_UINT32(i, event.Time);
+    }
+    TEST_ASSERT_EQUAL_UINT8(0U, BUTTON_Get(&queue, &event));
+    TEST_ASSERT_EQUAL_UINT8(1U, BUTTON_Post(&queue, &event));
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Debounce Tests */
+    RUN_TEST(test_bouncy_click);
+    RUN_TEST(test_glitch_is_ignored);
+    RUN_TEST(test_service_delays);
+
+    /* Gesture Tests */
+    RUN_TEST(test_long_press);
+    RUN_TEST(test_double_click);
+    RUN_TEST(test_slow_second_press_is_two_clicks);
+    RUN_TEST(test_press_bouncing_across_double_deadline);
+    RUN_TEST(test_second_press_held_long);
+    RUN_TEST(test_held_at_init_reports_release_only);
+    RUN_TEST(test_clock_wrap);
+
+    /* Queue Tests */
+    RUN_TEST(test_queue_full_drops_newest);
+
+    return UNITY_END();
+}
@@ -0,0 +1,492 @@
+/**
+  ******************************************************************************
+  * @file    test_can_filter.c
+  * @author  Test Framework
+  * @brief   Unit tests for the bxCAN filter bank planner
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "can_filter.h"
+#include <string.h>
+
+#define MAX_A   6U
+#define MAX_B   3U
+#define MAX_C   3U
+#define MAX_D   2U
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+static CANF_PlanTypeDef plan;
+static CANF_RuleTypeDef rules[CANF_MAX_RULES];
+static uint8_t memo[MAX_A + 1U][MAX_B + 1U][MAX_C + 1U][MAX_D + 1U];
+
+void setUp(void)
+{
+    memset(&plan, 0xA5, sizeof(plan));
+    memset(rules, 0, sizeof(rules));
+}
+
+void tearDown(void)
+{
+}
+
+static CANF_RuleTypeDef Rule(uint32_t id, uint32_t mask, uint8_t fifo, uint8_t queue)
+{
+    CANF_RuleTypeDef rule;
+
+    rule.Id = id;
+    rule.Mask = mask;
+    rule.Fifo = fifo;
+    rule.Queue = queue;
+    return rule;
+}
+
+/* k-th value with an even number of set bits: any two differ in 2+ bits,
+ * so no pair of them can merge */
+static uint32_t Even(uint32_t k)
+{
+    uint32_t v;
+
+    for (v = 0U; ; v++)
+    {
+        uint32_t bits = 0U;
+        uint32_t x;
+
+        for (x = v; x != 0U; x &= x - 1U)
+        {
+            bits++;
+        }
+        if (((bits & 1U) == 0U) && (k-- == 0U))
+        {
+            return v;
+        }
+    }
+}
+
+/* Every identifier a rule set could disagree with the plan on: all the
+ * standard ones, and every one-bit change and low-bit sweep of each
+ * extended rule */
+static void CheckId(uint32_t count, uint32_t id)
+{
+    uint8_t fifo = 0xFFU;
+    uint8_t fmi = 0xFFU;
+    uint8_t expected = 0U;
+    uint8_t queue_ok = 0U;
+    uint8_t got = CANF_Match(&plan, id, &fifo, &fmi);
+    uint32_t i;
+
+    for (i = 0U; i < count; i++)
+    {
+        if (CANF_RuleMatch(&rules[i], id) != 0U)
+        {
+            expected = 1U;
+            if ((got != 0U) && (rules[i].Fifo == fifo) && (fmi < plan.Filters[fifo]) &&
+                (plan.Queue[fifo][fmi] == rules[i].Queue))
+            {
+                queue_ok = 1U;
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT8(expected, got);
+    if (expected != 0U)
+    {
+        TEST_ASSERT_EQUAL_UINT8(1U, queue_ok);
+    }
+}
+
+static void Check(uint32_t count)
+{
+    uint32_t id;
+    uint32_t i;
+    uint32_t bit;
+
+    for (id = 0U; id <= CANQ_STD_MASK; id++)
+    {
+        CheckId(count, id);
+        CheckId(count, id | CANQ_RTR);
+        CheckId(count, CANQ_EXT | (id << 18));
+    }
+    for (i = 0U; i < count; i++)
+    {
+        uint32_t base = rules[i].Id & CANQ_EXT_MASK;
+        uint32_t flags = rules[i].Id & (CANQ_EXT | CANQ_RTR);
+
+        if ((flags & CANQ_EXT) == 0U)
+        {
+            continue;
+        }
+        for (bit = 0U; bit < 29U; bit++)
+        {
+            CheckId(count, flags | (base ^ (1UL << bit)));
+            CheckId(count, (flags ^ CANQ_RTR) | (base ^ (1UL << bit)));
+        }
+        for (id = 0U; id < 0x1000U; id++)
+        {
+            CheckId(count, flags | (base & ~0xFFFU) | id);
+        }
+    }
+}
+
+/* Fewest banks for a LIST16, b MASK16, c LIST32 and d MASK32 rules, by
+ * trying every way to fill every bank */
+static uint8_t Brute(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+    uint8_t best = 0xFFU;
+    uint8_t n;
+    uint32_t i;
+    uint32_t j;
+
+    if ((a + b + c + d) == 0U)
+    {
+        return 0U;
+    }
+    if (memo[a][b][c][d] != 0U)
+    {
+        return memo[a][b][c][d];
+    }
+    for (i = 1U; (i <= 4U) && (i <= a); i++)
+    {
+        n = Brute(a - i, b, c, d);
+        best = (n < best) ? n : best;
+    }
+    for (i = 0U; (i <= 2U) && (i <= a); i++)
+    {
+        for (j = 0U; ((i + j) <= 2U) && (j <= b); j++)
+        {
+            if ((i + j) != 0U)
+            {
+                n = Brute(a - i, b - j, c, d);
+                best = (n < best) ? n : best;
+            }
+        }
+        for (j = 0U; ((i + j) <= 2U) && (j <= c); j++)
+        {
+            if ((i + j) != 0U)
+            {
+                n = Brute(a - i, b, c - j, d);
+                best = (n < best) ? n : best;
+            }
+        }
+    }
+    if (d != 0U)
+    {
+        n = Brute(a, b, c, d - 1U);
+        best = (n < best) ? n : best;
+    }
+    memo[a][b][c][d] = (uint8_t)(best + 1U);
+    return memo[a][b][c][d];
+}
+
+/* ============================================================================ */
+/* VALIDATION TESTS */
+/* ============================================================================ */
+
+void test_no_rules_no_banks(void)
+{
+    TEST_ASSERT_EQUAL(CANF_OK, CANF_Plan(rules, 0U, &plan));
+    TEST_ASSERT_EQUAL_UINT32(0U, plan.Banks);
+    TEST_ASSERT_EQUAL_UINT8(0U, CANF_Match(&plan, 0x000U, NULL, NULL));
+}
+
+void test_invalid_rules(void)
+{
+    rules[0] = Rule(0x800U, CANQ_STD_MASK, 0U, 0U);
+    TEST_ASSERT_EQUAL(CANF_INVALID, CANF_Plan(rules, 1U, &plan));
+    rules[0] = Rule(0x100U, 0xFFFU, 0U, 0U);
+    TEST_ASSERT_EQUAL(CANF_INVALID, CANF_Plan(rules, 1U, &plan));
+    rules[0] = Rule(0x100U, CANQ_STD_MASK, 2U, 0U);
+    TEST_ASSERT_EQUAL(CANF_INVALID, CANF_Plan(rules, 1U, &plan));
+    TEST_ASSERT_EQUAL(CANF_INVALID, CANF_Plan(rules, CANF_MAX_RULES + 1U, &plan));
+}
+
+void test_too_many_banks(void)
+{
+    uint32_t i;
+
+    for (i = 0U; i <= CANF_MAX_BANKS; i++)
+    {
+        rules[i] = Rule(CANQ_EXT | (Even(i) << 4), 0x1FFFFFF0U, 0U, 0U);
+    }
+    TEST_ASSERT_EQUAL(CANF_NO_BANKS, CANF_Plan(rules, CANF_MAX_BANKS + 1U, &plan));
+    TEST_ASSERT_EQUAL(CANF_OK, CANF_Plan(rules, CANF_MAX_BANKS, &plan));
+}
+
+/* ============================================================================ */
+/* REDUCTION TESTS */
+/* ============================================================================ */
+
+void test_covered_rules_dropped(void)
+{
+    rules[0] = Rule(0x123U, CANQ_STD_MASK, 0U, 0U);
+    rules[1] = Rule(0x120U, 0x7F0U, 0U, 0U);
+    rules[2] = Rule(0x120U, 0x7F0U, 0U, 0U);
+
+    TEST_ASSERT_EQUAL(CANF_OK, CANF_Plan(rules, 3U, &plan));
+    TEST_ASSERT_EQUAL_UINT32(1U, plan.RuleCount);
+    TEST_ASSERT_EQUAL_UINT32(1U, plan.Banks);
+    Check(3U);
+}
+
+void test_adjacent_identifiers_merge(void)
+{
+    uint32_t i;
+
+    // Arrange: 0x200-0x20F, 16 exact identifiers
+    for (i = 0U; i < 16U; i++)
+    {
+        rules[i] = Rule(0x200U + i, CANQ_STD_MASK, 0U, 3U);
+    }
+
+    // Act
+    TEST_ASSERT_EQUAL(CANF_OK, CANF_Plan(rules, 16U, &plan));
+
+    // Assert: one 16-bit mask, half a bank
+    TEST_ASSERT_EQUAL_UINT32(1U, plan.RuleCount);
+    TEST_ASSERT_EQUAL_UINT32(0x7F0U, plan.Rules[0].Mask);
+    TEST_ASSERT_EQUAL_UINT32(1U, plan.Banks);
+    Check(16U);
+}
+
+void test_merge_skipped_when_it_costs_a_bank(void)
+{
+    // Four exact identifiers fill one list bank; merging the first two
+    // would leave a mask and two identifiers, which need two banks
+    rules[0] = Rule(0x100U, CANQ_STD_MASK, 0U, 0U);
+    rules[1] = Rule(0x101U, CANQ_STD_MASK, 0U, 0U);
+    rules[2] = Rule(0x202U, CANQ_STD_MASK, 0U, 0U);
+    rules[3] = Rule(0x404U, CANQ_STD_MASK, 0U, 0U);
+
+    TEST_ASSERT_EQUAL(CANF_OK, CANF_Plan(rules, 4U, &plan));
+    TEST_ASSERT_EQUAL_UINT32(4U, plan.RuleCount);
+    TEST_ASSERT_EQUAL_UINT32(1U, plan.Banks);
+    Check(4U);
+}
+
+void test_queues_are_not_merged(void)
+{
+    rules[0] = Rule(0x100U, CANQ_STD_MASK, 0U, 0U);
+    rules[1] = Rule(0x101U, CANQ_STD_MASK, 0U, 1U);
+    rules[2] = Rule(0x100U, 0x7F0U, 0U, 2U);
+
+    TEST_ASSERT_EQUAL(CANF_OK, CANF_Plan(rules, 3U, &plan));
+    TEST_ASSERT_EQUAL_UINT32(3U, plan.RuleCount);
+    Check(3U);
+}
+
+/* ============================================================================ */
+/* LAYOUT TESTS */
+/* ============================================================================ */
+
+void test_list16_registers_and_numbering(void)
+{
+    uint8_t fifo;
+    uint8_t fmi;
+
+    rules[0] = Rule(0x011U, CANQ_STD_MASK, 1U, 4U);
+    rules[1] = Rule(0x022U | CANQ_RTR, CANQ_STD_MASK, 1U, 5U);
+
+    TEST_ASSERT_EQUAL(CANF_OK, CANF_Plan(rules, 2U, &plan));
+
+    // One 16-bit list bank on FIFO 1, the last entry repeated
+    TEST_ASSERT_EQUAL_UINT32(1U, plan.Banks);
+    TEST_ASSERT_EQUAL_UINT32(1U, plan.Mode);
+    TEST_ASSERT_EQUAL_UINT32(0U, plan.Scale);
+    TEST_ASSERT_EQUAL_UINT32(1U, plan.Fifo);
+    TEST_ASSERT_EQUAL_HEX32((0x0450U << 16) | 0x0220U, plan.Fr1[0]);
+    TEST_ASSERT_EQUAL_HEX32((0x0450U << 16) | 0x0450U, plan.Fr2[0]);
+    TEST_ASSERT_EQUAL_UINT8(0U, plan.Filters[0]);
+    TEST_ASSERT_EQUAL_UINT8(4U, plan.Filters[1]);
+
+    TEST_ASSERT_EQUAL_UINT8(1U, CANF_Match(&plan, 0x022U | CANQ_RTR, &fifo, &fmi));
+    TEST_ASSERT_EQUAL_UINT8(1U, fifo);
+    TEST_ASSERT_EQUAL_UINT8(1U, fmi);
+    TEST_ASSERT_EQUAL_UINT8(5U, plan.Queue[1][fmi]);
+    TEST_ASSERT_EQUAL_UINT8(0U, CANF_Match(&plan, 0x022U, NULL, NULL));
+}
+
+void test_mask32_registers(void)
+{
+    rules[0] = Rule(CANQ_EXT | 0x18DAF100U, 0x1FFFFF00U, 0U, 0U);
+
+    TEST_ASSERT_EQUAL(CANF_OK, CANF_Plan(rules, 1U, &plan));
+    TEST_ASSERT_EQUAL_UINT32(1U, plan.Scale);
+    TEST_ASSERT_EQUAL_UINT32(0U, plan.Mode);
+    TEST_ASSERT_EQUAL_HEX32((0x18DAF100U << 3) | 0x4U, plan.Fr1[0]);
+    TEST_ASSERT_EQUAL_HEX32((0x1FFFFF00U << 3) | 0x6U, plan.Fr2[0]);
+    Check(1U);
+}
+
+void test_fifos_get_separate_banks(void)
+{
+    uint8_t fifo;
+    uint8_t fmi;
+
+    rules[0] = Rule(0x100U, CANQ_STD_MASK, 0U, 0U);
+    rules[1] = Rule(0x200U, CANQ_STD_MASK, 1U, 1U);
+    rules[2] = Rule(CANQ_EXT | 0x12345U, CANQ_EXT_MASK, 1U, 2U);
+
+    TEST_ASSERT_EQUAL(CANF_OK, CANF_Plan(rules, 3U, &plan));
+
+    // FIFO 1 pairs its extended identifier with 0x200 in a 32-bit list
+    TEST_ASSERT_EQUAL_UINT32(2U, plan.Banks);
+    TEST_ASSERT_EQUAL_UINT32(0x2U, plan.Fifo);
+    TEST_ASSERT_EQUAL_UINT8(1U, CANF_Match(&plan, 0x200U, &fifo, &fmi));
+    TEST_ASSERT_EQUAL_UINT8(1U, fifo);
+    TEST_ASSERT_EQUAL_UINT8(1U, plan.Queue[fifo][fmi]);
+    Check(3U);
+}
+
+void test_extended_rule_in_16bit_mask(void)
+{
+    // Only STID and EXID[17:15] matter: a 16-bit mask holds it
+    rules[0] = Rule(CANQ_EXT | (0x555UL << 18) | (0x5UL << 15), 0x1FFF8000U, 0U, 0U);
+    rules[1] = Rule(0x3F0U, 0x7F0U, 0U, 1U);
+
+    TEST_ASSERT_EQUAL(CANF_OK, CANF_Plan(rules, 2U, &plan));
+    TEST_ASSERT_EQUAL_UINT32(1U, plan.Banks);
+    TEST_ASSERT_EQUAL_UINT32(0U, plan.Scale);
+    Check(2U);
+}
+
+void test_overlapping_rules_follow_filter_priority(void)
+{
+    uint8_t fifo;
+    uint8_t fmi;
+
+    // Both share a 16-bit mask bank: the lower filter number wins
+    rules[0] = Rule(0x100U, 0x700U, 0U, 0U);
+    rules[1] = Rule(0x123U, CANQ_STD_MASK, 0U, 1U);
+
+    TEST_ASSERT_EQUAL(CANF_OK, CANF_Plan(rules, 2U, &plan));
+    TEST_ASSERT_EQUAL_UINT32(1U, plan.Banks);
+    TEST_ASSERT_EQUAL_UINT8(1U, CANF_Match(&plan, 0x123U, &fifo, &fmi));
+    TEST_ASSERT_EQUAL_UINT8(0U, fmi);
+    TEST_ASSERT_EQUAL_UINT8(0U, plan.Queue[fifo][fmi]);
+    TEST_ASSERT_EQUAL_UINT8(1U, CANF_Match(&plan, 0x124U, &fifo, &fmi));
+    TEST_ASSERT_EQUAL_UINT8(0U, plan.Queue[fifo][fmi]);
+    Check(2U);
+}
+
+/* ============================================================================ */
+/* EXHAUSTIVE TESTS */
+/* ============================================================================ */
+
+void test_bank_count_is_minimal(void)
+{
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    uint32_t d;
+    uint32_t i;
+    uint32_t n;
+
+    memset(memo, 0, sizeof(memo));
+    for (a = 0U; a <= MAX_A; a++)
+    {
+        for (b = 0U; b <= MAX_B; b++)
+        {
+            for (c = 0U; c <= MAX_C; c++)
+            {
+                for (d = 0U; d <= MAX_D; d++)
+                {
+                    // Arrange: rules of each kind that cannot be reduced
+                    n = 0U;
+                    for (i = 0U; i < a; i++)
+                    {
+                        rules[n++] = Rule(Even(i), CANQ_STD_MASK, 0U, 0U);
+                    }
+                    for (i = 0U; i < b; i++)
+                    {
+                        rules[n++] = Rule(Even(i) << 4, 0x7F0U, 0U, 1U);
+                    }
+                    for (i = 0U; i < c; i++)
+                    {
+                        rules[n++] = Rule(CANQ_EXT | Even(i), CANQ_EXT_MASK, 0U, 2U);
+                    }
+                    for (i = 0U; i < d; i++)
+                    {
+                        rules[n++] = Rule(CANQ_EXT | (Even(i) << 4), 0x1FFFFFF0U, 0U, 3U);
+                    }
+
+                    // Act
+                    TEST_ASSERT_EQUAL(CANF_OK, CANF_Plan(rules, n, &plan));
+
+                    // Assert
+                    TEST_ASSERT_EQUAL_UINT32(n, plan.RuleCount);
+                    TEST_ASSERT_EQUAL_UINT32(Brute(a, b, c, d), plan.Banks);
+                    Check(n);
+                }
+            }
+        }
+    }
+}
+
+void test_random_rule_sets_match_exactly(void)
+{
+    uint32_t seed = 12345U;
+    uint32_t set;
+    uint32_t i;
+    uint32_t n;
+
+    for (set = 0U; set < 40U; set++)
+    {
+        n = 1U + (set % 12U);
+        for (i = 0U; i < n; i++)
+        {
+            seed = seed * 1103515245U + 12345U;
+            if (((seed >> 8) & 3U) == 0U)
+            {
+                rules[i] = Rule(CANQ_EXT | ((seed >> 3) & 0x1FFFF000U), 0x1FFFF000U, 0U, 0U);
+                rules[i].Mask = (((seed >> 9) & 1U) != 0U) ? 0x1FFF8000U : 0x1FFFF000U;
+                rules[i].Id &= CANQ_EXT | rules[i].Mask;
+            }
+            else
+            {
+                rules[i] = Rule((seed >> 16) & 0x7FFU, CANQ_STD_MASK << ((seed >> 10) & 3U), 0U, 0U);
+                rules[i].Mask &= CANQ_STD_MASK;
+                rules[i].Id &= rules[i].Mask;
+            }
+            rules[i].Id |= (((seed >> 12) & 7U) == 0U) ? CANQ_RTR : 0U;
+            rules[i].Fifo = (uint8_t)((seed >> 13) & 1U);
+            rules[i].Queue = (uint8_t)((seed >> 14) & 3U);
+        }
+        TEST_ASSERT_EQUAL(CANF_OK, CANF_Plan(rules, n, &plan));
+        Check(n);
+    }
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Validation Tests */
+    RUN_TEST(test_no_rules_no_banks);
+    RUN_TEST(test_invalid_rules);
+    RUN_TEST(test_too_many_banks);
+
+    /* Reduction Tests */
+    RUN_TEST(test_covered_rules_dropped);
+    RUN_TEST(test_adjacent_identifiers_merge);
+    RUN_TEST(test_merge_skipped_when_it_costs_a_bank);
+    RUN_TEST(test_queues_are_not_merged);
+
+    /* Layout Tests */
+    RUN_TEST(test_list16_registers_and_numbering);
+    RUN_TEST(test_mask32_registers);
+    RUN_TEST(test_fifos_get_separate_banks);
+    RUN_TEST(test_extended_rule_in_16bit_mask);
+    RUN_TEST(test_overlapping_rules_follow_filter_priority);
+
+    /* Exhaustive Tests */
+    RUN_TEST(test_bank_count_is_minimal);
+    RUN_TEST(test_random_rule_sets_match_exactly);
+
+    return UNITY_END();
+}
@@ -0,0 +1,225 @@
+/**
+  ******************************************************************************
+  * @file    test_can_queue.c
+  * @author  Test Framework
+  * @brief   Unit tests for the CAN receive rings and transmit priority queue
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "can_queue.h"
+#include <string.h>
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+static CANQ_RxQueueTypeDef rx;
+static CANQ_TxQueueTypeDef tx;
+
+void setUp(void)
+{
+    memset(&rx, 0xA5, sizeof(rx));
+    memset(&tx, 0xA5, sizeof(tx));
+    CANQ_RxInit(&rx);
+    CANQ_TxInit(&tx);
+}
+
+void tearDown(void)
+{
+}
+
+static CANQ_FrameTypeDef Frame(uint32_t id, uint8_t tag)
+{
+    CANQ_FrameTypeDef frame;
+
+    memset(&frame, 0, sizeof(frame));
+    frame.Id = id;
+    frame.Dlc = 1U;
+    frame.Data[0] = tag;
+    return frame;
+}
+
+/* ============================================================================ */
+/* KEY TESTS */
+/* ============================================================================ */
+
+void test_key_is_the_tir_layout(void)
+{
+    TEST_ASSERT_EQUAL_HEX32(0x24600000U, CANQ_Key(0x123U));
+    TEST_ASSERT_EQUAL_HEX32(0x24600002U, CANQ_Key(0x123U | CANQ_RTR));
+    TEST_ASSERT_EQUAL_HEX32((0x18DAF110U << 3) | 0x4U, CANQ_Key(CANQ_EXT | 0x18DAF110U));
+}
+
+void test_key_follows_arbitration(void)
+{
+    // Standard data, then its remote frame, then extended with the same base
+    TEST_ASSERT_TRUE(CANQ_Key(0x123U) < CANQ_Key(0x123U | CANQ_RTR));
+    TEST_ASSERT_TRUE(CANQ_Key(0x123U | CANQ_RTR) < CANQ_Key(CANQ_EXT | (0x123UL << 18)));
+    TEST_ASSERT_TRUE(CANQ_Key(CANQ_EXT | (0x122UL << 18) | 0x3FFFFU) < CANQ_Key(0x123U));
+}
+
+/* ============================================================================ */
+/* RECEIVE RING TESTS */
+/* ============================================================================ */
+
+void test_rx_empty(void)
+{
+    CANQ_FrameTypeDef frame;
+
+    TEST_ASSERT_EQUAL_UINT8(0U, CANQ_Get(&rx, &frame));
+}
+
+void test_rx_order_and_overflow(void)
+{
+    CANQ_FrameTypeDef frame;
+    uint32_t i;
+
+    for (i = 0U; i < CANQ_RX_DEPTH; i++)
+    {
+        frame = Frame(0x100U, (uint8_t)i);
+        TEST_ASSERT_EQUAL_UINT8(1U, CANQ_Post(&rx, &frame));
+    }
+    frame = Frame(0x100U, 0xFFU);
+    TEST_ASSERT_EQUAL_UINT8(0U, CANQ_Post(&rx, &frame));
+    TEST_ASSERT_EQUAL_UINT32(1U, rx.Dropped);
+
+    for (i = 0U; i < CANQ_RX_DEPTH; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(1U, CANQ_Get(&rx, &frame));
+        TEST_ASSERT_EQUAL_UINT8(i, frame.Data[0]);
+    }
+    TEST_ASSERT_EQUAL_UINT8(0U, CANQ_Get(&rx, &frame));
+}
+
+void test_rx_index_wrap(void)
+{
+    CANQ_FrameTypeDef frame;
+    uint32_t i;
+
+    rx.Head = 0xFFFFFFFEU;
+    rx.Tail = 0xFFFFFFFEU;
+    for (i = 0U; i < 4U; i++)
+    {
+        frame = Frame(0x7FFU, (uint8_t)(10U + i));
+        TEST_ASSERT_EQUAL_UINT8(1U, CANQ_Post(&rx, &frame));
+    }
+    for (i = 0U; i < 4U; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(1U, CANQ_Get(&rx, &frame));
+        TEST_ASSERT_EQUAL_UINT8(10U + i, frame.Data[0]);
+    }
+}
+
+/* ============================================================================ */
+/* TRANSMIT QUEUE TESTS */
+/* ============================================================================ */
+
+void test_tx_empty(void)
+{
+    TEST_ASSERT_TRUE(CANQ_Peek(&tx) == NULL);
+    CANQ_Pop(&tx);
+    TEST_ASSERT_EQUAL_UINT32(0U, tx.Count);
+}
+
+void test_tx_pops_in_arbitration_order(void)
+{
+    CANQ_FrameTypeDef frame;
+    uint32_t seed = 1U;
+    uint32_t last = 0U;
+    uint32_t i;
+
+    // Arrange: a random mix of standard, extended and remote frames
+    for (i = 0U; i < CANQ_TX_DEPTH; i++)
+    {
+        seed = seed * 1103515245U + 12345U;
+        frame = Frame(((seed & 0x100U) != 0U) ? (CANQ_EXT | (seed >> 3)) : ((seed >> 16) & 0x7FFU), 0U);
+        frame.Id |= ((seed & 0x200U) != 0U) ? CANQ_RTR : 0U;
+        TEST_ASSERT_EQUAL_UINT8(1U, CANQ_Push(&tx, &frame));
+    }
+    frame = Frame(0x000U, 0U);
+    TEST_ASSERT_EQUAL_UINT8(0U, CANQ_Push(&tx, &frame));
+
+    // Act / Assert
+    for (i = 0U; i < CANQ_TX_DEPTH; i++)
+    {
+        TEST_ASSERT_TRUE(CANQ_Peek(&tx) != NULL);
+        TEST_ASSERT_TRUE(CANQ_Peek(&tx)->Key >= last);
+        TEST_ASSERT_EQUAL_HEX32(CANQ_Key(CANQ_Peek(&tx)->Frame.Id), CANQ_Peek(&tx)->Key);
+        last = CANQ_Peek(&tx)->Key;
+        CANQ_Pop(&tx);
+    }
+    TEST_ASSERT_TRUE(CANQ_Peek(&tx) == NULL);
+}
+
+void test_tx_same_identifier_keeps_order(void)
+{
+    CANQ_FrameTypeDef frame;
+    uint32_t i;
+
+    // Interleave two identifiers, pushing and popping as a sender would
+    for (i = 0U; i < 8U; i++)
+    {
+        frame = Frame(0x300U, (uint8_t)i);
+        TEST_ASSERT_EQUAL_UINT8(1U, CANQ_Push(&tx, &frame));
+        frame = Frame(0x200U, (uint8_t)i);
+        TEST_ASSERT_EQUAL_UINT8(1U, CANQ_Push(&tx, &frame));
+    }
+    for (i = 0U; i < 8U; i++)
+    {
+        TEST_ASSERT_EQUAL_HEX32(0x200U, CANQ_Peek(&tx)->Frame.Id);
+        TEST_ASSERT_EQUAL_UINT8(i, CANQ_Peek(&tx)->Frame.Data[0]);
+        CANQ_Pop(&tx);
+    }
+    for (i = 0U; i < 8U; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(i, CANQ_Peek(&tx)->Frame.Data[0]);
+        CANQ_Pop(&tx);
+        frame = Frame(0x300U, (uint8_t)(8U + i));
+        TEST_ASSERT_EQUAL_UINT8(1U, CANQ_Push(&tx, &frame));
+    }
+    for (i = 0U; i < 8U; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(8U + i, CANQ_Peek(&tx)->Frame.Data[0]);
+        CANQ_Pop(&tx);
+    }
+}
+
+void test_tx_sequence_wrap(void)
+{
+    CANQ_FrameTypeDef frame;
+
+    tx.Seq = 0xFFFFFFFFU;
+    frame = Frame(0x100U, 1U);
+    CANQ_Push(&tx, &frame);
+    frame = Frame(0x100U, 2U);
+    CANQ_Push(&tx, &frame);
+
+    TEST_ASSERT_EQUAL_UINT8(1U, CANQ_Peek(&tx)->Frame.Data[0]);
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Key Tests */
+    RUN_TEST(test_key_is_the_tir_layout);
+    RUN_TEST(test_key_follows_arbitration);
+
+    /* Receive Ring Tests */
+    RUN_TEST(test_rx_empty);
+    RUN_TEST(test_rx_order_and_overflow);
+    RUN_TEST(test_rx_index_wrap);
+
+    /* Transmit Queue Tests */
+    RUN_TEST(test_tx_empty);
+    RUN_TEST(test_tx_pops_in_arbitration_order);
+    RUN_TEST(test_tx_same_identifier_keeps_order);
+    RUN_TEST(test_tx_sequence_wrap);
+
+    return UNITY_END();
+}
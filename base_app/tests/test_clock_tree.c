@@ -0,0 +1,228 @@
+/**
+  ******************************************************************************
+  * @file    test_clock_tree.c
+  * @author  Test Framework
+  * @brief   Unit tests for the compile-time clock tree solver
+  ******************************************************************************
+  * The solver macros are ordinary expressions, so here they run on runtime
+  * values and are compared against a brute-force search of every PLL
+  * setting for the same VCO input.
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "clock_tree.h"
+
+#define MHZ(x)         ((unsigned long)(x) * 1000000UL)
+
+/* ============================================================================ */
+/* HELPERS */
+/* ============================================================================ */
+
+/* Smallest P of any exact, in-range setting with the solver's VCO input */
+static unsigned long BruteForceP(unsigned long src, unsigned long sys, unsigned long usb)
+{
+    unsigned long vin = CLOCK_VCO_IN(src);
+    unsigned long p, n, q, vco;
+
+    if (vin == 0UL)
+    {
+        return 0UL;
+    }
+    for (p = 2UL; p <= 8UL; p += 2UL)
+    {
+        for (n = CLOCK_PLLN_MIN; n <= CLOCK_PLLN_MAX; n++)
+        {
+            vco = vin * n;
+            if ((vco < CLOCK_VCO_OUT_MIN) || (vco > CLOCK_VCO_OUT_MAX) ||
+                (vco / p != sys) || (vco % p != 0UL) || (sys > CLOCK_SYSCLK_MAX))
+            {
+                continue;
+            }
+            for (q = CLOCK_PLLQ_MIN; q <= CLOCK_PLLQ_MAX; q++)
+            {
+                if ((usb != 0UL) ? ((vco % q == 0UL) && (vco / q == usb)) : (vco <= q * CLOCK_USB_HZ))
+                {
+                    return p;
+                }
+            }
+        }
+    }
+    return 0UL;
+}
+
+static void AssertSolution(unsigned long src, unsigned long sys, unsigned long usb)
+{
+    unsigned long m = CLOCK_PLLM(src);
+    unsigned long n = CLOCK_PLLN(src, sys, usb);
+    unsigned long p = CLOCK_PLLP(src, sys, usb);
+    unsigned long q = CLOCK_PLLQ(src, sys, usb);
+    unsigned long vin = src / m;
+
+    TEST_ASSERT_EQUAL_UINT32(src, vin * m);
+    TEST_ASSERT_TRUE((vin >= CLOCK_VCO_IN_MIN) && (vin <= CLOCK_VCO_IN_MAX));
+    TEST_ASSERT_TRUE((m >= 2UL) && (m <= 63UL));
+    TEST_ASSERT_TRUE((n >= CLOCK_PLLN_MIN) && (n <= CLOCK_PLLN_MAX));
+    TEST_ASSERT_TRUE((q >= CLOCK_PLLQ_MIN) && (q <= CLOCK_PLLQ_MAX));
+    TEST_ASSERT_TRUE((vin * n >= CLOCK_VCO_OUT_MIN) && (vin * n <= CLOCK_VCO_OUT_MAX));
+    TEST_ASSERT_EQUAL_UINT32(sys, vin * n / p);
+    TEST_ASSERT_EQUAL_UINT32(0U, (vin * n) % p);
+    if (usb != 0UL)
+    {
+        TEST_ASSERT_EQUAL_UINT32(usb, vin * n / q);
+        TEST_ASSERT_EQUAL_UINT32(0U, (vin * n) % q);
+    }
+    else
+    {
+        TEST_ASSERT_TRUE(vin * n / q <= CLOCK_USB_HZ);
+    }
+}
+
+/* ============================================================================ */
+/* TEST SETUP AND TEARDOWN */
+/* ============================================================================ */
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/* ============================================================================ */
+/* PLL TESTS */
+/* ============================================================================ */
+
+void test_hsi_168mhz_with_usb(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(8U, CLOCK_PLLM(MHZ(16)));
+    TEST_ASSERT_EQUAL_UINT32(168U, CLOCK_PLLN(MHZ(16), MHZ(168), CLOCK_USB_HZ));
+    TEST_ASSERT_EQUAL_UINT32(2U, CLOCK_PLLP(MHZ(16), MHZ(168), CLOCK_USB_HZ));
+    TEST_ASSERT_EQUAL_UINT32(7U, CLOCK_PLLQ(MHZ(16), MHZ(168), CLOCK_USB_HZ));
+}
+
+void test_hse_8mhz_168mhz_with_usb(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(4U, CLOCK_PLLM(MHZ(8)));
+    TEST_ASSERT_EQUAL_UINT32(168U, CLOCK_PLLN(MHZ(8), MHZ(168), CLOCK_USB_HZ));
+    TEST_ASSERT_EQUAL_UINT32(2U, CLOCK_PLLP(MHZ(8), MHZ(168), CLOCK_USB_HZ));
+    TEST_ASSERT_EQUAL_UINT32(7U, CLOCK_PLLQ(MHZ(8), MHZ(168), CLOCK_USB_HZ));
+}
+
+void test_odd_source_uses_1mhz_vco_input(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(MHZ(1), CLOCK_VCO_IN(MHZ(25)));
+    TEST_ASSERT_EQUAL_UINT32(25U, CLOCK_PLLM(MHZ(25)));
+    TEST_ASSERT_EQUAL_UINT32(336U, CLOCK_PLLN(MHZ(25), MHZ(168), CLOCK_USB_HZ));
+    AssertSolution(MHZ(25), MHZ(168), CLOCK_USB_HZ);
+}
+
+void test_usb_dont_care_caps_48mhz_domain(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(2U, CLOCK_PLLP(MHZ(16), MHZ(100), 0UL));
+    TEST_ASSERT_EQUAL_UINT32(5U, CLOCK_PLLQ(MHZ(16), MHZ(100), 0UL));
+    TEST_ASSERT_EQUAL_UINT32(0U, CLOCK_PLLP(MHZ(16), MHZ(100), CLOCK_USB_HZ));
+}
+
+void test_unsolvable_targets_return_zero(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(0U, CLOCK_PLLP(MHZ(16), MHZ(169), 0UL));
+    TEST_ASSERT_EQUAL_UINT32(0U, CLOCK_PLLP(MHZ(16), 0UL, 0UL));
+    TEST_ASSERT_EQUAL_UINT32(0U, CLOCK_PLLP(MHZ(16), MHZ(10), 0UL));
+    TEST_ASSERT_EQUAL_UINT32(0U, CLOCK_VCO_IN(15500000UL));
+    TEST_ASSERT_EQUAL_UINT32(0U, CLOCK_PLLM(15500000UL));
+    TEST_ASSERT_EQUAL_UINT32(0U, CLOCK_PLLN(15500000UL, MHZ(168), 0UL));
+    TEST_ASSERT_EQUAL_UINT32(0U, CLOCK_PLLQ(15500000UL, MHZ(168), 0UL));
+}
+
+void test_exhaustive_sweep_matches_brute_force(void)
+{
+    static const unsigned long sources[] = { MHZ(4), MHZ(8), MHZ(12), MHZ(16), MHZ(25), MHZ(26) };
+    static const unsigned long usbs[] = { CLOCK_USB_HZ, 0UL };
+    unsigned long solved = 0UL;
+    unsigned long s, u, sys;
+
+    for (s = 0UL; s < sizeof(sources) / sizeof(sources[0]); s++)
+    {
+        for (u = 0UL; u < sizeof(usbs) / sizeof(usbs[0]); u++)
+        {
+            for (sys = 250000UL; sys <= CLOCK_SYSCLK_MAX + MHZ(1); sys += 250000UL)
+            {
+                unsigned long expected = BruteForceP(sources[s], sys, usbs[u]);
+
+                TEST_ASSERT_EQUAL_UINT32(expected, CLOCK_PLLP(sources[s], sys, usbs[u]));
+                if (expected != 0UL)
+                {
+                    AssertSolution(sources[s], sys, usbs[u]);
+                    solved++;
+                }
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(solved > 1000UL);
+}
+
+/* ============================================================================ */
+/* BUS AND PERIPHERAL TESTS */
+/* ============================================================================ */
+
+void test_flash_latency_steps_every_30mhz(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(0U, CLOCK_FLASH_LATENCY(MHZ(16)));
+    TEST_ASSERT_EQUAL_UINT32(0U, CLOCK_FLASH_LATENCY(MHZ(30)));
+    TEST_ASSERT_EQUAL_UINT32(1U, CLOCK_FLASH_LATENCY(MHZ(30) + 1UL));
+    TEST_ASSERT_EQUAL_UINT32(4U, CLOCK_FLASH_LATENCY(MHZ(150)));
+    TEST_ASSERT_EQUAL_UINT32(5U, CLOCK_FLASH_LATENCY(MHZ(168)));
+}
+
+void test_apb_divider_is_smallest_in_range(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(4U, CLOCK_APB_DIV(MHZ(168), CLOCK_PCLK1_MAX));
+    TEST_ASSERT_EQUAL_UINT32(2U, CLOCK_APB_DIV(MHZ(168), CLOCK_PCLK2_MAX));
+    TEST_ASSERT_EQUAL_UINT32(1U, CLOCK_APB_DIV(MHZ(42), CLOCK_PCLK1_MAX));
+    TEST_ASSERT_EQUAL_UINT32(2U, CLOCK_APB_DIV(MHZ(84), CLOCK_PCLK1_MAX));
+    TEST_ASSERT_EQUAL_UINT32(0U, CLOCK_APB_DIV(MHZ(1000), CLOCK_PCLK1_MAX));
+}
+
+void test_timer_clock_and_prescaler(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(MHZ(84), CLOCK_TIM_CLK(MHZ(168), 4UL));
+    TEST_ASSERT_EQUAL_UINT32(MHZ(168), CLOCK_TIM_CLK(MHZ(168), 2UL));
+    TEST_ASSERT_EQUAL_UINT32(MHZ(42), CLOCK_TIM_CLK(MHZ(42), 1UL));
+    TEST_ASSERT_EQUAL_UINT32(83U, CLOCK_TIM_PSC(MHZ(84), MHZ(1)));
+    TEST_ASSERT_TRUE(CLOCK_TIM_EXACT(MHZ(84), 48000UL));
+    TEST_ASSERT_FALSE(CLOCK_TIM_EXACT(MHZ(84), 44100UL));
+}
+
+void test_uart_brr_and_error(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(365U, CLOCK_UART_BRR(MHZ(42), 115200UL));
+    TEST_ASSERT_EQUAL_UINT32(1145U, (uint32_t)CLOCK_UART_ERROR_PPM(MHZ(42), 115200UL));
+    TEST_ASSERT_EQUAL_UINT32(0U, (uint32_t)CLOCK_UART_ERROR_PPM(MHZ(48), 1000000UL));
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* PLL Tests */
+    RUN_TEST(test_hsi_168mhz_with_usb);
+    RUN_TEST(test_hse_8mhz_168mhz_with_usb);
+    RUN_TEST(test_odd_source_uses_1mhz_vco_input);
+    RUN_TEST(test_usb_dont_care_caps_48mhz_domain);
+    RUN_TEST(test_unsolvable_targets_return_zero);
+    RUN_TEST(test_exhaustive_sweep_matches_brute_force);
+
+    /* Bus and Peripheral Tests */
+    RUN_TEST(test_flash_latency_steps_every_30mhz);
+    RUN_TEST(test_apb_divider_is_smallest_in_range);
+    RUN_TEST(test_timer_clock_and_prescaler);
+    RUN_TEST(test_uart_brr_and_error);
+
+    return UNITY_END();
+}
@@ -0,0 +1,403 @@
+/**
+  ******************************************************************************
+  * @file    test_crash.c
+  * @author  Test Framework
+  * @brief   Unit tests for the fault capture record and crash report
+  ******************************************************************************
+  * Stacked frames are built in plain arrays the way the core pushes them;
+  * the "address" passed alongside is what SP held on handler entry.
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "crash.h"
+#include <stdio.h>
+#include <string.h>
+
+#define FRAME_SP          0x2001FF00U
+#define EXC_RETURN_MSP    0xFFFFFFF9U   /* Thread mode, MSP, basic frame    */
+#define EXC_RETURN_PSP    0xFFFFFFFDU   /* Thread mode, PSP, basic frame    */
+#define EXC_RETURN_PSP_FP 0xFFFFFFEDU   /* Thread mode, PSP, extended frame */
+
+static CRASH_RecordTypeDef    record;
+static CRASH_FaultRegsTypeDef regs;
+static uint32_t               frame[8];
+static TRACE_EventTypeDef     events[CRASH_TRACE_RECORDS];
+static uint32_t               event_count;
+
+/* ============================================================================ */
+/* HELPERS */
+/* ============================================================================ */
+
+static void Capture(void *context, const TRACE_EventTypeDef *event)
+{
+    (void)context;
+    if (event_count < CRASH_TRACE_RECORDS)
+    {
+        events[event_count] = *event;
+    }
+    event_count++;
+}
+
+static void SetFrame(uint32_t pc, uint32_t lr, uint32_t xpsr)
+{
+    uint32_t i;
+    for (i = 0; i < 5; i++)
+    {
+        frame[i] = 0x100 + i;   /* r0..r3, r12 */
+    }
+    frame[5] = lr;
+    frame[6] = pc;
+    frame[7] = xpsr;
+}
+
+static void CaptureBusFault(void)
+{
+    CRASH_Capture(&record, CRASH_EXC_BUSFAULT, EXC_RETURN_MSP, FRAME_SP, frame, &regs);
+    CRASH_Seal(&record);
+}
+
+/* ============================================================================ */
+/* TEST SETUP AND TEARDOWN */
+/* ============================================================================ */
+
+void setUp(void)
+{
+    memset(&record, 0xA5, sizeof(record));   /* power-on garbage */
+    memset(events, 0, sizeof(events));
+    event_count = 0;
+    regs.Cfsr = 0x00008200U;                  /* PRECISERR BFARVALID */
+    regs.Hfsr = 0;
+    regs.Mmfar = 0xE000EDF4U;
+    regs.Bfar = 0x40021000U;
+    SetFrame(0x08000F3AU, 0x08000E11U, 0x21000000U);
+}
+
+void tearDown(void)
+{
+}
+
+/* ============================================================================ */
+/* CAPTURE TESTS */
+/* ============================================================================ */
+
+void test_capture_copies_frame_and_registers(void)
+{
+    // Act
+    CaptureBusFault();
+
+    // Assert
+    TEST_ASSERT_EQUAL_HEX32(CRASH_MAGIC, record.Magic);
+    TEST_ASSERT_EQUAL_UINT32(CRASH_EXC_BUSFAULT, record.Exception);
+    TEST_ASSERT_EQUAL_HEX32(CRASH_FLAG_FRAME, record.Flags);
+    TEST_ASSERT_EQUAL_HEX32(0x100, record.Frame.R0);
+    TEST_ASSERT_EQUAL_HEX32(0x104, record.Frame.R12);
+    TEST_ASSERT_EQUAL_HEX32(0x08000E11U, record.Frame.Lr);
+    TEST_ASSERT_EQUAL_HEX32(0x08000F3AU, record.Frame.Pc);
+    TEST_ASSERT_EQUAL_HEX32(0x40021000U, record.Regs.Bfar);
+    TEST_ASSERT_EQUAL_HEX32(FRAME_SP + 0x20, record.Sp);
+}
+
+void test_capture_unwinds_padding_and_fp_frame(void)
+{
+    // Arrange: stack realigned on entry, FP context stacked, thread on PSP
+    SetFrame(0x08000F3AU, 0x08000E11U, 0x21000200U);
+
+    // Act
+    CRASH_Capture(&record, CRASH_EXC_USAGEFAULT, EXC_RETURN_PSP_FP, FRAME_SP, frame, &regs);
+
+    // Assert
+    TEST_ASSERT_EQUAL_HEX32(CRASH_FLAG_FRAME | CRASH_FLAG_PSP | CRASH_FLAG_FPU, record.Flags);
+    TEST_ASSERT_EQUAL_HEX32(FRAME_SP + 0x68 + 4, record.Sp);
+}
+
+void test_capture_without_readable_frame(void)
+{
+    // Act: stacking failed, the handler could not read SP
+    CRASH_Capture(&record, CRASH_EXC_HARDFAULT, EXC_RETURN_PSP, 0xDEAD0000U, NULL, &regs);
+
+    // Assert
+    TEST_ASSERT_EQUAL_HEX32(CRASH_FLAG_PSP, record.Flags);
+    TEST_ASSERT_EQUAL_HEX32(0xDEAD0000U, record.Sp);
+    TEST_ASSERT_EQUAL_HEX32(0, record.Frame.Pc);
+}
+
+/* ============================================================================ */
+/* INTEGRITY TESTS */
+/* ============================================================================ */
+
+void test_power_on_garbage_is_not_a_crash(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(0, CRASH_IsValid(&record));
+    TEST_ASSERT_EQUAL_UINT8(0, CRASH_IsPending(&record));
+
+    // Even with the right magic the checksum must match
+    record.Magic = CRASH_MAGIC;
+    TEST_ASSERT_EQUAL_UINT8(0, CRASH_IsPending(&record));
+}
+
+void test_corrupted_record_is_rejected(void)
+{
+    // Arrange
+    CaptureBusFault();
+    TEST_ASSERT_EQUAL_UINT8(1, CRASH_IsPending(&record));
+
+    // Act
+    record.Trace[CRASH_TRACE_RECORDS - 1].Payload ^= 1;
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT8(0, CRASH_IsValid(&record));
+}
+
+void test_fault_count_survives_report(void)
+{
+    // Arrange
+    CaptureBusFault();
+    TEST_ASSERT_EQUAL_UINT32(1, record.Count);
+
+    // Act
+    CRASH_MarkReported(&record);
+
+    // Assert: kept for counting, not reported again
+    TEST_ASSERT_EQUAL_UINT8(1, CRASH_IsValid(&record));
+    TEST_ASSERT_EQUAL_UINT8(0, CRASH_IsPending(&record));
+    CaptureBusFault();
+    TEST_ASSERT_EQUAL_UINT32(2, record.Count);
+    TEST_ASSERT_EQUAL_UINT8(1, CRASH_IsPending(&record));
+}
+
+/* ============================================================================ */
+/* TRACE CAPTURE TESTS */
+/* ============================================================================ */
+
+void test_trace_tail_is_kept_oldest_first(void)
+{
+    // Arrange: a wrapped 64-record ring holding 100 events, 5 cycles apart
+    static TRACE_RecordTypeDef ring_records[64];
+    TRACE_RingTypeDef ring;
+    TRACE_DumpHeaderTypeDef header;
+    uint32_t i;
+    TEST_ASSERT_EQUAL(TRACE_OK, TRACE_Init(&ring, ring_records, 64, 168000000U, 0));
+    for (i = 0; i < 100; i++)
+    {
+        TRACE_Encode(&ring, 5 + i * 5, TRACE_EV_MARK, i);
+    }
+    CRASH_Capture(&record, CRASH_EXC_HARDFAULT, EXC_RETURN_MSP, FRAME_SP, frame, &regs);
+
+    // Act
+    CRASH_CaptureTrace(&record, &ring);
+
+    // Assert: header and records form a trace dump
+    TEST_ASSERT_EQUAL(TRACE_OK, TRACE_Decode((const uint8_t *)&record.TraceHeader,
+                                             sizeof(record.TraceHeader) + sizeof(record.Trace),
+                                             &header, Capture, NULL));
+    TEST_ASSERT_EQUAL_UINT32(CRASH_TRACE_RECORDS, header.Count);
+    TEST_ASSERT_EQUAL_UINT32(100 - CRASH_TRACE_RECORDS, header.Lost);
+    TEST_ASSERT_EQUAL_UINT32(CRASH_TRACE_RECORDS, event_count);
+    for (i = 0; i < CRASH_TRACE_RECORDS; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(100 - CRASH_TRACE_RECORDS + i, events[i].Payload);
+        TEST_ASSERT_EQUAL_UINT32(i * 5, (uint32_t)events[i].Cycles);
+    }
+}
+
+void test_short_trace_is_kept_whole(void)
+{
+    // Arrange
+    static TRACE_RecordTypeDef ring_records[64];
+    TRACE_RingTypeDef ring;
+    TEST_ASSERT_EQUAL(TRACE_OK, TRACE_Init(&ring, ring_records, 64, 168000000U, 0));
+    TRACE_Encode(&ring, 10, TRACE_EV_ISR_ENTER, (uint32_t)-1);
+    TRACE_Encode(&ring, 20, TRACE_EV_ISR_EXIT, (uint32_t)-1);
+    CRASH_Capture(&record, CRASH_EXC_HARDFAULT, EXC_RETURN_MSP, FRAME_SP, frame, &regs);
+
+    // Act
+    CRASH_CaptureTrace(&record, &ring);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(2, record.TraceHeader.Count);
+    TEST_ASSERT_EQUAL_UINT32(0, record.TraceHeader.Lost);
+    TEST_ASSERT_EQUAL_HEX32(0x0100000A, record.Trace[0].Header);
+}
+
+void test_clock_change_left_out_sets_trace_clock(void)
+{
+    // Arrange: a switch to 42 MHz, then more records than the crash keeps
+    static TRACE_RecordTypeDef ring_records[64];
+    TRACE_RingTypeDef ring;
+    uint32_t i;
+    TEST_ASSERT_EQUAL(TRACE_OK, TRACE_Init(&ring, ring_records, 64, 168000000U, 0));
+    TRACE_Clock(&ring, 10, 42000000U);
+    for (i = 0; i < CRASH_TRACE_RECORDS; i++)
+    {
+        TRACE_Encode(&ring, 20 + i * 5, TRACE_EV_MARK, i);
+    }
+    CRASH_Capture(&record, CRASH_EXC_HARDFAULT, EXC_RETURN_MSP, FRAME_SP, frame, &regs);
+
+    // Act
+    CRASH_CaptureTrace(&record, &ring);
+
+    // Assert: every record kept counts at 42 MHz
+    TEST_ASSERT_EQUAL_UINT32(CRASH_TRACE_RECORDS, record.TraceHeader.Count);
+    TEST_ASSERT_EQUAL_UINT32(1, record.TraceHeader.Lost);
+    TEST_ASSERT_EQUAL_UINT32(42000000U, record.TraceHeader.CpuHz);
+}
+
+void test_uninitialised_trace_leaves_no_dump(void)
+{
+    // Arrange: fault before the recorder was started
+    TRACE_RingTypeDef ring;
+    memset(&ring, 0, sizeof(ring));
+    CRASH_Capture(&record, CRASH_EXC_HARDFAULT, EXC_RETURN_MSP, FRAME_SP, frame, &regs);
+
+    // Act
+    CRASH_CaptureTrace(&record, &ring);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(0, record.TraceHeader.Magic);
+    TEST_ASSERT_EQUAL_UINT32(0, record.TraceHeader.Count);
+}
+
+/* ============================================================================ */
+/* REPORT TESTS */
+/* ============================================================================ */
+
+void test_causes_name_every_status_bit(void)
+{
+    // Arrange
+    char out[CRASH_LINE_MAX];
+    CRASH_FaultRegsTypeDef r = { 0x02010082U, 0x40000000U, 0, 0 };
+
+    // Act & Assert
+    CRASH_Causes(&r, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("FORCED DACCVIOL MMARVALID UNDEFINSTR DIVBYZERO", out);
+    r.Cfsr = 0;
+    r.Hfsr = 0;
+    CRASH_Causes(&r, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("no status", out);
+}
+
+void test_causes_truncate_to_buffer(void)
+{
+    // Arrange
+    char out[16];
+    CRASH_FaultRegsTypeDef r = { 0xFFFFFFFFU, 0xFFFFFFFFU, 0, 0 };
+
+    // Act
+    uint32_t len = CRASH_Causes(&r, out, sizeof(out));
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(15, len);
+    TEST_ASSERT_EQUAL_STRING("VECTTBL FORCED ", out);
+}
+
+void test_report_lines(void)
+{
+    // Arrange
+    char out[CRASH_LINE_MAX];
+    record.Count = 7;   /* garbage: the counter restarts */
+    CaptureBusFault();
+
+    // Act & Assert
+    uint32_t len = CRASH_FormatLine(&record, 0, out, sizeof(out));
+    TEST_ASSERT_EQUAL_UINT32(strlen(out), len);
+    TEST_ASSERT_EQUAL_STRING("crash 1: BusFault, PRECISERR BFARVALID", out);
+    CRASH_FormatLine(&record, 1, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("pc 0x08000F3A lr 0x08000E11 msp 0x2001FF20 psr 0x21000000", out);
+    CRASH_FormatLine(&record, 2, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("r0 0x00000100 r1 0x00000101 r2 0x00000102 r3 0x00000103 r12 0x00000104", out);
+    CRASH_FormatLine(&record, 3, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("cfsr 0x00008200 hfsr 0x00000000 mmfar 0xE000EDF4 bfar 0x40021000", out);
+
+    // No trace captured: the report ends here
+    TEST_ASSERT_EQUAL_UINT32(0, CRASH_FormatLine(&record, 4, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_UINT32(0, CRASH_FormatLine(&record, 40, out, sizeof(out)));
+}
+
+void test_report_without_frame_and_with_trace(void)
+{
+    // Arrange
+    char out[CRASH_LINE_MAX];
+    uint32_t lines = 0;
+    CRASH_Capture(&record, CRASH_EXC_HARDFAULT, EXC_RETURN_PSP, 0x0800DEADU, NULL, &regs);
+    record.TraceHeader.Count = 3;
+    record.TraceHeader.Lost = 9;
+
+    // Act
+    while (CRASH_FormatLine(&record, lines, out, sizeof(out)) != 0)
+    {
+        TEST_ASSERT_TRUE(strlen(out) < CRASH_LINE_MAX);
+        lines++;
+    }
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(4, lines);
+    CRASH_FormatLine(&record, 1, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("stacked frame unreadable, psp 0x0800DEAD", out);
+    CRASH_FormatLine(&record, 3, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("trace: 3 events kept, 9 earlier lost", out);
+}
+
+void test_report_names_guard_hit(void)
+{
+    // Arrange: a push past the end of a task stack, and a NULL read
+    char out[CRASH_LINE_MAX];
+    CaptureBusFault();
+    record.Exception = CRASH_EXC_MEMMANAGE;
+    CRASH_CaptureGuard(&record, "much-too-long", 1U, 0x20001F9CU);
+
+    // Act & Assert: right after the headline, name cut to fit
+    CRASH_FormatLine(&record, 1, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("guard: much-too-lo stack overflow at 0x20001F9C", out);
+    CRASH_FormatLine(&record, 2, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("pc 0x08000F3A lr 0x08000E11 msp 0x2001FF20 psr 0x21000000", out);
+    TEST_ASSERT_EQUAL_UINT32(0, CRASH_FormatLine(&record, 5, out, sizeof(out)));
+
+    record.Flags &= ~CRASH_FLAG_STACK;
+    record.GuardAddress = 8U;
+    CRASH_FormatLine(&record, 1, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("guard: null pointer access at 0x00000008", out);
+}
+
+void test_exception_names(void)
+{
+    TEST_ASSERT_EQUAL_STRING("HardFault", CRASH_ExceptionName(CRASH_EXC_HARDFAULT));
+    TEST_ASSERT_EQUAL_STRING("MemManage", CRASH_ExceptionName(CRASH_EXC_MEMMANAGE));
+    TEST_ASSERT_EQUAL_STRING("UsageFault", CRASH_ExceptionName(CRASH_EXC_USAGEFAULT));
+    TEST_ASSERT_EQUAL_STRING("exception", CRASH_ExceptionName(2));
+}
+
+/* ============================================================================ */
+/* MAIN TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Capture Tests */
+    RUN_TEST(test_capture_copies_frame_and_registers);
+    RUN_TEST(test_capture_unwinds_padding_and_fp_frame);
+    RUN_TEST(test_capture_without_readable_frame);
+
+    /* Integrity Tests */
+    RUN_TEST(test_power_on_garbage_is_not_a_crash);
+    RUN_TEST(test_corrupted_record_is_rejected);
+    RUN_TEST(test_fault_count_survives_report);
+
+    /* Trace Capture Tests */
+    RUN_TEST(test_trace_tail_is_kept_oldest_first);
+    RUN_TEST(test_short_trace_is_kept_whole);
+    RUN_TEST(test_clock_change_left_out_sets_trace_clock);
+    RUN_TEST(test_uninitialised_trace_leaves_no_dump);
+
+    /* Report Tests */
+    RUN_TEST(test_causes_name_every_status_bit);
+    RUN_TEST(test_causes_truncate_to_buffer);
+    RUN_TEST(test_report_lines);
+    RUN_TEST(test_report_without_frame_and_with_trace);
+    RUN_TEST(test_report_names_guard_hit);
+    RUN_TEST(test_exception_names);
+
+    return UNITY_END();
+}
@@ -0,0 +1,321 @@
+/**
+  ******************************************************************************
+  * @file    test_dac_wave.c
+  * @author  Test Framework
+  * @brief   Unit tests for DAC waveform synthesis and rate solving
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "dac_wave.h"
+#include <math.h>
+#include <string.h>
+
+#define SAMPLES        64U
+#define PI             3.14159265358979323846
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+static uint16_t table[SAMPLES];
+
+void setUp(void)
+{
+    memset(table, 0xEE, sizeof(table));
+}
+
+void tearDown(void)
+{
+}
+
+static int32_t Reference(uint32_t phase)
+{
+    double value = floor(32768.0 * sin(2.0 * PI * (double)phase / 4294967296.0) + 0.5);
+
+    return (value > 32767.0) ? 32767 : (int32_t)value;
+}
+
+/* ============================================================================ */
+/* SINE TESTS */
+/* ============================================================================ */
+
+void test_sin_quadrant_points(void)
+{
+    TEST_ASSERT_EQUAL_INT32(0, DAC_WAVE_Sin(0x00000000UL));
+    TEST_ASSERT_EQUAL_INT32(32767, DAC_WAVE_Sin(0x40000000UL));
+    TEST_ASSERT_EQUAL_INT32(0, DAC_WAVE_Sin(0x80000000UL));
+    TEST_ASSERT_EQUAL_INT32(-32767, DAC_WAVE_Sin(0xC0000000UL));
+}
+
+void test_sin_within_one_lsb(void)
+{
+    uint32_t phase;
+    uint32_t i;
+
+    // Every 1/4096 turn, plus points off the grid
+    for (i = 0U; i < 4096U; i++)
+    {
+        phase = i << 20;
+        TEST_ASSERT_INT_WITHIN(1, Reference(phase), DAC_WAVE_Sin(phase));
+        phase += 0x0005A5A5UL;
+        TEST_ASSERT_INT_WITHIN(1, Reference(phase), DAC_WAVE_Sin(phase));
+    }
+}
+
+void test_sin_is_odd(void)
+{
+    uint32_t i;
+
+    for (i = 1U; i < 256U; i++)
+    {
+        TEST_ASSERT_EQUAL_INT32(-DAC_WAVE_Sin(i * 0x00FEDCBAUL), DAC_WAVE_Sin(0U - i * 0x00FEDCBAUL));
+    }
+}
+
+/* ============================================================================ */
+/* TABLE TESTS */
+/* ============================================================================ */
+
+void test_sine_table_peaks_and_offset(void)
+{
+    TEST_ASSERT_EQUAL(DAC_WAVE_OK, DAC_WAVE_Sine(table, SAMPLES, 1U, 2000U, DAC_WAVE_MID));
+
+    TEST_ASSERT_EQUAL_UINT16(DAC_WAVE_MID, table[0]);
+    TEST_ASSERT_INT_WITHIN(1, DAC_WAVE_MID + 2000, table[SAMPLES / 4U]);
+    TEST_ASSERT_INT_WITHIN(1, DAC_WAVE_MID, table[SAMPLES / 2U]);
+    TEST_ASSERT_INT_WITHIN(1, DAC_WAVE_MID - 2000, table[3U * SAMPLES / 4U]);
+}
+
+void test_sine_table_loops_seamlessly(void)
+{
+    uint32_t i;
+
+    // Two cycles: the second half repeats the first exactly
+    TEST_ASSERT_EQUAL(DAC_WAVE_OK, DAC_WAVE_Sine(table, SAMPLES, 2U, 1500U, 2000U));
+
+    for (i = 0U; i < SAMPLES / 2U; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT16(table[i], table[i + SAMPLES / 2U]);
+    }
+}
+
+void test_sine_table_clips(void)
+{
+    TEST_ASSERT_EQUAL(DAC_WAVE_OK, DAC_WAVE_Sine(table, SAMPLES, 1U, 4000U, DAC_WAVE_MID));
+
+    TEST_ASSERT_EQUAL_UINT16(DAC_WAVE_FULL, table[SAMPLES / 4U]);
+    TEST_ASSERT_EQUAL_UINT16(0U, table[3U * SAMPLES / 4U]);
+}
+
+void test_sine_table_invalid(void)
+{
+    TEST_ASSERT_EQUAL(DAC_WAVE_INVALID, DAC_WAVE_Sine(table, 0U, 1U, 100U, DAC_WAVE_MID));
+    TEST_ASSERT_EQUAL(DAC_WAVE_INVALID, DAC_WAVE_Sine(table, SAMPLES, 0U, 100U, DAC_WAVE_MID));
+    TEST_ASSERT_EQUAL(DAC_WAVE_INVALID, DAC_WAVE_Sine(table, SAMPLES, SAMPLES / 2U + 1U, 100U, DAC_WAVE_MID));
+
+    // Untouched
+    TEST_ASSERT_EQUAL_UINT16(0xEEEEU, table[0]);
+}
+
+void test_shape_interpolates_and_wraps(void)
+{
+    const uint16_t points[2] = {0U, 4000U};
+    const uint16_t triangle[8] = {0U, 1000U, 2000U, 3000U, 4000U, 3000U, 2000U, 1000U};
+
+    TEST_ASSERT_EQUAL(DAC_WAVE_OK, DAC_WAVE_Shape(table, 8U, points, 2U));
+
+    TEST_ASSERT_EQUAL_MEMORY(triangle, table, 8U * sizeof(uint16_t));
+    TEST_ASSERT_EQUAL_UINT16(0xEEEEU, table[8]);
+}
+
+void test_shape_one_point_per_sample_copies(void)
+{
+    const uint16_t points[4] = {100U, 4095U, 0U, 2048U};
+
+    TEST_ASSERT_EQUAL(DAC_WAVE_OK, DAC_WAVE_Shape(table, 4U, points, 4U));
+
+    TEST_ASSERT_EQUAL_MEMORY(points, table, 4U * sizeof(uint16_t));
+}
+
+void test_shape_invalid(void)
+{
+    const uint16_t points[4] = {0U, 1U, 2U, 3U};
+
+    TEST_ASSERT_EQUAL(DAC_WAVE_INVALID, DAC_WAVE_Shape(table, 4U, points, 0U));
+    TEST_ASSERT_EQUAL(DAC_WAVE_INVALID, DAC_WAVE_Shape(table, 3U, points, 4U));
+    TEST_ASSERT_EQUAL(DAC_WAVE_INVALID, DAC_WAVE_Shape(table, 0U, points, 4U));
+}
+
+/* ============================================================================ */
+/* RATE TESTS */
+/* ============================================================================ */
+
+void test_rate_exact(void)
+{
+    DAC_WAVE_RateTypeDef rate;
+
+    TEST_ASSERT_EQUAL(DAC_WAVE_OK, DAC_WAVE_SolveRate(84000000UL, 1000000UL, &rate));
+
+    TEST_ASSERT_EQUAL_UINT32(0U, rate.Prescaler);
+    TEST_ASSERT_EQUAL_UINT32(83U, rate.Period);
+    TEST_ASSERT_EQUAL_UINT32(1000000UL, rate.ActualHz);
+    TEST_ASSERT_EQUAL_INT32(0, rate.ErrorPpm);
+
+    // HSI timer clock
+    TEST_ASSERT_EQUAL(DAC_WAVE_OK, DAC_WAVE_SolveRate(16000000UL, 1000000UL, &rate));
+    TEST_ASSERT_EQUAL_UINT32(0U, rate.Prescaler);
+    TEST_ASSERT_EQUAL_UINT32(15U, rate.Period);
+}
+
+void test_rate_low_needs_prescaler(void)
+{
+    DAC_WAVE_RateTypeDef rate;
+
+    // 8.4e6 counts: the first divisor with a 16-bit reload is 140
+    TEST_ASSERT_EQUAL(DAC_WAVE_OK, DAC_WAVE_SolveRate(84000000UL, 10U, &rate));
+
+    TEST_ASSERT_EQUAL_UINT32(139U, rate.Prescaler);
+    TEST_ASSERT_EQUAL_UINT32(59999U, rate.Period);
+    TEST_ASSERT_EQUAL_UINT32(10U, rate.ActualHz);
+    TEST_ASSERT_EQUAL_INT32(0, rate.ErrorPpm);
+}
+
+void test_rate_closest(void)
+{
+    DAC_WAVE_RateTypeDef rate;
+    uint64_t divisor;
+
+    // 84 MHz / 44.1 kHz = 1904.76: no exact setting
+    TEST_ASSERT_EQUAL(DAC_WAVE_OK, DAC_WAVE_SolveRate(84000000UL, 44100U, &rate));
+
+    divisor = (uint64_t)(rate.Prescaler + 1U) * (rate.Period + 1U);
+    TEST_ASSERT_INT_WITHIN(6, 44100U, rate.ActualHz);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)((84000000ULL + divisor / 2U) / divisor), rate.ActualHz);
+
+    // Divides by 1905: 124 ppm slow beats 1904, 400 ppm fast
+    TEST_ASSERT_EQUAL_UINT32(1905U, (uint32_t)divisor);
+    TEST_ASSERT_EQUAL_INT32(-124, rate.ErrorPpm);
+}
+
+void test_rate_error_sign(void)
+{
+    DAC_WAVE_RateTypeDef rate;
+
+    // 84 MHz / 1.1 MHz is over the limit; 84 MHz / 999 kHz = 84.08 -> 84, fast
+    TEST_ASSERT_EQUAL(DAC_WAVE_OK, DAC_WAVE_SolveRate(84000000UL, 999000UL, &rate));
+
+    TEST_ASSERT_EQUAL_UINT32(83U, rate.Period);
+    TEST_ASSERT_EQUAL_UINT32(1000000UL, rate.ActualHz);
+    TEST_ASSERT_EQUAL_INT32(1001, rate.ErrorPpm);
+}
+
+void test_rate_invalid(void)
+{
+    DAC_WAVE_RateTypeDef rate;
+
+    TEST_ASSERT_EQUAL(DAC_WAVE_INVALID, DAC_WAVE_SolveRate(84000000UL, 0U, &rate));
+    TEST_ASSERT_EQUAL(DAC_WAVE_INVALID, DAC_WAVE_SolveRate(84000000UL, DAC_WAVE_MAX_RATE + 1U, &rate));
+    TEST_ASSERT_EQUAL(DAC_WAVE_INVALID, DAC_WAVE_SolveRate(1000000UL, 600000UL, &rate));
+}
+
+/* ============================================================================ */
+/* OSCILLATOR TESTS */
+/* ============================================================================ */
+
+void test_osc_tone_continues_across_blocks(void)
+{
+    DAC_WAVE_OscTypeDef whole;
+    DAC_WAVE_OscTypeDef blocks;
+    uint16_t once[48];
+    uint16_t split[48];
+
+    TEST_ASSERT_EQUAL(DAC_WAVE_OK, DAC_WAVE_OscInit(&whole, 48000U, 1000U, 1000U, 0U, 1000U, DAC_WAVE_MID));
+    TEST_ASSERT_EQUAL(DAC_WAVE_OK, DAC_WAVE_OscInit(&blocks, 48000U, 1000U, 1000U, 0U, 1000U, DAC_WAVE_MID));
+
+    // Act
+    DAC_WAVE_OscRender(&whole, once, 48U);
+    DAC_WAVE_OscRender(&blocks, split, 16U);
+    DAC_WAVE_OscRender(&blocks, &split[16], 16U);
+    DAC_WAVE_OscRender(&blocks, &split[32], 16U);
+
+    // Assert: one cycle, peak a quarter in
+    TEST_ASSERT_EQUAL_MEMORY(once, split, 48U * sizeof(uint16_t));
+    TEST_ASSERT_EQUAL_UINT16(DAC_WAVE_MID, once[0]);
+    TEST_ASSERT_INT_WITHIN(1, DAC_WAVE_MID + 1000, once[12]);
+    TEST_ASSERT_INT_WITHIN(1, DAC_WAVE_MID - 1000, once[36]);
+    TEST_ASSERT_EQUAL_INT32(0, whole.Sweep);
+
+    // The next cycle starts where the first one did
+    DAC_WAVE_OscRender(&whole, once, 1U);
+    TEST_ASSERT_INT_WITHIN(1, DAC_WAVE_MID, once[0]);
+}
+
+void test_osc_chirp_sweeps_and_restarts(void)
+{
+    DAC_WAVE_OscTypeDef osc;
+    uint16_t block[50];
+    uint64_t phase;
+
+    // 10 Hz to 110 Hz over 100 ms at 1 kHz: 100 samples
+    TEST_ASSERT_EQUAL(DAC_WAVE_OK, DAC_WAVE_OscInit(&osc, 1000U, 10U, 110U, 100U, 1000U, DAC_WAVE_MID));
+    TEST_ASSERT_EQUAL_UINT32(100U, osc.Length);
+
+    // Halfway: 60 Hz
+    DAC_WAVE_OscRender(&osc, block, 50U);
+    TEST_ASSERT_INT_WITHIN(1, (uint32_t)((60ULL << 32) / 1000U), (uint32_t)(osc.Step >> 32));
+    TEST_ASSERT_EQUAL_UINT32(50U, osc.Position);
+
+    // End of the sweep: back to 10 Hz, phase carried on
+    DAC_WAVE_OscRender(&osc, block, 50U);
+    phase = osc.Phase;
+    TEST_ASSERT_EQUAL_UINT32(0U, osc.Position);
+    TEST_ASSERT_TRUE(osc.Step == osc.StartStep);
+    TEST_ASSERT_TRUE(phase != 0U);
+}
+
+void test_osc_invalid(void)
+{
+    DAC_WAVE_OscTypeDef osc;
+
+    TEST_ASSERT_EQUAL(DAC_WAVE_INVALID, DAC_WAVE_OscInit(&osc, 0U, 10U, 10U, 0U, 100U, DAC_WAVE_MID));
+    TEST_ASSERT_EQUAL(DAC_WAVE_INVALID, DAC_WAVE_OscInit(&osc, 1000U, 501U, 10U, 100U, 100U, DAC_WAVE_MID));
+    TEST_ASSERT_EQUAL(DAC_WAVE_INVALID, DAC_WAVE_OscInit(&osc, 1000U, 10U, 501U, 100U, 100U, DAC_WAVE_MID));
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Sine Tests */
+    RUN_TEST(test_sin_quadrant_points);
+    RUN_TEST(test_sin_within_one_lsb);
+    RUN_TEST(test_sin_is_odd);
+
+    /* Table Tests */
+    RUN_TEST(test_sine_table_peaks_and_offset);
+    RUN_TEST(test_sine_table_loops_seamlessly);
+    RUN_TEST(test_sine_table_clips);
+    RUN_TEST(test_sine_table_invalid);
+    RUN_TEST(test_shape_interpolates_and_wraps);
+    RUN_TEST(test_shape_one_point_per_sample_copies);
+    RUN_TEST(test_shape_invalid);
+
+    /* Rate Tests */
+    RUN_TEST(test_rate_exact);
+    RUN_TEST(test_rate_low_needs_prescaler);
+    RUN_TEST(test_rate_closest);
+    RUN_TEST(test_rate_error_sign);
+    RUN_TEST(test_rate_invalid);
+
+    /* Oscillator Tests */
+    RUN_TEST(test_osc_tone_continues_across_blocks);
+    RUN_TEST(test_osc_chirp_sweeps_and_restarts);
+    RUN_TEST(test_osc_invalid);
+
+    return UNITY_END();
+}
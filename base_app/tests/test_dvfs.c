@@ -0,0 +1,356 @@
+/**
+  ******************************************************************************
+  * @file    test_dvfs.c
+  * @author  Test Framework
+  * @brief   Unit tests for operating points and peripheral re-timing
+  ******************************************************************************
+  * The point table mirrors the one in power.c for a 168 MHz PLL and the
+  * 16 MHz HSI: the console UART, a 1 MHz timer and the 1 kHz SysTick must
+  * keep their rates at every point.
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "dvfs.h"
+#include <stddef.h>
+
+#define MHZ(x)         ((uint32_t)(x) * 1000000U)
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+static const DVFS_PointTypeDef Points[4] =
+{
+    { "full",    MHZ(168), 1U, 1U, 4U, 2U, 5U, 1U },
+    { "half",    MHZ(168), 2U, 1U, 2U, 1U, 2U, 1U },
+    { "quarter", MHZ(168), 4U, 1U, 1U, 1U, 1U, 1U },
+    { "hsi",     MHZ(16),  1U, 0U, 1U, 1U, 0U, 2U }
+};
+
+static DVFS_HandleTypeDef hdvfs;
+static uint32_t CallsA;
+static uint32_t CallsB;
+static DVFS_EventTypeDef LastEvent;
+static const DVFS_PointTypeDef *LastPoint;
+static DVFS_StatusTypeDef VetoB;
+
+static DVFS_StatusTypeDef NotifyA(void *context, DVFS_EventTypeDef event, const DVFS_PointTypeDef *point)
+{
+    (void)context;
+    CallsA++;
+    LastEvent = event;
+    LastPoint = point;
+    return DVFS_OK;
+}
+
+static DVFS_StatusTypeDef NotifyB(void *context, DVFS_EventTypeDef event, const DVFS_PointTypeDef *point)
+{
+    (void)point;
+    CallsB++;
+    *(uint32_t *)context += 1U;
+    return (event == DVFS_EV_PRE) ? VetoB : DVFS_OK;
+}
+
+void setUp(void)
+{
+    (void)DVFS_Init(&hdvfs, Points, 4U, 0U);
+    CallsA = 0U;
+    CallsB = 0U;
+    LastPoint = NULL;
+    VetoB = DVFS_OK;
+}
+
+void tearDown(void)
+{
+}
+
+static uint32_t ErrorPermille(uint32_t pclk, uint32_t baud)
+{
+    uint32_t actual = pclk / DVFS_UartBrr(pclk, baud);
+
+    return ((actual > baud) ? (actual - baud) : (baud - actual)) * 1000U / baud;
+}
+
+static void AssertPlan(uint32_t from, uint32_t to, const DVFS_StepTypeDef *expected, uint32_t count)
+{
+    DVFS_StepTypeDef steps[DVFS_MAX_STEPS];
+    uint32_t i;
+
+    TEST_ASSERT_EQUAL_UINT32(count, DVFS_Plan(&Points[from], &Points[to], steps));
+    for (i = 0U; i < count; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(expected[i], steps[i]);
+    }
+}
+
+/* ============================================================================ */
+/* RE-TIMING TESTS */
+/* ============================================================================ */
+
+void test_bus_and_timer_clocks_per_point(void)
+{
+    // Full speed: APB1 /4, APB2 /2, timers at twice the bus
+    TEST_ASSERT_EQUAL_UINT32(MHZ(168), DVFS_Hclk(&Points[0]));
+    TEST_ASSERT_EQUAL_UINT32(MHZ(42), DVFS_Pclk(&Points[0], 1U));
+    TEST_ASSERT_EQUAL_UINT32(MHZ(84), DVFS_Pclk(&Points[0], 2U));
+    TEST_ASSERT_EQUAL_UINT32(MHZ(84), DVFS_TimerClock(&Points[0], 1U));
+    TEST_ASSERT_EQUAL_UINT32(MHZ(168), DVFS_TimerClock(&Points[0], 2U));
+
+    // Quarter: buses undivided, timers at the bus clock
+    TEST_ASSERT_EQUAL_UINT32(MHZ(42), DVFS_Hclk(&Points[2]));
+    TEST_ASSERT_EQUAL_UINT32(MHZ(42), DVFS_Pclk(&Points[2], 1U));
+    TEST_ASSERT_EQUAL_UINT32(MHZ(42), DVFS_TimerClock(&Points[2], 1U));
+
+    TEST_ASSERT_EQUAL_UINT32(MHZ(16), DVFS_TimerClock(&Points[3], 2U));
+}
+
+void test_uart_brr_within_2_percent_at_every_point(void)
+{
+    uint32_t i;
+
+    TEST_ASSERT_EQUAL_UINT32(365U, DVFS_UartBrr(MHZ(42), 115200U));
+    TEST_ASSERT_EQUAL_UINT32(139U, DVFS_UartBrr(MHZ(16), 115200U));
+    for (i = 0U; i < 4U; i++)
+    {
+        TEST_ASSERT_TRUE(ErrorPermille(DVFS_Pclk(&Points[i], 1U), 115200U) < 20U);
+        TEST_ASSERT_TRUE(ErrorPermille(DVFS_Pclk(&Points[i], 2U), 115200U) < 20U);
+    }
+}
+
+void test_timer_1mhz_prescaler_exact_at_every_point(void)
+{
+    uint32_t psc = 0U;
+    uint32_t i;
+
+    for (i = 0U; i < 4U; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(DVFS_OK, DVFS_TimerPrescaler(DVFS_TimerClock(&Points[i], 1U), MHZ(1), &psc));
+        TEST_ASSERT_EQUAL_UINT32(DVFS_TimerClock(&Points[i], 1U) / MHZ(1) - 1U, psc);
+    }
+    TEST_ASSERT_EQUAL_INT(DVFS_OK, DVFS_TimerPrescaler(MHZ(84), MHZ(1), &psc));
+    TEST_ASSERT_EQUAL_UINT32(83U, psc);
+}
+
+void test_timer_prescaler_inexact_or_out_of_range(void)
+{
+    uint32_t psc = 0U;
+
+    TEST_ASSERT_EQUAL_INT(DVFS_INEXACT, DVFS_TimerPrescaler(MHZ(16), 44100U, &psc));
+    TEST_ASSERT_EQUAL_UINT32(361U, psc);
+    TEST_ASSERT_EQUAL_INT(DVFS_INVALID, DVFS_TimerPrescaler(MHZ(168), 1000U, &psc));
+    TEST_ASSERT_EQUAL_INT(DVFS_INVALID, DVFS_TimerPrescaler(MHZ(16), MHZ(20), &psc));
+    TEST_ASSERT_EQUAL_INT(DVFS_INVALID, DVFS_TimerPrescaler(MHZ(16), 0U, &psc));
+}
+
+void test_systick_reload_at_every_point(void)
+{
+    uint32_t reload = 0U;
+    uint32_t i;
+
+    for (i = 0U; i < 4U; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(DVFS_OK, DVFS_SysTickReload(DVFS_Hclk(&Points[i]), 1000U, &reload));
+        TEST_ASSERT_EQUAL_UINT32(DVFS_Hclk(&Points[i]) / 1000U - 1U, reload);
+    }
+    TEST_ASSERT_EQUAL_INT(DVFS_INEXACT, DVFS_SysTickReload(MHZ(16), 3000U, &reload));
+    TEST_ASSERT_EQUAL_INT(DVFS_INVALID, DVFS_SysTickReload(MHZ(168), 1U, &reload));
+}
+
+/* ============================================================================ */
+/* VALIDATION AND PLAN TESTS */
+/* ============================================================================ */
+
+void test_validate_accepts_table(void)
+{
+    uint32_t i;
+
+    for (i = 0U; i < 4U; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(DVFS_OK, DVFS_Validate(&Points[i]));
+    }
+}
+
+void test_validate_rejects_broken_limits(void)
+{
+    DVFS_PointTypeDef p;
+
+    // APB1 over 42 MHz
+    p = Points[0];
+    p.Apb1Div = 2U;
+    TEST_ASSERT_EQUAL_INT(DVFS_INVALID, DVFS_Validate(&p));
+
+    // Too few wait states
+    p = Points[1];
+    p.FlashLatency = 1U;
+    TEST_ASSERT_EQUAL_INT(DVFS_INVALID, DVFS_Validate(&p));
+
+    // Scale 2 needs the PLL off
+    p = Points[2];
+    p.VoltageScale = 2U;
+    TEST_ASSERT_EQUAL_INT(DVFS_INVALID, DVFS_Validate(&p));
+
+    // No AHB /32
+    p = Points[3];
+    p.AhbDiv = 32U;
+    TEST_ASSERT_EQUAL_INT(DVFS_INVALID, DVFS_Validate(&p));
+
+    p = Points[3];
+    p.VoltageScale = 3U;
+    TEST_ASSERT_EQUAL_INT(DVFS_INVALID, DVFS_Validate(&p));
+
+    TEST_ASSERT_EQUAL_INT(DVFS_INVALID, DVFS_Init(&hdvfs, Points, 4U, 4U));
+}
+
+void test_plan_between_pll_points_is_clocks_only(void)
+{
+    const DVFS_StepTypeDef expected[] = { DVFS_STEP_CLOCKS };
+
+    AssertPlan(0U, 2U, expected, 1U);
+    AssertPlan(2U, 0U, expected, 1U);
+}
+
+void test_plan_to_hsi_lowers_scale_after_pll_off(void)
+{
+    const DVFS_StepTypeDef expected[] = { DVFS_STEP_CLOCKS, DVFS_STEP_PLL_OFF, DVFS_STEP_SCALE_DOWN };
+
+    AssertPlan(1U, 3U, expected, 3U);
+}
+
+void test_plan_from_hsi_raises_scale_before_pll_on(void)
+{
+    const DVFS_StepTypeDef expected[] = { DVFS_STEP_SCALE_UP, DVFS_STEP_PLL_ON, DVFS_STEP_CLOCKS };
+
+    AssertPlan(3U, 0U, expected, 3U);
+}
+
+/* ============================================================================ */
+/* NOTIFIER TESTS */
+/* ============================================================================ */
+
+void test_post_makes_point_current_and_tells_drivers(void)
+{
+    uint32_t count = 0U;
+
+    // Arrange
+    TEST_ASSERT_EQUAL_INT(DVFS_OK, DVFS_Register(&hdvfs, NotifyA, NULL));
+    TEST_ASSERT_EQUAL_INT(DVFS_OK, DVFS_Register(&hdvfs, NotifyB, &count));
+
+    // Act
+    TEST_ASSERT_EQUAL_INT(DVFS_OK, DVFS_Notify(&hdvfs, DVFS_EV_PRE, 2U));
+    TEST_ASSERT_EQUAL_UINT32(0U, hdvfs.Current);
+    TEST_ASSERT_EQUAL_INT(DVFS_OK, DVFS_Notify(&hdvfs, DVFS_EV_POST, 2U));
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(2U, hdvfs.Current);
+    TEST_ASSERT_EQUAL_UINT32(1U, hdvfs.Switches);
+    TEST_ASSERT_EQUAL_UINT32(2U, CallsA);
+    TEST_ASSERT_EQUAL_UINT32(2U, count);
+    TEST_ASSERT_EQUAL_INT(DVFS_EV_POST, LastEvent);
+    TEST_ASSERT_TRUE(LastPoint == &Points[2]);
+}
+
+void test_pre_veto_stops_at_first_driver(void)
+{
+    uint32_t count = 0U;
+
+    // Arrange
+    TEST_ASSERT_EQUAL_INT(DVFS_OK, DVFS_Register(&hdvfs, NotifyB, &count));
+    TEST_ASSERT_EQUAL_INT(DVFS_OK, DVFS_Register(&hdvfs, NotifyA, NULL));
+    VetoB = DVFS_BUSY;
+
+    // Act / Assert
+    TEST_ASSERT_EQUAL_INT(DVFS_BUSY, DVFS_Notify(&hdvfs, DVFS_EV_PRE, 3U));
+    TEST_ASSERT_EQUAL_UINT32(1U, CallsB);
+    TEST_ASSERT_EQUAL_UINT32(0U, CallsA);
+    TEST_ASSERT_EQUAL_UINT32(1U, hdvfs.Vetoes);
+    TEST_ASSERT_EQUAL_UINT32(0U, hdvfs.Current);
+    TEST_ASSERT_EQUAL_INT(DVFS_INVALID, DVFS_Notify(&hdvfs, DVFS_EV_PRE, 4U));
+}
+
+void test_register_full(void)
+{
+    uint32_t i;
+
+    for (i = 0U; i < DVFS_MAX_NOTIFIERS; i++)
+    {
+        TEST_ASSERT_EQUAL_INT(DVFS_OK, DVFS_Register(&hdvfs, NotifyA, NULL));
+    }
+    TEST_ASSERT_EQUAL_INT(DVFS_FULL, DVFS_Register(&hdvfs, NotifyA, NULL));
+    TEST_ASSERT_EQUAL_INT(DVFS_INVALID, DVFS_Register(&hdvfs, NULL, NULL));
+}
+
+/* ============================================================================ */
+/* GOVERNOR TESTS */
+/* ============================================================================ */
+
+void test_governor_jumps_to_full_speed_under_load(void)
+{
+    DVFS_GovernorTypeDef gov;
+
+    DVFS_GovernorInit(&gov, 700U, 250U, 2U);
+
+    // 80 of 100 ticks busy
+    TEST_ASSERT_EQUAL_UINT32(0U, DVFS_GovernorUpdate(&gov, 2U, 100U, 20U));
+    TEST_ASSERT_EQUAL_UINT16(800U, gov.Load);
+}
+
+void test_governor_steps_down_to_floor_when_quiet(void)
+{
+    DVFS_GovernorTypeDef gov;
+
+    DVFS_GovernorInit(&gov, 700U, 250U, 2U);
+
+    // 10% load per window: one point at a time, never below the floor
+    TEST_ASSERT_EQUAL_UINT32(1U, DVFS_GovernorUpdate(&gov, 0U, 100U, 90U));
+    TEST_ASSERT_EQUAL_UINT32(2U, DVFS_GovernorUpdate(&gov, 1U, 200U, 180U));
+    TEST_ASSERT_EQUAL_UINT32(2U, DVFS_GovernorUpdate(&gov, 2U, 300U, 270U));
+
+    // Medium load holds
+    TEST_ASSERT_EQUAL_UINT32(1U, DVFS_GovernorUpdate(&gov, 1U, 400U, 320U));
+}
+
+void test_governor_pulls_up_to_floor_and_ignores_empty_window(void)
+{
+    DVFS_GovernorTypeDef gov;
+
+    DVFS_GovernorInit(&gov, 700U, 250U, 2U);
+
+    TEST_ASSERT_EQUAL_UINT32(2U, DVFS_GovernorUpdate(&gov, 3U, 100U, 100U));
+    TEST_ASSERT_EQUAL_UINT32(3U, DVFS_GovernorUpdate(&gov, 3U, 100U, 100U));
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Re-timing Tests */
+    RUN_TEST(test_bus_and_timer_clocks_per_point);
+    RUN_TEST(test_uart_brr_within_2_percent_at_every_point);
+    RUN_TEST(test_timer_1mhz_prescaler_exact_at_every_point);
+    RUN_TEST(test_timer_prescaler_inexact_or_out_of_range);
+    RUN_TEST(test_systick_reload_at_every_point);
+
+    /* Validation and Plan Tests */
+    RUN_TEST(test_validate_accepts_table);
+    RUN_TEST(test_validate_rejects_broken_limits);
+    RUN_TEST(test_plan_between_pll_points_is_clocks_only);
+    RUN_TEST(test_plan_to_hsi_lowers_scale_after_pll_off);
+    RUN_TEST(test_plan_from_hsi_raises_scale_before_pll_on);
+
+    /* Notifier Tests */
+    RUN_TEST(test_post_makes_point_current_and_tells_drivers);
+    RUN_TEST(test_pre_veto_stops_at_first_driver);
+    RUN_TEST(test_register_full);
+
+    /* Governor Tests */
+    RUN_TEST(test_governor_jumps_to_full_speed_under_load);
+    RUN_TEST(test_governor_steps_down_to_floor_when_quiet);
+    RUN_TEST(test_governor_pulls_up_to_floor_and_ignores_empty_window);
+
+    return UNITY_END();
+}
@@ -0,0 +1,339 @@
+/**
+  ******************************************************************************
+  * @file    test_fixmath.c
+  * @author  Test Framework
+  * @brief   Unit tests for the fixed-point math library, against double
+  *          precision
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "fixmath.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define PI             3.14159265358979323846
+#define TURN           4294967296.0
+#define RANDOM_POINTS  200000U
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+static uint32_t seed;
+
+void setUp(void)
+{
+    seed = 12345U;
+}
+
+void tearDown(void)
+{
+}
+
+static uint32_t Random(void)
+{
+    seed = (seed * 1664525U) + 1013904223U;
+    return seed;
+}
+
+/* Random magnitude too: a random word shifted down by 0 to 31 bits */
+static uint32_t RandomScaled(void)
+{
+    uint32_t value = Random();
+
+    return value >> (Random() >> 27);
+}
+
+static double Radians(uint32_t angle)
+{
+    return 2.0 * PI * (double)angle / TURN;
+}
+
+static int64_t Round(double value)
+{
+    return (int64_t)floor(value + 0.5);
+}
+
+static int64_t Q31(double value)
+{
+    int64_t q = Round(value * 2147483648.0);
+
+    return (q > INT32_MAX) ? INT32_MAX : q;
+}
+
+/* Distance between two binary angles, around the circle */
+static int32_t AngleError(double reference, int32_t angle)
+{
+    return (int32_t)((uint32_t)angle - (uint32_t)(int64_t)Round(reference / (2.0 * PI) * TURN));
+}
+
+static void CheckSinCos(uint32_t angle)
+{
+    int32_t s;
+    int32_t c;
+
+    FIX_SinCos(angle, &s, &c);
+    TEST_ASSERT_TRUE(llabs(s - Q31(sin(Radians(angle)))) <= FIX_SINCOS_ERROR);
+    TEST_ASSERT_TRUE(llabs(c - Q31(cos(Radians(angle)))) <= FIX_SINCOS_ERROR);
+}
+
+static void CheckAtan2(int32_t y, int32_t x)
+{
+    int32_t error = AngleError(atan2((double)y, (double)x), FIX_Atan2(y, x));
+
+    TEST_ASSERT_INT_WITHIN(FIX_ATAN2_ERROR, 0, error);
+}
+
+/* ============================================================================ */
+/* TABLE TESTS */
+/* ============================================================================ */
+
+void test_tables_generated(void)
+{
+    // atan(1) is 45 degrees, the gain 1/K of the full CORDIC
+    TEST_ASSERT_EQUAL_UINT32(0x20000000UL, FIX_AtanTable[0]);
+    TEST_ASSERT_INT_WITHIN(2, 652032874, FIX_CordicGain);
+    TEST_ASSERT_EQUAL_INT16(0, FIX_SinTable[0]);
+    TEST_ASSERT_EQUAL_INT16(32767, FIX_SinTable[1UL << FIX_SIN_BITS]);
+    TEST_ASSERT_EQUAL_INT16(23170, FIX_SinTable[1UL << (FIX_SIN_BITS - 1U)]);
+}
+
+/* ============================================================================ */
+/* CORDIC TESTS */
+/* ============================================================================ */
+
+void test_sincos_quadrant_points(void)
+{
+    int32_t s;
+    int32_t c;
+
+    // +-1.0 saturates rather than wrapping
+    CheckSinCos(0U);
+    CheckSinCos(FIX_ANGLE_90);
+    CheckSinCos(FIX_ANGLE_180);
+    CheckSinCos(FIX_ANGLE_180 + FIX_ANGLE_90);
+    FIX_SinCos(0U, &s, &c);
+    TEST_ASSERT_TRUE(c > 0);
+    FIX_SinCos(FIX_ANGLE_180 + FIX_ANGLE_90, &s, &c);
+    TEST_ASSERT_TRUE(s < 0);
+}
+
+void test_sincos_within_bound(void)
+{
+    uint32_t i;
+
+    // A grid across all octant boundaries, then random angles
+    for (i = 0U; i < 65536U; i++)
+    {
+        CheckSinCos(i << 16);
+        CheckSinCos((i << 16) - 1U);
+    }
+    for (i = 0U; i < RANDOM_POINTS; i++)
+    {
+        CheckSinCos(Random());
+    }
+}
+
+void test_atan2_axes_and_diagonals(void)
+{
+    TEST_ASSERT_EQUAL_INT32(0, FIX_Atan2(0, 0));
+    CheckAtan2(0, 1000);
+    CheckAtan2(1000, 0);
+    CheckAtan2(0, -1000);
+    CheckAtan2(-1000, 0);
+    CheckAtan2(1, 1);
+    CheckAtan2(-1, -1);
+    CheckAtan2(INT32_MAX, INT32_MAX);
+    CheckAtan2(INT32_MIN, INT32_MIN);
+    CheckAtan2(INT32_MIN, 0);
+    CheckAtan2(0, INT32_MIN);
+}
+
+void test_atan2_within_bound_at_any_scale(void)
+{
+    int32_t y;
+    int32_t x;
+    uint32_t i;
+
+    for (i = 0U; i < RANDOM_POINTS; i++)
+    {
+        y = (int32_t)Random() >> (Random() >> 27);
+        x = (int32_t)Random() >> (Random() >> 27);
+        if ((x != 0) || (y != 0))
+        {
+            CheckAtan2(y, x);
+        }
+    }
+}
+
+void test_atan2_inverts_sincos(void)
+{
+    int32_t s;
+    int32_t c;
+    uint32_t angle;
+    uint32_t i;
+
+    for (i = 0U; i < 4096U; i++)
+    {
+        angle = Random();
+        FIX_SinCos(angle, &s, &c);
+        TEST_ASSERT_INT_WITHIN(2 * FIX_ATAN2_ERROR, 0, (int32_t)((uint32_t)FIX_Atan2(s, c) - angle));
+    }
+}
+
+/* ============================================================================ */
+/* TABLE LOOKUP TESTS */
+/* ============================================================================ */
+
+void test_sin15_quadrant_points(void)
+{
+    TEST_ASSERT_EQUAL_INT16(0, FIX_Sin15(0U));
+    TEST_ASSERT_EQUAL_INT16(32767, FIX_Sin15(FIX_ANGLE_90));
+    TEST_ASSERT_EQUAL_INT16(0, FIX_Sin15(FIX_ANGLE_180));
+    TEST_ASSERT_EQUAL_INT16(-32767, FIX_Sin15(FIX_ANGLE_180 + FIX_ANGLE_90));
+    TEST_ASSERT_EQUAL_INT16(32767, FIX_Cos15(0U));
+    TEST_ASSERT_EQUAL_INT16(-32767, FIX_Cos15(FIX_ANGLE_180));
+}
+
+void test_sin15_cos15_within_bound(void)
+{
+    double reference;
+    uint32_t angle;
+    uint32_t i;
+
+    // Every 1/65536 turn and the points just before
+    for (i = 0U; i < 131072U; i++)
+    {
+        angle = (i >> 1) << 16;
+        angle -= i & 1U;
+        reference = (double)Round(32768.0 * sin(Radians(angle)));
+        reference = (reference > 32767.0) ? 32767.0 : reference;
+        TEST_ASSERT_INT_WITHIN(FIX_SIN15_ERROR, (int32_t)reference, FIX_Sin15(angle));
+        reference = (double)Round(32768.0 * cos(Radians(angle)));
+        reference = (reference > 32767.0) ? 32767.0 : reference;
+        TEST_ASSERT_INT_WITHIN(FIX_SIN15_ERROR, (int32_t)reference, FIX_Cos15(angle));
+    }
+}
+
+void test_lookup_interpolates_between_entries(void)
+{
+    static const int16_t line[5] = { -32768, -16384, 0, 16384, 32767 };
+
+    TEST_ASSERT_EQUAL_INT32(-32768, FIX_Lookup(line, 2U, 0U));
+    TEST_ASSERT_EQUAL_INT32(-24576, FIX_Lookup(line, 2U, 0x20000000UL));
+    TEST_ASSERT_EQUAL_INT32(0, FIX_Lookup(line, 2U, 0x80000000UL));
+    TEST_ASSERT_EQUAL_INT32(8192, FIX_Lookup(line, 2U, 0xA0000000UL));
+    TEST_ASSERT_EQUAL_INT32(32767, FIX_Lookup(line, 2U, 0xFFFFFFFFUL));
+}
+
+/* ============================================================================ */
+/* SQUARE ROOT TESTS */
+/* ============================================================================ */
+
+void test_sqrt_exact(void)
+{
+    uint32_t x;
+    uint32_t r;
+    uint32_t i;
+
+    TEST_ASSERT_EQUAL_UINT32(0U, FIX_Sqrt(0U));
+    TEST_ASSERT_EQUAL_UINT32(1U, FIX_Sqrt(3U));
+    TEST_ASSERT_EQUAL_UINT32(65535U, FIX_Sqrt(UINT32_MAX));
+    for (i = 1U; i < 65536U; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(i, FIX_Sqrt(i * i));
+        TEST_ASSERT_EQUAL_UINT32(i - 1U, FIX_Sqrt((i * i) - 1U));
+    }
+    for (i = 0U; i < RANDOM_POINTS; i++)
+    {
+        x = RandomScaled();
+        r = FIX_Sqrt(x);
+        TEST_ASSERT_TRUE(((uint64_t)r * r) <= x);
+        TEST_ASSERT_TRUE(((uint64_t)(r + 1U) * (r + 1U)) > x);
+    }
+}
+
+void test_sqrt_q31_exact(void)
+{
+    uint64_t target;
+    uint64_t r;
+    int32_t x;
+    uint32_t i;
+
+    TEST_ASSERT_EQUAL_INT32(0, FIX_SqrtQ31(0));
+    TEST_ASSERT_EQUAL_INT32(0, FIX_SqrtQ31(-1));
+    TEST_ASSERT_EQUAL_INT32(0x20000000L, FIX_SqrtQ31(0x08000000L));     // sqrt(1/16) = 1/4
+    TEST_ASSERT_EQUAL_INT32(0x5A82799AL - 1, FIX_SqrtQ31(0x40000000L)); // sqrt(1/2), rounded down
+    TEST_ASSERT_EQUAL_INT32(INT32_MAX, FIX_SqrtQ31(INT32_MAX));
+    for (i = 0U; i < RANDOM_POINTS + 62U; i++)
+    {
+        // Powers of two and their neighbours, then random values
+        x = (i < 62U) ? (int32_t)((1UL << (i / 2U)) - (i & 1U)) : (int32_t)(RandomScaled() >> 1);
+        x = (x == 0) ? 1 : x;
+        r = (uint64_t)FIX_SqrtQ31(x);
+        target = (uint64_t)x << 31;
+        TEST_ASSERT_TRUE((r * r) <= target);
+        TEST_ASSERT_TRUE(((r + 1U) * (r + 1U)) > target);
+    }
+}
+
+/* ============================================================================ */
+/* RECIPROCAL TESTS */
+/* ============================================================================ */
+
+void test_recip_exact(void)
+{
+    uint32_t x;
+    uint32_t i;
+
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, FIX_Recip(0U));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, FIX_Recip(1U));
+    TEST_ASSERT_EQUAL_UINT32(0x80000000UL, FIX_Recip(2U));
+    TEST_ASSERT_EQUAL_UINT32(1431655765UL, FIX_Recip(3U));
+    TEST_ASSERT_EQUAL_UINT32(1U, FIX_Recip(UINT32_MAX));
+    TEST_ASSERT_EQUAL_UINT32(0x00010000UL, FIX_Recip(0x00010000UL));   // Q16.16: 1/1 = 1
+    TEST_ASSERT_EQUAL_UINT32(0x00004000UL, FIX_Recip(0x00040000UL));   // 1/4
+    for (i = 0U; i < RANDOM_POINTS + 93U; i++)
+    {
+        // Powers of two and their neighbours, then random values
+        x = (i < 93U) ? ((1UL << (i / 3U)) + (i % 3U) - 1U) : RandomScaled();
+        if (x > 1U)
+        {
+            TEST_ASSERT_EQUAL_UINT32((uint32_t)(0x100000000ULL / x), FIX_Recip(x));
+        }
+    }
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Table Tests */
+    RUN_TEST(test_tables_generated);
+
+    /* CORDIC Tests */
+    RUN_TEST(test_sincos_quadrant_points);
+    RUN_TEST(test_sincos_within_bound);
+    RUN_TEST(test_atan2_axes_and_diagonals);
+    RUN_TEST(test_atan2_within_bound_at_any_scale);
+    RUN_TEST(test_atan2_inverts_sincos);
+
+    /* Table Lookup Tests */
+    RUN_TEST(test_sin15_quadrant_points);
+    RUN_TEST(test_sin15_cos15_within_bound);
+    RUN_TEST(test_lookup_interpolates_between_entries);
+
+    /* Square Root Tests */
+    RUN_TEST(test_sqrt_exact);
+    RUN_TEST(test_sqrt_q31_exact);
+
+    /* Reciprocal Tests */
+    RUN_TEST(test_recip_exact);
+
+    return UNITY_END();
+}
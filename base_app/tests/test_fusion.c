@@ -0,0 +1,366 @@
+/**
+  ******************************************************************************
+  * @file    test_fusion.c
+  * @author  Test Framework
+  * @brief   Unit tests for the accelerometer tilt and vibration filter
+  ******************************************************************************
+  * The traces are generated as the LIS3DSH would record them: gravity at a
+  * given roll and pitch, vibration, white noise and 0.06 mg quantisation,
+  * at 100 Hz.
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "fusion.h"
+#include <math.h>
+#include <string.h>
+
+#define ODR_HZ         100.0f
+#define NOISE_G        0.002f
+#define RATE_DPS       90.0f
+#define WINDOW_S       1.0f
+#define LSB_G          0.00006f
+#define PI_F           3.14159265f
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+static FUSION_TypeDef f;
+static FUSION_TiltTypeDef tilt;
+static uint32_t seed;
+static uint32_t t;
+
+/* Vibration added to every sample: amplitude in g along a direction */
+static float vib_g;
+static float vib_hz;
+static float vib_dir[3];
+
+/* Worst and RMS tilt errors of the last Feed(), filter and raw sample */
+static float worst;
+static float rms;
+static float raw_rms;
+
+void setUp(void)
+{
+    FUSION_Init(&f, ODR_HZ, NOISE_G, RATE_DPS, WINDOW_S);
+    memset(&tilt, 0, sizeof(tilt));
+    seed = 12345U;
+    t = 0U;
+    vib_g = 0.0f;
+    vib_hz = 0.0f;
+    vib_dir[0] = 1.0f;
+    vib_dir[1] = 0.0f;
+    vib_dir[2] = 0.0f;
+}
+
+void tearDown(void)
+{
+}
+
+/* Uniform in [-0.5, 0.5) */
+static float Uniform(void)
+{
+    seed = seed * 1664525U + 1013904223U;
+    return (float)(seed >> 8) / 16777216.0f - 0.5f;
+}
+
+/* Unit variance, near enough Gaussian */
+static float Gauss(void)
+{
+    float sum = 0.0f;
+    uint32_t i;
+
+    for (i = 0U; i < 12U; i++)
+    {
+        sum += Uniform();
+    }
+    return sum;
+}
+
+static float Quantise(float g)
+{
+    return floorf(g / LSB_G + 0.5f) * LSB_G;
+}
+
+static float AngleError(float a, float b)
+{
+    float d = fmodf(a - b + 540.0f, 360.0f) - 180.0f;
+
+    return fabsf(d);
+}
+
+/* Feed samples at a fixed roll and pitch (degrees); errors are taken over
+   the samples after skip */
+static void Feed(float roll, float pitch, uint32_t count, uint32_t skip)
+{
+    float r = roll * PI_F / 180.0f;
+    float p = pitch * PI_F / 180.0f;
+    float g[3];
+    float a[3];
+    float v;
+    float e;
+    float sum = 0.0f;
+    float raw_sum = 0.0f;
+    FUSION_TiltTypeDef raw;
+    uint32_t i;
+    uint32_t k;
+
+    g[0] = -sinf(p);
+    g[1] = sinf(r) * cosf(p);
+    g[2] = cosf(r) * cosf(p);
+    worst = 0.0f;
+    for (i = 0U; i < count; i++, t++)
+    {
+        v = vib_g * sinf(2.0f * PI_F * vib_hz * (float)t / ODR_HZ);
+        for (k = 0U; k < 3U; k++)
+        {
+            a[k] = Quantise(g[k] + v * vib_dir[k] + NOISE_G * Gauss());
+        }
+        FUSION_Update(&f, a[0], a[1], a[2]);
+        if (i >= skip)
+        {
+            FUSION_Tilt(&f, &tilt);
+            FUSION_TiltOf(a[0], a[1], a[2], &raw);
+            e = AngleError(tilt.Roll, roll) + AngleError(tilt.Pitch, pitch);
+            worst = (e > worst) ? e : worst;
+            sum += e * e;
+            e = AngleError(raw.Roll, roll) + AngleError(raw.Pitch, pitch);
+            raw_sum += e * e;
+        }
+    }
+    rms = (count > skip) ? sqrtf(sum / (float)(count - skip)) : 0.0f;
+    raw_rms = (count > skip) ? sqrtf(raw_sum / (float)(count - skip)) : 0.0f;
+}
+
+/* ============================================================================ */
+/* GEOMETRY TESTS */
+/* ============================================================================ */
+
+void test_tilt_of_level(void)
+{
+    FUSION_TiltOf(0.0f, 0.0f, 1.0f, &tilt);
+
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, tilt.Roll);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, tilt.Pitch);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, tilt.Tilt);
+}
+
+void test_tilt_of_axes(void)
+{
+    FUSION_TiltOf(0.0f, 1.0f, 0.0f, &tilt);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 90.0f, tilt.Roll);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 90.0f, tilt.Tilt);
+
+    FUSION_TiltOf(-1.0f, 0.0f, 0.0f, &tilt);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 90.0f, tilt.Pitch);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 90.0f, tilt.Tilt);
+
+    /* Upside down: the magnitude does not matter */
+    FUSION_TiltOf(0.0f, 0.0f, -0.5f, &tilt);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 180.0f, fabsf(tilt.Roll));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 180.0f, tilt.Tilt);
+}
+
+/* ============================================================================ */
+/* CONVERGENCE TESTS */
+/* ============================================================================ */
+
+void test_first_sample_initialises_state(void)
+{
+    // Act
+    FUSION_Update(&f, 0.1f, -0.2f, 0.97f);
+
+    // Assert
+    TEST_ASSERT_EQUAL_FLOAT(0.1f, f.X[0]);
+    TEST_ASSERT_EQUAL_FLOAT(-0.2f, f.X[1]);
+    TEST_ASSERT_EQUAL_FLOAT(0.97f, f.X[2]);
+    TEST_ASSERT_EQUAL_UINT32(1U, f.Updates);
+}
+
+void test_converges_level(void)
+{
+    // Act: 2 s, judged over the second
+    Feed(0.0f, 0.0f, 200U, 100U);
+
+    // Assert: tuned for 90 degrees/s, so little smoothing at rest
+    TEST_ASSERT_TRUE(rms < 0.3f);
+    TEST_ASSERT_TRUE(worst < 0.8f);
+    TEST_ASSERT_TRUE(rms < raw_rms);
+}
+
+void test_converges_to_static_tilt(void)
+{
+    // Act
+    Feed(30.0f, -20.0f, 300U, 100U);
+
+    // Assert
+    FUSION_Tilt(&f, &tilt);
+    TEST_ASSERT_FLOAT_WITHIN(0.4f, 30.0f, tilt.Roll);
+    TEST_ASSERT_FLOAT_WITHIN(0.4f, -20.0f, tilt.Pitch);
+    TEST_ASSERT_TRUE(rms < 0.3f);
+    TEST_ASSERT_TRUE(worst < 0.8f);
+}
+
+void test_follows_tilt_step(void)
+{
+    // Arrange
+    Feed(0.0f, 0.0f, 300U, 300U);
+
+    // Act: turned over by 45 degrees, within 0.5 s
+    Feed(45.0f, 0.0f, 100U, 50U);
+
+    // Assert
+    TEST_ASSERT_TRUE(worst < 1.0f);
+}
+
+void test_tracks_rotation(void)
+{
+    uint32_t i;
+
+    // Arrange
+    Feed(0.0f, 0.0f, 200U, 200U);
+
+    // Act: 20 degrees/s about X for 2 s
+    for (i = 1U; i <= 200U; i++)
+    {
+        Feed(20.0f * (float)i / ODR_HZ, 0.0f, 1U, 0U);
+    }
+
+    // Assert: lags by well under a degree
+    FUSION_Tilt(&f, &tilt);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 40.0f, tilt.Roll);
+}
+
+/* ============================================================================ */
+/* VIBRATION TESTS */
+/* ============================================================================ */
+
+void test_vibration_at_rest_is_sensor_noise(void)
+{
+    // Act
+    Feed(10.0f, 10.0f, 500U, 500U);
+
+    // Assert: three axes of NOISE_G
+    TEST_ASSERT_FLOAT_WITHIN(0.0015f, 0.0035f, FUSION_Vibration(&f));
+}
+
+void test_vibration_rms_measured(void)
+{
+    // Arrange: 0.5 g peak at 23 Hz along X
+    vib_g = 0.5f;
+    vib_hz = 23.0f;
+
+    // Act
+    Feed(0.0f, 0.0f, 500U, 500U);
+
+    // Assert: 0.5 / sqrt(2)
+    TEST_ASSERT_FLOAT_WITHIN(0.02f, 0.354f, FUSION_Vibration(&f));
+}
+
+void test_tilt_steady_under_vibration(void)
+{
+    // Arrange
+    vib_g = 0.5f;
+    vib_hz = 23.0f;
+
+    // Act: 10 s at a tilt, judged after the first 3 s
+    Feed(15.0f, 25.0f, 1000U, 300U);
+
+    // Assert: the raw samples are tens of degrees out, the filter is not
+    TEST_ASSERT_TRUE(raw_rms > 10.0f);
+    TEST_ASSERT_TRUE(rms < 1.5f);
+    TEST_ASSERT_TRUE(rms * 10.0f < raw_rms);
+}
+
+void test_vibration_learns_its_axis(void)
+{
+    // Arrange: along X + Y
+    vib_g = 0.3f;
+    vib_hz = 17.0f;
+    vib_dir[0] = 0.7071f;
+    vib_dir[1] = 0.7071f;
+
+    // Act
+    Feed(0.0f, 0.0f, 500U, 500U);
+
+    // Assert: a full covariance, X and Y move together, Z is quiet
+    TEST_ASSERT_TRUE(f.Moment[1] > 0.8f * f.Moment[0]);
+    TEST_ASSERT_TRUE(f.Moment[5] < 0.01f * f.Moment[0]);
+}
+
+void test_vibration_settles_after_it_stops(void)
+{
+    // Arrange
+    vib_g = 0.5f;
+    vib_hz = 23.0f;
+    Feed(0.0f, 0.0f, 500U, 500U);
+
+    // Act: quiet for 10 windows
+    vib_g = 0.0f;
+    Feed(0.0f, 0.0f, 1000U, 1000U);
+
+    // Assert
+    TEST_ASSERT_TRUE(FUSION_Vibration(&f) < 0.01f);
+}
+
+/* ============================================================================ */
+/* NUMERICAL TESTS */
+/* ============================================================================ */
+
+void test_covariance_stays_positive_definite(void)
+{
+    const float *p = f.P;
+    float det;
+
+    // Arrange
+    vib_g = 0.8f;
+    vib_hz = 31.0f;
+    vib_dir[0] = 0.6f;
+    vib_dir[2] = 0.8f;
+
+    // Act: an hour at 100 Hz, tilted
+    Feed(-60.0f, 35.0f, 360000U, 359000U);
+
+    // Assert
+    det = p[0] * (p[3] * p[5] - p[4] * p[4]) - p[1] * (p[1] * p[5] - p[4] * p[2]) +
+          p[2] * (p[1] * p[4] - p[3] * p[2]);
+    TEST_ASSERT_TRUE(p[0] > 0.0f);
+    TEST_ASSERT_TRUE(p[3] > 0.0f);
+    TEST_ASSERT_TRUE(p[5] > 0.0f);
+    TEST_ASSERT_TRUE(det > 0.0f);
+    TEST_ASSERT_TRUE(p[0] < FUSION_P0);
+    TEST_ASSERT_TRUE(worst < 6.0f);
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    // Geometry Tests
+    RUN_TEST(test_tilt_of_level);
+    RUN_TEST(test_tilt_of_axes);
+
+    // Convergence Tests
+    RUN_TEST(test_first_sample_initialises_state);
+    RUN_TEST(test_converges_level);
+    RUN_TEST(test_converges_to_static_tilt);
+    RUN_TEST(test_follows_tilt_step);
+    RUN_TEST(test_tracks_rotation);
+
+    // Vibration Tests
+    RUN_TEST(test_vibration_at_rest_is_sensor_noise);
+    RUN_TEST(test_vibration_rms_measured);
+    RUN_TEST(test_tilt_steady_under_vibration);
+    RUN_TEST(test_vibration_learns_its_axis);
+    RUN_TEST(test_vibration_settles_after_it_stops);
+
+    // Numerical Tests
+    RUN_TEST(test_covariance_stays_positive_definite);
+
+    return UNITY_END();
+}
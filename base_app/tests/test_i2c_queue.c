@@ -0,0 +1,784 @@
+/**
+  ******************************************************************************
+  * @file    test_i2c_queue.c
+  * @author  Test Framework
+  * @brief   Unit tests for the queued I2C transaction engine
+  ******************************************************************************
+  * The engine runs against a scripted bus simulator that stands in for I2C1:
+  * port operations are answered by register-file devices, their events are
+  * queued and delivered by SimRun() the way the interrupt handlers would, and
+  * a fault script turns chosen bus operations into NACKs, bus errors or a
+  * hung bus. Every bus operation is logged so tests can check the exact
+  * sequence on the wire:
+  *
+  *   S / Sr   START / repeated START     94A   byte sent and ACKed
+  *   P        STOP                       40 N  byte sent and NACKed
+  *   R        peripheral reset/recovery  <12>  byte read from the slave
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "i2c_queue.h"
+#include <stdio.h>
+
+#define SIM_MAX_DEVICES    2U
+#define SIM_MAX_EVENTS     16U
+#define SIM_MAX_FAULTS     4U
+#define SIM_LOG_SIZE       512U
+
+#define CODEC_ADDR         0x94U
+#define SENSOR_ADDR        0x32U
+#define ABSENT_ADDR        0x40U
+
+typedef enum
+{
+    FAULT_NONE = 0,
+    FAULT_NACK,         /* Operation is answered with AF                  */
+    FAULT_BUS_ERROR,    /* Operation is answered with BERR                */
+    FAULT_HANG          /* Operation never completes                      */
+} SimFaultTypeDef;
+
+typedef struct
+{
+    uint8_t Addr;
+    uint8_t Regs[256];
+} SimDeviceTypeDef;
+
+typedef struct
+{
+    uint32_t        Op;     /* Bus operation number (Start, address, byte) */
+    SimFaultTypeDef Kind;
+} SimFaultEntryTypeDef;
+
+static struct
+{
+    SimDeviceTypeDef     Dev[SIM_MAX_DEVICES];
+    SimDeviceTypeDef    *Selected;
+    uint8_t              Pointer;
+    uint8_t              PointerSet;
+    uint8_t              InFrame;       /* START seen, no STOP yet         */
+    uint8_t             *RxData;
+    uint16_t             RxLen;
+    I2CQ_EventTypeDef    Events[SIM_MAX_EVENTS];
+    uint32_t             EventCount;
+    uint8_t              Kicked;
+    uint32_t             Ops;
+    SimFaultEntryTypeDef Faults[SIM_MAX_FAULTS];
+    uint32_t             Recovers;
+    uint32_t             Locks;
+    char                 Log[SIM_LOG_SIZE];
+} sim;
+
+static I2CQ_HandleTypeDef q;
+
+static I2CQ_XferTypeDef *done[32];
+static uint32_t          done_count;
+
+static I2CQ_XferTypeDef  pulse_writes[2];
+static uint8_t           pulse_values[2];
+
+/* ============================================================================ */
+/* BUS SIMULATOR */
+/* ============================================================================ */
+
+static void SimLog(const char *text)
+{
+    size_t used = strlen(sim.Log);
+
+    snprintf(sim.Log + used, SIM_LOG_SIZE - used, "%s%s", (used != 0U) ? " " : "", text);
+}
+
+static void SimPush(I2CQ_EventTypeDef event)
+{
+    TEST_ASSERT_TRUE(sim.EventCount < SIM_MAX_EVENTS);
+    sim.Events[sim.EventCount++] = event;
+}
+
+/**
+  * @brief  Count a bus operation and look it up in the fault script.
+  * @retval Fault to apply, FAULT_NONE for a healthy bus
+  */
+static SimFaultTypeDef SimNextOp(void)
+{
+    uint32_t op = sim.Ops++;
+    uint32_t i;
+
+    for (i = 0; i < SIM_MAX_FAULTS; i++)
+    {
+        if ((sim.Faults[i].Kind != FAULT_NONE) && (sim.Faults[i].Op == op))
+        {
+            return sim.Faults[i].Kind;
+        }
+    }
+    return FAULT_NONE;
+}
+
+/**
+  * @brief  Report an injected fault the way the error interrupt would.
+  * @retval 1 if the operation was faulted
+  */
+static int SimFault(SimFaultTypeDef fault)
+{
+    switch (fault)
+    {
+        case FAULT_NACK:
+            SimLog("N");
+            SimPush(I2CQ_EV_NACK);
+            return 1;
+        case FAULT_BUS_ERROR:
+            SimLog("BERR");
+            SimPush(I2CQ_EV_BUS_ERROR);
+            return 1;
+        case FAULT_HANG:
+            SimLog("HANG");
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void SimStart(void)
+{
+    SimFaultTypeDef fault = SimNextOp();
+
+    SimLog(sim.InFrame ? "Sr" : "S");
+    sim.InFrame = 1U;
+    if (!SimFault(fault))
+    {
+        SimPush(I2CQ_EV_START);
+    }
+}
+
+static void SimSendAddress(uint8_t addr)
+{
+    SimFaultTypeDef fault = SimNextOp();
+    char text[8];
+    uint32_t i;
+    uint16_t n;
+
+    sim.Selected = NULL;
+    for (i = 0; i < SIM_MAX_DEVICES; i++)
+    {
+        if (sim.Dev[i].Addr == (addr & 0xFEU))
+        {
+            sim.Selected = &sim.Dev[i];
+        }
+    }
+    if ((sim.Selected == NULL) && (fault == FAULT_NONE))
+    {
+        fault = FAULT_NACK;
+    }
+
+    snprintf(text, sizeof(text), "%02X%s", addr, (fault == FAULT_NONE) ? "A" : "");
+    SimLog(text);
+    if (SimFault(fault))
+    {
+        return;
+    }
+
+    if ((addr & 0x01U) == 0U)
+    {
+        sim.PointerSet = 0U;
+        SimPush(I2CQ_EV_ADDR_ACK);
+        return;
+    }
+
+    /* Read: the port DMAs RxLen bytes, NACKs the last one and sends STOP */
+    TEST_ASSERT_NOT_NULL(sim.RxData);
+    for (n = 0; n < sim.RxLen; n++)
+    {
+        sim.RxData[n] = sim.Selected->Regs[sim.Pointer++];
+        snprintf(text, sizeof(text), "<%02X>", sim.RxData[n]);
+        SimLog(text);
+    }
+    sim.RxData = NULL;
+    SimLog("P");
+    sim.InFrame = 0U;
+    SimPush(I2CQ_EV_RX_DONE);
+}
+
+static void SimWriteByte(uint8_t value)
+{
+    SimFaultTypeDef fault = SimNextOp();
+    char text[8];
+
+    snprintf(text, sizeof(text), "%02X%s", value, (fault == FAULT_NONE) ? "A" : "");
+    SimLog(text);
+    if (SimFault(fault))
+    {
+        return;
+    }
+
+    TEST_ASSERT_NOT_NULL(sim.Selected);
+    if (!sim.PointerSet)
+    {
+        sim.Pointer = value;
+        sim.PointerSet = 1U;
+    }
+    else
+    {
+        sim.Selected->Regs[sim.Pointer++] = value;
+    }
+    SimPush(I2CQ_EV_TX_DONE);
+}
+
+static void SimPrepareRead(uint8_t *data, uint16_t len)
+{
+    sim.RxData = data;
+    sim.RxLen = len;
+}
+
+static void SimStop(void)
+{
+    SimLog("P");
+    sim.InFrame = 0U;
+}
+
+static void SimRecover(void)
+{
+    SimLog("R");
+    sim.Recovers++;
+    sim.InFrame = 0U;
+    sim.RxData = NULL;
+    /* A reset peripheral forgets whatever it was about to report */
+    sim.EventCount = 0U;
+}
+
+static void SimKick(void)
+{
+    sim.Kicked = 1U;
+}
+
+static uint32_t SimLock(void)
+{
+    sim.Locks++;
+    return 0x5AU;
+}
+
+static void SimUnlock(uint32_t state)
+{
+    TEST_ASSERT_EQUAL_HEX32(0x5AU, state);
+    TEST_ASSERT_TRUE(sim.Locks > 0U);
+    sim.Locks--;
+}
+
+static const I2CQ_PortTypeDef sim_port =
+{
+    SimStart,
+    SimSendAddress,
+    SimWriteByte,
+    SimPrepareRead,
+    SimStop,
+    SimRecover,
+    SimKick,
+    SimLock,
+    SimUnlock
+};
+
+/**
+  * @brief  Deliver queued events and kicks until the bus goes quiet, like
+  *         the event interrupt firing back to back.
+  */
+static void SimRun(void)
+{
+    uint32_t guard = 0;
+    I2CQ_EventTypeDef event;
+
+    while (((sim.EventCount != 0U) || sim.Kicked) && (guard++ < 1000U))
+    {
+        if (sim.EventCount != 0U)
+        {
+            event = sim.Events[0];
+            memmove(&sim.Events[0], &sim.Events[1], (sim.EventCount - 1U) * sizeof(sim.Events[0]));
+            sim.EventCount--;
+            I2CQ_Event(&q, event);
+        }
+        sim.Kicked = 0U;
+        I2CQ_Service(&q);
+    }
+    TEST_ASSERT_TRUE(guard < 1000U);
+}
+
+static void SimFaultAt(uint32_t op, SimFaultTypeDef kind)
+{
+    uint32_t i;
+
+    for (i = 0; i < SIM_MAX_FAULTS; i++)
+    {
+        if (sim.Faults[i].Kind == FAULT_NONE)
+        {
+            sim.Faults[i].Op = op;
+            sim.Faults[i].Kind = kind;
+            return;
+        }
+    }
+    TEST_FAIL_MESSAGE("fault script full");
+}
+
+static void RecordDone(I2CQ_XferTypeDef *xfer)
+{
+    if (done_count < 32U)
+    {
+        done[done_count] = xfer;
+    }
+    done_count++;
+}
+
+static void SetWrite(I2CQ_XferTypeDef *x, uint8_t dev, uint8_t reg, uint8_t *data, uint16_t len)
+{
+    I2CQ_SetWrite(x, dev, reg, data, len);
+    x->Callback = RecordDone;
+}
+
+static void SetRead(I2CQ_XferTypeDef *x, uint8_t dev, uint8_t reg, uint8_t *data, uint16_t len)
+{
+    I2CQ_SetRead(x, dev, reg, data, len);
+    x->Callback = RecordDone;
+}
+
+/**
+  * @brief  Completion callback that queues a dependent batch from bus context
+  */
+static void PulseBit7(I2CQ_XferTypeDef *xfer)
+{
+    pulse_values[0] = (uint8_t)(*xfer->Data | 0x80U);
+    pulse_values[1] = (uint8_t)(*xfer->Data & 0x7FU);
+    SetWrite(&pulse_writes[0], CODEC_ADDR, 0x32, &pulse_values[0], 1);
+    SetWrite(&pulse_writes[1], CODEC_ADDR, 0x32, &pulse_values[1], 1);
+    TEST_ASSERT_EQUAL(I2CQ_OK, I2CQ_Submit(&q, pulse_writes, 2));
+}
+
+/* ============================================================================ */
+/* TEST SETUP AND TEARDOWN */
+/* ============================================================================ */
+
+void setUp(void)
+{
+    memset(&sim, 0, sizeof(sim));
+    sim.Dev[0].Addr = CODEC_ADDR;
+    sim.Dev[1].Addr = SENSOR_ADDR;
+    memset(done, 0, sizeof(done));
+    done_count = 0;
+    I2CQ_Init(&q, &sim_port);
+}
+
+void tearDown(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(0, sim.Locks);
+}
+
+/* ============================================================================ */
+/* TRANSACTION TESTS */
+/* ============================================================================ */
+
+void test_write_single_register(void)
+{
+    // Arrange
+    I2CQ_XferTypeDef x;
+    uint8_t value = 0x9E;
+    SetWrite(&x, CODEC_ADDR, 0x02, &value, 1);
+
+    // Act
+    TEST_ASSERT_EQUAL(I2CQ_OK, I2CQ_Submit(&q, &x, 1));
+    TEST_ASSERT_EQUAL(I2CQ_PENDING, x.Status);
+    SimRun();
+
+    // Assert
+    TEST_ASSERT_EQUAL_STRING("S 94A 02A 9EA P", sim.Log);
+    TEST_ASSERT_EQUAL(I2CQ_OK, x.Status);
+    TEST_ASSERT_EQUAL_HEX32(0x9E, sim.Dev[0].Regs[0x02]);
+    TEST_ASSERT_EQUAL_UINT32(1, done_count);
+    TEST_ASSERT_EQUAL_UINT32(0, I2CQ_Pending(&q));
+}
+
+void test_write_without_data_only_sets_pointer(void)
+{
+    // Arrange
+    I2CQ_XferTypeDef x;
+    SetWrite(&x, SENSOR_ADDR, 0x0F, NULL, 0);
+
+    // Act
+    I2CQ_Submit(&q, &x, 1);
+    SimRun();
+
+    // Assert
+    TEST_ASSERT_EQUAL_STRING("S 32A 0FA P", sim.Log);
+    TEST_ASSERT_EQUAL(I2CQ_OK, x.Status);
+}
+
+void test_read_uses_repeated_start(void)
+{
+    // Arrange
+    I2CQ_XferTypeDef x;
+    uint8_t data[3] = {0};
+    sim.Dev[1].Regs[0x28] = 0x12;
+    sim.Dev[1].Regs[0x29] = 0x34;
+    sim.Dev[1].Regs[0x2A] = 0x56;
+    SetRead(&x, SENSOR_ADDR, 0x28, data, 3);
+
+    // Act
+    I2CQ_Submit(&q, &x, 1);
+    SimRun();
+
+    // Assert
+    TEST_ASSERT_EQUAL_STRING("S 32A 28A Sr 33A <12> <34> <56> P", sim.Log);
+    TEST_ASSERT_EQUAL(I2CQ_OK, x.Status);
+    TEST_ASSERT_EQUAL_HEX32(0x12, data[0]);
+    TEST_ASSERT_EQUAL_HEX32(0x34, data[1]);
+    TEST_ASSERT_EQUAL_HEX32(0x56, data[2]);
+}
+
+void test_batch_runs_back_to_back_in_order(void)
+{
+    // Arrange
+    I2CQ_XferTypeDef batch[3];
+    uint8_t volume[2] = {0x18, 0x19};
+    uint8_t power = 0x9E;
+    uint8_t readback[2] = {0};
+    SetWrite(&batch[0], CODEC_ADDR, 0x20, volume, 2);
+    SetWrite(&batch[1], CODEC_ADDR, 0x02, &power, 1);
+    SetRead(&batch[2], CODEC_ADDR, 0x20, readback, 2);
+
+    // Act
+    TEST_ASSERT_EQUAL(I2CQ_OK, I2CQ_Submit(&q, batch, 3));
+    TEST_ASSERT_EQUAL_UINT32(3, I2CQ_Pending(&q));
+    SimRun();
+
+    // Assert
+    TEST_ASSERT_EQUAL_STRING("S 94A 20A 18A 19A P S 94A 02A 9EA P S 94A 20A Sr 95A <18> <19> P", sim.Log);
+    TEST_ASSERT_EQUAL_UINT32(3, done_count);
+    TEST_ASSERT_TRUE(done[0] == &batch[0]);
+    TEST_ASSERT_TRUE(done[1] == &batch[1]);
+    TEST_ASSERT_TRUE(done[2] == &batch[2]);
+    TEST_ASSERT_EQUAL_HEX32(0x19, readback[1]);
+    TEST_ASSERT_EQUAL_UINT32(3, q.Stats.Completed);
+    TEST_ASSERT_EQUAL_UINT32(3, q.Stats.MaxQueued);
+}
+
+void test_submit_never_touches_the_bus_directly(void)
+{
+    // Arrange
+    I2CQ_XferTypeDef x;
+    uint8_t value = 1;
+    SetWrite(&x, CODEC_ADDR, 0x02, &value, 1);
+
+    // Act
+    I2CQ_Submit(&q, &x, 1);
+
+    // Assert: only the kick, the transfer starts in bus context
+    TEST_ASSERT_EQUAL_STRING("", sim.Log);
+    TEST_ASSERT_TRUE(sim.Kicked);
+    TEST_ASSERT_EQUAL(I2CQ_PENDING, x.Status);
+}
+
+void test_callback_can_chain_a_dependent_batch(void)
+{
+    // Arrange: read-modify-write of bit 7, the way the codec bring-up does it
+    I2CQ_XferTypeDef read;
+    uint8_t reg = 0;
+    sim.Dev[0].Regs[0x32] = 0x3B;
+    SetRead(&read, CODEC_ADDR, 0x32, &reg, 1);
+    read.Callback = PulseBit7;
+
+    // Act
+    I2CQ_Submit(&q, &read, 1);
+    SimRun();
+
+    // Assert
+    TEST_ASSERT_EQUAL_STRING("S 94A 32A Sr 95A <3B> P S 94A 32A BBA P S 94A 32A 3BA P", sim.Log);
+    TEST_ASSERT_EQUAL_UINT32(2, done_count);
+    TEST_ASSERT_TRUE(done[1] == &pulse_writes[1]);
+    TEST_ASSERT_EQUAL_HEX32(0x3B, sim.Dev[0].Regs[0x32]);
+}
+
+/* ============================================================================ */
+/* SUBMIT TESTS */
+/* ============================================================================ */
+
+void test_submit_rejects_malformed_descriptors(void)
+{
+    // Arrange
+    I2CQ_XferTypeDef x;
+    uint8_t value = 0;
+
+    // Act & Assert
+    SetRead(&x, CODEC_ADDR, 0x01, &value, 0);
+    TEST_ASSERT_EQUAL(I2CQ_INVALID, I2CQ_Submit(&q, &x, 1));
+    SetWrite(&x, CODEC_ADDR, 0x01, NULL, 2);
+    TEST_ASSERT_EQUAL(I2CQ_INVALID, I2CQ_Submit(&q, &x, 1));
+    SetWrite(&x, CODEC_ADDR, 0x01, &value, 1);
+    x.Dir = 7;
+    TEST_ASSERT_EQUAL(I2CQ_INVALID, I2CQ_Submit(&q, &x, 1));
+    TEST_ASSERT_EQUAL_UINT32(0, I2CQ_Pending(&q));
+}
+
+void test_submit_rejects_descriptor_already_queued(void)
+{
+    // Arrange
+    I2CQ_XferTypeDef x;
+    uint8_t value = 0;
+    SetWrite(&x, CODEC_ADDR, 0x01, &value, 1);
+    TEST_ASSERT_EQUAL(I2CQ_OK, I2CQ_Submit(&q, &x, 1));
+
+    // Act & Assert
+    TEST_ASSERT_EQUAL(I2CQ_INVALID, I2CQ_Submit(&q, &x, 1));
+    TEST_ASSERT_EQUAL_UINT32(1, I2CQ_Pending(&q));
+}
+
+void test_batch_is_queued_whole_or_not_at_all(void)
+{
+    // Arrange: leave one free slot
+    I2CQ_XferTypeDef fill[I2CQ_DEPTH];
+    I2CQ_XferTypeDef batch[2];
+    uint8_t value = 0;
+    uint32_t i;
+    for (i = 0; i < I2CQ_DEPTH - 1U; i++)
+    {
+        SetWrite(&fill[i], CODEC_ADDR, (uint8_t)i, &value, 1);
+        TEST_ASSERT_EQUAL(I2CQ_OK, I2CQ_Submit(&q, &fill[i], 1));
+    }
+    SetWrite(&batch[0], SENSOR_ADDR, 0x20, &value, 1);
+    SetWrite(&batch[1], SENSOR_ADDR, 0x21, &value, 1);
+
+    // Act
+    I2CQ_StatusTypeDef status = I2CQ_Submit(&q, batch, 2);
+
+    // Assert
+    TEST_ASSERT_EQUAL(I2CQ_FULL, status);
+    TEST_ASSERT_EQUAL(I2CQ_OK, batch[0].Status);
+    TEST_ASSERT_EQUAL(I2CQ_OK, batch[1].Status);
+    TEST_ASSERT_EQUAL_UINT32(I2CQ_DEPTH - 1U, I2CQ_Pending(&q));
+
+    // Once the queue drains the same batch goes through
+    SimRun();
+    TEST_ASSERT_EQUAL(I2CQ_OK, I2CQ_Submit(&q, batch, 2));
+    SimRun();
+    TEST_ASSERT_EQUAL_UINT32(I2CQ_DEPTH + 1U, done_count);
+}
+
+/* ============================================================================ */
+/* ERROR RECOVERY TESTS */
+/* ============================================================================ */
+
+void test_absent_device_nacks_and_queue_moves_on(void)
+{
+    // Arrange
+    I2CQ_XferTypeDef batch[2];
+    uint8_t value = 0x55;
+    uint8_t data = 0;
+    sim.Dev[1].Regs[0x0F] = 0x33;
+    SetWrite(&batch[0], ABSENT_ADDR, 0x00, &value, 1);
+    SetRead(&batch[1], SENSOR_ADDR, 0x0F, &data, 1);
+
+    // Act
+    I2CQ_Submit(&q, batch, 2);
+    SimRun();
+
+    // Assert
+    TEST_ASSERT_EQUAL_STRING("S 40 N P S 32A 0FA Sr 33A <33> P", sim.Log);
+    TEST_ASSERT_EQUAL(I2CQ_NACK, batch[0].Status);
+    TEST_ASSERT_EQUAL(I2CQ_OK, batch[1].Status);
+    TEST_ASSERT_EQUAL_HEX32(0x33, data);
+    TEST_ASSERT_EQUAL_UINT32(1, q.Stats.Nacks);
+    TEST_ASSERT_EQUAL_UINT32(1, q.Stats.Failed);
+    TEST_ASSERT_EQUAL_UINT32(0, sim.Recovers);
+}
+
+void test_data_nack_is_retried(void)
+{
+    // Arrange: ops are S(0) addr(1) reg(2) data(3)
+    I2CQ_XferTypeDef x;
+    uint8_t value = 0xAF;
+    SetWrite(&x, CODEC_ADDR, 0x04, &value, 1);
+    x.Retries = 1;
+    SimFaultAt(3, FAULT_NACK);
+
+    // Act
+    I2CQ_Submit(&q, &x, 1);
+    SimRun();
+
+    // Assert
+    TEST_ASSERT_EQUAL_STRING("S 94A 04A AF N P S 94A 04A AFA P", sim.Log);
+    TEST_ASSERT_EQUAL(I2CQ_OK, x.Status);
+    TEST_ASSERT_EQUAL_UINT32(1, q.Stats.Retries);
+    TEST_ASSERT_EQUAL_UINT32(1, q.Stats.Nacks);
+    TEST_ASSERT_EQUAL_UINT32(1, done_count);
+}
+
+void test_retries_are_bounded(void)
+{
+    // Arrange
+    I2CQ_XferTypeDef x;
+    uint8_t value = 0;
+    SetWrite(&x, ABSENT_ADDR, 0x00, &value, 1);
+    x.Retries = 2;
+
+    // Act
+    I2CQ_Submit(&q, &x, 1);
+    SimRun();
+
+    // Assert
+    TEST_ASSERT_EQUAL_STRING("S 40 N P S 40 N P S 40 N P", sim.Log);
+    TEST_ASSERT_EQUAL(I2CQ_NACK, x.Status);
+    TEST_ASSERT_EQUAL_UINT32(2, q.Stats.Retries);
+    TEST_ASSERT_EQUAL_UINT32(1, done_count);
+}
+
+void test_bus_error_resets_peripheral_and_continues(void)
+{
+    // Arrange
+    I2CQ_XferTypeDef batch[2];
+    uint8_t a = 1;
+    uint8_t b = 2;
+    SetWrite(&batch[0], CODEC_ADDR, 0x10, &a, 1);
+    SetWrite(&batch[1], CODEC_ADDR, 0x11, &b, 1);
+    SimFaultAt(2, FAULT_BUS_ERROR);
+
+    // Act
+    I2CQ_Submit(&q, batch, 2);
+    SimRun();
+
+    // Assert
+    TEST_ASSERT_EQUAL_STRING("S 94A 10 BERR R S 94A 11A 02A P", sim.Log);
+    TEST_ASSERT_EQUAL(I2CQ_BUS_ERROR, batch[0].Status);
+    TEST_ASSERT_EQUAL(I2CQ_OK, batch[1].Status);
+    TEST_ASSERT_EQUAL_UINT32(1, sim.Recovers);
+    TEST_ASSERT_EQUAL_UINT32(1, q.Stats.BusErrors);
+    TEST_ASSERT_EQUAL_UINT32(1, q.Stats.Recoveries);
+}
+
+void test_out_of_sequence_event_counts_as_bus_error(void)
+{
+    // Arrange
+    I2CQ_XferTypeDef x;
+    uint8_t value = 0;
+    SetWrite(&x, CODEC_ADDR, 0x02, &value, 1);
+    I2CQ_Submit(&q, &x, 1);
+    I2CQ_Service(&q);
+
+    // Act: START requested, a receive completion is nonsense here
+    sim.EventCount = 0;
+    I2CQ_Event(&q, I2CQ_EV_RX_DONE);
+
+    // Assert
+    TEST_ASSERT_EQUAL(I2CQ_BUS_ERROR, x.Status);
+    TEST_ASSERT_EQUAL_UINT32(1, sim.Recovers);
+    TEST_ASSERT_EQUAL_UINT32(0, I2CQ_Pending(&q));
+}
+
+void test_hung_bus_times_out_and_recovers(void)
+{
+    // Arrange
+    I2CQ_XferTypeDef batch[2];
+    uint8_t value = 0x81;
+    uint8_t id = 0;
+    uint32_t t;
+    sim.Dev[0].Regs[0x01] = 0xE3;
+    SetWrite(&batch[0], CODEC_ADDR, 0x05, &value, 1);
+    SetRead(&batch[1], CODEC_ADDR, 0x01, &id, 1);
+    SimFaultAt(2, FAULT_HANG);
+    I2CQ_Submit(&q, batch, 2);
+    SimRun();
+    TEST_ASSERT_EQUAL(I2CQ_PENDING, batch[0].Status);
+
+    // Act: one tick short of the limit changes nothing
+    for (t = 0; t < I2CQ_TIMEOUT_TICKS - 1U; t++)
+    {
+        I2CQ_Tick(&q);
+        SimRun();
+    }
+    TEST_ASSERT_EQUAL(I2CQ_PENDING, batch[0].Status);
+    I2CQ_Tick(&q);
+    SimRun();
+
+    // Assert
+    TEST_ASSERT_EQUAL_STRING("S 94A 05 HANG R S 94A 01A Sr 95A <E3> P", sim.Log);
+    TEST_ASSERT_EQUAL(I2CQ_TIMEOUT, batch[0].Status);
+    TEST_ASSERT_EQUAL(I2CQ_OK, batch[1].Status);
+    TEST_ASSERT_EQUAL_HEX32(0xE3, id);
+    TEST_ASSERT_EQUAL_UINT32(1, q.Stats.Timeouts);
+}
+
+void test_timeout_budget_is_per_transaction(void)
+{
+    // Arrange: many short transactions while the clock keeps ticking
+    I2CQ_XferTypeDef x;
+    uint8_t value = 0;
+    uint32_t t;
+
+    // Act
+    for (t = 0; t < 3U * I2CQ_TIMEOUT_TICKS; t++)
+    {
+        SetWrite(&x, CODEC_ADDR, 0x00, &value, 1);
+        I2CQ_Submit(&q, &x, 1);
+        I2CQ_Service(&q);
+        I2CQ_Tick(&q);
+        SimRun();
+        TEST_ASSERT_EQUAL(I2CQ_OK, x.Status);
+    }
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(0, q.Stats.Timeouts);
+    TEST_ASSERT_EQUAL_UINT32(0, sim.Recovers);
+}
+
+void test_late_event_after_timeout_is_ignored(void)
+{
+    // Arrange
+    I2CQ_XferTypeDef x;
+    uint8_t value = 0;
+    uint32_t t;
+    SetWrite(&x, CODEC_ADDR, 0x00, &value, 1);
+    SimFaultAt(0, FAULT_HANG);
+    I2CQ_Submit(&q, &x, 1);
+    SimRun();
+    for (t = 0; t < I2CQ_TIMEOUT_TICKS; t++)
+    {
+        I2CQ_Tick(&q);
+    }
+    SimRun();
+    TEST_ASSERT_EQUAL(I2CQ_TIMEOUT, x.Status);
+
+    // Act
+    I2CQ_Event(&q, I2CQ_EV_START);
+    I2CQ_Event(&q, I2CQ_EV_TX_DONE);
+
+    // Assert
+    TEST_ASSERT_EQUAL_STRING("S HANG R", sim.Log);
+    TEST_ASSERT_EQUAL_UINT32(1, done_count);
+    TEST_ASSERT_EQUAL_UINT32(0, q.Stats.BusErrors);
+}
+
+/* ============================================================================ */
+/* MAIN TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Transaction Tests */
+    RUN_TEST(test_write_single_register);
+    RUN_TEST(test_write_without_data_only_sets_pointer);
+    RUN_TEST(test_read_uses_repeated_start);
+    RUN_TEST(test_batch_runs_back_to_back_in_order);
+    RUN_TEST(test_submit_never_touches_the_bus_directly);
+    RUN_TEST(test_callback_can_chain_a_dependent_batch);
+
+    /* Submit Tests */
+    RUN_TEST(test_submit_rejects_malformed_descriptors);
+    RUN_TEST(test_submit_rejects_descriptor_already_queued);
+    RUN_TEST(test_batch_is_queued_whole_or_not_at_all);
+
+    /* Error Recovery Tests */
+    RUN_TEST(test_absent_device_nacks_and_queue_moves_on);
+    RUN_TEST(test_data_nack_is_retried);
+    RUN_TEST(test_retries_are_bounded);
+    RUN_TEST(test_bus_error_resets_peripheral_and_continues);
+    RUN_TEST(test_out_of_sequence_event_counts_as_bus_error);
+    RUN_TEST(test_hung_bus_times_out_and_recovers);
+    RUN_TEST(test_timeout_budget_is_per_transaction);
+    RUN_TEST(test_late_event_after_timeout_is_ignored);
+
+    return UNITY_END();
+}
@@ -0,0 +1,493 @@
+/**
+  ******************************************************************************
+  * @file    test_kernel.c
+  * @author  Test Framework
+  * @brief   Unit tests for the kernel scheduler, semaphores and mutexes
+  ******************************************************************************
+  * The stub port only counts switch requests; Run() plays PendSV by calling
+  * KERNEL_Switch() when one is pending. Blocking calls return KERNEL_PENDING
+  * here, so a test makes a task block by letting it be the running one and
+  * reads the outcome from its WaitResult later.
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "kernel.h"
+#include <string.h>
+
+#define STACK_WORDS    KERNEL_STACK_MIN
+
+static KERNEL_TaskTypeDef tasks[KERNEL_MAX_TASKS + 1U];
+static uint32_t           stacks[KERNEL_MAX_TASKS + 1U][STACK_WORDS] __attribute__((aligned(8)));
+static uint32_t           switch_requests;
+static int32_t            lock_depth;
+
+/* ============================================================================ */
+/* STUB PORT */
+/* ============================================================================ */
+
+static void StubSwitch(void)
+{
+    switch_requests++;
+}
+
+static void StubExit(void)
+{
+}
+
+static uint32_t StubLock(void)
+{
+    return (uint32_t)lock_depth++;
+}
+
+static void StubUnlock(uint32_t state)
+{
+    lock_depth = (int32_t)state;
+}
+
+static const KERNEL_PortTypeDef port = { StubSwitch, StubExit, StubLock, StubUnlock };
+
+/* ============================================================================ */
+/* HELPERS */
+/* ============================================================================ */
+
+static void Entry(void *argument)
+{
+    (void)argument;
+}
+
+static KERNEL_TaskTypeDef *Create(uint32_t index, uint32_t priority)
+{
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_TaskCreate(&tasks[index], "task", Entry, NULL, priority,
+                                                   stacks[index], STACK_WORDS));
+    return &tasks[index];
+}
+
+/* Take a pending switch the way PendSV would; returns the running task */
+static KERNEL_TaskTypeDef *Run(void)
+{
+    TEST_ASSERT_EQUAL_INT32(0, lock_depth);
+    if (switch_requests != 0U)
+    {
+        switch_requests = 0U;
+        (void)KERNEL_Switch(KERNEL_Current()->Sp);
+    }
+    return KERNEL_Current();
+}
+
+static void Ticks(uint32_t count)
+{
+    while (count-- != 0U)
+    {
+        KERNEL_Tick();
+    }
+}
+
+/* ============================================================================ */
+/* TEST SETUP AND TEARDOWN */
+/* ============================================================================ */
+
+void setUp(void)
+{
+    memset(tasks, 0, sizeof(tasks));
+    memset(stacks, 0, sizeof(stacks));
+    switch_requests = 0U;
+    lock_depth = 0;
+    KERNEL_Init(&port);
+}
+
+void tearDown(void)
+{
+    TEST_ASSERT_EQUAL_INT32(0, lock_depth);
+}
+
+/* ============================================================================ */
+/* TASK TESTS */
+/* ============================================================================ */
+
+void test_create_builds_initial_frame(void)
+{
+    // Arrange
+    int argument;
+
+    // Act
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_TaskCreate(&tasks[0], "frame", Entry, &argument, 3U,
+                                                   stacks[0], STACK_WORDS));
+
+    // Assert
+    uint32_t *sp = tasks[0].Sp;
+    TEST_ASSERT_EQUAL_UINT32(0U, ((uintptr_t)sp) & 7U);
+    TEST_ASSERT_TRUE(sp + KERNEL_FRAME_WORDS <= stacks[0] + STACK_WORDS);
+    TEST_ASSERT_EQUAL_HEX32(KERNEL_EXC_RETURN_TASK, sp[KERNEL_FRAME_EXC_RETURN]);
+    TEST_ASSERT_EQUAL_HEX32((uint32_t)(uintptr_t)&argument, sp[KERNEL_FRAME_R0]);
+    TEST_ASSERT_EQUAL_HEX32((uint32_t)(uintptr_t)StubExit, sp[KERNEL_FRAME_LR]);
+    TEST_ASSERT_EQUAL_HEX32((uint32_t)(uintptr_t)Entry & ~1U, sp[KERNEL_FRAME_PC]);
+    TEST_ASSERT_EQUAL_HEX32(KERNEL_XPSR_THUMB, sp[KERNEL_FRAME_XPSR]);
+    TEST_ASSERT_EQUAL_HEX32(KERNEL_STACK_FILL, stacks[0][0]);
+    TEST_ASSERT_EQUAL_UINT8(3U, tasks[0].Priority);
+    TEST_ASSERT_EQUAL_UINT8(KERNEL_TASK_READY, tasks[0].State);
+}
+
+void test_create_rejects_bad_arguments(void)
+{
+    uint32_t i;
+
+    TEST_ASSERT_EQUAL(KERNEL_INVALID, KERNEL_TaskCreate(&tasks[0], "t", Entry, NULL, KERNEL_PRIORITIES,
+                                                        stacks[0], STACK_WORDS));
+    TEST_ASSERT_EQUAL(KERNEL_INVALID, KERNEL_TaskCreate(&tasks[0], "t", Entry, NULL, 1U,
+                                                        stacks[0], KERNEL_STACK_MIN - 1U));
+    TEST_ASSERT_EQUAL(KERNEL_INVALID, KERNEL_TaskCreate(&tasks[0], "t", NULL, NULL, 1U,
+                                                        stacks[0], STACK_WORDS));
+
+    for (i = 0U; i < KERNEL_MAX_TASKS; i++)
+    {
+        (void)Create(i, 1U);
+    }
+    TEST_ASSERT_EQUAL(KERNEL_FULL, KERNEL_TaskCreate(&tasks[i], "t", Entry, NULL, 1U,
+                                                     stacks[i], STACK_WORDS));
+}
+
+void test_task_at_walks_creation_order(void)
+{
+    KERNEL_TaskTypeDef *first = Create(0, 5U);
+    KERNEL_TaskTypeDef *second = Create(1, 2U);
+
+    TEST_ASSERT_TRUE(first == KERNEL_TaskAt(0U));
+    TEST_ASSERT_TRUE(second == KERNEL_TaskAt(1U));
+    TEST_ASSERT_EQUAL_UINT8(1U, second->Id);
+    TEST_ASSERT_NULL(KERNEL_TaskAt(2U));
+}
+
+void test_start_picks_highest_priority(void)
+{
+    TEST_ASSERT_NULL(KERNEL_Start());
+
+    (void)Create(0, 5U);
+    KERNEL_TaskTypeDef *high = Create(1, 3U);
+    (void)Create(2, 7U);
+
+    TEST_ASSERT_TRUE(high == KERNEL_Start());
+    TEST_ASSERT_TRUE(high == KERNEL_Current());
+    TEST_ASSERT_EQUAL_UINT32(0U, switch_requests);
+}
+
+void test_bitmap_spans_all_priorities(void)
+{
+    // Arrange
+    KERNEL_TaskTypeDef *lowest = Create(0, KERNEL_PRIORITIES - 1U);
+    KERNEL_TaskTypeDef *highest = Create(1, 0U);
+    (void)KERNEL_Start();
+
+    // Act
+    TEST_ASSERT_TRUE(highest == KERNEL_Current());
+    KERNEL_Sleep(1U);
+
+    // Assert
+    TEST_ASSERT_TRUE(lowest == Run());
+    Ticks(1U);
+    TEST_ASSERT_TRUE(highest == Run());
+    TEST_ASSERT_EQUAL_UINT32(2U, KERNEL_Switches());
+}
+
+void test_higher_priority_task_preempts(void)
+{
+    KERNEL_TaskTypeDef *low = Create(0, 10U);
+    (void)KERNEL_Start();
+
+    (void)Create(1, 12U);
+    TEST_ASSERT_EQUAL_UINT32(0U, switch_requests);
+    KERNEL_TaskTypeDef *high = Create(2, 4U);
+    TEST_ASSERT_EQUAL_UINT32(1U, switch_requests);
+
+    TEST_ASSERT_TRUE(high == Run());
+    TEST_ASSERT_EQUAL_UINT32(1U, high->Runs);
+    TEST_ASSERT_EQUAL_UINT32(1U, low->Runs);
+}
+
+void test_yield_rotates_equal_priorities(void)
+{
+    KERNEL_TaskTypeDef *a = Create(0, 4U);
+    KERNEL_TaskTypeDef *b = Create(1, 4U);
+    KERNEL_TaskTypeDef *c = Create(2, 4U);
+    (void)Create(3, 9U);
+    TEST_ASSERT_TRUE(a == KERNEL_Start());
+
+    KERNEL_Yield();
+    TEST_ASSERT_TRUE(b == Run());
+    KERNEL_Yield();
+    TEST_ASSERT_TRUE(c == Run());
+    KERNEL_Sleep(0U);
+    TEST_ASSERT_TRUE(a == Run());
+}
+
+void test_yield_alone_keeps_running(void)
+{
+    KERNEL_TaskTypeDef *a = Create(0, 4U);
+    (void)Create(1, 5U);
+    (void)KERNEL_Start();
+
+    KERNEL_Yield();
+
+    TEST_ASSERT_EQUAL_UINT32(0U, switch_requests);
+    TEST_ASSERT_TRUE(a == Run());
+}
+
+void test_sleep_wakes_after_ticks(void)
+{
+    // Arrange
+    KERNEL_TaskTypeDef *sleeper = Create(0, 1U);
+    KERNEL_TaskTypeDef *other = Create(1, 2U);
+    (void)KERNEL_Start();
+
+    // Act
+    KERNEL_Sleep(3U);
+    TEST_ASSERT_TRUE(other == Run());
+    Ticks(2U);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT8(KERNEL_TASK_SLEEPING, sleeper->State);
+    TEST_ASSERT_TRUE(other == Run());
+    Ticks(1U);
+    TEST_ASSERT_TRUE(sleeper == Run());
+    TEST_ASSERT_EQUAL_UINT32(3U, KERNEL_Ticks());
+}
+
+void test_task_exit_switches_away(void)
+{
+    KERNEL_TaskTypeDef *dying = Create(0, 1U);
+    KERNEL_TaskTypeDef *other = Create(1, 2U);
+    (void)KERNEL_Start();
+
+    KERNEL_TaskExit();
+
+    TEST_ASSERT_EQUAL_UINT8(KERNEL_TASK_DEAD, dying->State);
+    TEST_ASSERT_TRUE(other == Run());
+    Ticks(5U);
+    TEST_ASSERT_TRUE(other == Run());
+}
+
+void test_stack_unused_counts_fill_words(void)
+{
+    KERNEL_TaskTypeDef *task = Create(0, 1U);
+    uint32_t unused = KERNEL_StackUnused(task);
+
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(task->Sp - stacks[0]), unused);
+    stacks[0][10] = 0U;
+    TEST_ASSERT_EQUAL_UINT32(10U, KERNEL_StackUnused(task));
+}
+
+/* ============================================================================ */
+/* SEMAPHORE TESTS */
+/* ============================================================================ */
+
+void test_sem_counts_up_to_max(void)
+{
+    KERNEL_SemTypeDef sem;
+    (void)Create(0, 1U);
+    (void)KERNEL_Start();
+    KERNEL_SemInit(&sem, 1U, 2U);
+
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_SemGive(&sem));
+    TEST_ASSERT_EQUAL(KERNEL_FULL, KERNEL_SemGive(&sem));
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_SemTake(&sem, 0U));
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_SemTake(&sem, KERNEL_FOREVER));
+    TEST_ASSERT_EQUAL(KERNEL_TIMEOUT, KERNEL_SemTake(&sem, 0U));
+    TEST_ASSERT_EQUAL_UINT32(0U, switch_requests);
+}
+
+void test_sem_wakes_highest_priority_waiter_first(void)
+{
+    // Arrange: each task blocks in turn as it becomes the running one
+    KERNEL_SemTypeDef sem;
+    KERNEL_TaskTypeDef *first = Create(0, 2U);
+    KERNEL_TaskTypeDef *second = Create(1, 2U);
+    KERNEL_TaskTypeDef *top = Create(2, 1U);
+    KERNEL_TaskTypeDef *giver = Create(3, 5U);
+    KERNEL_SemInit(&sem, 0U, 1U);
+    (void)KERNEL_Start();
+
+    TEST_ASSERT_EQUAL(KERNEL_PENDING, KERNEL_SemTake(&sem, KERNEL_FOREVER));
+    TEST_ASSERT_TRUE(first == Run());
+    TEST_ASSERT_EQUAL(KERNEL_PENDING, KERNEL_SemTake(&sem, KERNEL_FOREVER));
+    TEST_ASSERT_TRUE(second == Run());
+    TEST_ASSERT_EQUAL(KERNEL_PENDING, KERNEL_SemTake(&sem, KERNEL_FOREVER));
+    TEST_ASSERT_TRUE(giver == Run());
+
+    // Act / Assert
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_SemGive(&sem));
+    TEST_ASSERT_TRUE(top == Run());
+    TEST_ASSERT_EQUAL_UINT8(KERNEL_OK, top->WaitResult);
+    TEST_ASSERT_TRUE(first == sem.Waiters.Head);
+    TEST_ASSERT_TRUE(second == first->Next);
+    TEST_ASSERT_EQUAL_UINT32(0U, sem.Count);
+}
+
+void test_sem_take_times_out(void)
+{
+    KERNEL_SemTypeDef sem;
+    KERNEL_TaskTypeDef *waiter = Create(0, 1U);
+    KERNEL_TaskTypeDef *other = Create(1, 2U);
+    KERNEL_SemInit(&sem, 0U, 1U);
+    (void)KERNEL_Start();
+
+    TEST_ASSERT_EQUAL(KERNEL_PENDING, KERNEL_SemTake(&sem, 5U));
+    TEST_ASSERT_TRUE(other == Run());
+    Ticks(4U);
+    TEST_ASSERT_TRUE(other == Run());
+    Ticks(1U);
+
+    TEST_ASSERT_TRUE(waiter == Run());
+    TEST_ASSERT_EQUAL_UINT8(KERNEL_TIMEOUT, waiter->WaitResult);
+    TEST_ASSERT_NULL(sem.Waiters.Head);
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_SemGive(&sem));
+    TEST_ASSERT_EQUAL_UINT32(1U, sem.Count);
+}
+
+/* ============================================================================ */
+/* MUTEX TESTS */
+/* ============================================================================ */
+
+void test_mutex_rejects_misuse(void)
+{
+    KERNEL_MutexTypeDef mutex;
+    (void)Create(0, 1U);
+    (void)KERNEL_Start();
+    KERNEL_MutexInit(&mutex);
+
+    TEST_ASSERT_EQUAL(KERNEL_INVALID, KERNEL_MutexUnlock(&mutex));
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_MutexLock(&mutex, 0U));
+    TEST_ASSERT_EQUAL(KERNEL_INVALID, KERNEL_MutexLock(&mutex, KERNEL_FOREVER));
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_MutexUnlock(&mutex));
+    TEST_ASSERT_NULL(mutex.Owner);
+}
+
+void test_mutex_inherits_and_hands_over(void)
+{
+    // Arrange: low takes the mutex, then high wakes up and wants it
+    KERNEL_MutexTypeDef mutex;
+    KERNEL_TaskTypeDef *low = Create(0, 10U);
+    KERNEL_TaskTypeDef *middle = Create(1, 6U);
+    KERNEL_TaskTypeDef *high = Create(2, 2U);
+    KERNEL_MutexInit(&mutex);
+    (void)KERNEL_Start();
+    KERNEL_Sleep(1U);
+    TEST_ASSERT_TRUE(middle == Run());
+    KERNEL_Sleep(1U);
+    TEST_ASSERT_TRUE(low == Run());
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_MutexLock(&mutex, KERNEL_FOREVER));
+    Ticks(1U);
+    TEST_ASSERT_TRUE(high == Run());
+
+    // Act
+    TEST_ASSERT_EQUAL(KERNEL_PENDING, KERNEL_MutexLock(&mutex, KERNEL_FOREVER));
+
+    // Assert: low runs ahead of middle at high's priority
+    TEST_ASSERT_EQUAL_UINT8(2U, low->Priority);
+    TEST_ASSERT_TRUE(low == Run());
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_MutexUnlock(&mutex));
+    TEST_ASSERT_EQUAL_UINT8(10U, low->Priority);
+    TEST_ASSERT_TRUE(high == Run());
+    TEST_ASSERT_TRUE(high == mutex.Owner);
+    TEST_ASSERT_EQUAL_UINT8(KERNEL_OK, high->WaitResult);
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_MutexUnlock(&mutex));
+    TEST_ASSERT_NULL(mutex.Owner);
+}
+
+void test_mutex_inheritance_is_transitive(void)
+{
+    // Arrange: low holds a, middle holds b and waits for a, high wants b
+    KERNEL_MutexTypeDef a;
+    KERNEL_MutexTypeDef b;
+    KERNEL_TaskTypeDef *low = Create(0, 20U);
+    KERNEL_TaskTypeDef *middle = Create(1, 10U);
+    KERNEL_TaskTypeDef *high = Create(2, 1U);
+    KERNEL_MutexInit(&a);
+    KERNEL_MutexInit(&b);
+    (void)KERNEL_Start();
+    KERNEL_Sleep(2U);
+    TEST_ASSERT_TRUE(middle == Run());
+    KERNEL_Sleep(1U);
+    TEST_ASSERT_TRUE(low == Run());
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_MutexLock(&a, KERNEL_FOREVER));
+    Ticks(1U);
+    TEST_ASSERT_TRUE(middle == Run());
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_MutexLock(&b, KERNEL_FOREVER));
+    TEST_ASSERT_EQUAL(KERNEL_PENDING, KERNEL_MutexLock(&a, KERNEL_FOREVER));
+    TEST_ASSERT_EQUAL_UINT8(10U, low->Priority);
+    Ticks(1U);
+    TEST_ASSERT_TRUE(high == Run());
+
+    // Act
+    TEST_ASSERT_EQUAL(KERNEL_PENDING, KERNEL_MutexLock(&b, KERNEL_FOREVER));
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT8(1U, middle->Priority);
+    TEST_ASSERT_EQUAL_UINT8(1U, low->Priority);
+    TEST_ASSERT_TRUE(low == Run());
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_MutexUnlock(&a));
+    TEST_ASSERT_EQUAL_UINT8(20U, low->Priority);
+    TEST_ASSERT_TRUE(middle == Run());
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_MutexUnlock(&b));
+    TEST_ASSERT_EQUAL_UINT8(10U, middle->Priority);
+    TEST_ASSERT_TRUE(high == Run());
+}
+
+void test_mutex_timeout_drops_inherited_priority(void)
+{
+    KERNEL_MutexTypeDef mutex;
+    KERNEL_TaskTypeDef *low = Create(0, 10U);
+    KERNEL_TaskTypeDef *high = Create(1, 2U);
+    KERNEL_MutexInit(&mutex);
+    (void)KERNEL_Start();
+    KERNEL_Sleep(1U);
+    TEST_ASSERT_TRUE(low == Run());
+    TEST_ASSERT_EQUAL(KERNEL_OK, KERNEL_MutexLock(&mutex, KERNEL_FOREVER));
+    Ticks(1U);
+    TEST_ASSERT_TRUE(high == Run());
+
+    TEST_ASSERT_EQUAL(KERNEL_PENDING, KERNEL_MutexLock(&mutex, 3U));
+    TEST_ASSERT_TRUE(low == Run());
+    TEST_ASSERT_EQUAL_UINT8(2U, low->Priority);
+    Ticks(3U);
+
+    TEST_ASSERT_TRUE(high == Run());
+    TEST_ASSERT_EQUAL_UINT8(KERNEL_TIMEOUT, high->WaitResult);
+    TEST_ASSERT_EQUAL_UINT8(10U, low->Priority);
+    TEST_ASSERT_NULL(high->WaitMutex);
+    TEST_ASSERT_TRUE(low == mutex.Owner);
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Task Tests */
+    RUN_TEST(test_create_builds_initial_frame);
+    RUN_TEST(test_create_rejects_bad_arguments);
+    RUN_TEST(test_task_at_walks_creation_order);
+    RUN_TEST(test_start_picks_highest_priority);
+    RUN_TEST(test_bitmap_spans_all_priorities);
+    RUN_TEST(test_higher_priority_task_preempts);
+    RUN_TEST(test_yield_rotates_equal_priorities);
+    RUN_TEST(test_yield_alone_keeps_running);
+    RUN_TEST(test_sleep_wakes_after_ticks);
+    RUN_TEST(test_task_exit_switches_away);
+    RUN_TEST(test_stack_unused_counts_fill_words);
+
+    /* Semaphore Tests */
+    RUN_TEST(test_sem_counts_up_to_max);
+    RUN_TEST(test_sem_wakes_highest_priority_waiter_first);
+    RUN_TEST(test_sem_take_times_out);
+
+    /* Mutex Tests */
+    RUN_TEST(test_mutex_rejects_misuse);
+    RUN_TEST(test_mutex_inherits_and_hands_over);
+    RUN_TEST(test_mutex_inheritance_is_transitive);
+    RUN_TEST(test_mutex_timeout_drops_inherited_priority);
+
+    return UNITY_END();
+}
@@ -0,0 +1,194 @@
+/**
+  ******************************************************************************
+  * @file    test_led_pattern.c
+  * @author  Test Framework
+  * @brief   Unit tests for the LED PWM timing and pattern tables
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "led_pattern.h"
+#include <string.h>
+
+#define TICK_HZ        1000000U
+#define PWM_HZ         200U
+#define PERIOD         5000U
+#define CHANNELS       4U
+#define FRAMES         40U
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+static uint16_t table[FRAMES * CHANNELS];
+
+void setUp(void)
+{
+    memset(table, 0xEE, sizeof(table));
+}
+
+void tearDown(void)
+{
+}
+
+static LED_PatternTypeDef Pattern(LED_ShapeTypeDef shape, uint16_t level, uint16_t duty,
+                                  uint16_t phase, uint16_t repeat)
+{
+    LED_PatternTypeDef pattern;
+
+    pattern.Shape  = shape;
+    pattern.Level  = level;
+    pattern.Duty   = duty;
+    pattern.Phase  = phase;
+    pattern.Repeat = repeat;
+    return pattern;
+}
+
+/* ============================================================================ */
+/* TIMING TESTS */
+/* ============================================================================ */
+
+void test_period_divides_tick(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(PERIOD, LED_PATTERN_Period(TICK_HZ, PWM_HZ));
+    TEST_ASSERT_EQUAL_UINT32(1000U, LED_PATTERN_Period(TICK_HZ, 1000U));
+
+    // Not exact, no rate, too slow for 16 bits, too fast to dim
+    TEST_ASSERT_EQUAL_UINT32(0U, LED_PATTERN_Period(TICK_HZ, 300U));
+    TEST_ASSERT_EQUAL_UINT32(0U, LED_PATTERN_Period(TICK_HZ, 0U));
+    TEST_ASSERT_EQUAL_UINT32(0U, LED_PATTERN_Period(TICK_HZ, 10U));
+    TEST_ASSERT_EQUAL_UINT32(0U, LED_PATTERN_Period(TICK_HZ, TICK_HZ));
+}
+
+void test_frames_of_cycle(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(400U, LED_PATTERN_Frames(PWM_HZ, 2000U));
+    TEST_ASSERT_EQUAL_UINT32(1U, LED_PATTERN_Frames(PWM_HZ, 7U));
+    TEST_ASSERT_EQUAL_UINT32(2U, LED_PATTERN_Frames(PWM_HZ, 8U));
+    TEST_ASSERT_EQUAL_UINT32(1U, LED_PATTERN_Frames(PWM_HZ, 0U));
+}
+
+void test_gamma(void)
+{
+    TEST_ASSERT_EQUAL_UINT16(0U, LED_PATTERN_Gamma(0U, PERIOD));
+    TEST_ASSERT_EQUAL_UINT16(PERIOD, LED_PATTERN_Gamma(LED_PATTERN_FULL, PERIOD));
+    TEST_ASSERT_EQUAL_UINT16(PERIOD / 4U, LED_PATTERN_Gamma(500U, PERIOD));
+    TEST_ASSERT_EQUAL_UINT16(50U, LED_PATTERN_Gamma(100U, PERIOD));
+
+    // Clamped, and full on fits the largest period
+    TEST_ASSERT_EQUAL_UINT16(PERIOD, LED_PATTERN_Gamma(2000U, PERIOD));
+    TEST_ASSERT_EQUAL_UINT16(LED_PATTERN_MAX_TICKS, LED_PATTERN_Gamma(LED_PATTERN_FULL, LED_PATTERN_MAX_TICKS));
+}
+
+/* ============================================================================ */
+/* RENDER TESTS */
+/* ============================================================================ */
+
+void test_render_fills_only_its_channel(void)
+{
+    // Arrange
+    LED_PatternTypeDef on = Pattern(LED_SHAPE_ON, 500U, 0U, 0U, 0U);
+    uint32_t f;
+
+    // Act
+    LED_PATTERN_Render(table, FRAMES, CHANNELS, 2U, &on, PERIOD);
+
+    // Assert
+    for (f = 0U; f < FRAMES; f++)
+    {
+        TEST_ASSERT_EQUAL_UINT16(PERIOD / 4U, table[f * CHANNELS + 2U]);
+        TEST_ASSERT_EQUAL_UINT16(0xEEEEU, table[f * CHANNELS + 1U]);
+        TEST_ASSERT_EQUAL_UINT16(0xEEEEU, table[f * CHANNELS + 3U]);
+    }
+}
+
+void test_render_blink(void)
+{
+    LED_PatternTypeDef blink = Pattern(LED_SHAPE_BLINK, LED_PATTERN_FULL, 250U, 0U, 2U);
+    uint32_t lit = 0U;
+    uint32_t f;
+
+    LED_PATTERN_Render(table, FRAMES, CHANNELS, 0U, &blink, PERIOD);
+
+    // Two repeats of 20 frames, each on for the first 5
+    for (f = 0U; f < FRAMES; f++)
+    {
+        lit += (table[f * CHANNELS] == PERIOD) ? 1U : 0U;
+    }
+    TEST_ASSERT_EQUAL_UINT32(10U, lit);
+    TEST_ASSERT_EQUAL_UINT16(PERIOD, table[0]);
+    TEST_ASSERT_EQUAL_UINT16(PERIOD, table[4U * CHANNELS]);
+    TEST_ASSERT_EQUAL_UINT16(0U, table[5U * CHANNELS]);
+    TEST_ASSERT_EQUAL_UINT16(PERIOD, table[20U * CHANNELS]);
+}
+
+void test_render_blink_phase(void)
+{
+    LED_PatternTypeDef blink = Pattern(LED_SHAPE_BLINK, LED_PATTERN_FULL, 250U, 500U, 1U);
+
+    LED_PATTERN_Render(table, FRAMES, CHANNELS, 1U, &blink, PERIOD);
+
+    // Half a repeat late: lit from frame 20 to 29
+    TEST_ASSERT_EQUAL_UINT16(0U, table[0U * CHANNELS + 1U]);
+    TEST_ASSERT_EQUAL_UINT16(0U, table[19U * CHANNELS + 1U]);
+    TEST_ASSERT_EQUAL_UINT16(PERIOD, table[20U * CHANNELS + 1U]);
+    TEST_ASSERT_EQUAL_UINT16(PERIOD, table[29U * CHANNELS + 1U]);
+    TEST_ASSERT_EQUAL_UINT16(0U, table[30U * CHANNELS + 1U]);
+}
+
+void test_render_breathe(void)
+{
+    LED_PatternTypeDef breathe = Pattern(LED_SHAPE_BREATHE, LED_PATTERN_FULL, 0U, 0U, 1U);
+    uint32_t f;
+
+    LED_PATTERN_Render(table, FRAMES, CHANNELS, 3U, &breathe, PERIOD);
+
+    // Dark at the ends, full in the middle, symmetric, rising then falling
+    TEST_ASSERT_EQUAL_UINT16(0U, table[3U]);
+    TEST_ASSERT_EQUAL_UINT16(PERIOD, table[(FRAMES / 2U) * CHANNELS + 3U]);
+    for (f = 1U; f < FRAMES / 2U; f++)
+    {
+        TEST_ASSERT_EQUAL_UINT16(table[f * CHANNELS + 3U], table[(FRAMES - f) * CHANNELS + 3U]);
+        TEST_ASSERT_TRUE(table[f * CHANNELS + 3U] >= table[(f - 1U) * CHANNELS + 3U]);
+    }
+
+    // Eased: still dim a quarter of the way up, half way at a quarter repeat
+    TEST_ASSERT_TRUE(table[(FRAMES / 8U) * CHANNELS + 3U] < PERIOD / 16U);
+    TEST_ASSERT_EQUAL_UINT16(PERIOD / 4U, table[(FRAMES / 4U) * CHANNELS + 3U]);
+}
+
+void test_render_breathe_level_and_off(void)
+{
+    LED_PatternTypeDef breathe = Pattern(LED_SHAPE_BREATHE, 500U, 0U, 0U, 1U);
+    LED_PatternTypeDef off = Pattern(LED_SHAPE_OFF, LED_PATTERN_FULL, 0U, 0U, 1U);
+
+    LED_PATTERN_Render(table, FRAMES, CHANNELS, 0U, &breathe, PERIOD);
+    LED_PATTERN_Render(table, FRAMES, CHANNELS, 1U, &off, PERIOD);
+
+    // Peaks at the level's duty, not full
+    TEST_ASSERT_EQUAL_UINT16(PERIOD / 4U, table[(FRAMES / 2U) * CHANNELS]);
+    TEST_ASSERT_EQUAL_UINT16(0U, table[(FRAMES / 2U) * CHANNELS + 1U]);
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Timing Tests */
+    RUN_TEST(test_period_divides_tick);
+    RUN_TEST(test_frames_of_cycle);
+    RUN_TEST(test_gamma);
+
+    /* Render Tests */
+    RUN_TEST(test_render_fills_only_its_channel);
+    RUN_TEST(test_render_blink);
+    RUN_TEST(test_render_blink_phase);
+    RUN_TEST(test_render_breathe);
+    RUN_TEST(test_render_breathe_level_and_off);
+
+    return UNITY_END();
+}
@@ -0,0 +1,598 @@
+/**
+  ******************************************************************************
+  * @file    test_logfs.c
+  * @author  Test Framework
+  * @brief   Unit tests for the log filesystem over a file-backed block device
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "logfs.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Binary data is compared with memcmp(): TEST_ASSERT_EQUAL_MEMORY is a string
+ * compare in this Unity */
+
+/* ============================================================================ */
+/* FILE-BACKED BLOCK DEVICE */
+/* ============================================================================ */
+
+#define DEV_BLOCKS      2048U
+#define SMALL_BATCH     (4U * LOGFS_BLOCK_SIZE)
+
+/**
+  * A temporary file, with a power cut after Budget block writes: the write
+  * that hits it stops there, its block untouched or, when Torn, half
+  * written, and every later write fails.
+  */
+typedef struct
+{
+    FILE    *File;
+    int32_t  Budget;        /* Block writes left, -1 for no cut */
+    uint8_t  Torn;
+    uint8_t  Cut;
+    uint32_t Writes;
+    uint32_t BatchWrites;   /* Writes of LOGFS_ALIGN_BLOCKS blocks */
+    uint32_t SuperWrites;   /* Writes to block 0 or 1 */
+} FileDevTypeDef;
+
+static FileDevTypeDef dev;
+static LOGFS_DeviceTypeDef device;
+static LOGFS_TypeDef fs;
+static uint32_t batch[LOGFS_BATCH_SIZE / 4U];
+static uint32_t batch2[SMALL_BATCH / 4U];
+static uint8_t buffer[256U * 1024U];
+static uint8_t readback[256U * 1024U + 4U];
+
+static LOGFS_StatusTypeDef Dev_Read(void *context, uint32_t block, void *data, uint32_t count)
+{
+    FileDevTypeDef *d = context;
+
+    TEST_ASSERT_TRUE((block + count) <= DEV_BLOCKS);
+    TEST_ASSERT_EQUAL_UINT32(0U, (uint32_t)((uintptr_t)data & 3U));
+    memset(data, 0, count * LOGFS_BLOCK_SIZE);
+    if (fseek(d->File, (long)block * LOGFS_BLOCK_SIZE, SEEK_SET) != 0)
+    {
+        return LOGFS_ERROR;
+    }
+    (void)fread(data, LOGFS_BLOCK_SIZE, count, d->File);
+    return LOGFS_OK;
+}
+
+static LOGFS_StatusTypeDef Dev_Write(void *context, uint32_t block, const void *data, uint32_t count)
+{
+    FileDevTypeDef *d = context;
+    const uint8_t *p = data;
+    uint32_t i;
+
+    TEST_ASSERT_TRUE((block + count) <= DEV_BLOCKS);
+    TEST_ASSERT_EQUAL_UINT32(0U, (uint32_t)((uintptr_t)data & 3U));
+    if (d->Cut != 0U)
+    {
+        return LOGFS_ERROR;
+    }
+    d->Writes++;
+    d->BatchWrites += (count == LOGFS_ALIGN_BLOCKS) ? 1U : 0U;
+    d->SuperWrites += (block < 2U) ? 1U : 0U;
+    TEST_ASSERT_EQUAL_INT(0, fseek(d->File, (long)block * LOGFS_BLOCK_SIZE, SEEK_SET));
+    for (i = 0U; i < count; i++)
+    {
+        if (d->Budget == 0)
+        {
+            if (d->Torn != 0U)
+            {
+                (void)fwrite(&p[i * LOGFS_BLOCK_SIZE], LOGFS_BLOCK_SIZE / 2U, 1U, d->File);
+            }
+            d->Cut = 1U;
+            (void)fflush(d->File);
+            return LOGFS_ERROR;
+        }
+        if (d->Budget > 0)
+        {
+            d->Budget--;
+        }
+        TEST_ASSERT_EQUAL_UINT32(1U, (uint32_t)fwrite(&p[i * LOGFS_BLOCK_SIZE], LOGFS_BLOCK_SIZE, 1U, d->File));
+    }
+    (void)fflush(d->File);
+    return LOGFS_OK;
+}
+
+/* Power back on: same medium, no cut, counters cleared */
+static void Reboot(void)
+{
+    dev.Budget = -1;
+    dev.Cut = 0U;
+    dev.Writes = 0U;
+    dev.BatchWrites = 0U;
+    dev.SuperWrites = 0U;
+}
+
+static void Corrupt(uint32_t block)
+{
+    uint8_t junk = 0x5AU;
+
+    TEST_ASSERT_EQUAL_INT(0, fseek(dev.File, (long)block * LOGFS_BLOCK_SIZE + 100L, SEEK_SET));
+    TEST_ASSERT_EQUAL_UINT32(1U, (uint32_t)fwrite(&junk, 1U, 1U, dev.File));
+    (void)fflush(dev.File);
+}
+
+/* Byte k of file f */
+static uint8_t Pattern(uint32_t f, uint32_t k)
+{
+    return (uint8_t)((k * 31U) + (f * 7U) + (k >> 9));
+}
+
+static void Fill(uint32_t f, uint32_t offset, uint8_t *data, uint32_t length)
+{
+    uint32_t i;
+
+    for (i = 0U; i < length; i++)
+    {
+        data[i] = Pattern(f, offset + i);
+    }
+}
+
+/* Reads the whole file in one call and checks it against the pattern */
+static void CheckFile(LOGFS_FileTypeDef *file, uint32_t f, uint32_t length)
+{
+    uint32_t read;
+
+    TEST_ASSERT_EQUAL_UINT32(length, file->Length);
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Read(file, 0U, readback, sizeof(readback), &read));
+    TEST_ASSERT_EQUAL_UINT32(length, read);
+    Fill(f, 0U, buffer, length);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(buffer, readback, length));
+}
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+void setUp(void)
+{
+    memset(&dev, 0, sizeof(dev));
+    dev.File = tmpfile();
+    TEST_ASSERT_NOT_NULL(dev.File);
+    dev.Budget = -1;
+    device.Read = Dev_Read;
+    device.Write = Dev_Write;
+    device.Context = &dev;
+    device.Blocks = DEV_BLOCKS;
+    memset(&fs, 0xA5, sizeof(fs));
+}
+
+void tearDown(void)
+{
+    if (dev.File != NULL)
+    {
+        fclose(dev.File);
+    }
+}
+
+/* ============================================================================ */
+/* FORMAT AND MOUNT TESTS */
+/* ============================================================================ */
+
+void test_crc32_known_vector(void)
+{
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926UL, LOGFS_Crc32("123456789", 9U));
+}
+
+void test_blank_device_does_not_mount(void)
+{
+    TEST_ASSERT_EQUAL(LOGFS_CORRUPT, LOGFS_Mount(&fs, &device));
+}
+
+void test_format_then_mount_empty(void)
+{
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Format(&fs, &device));
+    TEST_ASSERT_EQUAL_UINT32(2U, dev.SuperWrites);
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Mount(&fs, &device));
+    TEST_ASSERT_EQUAL_UINT32(0U, fs.Count);
+    TEST_ASSERT_EQUAL_UINT32(LOGFS_ALIGN_BLOCKS, fs.Next);
+    TEST_ASSERT_EQUAL_UINT32(2U, fs.Sequence);
+}
+
+void test_format_rejects_tiny_device(void)
+{
+    device.Blocks = LOGFS_ALIGN_BLOCKS;
+    TEST_ASSERT_EQUAL(LOGFS_INVALID, LOGFS_Format(&fs, &device));
+    TEST_ASSERT_EQUAL_UINT32(0U, dev.Writes);
+}
+
+void test_newer_copy_torn_falls_back(void)
+{
+    LOGFS_FileTypeDef file;
+
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Format(&fs, &device));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Create(&fs, "log", 10000U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Open(&fs, &file, "log", (uint8_t *)batch, sizeof(batch)));
+    Fill(0U, 0U, buffer, 3000U);
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Append(&file, buffer, 1000U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Sync(&file));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Append(&file, &buffer[1000], 2000U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Sync(&file));
+
+    Corrupt(fs.Sequence & 1U);
+    Reboot();
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Mount(&fs, &device));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Open(&fs, &file, "log", NULL, 0U));
+    CheckFile(&file, 0U, 1000U);
+
+    /* The next commit goes over the bad copy */
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Open(&fs, &file, "log", (uint8_t *)batch, sizeof(batch)));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Append(&file, &buffer[1000], 5U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Sync(&file));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Mount(&fs, &device));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Open(&fs, &file, "log", NULL, 0U));
+    CheckFile(&file, 0U, 1005U);
+}
+
+void test_both_copies_bad_is_corrupt(void)
+{
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Format(&fs, &device));
+    Corrupt(0U);
+    Corrupt(1U);
+    TEST_ASSERT_EQUAL(LOGFS_CORRUPT, LOGFS_Mount(&fs, &device));
+}
+
+/* ============================================================================ */
+/* EXTENT TESTS */
+/* ============================================================================ */
+
+void test_create_reserves_aligned_extents(void)
+{
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Format(&fs, &device));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Create(&fs, "a", 1U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Create(&fs, "bbbbbbbbbbbbbbb", 40000U));
+    TEST_ASSERT_EQUAL_UINT32(LOGFS_ALIGN_BLOCKS, fs.Files[0].Start);
+    TEST_ASSERT_EQUAL_UINT32(LOGFS_ALIGN_BLOCKS, fs.Files[0].Blocks);
+    TEST_ASSERT_EQUAL_UINT32(2U * LOGFS_ALIGN_BLOCKS, fs.Files[1].Start);
+    TEST_ASSERT_EQUAL_UINT32(2U * LOGFS_ALIGN_BLOCKS, fs.Files[1].Blocks);
+
+    TEST_ASSERT_EQUAL(LOGFS_EXISTS, LOGFS_Create(&fs, "a", 1U));
+    TEST_ASSERT_EQUAL(LOGFS_INVALID, LOGFS_Create(&fs, "", 1U));
+    TEST_ASSERT_EQUAL(LOGFS_INVALID, LOGFS_Create(&fs, "cccccccccccccccc", 1U));
+    TEST_ASSERT_EQUAL(LOGFS_INVALID, LOGFS_Create(&fs, "c", 0U));
+    TEST_ASSERT_EQUAL(LOGFS_FULL, LOGFS_Create(&fs, "c", DEV_BLOCKS * LOGFS_BLOCK_SIZE));
+
+    /* The rest of the device, exactly */
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Create(&fs, "c", (DEV_BLOCKS - fs.Next) * LOGFS_BLOCK_SIZE));
+    TEST_ASSERT_EQUAL_UINT32(DEV_BLOCKS, fs.Next);
+    TEST_ASSERT_EQUAL(LOGFS_FULL, LOGFS_Create(&fs, "d", 1U));
+
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Mount(&fs, &device));
+    TEST_ASSERT_EQUAL_UINT32(3U, fs.Count);
+    TEST_ASSERT_EQUAL_STRING("bbbbbbbbbbbbbbb", fs.Files[1].Name);
+    TEST_ASSERT_EQUAL_UINT32(DEV_BLOCKS, fs.Next);
+}
+
+void test_file_table_limit(void)
+{
+    char name[4] = "f00";
+    uint32_t i;
+
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Format(&fs, &device));
+    for (i = 0U; i < LOGFS_MAX_FILES; i++)
+    {
+        name[1] = (char)('0' + (i / 10U));
+        name[2] = (char)('0' + (i % 10U));
+        TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Create(&fs, name, 1U));
+    }
+    TEST_ASSERT_EQUAL(LOGFS_FULL, LOGFS_Create(&fs, "x", 1U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Mount(&fs, &device));
+    TEST_ASSERT_EQUAL_UINT32(LOGFS_MAX_FILES, fs.Count);
+}
+
+void test_open_checks_name_and_buffer(void)
+{
+    LOGFS_FileTypeDef file;
+
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Format(&fs, &device));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Create(&fs, "log", 1U));
+    TEST_ASSERT_EQUAL(LOGFS_NOT_FOUND, LOGFS_Open(&fs, &file, "lo", NULL, 0U));
+    TEST_ASSERT_EQUAL(LOGFS_INVALID, LOGFS_Open(&fs, &file, "log", (uint8_t *)batch, 1000U));
+    TEST_ASSERT_EQUAL(LOGFS_INVALID, LOGFS_Open(&fs, &file, "log", (uint8_t *)batch + 1, 512U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Open(&fs, &file, "log", NULL, 0U));
+    TEST_ASSERT_EQUAL(LOGFS_INVALID, LOGFS_Append(&file, buffer, 1U));
+    TEST_ASSERT_EQUAL(LOGFS_INVALID, LOGFS_Sync(&file));
+}
+
+/* ============================================================================ */
+/* APPEND AND READ TESTS */
+/* ============================================================================ */
+
+void test_append_read_round_trip(void)
+{
+    LOGFS_FileTypeDef file;
+    uint32_t length = 0U;
+    uint32_t chunk = 1U;
+    uint32_t read;
+    uint32_t offset;
+
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Format(&fs, &device));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Create(&fs, "log", 200000U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Open(&fs, &file, "log", (uint8_t *)batch, sizeof(batch)));
+    while (length < 150000U)
+    {
+        Fill(0U, length, buffer, chunk);
+        TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Append(&file, buffer, chunk));
+        length += chunk;
+        chunk = (chunk * 7U + 13U) % 3001U;
+    }
+
+    /* Unsynced: partly on the device, the rest in the batch */
+    CheckFile(&file, 0U, length);
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Sync(&file));
+    CheckFile(&file, 0U, length);
+
+    /* Unaligned destinations and offsets */
+    Fill(0U, 0U, buffer, length);
+    for (offset = 0U; offset < length; offset += 9973U)
+    {
+        TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Read(&file, offset, &readback[1], 5000U, &read));
+        TEST_ASSERT_EQUAL_UINT32(((length - offset) < 5000U) ? (length - offset) : 5000U, read);
+        TEST_ASSERT_EQUAL_INT(0, memcmp(&buffer[offset], &readback[1], read));
+    }
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Read(&file, length, readback, 10U, &read));
+    TEST_ASSERT_EQUAL_UINT32(0U, read);
+}
+
+void test_full_batches_are_single_transfers(void)
+{
+    LOGFS_FileTypeDef file;
+    uint32_t i;
+
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Format(&fs, &device));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Create(&fs, "log", 8U * LOGFS_BATCH_SIZE));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Open(&fs, &file, "log", (uint8_t *)batch, sizeof(batch)));
+    Reboot();
+    for (i = 0U; i < (6U * LOGFS_BATCH_SIZE) / 100U; i++)
+    {
+        Fill(0U, i * 100U, buffer, 100U);
+        TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Append(&file, buffer, 100U));
+    }
+
+    /* 5 whole batches written, aligned, nothing committed yet */
+    TEST_ASSERT_EQUAL_UINT32(5U, dev.Writes);
+    TEST_ASSERT_EQUAL_UINT32(5U, dev.BatchWrites);
+    TEST_ASSERT_EQUAL_UINT32(0U, dev.SuperWrites);
+    TEST_ASSERT_EQUAL_UINT32(0U, fs.Files[0].Start % LOGFS_ALIGN_BLOCKS);
+
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Sync(&file));
+    TEST_ASSERT_EQUAL_UINT32(7U, dev.Writes);
+    TEST_ASSERT_EQUAL_UINT32(1U, dev.SuperWrites);
+
+    /* Nothing new: nothing written */
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Sync(&file));
+    TEST_ASSERT_EQUAL_UINT32(7U, dev.Writes);
+    CheckFile(&file, 0U, i * 100U);
+}
+
+void test_unsynced_data_is_lost_on_remount(void)
+{
+    LOGFS_FileTypeDef file;
+
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Format(&fs, &device));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Create(&fs, "log", 100000U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Open(&fs, &file, "log", (uint8_t *)batch2, sizeof(batch2)));
+    Fill(0U, 0U, buffer, 9000U);
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Append(&file, buffer, 1234U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Sync(&file));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Append(&file, &buffer[1234], 7000U));
+
+    Reboot();
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Mount(&fs, &device));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Open(&fs, &file, "log", (uint8_t *)batch2, sizeof(batch2)));
+    CheckFile(&file, 0U, 1234U);
+
+    /* Appending resumes inside the committed tail block */
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Append(&file, &buffer[1234], 7000U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Sync(&file));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Mount(&fs, &device));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Open(&fs, &file, "log", NULL, 0U));
+    CheckFile(&file, 0U, 8234U);
+}
+
+void test_extent_full_adds_nothing(void)
+{
+    LOGFS_FileTypeDef file;
+
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Format(&fs, &device));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Create(&fs, "log", 1U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Open(&fs, &file, "log", (uint8_t *)batch2, sizeof(batch2)));
+    TEST_ASSERT_EQUAL_UINT32(LOGFS_BATCH_SIZE, file.Capacity);
+    Fill(0U, 0U, buffer, LOGFS_BATCH_SIZE);
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Append(&file, buffer, LOGFS_BATCH_SIZE - 10U));
+    TEST_ASSERT_EQUAL(LOGFS_FULL, LOGFS_Append(&file, buffer, 11U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Append(&file, &buffer[LOGFS_BATCH_SIZE - 10U], 10U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Sync(&file));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Mount(&fs, &device));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Open(&fs, &file, "log", NULL, 0U));
+    CheckFile(&file, 0U, LOGFS_BATCH_SIZE);
+    TEST_ASSERT_EQUAL_UINT32(2U * LOGFS_ALIGN_BLOCKS, fs.Next);
+}
+
+void test_truncate_keeps_the_extent(void)
+{
+    LOGFS_FileTypeDef file;
+
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Format(&fs, &device));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Create(&fs, "log", 10000U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Open(&fs, &file, "log", (uint8_t *)batch2, sizeof(batch2)));
+    Fill(0U, 0U, buffer, 5000U);
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Append(&file, buffer, 5000U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Sync(&file));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Truncate(&file));
+    TEST_ASSERT_EQUAL_UINT32(0U, file.Length);
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Append(&file, buffer, 700U));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Sync(&file));
+
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Mount(&fs, &device));
+    TEST_ASSERT_EQUAL(LOGFS_OK, LOGFS_Open(&fs, &file, "log", NULL, 0U));
+    CheckFile(&file, 0U, 700U);
+    TEST_ASSERT_EQUAL_UINT32(2U * LOGFS_ALIGN_BLOCKS, fs.Next);
+}
+
+/* ============================================================================ */
+/* CRASH CONSISTENCY TESTS */
+/* ============================================================================ */
+
+typedef struct
+{
+    uint8_t  Formatted;
+    uint8_t  Created[2];
+    uint32_t Synced[2];     /* Lengths LOGFS_Sync() reported as committed */
+} WorkloadTypeDef;
+
+/**
+  * Two files appended in turns with record sizes up to 4000 bytes, one
+  * through a full batch and one through a small one, each synced every
+  * third record. Stops at the first error, as a power cut would.
+  */
+static void Workload(WorkloadTypeDef *w)
+{
+    static const char *const Names[2] = { "fast", "slow" };
+    LOGFS_FileTypeDef files[2];
+    uint32_t length[2] = { 0U, 0U };
+    uint32_t seed = 7U;
+    uint32_t n;
+    uint32_t f;
+    uint32_t i;
+
+    memset(w, 0, sizeof(*w));
+    if (LOGFS_Format(&fs, &device) != LOGFS_OK)
+    {
+        return;
+    }
+    w->Formatted = 1U;
+    for (f = 0U; f < 2U; f++)
+    {
+        if (LOGFS_Create(&fs, Names[f], 200000U) != LOGFS_OK)
+        {
+            return;
+        }
+        w->Created[f] = 1U;
+    }
+    if ((LOGFS_Open(&fs, &files[0], Names[0], (uint8_t *)batch, sizeof(batch)) != LOGFS_OK) ||
+        (LOGFS_Open(&fs, &files[1], Names[1], (uint8_t *)batch2, sizeof(batch2)) != LOGFS_OK))
+    {
+        return;
+    }
+    for (i = 0U; i < 90U; i++)
+    {
+        f = i & 1U;
+        seed = (seed * 1103515245U) + 12345U;
+        n = 1U + ((seed >> 16) % 4000U);
+        Fill(f, length[f], buffer, n);
+        if (LOGFS_Append(&files[f], buffer, n) != LOGFS_OK)
+        {
+            return;
+        }
+        length[f] += n;
+        if ((i % 6U) >= 4U)
+        {
+            if (LOGFS_Sync(&files[f]) != LOGFS_OK)
+            {
+                return;
+            }
+            w->Synced[f] = length[f];
+        }
+    }
+}
+
+static void CheckAfterCut(const WorkloadTypeDef *w, int32_t budget)
+{
+    static const char *const Names[2] = { "fast", "slow" };
+    LOGFS_FileTypeDef file;
+    LOGFS_StatusTypeDef status;
+    uint32_t f;
+
+    Reboot();
+    status = LOGFS_Mount(&fs, &device);
+    if (budget == 0)
+    {
+        TEST_ASSERT_EQUAL(LOGFS_CORRUPT, status);
+        return;
+    }
+    TEST_ASSERT_EQUAL(LOGFS_OK, status);
+    for (f = 0U; f < 2U; f++)
+    {
+        status = LOGFS_Open(&fs, &file, Names[f], NULL, 0U);
+        if (w->Created[f] == 0U)
+        {
+            /* Its superblock was the write that failed */
+            TEST_ASSERT_EQUAL(LOGFS_NOT_FOUND, status);
+            continue;
+        }
+        TEST_ASSERT_EQUAL(LOGFS_OK, status);
+        CheckFile(&file, f, w->Synced[f]);
+    }
+}
+
+static void PowerCutSweep(uint8_t torn)
+{
+    WorkloadTypeDef w;
+    uint32_t total;
+    int32_t budget;
+
+    Workload(&w);
+    TEST_ASSERT_TRUE(w.Synced[0] > (2U * LOGFS_BATCH_SIZE));
+    TEST_ASSERT_EQUAL_UINT32(0U, dev.Cut);
+    total = fs.BlocksWritten;
+
+    for (budget = 0; budget <= (int32_t)total; budget++)
+    {
+        fclose(dev.File);
+        dev.File = tmpfile();
+        TEST_ASSERT_NOT_NULL(dev.File);
+        Reboot();
+        dev.Budget = budget;
+        dev.Torn = torn;
+        Workload(&w);
+        TEST_ASSERT_EQUAL_UINT32((budget < (int32_t)total) ? 1U : 0U, dev.Cut);
+        CheckAfterCut(&w, budget);
+    }
+}
+
+void test_power_cut_at_every_block_write(void)
+{
+    PowerCutSweep(0U);
+}
+
+void test_torn_write_at_every_block(void)
+{
+    PowerCutSweep(1U);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Format and Mount Tests */
+    RUN_TEST(test_crc32_known_vector);
+    RUN_TEST(test_blank_device_does_not_mount);
+    RUN_TEST(test_format_then_mount_empty);
+    RUN_TEST(test_format_rejects_tiny_device);
+    RUN_TEST(test_newer_copy_torn_falls_back);
+    RUN_TEST(test_both_copies_bad_is_corrupt);
+
+    /* Extent Tests */
+    RUN_TEST(test_create_reserves_aligned_extents);
+    RUN_TEST(test_file_table_limit);
+    RUN_TEST(test_open_checks_name_and_buffer);
+
+    /* Append and Read Tests */
+    RUN_TEST(test_append_read_round_trip);
+    RUN_TEST(test_full_batches_are_single_transfers);
+    RUN_TEST(test_unsynced_data_is_lost_on_remount);
+    RUN_TEST(test_extent_full_adds_nothing);
+    RUN_TEST(test_truncate_keeps_the_extent);
+
+    /* Crash Consistency Tests */
+    RUN_TEST(test_power_cut_at_every_block_write);
+    RUN_TEST(test_torn_write_at_every_block);
+
+    return UNITY_END();
+}
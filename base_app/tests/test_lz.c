@@ -0,0 +1,436 @@
+/**
+  ******************************************************************************
+  * @file    test_lz.c
+  * @author  Test Framework
+  * @brief   Unit tests for the streaming LZSS compressor: round trips on
+  *          console and telemetry logs, edge cases, corrupt input
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "lzss.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define CORPUS_MAX     (256U * 1024U)
+#define LINES_MAX      16384U
+#define FRAME_SIZE     255U                     /* As console_lz.c */
+#define OUT_MAX        (FRAME_SIZE * 258U)
+
+/* TEST_ASSERT_EQUAL_MEMORY stops at the first NUL here; memcmp() it is */
+
+/* Compression floors on the logs, per-line flushes, by window bits */
+static const double ConsoleFloor[4] = { 1.8, 2.7, 2.8, 2.8 };
+static const double TelemetryFloor[4] = { 1.45, 1.5, 1.55, 1.6 };
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+static uint8_t  corpus[CORPUS_MAX];
+static uint32_t corpusLength;
+static uint32_t lineEnd[LINES_MAX];
+static uint32_t lineCount;
+static uint8_t  decoded[CORPUS_MAX + OUT_MAX];
+static uint32_t decodedLength;
+static uint8_t  encWindow[LZSS_WINDOW_SIZE(LZSS_WINDOW_BITS_MAX)];
+static uint8_t  decWindow[LZSS_WINDOW_SIZE(LZSS_WINDOW_BITS_MAX)];
+static uint8_t  frame[FRAME_SIZE];
+static LZSS_EncoderTypeDef enc;
+static LZSS_DecoderTypeDef dec;
+static uint32_t wire;
+static uint32_t seed;
+
+void setUp(void)
+{
+    seed = 12345U;
+    corpusLength = 0U;
+    lineCount = 0U;
+    decodedLength = 0U;
+    wire = 0U;
+}
+
+void tearDown(void)
+{
+}
+
+static uint32_t Random(void)
+{
+    seed = (seed * 1664525U) + 1013904223U;
+    return seed >> 8;
+}
+
+/* One line of the corpus, printf-style, at most the console's 80 bytes */
+static void Line(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static void Line(const char *format, ...)
+{
+    va_list args;
+    int n;
+
+    va_start(args, format);
+    n = vsnprintf((char *)&corpus[corpusLength], 80U, format, args);
+    va_end(args);
+    corpusLength += (uint32_t)n;
+    lineEnd[lineCount++] = corpusLength;
+}
+
+/* The application loop of main.c, a second per pass: the same formats with
+   values that drift the way they do on the board */
+static void ConsoleCorpus(void)
+{
+    uint32_t milli_hz = 1000000U;
+    uint32_t can[3] = { 0U, 0U, 0U };
+    uint32_t adc[4] = { 30000U, 12000U, 45000U, 800U };
+    uint32_t t = 0U;
+    uint32_t i;
+
+    Line("trace: 512 records, 14 cycles per event\r\n");
+    Line("kernel: switch 92/97/141 cycles min/avg/max\r\n");
+    while ((corpusLength + 6U * 80U) < CORPUS_MAX)
+    {
+        Line("Hello World\r\n");
+        for (i = 0U; i < 4U; i++)
+        {
+            adc[i] = (adc[i] + Random() % 64U) - 32U;
+        }
+        Line("adc: %u %u %u %u\r\n", adc[0], adc[1], adc[2], adc[3]);
+        milli_hz += (Random() % 9U) - 4U;
+        Line("pulse: %u.%03u Hz, jitter %u/%u ticks, duty %u.%u%%\r\n", milli_hz / 1000U,
+             milli_hz % 1000U, Random() % 40U, 84000U, 500U / 10U, Random() % 10U);
+        can[0] += 100U;
+        can[1] += 10U;
+        can[2] += Random() % 2U;
+        Line("can: %u/%u/%u frames, %u dropped, %u bus-off, tec %u\r\n", can[0], can[1], can[2],
+             0U, 0U, 0U);
+        Line("accel: roll %d, pitch %d, tilt %d (0.1 deg), vibration %u mg\r\n",
+             (int)(Random() % 21U) - 10, (int)(Random() % 21U) - 10, (int)(Random() % 15U),
+             Random() % 30U);
+        if ((Random() % 16U) == 0U)
+        {
+            Line("button: %s at %u ms\r\n", ((Random() % 2U) != 0U) ? "click" : "long press", t);
+        }
+        t += 1000U;
+    }
+}
+
+/* The SD log lines of main.c: ticks, pulse mHz, duty, CAN frames, underruns */
+static void TelemetryCorpus(void)
+{
+    uint32_t milli_hz = 1000000U;
+    uint32_t ticks = 0U;
+    uint32_t can = 0U;
+
+    while ((corpusLength + 80U) < CORPUS_MAX)
+    {
+        ticks += 1000U + (Random() % 3U);
+        milli_hz += (Random() % 9U) - 4U;
+        can += 110U + (Random() % 2U);
+        Line("%u,%u,%u,%u,%u,%u\n", ticks, milli_hz, 500U + (Random() % 3U), can, 0U, 0U);
+    }
+}
+
+static void DecodeFrame(uint32_t length)
+{
+    uint32_t produced;
+
+    TEST_ASSERT_EQUAL(LZSS_OK, LZSS_Decode(&dec, frame, length, &decoded[decodedLength],
+                                           sizeof(decoded) - decodedLength, &produced));
+    decodedLength += produced;
+    wire += length + 2U;                        /* Plus the frame header */
+}
+
+/* One write as console_lz.c makes it, compressed and flushed, every frame
+   decoded as it comes */
+static void Write(const uint8_t *data, uint32_t length)
+{
+    uint32_t taken;
+
+    while (length != 0U)
+    {
+        taken = LZSS_Compress(&enc, data, length);
+        data += taken;
+        length -= taken;
+        if (length != 0U)
+        {
+            DecodeFrame(LZSS_Frame(&enc));
+        }
+    }
+    while (LZSS_Flush(&enc) != 0U)
+    {
+        DecodeFrame(LZSS_Frame(&enc));
+    }
+    if (enc.OutLength != 0U)
+    {
+        DecodeFrame(LZSS_Frame(&enc));
+    }
+}
+
+static void Start(uint32_t bits, uint32_t frame_size)
+{
+    TEST_ASSERT_EQUAL(LZSS_OK, LZSS_EncoderInit(&enc, encWindow, bits, frame, frame_size));
+    TEST_ASSERT_EQUAL(LZSS_OK, LZSS_DecoderInit(&dec, decWindow, bits));
+    decodedLength = 0U;
+    wire = 0U;
+}
+
+/* Round trip of the corpus, a write per line as printMsg() does; reports
+   the ratio and the rate of both sides, the decoding included */
+static double RoundTripLines(const char *name, uint32_t bits)
+{
+    clock_t start;
+    double seconds;
+    uint32_t from = 0U;
+    uint32_t i;
+
+    Start(bits, FRAME_SIZE);
+    start = clock();
+    for (i = 0U; i < lineCount; i++)
+    {
+        Write(&corpus[from], lineEnd[i] - from);
+        from = lineEnd[i];
+    }
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    TEST_ASSERT_EQUAL_UINT32(corpusLength, decodedLength);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(corpus, decoded, corpusLength));
+    TEST_ASSERT_EQUAL_UINT32(corpusLength, enc.In);
+    printf("%s, %u-byte window: %u -> %u bytes, ratio %.2f, %.0f bytes/s\n", name,
+           (unsigned)LZSS_WINDOW_SIZE(bits), (unsigned)corpusLength, (unsigned)wire,
+           (double)corpusLength / (double)wire, (seconds > 0.0) ? (corpusLength / seconds) : 0.0);
+    return (double)corpusLength / (double)wire;
+}
+
+/* ============================================================================ */
+/* LOG CORPUS TESTS */
+/* ============================================================================ */
+
+void test_console_log_round_trip_all_windows(void)
+{
+    uint32_t bits;
+
+    ConsoleCorpus();
+    for (bits = LZSS_WINDOW_BITS_MIN; bits <= LZSS_WINDOW_BITS_MAX; bits++)
+    {
+        TEST_ASSERT_TRUE(RoundTripLines("console", bits) >= ConsoleFloor[bits - LZSS_WINDOW_BITS_MIN]);
+    }
+}
+
+void test_telemetry_log_round_trip_all_windows(void)
+{
+    uint32_t bits;
+
+    TelemetryCorpus();
+    for (bits = LZSS_WINDOW_BITS_MIN; bits <= LZSS_WINDOW_BITS_MAX; bits++)
+    {
+        TEST_ASSERT_TRUE(RoundTripLines("telemetry", bits) >= TelemetryFloor[bits - LZSS_WINDOW_BITS_MIN]);
+    }
+}
+
+void test_one_write_compresses_better_than_lines(void)
+{
+    double lines;
+
+    ConsoleCorpus();
+    lines = RoundTripLines("console", LZSS_WINDOW_BITS_MAX);
+    Start(LZSS_WINDOW_BITS_MAX, FRAME_SIZE);
+    Write(corpus, corpusLength);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(corpus, decoded, corpusLength));
+    TEST_ASSERT_TRUE(((double)corpusLength / (double)wire) >= lines);
+}
+
+/* ============================================================================ */
+/* STREAMING TESTS */
+/* ============================================================================ */
+
+void test_byte_at_a_time_matches_one_write(void)
+{
+    uint32_t whole;
+    uint32_t i;
+
+    ConsoleCorpus();
+    corpusLength = 20000U;
+    Start(10U, FRAME_SIZE);
+    Write(corpus, corpusLength);
+    whole = wire;
+
+    /* Frames only when the buffer fills: the same items, in other frames */
+    Start(10U, FRAME_SIZE);
+    for (i = 0U; i < corpusLength; i++)
+    {
+        if (LZSS_Compress(&enc, &corpus[i], 1U) == 0U)
+        {
+            DecodeFrame(LZSS_Frame(&enc));
+            TEST_ASSERT_EQUAL_UINT32(1U, LZSS_Compress(&enc, &corpus[i], 1U));
+        }
+    }
+    Write(corpus, 0U);
+    TEST_ASSERT_EQUAL_UINT32(corpusLength, decodedLength);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(corpus, decoded, corpusLength));
+    TEST_ASSERT_INT_WITHIN((int)(whole / 50U), (int)whole, (int)wire);
+}
+
+void test_smallest_output_buffer(void)
+{
+    ConsoleCorpus();
+    corpusLength = 5000U;
+    Start(LZSS_WINDOW_BITS_MIN, LZSS_ITEM_MAX);
+    Write(corpus, corpusLength);
+    TEST_ASSERT_EQUAL_UINT32(corpusLength, decodedLength);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(corpus, decoded, corpusLength));
+}
+
+void test_runs_overlap_their_own_output(void)
+{
+    uint32_t bits;
+
+    memset(corpus, 'a', 10000U);
+    corpusLength = 10000U;
+    for (bits = LZSS_WINDOW_BITS_MIN; bits <= LZSS_WINDOW_BITS_MAX; bits++)
+    {
+        Start(bits, FRAME_SIZE);
+        Write(corpus, corpusLength);
+        TEST_ASSERT_EQUAL_UINT32(corpusLength, decodedLength);
+        TEST_ASSERT_EQUAL_INT(0, memcmp(corpus, decoded, corpusLength));
+        /* A literal, then matches of MaxMatch at distance 1, 2 bytes each */
+        TEST_ASSERT_TRUE(wire < ((corpusLength / enc.MaxMatch) * 3U) + 16U);
+    }
+}
+
+void test_random_data_within_bound(void)
+{
+    uint32_t bits;
+    uint32_t before;
+    uint32_t i;
+
+    for (i = 0U; i < 100000U; i++)
+    {
+        corpus[i] = (uint8_t)Random();
+    }
+    corpusLength = 100000U;
+    for (bits = LZSS_WINDOW_BITS_MIN; bits <= LZSS_WINDOW_BITS_MAX; bits++)
+    {
+        /* A write that fits one frame never grows past the bound */
+        Start(bits, FRAME_SIZE);
+        for (i = 0U; i < corpusLength; i += 100U)
+        {
+            before = enc.Produced;
+            Write(&corpus[i], 100U);
+            TEST_ASSERT_TRUE((enc.Produced - before) <= LZSS_BOUND(100U));
+        }
+        TEST_ASSERT_EQUAL_UINT32(corpusLength, decodedLength);
+        TEST_ASSERT_EQUAL_INT(0, memcmp(corpus, decoded, corpusLength));
+    }
+}
+
+void test_long_stream_past_16_bit_positions(void)
+{
+    uint32_t i;
+
+    /* Short random words over a small alphabet: plenty of stale hash hits */
+    for (i = 0U; i < 200000U; i++)
+    {
+        corpus[i] = (uint8_t)('a' + (Random() % 4U));
+    }
+    corpusLength = 200000U;
+    Start(9U, FRAME_SIZE);
+    Write(corpus, corpusLength);
+    TEST_ASSERT_EQUAL_UINT32(corpusLength, decodedLength);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(corpus, decoded, corpusLength));
+}
+
+void test_reset_starts_a_stream_of_its_own(void)
+{
+    ConsoleCorpus();
+    Start(LZSS_WINDOW_BITS_MAX, FRAME_SIZE);
+    Write(corpus, 3000U);
+
+    /* A decoder that never saw the first part follows after the reset */
+    LZSS_EncoderReset(&enc);
+    LZSS_DecoderReset(&dec);
+    decodedLength = 0U;
+    memset(decWindow, 0, sizeof(decWindow));
+    Write(&corpus[3000U], 3000U);
+    TEST_ASSERT_EQUAL_UINT32(3000U, decodedLength);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(&corpus[3000U], decoded, 3000U));
+    TEST_ASSERT_EQUAL_UINT32(6000U, enc.In);
+}
+
+/* ============================================================================ */
+/* SETUP AND DECODER ERROR TESTS */
+/* ============================================================================ */
+
+void test_init_rejects_bad_sizes(void)
+{
+    TEST_ASSERT_EQUAL(LZSS_INVALID, LZSS_EncoderInit(&enc, encWindow, 7U, frame, FRAME_SIZE));
+    TEST_ASSERT_EQUAL(LZSS_INVALID, LZSS_EncoderInit(&enc, encWindow, 12U, frame, FRAME_SIZE));
+    TEST_ASSERT_EQUAL(LZSS_INVALID, LZSS_EncoderInit(&enc, encWindow, 8U, frame, LZSS_ITEM_MAX - 1U));
+    TEST_ASSERT_EQUAL(LZSS_INVALID, LZSS_DecoderInit(&dec, decWindow, 7U));
+    TEST_ASSERT_EQUAL(LZSS_INVALID, LZSS_DecoderInit(&dec, decWindow, 12U));
+}
+
+void test_decoder_rejects_match_before_start(void)
+{
+    /* A literal, then a match 2 back */
+    static const uint8_t bad[] = { 0x02U, 'x', 0x01U, 0x00U };
+    uint32_t produced;
+
+    TEST_ASSERT_EQUAL(LZSS_OK, LZSS_DecoderInit(&dec, decWindow, 8U));
+    TEST_ASSERT_EQUAL(LZSS_CORRUPT, LZSS_Decode(&dec, bad, sizeof(bad), decoded, 100U, &produced));
+    TEST_ASSERT_EQUAL_UINT32(1U, produced);
+}
+
+void test_decoder_rejects_cut_match(void)
+{
+    static const uint8_t cut[] = { 0x02U, 'x', 0x00U };
+    uint32_t produced;
+
+    TEST_ASSERT_EQUAL(LZSS_OK, LZSS_DecoderInit(&dec, decWindow, 8U));
+    TEST_ASSERT_EQUAL(LZSS_CORRUPT, LZSS_Decode(&dec, cut, sizeof(cut), decoded, 100U, &produced));
+}
+
+void test_decoder_stops_when_output_full(void)
+{
+    /* "x", then 3 + 5 more at distance 1 */
+    static const uint8_t run[] = { 0x02U, 'x', 0x00U, 0x05U };
+    uint32_t produced;
+
+    TEST_ASSERT_EQUAL(LZSS_OK, LZSS_DecoderInit(&dec, decWindow, 8U));
+    TEST_ASSERT_EQUAL(LZSS_FULL, LZSS_Decode(&dec, run, sizeof(run), decoded, 8U, &produced));
+    TEST_ASSERT_EQUAL_UINT32(1U, produced);
+    TEST_ASSERT_EQUAL(LZSS_OK, LZSS_DecoderInit(&dec, decWindow, 8U));
+    TEST_ASSERT_EQUAL(LZSS_OK, LZSS_Decode(&dec, run, sizeof(run), decoded, 9U, &produced));
+    TEST_ASSERT_EQUAL_UINT32(9U, produced);
+    TEST_ASSERT_EQUAL_INT(0, memcmp("xxxxxxxxx", decoded, 9U));
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Log Corpus Tests */
+    RUN_TEST(test_console_log_round_trip_all_windows);
+    RUN_TEST(test_telemetry_log_round_trip_all_windows);
+    RUN_TEST(test_one_write_compresses_better_than_lines);
+
+    /* Streaming Tests */
+    RUN_TEST(test_byte_at_a_time_matches_one_write);
+    RUN_TEST(test_smallest_output_buffer);
+    RUN_TEST(test_runs_overlap_their_own_output);
+    RUN_TEST(test_random_data_within_bound);
+    RUN_TEST(test_long_stream_past_16_bit_positions);
+    RUN_TEST(test_reset_starts_a_stream_of_its_own);
+
+    /* Setup And Decoder Error Tests */
+    RUN_TEST(test_init_rejects_bad_sizes);
+    RUN_TEST(test_decoder_rejects_match_before_start);
+    RUN_TEST(test_decoder_rejects_cut_match);
+    RUN_TEST(test_decoder_stops_when_output_full);
+
+    return UNITY_END();
+}
@@ -0,0 +1,516 @@
+/**
+  ******************************************************************************
+  * @file    test_modbus.c
+  * @author  Test Framework
+  * @brief   Unit tests for the Modbus RTU slave protocol engine
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "modbus.h"
+#include <string.h>
+#include <stdarg.h>
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+#define SLAVE       0x11U
+#define GUARD       0x5AU
+
+static MODBUS_SlaveTypeDef slave;
+static uint16_t holding[8];
+static uint16_t setpoint;
+static uint32_t writes;
+static uint8_t  out_of_range;
+static uint8_t  response[MODBUS_ADU_MAX + 16U];
+
+static uint16_t ReadStatus(uint16_t index)
+{
+    out_of_range |= (index >= 4U);
+    return (uint16_t)(0x1000U + index);
+}
+
+static uint16_t ReadHolding(uint16_t index)
+{
+    out_of_range |= (index >= 8U);
+    return holding[index & 7U];
+}
+
+static uint8_t WriteHolding(uint16_t index, uint16_t value)
+{
+    out_of_range |= (index >= 8U);
+    if (value == 0xFFFFU)
+    {
+        return MODBUS_EX_VALUE;
+    }
+    holding[index & 7U] = value;
+    writes++;
+    return 0U;
+}
+
+static uint16_t ReadLimits(uint16_t index)
+{
+    out_of_range |= (index >= 2U);
+    return (uint16_t)(0x2000U + index);
+}
+
+static uint16_t ReadSetpoint(uint16_t index)
+{
+    out_of_range |= (index != 0U);
+    return setpoint;
+}
+
+static uint8_t WriteSetpoint(uint16_t index, uint16_t value)
+{
+    out_of_range |= (index != 0U);
+    setpoint = value;
+    writes++;
+    return 0U;
+}
+
+/* 0x0000-0x0003 RO, 0x0010-0x0017 RW, 0x0018-0x0019 RO, 0x1000 RW */
+static const MODBUS_RegionTypeDef regions[] =
+{
+    { 0x0000U, 4U, ReadStatus, NULL },
+    { 0x0010U, 8U, ReadHolding, WriteHolding },
+    { 0x0018U, 2U, ReadLimits, NULL },
+    { 0x1000U, 1U, ReadSetpoint, WriteSetpoint },
+};
+
+void setUp(void)
+{
+    memset(holding, 0, sizeof(holding));
+    memset(response, GUARD, sizeof(response));
+    setpoint = 0U;
+    writes = 0U;
+    out_of_range = 0U;
+    TEST_ASSERT_EQUAL_UINT8(MODBUS_OK, MODBUS_Init(&slave, SLAVE, regions, 4U));
+}
+
+void tearDown(void)
+{
+}
+
+/** Build a frame from its bytes before the CRC, run it, check the response CRC */
+static uint32_t Send(uint32_t count, ...)
+{
+    uint8_t request[MODBUS_ADU_MAX];
+    uint16_t crc;
+    uint32_t length;
+    uint32_t i;
+    va_list args;
+
+    va_start(args, count);
+    for (i = 0U; i < count; i++)
+    {
+        request[i] = (uint8_t)va_arg(args, int);
+    }
+    va_end(args);
+    crc = MODBUS_Crc16(request, count);
+    request[count] = (uint8_t)crc;
+    request[count + 1U] = (uint8_t)(crc >> 8);
+
+    memset(response, GUARD, sizeof(response));
+    length = MODBUS_Process(&slave, request, count + 2U, response);
+    if (length != 0U)
+    {
+        crc = MODBUS_Crc16(response, length - 2U);
+        TEST_ASSERT_EQUAL_UINT8((uint8_t)crc, response[length - 2U]);
+        TEST_ASSERT_EQUAL_UINT8((uint8_t)(crc >> 8), response[length - 1U]);
+    }
+    TEST_ASSERT_EQUAL_UINT8(GUARD, response[length]);
+    return length;
+}
+
+static uint16_t Word(uint32_t offset)
+{
+    return (uint16_t)((response[offset] << 8) | response[offset + 1U]);
+}
+
+static void AssertException(uint8_t function, uint8_t code, uint32_t length)
+{
+    TEST_ASSERT_EQUAL_UINT32(5U, length);
+    TEST_ASSERT_EQUAL_UINT8(SLAVE, response[0]);
+    TEST_ASSERT_EQUAL_UINT8(function | 0x80U, response[1]);
+    TEST_ASSERT_EQUAL_UINT8(code, response[2]);
+}
+
+/* ============================================================================ */
+/* CRC AND TIMING TESTS */
+/* ============================================================================ */
+
+void test_crc_known_frame(void)
+{
+    const uint8_t frame[] = { 0x01U, 0x03U, 0x00U, 0x00U, 0x00U, 0x0AU };
+
+    // Sent on the wire as C5 CD
+    TEST_ASSERT_EQUAL_HEX32(0xCDC5U, MODBUS_Crc16(frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFU, MODBUS_Crc16(frame, 0U));
+}
+
+void test_crc_matches_bitwise(void)
+{
+    uint8_t data[64];
+    uint16_t crc = 0xFFFFU;
+    uint32_t i;
+    uint32_t bit;
+
+    for (i = 0U; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t)((i * 37U) ^ 0xA5U);
+        crc ^= data[i];
+        for (bit = 0U; bit < 8U; bit++)
+        {
+            crc = ((crc & 1U) != 0U) ? (uint16_t)((crc >> 1) ^ 0xA001U) : (uint16_t)(crc >> 1);
+        }
+    }
+    TEST_ASSERT_EQUAL_HEX32(crc, MODBUS_Crc16(data, sizeof(data)));
+}
+
+void test_timing_slow_and_fast(void)
+{
+    MODBUS_TimingTypeDef timing;
+
+    // 9600 8E1: 1145.8 us a character
+    MODBUS_Timing(9600U, 11U, &timing);
+    TEST_ASSERT_EQUAL_UINT32(1146U, timing.CharUs);
+    TEST_ASSERT_EQUAL_UINT32(1719U, timing.T15Us);
+    TEST_ASSERT_EQUAL_UINT32(4011U, timing.T35Us);
+
+    MODBUS_Timing(19200U, 11U, &timing);
+    TEST_ASSERT_EQUAL_UINT32(860U, timing.T15Us);
+    TEST_ASSERT_EQUAL_UINT32(2006U, timing.T35Us);
+
+    // Fixed above 19200
+    MODBUS_Timing(115200U, 11U, &timing);
+    TEST_ASSERT_EQUAL_UINT32(96U, timing.CharUs);
+    TEST_ASSERT_EQUAL_UINT32(750U, timing.T15Us);
+    TEST_ASSERT_EQUAL_UINT32(1750U, timing.T35Us);
+}
+
+/* ============================================================================ */
+/* MAP TESTS */
+/* ============================================================================ */
+
+void test_init_rejects_bad_maps(void)
+{
+    MODBUS_SlaveTypeDef other;
+    const MODBUS_RegionTypeDef unsorted[] = { { 0x10U, 1U, ReadStatus, NULL }, { 0x08U, 1U, ReadStatus, NULL } };
+    const MODBUS_RegionTypeDef overlap[] = { { 0x10U, 4U, ReadStatus, NULL }, { 0x13U, 1U, ReadStatus, NULL } };
+    const MODBUS_RegionTypeDef empty[] = { { 0x10U, 0U, ReadStatus, NULL } };
+    const MODBUS_RegionTypeDef wrap[] = { { 0xFFFFU, 2U, ReadStatus, NULL } };
+    const MODBUS_RegionTypeDef last[] = { { 0xFFFFU, 1U, ReadStatus, NULL } };
+
+    TEST_ASSERT_EQUAL_UINT8(MODBUS_INVALID, MODBUS_Init(&other, 1U, unsorted, 2U));
+    TEST_ASSERT_EQUAL_UINT8(MODBUS_INVALID, MODBUS_Init(&other, 1U, overlap, 2U));
+    TEST_ASSERT_EQUAL_UINT8(MODBUS_INVALID, MODBUS_Init(&other, 1U, empty, 1U));
+    TEST_ASSERT_EQUAL_UINT8(MODBUS_INVALID, MODBUS_Init(&other, 1U, wrap, 1U));
+    TEST_ASSERT_EQUAL_UINT8(MODBUS_OK, MODBUS_Init(&other, 1U, last, 1U));
+    TEST_ASSERT_EQUAL_UINT8(MODBUS_INVALID, MODBUS_Init(&other, MODBUS_BROADCAST, regions, 4U));
+    TEST_ASSERT_EQUAL_UINT8(MODBUS_INVALID, MODBUS_Init(&other, 248U, regions, 4U));
+}
+
+void test_find_matches_linear_search(void)
+{
+    MODBUS_RegionTypeDef many[100];
+    MODBUS_SlaveTypeDef other;
+    const MODBUS_RegionTypeDef *expect;
+    uint32_t address;
+    uint32_t i;
+    uint32_t n;
+
+    // Arrange: regions of 1 to 5 registers with gaps of 0 to 3
+    for (i = 0U, address = 3U; i < 100U; i++)
+    {
+        many[i].Address = (uint16_t)address;
+        many[i].Count = (uint16_t)(1U + (i % 5U));
+        many[i].Read = ReadStatus;
+        many[i].Write = NULL;
+        address += many[i].Count + ((i * 7U) % 4U);
+    }
+
+    for (n = 0U; n <= 100U; n += 25U)
+    {
+        TEST_ASSERT_EQUAL_UINT8(MODBUS_OK, MODBUS_Init(&other, 1U, many, n));
+        for (address = 0U; address < 0x10000U; address++)
+        {
+            expect = NULL;
+            for (i = 0U; i < n; i++)
+            {
+                if ((address >= many[i].Address) && (address < ((uint32_t)many[i].Address + many[i].Count)))
+                {
+                    expect = &many[i];
+                }
+            }
+            TEST_ASSERT_TRUE(MODBUS_Find(&other, (uint16_t)address) == expect);
+        }
+    }
+}
+
+/* ============================================================================ */
+/* READ TESTS */
+/* ============================================================================ */
+
+void test_read_across_regions(void)
+{
+    uint32_t length;
+    uint32_t i;
+
+    for (i = 0U; i < 8U; i++)
+    {
+        holding[i] = (uint16_t)(0x0100U * i + 7U);
+    }
+
+    // Act: 0x0010-0x0019 spans the holding block and the limits
+    length = Send(6U, SLAVE, 0x03, 0x00, 0x10, 0x00, 0x0A);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(5U + 20U, length);
+    TEST_ASSERT_EQUAL_UINT8(SLAVE, response[0]);
+    TEST_ASSERT_EQUAL_UINT8(0x03U, response[1]);
+    TEST_ASSERT_EQUAL_UINT8(20U, response[2]);
+    for (i = 0U; i < 8U; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT16(holding[i], Word(3U + 2U * i));
+    }
+    TEST_ASSERT_EQUAL_UINT16(0x2000U, Word(19U));
+    TEST_ASSERT_EQUAL_UINT16(0x2001U, Word(21U));
+    TEST_ASSERT_FALSE(out_of_range);
+}
+
+void test_read_input_registers_share_the_map(void)
+{
+    uint32_t length = Send(6U, SLAVE, 0x04, 0x00, 0x02, 0x00, 0x02);
+
+    TEST_ASSERT_EQUAL_UINT32(9U, length);
+    TEST_ASSERT_EQUAL_UINT8(0x04U, response[1]);
+    TEST_ASSERT_EQUAL_UINT16(0x1002U, Word(3U));
+    TEST_ASSERT_EQUAL_UINT16(0x1003U, Word(5U));
+}
+
+void test_read_exceptions(void)
+{
+    // A gap at 0x0004-0x000F
+    AssertException(0x03U, MODBUS_EX_ADDRESS, Send(6U, SLAVE, 0x03, 0x00, 0x02, 0x00, 0x04));
+    AssertException(0x03U, MODBUS_EX_ADDRESS, Send(6U, SLAVE, 0x03, 0x00, 0x1A, 0x00, 0x01));
+    AssertException(0x03U, MODBUS_EX_ADDRESS, Send(6U, SLAVE, 0x03, 0xFF, 0xFF, 0x00, 0x02));
+    // Quantity 0 and 126, and a short PDU
+    AssertException(0x03U, MODBUS_EX_VALUE, Send(6U, SLAVE, 0x03, 0x00, 0x00, 0x00, 0x00));
+    AssertException(0x03U, MODBUS_EX_VALUE, Send(6U, SLAVE, 0x03, 0x00, 0x00, 0x00, 0x7E));
+    AssertException(0x03U, MODBUS_EX_VALUE, Send(5U, SLAVE, 0x03, 0x00, 0x00, 0x00));
+    TEST_ASSERT_EQUAL_UINT16(6U, slave.Exceptions);
+}
+
+/* ============================================================================ */
+/* WRITE TESTS */
+/* ============================================================================ */
+
+void test_write_single_echoes(void)
+{
+    uint32_t length = Send(6U, SLAVE, 0x06, 0x10, 0x00, 0xBE, 0xEF);
+
+    TEST_ASSERT_EQUAL_UINT32(8U, length);
+    TEST_ASSERT_EQUAL_UINT8(0x06U, response[1]);
+    TEST_ASSERT_EQUAL_UINT16(0x1000U, Word(2U));
+    TEST_ASSERT_EQUAL_UINT16(0xBEEFU, Word(4U));
+    TEST_ASSERT_EQUAL_UINT16(0xBEEFU, setpoint);
+}
+
+void test_write_single_exceptions(void)
+{
+    AssertException(0x06U, MODBUS_EX_ADDRESS, Send(6U, SLAVE, 0x06, 0x00, 0x01, 0x00, 0x01));
+    AssertException(0x06U, MODBUS_EX_ADDRESS, Send(6U, SLAVE, 0x06, 0x20, 0x00, 0x00, 0x01));
+    // The map refuses the value
+    AssertException(0x06U, MODBUS_EX_VALUE, Send(6U, SLAVE, 0x06, 0x00, 0x12, 0xFF, 0xFF));
+    TEST_ASSERT_EQUAL_UINT32(0U, writes);
+}
+
+void test_write_multiple(void)
+{
+    uint32_t length = Send(13U, SLAVE, 0x10, 0x00, 0x14, 0x00, 0x03, 0x06,
+                           0x00, 0x01, 0x00, 0x02, 0x00, 0x03);
+
+    TEST_ASSERT_EQUAL_UINT32(8U, length);
+    TEST_ASSERT_EQUAL_UINT16(0x0014U, Word(2U));
+    TEST_ASSERT_EQUAL_UINT16(3U, Word(4U));
+    TEST_ASSERT_EQUAL_UINT16(1U, holding[4]);
+    TEST_ASSERT_EQUAL_UINT16(2U, holding[5]);
+    TEST_ASSERT_EQUAL_UINT16(3U, holding[6]);
+}
+
+void test_write_multiple_checks_the_whole_range_first(void)
+{
+    // 0x0016-0x0018: the last one is read-only
+    AssertException(0x10U, MODBUS_EX_ADDRESS, Send(13U, SLAVE, 0x10, 0x00, 0x16, 0x00, 0x03, 0x06,
+                                                   0x00, 0x01, 0x00, 0x02, 0x00, 0x03));
+    TEST_ASSERT_EQUAL_UINT32(0U, writes);
+
+    // Byte count and frame length have to agree with the quantity
+    AssertException(0x10U, MODBUS_EX_VALUE, Send(11U, SLAVE, 0x10, 0x00, 0x10, 0x00, 0x02, 0x03,
+                                                 0x00, 0x01, 0x00, 0x02));
+    AssertException(0x10U, MODBUS_EX_VALUE, Send(10U, SLAVE, 0x10, 0x00, 0x10, 0x00, 0x02, 0x04,
+                                                 0x00, 0x01, 0x00));
+    AssertException(0x10U, MODBUS_EX_VALUE, Send(6U, SLAVE, 0x10, 0x00, 0x10, 0x00, 0x00));
+    TEST_ASSERT_EQUAL_UINT32(0U, writes);
+}
+
+/* ============================================================================ */
+/* ADDRESSING AND DIAGNOSTICS TESTS */
+/* ============================================================================ */
+
+void test_other_slaves_and_bad_frames_are_silent(void)
+{
+    uint8_t frame[8] = { SLAVE, 0x03U, 0x00U, 0x00U, 0x00U, 0x01U, 0x00U, 0x00U };
+
+    TEST_ASSERT_EQUAL_UINT32(0U, Send(6U, SLAVE + 1U, 0x03, 0x00, 0x00, 0x00, 0x01));
+    TEST_ASSERT_EQUAL_UINT32(0U, MODBUS_Process(&slave, frame, sizeof(frame), response));
+    TEST_ASSERT_EQUAL_UINT32(0U, MODBUS_Process(&slave, frame, 3U, response));
+    TEST_ASSERT_EQUAL_UINT16(1U, slave.BusMessages);
+    TEST_ASSERT_EQUAL_UINT16(2U, slave.CrcErrors);
+    TEST_ASSERT_EQUAL_UINT16(0U, slave.SlaveMessages);
+}
+
+void test_broadcast_writes_without_answer(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(0U, Send(6U, MODBUS_BROADCAST, 0x06, 0x10, 0x00, 0x12, 0x34));
+    TEST_ASSERT_EQUAL_UINT16(0x1234U, setpoint);
+
+    // Reads, diagnostics and errors stay unanswered too
+    TEST_ASSERT_EQUAL_UINT32(0U, Send(6U, MODBUS_BROADCAST, 0x03, 0x00, 0x00, 0x00, 0x01));
+    TEST_ASSERT_EQUAL_UINT32(0U, Send(6U, MODBUS_BROADCAST, 0x08, 0x00, 0x0A, 0x00, 0x00));
+    TEST_ASSERT_EQUAL_UINT32(0U, Send(6U, MODBUS_BROADCAST, 0x06, 0x00, 0x00, 0x00, 0x01));
+    TEST_ASSERT_EQUAL_UINT16(4U, slave.NoResponses);
+    TEST_ASSERT_EQUAL_UINT16(4U, slave.SlaveMessages);
+    TEST_ASSERT_EQUAL_UINT16(0U, slave.Exceptions);
+}
+
+void test_diagnostics(void)
+{
+    uint32_t length;
+
+    // Echo returns the request unchanged
+    length = Send(8U, SLAVE, 0x08, 0x00, 0x00, 0xA5, 0x37, 0x01, 0x02);
+    TEST_ASSERT_EQUAL_UINT32(10U, length);
+    TEST_ASSERT_EQUAL_UINT16(0xA537U, Word(4U));
+    TEST_ASSERT_EQUAL_UINT16(0x0102U, Word(6U));
+
+    (void)Send(6U, SLAVE, 0x2B, 0x0E, 0x01, 0x00, 0x00);
+    length = Send(6U, SLAVE, 0x08, 0x00, 0x0D, 0x00, 0x00);
+    TEST_ASSERT_EQUAL_UINT32(8U, length);
+    TEST_ASSERT_EQUAL_UINT16(0x000DU, Word(2U));
+    TEST_ASSERT_EQUAL_UINT16(1U, Word(4U));
+    length = Send(6U, SLAVE, 0x08, 0x00, 0x0B, 0x00, 0x00);
+    TEST_ASSERT_EQUAL_UINT16(4U, Word(4U));
+
+    // Clear, then the counters start from this request
+    (void)Send(6U, SLAVE, 0x08, 0x00, 0x0A, 0x00, 0x00);
+    length = Send(6U, SLAVE, 0x08, 0x00, 0x0E, 0x00, 0x00);
+    TEST_ASSERT_EQUAL_UINT16(1U, Word(4U));
+
+    AssertException(0x08U, MODBUS_EX_FUNCTION, Send(6U, SLAVE, 0x08, 0x00, 0x63, 0x00, 0x00));
+    AssertException(0x08U, MODBUS_EX_VALUE, Send(6U, SLAVE, 0x08, 0x00, 0x0B, 0x00, 0x01));
+    AssertException(0x2BU, MODBUS_EX_FUNCTION, Send(2U, SLAVE, 0x2B));
+}
+
+/* ============================================================================ */
+/* FUZZ TESTS */
+/* ============================================================================ */
+
+void test_random_frames_keep_the_response_well_formed(void)
+{
+    static const uint8_t functions[] = { 0x03U, 0x04U, 0x06U, 0x08U, 0x10U, 0x2BU };
+    uint8_t request[MODBUS_ADU_MAX + 4U];
+    uint32_t seed = 12345U;
+    uint32_t length;
+    uint32_t n;
+    uint32_t i;
+    uint16_t crc;
+
+    for (n = 0U; n < 200000U; n++)
+    {
+        // Arrange: random bytes, mostly with a valid CRC, our address and a
+        // known function, with small addresses and quantities half the time
+        seed = seed * 1103515245U + 12345U;
+        length = (seed >> 8) % (MODBUS_ADU_MAX + 4U);
+        for (i = 0U; i < length; i++)
+        {
+            seed = seed * 1103515245U + 12345U;
+            request[i] = (uint8_t)(seed >> 16);
+            if (((n & 1U) != 0U) && (i >= 2U) && (i < 6U) && ((i & 1U) == 0U))
+            {
+                request[i] = 0U;
+            }
+        }
+        if ((length >= 4U) && (length <= MODBUS_ADU_MAX) && ((n % 8U) != 0U))
+        {
+            request[0] = ((n % 16U) == 1U) ? MODBUS_BROADCAST : SLAVE;
+            request[1] = functions[(seed >> 4) % sizeof(functions)];
+            crc = MODBUS_Crc16(request, length - 2U);
+            request[length - 2U] = (uint8_t)crc;
+            request[length - 1U] = (uint8_t)(crc >> 8);
+        }
+        memset(response, GUARD, sizeof(response));
+
+        // Act
+        length = MODBUS_Process(&slave, request, length, response);
+
+        // Assert
+        TEST_ASSERT_TRUE(length <= MODBUS_ADU_MAX);
+        for (i = MODBUS_ADU_MAX; i < sizeof(response); i++)
+        {
+            TEST_ASSERT_EQUAL_UINT8(GUARD, response[i]);
+        }
+        if (length != 0U)
+        {
+            TEST_ASSERT_TRUE(length >= 5U);
+            TEST_ASSERT_EQUAL_UINT8(SLAVE, response[0]);
+            TEST_ASSERT_EQUAL_UINT8(request[1], response[1] & 0x7FU);
+            TEST_ASSERT_TRUE(((response[1] & 0x80U) == 0U) || (length == 5U));
+            crc = MODBUS_Crc16(response, length - 2U);
+            TEST_ASSERT_EQUAL_UINT8((uint8_t)crc, response[length - 2U]);
+            TEST_ASSERT_EQUAL_UINT8((uint8_t)(crc >> 8), response[length - 1U]);
+        }
+        TEST_ASSERT_FALSE(out_of_range);
+    }
+    TEST_ASSERT_TRUE(writes > 0U);
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* CRC and Timing Tests */
+    RUN_TEST(test_crc_known_frame);
+    RUN_TEST(test_crc_matches_bitwise);
+    RUN_TEST(test_timing_slow_and_fast);
+
+    /* Map Tests */
+    RUN_TEST(test_init_rejects_bad_maps);
+    RUN_TEST(test_find_matches_linear_search);
+
+    /* Read Tests */
+    RUN_TEST(test_read_across_regions);
+    RUN_TEST(test_read_input_registers_share_the_map);
+    RUN_TEST(test_read_exceptions);
+
+    /* Write Tests */
+    RUN_TEST(test_write_single_echoes);
+    RUN_TEST(test_write_single_exceptions);
+    RUN_TEST(test_write_multiple);
+    RUN_TEST(test_write_multiple_checks_the_whole_range_first);
+
+    /* Addressing and Diagnostics Tests */
+    RUN_TEST(test_other_slaves_and_bad_frames_are_silent);
+    RUN_TEST(test_broadcast_writes_without_answer);
+    RUN_TEST(test_diagnostics);
+
+    /* Fuzz Tests */
+    RUN_TEST(test_random_frames_keep_the_response_well_formed);
+
+    return UNITY_END();
+}
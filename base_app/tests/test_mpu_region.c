@@ -0,0 +1,193 @@
+/**
+  ******************************************************************************
+  * @file    test_mpu_region.c
+  * @author  Test Framework
+  * @brief   Unit tests for MPU guard placement and the region table
+  ******************************************************************************
+  * Register values are checked against the ARMv7-M encoding written out by
+  * hand, so a mistake in the field macros shows up here and not as a guard
+  * that silently never faults.
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "mpu_region.h"
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+static MPU_REGION_TableTypeDef table;
+static MPU_REGION_FitTypeDef fit;
+
+void setUp(void)
+{
+    MPU_REGION_Init(&table);
+}
+
+void tearDown(void)
+{
+}
+
+/* ============================================================================ */
+/* PLACEMENT TESTS */
+/* ============================================================================ */
+
+void test_fit_aligned_block_takes_whole_region(void)
+{
+    TEST_ASSERT_EQUAL(MPU_REGION_OK, MPU_REGION_Fit(0x20001000UL, 0x20002000UL, 256U, &fit));
+
+    TEST_ASSERT_EQUAL_HEX32(0x20001000UL, fit.Base);
+    TEST_ASSERT_EQUAL_UINT8(8U, fit.SizeLog2);
+    TEST_ASSERT_EQUAL_HEX32(0x00U, fit.Disabled);
+    TEST_ASSERT_EQUAL_HEX32(0x20001000UL, fit.Start);
+    TEST_ASSERT_EQUAL_HEX32(0x20001100UL, fit.End);
+}
+
+void test_fit_unaligned_block_uses_subregions(void)
+{
+    // Arrange: an 8-byte aligned stack array, 128-byte guard
+    // Act
+    TEST_ASSERT_EQUAL(MPU_REGION_OK, MPU_REGION_Fit(0x20000408UL, 0x20000800UL, 128U, &fit));
+
+    // Assert: subregions 1-4 of the 256-byte region at 0x400, not the
+    // next 128-byte boundary at 0x480
+    TEST_ASSERT_EQUAL_HEX32(0x20000400UL, fit.Base);
+    TEST_ASSERT_EQUAL_UINT8(8U, fit.SizeLog2);
+    TEST_ASSERT_EQUAL_HEX32(0xE1U, fit.Disabled);
+    TEST_ASSERT_EQUAL_HEX32(0x20000420UL, fit.Start);
+    TEST_ASSERT_EQUAL_HEX32(0x200004A0UL, fit.End);
+}
+
+void test_fit_crossing_region_boundary_moves_up(void)
+{
+    // Four 32-byte subregions from 0x4E0 would run into the next 256 bytes
+    TEST_ASSERT_EQUAL(MPU_REGION_OK, MPU_REGION_Fit(0x200004E0UL, 0x20000800UL, 128U, &fit));
+
+    TEST_ASSERT_EQUAL_HEX32(0x20000500UL, fit.Start);
+    TEST_ASSERT_EQUAL_HEX32(0x20000580UL, fit.End);
+    TEST_ASSERT_EQUAL_UINT8(7U, fit.SizeLog2);
+    TEST_ASSERT_EQUAL_HEX32(0x00U, fit.Disabled);
+}
+
+void test_fit_rejects_bad_sizes_and_small_blocks(void)
+{
+    TEST_ASSERT_EQUAL(MPU_REGION_INVALID, MPU_REGION_Fit(0x20000000UL, 0x20001000UL, 0U, &fit));
+    TEST_ASSERT_EQUAL(MPU_REGION_INVALID, MPU_REGION_Fit(0x20000000UL, 0x20001000UL, 48U, &fit));
+    TEST_ASSERT_EQUAL(MPU_REGION_NO_FIT, MPU_REGION_Fit(0x20000000UL, 0x20000040UL, 128U, &fit));
+    TEST_ASSERT_EQUAL(MPU_REGION_NO_FIT, MPU_REGION_Fit(0x20000008UL, 0x20000088UL, 128U, &fit));
+}
+
+void test_fit_block_at_top_of_address_space(void)
+{
+    TEST_ASSERT_EQUAL(MPU_REGION_OK, MPU_REGION_Fit(0xFFFFFF00UL, 0U, 256U, &fit));
+
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFF00UL, fit.Base);
+    TEST_ASSERT_EQUAL_HEX32(0U, fit.End);
+}
+
+/* ============================================================================ */
+/* TABLE TESTS */
+/* ============================================================================ */
+
+void test_null_guard_registers(void)
+{
+    TEST_ASSERT_EQUAL(MPU_REGION_OK,
+                      MPU_REGION_Add(&table, "null", MPU_REGION_NULL, 0U, 0x400U, 1024U));
+
+    // Region 0, 1 KB at 0: XN, no access, TEX 0 C, SIZE 9, enabled
+    TEST_ASSERT_EQUAL_UINT32(1U, table.Count);
+    TEST_ASSERT_EQUAL_HEX32(0x00000010UL, table.Entries[0].Rbar);
+    TEST_ASSERT_EQUAL_HEX32(0x10020013UL, table.Entries[0].Rasr);
+}
+
+void test_stack_guard_registers(void)
+{
+    (void)MPU_REGION_Add(&table, "null", MPU_REGION_NULL, 0U, 0x400U, 1024U);
+
+    TEST_ASSERT_EQUAL(MPU_REGION_OK,
+                      MPU_REGION_Add(&table, "app", MPU_REGION_STACK, 0x20000408UL, 0x20000800UL, 128U));
+
+    // Region 1: XN, read-only, TEX 1 C B, SRD 0xE1, SIZE 7, enabled
+    TEST_ASSERT_EQUAL_HEX32(0x20000411UL, table.Entries[1].Rbar);
+    TEST_ASSERT_EQUAL_HEX32(0x160BE10FUL, table.Entries[1].Rasr);
+    TEST_ASSERT_EQUAL_STRING("app", table.Entries[1].Name);
+    TEST_ASSERT_EQUAL_HEX32(0x20000420UL, table.Entries[1].Start);
+}
+
+void test_add_rejects_overlap_and_full_table(void)
+{
+    uint32_t i;
+
+    TEST_ASSERT_EQUAL(MPU_REGION_OK,
+                      MPU_REGION_Add(&table, "a", MPU_REGION_STACK, 0x20000408UL, 0x20000800UL, 128U));
+    TEST_ASSERT_EQUAL(MPU_REGION_OVERLAP,
+                      MPU_REGION_Add(&table, "b", MPU_REGION_STACK, 0x20000400UL, 0x20000800UL, 256U));
+    TEST_ASSERT_EQUAL(MPU_REGION_NO_FIT,
+                      MPU_REGION_Add(&table, "c", MPU_REGION_STACK, 0x20000400UL, 0x20000410UL, 32U));
+    TEST_ASSERT_EQUAL_UINT32(1U, table.Count);
+
+    for (i = 1U; i < MPU_REGION_COUNT; i++)
+    {
+        TEST_ASSERT_EQUAL(MPU_REGION_OK,
+                          MPU_REGION_Add(&table, "s", MPU_REGION_STACK, 0x20001000UL + (i * 0x100U),
+                                         0x20002000UL, 32U));
+        TEST_ASSERT_EQUAL_HEX32(i, table.Entries[i].Rbar & 0xFU);
+    }
+    TEST_ASSERT_EQUAL(MPU_REGION_FULL,
+                      MPU_REGION_Add(&table, "s", MPU_REGION_STACK, 0x20003000UL, 0x20004000UL, 32U));
+}
+
+/* ============================================================================ */
+/* LOOKUP TESTS */
+/* ============================================================================ */
+
+void test_find_hit_and_stacking_fault_below(void)
+{
+    const MPU_REGION_EntryTypeDef *null_guard;
+    const MPU_REGION_EntryTypeDef *app;
+
+    (void)MPU_REGION_Add(&table, "null", MPU_REGION_NULL, 0U, 0x400U, 1024U);
+    (void)MPU_REGION_Add(&table, "app", MPU_REGION_STACK, 0x20000408UL, 0x20000800UL, 128U);
+    null_guard = &table.Entries[0];
+    app = &table.Entries[1];
+
+    // Inside a guard
+    TEST_ASSERT_TRUE(null_guard == MPU_REGION_Find(&table, 0x0000000CUL));
+    TEST_ASSERT_TRUE(app == MPU_REGION_Find(&table, 0x20000440UL));
+
+    // SP left below a stack guard by a frame that could not be pushed
+    TEST_ASSERT_TRUE(app == MPU_REGION_Find(&table, 0x20000420UL - 0x20U));
+    TEST_ASSERT_TRUE(app == MPU_REGION_Find(&table, 0x20000420UL - MPU_REGION_FRAME_MAX));
+
+    // Elsewhere
+    TEST_ASSERT_NULL(MPU_REGION_Find(&table, 0x20000420UL - MPU_REGION_FRAME_MAX - 4U));
+    TEST_ASSERT_NULL(MPU_REGION_Find(&table, 0x200004A0UL));
+    TEST_ASSERT_NULL(MPU_REGION_Find(&table, 0x00000400UL));
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Placement Tests */
+    RUN_TEST(test_fit_aligned_block_takes_whole_region);
+    RUN_TEST(test_fit_unaligned_block_uses_subregions);
+    RUN_TEST(test_fit_crossing_region_boundary_moves_up);
+    RUN_TEST(test_fit_rejects_bad_sizes_and_small_blocks);
+    RUN_TEST(test_fit_block_at_top_of_address_space);
+
+    /* Table Tests */
+    RUN_TEST(test_null_guard_registers);
+    RUN_TEST(test_stack_guard_registers);
+    RUN_TEST(test_add_rejects_overlap_and_full_table);
+
+    /* Lookup Tests */
+    RUN_TEST(test_find_hit_and_stacking_fault_below);
+
+    return UNITY_END();
+}
@@ -0,0 +1,204 @@
+/**
+  ******************************************************************************
+  * @file    test_pin.c
+  * @author  Test Framework
+  * @brief   Unit tests for the header-only GPIO pin layer
+  ******************************************************************************
+  * The generated functions run against a mock GPIO_TypeDef in RAM. Writes to
+  * BSRR are not applied to ODR here, so every test checks the exact value the
+  * single store put there. Bit-banding is off on the host; the alias address
+  * math is checked on its own.
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "stm32f4xx_hal_mocks.h"
+#include "pin.h"
+#include <string.h>
+
+#define GPIOD_ODR_ADDR  0x40020C14UL
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+static GPIO_TypeDef port;
+
+PIN_DEFINE(Led, &port, 12U)
+PIN_DEFINE(Tx, &port, 9U)
+PIN_GROUP_DEFINE(Leds, &port, 0xF000UL)
+
+void setUp(void)
+{
+    memset((void *)&port, 0, sizeof(port));
+}
+
+void tearDown(void)
+{
+}
+
+/* ============================================================================ */
+/* SINGLE PIN TESTS */
+/* ============================================================================ */
+
+void test_set_reset_write_bsrr(void)
+{
+    Led_Set();
+    TEST_ASSERT_EQUAL_HEX32(0x00001000UL, port.BSRR);
+
+    Led_Reset();
+    TEST_ASSERT_EQUAL_HEX32(0x10000000UL, port.BSRR);
+
+    Led_Write(7U);
+    TEST_ASSERT_EQUAL_HEX32(0x00001000UL, port.BSRR);
+
+    Led_Write(0U);
+    TEST_ASSERT_EQUAL_HEX32(0x10000000UL, port.BSRR);
+
+    // ODR is never written
+    TEST_ASSERT_EQUAL_HEX32(0UL, port.ODR);
+}
+
+void test_read_idr(void)
+{
+    port.IDR = 0xEFFFUL;
+    TEST_ASSERT_EQUAL_UINT32(0U, Led_Read());
+
+    port.IDR = 0x1000UL;
+    TEST_ASSERT_EQUAL_UINT32(1U, Led_Read());
+}
+
+void test_toggle_from_odr(void)
+{
+    // Arrange: every other pin high
+    port.ODR = 0xEFFFUL;
+
+    // Act / Assert: low goes high
+    Led_Toggle();
+    TEST_ASSERT_EQUAL_HEX32(0x00001000UL, port.BSRR);
+
+    // High goes low
+    port.ODR = 0x1000UL;
+    Led_Toggle();
+    TEST_ASSERT_EQUAL_HEX32(0x10000000UL, port.BSRR);
+}
+
+void test_init_touches_only_its_fields(void)
+{
+    // Arrange
+    port.MODER   = 0xFFFFFFFFUL;
+    port.OSPEEDR = 0UL;
+    port.PUPDR   = 0xFFFFFFFFUL;
+    port.OTYPER  = 0UL;
+
+    // Act
+    Led_Init(PIN_MODE_OUTPUT, PIN_PULL_NONE, PIN_SPEED_VERY_HIGH, PIN_OTYPE_OD);
+
+    // Assert: pin 12 is bits 25:24 of the 2-bit registers
+    TEST_ASSERT_EQUAL_HEX32(0xFDFFFFFFUL, port.MODER);
+    TEST_ASSERT_EQUAL_HEX32(0x03000000UL, port.OSPEEDR);
+    TEST_ASSERT_EQUAL_HEX32(0xFCFFFFFFUL, port.PUPDR);
+    TEST_ASSERT_EQUAL_HEX32(0x00001000UL, port.OTYPER);
+}
+
+void test_alternate_function(void)
+{
+    port.AFR[0] = 0xFFFFFFFFUL;
+    port.AFR[1] = 0xFFFFFFFFUL;
+
+    Tx_Alternate(7U);
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFF7FUL, port.AFR[1]);
+
+    Led_Alternate(2U);
+    TEST_ASSERT_EQUAL_HEX32(0xFFF2FF7FUL, port.AFR[1]);
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFFUL, port.AFR[0]);
+}
+
+/* ============================================================================ */
+/* GROUP TESTS */
+/* ============================================================================ */
+
+void test_group_write_is_one_store(void)
+{
+    // Set two, clear the other two, ignore pins outside the group
+    Leds_Write(0x5001UL);
+    TEST_ASSERT_EQUAL_HEX32(0xA0005000UL, port.BSRR);
+
+    Leds_Set(0x8001UL);
+    TEST_ASSERT_EQUAL_HEX32(0x00008000UL, port.BSRR);
+
+    Leds_Reset(0x3000UL);
+    TEST_ASSERT_EQUAL_HEX32(0x30000000UL, port.BSRR);
+}
+
+void test_group_toggle_and_read(void)
+{
+    port.ODR = 0x3001UL;
+    Leds_Toggle(0xF000UL);
+    TEST_ASSERT_EQUAL_HEX32(0x3000C000UL, port.BSRR);
+
+    // Only the pins asked for
+    Leds_Toggle(0x1000UL);
+    TEST_ASSERT_EQUAL_HEX32(0x10000000UL, port.BSRR);
+
+    port.IDR = 0x9FFFUL;
+    TEST_ASSERT_EQUAL_HEX32(0x9000UL, Leds_Read());
+}
+
+void test_group_init(void)
+{
+    port.MODER = 0x000000FFUL;
+    port.OTYPER = 0xFFFFUL;
+
+    Leds_Init(PIN_MODE_OUTPUT, PIN_PULL_DOWN, PIN_SPEED_LOW, PIN_OTYPE_PP);
+
+    TEST_ASSERT_EQUAL_HEX32(0x550000FFUL, port.MODER);
+    TEST_ASSERT_EQUAL_HEX32(0xAA000000UL, port.PUPDR);
+    TEST_ASSERT_EQUAL_HEX32(0x0FFFUL, port.OTYPER);
+}
+
+/* ============================================================================ */
+/* MACRO TESTS */
+/* ============================================================================ */
+
+void test_spread(void)
+{
+    TEST_ASSERT_EQUAL_HEX32(0x00000000UL, PIN_SPREAD(0x0000UL));
+    TEST_ASSERT_EQUAL_HEX32(0x40000001UL, PIN_SPREAD(0x8001UL));
+    TEST_ASSERT_EQUAL_HEX32(0x55000000UL, PIN_SPREAD(0xF000UL));
+    TEST_ASSERT_EQUAL_HEX32(0x55555555UL, PIN_SPREAD(0x1FFFFUL));
+}
+
+void test_bitband_alias(void)
+{
+    // RM0090 2.3.3: alias = 0x42000000 + offset * 32 + bit * 4
+    TEST_ASSERT_EQUAL_HEX32(0x424182B8UL, PIN_BB_ADDR(GPIOD_ODR_ADDR, 14U));
+    TEST_ASSERT_EQUAL_HEX32(0x42000000UL, PIN_BB_ADDR(PIN_PERIPH_BASE, 0U));
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Single Pin Tests */
+    RUN_TEST(test_set_reset_write_bsrr);
+    RUN_TEST(test_read_idr);
+    RUN_TEST(test_toggle_from_odr);
+    RUN_TEST(test_init_touches_only_its_fields);
+    RUN_TEST(test_alternate_function);
+
+    /* Group Tests */
+    RUN_TEST(test_group_write_is_one_store);
+    RUN_TEST(test_group_toggle_and_read);
+    RUN_TEST(test_group_init);
+
+    /* Macro Tests */
+    RUN_TEST(test_spread);
+    RUN_TEST(test_bitband_alias);
+
+    return UNITY_END();
+}
@@ -0,0 +1,267 @@
+/**
+  ******************************************************************************
+  * @file    test_pulse.c
+  * @author  Test Framework
+  * @brief   Unit tests for the capture record ring and period/duty batches
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "pulse.h"
+#include <string.h>
+
+#define RECORDS        8U
+#define GUARD          1U
+#define MAX_PERIOD     1000U
+#define TICK_HZ        1000000U
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+static uint32_t buffer[RECORDS * PULSE_RECORD_WORDS];
+static PULSE_RingTypeDef ring;
+static PULSE_BatchTypeDef batch;
+static PULSE_ResultTypeDef result;
+static uint32_t written;
+
+void setUp(void)
+{
+    memset(buffer, 0, sizeof(buffer));
+    PULSE_RingInit(&ring, buffer, RECORDS, GUARD, MAX_PERIOD);
+    PULSE_BatchInit(&batch);
+    memset(&result, 0xA5, sizeof(result));
+    written = 0U;
+}
+
+void tearDown(void)
+{
+}
+
+/* Stand-in for the DMA burst on a rising edge: last fall, then the rise */
+static void Edge(uint32_t fall, uint32_t rise)
+{
+    uint32_t slot = (written % RECORDS) * PULSE_RECORD_WORDS;
+
+    buffer[slot]      = fall;
+    buffer[slot + 1U] = rise;
+    written++;
+}
+
+/* count rising edges period apart from start, each high for high ticks */
+static void Square(uint32_t start, uint32_t period, uint32_t high, uint32_t count)
+{
+    uint32_t i;
+
+    for (i = 0U; i < count; i++)
+    {
+        Edge(start + i * period - period + high, start + i * period);
+    }
+}
+
+/* ============================================================================ */
+/* RING TESTS */
+/* ============================================================================ */
+
+void test_take_nothing_written(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(0U, PULSE_Take(&ring, &batch, written));
+    TEST_ASSERT_EQUAL_UINT32(0U, batch.Periods);
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFU, PULSE_Idle(&ring, 1234U));
+}
+
+void test_first_edge_only_starts_a_period(void)
+{
+    Edge(0U, 500U);
+
+    TEST_ASSERT_EQUAL_UINT32(0U, PULSE_Take(&ring, &batch, written));
+    TEST_ASSERT_EQUAL_UINT32(1U, ring.Read);
+    TEST_ASSERT_EQUAL_UINT32(20U, PULSE_Idle(&ring, 520U));
+}
+
+void test_steady_square_wave(void)
+{
+    // Arrange: 100 ticks, 25 high
+    Square(1000U, 100U, 25U, 6U);
+
+    // Act
+    TEST_ASSERT_EQUAL_UINT32(5U, PULSE_Take(&ring, &batch, written));
+    PULSE_Result(&batch, TICK_HZ, &result);
+
+    // Assert: 10 kHz, no jitter, 25 %
+    TEST_ASSERT_EQUAL_UINT32(5U, result.Periods);
+    TEST_ASSERT_EQUAL_UINT32(10000000U, result.MilliHz);
+    TEST_ASSERT_EQUAL_UINT32(100U, result.Mean);
+    TEST_ASSERT_EQUAL_UINT32(100U, result.Min);
+    TEST_ASSERT_EQUAL_UINT32(100U, result.Max);
+    TEST_ASSERT_EQUAL_UINT32(0U, result.Jitter);
+    TEST_ASSERT_EQUAL_UINT16(250U, result.DutyPermille);
+}
+
+void test_take_continues_across_calls(void)
+{
+    Square(1000U, 100U, 50U, 3U);
+    TEST_ASSERT_EQUAL_UINT32(2U, PULSE_Take(&ring, &batch, written));
+
+    // The chain carries on from the last rise taken
+    Edge(1250U, 1300U);
+    TEST_ASSERT_EQUAL_UINT32(1U, PULSE_Take(&ring, &batch, written));
+    TEST_ASSERT_EQUAL_UINT32(3U, batch.Periods);
+    TEST_ASSERT_EQUAL_UINT32(100U, batch.Max);
+}
+
+void test_counter_wrap(void)
+{
+    // Act: the second rise is past the 32-bit wrap
+    Edge(0U, 0xFFFFFFC0U);
+    Edge(0xFFFFFFF0U, 0x00000024U);
+    PULSE_Take(&ring, &batch, written);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(1U, batch.Periods);
+    TEST_ASSERT_EQUAL_UINT32(100U, batch.Min);
+    TEST_ASSERT_EQUAL_UINT32(48U, (uint32_t)batch.HighSum);
+}
+
+void test_stale_fall_gives_no_duty(void)
+{
+    // No falling edge between the rises: CCR1 still holds an older one
+    Edge(900U, 1000U);
+    Edge(900U, 1100U);
+    Edge(1150U, 1200U);
+    PULSE_Take(&ring, &batch, written);
+    PULSE_Result(&batch, TICK_HZ, &result);
+
+    TEST_ASSERT_EQUAL_UINT32(2U, batch.Periods);
+    TEST_ASSERT_EQUAL_UINT32(1U, batch.Highs);
+    TEST_ASSERT_EQUAL_UINT16(500U, result.DutyPermille);
+}
+
+void test_gap_breaks_the_chain(void)
+{
+    // A stall longer than MAX_PERIOD, then the signal comes back
+    Edge(0U, 1000U);
+    Edge(1050U, 1000U + MAX_PERIOD + 1U);
+    Edge(2050U, 2101U);
+
+    TEST_ASSERT_EQUAL_UINT32(1U, PULSE_Take(&ring, &batch, written));
+    TEST_ASSERT_EQUAL_UINT32(1U, ring.Breaks);
+    TEST_ASSERT_EQUAL_UINT32(100U, batch.Min);
+}
+
+void test_lapped_reader_loses_records(void)
+{
+    // 12 records into a ring of 8: only the newest 7 are safe to read
+    Square(1000U, 100U, 10U, 12U);
+
+    TEST_ASSERT_EQUAL_UINT32(6U, PULSE_Take(&ring, &batch, written));
+    TEST_ASSERT_EQUAL_UINT32(5U, ring.Lost);
+    TEST_ASSERT_EQUAL_UINT32(12U, ring.Read);
+    TEST_ASSERT_EQUAL_UINT32(0U, ring.Breaks);
+}
+
+void test_resync_drops_pending_records(void)
+{
+    Square(1000U, 100U, 10U, 3U);
+    PULSE_Resync(&ring, written);
+
+    // The counter restarted: a period across it would be nonsense
+    Edge(5U, 20U);
+    Edge(70U, 120U);
+
+    TEST_ASSERT_EQUAL_UINT32(1U, PULSE_Take(&ring, &batch, written));
+    TEST_ASSERT_EQUAL_UINT32(100U, batch.Min);
+    TEST_ASSERT_EQUAL_UINT32(0U, ring.Breaks);
+}
+
+/* ============================================================================ */
+/* BATCH TESTS */
+/* ============================================================================ */
+
+void test_result_empty(void)
+{
+    PULSE_Result(&batch, TICK_HZ, &result);
+
+    TEST_ASSERT_EQUAL_UINT32(0U, result.Periods);
+    TEST_ASSERT_EQUAL_UINT32(0U, result.MilliHz);
+    TEST_ASSERT_EQUAL_UINT32(0U, result.Jitter);
+    TEST_ASSERT_EQUAL_UINT16(0U, result.DutyPermille);
+}
+
+void test_result_jitter_is_rms(void)
+{
+    uint32_t i;
+
+    // 90 and 110 alternating: mean 100, every deviation 10
+    for (i = 0U; i < 10U; i++)
+    {
+        PULSE_BatchAdd(&batch, (i & 1U) ? 110U : 90U, 0U);
+    }
+    PULSE_Result(&batch, TICK_HZ, &result);
+
+    TEST_ASSERT_EQUAL_UINT32(100U, result.Mean);
+    TEST_ASSERT_EQUAL_UINT32(90U, result.Min);
+    TEST_ASSERT_EQUAL_UINT32(110U, result.Max);
+    TEST_ASSERT_EQUAL_UINT32(10U, result.Jitter);
+    TEST_ASSERT_EQUAL_UINT16(0U, result.DutyPermille);
+}
+
+void test_result_frequency_rounding(void)
+{
+    // 2 MHz / 3 ticks = 666666.667 Hz
+    PULSE_BatchAdd(&batch, 3U, 1U);
+    PULSE_Result(&batch, 2000000U, &result);
+
+    TEST_ASSERT_EQUAL_UINT32(666666667U, result.MilliHz);
+    TEST_ASSERT_EQUAL_UINT16(333U, result.DutyPermille);
+}
+
+void test_result_slow_signal_keeps_millihertz(void)
+{
+    // 0.7 Hz at 2 MHz: 2857143 ticks a period
+    PULSE_BatchAdd(&batch, 2857143U, 1428571U);
+    PULSE_BatchAdd(&batch, 2857143U, 1428572U);
+    PULSE_Result(&batch, 2000000U, &result);
+
+    TEST_ASSERT_EQUAL_UINT32(700U, result.MilliHz);
+    TEST_ASSERT_EQUAL_UINT16(500U, result.DutyPermille);
+}
+
+void test_sqrt(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(0U, PULSE_Sqrt(0U));
+    TEST_ASSERT_EQUAL_UINT32(1U, PULSE_Sqrt(3U));
+    TEST_ASSERT_EQUAL_UINT32(2U, PULSE_Sqrt(4U));
+    TEST_ASSERT_EQUAL_UINT32(1000000U, PULSE_Sqrt(1000000000000ULL));
+    TEST_ASSERT_EQUAL_UINT32(999999U, PULSE_Sqrt(999999999999ULL));
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFU, PULSE_Sqrt(UINT64_MAX));
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Ring Tests */
+    RUN_TEST(test_take_nothing_written);
+    RUN_TEST(test_first_edge_only_starts_a_period);
+    RUN_TEST(test_steady_square_wave);
+    RUN_TEST(test_take_continues_across_calls);
+    RUN_TEST(test_counter_wrap);
+    RUN_TEST(test_stale_fall_gives_no_duty);
+    RUN_TEST(test_gap_breaks_the_chain);
+    RUN_TEST(test_lapped_reader_loses_records);
+    RUN_TEST(test_resync_drops_pending_records);
+
+    /* Batch Tests */
+    RUN_TEST(test_result_empty);
+    RUN_TEST(test_result_jitter_is_rms);
+    RUN_TEST(test_result_frequency_rounding);
+    RUN_TEST(test_result_slow_signal_keeps_millihertz);
+    RUN_TEST(test_sqrt);
+
+    return UNITY_END();
+}
@@ -0,0 +1,593 @@
+/**
+  ******************************************************************************
+  * @file    test_stack_depth.c
+  * @author  Test Framework
+  * @brief   Unit tests for the worst-case stack depth analysis
+  ******************************************************************************
+  * The inputs are written the way GCC writes them (-fstack-usage,
+  * -fcallgraph-info=su), cut down to a few functions whose depths are easy
+  * to add up by hand.
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "stack_depth.h"
+#include <string.h>
+
+/* ============================================================================ */
+/* TEST FIXTURES */
+/* ============================================================================ */
+
+typedef STACK_DEPTH_StatusTypeDef (*ParserTypeDef)(STACK_DEPTH_GraphTypeDef *graph, const char *line);
+
+#define LOAD(parse, lines)  Load((parse), (lines), sizeof(lines) / sizeof((lines)[0]))
+
+static STACK_DEPTH_GraphTypeDef graph;
+static char missing[STACK_DEPTH_NAME_MAX];
+static char text[STACK_DEPTH_LINE_MAX];
+
+/* main > Work > Leaf (static), Fast_IRQHandler > Work */
+static const char *const app_usage[] = {
+    "src/app.c:10:5:main\t16\tstatic\n",
+    "src/app.c:20:6:Work\t24\tstatic\n",
+    "src/app.c:30:13:Leaf\t8\tstatic\n",
+    "src/isr.c:5:6:Fast_IRQHandler\t32\tstatic\n",
+    "src/isr.c:9:6:Slow_IRQHandler\t16\tstatic\n",
+    "src/isr.c:12:6:Other_IRQHandler\t40\tstatic\n",
+};
+
+static const char *const app_graph[] = {
+    "graph: { title: \"src/app.c\"\n",
+    "node: { title: \"main\" label: \"main\\nsrc/app.c:10:5\\n16 bytes (static)\" }\n",
+    "node: { title: \"Work\" label: \"Work\\nsrc/app.c:20:6\\n24 bytes (static)\" }\n",
+    "node: { title: \"src/app.c:Leaf\" label: \"Leaf\\nsrc/app.c:30:13\\n8 bytes (static)\" }\n",
+    "edge: { sourcename: \"main\" targetname: \"src/app.c:Leaf\" label: \"src/app.c:11:3\" }\n",
+    "edge: { sourcename: \"main\" targetname: \"Work\" label: \"src/app.c:12:3\" }\n",
+    "edge: { sourcename: \"Work\" targetname: \"src/app.c:Leaf\" label: \"src/app.c:21:3\" }\n",
+    "}\n",
+    "graph: { title: \"src/isr.c\"\n",
+    "node: { title: \"Fast_IRQHandler\" label: \"Fast_IRQHandler\\nsrc/isr.c:5:6\\n32 bytes (static)\" }\n",
+    "node: { title: \"Work\" label: \"Work\\nsrc/app.h:3:6\" shape : ellipse }\n",
+    "edge: { sourcename: \"Fast_IRQHandler\" targetname: \"Work\" label: \"src/isr.c:6:3\" }\n",
+    "node: { title: \"Slow_IRQHandler\" label: \"Slow_IRQHandler\\nsrc/isr.c:9:6\\n16 bytes (static)\" }\n",
+    "node: { title: \"Other_IRQHandler\" label: \"Other_IRQHandler\\nsrc/isr.c:12:6\\n40 bytes (static)\" }\n",
+    "}\n",
+};
+
+static const char *const app_config[] = {
+    "# msp and its handlers\n",
+    "frame 104\n",
+    "stack msp 400 8\n",
+    "thread msp main\n",
+    "isr msp Fast_IRQHandler 2\n",
+    "isr msp Slow_IRQHandler 5   # shares a level\n",
+    "isr msp Other_IRQHandler 5\n",
+};
+
+void setUp(void)
+{
+    STACK_DEPTH_Init(&graph);
+    memset(missing, 0, sizeof(missing));
+}
+
+void tearDown(void)
+{
+}
+
+static void Load(ParserTypeDef parse, const char *const *lines, uint32_t count)
+{
+    STACK_DEPTH_StatusTypeDef status;
+    uint32_t i;
+
+    for (i = 0U; i < count; i++)
+    {
+        status = parse(&graph, lines[i]);
+        TEST_ASSERT_TRUE((status == STACK_DEPTH_OK) || (status == STACK_DEPTH_IGNORED));
+    }
+}
+
+static void LoadApp(void)
+{
+    LOAD(STACK_DEPTH_ParseConfig, app_config);
+    LOAD(STACK_DEPTH_ParseUsage, app_usage);
+    LOAD(STACK_DEPTH_ParseGraph, app_graph);
+}
+
+static const STACK_DEPTH_FuncTypeDef *Func(const char *name)
+{
+    int32_t index = STACK_DEPTH_Find(&graph, name);
+
+    TEST_ASSERT_TRUE(index >= 0);
+    return &graph.Funcs[index];
+}
+
+static const char *Line(uint32_t line)
+{
+    (void)STACK_DEPTH_FormatLine(&graph, line, text, sizeof(text));
+    return text;
+}
+
+/* ============================================================================ */
+/* PARSER TESTS */
+/* ============================================================================ */
+
+void test_usage_line_location_size_and_kind(void)
+{
+    // Act
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseUsage(&graph, "src/a.c:10:5:main\t16\tstatic\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseUsage(&graph, "src/a.c:20:6:Vla\t48\tdynamic\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseUsage(&graph, "src/a.c:30:6:Fixed\t64\tdynamic,bounded"));
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(3U, graph.UsageCount);
+    TEST_ASSERT_EQUAL_STRING("src/a.c:10:5", graph.Usage[0].Location);
+    TEST_ASSERT_EQUAL_UINT32(16U, graph.Usage[0].Value);
+    TEST_ASSERT_EQUAL_UINT8(0U, graph.Usage[0].Dynamic);
+    TEST_ASSERT_EQUAL_UINT8(1U, graph.Usage[1].Dynamic);
+    TEST_ASSERT_EQUAL_UINT8(0U, graph.Usage[2].Dynamic);
+}
+
+void test_malformed_lines_rejected(void)
+{
+    TEST_ASSERT_EQUAL(STACK_DEPTH_IGNORED, STACK_DEPTH_ParseUsage(&graph, " \r\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_SYNTAX, STACK_DEPTH_ParseUsage(&graph, "main 16 static\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_SYNTAX, STACK_DEPTH_ParseUsage(&graph, "src/a.c:10:5:main\tstatic\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_IGNORED, STACK_DEPTH_ParseGraph(&graph, "graph: { title: \"a.c\"\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_SYNTAX, STACK_DEPTH_ParseGraph(&graph, "node: { label: \"main\" }\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_SYNTAX, STACK_DEPTH_ParseGraph(&graph, "edge: { sourcename: \"main\" }\n"));
+    TEST_ASSERT_EQUAL_UINT32(0U, graph.UsageCount);
+}
+
+void test_image_frame_calls_and_flags(void)
+{
+    static const char *const lines[] = {
+        "\n",
+        "build/app.elf:     file format elf32-littlearm\n",
+        "Disassembly of section .text:\n",
+        "08000188 <_svfprintf_r>:\n",
+        " 8000188:\tpush\t{r4, r5, r6, r7, r8, lr}\n",
+        " 800018a:\tvpush\t{d8-d9}\n",
+        " 800018c:\tsub\tsp, #100\t; 0x64\n",
+        " 800018e:\tsub.w\tsp, sp, #256\t; 0x100\n",
+        " 8000190:\tbl\t8000200 <_dtoa_r>\n",
+        " 8000194:\tbeq.n\t8000188 <_svfprintf_r>\n",
+        " 8000196:\tb.n\t800018c <_svfprintf_r+0x4>\n",
+        " 8000198:\tbx\tlr\n",
+        "\n",
+        "08000200 <_dtoa_r>:\n",
+        " 8000200:\tstmdb\tsp!, {r4, r5, r6, r7, r8, r9, sl, fp, lr}\n",
+        " 8000204:\tstr.w\tlr, [sp, #-4]!\n",
+        " 8000208:\tsub\tsp, r3\n",
+        " 800020a:\tblx\tr3\n",
+        " 800020c:\tb.w\t8000300 <memcpy>\n",
+        "\t...\n",
+    };
+
+    // Act
+    LOAD(STACK_DEPTH_ParseImage, lines);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(2U, graph.ImageCount);
+    TEST_ASSERT_EQUAL_STRING("_svfprintf_r", graph.Image[0].Name);
+    TEST_ASSERT_EQUAL_HEX32(0x08000188U, graph.Image[0].Address);
+    TEST_ASSERT_EQUAL_UINT32(24U + 16U + 100U + 256U, graph.Image[0].Size);
+    TEST_ASSERT_EQUAL_UINT32(1U, graph.Image[0].CallCount);
+    TEST_ASSERT_EQUAL_HEX32(0x08000200U, graph.ImageCalls[graph.Image[0].FirstCall]);
+    TEST_ASSERT_EQUAL_HEX32(0U, graph.Image[0].Flags);
+    TEST_ASSERT_EQUAL_UINT32(36U + 4U, graph.Image[1].Size);
+    TEST_ASSERT_EQUAL_UINT32(1U, graph.Image[1].CallCount);
+    TEST_ASSERT_EQUAL_HEX32(0x08000300U, graph.ImageCalls[graph.Image[1].FirstCall]);
+    TEST_ASSERT_EQUAL_HEX32(STACK_DEPTH_DYNAMIC | STACK_DEPTH_INDIRECT, graph.Image[1].Flags);
+    TEST_ASSERT_EQUAL(STACK_DEPTH_SYNTAX, STACK_DEPTH_ParseImage(&graph, "08000400 <broken\n"));
+}
+
+void test_config_directives_and_errors(void)
+{
+    // Arrange / Act
+    TEST_ASSERT_EQUAL(STACK_DEPTH_IGNORED, STACK_DEPTH_ParseConfig(&graph, "  # comment only\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_NOT_FOUND, STACK_DEPTH_ParseConfig(&graph, "isr msp NMI_Handler -2\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "frame 72\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "stack msp 1024\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "isr msp NMI_Handler -2\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "call Run_* A B C\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "extern memcpy 16\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_SYNTAX, STACK_DEPTH_ParseConfig(&graph, "stack app lots\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_SYNTAX, STACK_DEPTH_ParseConfig(&graph, "isr msp X_IRQHandler high\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_SYNTAX, STACK_DEPTH_ParseConfig(&graph, "call Lonely\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_SYNTAX, STACK_DEPTH_ParseConfig(&graph, "heap 4096\n"));
+
+    // Assert: one link per callee, the extern last
+    TEST_ASSERT_EQUAL_UINT32(72U, graph.Frame);
+    TEST_ASSERT_EQUAL_UINT32(1U, graph.StackCount);
+    TEST_ASSERT_EQUAL_UINT32(1024U, graph.Stacks[0].Budget);
+    TEST_ASSERT_EQUAL_UINT32(0U, graph.Stacks[0].Reserve);
+    TEST_ASSERT_EQUAL_UINT32(1U, graph.EntryCount);
+    TEST_ASSERT_EQUAL_INT32(-2, graph.Entries[0].Priority);
+    TEST_ASSERT_EQUAL_UINT32(4U, graph.LinkCount);
+    TEST_ASSERT_EQUAL_STRING("Run_*", graph.Links[2].Caller);
+    TEST_ASSERT_EQUAL_STRING("C", graph.Links[2].Callee);
+    TEST_ASSERT_EQUAL_STRING("", graph.Links[3].Callee);
+    TEST_ASSERT_EQUAL_UINT32(16U, graph.Links[3].Size);
+}
+
+/* ============================================================================ */
+/* RESOLVE TESTS */
+/* ============================================================================ */
+
+void test_sizes_joined_by_location(void)
+{
+    // Arrange
+    LoadApp();
+
+    // Act
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+
+    // Assert: the reference to Work from isr.c carries no size of its own
+    TEST_ASSERT_EQUAL_UINT32(16U, Func("main")->Size);
+    TEST_ASSERT_EQUAL_UINT32(24U, Func("Work")->Size);
+    TEST_ASSERT_EQUAL_UINT32(8U, Func("src/app.c:Leaf")->Size);
+    TEST_ASSERT_EQUAL_HEX32(STACK_DEPTH_DEFINED, Func("Work")->Flags);
+    TEST_ASSERT_EQUAL_UINT32(2U, Func("main")->CallCount);
+}
+
+void test_static_found_by_short_name_only_when_unique(void)
+{
+    // Arrange
+    LoadApp();
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseGraph(&graph,
+        "node: { title: \"src/isr.c:Leaf\" label: \"Leaf\\nsrc/isr.c:2:13\\n8 bytes (static)\" }\n"));
+
+    // Act / Assert
+    TEST_ASSERT_TRUE(STACK_DEPTH_Find(&graph, "src/app.c:Leaf") >= 0);
+    TEST_ASSERT_TRUE(STACK_DEPTH_Find(&graph, "src/isr.c:Leaf") >= 0);
+    TEST_ASSERT_EQUAL_INT32(-1, STACK_DEPTH_Find(&graph, "Leaf"));
+    TEST_ASSERT_EQUAL_INT32(-1, STACK_DEPTH_Find(&graph, "eaf"));
+}
+
+void test_missing_config_function_named(void)
+{
+    // Arrange
+    LoadApp();
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "isr msp Gone_IRQHandler 7\n"));
+
+    // Act / Assert
+    TEST_ASSERT_EQUAL(STACK_DEPTH_NOT_FOUND, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+    TEST_ASSERT_EQUAL_STRING("Gone_IRQHandler", missing);
+}
+
+void test_weak_default_reached_through_plain_name(void)
+{
+    static const char *const lines[] = {
+        "node: { title: \"hal.c:HAL_Tick\" label: \"HAL_Tick\\nhal.c:4:13\\n8 bytes (static)\" }\n",
+        "node: { title: \"main\" label: \"main\\napp.c:1:5\\n16 bytes (static)\" }\n",
+        "node: { title: \"HAL_Tick\" label: \"HAL_Tick\\nhal.h:9:6\" shape : ellipse }\n",
+        "edge: { sourcename: \"main\" targetname: \"HAL_Tick\" label: \"app.c:2:3\" }\n",
+    };
+    static const char *const usage[] = {
+        "hal.c:4:13:HAL_Tick\t8\tstatic\n",
+        "app.c:1:5:main\t16\tstatic\n",
+    };
+
+    // Arrange: no override, main calls the weak default by its plain name
+    LOAD(STACK_DEPTH_ParseUsage, usage);
+    LOAD(STACK_DEPTH_ParseGraph, lines);
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "stack msp 512\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "thread msp main\n"));
+
+    // Act
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+    (void)STACK_DEPTH_Analyse(&graph);
+
+    // Assert: known, and as deep as the default
+    TEST_ASSERT_EQUAL_UINT32(24U, Func("main")->Depth);
+    TEST_ASSERT_EQUAL_HEX32(0U, Func("main")->PathFlags);
+}
+
+void test_weak_default_calls_its_override(void)
+{
+    static const char *const lines[] = {
+        "node: { title: \"hal.c:HAL_Tick\" label: \"HAL_Tick\\nhal.c:4:13\\n8 bytes (static)\" }\n",
+        "node: { title: \"hal.c:HAL_Run\" label: \"HAL_Run\\nhal.c:9:6\\n16 bytes (static)\" }\n",
+        "edge: { sourcename: \"hal.c:HAL_Run\" targetname: \"hal.c:HAL_Tick\" label: \"hal.c:10:3\" }\n",
+        "node: { title: \"HAL_Tick\" label: \"HAL_Tick\\napp.c:3:6\\n40 bytes (static)\" }\n",
+    };
+    static const char *const usage[] = {
+        "hal.c:4:13:HAL_Tick\t8\tstatic\n",
+        "hal.c:9:6:HAL_Run\t16\tstatic\n",
+        "app.c:3:6:HAL_Tick\t40\tstatic\n",
+    };
+
+    // Arrange: the caller in the weak default's own file only sees it
+    LOAD(STACK_DEPTH_ParseUsage, usage);
+    LOAD(STACK_DEPTH_ParseGraph, lines);
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "stack msp 512\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "thread msp HAL_Run\n"));
+
+    // Act
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+    (void)STACK_DEPTH_Analyse(&graph);
+
+    // Assert: 16 + 8 + 40, through the override
+    TEST_ASSERT_EQUAL_UINT32(64U, Func("HAL_Run")->Depth);
+    TEST_ASSERT_EQUAL_STRING("  HAL_Run 64: HAL_Run > HAL_Tick > HAL_Tick", Line(1));
+}
+
+/* ============================================================================ */
+/* DEPTH TESTS */
+/* ============================================================================ */
+
+void test_thread_depth_follows_worst_path(void)
+{
+    // Arrange
+    LoadApp();
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+
+    // Act
+    (void)STACK_DEPTH_Analyse(&graph);
+
+    // Assert: 16 + 24 + 8, not main > Leaf
+    TEST_ASSERT_EQUAL_UINT32(48U, Func("main")->Depth);
+    TEST_ASSERT_EQUAL_UINT32(64U, Func("Fast_IRQHandler")->Depth);
+    TEST_ASSERT_EQUAL_STRING("  main 48: main > Work > Leaf", Line(1));
+}
+
+void test_isr_levels_add_deepest_handler_and_frame(void)
+{
+    // Arrange
+    LoadApp();
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+
+    // Act
+    TEST_ASSERT_EQUAL_UINT32(0U, STACK_DEPTH_Analyse(&graph));
+
+    // Assert: reserve 8, level 2 (64 + 104), level 5 (max(16, 40) + 104),
+    // thread 48
+    TEST_ASSERT_EQUAL_UINT32(368U, graph.Stacks[0].Depth);
+    TEST_ASSERT_EQUAL_UINT32(2U, graph.Stacks[0].Levels);
+    TEST_ASSERT_EQUAL_STRING("msp: 368 of 400 bytes, 32 spare, 2 interrupt levels", Line(0));
+    TEST_ASSERT_EQUAL_STRING("  isr 2 Fast_IRQHandler 64: Fast_IRQHandler > Work > Leaf", Line(2));
+    TEST_ASSERT_EQUAL_STRING("  isr 5 Other_IRQHandler 40: Other_IRQHandler", Line(4));
+    TEST_ASSERT_EQUAL_UINT32(0U, STACK_DEPTH_FormatLine(&graph, 5U, text, sizeof(text)));
+}
+
+void test_task_stack_takes_one_frame(void)
+{
+    // Arrange
+    LoadApp();
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "stack task 256 100\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "thread task Work\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+
+    // Act
+    TEST_ASSERT_EQUAL_UINT32(0U, STACK_DEPTH_Analyse(&graph));
+
+    // Assert: 100 + 32 + 104
+    TEST_ASSERT_EQUAL_UINT32(236U, graph.Stacks[1].Depth);
+    TEST_ASSERT_EQUAL_UINT32(0U, graph.Stacks[1].Levels);
+    TEST_ASSERT_EQUAL_STRING("task: 236 of 256 bytes, 20 spare", Line(5));
+}
+
+void test_over_budget_counted_and_reported(void)
+{
+    // Arrange
+    LoadApp();
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "stack tiny 64\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "thread tiny main\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+
+    // Act / Assert: 48 + 104
+    TEST_ASSERT_EQUAL_UINT32(1U, STACK_DEPTH_Analyse(&graph));
+    TEST_ASSERT_EQUAL_STRING("tiny: 152 of 64 bytes, OVER by 88", Line(5));
+}
+
+/* ============================================================================ */
+/* WARNING TESTS */
+/* ============================================================================ */
+
+void test_recursion_flagged_and_not_followed(void)
+{
+    static const char *const lines[] = {
+        "edge: { sourcename: \"Work\" targetname: \"Again\" label: \"src/app.c:22:3\" }\n",
+        "node: { title: \"Again\" label: \"Again\\nsrc/app.c:40:6\\n12 bytes (static)\" }\n",
+        "edge: { sourcename: \"Again\" targetname: \"Work\" label: \"src/app.c:41:3\" }\n",
+    };
+
+    // Arrange: Work > Again > Work
+    LoadApp();
+    LOAD(STACK_DEPTH_ParseGraph, lines);
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseUsage(&graph, "src/app.c:40:6:Again\t12\tstatic\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+
+    // Act
+    (void)STACK_DEPTH_Analyse(&graph);
+
+    // Assert: one trip round the loop, and a lower bound from then on
+    TEST_ASSERT_EQUAL_UINT32(16U + 24U + 12U, Func("main")->Depth);
+    TEST_ASSERT_EQUAL_HEX32(STACK_DEPTH_RECURSION, Func("main")->PathFlags);
+    TEST_ASSERT_EQUAL_STRING("msp: 376 of 400 bytes, 24 spare, 2 interrupt levels, at least", Line(0));
+    TEST_ASSERT_EQUAL_STRING("warning: Again: recursion", Line(5));
+}
+
+void test_indirect_call_resolved_by_config(void)
+{
+    static const char *const lines[] = {
+        "node: { title: \"__indirect_call\" label: \"Indirect Call Placeholder\" shape : ellipse }\n",
+        "edge: { sourcename: \"Slow_IRQHandler\" targetname: \"__indirect_call\" label: \"src/isr.c:10:3\" }\n",
+    };
+
+    // Arrange
+    LoadApp();
+    LOAD(STACK_DEPTH_ParseGraph, lines);
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+
+    // Act / Assert: unresolved, the handler is a lower bound
+    (void)STACK_DEPTH_Analyse(&graph);
+    TEST_ASSERT_EQUAL_HEX32(STACK_DEPTH_INDIRECT, Func("Slow_IRQHandler")->PathFlags);
+    TEST_ASSERT_EQUAL_STRING("warning: Slow_IRQHandler: indirect call", Line(5));
+
+    // Arrange: the same graph with its targets named
+    setUp();
+    LoadApp();
+    LOAD(STACK_DEPTH_ParseGraph, lines);
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "call Slow_IRQHandler Leaf main\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+
+    // Act / Assert: 16 + 48, deeper than Other_IRQHandler at its level
+    TEST_ASSERT_EQUAL_UINT32(0U, STACK_DEPTH_Analyse(&graph));
+    TEST_ASSERT_EQUAL_UINT32(64U, Func("Slow_IRQHandler")->Depth);
+    TEST_ASSERT_EQUAL_HEX32(0U, Func("Slow_IRQHandler")->PathFlags);
+    TEST_ASSERT_EQUAL_UINT32(392U, graph.Stacks[0].Depth);
+    TEST_ASSERT_EQUAL_UINT32(0U, STACK_DEPTH_FormatLine(&graph, 5U, text, sizeof(text)));
+}
+
+void test_indirect_call_resolved_by_prefix(void)
+{
+    static const char *const lines[] = {
+        "edge: { sourcename: \"Slow_IRQHandler\" targetname: \"__indirect_call\" label: \"src/isr.c:10:3\" }\n",
+        "edge: { sourcename: \"Other_IRQHandler\" targetname: \"__indirect_call\" label: \"src/isr.c:13:3\" }\n",
+    };
+
+    // Arrange: only handlers calling through a pointer take the targets
+    LoadApp();
+    LOAD(STACK_DEPTH_ParseGraph, lines);
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "call Slow_* Work\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "call Fast_* main\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+
+    // Act
+    (void)STACK_DEPTH_Analyse(&graph);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(48U, Func("Slow_IRQHandler")->Depth);
+    TEST_ASSERT_EQUAL_HEX32(0U, Func("Slow_IRQHandler")->PathFlags);
+    TEST_ASSERT_EQUAL_UINT32(64U, Func("Fast_IRQHandler")->Depth);
+    TEST_ASSERT_EQUAL_HEX32(STACK_DEPTH_INDIRECT, Func("Other_IRQHandler")->PathFlags);
+
+    // A prefix call to a function the graph does not have is an error
+    setUp();
+    LoadApp();
+    LOAD(STACK_DEPTH_ParseGraph, lines);
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "call Slow_* Nowhere\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_NOT_FOUND, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+    TEST_ASSERT_EQUAL_STRING("Nowhere", missing);
+}
+
+void test_dynamic_and_unknown_sizes_flagged(void)
+{
+    static const char *const lines[] = {
+        "node: { title: \"memcpy\" label: \"memcpy\\n/usr/include/string.h:43:14\" shape : ellipse }\n",
+        "edge: { sourcename: \"src/app.c:Leaf\" targetname: \"memcpy\" label: \"src/app.c:31:3\" }\n",
+        "node: { title: \"Buffer\" label: \"Buffer\\nsrc/app.c:50:6\\n32 bytes (dynamic)\" }\n",
+        "edge: { sourcename: \"Other_IRQHandler\" targetname: \"Buffer\" label: \"src/isr.c:13:3\" }\n",
+    };
+
+    // Arrange
+    LoadApp();
+    LOAD(STACK_DEPTH_ParseGraph, lines);
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseUsage(&graph, "src/app.c:50:6:Buffer\t32\tdynamic\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+
+    // Act
+    (void)STACK_DEPTH_Analyse(&graph);
+
+    // Assert
+    TEST_ASSERT_EQUAL_HEX32(STACK_DEPTH_UNKNOWN, Func("main")->PathFlags);
+    TEST_ASSERT_EQUAL_HEX32(STACK_DEPTH_DYNAMIC | STACK_DEPTH_UNKNOWN, graph.Stacks[0].Flags);
+    TEST_ASSERT_EQUAL_STRING("  main 48: main > Work > Leaf > memcpy?", Line(1));
+    TEST_ASSERT_EQUAL_STRING("warning: memcpy: unknown size", Line(5));
+    TEST_ASSERT_EQUAL_STRING("warning: Buffer: dynamic stack", Line(6));
+
+    // An extern line gives the library function its size
+    setUp();
+    LoadApp();
+    LOAD(STACK_DEPTH_ParseGraph, lines);
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "extern memcpy 16\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "extern strlen 8\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+    (void)STACK_DEPTH_Analyse(&graph);
+    TEST_ASSERT_EQUAL_UINT32(64U, Func("main")->Depth);
+    TEST_ASSERT_EQUAL_HEX32(0U, Func("main")->PathFlags);
+}
+
+void test_library_sized_from_image(void)
+{
+    static const char *const lines[] = {
+        "node: { title: \"memcpy\" label: \"memcpy\\n/usr/include/string.h:43:14\" shape : ellipse }\n",
+        "edge: { sourcename: \"src/app.c:Leaf\" targetname: \"memcpy\" label: \"src/app.c:31:3\" }\n",
+    };
+    static const char *const image[] = {
+        "08000100 <main>:\n",
+        " 8000100:\tpush\t{r4, r5, r6, r7, lr}\n",
+        " 8000102:\tsub\tsp, #200\n",
+        "08000200 <memcpy>:\n",
+        " 8000200:\tpush\t{r4, lr}\n",
+        " 8000202:\tbl\t8000300 <__aeabi_memcpy_helper>\n",
+        "08000300 <__aeabi_memcpy_helper>:\n",
+        " 8000300:\tsub\tsp, #8\n",
+        " 8000302:\tbx\tlr\n",
+    };
+
+    // Arrange
+    LoadApp();
+    LOAD(STACK_DEPTH_ParseGraph, lines);
+    LOAD(STACK_DEPTH_ParseImage, image);
+
+    // Act
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+    (void)STACK_DEPTH_Analyse(&graph);
+
+    // Assert: main keeps its .su size, memcpy and its callee come from the image
+    TEST_ASSERT_EQUAL_UINT32(16U, Func("main")->Size);
+    TEST_ASSERT_EQUAL_UINT32(8U, Func("memcpy")->Size);
+    TEST_ASSERT_EQUAL_UINT32(64U, Func("main")->Depth);
+    TEST_ASSERT_EQUAL_HEX32(0U, Func("main")->PathFlags);
+    TEST_ASSERT_EQUAL_STRING("  main 64: main > Work > Leaf > memcpy > __aeabi_memcpy_helper", Line(1));
+
+    // An extern line overrides the image, callees included
+    setUp();
+    LoadApp();
+    LOAD(STACK_DEPTH_ParseGraph, lines);
+    LOAD(STACK_DEPTH_ParseImage, image);
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_ParseConfig(&graph, "extern memcpy 40\n"));
+    TEST_ASSERT_EQUAL(STACK_DEPTH_OK, STACK_DEPTH_Resolve(&graph, missing, sizeof(missing)));
+    (void)STACK_DEPTH_Analyse(&graph);
+    TEST_ASSERT_EQUAL_UINT32(88U, Func("main")->Depth);
+    TEST_ASSERT_EQUAL_INT32(-1, STACK_DEPTH_Find(&graph, "__aeabi_memcpy_helper"));
+}
+
+/* ============================================================================ */
+/* TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Parser Tests */
+    RUN_TEST(test_usage_line_location_size_and_kind);
+    RUN_TEST(test_malformed_lines_rejected);
+    RUN_TEST(test_config_directives_and_errors);
+    RUN_TEST(test_image_frame_calls_and_flags);
+
+    /* Resolve Tests */
+    RUN_TEST(test_sizes_joined_by_location);
+    RUN_TEST(test_static_found_by_short_name_only_when_unique);
+    RUN_TEST(test_missing_config_function_named);
+    RUN_TEST(test_weak_default_reached_through_plain_name);
+    RUN_TEST(test_weak_default_calls_its_override);
+
+    /* Depth Tests */
+    RUN_TEST(test_thread_depth_follows_worst_path);
+    RUN_TEST(test_isr_levels_add_deepest_handler_and_frame);
+    RUN_TEST(test_task_stack_takes_one_frame);
+    RUN_TEST(test_over_budget_counted_and_reported);
+
+    /* Warning Tests */
+    RUN_TEST(test_recursion_flagged_and_not_followed);
+    RUN_TEST(test_indirect_call_resolved_by_config);
+    RUN_TEST(test_indirect_call_resolved_by_prefix);
+    RUN_TEST(test_dynamic_and_unknown_sizes_flagged);
+    RUN_TEST(test_library_sized_from_image);
+
+    return UNITY_END();
+}
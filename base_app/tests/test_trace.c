@@ -0,0 +1,437 @@
+/**
+  ******************************************************************************
+  * @file    test_trace.c
+  * @author  Test Framework
+  * @brief   Unit tests for the binary event trace
+  ******************************************************************************
+  * Records are encoded into a small ring with hand-picked timestamps, turned
+  * into a dump exactly as TRACE_RECORDER_Dump() lays it out (header, then the
+  * two spans), and decoded back into a captured event list.
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "trace.h"
+#include <stdio.h>
+#include <string.h>
+
+#define RING_SIZE      8U
+#define CPU_HZ         168000000U
+#define MAX_EVENTS     32U
+
+static TRACE_RingTypeDef   ring;
+static TRACE_RecordTypeDef records[RING_SIZE];
+static uint8_t             dump[TRACE_HEADER_SIZE + RING_SIZE * TRACE_RECORD_SIZE + 8U];
+static TRACE_EventTypeDef  events[MAX_EVENTS];
+static uint32_t            event_count;
+
+/* ============================================================================ */
+/* HELPERS */
+/* ============================================================================ */
+
+static void Capture(void *context, const TRACE_EventTypeDef *event)
+{
+    (void)context;
+    if (event_count < MAX_EVENTS)
+    {
+        events[event_count] = *event;
+    }
+    event_count++;
+}
+
+/* Serialise the ring the way the firmware sends it; returns the dump size */
+static uint32_t MakeDump(void)
+{
+    TRACE_DumpHeaderTypeDef header;
+    const TRACE_RecordTypeDef *span;
+    uint32_t size = sizeof(header);
+    uint32_t count;
+    uint32_t part;
+
+    TRACE_DumpHeader(&ring, &header);
+    memcpy(dump, &header, sizeof(header));
+    for (part = 0; part < 2; part++)
+    {
+        span = TRACE_Span(&ring, part, &count);
+        memcpy(dump + size, span, count * sizeof(*span));
+        size += count * sizeof(*span);
+    }
+    return size;
+}
+
+static uint32_t DecodeRing(void)
+{
+    uint32_t size = MakeDump();
+    TEST_ASSERT_EQUAL(TRACE_OK, TRACE_Decode(dump, size, NULL, Capture, NULL));
+    return event_count;
+}
+
+/* ============================================================================ */
+/* TEST SETUP AND TEARDOWN */
+/* ============================================================================ */
+
+void setUp(void)
+{
+    memset(records, 0xA5, sizeof(records));
+    memset(dump, 0, sizeof(dump));
+    memset(events, 0, sizeof(events));
+    event_count = 0;
+    TEST_ASSERT_EQUAL(TRACE_OK, TRACE_Init(&ring, records, RING_SIZE, CPU_HZ, 1000));
+}
+
+void tearDown(void)
+{
+}
+
+/* ============================================================================ */
+/* ENCODER TESTS */
+/* ============================================================================ */
+
+void test_init_rejects_capacity_not_power_of_two(void)
+{
+    // Arrange
+    TRACE_RingTypeDef other;
+
+    // Act & Assert
+    TEST_ASSERT_EQUAL(TRACE_ERROR, TRACE_Init(&other, records, 6, CPU_HZ, 0));
+    TEST_ASSERT_EQUAL(TRACE_ERROR, TRACE_Init(&other, records, 0, CPU_HZ, 0));
+    TEST_ASSERT_EQUAL(TRACE_ERROR, TRACE_Init(&other, NULL, 8, CPU_HZ, 0));
+    TEST_ASSERT_EQUAL(TRACE_OK, TRACE_Init(&other, records, 1, CPU_HZ, 0));
+}
+
+void test_record_packs_id_and_delta(void)
+{
+    // Act
+    TRACE_Encode(&ring, 1100, TRACE_EV_ISR_ENTER, (uint32_t)-1);
+    TRACE_Encode(&ring, 1142, TRACE_EV_ISR_EXIT, (uint32_t)-1);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(2, ring.Head);
+    TEST_ASSERT_EQUAL_HEX32(0x01000064, records[0].Header);
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, records[0].Payload);
+    TEST_ASSERT_EQUAL_HEX32(0x0200002A, records[1].Header);
+    TEST_ASSERT_EQUAL_UINT32(1142, ring.Last);
+}
+
+void test_delta_survives_counter_wrap(void)
+{
+    // Arrange
+    TRACE_Reset(&ring, 0xFFFFFFF0U);
+
+    // Act
+    TRACE_Encode(&ring, 0x00000010U, TRACE_EV_MARK, 7);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(1, ring.Head);
+    TEST_ASSERT_EQUAL_HEX32(0x07000020, records[0].Header);
+}
+
+void test_long_gap_emits_sync_record(void)
+{
+    // Act: 0x01000000 cycles is one past the 24-bit field
+    TRACE_Encode(&ring, 1000 + 0x01000000U, TRACE_EV_MARK, 1);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(2, ring.Head);
+    TEST_ASSERT_EQUAL_HEX32(0x00000000, records[0].Header);
+    TEST_ASSERT_EQUAL_HEX32(0x01000000, records[0].Payload);
+    TEST_ASSERT_EQUAL_HEX32(0x07000000, records[1].Header);
+}
+
+void test_largest_delta_needs_no_sync(void)
+{
+    // Act
+    TRACE_Encode(&ring, 1000 + TRACE_DELTA_MAX, TRACE_EV_MARK, 1);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(1, ring.Head);
+    TEST_ASSERT_EQUAL_HEX32(0x07FFFFFF, records[0].Header);
+}
+
+/* ============================================================================ */
+/* DUMP AND DECODER TESTS */
+/* ============================================================================ */
+
+void test_decode_round_trip_gives_absolute_times(void)
+{
+    // Arrange
+    TRACE_Encode(&ring, 1010, TRACE_EV_ISR_ENTER, (uint32_t)-1);
+    TRACE_Encode(&ring, 1030, TRACE_EV_ISR_EXIT, (uint32_t)-1);
+    TRACE_Encode(&ring, 1000 + 0x02000000U, TRACE_EV_TASK_SWITCH, 2);
+
+    // Act
+    TEST_ASSERT_EQUAL_UINT32(3, DecodeRing());
+
+    // Assert: the SYNC record is folded into the time base
+    TEST_ASSERT_EQUAL_UINT8(TRACE_EV_ISR_ENTER, events[0].Id);
+    TEST_ASSERT_EQUAL_UINT32(10, (uint32_t)events[0].Cycles);
+    TEST_ASSERT_EQUAL_UINT32(30, (uint32_t)events[1].Cycles);
+    TEST_ASSERT_EQUAL_UINT8(TRACE_EV_TASK_SWITCH, events[2].Id);
+    TEST_ASSERT_EQUAL_UINT32(2, events[2].Payload);
+    TEST_ASSERT_EQUAL_UINT32(0x02000000U, (uint32_t)events[2].Cycles);
+}
+
+void test_wrapped_ring_dumps_oldest_first(void)
+{
+    // Arrange: 11 events into 8 slots, 10 cycles apart
+    TRACE_DumpHeaderTypeDef header;
+    uint32_t size;
+    uint32_t i;
+    for (i = 0; i < 11; i++)
+    {
+        TRACE_Encode(&ring, 1010 + i * 10, TRACE_EV_MARK, i);
+    }
+
+    // Act
+    size = MakeDump();
+    TEST_ASSERT_EQUAL(TRACE_OK, TRACE_Decode(dump, size, &header, Capture, NULL));
+
+    // Assert: time restarts at the oldest surviving record
+    TEST_ASSERT_EQUAL_UINT32(TRACE_MAGIC, header.Magic);
+    TEST_ASSERT_EQUAL_UINT32(CPU_HZ, header.CpuHz);
+    TEST_ASSERT_EQUAL_UINT32(8, header.Count);
+    TEST_ASSERT_EQUAL_UINT32(3, header.Lost);
+    TEST_ASSERT_EQUAL_UINT32(8, event_count);
+    for (i = 0; i < 8; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(3 + i, events[i].Payload);
+        TEST_ASSERT_EQUAL_UINT32(i * 10, (uint32_t)events[i].Cycles);
+    }
+}
+
+void test_orphaned_sync_at_dump_start_is_skipped(void)
+{
+    // Arrange: mark, SYNC + mark, six marks; the first mark is overwritten
+    uint32_t i;
+    TRACE_Encode(&ring, 1010, TRACE_EV_MARK, 99);
+    TRACE_Encode(&ring, 1010 + 0x03000000U, TRACE_EV_MARK, 100);
+    for (i = 0; i < 6; i++)
+    {
+        TRACE_Encode(&ring, 1010 + 0x03000000U + (i + 1) * 4, TRACE_EV_MARK, i);
+    }
+
+    // Act: the oldest surviving record is the SYNC
+    TEST_ASSERT_EQUAL_HEX32(0x00000000, records[1].Header);
+    TEST_ASSERT_EQUAL_UINT32(7, DecodeRing());
+
+    // Assert: its delta belongs to a lost record, time starts at its event
+    TEST_ASSERT_EQUAL_UINT32(100, events[0].Payload);
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)events[0].Cycles);
+    TEST_ASSERT_EQUAL_UINT32(0, events[1].Payload);
+    TEST_ASSERT_EQUAL_UINT32(4, (uint32_t)events[1].Cycles);
+}
+
+void test_wrapped_clock_change_sets_header_clock(void)
+{
+    // Arrange: a switch to 42 MHz, then enough events to overwrite it
+    TRACE_DumpHeaderTypeDef header;
+    uint32_t i;
+    TRACE_Encode(&ring, 1010, TRACE_EV_MARK, 0);
+    TRACE_Clock(&ring, 1020, CPU_HZ / 4U);
+    TRACE_Clock(&ring, 1030, CPU_HZ / 4U);
+    TEST_ASSERT_EQUAL_UINT32(2, ring.Head);
+
+    // Act
+    for (i = 0; i < RING_SIZE; i++)
+    {
+        TRACE_Encode(&ring, 1040 + i * 10, TRACE_EV_MARK, i + 1);
+    }
+    TRACE_DumpHeader(&ring, &header);
+
+    // Assert: the oldest record left counts at the new rate
+    TEST_ASSERT_EQUAL_UINT32(CPU_HZ / 4U, header.CpuHz);
+    TEST_ASSERT_EQUAL_UINT32(CPU_HZ / 4U, ring.ClockHz);
+
+    // Act: a reset starts over at the current rate
+    TRACE_Reset(&ring, 2000);
+    TRACE_DumpHeader(&ring, &header);
+    TEST_ASSERT_EQUAL_UINT32(CPU_HZ / 4U, header.CpuHz);
+}
+
+void test_decode_rejects_bad_dumps(void)
+{
+    // Arrange
+    uint32_t size;
+    TRACE_Encode(&ring, 1010, TRACE_EV_MARK, 1);
+    TRACE_Encode(&ring, 1020, TRACE_EV_MARK, 2);
+    size = MakeDump();
+
+    // Act & Assert
+    TEST_ASSERT_EQUAL(TRACE_ERROR, TRACE_Decode(dump, TRACE_HEADER_SIZE - 1, NULL, Capture, NULL));
+    TEST_ASSERT_EQUAL(TRACE_ERROR, TRACE_Decode(dump, size - 1, NULL, Capture, NULL));
+    TEST_ASSERT_EQUAL(TRACE_ERROR, TRACE_Decode(dump + 1, size - 1, NULL, Capture, NULL));
+    TEST_ASSERT_EQUAL(TRACE_OK, TRACE_Decode(dump, size + 8, NULL, NULL, NULL));
+    TEST_ASSERT_EQUAL_UINT32(0, event_count);
+}
+
+/* ============================================================================ */
+/* JSON WRITER TESTS */
+/* ============================================================================ */
+
+void test_irq_names_cover_core_and_device_vectors(void)
+{
+    TEST_ASSERT_EQUAL_STRING("SysTick", TRACE_IrqName(-1));
+    TEST_ASSERT_EQUAL_STRING("HardFault", TRACE_IrqName(-13));
+    TEST_ASSERT_EQUAL_STRING("WWDG", TRACE_IrqName(0));
+    TEST_ASSERT_EQUAL_STRING("USART3", TRACE_IrqName(39));
+    TEST_ASSERT_EQUAL_STRING("TIM6_DAC", TRACE_IrqName(54));
+    TEST_ASSERT_EQUAL_STRING("FPU", TRACE_IrqName(81));
+    TEST_ASSERT_NULL(TRACE_IrqName(-16));
+    TEST_ASSERT_NULL(TRACE_IrqName(-9));
+    TEST_ASSERT_NULL(TRACE_IrqName(82));
+}
+
+void test_json_isr_slice_in_microseconds(void)
+{
+    // Arrange
+    TRACE_JsonTypeDef json;
+    TRACE_EventTypeDef ev = { TRACE_EV_ISR_ENTER, 54, 168 };
+    char out[TRACE_JSON_MAX];
+    (void)TRACE_JsonBegin(&json, CPU_HZ, out, sizeof(out));
+
+    // Act
+    uint32_t len = TRACE_JsonEvent(&json, &ev, out, sizeof(out));
+
+    // Assert
+    TEST_ASSERT_EQUAL_STRING(",\n{\"name\":\"TIM6_DAC\",\"cat\":\"isr\",\"ph\":\"B\",\"ts\":1.000,\"pid\":1,\"tid\":1}", out);
+    TEST_ASSERT_EQUAL_UINT32(strlen(out), len);
+}
+
+void test_json_task_switch_closes_previous_task(void)
+{
+    // Arrange
+    TRACE_JsonTypeDef json;
+    TRACE_EventTypeDef first = { TRACE_EV_TASK_SWITCH, 1, 84 };
+    TRACE_EventTypeDef second = { TRACE_EV_TASK_SWITCH, 2, 252 };
+    char out[TRACE_JSON_MAX];
+    (void)TRACE_JsonBegin(&json, CPU_HZ, out, sizeof(out));
+    (void)TRACE_JsonEvent(&json, &first, out, sizeof(out));
+
+    // Act
+    (void)TRACE_JsonEvent(&json, &second, out, sizeof(out));
+
+    // Assert
+    TEST_ASSERT_EQUAL_STRING(
+        ",\n{\"name\":\"task 1\",\"cat\":\"task\",\"ph\":\"E\",\"ts\":1.500,\"pid\":1,\"tid\":2}"
+        ",\n{\"name\":\"task 2\",\"cat\":\"task\",\"ph\":\"B\",\"ts\":1.500,\"pid\":1,\"tid\":2}", out);
+
+    // Act: the document end closes the running task
+    (void)TRACE_JsonEnd(&json, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING(
+        ",\n{\"name\":\"task 2\",\"cat\":\"task\",\"ph\":\"E\",\"ts\":1.500,\"pid\":1,\"tid\":2}"
+        "\n],\"displayTimeUnit\":\"ns\"}\n", out);
+}
+
+void test_json_instant_events_and_unknown_irq(void)
+{
+    // Arrange
+    TRACE_JsonTypeDef json;
+    TRACE_EventTypeDef mark = { TRACE_EV_MARK, 42, 1 };
+    TRACE_EventTypeDef user = { TRACE_EV_USER | 3U, 5, 2 };
+    TRACE_EventTypeDef irq = { TRACE_EV_ISR_EXIT, 200, 3 };
+    char out[TRACE_JSON_MAX];
+    (void)TRACE_JsonBegin(&json, 1000000000U, out, sizeof(out));
+
+    // Act & Assert: 1 GHz clock, so 1 cycle is 0.001 us
+    (void)TRACE_JsonEvent(&json, &mark, out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING(",\n{\"name\":\"mark\",\"cat\":\"event\",\"ph\":\"i\",\"s\":\"t\",\"ts\":0.001,"
+                             "\"pid\":1,\"tid\":3,\"args\":{\"value\":42}}", out);
+    (void)TRACE_JsonEvent(&json, &user, out, sizeof(out));
+    TEST_ASSERT_NOT_NULL(strstr(out, "\"name\":\"event 0x83\""));
+    (void)TRACE_JsonEvent(&json, &irq, out, sizeof(out));
+    TEST_ASSERT_NOT_NULL(strstr(out, "\"name\":\"IRQ200\",\"cat\":\"isr\",\"ph\":\"E\",\"ts\":0.003"));
+}
+
+void test_json_timestamps_do_not_overflow(void)
+{
+    // Arrange: about 30 hours of cycles, cycles * 1e9 would overflow
+    TRACE_JsonTypeDef json;
+    TRACE_EventTypeDef ev = { TRACE_EV_MARK, 0, (uint64_t)CPU_HZ * 108000U + 84U };
+    char out[TRACE_JSON_MAX];
+    (void)TRACE_JsonBegin(&json, CPU_HZ, out, sizeof(out));
+
+    // Act
+    (void)TRACE_JsonEvent(&json, &ev, out, sizeof(out));
+
+    // Assert
+    TEST_ASSERT_NOT_NULL(strstr(out, "\"ts\":108000000000.500,"));
+}
+
+void test_json_rescales_after_a_clock_switch(void)
+{
+    // Arrange: 168 cycles at 168 MHz, a switch to 42 MHz, 84 more cycles
+    TRACE_JsonTypeDef json;
+    TRACE_DumpHeaderTypeDef header;
+    char out[TRACE_JSON_MAX];
+    uint32_t size;
+    uint32_t i;
+    TRACE_Encode(&ring, 1168, TRACE_EV_ISR_ENTER, 54);
+    TRACE_Clock(&ring, 1168, CPU_HZ / 4U);
+    TRACE_Encode(&ring, 1252, TRACE_EV_ISR_EXIT, 54);
+    size = MakeDump();
+
+    // Act
+    TEST_ASSERT_EQUAL(TRACE_OK, TRACE_Decode(dump, size, &header, Capture, NULL));
+    (void)TRACE_JsonBegin(&json, header.CpuHz, out, sizeof(out));
+    for (i = 0; i < 2; i++)
+    {
+        (void)TRACE_JsonEvent(&json, &events[i], out, sizeof(out));
+    }
+    TEST_ASSERT_NOT_NULL(strstr(out, "\"name\":\"clock\",\"cat\":\"event\",\"ph\":\"i\",\"s\":\"t\",\"ts\":1.000,"));
+    TEST_ASSERT_NOT_NULL(strstr(out, "\"args\":{\"value\":42000000}"));
+    (void)TRACE_JsonEvent(&json, &events[2], out, sizeof(out));
+
+    // Assert: 84 cycles at 42 MHz are 2 us, not 0.5
+    TEST_ASSERT_EQUAL_UINT32(CPU_HZ, header.CpuHz);
+    TEST_ASSERT_EQUAL_UINT32(3, event_count);
+    TEST_ASSERT_EQUAL_UINT8(TRACE_EV_CLOCK, events[1].Id);
+    TEST_ASSERT_EQUAL_STRING(",\n{\"name\":\"TIM6_DAC\",\"cat\":\"isr\",\"ph\":\"E\",\"ts\":3.000,\"pid\":1,\"tid\":1}", out);
+}
+
+void test_json_output_is_truncated_to_buffer(void)
+{
+    // Arrange
+    TRACE_JsonTypeDef json;
+    char out[32];
+
+    // Act
+    uint32_t len = TRACE_JsonBegin(&json, CPU_HZ, out, sizeof(out));
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(31, len);
+    TEST_ASSERT_EQUAL_UINT32(31, strlen(out));
+}
+
+/* ============================================================================ */
+/* MAIN TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Encoder Tests */
+    RUN_TEST(test_init_rejects_capacity_not_power_of_two);
+    RUN_TEST(test_record_packs_id_and_delta);
+    RUN_TEST(test_delta_survives_counter_wrap);
+    RUN_TEST(test_long_gap_emits_sync_record);
+    RUN_TEST(test_largest_delta_needs_no_sync);
+
+    /* Dump and Decoder Tests */
+    RUN_TEST(test_decode_round_trip_gives_absolute_times);
+    RUN_TEST(test_wrapped_ring_dumps_oldest_first);
+    RUN_TEST(test_orphaned_sync_at_dump_start_is_skipped);
+    RUN_TEST(test_wrapped_clock_change_sets_header_clock);
+    RUN_TEST(test_decode_rejects_bad_dumps);
+
+    /* JSON Writer Tests */
+    RUN_TEST(test_irq_names_cover_core_and_device_vectors);
+    RUN_TEST(test_json_isr_slice_in_microseconds);
+    RUN_TEST(test_json_task_switch_closes_previous_task);
+    RUN_TEST(test_json_instant_events_and_unknown_irq);
+    RUN_TEST(test_json_timestamps_do_not_overflow);
+    RUN_TEST(test_json_rescales_after_a_clock_switch);
+    RUN_TEST(test_json_output_is_truncated_to_buffer);
+
+    return UNITY_END();
+}
@@ -0,0 +1,849 @@
+/**
+  ******************************************************************************
+  * @file    test_usb_cdc.c
+  * @author  Test Framework
+  * @brief   Unit tests for the USB CDC-ACM device
+  ******************************************************************************
+  * The device runs against a simulated controller that stands in for
+  * OTG_FS. Transmit() and Receive() only record what the device handed
+  * over, per endpoint; the host helpers below play the host side of the
+  * bus: they issue SETUP packets, collect IN packets and answer with
+  * USB_CDC_DataIn(), fill armed OUT buffers and answer with
+  * USB_CDC_DataOut(), the way the controller interrupt would.
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "usb_cdc.h"
+#include <string.h>
+
+#define SIM_EPS            3U
+#define SIM_ADDRESS        5U
+
+typedef struct
+{
+    const uint8_t *Data;
+    uint32_t       Length;
+    uint8_t        Pending;     /* Transfer handed over, not yet taken */
+} SimInTypeDef;
+
+typedef struct
+{
+    uint8_t       *Data;
+    uint32_t       Length;
+    uint8_t        Armed;
+} SimOutTypeDef;
+
+static struct
+{
+    SimInTypeDef   In[SIM_EPS];
+    SimOutTypeDef  Out[SIM_EPS];
+    uint8_t        Stalled[2][SIM_EPS];     /* [out, in][endpoint]          */
+    uint8_t        Opened[2][SIM_EPS];
+    uint8_t        Types[2][SIM_EPS];
+    uint16_t       Sizes[2][SIM_EPS];
+    uint8_t        ClearStalls;
+    int            Address;
+    int            Locks;
+    uint32_t       InTransfers;             /* Non-zero bulk IN transfers   */
+    uint32_t       MaxTransfer;
+} sim;
+
+static USB_CDC_HandleTypeDef h;
+
+/* Host side of the stream test */
+static uint8_t  stream_out[20000];
+static uint8_t  stream_in[20000];
+
+/* ============================================================================ */
+/* CONTROLLER SIMULATOR */
+/* ============================================================================ */
+
+static uint8_t SimDir(uint8_t ep)
+{
+    return ((ep & 0x80U) != 0U) ? 1U : 0U;
+}
+
+static void SimSetAddress(uint8_t address)
+{
+    sim.Address = address;
+}
+
+static void SimOpen(uint8_t ep, uint8_t type, uint16_t size)
+{
+    TEST_ASSERT_TRUE((ep & 0x7FU) < SIM_EPS);
+    sim.Opened[SimDir(ep)][ep & 0x7FU] = 1U;
+    sim.Types[SimDir(ep)][ep & 0x7FU] = type;
+    sim.Sizes[SimDir(ep)][ep & 0x7FU] = size;
+}
+
+static void SimTransmit(uint8_t ep, const uint8_t *data, uint32_t length)
+{
+    SimInTypeDef *in = &sim.In[ep & 0x7FU];
+
+    TEST_ASSERT_TRUE((ep & 0x80U) != 0U);
+    TEST_ASSERT_TRUE(sim.Opened[1][ep & 0x7FU]);
+    TEST_ASSERT_FALSE(in->Pending);
+    in->Data = data;
+    in->Length = length;
+    in->Pending = 1U;
+    if ((ep == USB_CDC_EP_IN) && (length != 0U))
+    {
+        sim.InTransfers++;
+        sim.MaxTransfer = (length > sim.MaxTransfer) ? length : sim.MaxTransfer;
+    }
+}
+
+static void SimReceive(uint8_t ep, uint8_t *data, uint32_t length)
+{
+    SimOutTypeDef *out = &sim.Out[ep & 0x7FU];
+
+    TEST_ASSERT_TRUE((ep & 0x80U) == 0U);
+    TEST_ASSERT_TRUE(sim.Opened[0][ep]);
+    out->Data = data;
+    out->Length = length;
+    out->Armed = 1U;
+}
+
+static void SimStall(uint8_t ep)
+{
+    sim.Stalled[SimDir(ep)][ep & 0x7FU] = 1U;
+    if ((ep & 0x80U) != 0U)
+    {
+        sim.In[ep & 0x7FU].Pending = 0U;
+    }
+    else
+    {
+        sim.Out[ep].Armed = 0U;
+    }
+}
+
+static void SimClearStall(uint8_t ep)
+{
+    sim.Stalled[SimDir(ep)][ep & 0x7FU] = 0U;
+    sim.ClearStalls++;
+    if ((ep & 0x80U) != 0U)
+    {
+        sim.In[ep & 0x7FU].Pending = 0U;   /* The transfer in flight is lost */
+    }
+}
+
+static uint32_t SimLock(void)
+{
+    sim.Locks++;
+    return 0x5AU;
+}
+
+static void SimUnlock(uint32_t state)
+{
+    TEST_ASSERT_EQUAL_UINT32(0x5AU, state);
+    sim.Locks--;
+}
+
+static const USB_CDC_PcdTypeDef sim_pcd =
+{
+    SimSetAddress,
+    SimOpen,
+    SimTransmit,
+    SimReceive,
+    SimStall,
+    SimClearStall,
+    SimLock,
+    SimUnlock
+};
+
+/* ============================================================================ */
+/* HOST SIDE */
+/* ============================================================================ */
+
+static void Setup(uint8_t type, uint8_t request, uint16_t value, uint16_t index, uint16_t length)
+{
+    uint8_t setup[8] =
+    {
+        type, request, (uint8_t)value, (uint8_t)(value >> 8),
+        (uint8_t)index, (uint8_t)(index >> 8), (uint8_t)length, (uint8_t)(length >> 8)
+    };
+
+    /* A SETUP clears a stall on endpoint 0 */
+    sim.Stalled[0][0] = 0U;
+    sim.Stalled[1][0] = 0U;
+    sim.In[0].Pending = 0U;
+    sim.Out[0].Armed = 0U;
+    USB_CDC_Setup(&h, setup);
+}
+
+/**
+  * @brief  Read IN packets of endpoint 0 until a short packet or length.
+  * @retval Bytes received, -1 on a stall; packets counts the data packets
+  */
+static int ControlIn(uint8_t type, uint8_t request, uint16_t value, uint16_t index, uint16_t length,
+                     uint8_t *data, uint32_t *packets)
+{
+    uint32_t total = 0U;
+    uint32_t n = 0U;
+
+    Setup(type, request, value, index, length);
+    while (1)
+    {
+        if (sim.Stalled[1][0])
+        {
+            return -1;
+        }
+        TEST_ASSERT_TRUE(sim.In[0].Pending);
+        TEST_ASSERT_TRUE(sim.In[0].Length <= USB_CDC_EP0_SIZE);
+        TEST_ASSERT_TRUE(total + sim.In[0].Length <= length);
+        memcpy(&data[total], sim.In[0].Data, sim.In[0].Length);
+        total += sim.In[0].Length;
+        n++;
+        sim.In[0].Pending = 0U;
+        USB_CDC_DataIn(&h, 0x80U);
+        if ((sim.In[0].Pending == 0U) || (total == length))
+        {
+            break;
+        }
+    }
+    if (packets != NULL)
+    {
+        *packets = n;
+    }
+
+    /* Status stage: an empty OUT packet */
+    TEST_ASSERT_FALSE(sim.In[0].Pending);
+    TEST_ASSERT_TRUE(sim.Out[0].Armed);
+    sim.Out[0].Armed = 0U;
+    USB_CDC_DataOut(&h, 0x00U, 0U);
+    return (int)total;
+}
+
+/**
+  * @brief  Control write with an optional OUT data stage.
+  * @retval 0, or -1 on a stall
+  */
+static int ControlOut(uint8_t type, uint8_t request, uint16_t value, uint16_t index,
+                      const uint8_t *data, uint16_t length)
+{
+    Setup(type, request, value, index, length);
+    if (sim.Stalled[0][0] || sim.Stalled[1][0])
+    {
+        return -1;
+    }
+    if (length != 0U)
+    {
+        TEST_ASSERT_TRUE(sim.Out[0].Armed);
+        TEST_ASSERT_TRUE(sim.Out[0].Length >= length);
+        memcpy(sim.Out[0].Data, data, length);
+        sim.Out[0].Armed = 0U;
+        USB_CDC_DataOut(&h, 0x00U, length);
+    }
+    /* Status stage: an empty IN packet */
+    TEST_ASSERT_TRUE(sim.In[0].Pending);
+    TEST_ASSERT_EQUAL_UINT32(0, sim.In[0].Length);
+    sim.In[0].Pending = 0U;
+    USB_CDC_DataIn(&h, 0x80U);
+    return 0;
+}
+
+static void Enumerate(void)
+{
+    static const uint8_t coding[7] = { 0x00, 0x10, 0x0E, 0x00, 0, 0, 8 };    /* 921600 8N1 */
+    uint8_t buffer[256];
+
+    USB_CDC_Reset(&h);
+    TEST_ASSERT_EQUAL_INT(18, ControlIn(0x80, 0x06, 0x0100, 0, 64, buffer, NULL));
+    TEST_ASSERT_EQUAL_INT(0, ControlOut(0x00, 0x05, SIM_ADDRESS, 0, NULL, 0));
+    TEST_ASSERT_EQUAL_INT(9, ControlIn(0x80, 0x06, 0x0200, 0, 9, buffer, NULL));
+    TEST_ASSERT_EQUAL_INT(67, ControlIn(0x80, 0x06, 0x0200, 0, 255, buffer, NULL));
+    TEST_ASSERT_EQUAL_INT(0, ControlOut(0x00, 0x09, 1, 0, NULL, 0));
+    TEST_ASSERT_EQUAL_INT(0, ControlOut(0x21, 0x20, 0, 0, coding, sizeof(coding)));
+    TEST_ASSERT_EQUAL_INT(0, ControlOut(0x21, 0x22, USB_CDC_DTR | USB_CDC_RTS, 0, NULL, 0));
+}
+
+/**
+  * @brief  Take the pending bulk IN transfer, checking it points into the
+  *         transmit ring (no bounce buffer), and complete it.
+  * @retval Bytes, 0 for a ZLP, -1 if nothing was pending
+  */
+static int BulkIn(uint8_t *data)
+{
+    SimInTypeDef *in = &sim.In[USB_CDC_EP_IN & 0x7FU];
+    uint32_t length = in->Length;
+
+    if (!in->Pending)
+    {
+        return -1;
+    }
+    if (length != 0U)
+    {
+        TEST_ASSERT_TRUE(in->Data >= h.TxBuf);
+        TEST_ASSERT_TRUE(in->Data + length <= h.TxBuf + USB_CDC_TX_SIZE);
+        if (data != NULL)
+        {
+            memcpy(data, in->Data, length);
+        }
+    }
+    in->Pending = 0U;
+    USB_CDC_DataIn(&h, USB_CDC_EP_IN);
+    return (int)length;
+}
+
+/**
+  * @brief  Deliver an OUT packet if the endpoint is armed.
+  * @retval 1 if the device took it
+  */
+static int BulkOut(const uint8_t *data, uint32_t length)
+{
+    SimOutTypeDef *out = &sim.Out[USB_CDC_EP_OUT];
+
+    if (!out->Armed)
+    {
+        return 0;
+    }
+    TEST_ASSERT_TRUE(length <= out->Length);
+    memcpy(out->Data, data, length);
+    out->Armed = 0U;
+    USB_CDC_DataOut(&h, USB_CDC_EP_OUT, length);
+    return 1;
+}
+
+static uint32_t Random(uint32_t *seed)
+{
+    *seed = *seed * 1103515245U + 12345U;
+    return *seed >> 16;
+}
+
+/* ============================================================================ */
+/* TEST SETUP AND TEARDOWN */
+/* ============================================================================ */
+
+void setUp(void)
+{
+    memset(&sim, 0, sizeof(sim));
+    sim.Address = -1;
+    USB_CDC_Init(&h, &sim_pcd, "0123456789AB");
+}
+
+void tearDown(void)
+{
+    TEST_ASSERT_EQUAL_INT(0, sim.Locks);
+}
+
+/* ============================================================================ */
+/* DESCRIPTOR TESTS */
+/* ============================================================================ */
+
+void test_device_descriptor(void)
+{
+    // Arrange
+    const uint8_t *d = NULL;
+
+    // Act
+    uint32_t length = USB_CDC_Descriptor(&h, 0x0100, &d);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(18, length);
+    TEST_ASSERT_EQUAL_UINT8(18, d[0]);
+    TEST_ASSERT_EQUAL_UINT8(0x01, d[1]);
+    TEST_ASSERT_EQUAL_UINT8(0x02, d[4]);                     /* CDC */
+    TEST_ASSERT_EQUAL_UINT8(USB_CDC_EP0_SIZE, d[7]);
+    TEST_ASSERT_EQUAL_UINT16(USB_CDC_VID, d[8] | (d[9] << 8));
+    TEST_ASSERT_EQUAL_UINT16(USB_CDC_PID, d[10] | (d[11] << 8));
+    TEST_ASSERT_EQUAL_UINT8(1, d[17]);
+}
+
+void test_configuration_descriptor_is_consistent(void)
+{
+    // Arrange
+    const uint8_t *d = NULL;
+    uint32_t length = USB_CDC_Descriptor(&h, 0x0200, &d);
+    uint32_t offset = 0U;
+    uint32_t interfaces = 0U;
+    uint8_t endpoints[4] = {0};
+    uint32_t e = 0U;
+
+    // Act: walk the descriptors by their bLength
+    while (offset < length)
+    {
+        TEST_ASSERT_TRUE(d[offset] >= 2U);
+        if (d[offset + 1] == 0x04)
+        {
+            interfaces++;
+        }
+        if ((d[offset + 1] == 0x05) && (e < 4U))
+        {
+            endpoints[e++] = d[offset + 2];
+            TEST_ASSERT_EQUAL_UINT8((d[offset + 2] == USB_CDC_EP_NOTIFY) ? USB_CDC_NOTIFY_SIZE : USB_CDC_DATA_SIZE,
+                                    d[offset + 4]);
+        }
+        offset += d[offset];
+    }
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(length, offset);
+    TEST_ASSERT_EQUAL_UINT32(length, d[2] | (d[3] << 8));
+    TEST_ASSERT_EQUAL_UINT32(d[4], interfaces);
+    TEST_ASSERT_EQUAL_UINT32(3, e);
+    TEST_ASSERT_EQUAL_HEX32(USB_CDC_EP_NOTIFY, endpoints[0]);
+    TEST_ASSERT_EQUAL_HEX32(USB_CDC_EP_OUT, endpoints[1]);
+    TEST_ASSERT_EQUAL_HEX32(USB_CDC_EP_IN, endpoints[2]);
+}
+
+void test_string_descriptors_are_utf16(void)
+{
+    // Arrange
+    const uint8_t *d = NULL;
+    uint32_t length;
+    uint32_t i;
+
+    // Act / Assert: language, then the serial number
+    TEST_ASSERT_EQUAL_UINT32(4, USB_CDC_Descriptor(&h, 0x0300, &d));
+    TEST_ASSERT_EQUAL_UINT8(0x09, d[2]);
+    TEST_ASSERT_EQUAL_UINT8(0x04, d[3]);
+    length = USB_CDC_Descriptor(&h, 0x0303, &d);
+    TEST_ASSERT_EQUAL_UINT32(2 + 2 * 12, length);
+    TEST_ASSERT_EQUAL_UINT8(length, d[0]);
+    TEST_ASSERT_EQUAL_UINT8(0x03, d[1]);
+    for (i = 0; i < 12; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8("0123456789AB"[i], d[2 + 2 * i]);
+        TEST_ASSERT_EQUAL_UINT8(0, d[3 + 2 * i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, USB_CDC_Descriptor(&h, 0x0304, &d));
+    TEST_ASSERT_EQUAL_UINT32(0, USB_CDC_Descriptor(&h, 0x0600, &d));   /* Qualifier */
+}
+
+void test_long_string_is_cut_to_one_packet(void)
+{
+    // Arrange
+    const uint8_t *d = NULL;
+    USB_CDC_Init(&h, &sim_pcd, "0123456789012345678901234567890123456789");
+
+    // Act
+    uint32_t length = USB_CDC_Descriptor(&h, 0x0303, &d);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(USB_CDC_EP0_SIZE, length);
+    TEST_ASSERT_EQUAL_UINT8('0', d[62]);                     /* 31st character */
+}
+
+/* ============================================================================ */
+/* ENUMERATION TESTS */
+/* ============================================================================ */
+
+void test_enumeration_configures_the_data_endpoints(void)
+{
+    // Act
+    Enumerate();
+
+    // Assert
+    TEST_ASSERT_EQUAL(USB_CDC_CONFIGURED, h.State);
+    TEST_ASSERT_EQUAL_INT(SIM_ADDRESS, sim.Address);
+    TEST_ASSERT_TRUE(sim.Opened[1][1]);
+    TEST_ASSERT_EQUAL_UINT8(USB_CDC_EP_BULK, sim.Types[1][1]);
+    TEST_ASSERT_EQUAL_UINT16(USB_CDC_DATA_SIZE, sim.Sizes[1][1]);
+    TEST_ASSERT_TRUE(sim.Opened[0][1]);
+    TEST_ASSERT_EQUAL_UINT8(USB_CDC_EP_BULK, sim.Types[0][1]);
+    TEST_ASSERT_TRUE(sim.Opened[1][2]);
+    TEST_ASSERT_EQUAL_UINT8(USB_CDC_EP_INTERRUPT, sim.Types[1][2]);
+    TEST_ASSERT_TRUE(sim.Out[USB_CDC_EP_OUT].Armed);
+    TEST_ASSERT_EQUAL_UINT8(0x00, h.LineCoding[0]);
+    TEST_ASSERT_EQUAL_UINT8(0x10, h.LineCoding[1]);
+    TEST_ASSERT_EQUAL_UINT8(0x0E, h.LineCoding[2]);
+    TEST_ASSERT_TRUE(USB_CDC_Connected(&h));
+    TEST_ASSERT_EQUAL_UINT32(0, h.Stats.Stalls);
+}
+
+void test_control_read_is_split_into_packets(void)
+{
+    // Arrange
+    uint8_t buffer[256];
+    uint32_t packets = 0U;
+    USB_CDC_Reset(&h);
+
+    // Act
+    int length = ControlIn(0x80, 0x06, 0x0200, 0, 255, buffer, &packets);
+
+    // Assert: 64 + 3
+    TEST_ASSERT_EQUAL_INT(67, length);
+    TEST_ASSERT_EQUAL_UINT32(2, packets);
+    TEST_ASSERT_EQUAL_UINT8(0x09, buffer[0]);
+    TEST_ASSERT_EQUAL_UINT8(USB_CDC_EP_IN, buffer[62]);
+    TEST_ASSERT_EQUAL_UINT8(USB_CDC_DATA_SIZE, buffer[64]);  /* From the second packet */
+}
+
+void test_control_read_ends_with_zlp_on_full_packet(void)
+{
+    // Arrange: a serial number of 31 characters makes a 64-byte descriptor
+    uint8_t buffer[256];
+    uint32_t packets = 0U;
+    USB_CDC_Init(&h, &sim_pcd, "0123456789012345678901234567890");
+    USB_CDC_Reset(&h);
+
+    // Act / Assert: the host asked for more, so a ZLP ends the data stage
+    TEST_ASSERT_EQUAL_INT(64, ControlIn(0x80, 0x06, 0x0303, 0x0409, 255, buffer, &packets));
+    TEST_ASSERT_EQUAL_UINT32(2, packets);
+
+    // Act / Assert: exactly what the host asked for needs no ZLP
+    TEST_ASSERT_EQUAL_INT(64, ControlIn(0x80, 0x06, 0x0303, 0x0409, 64, buffer, &packets));
+    TEST_ASSERT_EQUAL_UINT32(1, packets);
+}
+
+void test_unknown_requests_stall_endpoint_zero(void)
+{
+    // Arrange
+    uint8_t buffer[64];
+    Enumerate();
+
+    // Act / Assert
+    TEST_ASSERT_EQUAL_INT(-1, ControlIn(0x80, 0x06, 0x0600, 0, 10, buffer, NULL)); /* Qualifier */
+    TEST_ASSERT_TRUE(sim.Stalled[0][0]);
+    TEST_ASSERT_EQUAL_INT(-1, ControlOut(0x40, 0x01, 0, 0, NULL, 0));      /* Vendor */
+    TEST_ASSERT_EQUAL_INT(-1, ControlOut(0x00, 0x05, 7, 0, NULL, 0));      /* Address, configured */
+    TEST_ASSERT_EQUAL_INT(-1, ControlOut(0x00, 0x09, 2, 0, NULL, 0));      /* No configuration 2 */
+    TEST_ASSERT_EQUAL_INT(-1, ControlOut(0x00, 0x06, 0x0100, 0, NULL, 0)); /* Wrong direction */
+    TEST_ASSERT_EQUAL_INT(-1, ControlOut(0x21, 0x20, 0, 0, buffer, 3));    /* Short line coding */
+    TEST_ASSERT_EQUAL_UINT32(6, h.Stats.Stalls);
+
+    // The next good request goes through
+    TEST_ASSERT_EQUAL_INT(1, ControlIn(0x80, 0x08, 0, 0, 1, buffer, NULL));
+    TEST_ASSERT_EQUAL_UINT8(1, buffer[0]);
+    TEST_ASSERT_EQUAL(USB_CDC_CONFIGURED, h.State);
+}
+
+void test_line_coding_round_trip(void)
+{
+    // Arrange
+    static const uint8_t coding[7] = { 0x80, 0x25, 0x00, 0x00, 2, 1, 7 };    /* 9600 7O2 */
+    uint8_t buffer[16];
+    Enumerate();
+
+    // Act
+    TEST_ASSERT_EQUAL_INT(0, ControlOut(0x21, 0x20, 0, 0, coding, sizeof(coding)));
+    int length = ControlIn(0xA1, 0x21, 0, 0, 7, buffer, NULL);
+
+    // Assert
+    TEST_ASSERT_EQUAL_INT(7, length);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(coding, buffer, sizeof(coding)));
+}
+
+void test_closing_the_port_clears_connected(void)
+{
+    // Arrange
+    Enumerate();
+
+    // Act
+    TEST_ASSERT_EQUAL_INT(0, ControlOut(0x21, 0x22, 0, 0, NULL, 0));
+
+    // Assert: still configured, data still flows
+    TEST_ASSERT_FALSE(USB_CDC_Connected(&h));
+    TEST_ASSERT_EQUAL_UINT32(5, USB_CDC_Write(&h, "hello", 5));
+}
+
+/* ============================================================================ */
+/* DATA TESTS */
+/* ============================================================================ */
+
+void test_write_before_configuration_is_dropped(void)
+{
+    // Arrange
+    USB_CDC_Reset(&h);
+
+    // Act
+    uint32_t written = USB_CDC_Write(&h, "abc", 3);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(0, written);
+    TEST_ASSERT_EQUAL_UINT32(3, h.Stats.TxDropped);
+    TEST_ASSERT_FALSE(sim.In[1].Pending);
+}
+
+void test_write_transmits_from_the_ring(void)
+{
+    // Arrange
+    uint8_t data[8] = {0};
+    Enumerate();
+
+    // Act
+    TEST_ASSERT_EQUAL_UINT32(5, USB_CDC_Write(&h, "hello", 5));
+
+    // Assert: straight out of the ring, no copy
+    TEST_ASSERT_TRUE(sim.In[1].Pending);
+    TEST_ASSERT_TRUE(sim.In[1].Data == &h.TxBuf[0]);
+    TEST_ASSERT_EQUAL_INT(5, BulkIn(data));
+    TEST_ASSERT_EQUAL_INT(0, memcmp("hello", data, 5));
+    TEST_ASSERT_EQUAL_INT(-1, BulkIn(NULL));                 /* Short packet: no ZLP */
+    TEST_ASSERT_EQUAL_UINT32(5, h.Stats.TxBytes);
+}
+
+void test_writes_during_a_transfer_go_out_together(void)
+{
+    // Arrange
+    uint8_t data[256];
+    uint32_t i;
+    Enumerate();
+    USB_CDC_Write(&h, "first", 5);
+
+    // Act: three writes while the first transfer is on the bus
+    for (i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(10, USB_CDC_Write(&h, "0123456789", 10));
+    }
+
+    // Assert
+    TEST_ASSERT_EQUAL_INT(5, BulkIn(data));
+    TEST_ASSERT_EQUAL_INT(30, BulkIn(data));
+    TEST_ASSERT_EQUAL_UINT32(2, h.Stats.TxTransfers);
+}
+
+void test_transfer_is_at_most_half_the_ring(void)
+{
+    // Arrange
+    static uint8_t data[USB_CDC_TX_SIZE];
+    Enumerate();
+    USB_CDC_Write(&h, "x", 1);
+
+    // Act: fill the rest while the first byte is in flight
+    TEST_ASSERT_EQUAL_UINT32(USB_CDC_TX_SIZE - 1U, USB_CDC_Write(&h, data, USB_CDC_TX_SIZE - 1U));
+
+    // Assert: one half drains while the other refills
+    TEST_ASSERT_EQUAL_INT(1, BulkIn(NULL));
+    TEST_ASSERT_EQUAL_UINT32(1, USB_CDC_Write(&h, "y", 1));
+    TEST_ASSERT_EQUAL_UINT32(0, USB_CDC_TxFree(&h));
+    TEST_ASSERT_EQUAL_INT(USB_CDC_TX_SIZE / 2, BulkIn(NULL));
+    TEST_ASSERT_EQUAL_UINT32(USB_CDC_TX_SIZE / 2, USB_CDC_TxFree(&h));
+    TEST_ASSERT_EQUAL_INT(USB_CDC_TX_SIZE / 2 - 1, BulkIn(NULL));   /* Up to the wrap */
+    TEST_ASSERT_EQUAL_INT(1, BulkIn(NULL));
+    TEST_ASSERT_EQUAL_INT(-1, BulkIn(NULL));
+}
+
+void test_full_packet_transfer_ends_with_zlp(void)
+{
+    // Arrange
+    static uint8_t data[128];
+    Enumerate();
+
+    // Act
+    USB_CDC_Write(&h, data, sizeof(data));
+
+    // Assert
+    TEST_ASSERT_EQUAL_INT(128, BulkIn(NULL));
+    TEST_ASSERT_EQUAL_INT(0, BulkIn(NULL));
+    TEST_ASSERT_EQUAL_INT(-1, BulkIn(NULL));
+    TEST_ASSERT_EQUAL_UINT32(1, h.Stats.TxZlps);
+}
+
+void test_no_zlp_when_more_data_follows(void)
+{
+    // Arrange
+    static uint8_t data[64];
+    Enumerate();
+    USB_CDC_Write(&h, data, sizeof(data));
+    USB_CDC_Write(&h, "tail", 4);
+
+    // Act / Assert
+    TEST_ASSERT_EQUAL_INT(64, BulkIn(NULL));
+    TEST_ASSERT_EQUAL_INT(4, BulkIn(NULL));
+    TEST_ASSERT_EQUAL_INT(-1, BulkIn(NULL));
+    TEST_ASSERT_EQUAL_UINT32(0, h.Stats.TxZlps);
+}
+
+void test_write_is_all_or_nothing(void)
+{
+    // Arrange
+    static uint8_t data[USB_CDC_TX_SIZE];
+    Enumerate();
+    USB_CDC_Write(&h, data, USB_CDC_TX_SIZE - 10U);
+
+    // Act / Assert
+    TEST_ASSERT_EQUAL_UINT32(0, USB_CDC_Write(&h, data, 11));
+    TEST_ASSERT_EQUAL_UINT32(11, h.Stats.TxDropped);
+    TEST_ASSERT_EQUAL_UINT32(10, USB_CDC_Write(&h, data, 10));
+    TEST_ASSERT_EQUAL_UINT32(0, USB_CDC_TxFree(&h));
+    BulkIn(NULL);
+    TEST_ASSERT_EQUAL_UINT32(USB_CDC_TX_SIZE / 2, USB_CDC_TxFree(&h));
+}
+
+void test_random_stream_arrives_intact(void)
+{
+    // Arrange
+    uint32_t seed = 1U;
+    uint32_t written = 0U;
+    uint32_t received = 0U;
+    uint32_t i;
+    int n;
+    Enumerate();
+    for (i = 0; i < sizeof(stream_out); i++)
+    {
+        stream_out[i] = (uint8_t)Random(&seed);
+    }
+
+    // Act: writes of 1-300 bytes, the host draining at its own pace
+    while (received < sizeof(stream_out))
+    {
+        if (written < sizeof(stream_out))
+        {
+            uint32_t length = 1U + Random(&seed) % 300U;
+            length = (length < sizeof(stream_out) - written) ? length : sizeof(stream_out) - written;
+            written += USB_CDC_Write(&h, &stream_out[written], length);
+        }
+        if ((Random(&seed) % 3U) == 0U)
+        {
+            n = BulkIn(&stream_in[received]);
+            received += (n > 0) ? (uint32_t)n : 0U;
+        }
+        if (written == sizeof(stream_out))
+        {
+            n = BulkIn(&stream_in[received]);
+            TEST_ASSERT_TRUE((n >= 0) || (received == written));
+            received += (n > 0) ? (uint32_t)n : 0U;
+        }
+    }
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(sizeof(stream_out), received);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(stream_out, stream_in, sizeof(stream_out)));
+    TEST_ASSERT_TRUE(sim.MaxTransfer <= USB_CDC_TX_SIZE / 2U);
+    TEST_ASSERT_TRUE(sim.InTransfers < sizeof(stream_out) / 64U);
+}
+
+void test_received_packets_are_read_in_order(void)
+{
+    // Arrange
+    uint8_t data[16] = {0};
+    Enumerate();
+
+    // Act
+    TEST_ASSERT_EQUAL_INT(1, BulkOut((const uint8_t *)"abc", 3));
+    TEST_ASSERT_EQUAL_INT(1, BulkOut((const uint8_t *)"defg", 4));
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(7, USB_CDC_Read(&h, data, sizeof(data)));
+    TEST_ASSERT_EQUAL_INT(0, memcmp("abcdefg", data, 7));
+    TEST_ASSERT_EQUAL_UINT32(0, USB_CDC_Read(&h, data, sizeof(data)));
+}
+
+void test_full_receive_ring_naks_until_read(void)
+{
+    // Arrange
+    uint8_t packet[USB_CDC_DATA_SIZE];
+    uint8_t data[USB_CDC_RX_SIZE];
+    uint32_t taken = 0U;
+    memset(packet, 0x42, sizeof(packet));
+    Enumerate();
+
+    // Act: the host keeps sending until the device stops arming
+    while (BulkOut(packet, sizeof(packet)))
+    {
+        taken++;
+    }
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(USB_CDC_RX_SIZE / USB_CDC_DATA_SIZE, taken);
+    TEST_ASSERT_EQUAL_UINT32(1, h.Stats.RxPaused);
+    TEST_ASSERT_EQUAL_UINT32(USB_CDC_DATA_SIZE, USB_CDC_Read(&h, data, USB_CDC_DATA_SIZE));
+    TEST_ASSERT_TRUE(sim.Out[USB_CDC_EP_OUT].Armed);
+    TEST_ASSERT_EQUAL_UINT32(USB_CDC_RX_SIZE - USB_CDC_DATA_SIZE, USB_CDC_Read(&h, data, sizeof(data)));
+}
+
+/* ============================================================================ */
+/* BUS EVENT TESTS */
+/* ============================================================================ */
+
+void test_reset_drops_pending_data(void)
+{
+    // Arrange
+    Enumerate();
+    USB_CDC_Write(&h, "abc", 3);
+    USB_CDC_Write(&h, "def", 3);
+
+    // Act
+    USB_CDC_Reset(&h);
+
+    // Assert
+    TEST_ASSERT_EQUAL(USB_CDC_DEFAULT, h.State);
+    TEST_ASSERT_EQUAL_UINT32(USB_CDC_TX_SIZE, USB_CDC_TxFree(&h));
+    TEST_ASSERT_FALSE(USB_CDC_Connected(&h));
+    TEST_ASSERT_EQUAL_UINT32(0, USB_CDC_Write(&h, "x", 1));
+    TEST_ASSERT_EQUAL_UINT32(2, h.Stats.Resets);
+}
+
+void test_halted_in_endpoint_resends_after_clear(void)
+{
+    // Arrange
+    uint8_t status[2];
+    uint8_t data[8] = {0};
+    Enumerate();
+    USB_CDC_Write(&h, "abc", 3);
+
+    // Act: the host halts 0x81 while "abc" is in flight, then clears it
+    TEST_ASSERT_EQUAL_INT(0, ControlOut(0x02, 0x03, 0, USB_CDC_EP_IN, NULL, 0));
+    TEST_ASSERT_TRUE(sim.Stalled[1][1]);
+    TEST_ASSERT_EQUAL_INT(2, ControlIn(0x82, 0x00, 0, USB_CDC_EP_IN, 2, status, NULL));
+    TEST_ASSERT_EQUAL_UINT8(1, status[0]);
+    USB_CDC_Write(&h, "de", 2);
+    TEST_ASSERT_FALSE(sim.In[1].Pending);
+    TEST_ASSERT_EQUAL_INT(0, ControlOut(0x02, 0x01, 0, USB_CDC_EP_IN, NULL, 0));
+
+    // Assert
+    TEST_ASSERT_FALSE(sim.Stalled[1][1]);
+    TEST_ASSERT_EQUAL_INT(5, BulkIn(data));
+    TEST_ASSERT_EQUAL_INT(0, memcmp("abcde", data, 5));
+    TEST_ASSERT_EQUAL_INT(2, ControlIn(0x82, 0x00, 0, USB_CDC_EP_IN, 2, status, NULL));
+    TEST_ASSERT_EQUAL_UINT8(0, status[0]);
+}
+
+void test_suspend_and_resume(void)
+{
+    // Arrange
+    Enumerate();
+
+    // Act / Assert
+    USB_CDC_Suspend(&h);
+    TEST_ASSERT_EQUAL(USB_CDC_SUSPENDED, h.State);
+    TEST_ASSERT_EQUAL_UINT32(0, USB_CDC_Write(&h, "x", 1));
+    USB_CDC_Suspend(&h);
+    USB_CDC_Resume(&h);
+    TEST_ASSERT_EQUAL(USB_CDC_CONFIGURED, h.State);
+    TEST_ASSERT_EQUAL_UINT32(1, USB_CDC_Write(&h, "x", 1));
+}
+
+/* ============================================================================ */
+/* MAIN TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Descriptor Tests */
+    RUN_TEST(test_device_descriptor);
+    RUN_TEST(test_configuration_descriptor_is_consistent);
+    RUN_TEST(test_string_descriptors_are_utf16);
+    RUN_TEST(test_long_string_is_cut_to_one_packet);
+
+    /* Enumeration Tests */
+    RUN_TEST(test_enumeration_configures_the_data_endpoints);
+    RUN_TEST(test_control_read_is_split_into_packets);
+    RUN_TEST(test_control_read_ends_with_zlp_on_full_packet);
+    RUN_TEST(test_unknown_requests_stall_endpoint_zero);
+    RUN_TEST(test_line_coding_round_trip);
+    RUN_TEST(test_closing_the_port_clears_connected);
+
+    /* Data Tests */
+    RUN_TEST(test_write_before_configuration_is_dropped);
+    RUN_TEST(test_write_transmits_from_the_ring);
+    RUN_TEST(test_writes_during_a_transfer_go_out_together);
+    RUN_TEST(test_transfer_is_at_most_half_the_ring);
+    RUN_TEST(test_full_packet_transfer_ends_with_zlp);
+    RUN_TEST(test_no_zlp_when_more_data_follows);
+    RUN_TEST(test_write_is_all_or_nothing);
+    RUN_TEST(test_random_stream_arrives_intact);
+    RUN_TEST(test_received_packets_are_read_in_order);
+    RUN_TEST(test_full_receive_ring_naks_until_read);
+
+    /* Bus Event Tests */
+    RUN_TEST(test_reset_drops_pending_data);
+    RUN_TEST(test_halted_in_endpoint_resends_after_clear);
+    RUN_TEST(test_suspend_and_resume);
+
+    return UNITY_END();
+}
@@ -0,0 +1,328 @@
+/**
+  ******************************************************************************
+  * @file    test_watchdog.c
+  * @author  Test Framework
+  * @brief   Unit tests for the watchdog supervisor
+  ******************************************************************************
+  * A virtual clock stands in for HAL_GetTick(); Advance() moves it and runs
+  * the periodic check the way SUPERVISOR_Tick() does, counting the refreshes
+  * the hardware watchdog would have received.
+  ******************************************************************************
+  */
+
+#include "unity.h"
+#include "watchdog.h"
+#include <string.h>
+
+#define CHECK_PERIOD   100U
+
+static WDOG_HandleTypeDef hwdog;
+static WDOG_RecordTypeDef record;
+static uint32_t           now;
+static uint32_t           refreshes;
+
+/* ============================================================================ */
+/* HELPERS */
+/* ============================================================================ */
+
+/* Run the clock forward in check periods; returns the last check result */
+static WDOG_StatusTypeDef Advance(uint32_t ticks)
+{
+    WDOG_StatusTypeDef status = WDOG_OK;
+    uint32_t end = now + ticks;
+    while (now != end)
+    {
+        now += CHECK_PERIOD;
+        status = WDOG_Check(&hwdog, now);
+        if (status == WDOG_OK)
+        {
+            refreshes++;
+        }
+    }
+    return status;
+}
+
+static uint32_t Register(const char *name, uint32_t deadline)
+{
+    uint32_t id = 99;
+    TEST_ASSERT_EQUAL(WDOG_OK, WDOG_Register(&hwdog, name, deadline, now, &id));
+    return id;
+}
+
+/* ============================================================================ */
+/* TEST SETUP AND TEARDOWN */
+/* ============================================================================ */
+
+void setUp(void)
+{
+    WDOG_Init(&hwdog);
+    memset(&record, 0xA5, sizeof(record));   /* power-on garbage */
+    now = 0;
+    refreshes = 0;
+}
+
+void tearDown(void)
+{
+}
+
+/* ============================================================================ */
+/* REGISTRATION TESTS */
+/* ============================================================================ */
+
+void test_register_hands_out_ids_until_full(void)
+{
+    // Arrange
+    uint32_t id;
+    uint32_t i;
+
+    // Act & Assert
+    for (i = 0; i < WDOG_MAX_TASKS; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(i, Register("task", 100));
+    }
+    TEST_ASSERT_EQUAL(WDOG_FULL, WDOG_Register(&hwdog, "extra", 100, now, &id));
+}
+
+void test_register_rejects_bad_arguments(void)
+{
+    uint32_t id;
+    TEST_ASSERT_EQUAL(WDOG_INVALID, WDOG_Register(&hwdog, NULL, 100, now, &id));
+    TEST_ASSERT_EQUAL(WDOG_INVALID, WDOG_Register(&hwdog, "zero", 0, now, &id));
+    TEST_ASSERT_EQUAL(WDOG_INVALID, WDOG_Register(&hwdog, "noid", 100, now, NULL));
+    TEST_ASSERT_EQUAL_UINT32(0, hwdog.Count);
+}
+
+void test_no_tasks_always_refreshes(void)
+{
+    TEST_ASSERT_EQUAL(WDOG_OK, Advance(1000));
+    TEST_ASSERT_EQUAL_UINT32(10, refreshes);
+}
+
+/* ============================================================================ */
+/* DEADLINE TESTS */
+/* ============================================================================ */
+
+void test_healthy_tasks_keep_refreshing(void)
+{
+    // Arrange
+    uint32_t fast = Register("fast", 200);
+    uint32_t slow = Register("slow", 1000);
+    uint32_t i;
+
+    // Act: fast beats every 200, slow every 1000, for 10 s
+    for (i = 0; i < 50; i++)
+    {
+        TEST_ASSERT_EQUAL(WDOG_OK, Advance(200));
+        WDOG_Heartbeat(&hwdog, fast, now);
+        if ((i % 5) == 4)
+        {
+            WDOG_Heartbeat(&hwdog, slow, now);
+        }
+    }
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(100, refreshes);
+    TEST_ASSERT_EQUAL_INT32(-1, hwdog.Starved);
+    TEST_ASSERT_EQUAL_UINT32(50, hwdog.Tasks[fast].Beats);
+    TEST_ASSERT_EQUAL_UINT32(200, hwdog.Tasks[fast].WorstGap);
+    TEST_ASSERT_EQUAL_UINT32(1000, hwdog.Tasks[slow].WorstGap);
+}
+
+void test_deadline_is_inclusive(void)
+{
+    // Arrange
+    Register("edge", 300);
+
+    // Act & Assert: exactly 300 ticks late is still on time
+    TEST_ASSERT_EQUAL(WDOG_OK, Advance(300));
+    TEST_ASSERT_EQUAL(WDOG_STARVED, Advance(100));
+    TEST_ASSERT_EQUAL_UINT32(3, refreshes);
+    TEST_ASSERT_EQUAL_UINT32(100, hwdog.Overdue);
+}
+
+void test_missed_deadline_stops_refresh(void)
+{
+    // Arrange
+    uint32_t alive = Register("alive", 500);
+    uint32_t stuck = Register("stuck", 500);
+    uint32_t i;
+
+    // Act: only one of the two tasks keeps beating
+    for (i = 0; i < 8; i++)
+    {
+        Advance(100);
+        WDOG_Heartbeat(&hwdog, alive, now);
+    }
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT32(5, refreshes);
+    TEST_ASSERT_EQUAL_INT32((int32_t)stuck, hwdog.Starved);
+    TEST_ASSERT_EQUAL_UINT32(100, hwdog.Overdue);   /* as first detected */
+}
+
+void test_starvation_is_latched(void)
+{
+    // Arrange
+    uint32_t id = Register("late", 100);
+    Advance(200);
+    TEST_ASSERT_EQUAL_INT32((int32_t)id, hwdog.Starved);
+
+    // Act: the task recovers
+    WDOG_Heartbeat(&hwdog, id, now);
+
+    // Assert: the watchdog must still expire
+    TEST_ASSERT_EQUAL(WDOG_STARVED, Advance(100));
+    TEST_ASSERT_EQUAL_UINT32(1, refreshes);
+}
+
+void test_most_overdue_task_is_blamed(void)
+{
+    // Arrange: both miss in the same check, "long" by less
+    Register("long", 250);
+    uint32_t shorter = Register("short", 210);
+
+    // Act
+    TEST_ASSERT_EQUAL(WDOG_STARVED, Advance(300));
+
+    // Assert
+    TEST_ASSERT_EQUAL_INT32((int32_t)shorter, hwdog.Starved);
+    TEST_ASSERT_EQUAL_UINT32(90, hwdog.Overdue);
+}
+
+void test_suspended_task_is_not_checked(void)
+{
+    // Arrange
+    uint32_t id = Register("sleepy", 200);
+    WDOG_Suspend(&hwdog, id);
+
+    // Act & Assert
+    TEST_ASSERT_EQUAL(WDOG_OK, Advance(1000));
+    WDOG_Resume(&hwdog, id, now);
+    TEST_ASSERT_EQUAL(WDOG_OK, Advance(200));
+    TEST_ASSERT_EQUAL(WDOG_STARVED, Advance(100));
+}
+
+void test_clock_wrap_is_handled(void)
+{
+    // Arrange
+    uint32_t id;
+    now = 0xFFFFFF00U;
+    id = Register("wrap", 400);
+
+    // Act & Assert
+    TEST_ASSERT_EQUAL(WDOG_OK, Advance(300));
+    WDOG_Heartbeat(&hwdog, id, now);
+    TEST_ASSERT_EQUAL(WDOG_OK, Advance(400));
+    TEST_ASSERT_EQUAL_UINT32(300, hwdog.Tasks[id].WorstGap);
+}
+
+void test_unknown_id_is_ignored(void)
+{
+    Register("one", 100);
+    WDOG_Heartbeat(&hwdog, 5, now);
+    WDOG_Suspend(&hwdog, 5);
+    WDOG_Resume(&hwdog, 5, now);
+    TEST_ASSERT_EQUAL_UINT32(0, hwdog.Tasks[0].Beats);
+    TEST_ASSERT_EQUAL_UINT8(0, hwdog.Tasks[5].Suspended);
+}
+
+/* ============================================================================ */
+/* RECORD TESTS */
+/* ============================================================================ */
+
+void test_record_names_the_starved_task(void)
+{
+    // Arrange
+    char line[80];
+    Register("main", 2000);
+    Register("audio-mixer-loop", 500);
+    Advance(1500);
+
+    // Act
+    WDOG_Record(&hwdog, &record);
+
+    // Assert: long names are cut to WDOG_NAME_MAX - 1
+    TEST_ASSERT_EQUAL_UINT8(1, WDOG_RecordIsPending(&record));
+    TEST_ASSERT_EQUAL_UINT32(1, record.Task);
+    TEST_ASSERT_EQUAL_UINT32(100, record.Overdue);
+    WDOG_FormatRecord(&record, line, sizeof(line));
+    TEST_ASSERT_EQUAL_STRING("watchdog 1: task 1 'audio-mixer' starved, 100 ms overdue", line);
+}
+
+void test_record_needs_a_starved_task(void)
+{
+    // Arrange
+    Register("ok", 1000);
+    Advance(500);
+
+    // Act
+    WDOG_Record(&hwdog, &record);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT8(0, WDOG_RecordIsPending(&record));
+}
+
+void test_record_count_survives_report(void)
+{
+    // Arrange
+    Register("late", 100);
+    Advance(200);
+    WDOG_Record(&hwdog, &record);
+
+    // Act
+    WDOG_RecordMarkReported(&record);
+    TEST_ASSERT_EQUAL_UINT8(0, WDOG_RecordIsPending(&record));
+    WDOG_Record(&hwdog, &record);
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT8(1, WDOG_RecordIsPending(&record));
+    TEST_ASSERT_EQUAL_UINT32(2, record.Count);
+}
+
+void test_corrupted_record_is_rejected(void)
+{
+    // Arrange
+    Register("late", 100);
+    Advance(200);
+    WDOG_Record(&hwdog, &record);
+
+    // Act
+    record.Overdue ^= 0x10;
+
+    // Assert
+    TEST_ASSERT_EQUAL_UINT8(0, WDOG_RecordIsPending(&record));
+    record.Overdue ^= 0x10;
+    TEST_ASSERT_EQUAL_UINT8(1, WDOG_RecordIsPending(&record));
+}
+
+/* ============================================================================ */
+/* MAIN TEST RUNNER */
+/* ============================================================================ */
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    /* Registration Tests */
+    RUN_TEST(test_register_hands_out_ids_until_full);
+    RUN_TEST(test_register_rejects_bad_arguments);
+    RUN_TEST(test_no_tasks_always_refreshes);
+
+    /* Deadline Tests */
+    RUN_TEST(test_healthy_tasks_keep_refreshing);
+    RUN_TEST(test_deadline_is_inclusive);
+    RUN_TEST(test_missed_deadline_stops_refresh);
+    RUN_TEST(test_starvation_is_latched);
+    RUN_TEST(test_most_overdue_task_is_blamed);
+    RUN_TEST(test_suspended_task_is_not_checked);
+    RUN_TEST(test_clock_wrap_is_handled);
+    RUN_TEST(test_unknown_id_is_ignored);
+
+    /* Record Tests */
+    RUN_TEST(test_record_names_the_starved_task);
+    RUN_TEST(test_record_needs_a_starved_task);
+    RUN_TEST(test_record_count_survives_report);
+    RUN_TEST(test_corrupted_record_is_rejected);
+
+    return UNITY_END();
+}
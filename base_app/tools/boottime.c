@@ -0,0 +1,77 @@
+/**
+  ******************************************************************************
+  * @file    boottime.c
+  * @brief   Host decoder for the boot record read back over the debugger.
+  ******************************************************************************
+  * Usage: openocd ... -c "mdw <BootRecord> 22" 2>&1 | boottime
+  *
+  * Reads OpenOCD "mdw" output ("0x20000100: 544f4f42 0000000a ...") from
+  * stdin, rebuilds BOOT_RecordTypeDef (boot.h) and prints the boot-time
+  * breakdown. "make boottime" does all of it on a connected board. Build
+  * with "make -f test.mk boottime".
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "boot.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BOOTTIME_WORDS  (sizeof(BOOT_RecordTypeDef) / sizeof(uint32_t))
+
+/* Main ----------------------------------------------------------------------*/
+
+int main(void)
+{
+  uint32_t words[BOOTTIME_WORDS];
+  BOOT_RecordTypeDef record;
+  char line[256];
+  char out[BOOT_LINE_MAX];
+  uint32_t count = 0U;
+  uint32_t phase;
+  char *p;
+  char *end;
+
+  while ((count < BOOTTIME_WORDS) && (fgets(line, sizeof(line), stdin) != NULL))
+  {
+    /* Only "0x<address>: <word> <word> ..." lines carry memory */
+    p = strchr(line, ':');
+    if ((strncmp(line, "0x", 2) != 0) || (p == NULL))
+    {
+      continue;
+    }
+    p++;
+    while (count < BOOTTIME_WORDS)
+    {
+      unsigned long value = strtoul(p, &end, 16);
+
+      if (end == p)
+      {
+        break;
+      }
+      words[count++] = (uint32_t)value;
+      p = end;
+    }
+  }
+  if (count < BOOTTIME_WORDS)
+  {
+    fprintf(stderr, "boottime: expected %u words, got %u\n", (unsigned)BOOTTIME_WORDS, (unsigned)count);
+    return 1;
+  }
+
+  memcpy(&record, words, sizeof(record));
+  if (BOOT_IsValid(&record) == 0U)
+  {
+    fprintf(stderr, "boottime: no boot record (did the board boot?)\n");
+    return 1;
+  }
+  for (phase = BOOT_PH_SYSTEMINIT; phase < record.Count; phase++)
+  {
+    BOOT_Format(&record, phase, out, sizeof(out));
+    printf("%s\n", out);
+  }
+  printf("reset to main: %lu us\n", (unsigned long)BOOT_TotalUs(&record, BOOT_PH_MAIN));
+  return 0;
+}
@@ -0,0 +1,88 @@
+/**
+  ******************************************************************************
+  * @file    fixmath_gen.c
+  * @brief   Host generator for the fixed-point math tables (fixmath.h).
+  ******************************************************************************
+  * Usage: fixmath_gen > fixmath_tables.c
+  *
+  * Computes every table in double precision from the sizes in fixmath.h
+  * and prints them as a C source of const arrays, rounded to nearest. The
+  * firmware Makefile and test.mk both run it into their build directory,
+  * so the tables cannot drift from the code that indexes them. Build with
+  * "make -f test.mk fixmath_gen".
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <stdio.h>
+#include "fixmath.h"
+
+/* Private define ------------------------------------------------------------*/
+#define FIXMATH_GEN_PI          3.14159265358979323846
+#define FIXMATH_GEN_PER_LINE    8U
+
+/* Private functions ---------------------------------------------------------*/
+
+/* One array, FIXMATH_GEN_PER_LINE values per line */
+static void FIXMATH_GEN_Array(const char *decl, const long long *values, unsigned count)
+{
+  unsigned i;
+
+  printf("\n%s =\n{", decl);
+  for (i = 0U; i < count; i++)
+  {
+    printf("%s%lld%s", ((i % FIXMATH_GEN_PER_LINE) == 0U) ? "\n  " : " ", values[i],
+           (i + 1U < count) ? "," : "");
+  }
+  printf("\n};\n");
+}
+
+/* Main ----------------------------------------------------------------------*/
+
+int main(void)
+{
+  long long values[1U << FIX_SEED_BITS];
+  double gain = 1.0;
+  double m;
+  unsigned i;
+
+  printf("/* Generated by tools/fixmath_gen.c from the sizes in fixmath.h; do not edit */\n\n");
+  printf("#include \"fixmath.h\"\n");
+
+  /* CORDIC: atan(2^-i) as a fraction of a turn, and the gain of all steps */
+  for (i = 0U; i < FIX_CORDIC_STEPS; i++)
+  {
+    values[i] = llround(atan(ldexp(1.0, -(int)i)) / (2.0 * FIXMATH_GEN_PI) * 4294967296.0);
+    gain *= sqrt(1.0 + ldexp(1.0, -2 * (int)i));
+  }
+  FIXMATH_GEN_Array("const uint32_t FIX_AtanTable[FIX_CORDIC_STEPS]", values, FIX_CORDIC_STEPS);
+  printf("\nconst int32_t FIX_CordicGain = %lld;\n", llround(ldexp(1.0 / gain, 30)));
+
+  /* Quarter sine at the segment ends; 1.0 does not fit Q15 */
+  for (i = 0U; i <= (1U << FIX_SIN_BITS); i++)
+  {
+    values[i] = llround(sin(ldexp((double)i, -(int)FIX_SIN_BITS) * FIXMATH_GEN_PI / 2.0) * 32768.0);
+    values[i] = (values[i] > 32767) ? 32767 : values[i];
+  }
+  printf("\n/* The last entry is only read at exactly 90 degrees */");
+  FIXMATH_GEN_Array("const int16_t FIX_SinTable[(1UL << FIX_SIN_BITS) + 1U]", values,
+                    (1U << FIX_SIN_BITS) + 1U);
+
+  /* Newton seeds at the middle of each interval: m in [0.5, 1) for the
+     reciprocal, [0.25, 1) for the reciprocal root */
+  for (i = 0U; i < (1U << FIX_SEED_BITS); i++)
+  {
+    m = ((double)((1U << FIX_SEED_BITS) + i) + 0.5) / (double)(2U << FIX_SEED_BITS);
+    values[i] = llround(32768.0 / m);
+  }
+  FIXMATH_GEN_Array("const uint16_t FIX_RecipSeed[1UL << FIX_SEED_BITS]", values, 1U << FIX_SEED_BITS);
+  for (i = 0U; i < (3U << (FIX_SEED_BITS - 2U)); i++)
+  {
+    m = ((double)((1U << (FIX_SEED_BITS - 2U)) + i) + 0.5) / (double)(1U << FIX_SEED_BITS);
+    values[i] = llround(32768.0 / sqrt(m));
+  }
+  FIXMATH_GEN_Array("const uint16_t FIX_RsqrtSeed[3UL << (FIX_SEED_BITS - 2U)]", values,
+                    3U << (FIX_SEED_BITS - 2U));
+  return 0;
+}
@@ -0,0 +1,130 @@
+/**
+  ******************************************************************************
+  * @file    lzcat.c
+  * @brief   Host decoder for the compressed console (console_lz.h).
+  ******************************************************************************
+  * Usage: lzcat [-v] < capture
+  *        stty -F /dev/ttyACM0 115200 raw && lzcat < /dev/ttyACM0
+  *
+  * Copies stdin to stdout, decoding the console frames and passing the raw
+  * output of the other modules through as it is, binary blocks without
+  * their header, so a trace dump (trace.h) comes out ready for trace2json.
+  * Frames before the first restart cannot be decoded and are dropped; so
+  * is the rest of the stream up to the next restart after a corrupt frame.
+  * With -v the byte counts and the ratio of the frames go to stderr at the
+  * end.
+  * Build with "make -f test.mk lzcat".
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "lzss.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Frame markers, as in console_lz.h */
+#define LZCAT_CONTINUE  0x00
+#define LZCAT_RESTART   0x01
+#define LZCAT_BINARY    0x02
+
+/* Longest frame output: every two bytes a match of the longest length */
+#define LZCAT_OUT_MAX   (255U * 258U)
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t Window[LZSS_WINDOW_SIZE(LZSS_WINDOW_BITS_MAX)];
+static uint8_t Frame[255];
+static uint8_t Out[LZCAT_OUT_MAX];
+
+/* Main ----------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+  LZSS_DecoderTypeDef dec;
+  LZSS_StatusTypeDef status;
+  unsigned long wire = 0UL;
+  unsigned long text = 0UL;
+  unsigned long dropped = 0UL;
+  uint32_t produced;
+  int verbose = ((argc > 1) && (strcmp(argv[1], "-v") == 0));
+  int synced = 0;
+  int c;
+  int bits;
+  int length;
+  int high;
+
+  while ((c = getchar()) != EOF)
+  {
+    if (c == LZCAT_BINARY)
+    {
+      /* Little-endian length, then the bytes as they are */
+      length = getchar();
+      high = getchar();
+      if ((length == EOF) || (high == EOF))
+      {
+        fprintf(stderr, "lzcat: truncated binary block\n");
+        break;
+      }
+      for (length += high * 256; (length > 0) && ((c = getchar()) != EOF); length--)
+      {
+        putchar(c);
+      }
+      if (length > 0)
+      {
+        fprintf(stderr, "lzcat: truncated binary block\n");
+        break;
+      }
+      fflush(stdout);
+      continue;
+    }
+    if ((c != LZCAT_CONTINUE) && (c != LZCAT_RESTART))
+    {
+      putchar(c);
+      if (c == '\n')
+      {
+        fflush(stdout);
+      }
+      continue;
+    }
+
+    /* Header, then the payload */
+    bits = (c == LZCAT_RESTART) ? getchar() : 0;
+    length = getchar();
+    if ((bits == EOF) || (length == EOF) || (fread(Frame, 1U, (size_t)length, stdin) != (size_t)length))
+    {
+      fprintf(stderr, "lzcat: truncated frame\n");
+      break;
+    }
+    wire += 2UL + ((c == LZCAT_RESTART) ? 1UL : 0UL) + (unsigned long)length;
+    if (c == LZCAT_RESTART)
+    {
+      synced = (LZSS_DecoderInit(&dec, Window, (uint32_t)bits) == LZSS_OK);
+      if (synced == 0)
+      {
+        fprintf(stderr, "lzcat: window of %d bits not supported\n", bits);
+      }
+    }
+    if (synced == 0)
+    {
+      dropped++;
+      continue;
+    }
+
+    status = LZSS_Decode(&dec, Frame, (uint32_t)length, Out, sizeof(Out), &produced);
+    fwrite(Out, 1U, produced, stdout);
+    text += produced;
+    if (status != LZSS_OK)
+    {
+      fprintf(stderr, "lzcat: corrupt frame, waiting for a restart\n");
+      synced = 0;
+    }
+    fflush(stdout);
+  }
+
+  if (verbose != 0)
+  {
+    fprintf(stderr, "lzcat: %lu bytes of frames, %lu of text, ratio %.2f, %lu frames dropped\n",
+            wire, text, (wire != 0UL) ? ((double)text / (double)wire) : 0.0, dropped);
+  }
+  return 0;
+}
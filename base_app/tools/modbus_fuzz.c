@@ -0,0 +1,222 @@
+/**
+  ******************************************************************************
+  * @file    modbus_fuzz.c
+  * @brief   Fuzz harness for the Modbus RTU protocol engine.
+  ******************************************************************************
+  * Usage: modbus_fuzz [iterations | frame files...]
+  *
+  * Each input is one request frame for a slave at address 1 on a small map
+  * of read-only and writable regions. Most inputs would fail the CRC, so
+  * the harness also runs every input with its CRC fixed up. It aborts when
+  * a response is longer than MODBUS_ADU_MAX, has a bad CRC or echoes the
+  * wrong function, or when a callback gets an index outside its region.
+  *
+  * Built with "make -f test.mk modbus_fuzz" it runs random and mutated
+  * frames under AddressSanitizer and UBSan, or replays frame files. With
+  * clang and MODBUS_FUZZ_LIBFUZZER defined, LLVMFuzzerTestOneInput() is the
+  * libFuzzer entry point and main() is left out:
+  *
+  *   clang -DMODBUS_FUZZ_LIBFUZZER -fsanitize=fuzzer,address -IInc \
+  *         tools/modbus_fuzz.c src/modbus.c
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "modbus.h"
+
+/* Private define ------------------------------------------------------------*/
+#define FUZZ_SLAVE          1U
+#define FUZZ_ITERATIONS     1000000UL
+
+/* Private variables ---------------------------------------------------------*/
+static uint16_t FuzzHolding[16];
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Fuzz_Fail(const char *what)
+{
+  fprintf(stderr, "modbus_fuzz: %s\n", what);
+  abort();
+}
+
+static uint16_t Fuzz_ReadStatus(uint16_t index)
+{
+  if (index >= 4U)
+  {
+    Fuzz_Fail("status index out of range");
+  }
+  return index;
+}
+
+static uint16_t Fuzz_ReadHolding(uint16_t index)
+{
+  if (index >= 16U)
+  {
+    Fuzz_Fail("holding index out of range");
+  }
+  return FuzzHolding[index];
+}
+
+static uint8_t Fuzz_WriteHolding(uint16_t index, uint16_t value)
+{
+  if (index >= 16U)
+  {
+    Fuzz_Fail("holding index out of range");
+  }
+  FuzzHolding[index] = value;
+  return (value == 0xFFFFU) ? MODBUS_EX_VALUE : 0U;
+}
+
+static const MODBUS_RegionTypeDef FuzzRegions[] =
+{
+  { 0x0000U, 4U, Fuzz_ReadStatus, NULL },
+  { 0x0004U, 16U, Fuzz_ReadHolding, Fuzz_WriteHolding },
+  { 0x8000U, 4U, Fuzz_ReadStatus, NULL },
+  { 0xFFF0U, 16U, Fuzz_ReadHolding, Fuzz_WriteHolding },
+};
+
+static void Fuzz_Run(const uint8_t *data, size_t size)
+{
+  static MODBUS_SlaveTypeDef slave;
+  static uint8_t request[MODBUS_ADU_MAX];
+  static uint8_t response[MODBUS_ADU_MAX];
+  uint8_t *exact;
+  uint32_t length;
+  uint16_t crc;
+
+  if ((slave.Regions == NULL) &&
+      (MODBUS_Init(&slave, FUZZ_SLAVE, FuzzRegions, sizeof(FuzzRegions) / sizeof(FuzzRegions[0])) != MODBUS_OK))
+  {
+    Fuzz_Fail("bad map");
+  }
+
+  /* As received, then with the CRC made good; an exact-size copy lets the
+   * sanitizer see any read past the frame */
+  length = (uint32_t)((size < MODBUS_ADU_MAX) ? size : MODBUS_ADU_MAX);
+  memcpy(request, data, length);
+  (void)MODBUS_Process(&slave, data, (uint32_t)size, response);
+  if (length < 4U)
+  {
+    return;
+  }
+  crc = MODBUS_Crc16(request, length - 2U);
+  request[length - 2U] = (uint8_t)crc;
+  request[length - 1U] = (uint8_t)(crc >> 8);
+  exact = malloc(length);
+  if (exact == NULL)
+  {
+    Fuzz_Fail("out of memory");
+  }
+  memcpy(exact, request, length);
+
+  length = MODBUS_Process(&slave, exact, length, response);
+  if (length > MODBUS_ADU_MAX)
+  {
+    Fuzz_Fail("response too long");
+  }
+  if (length != 0U)
+  {
+    crc = MODBUS_Crc16(response, length - 2U);
+    if ((length < 5U) || (response[length - 2U] != (uint8_t)crc) ||
+        (response[length - 1U] != (uint8_t)(crc >> 8)) || (response[0] != FUZZ_SLAVE) ||
+        ((response[1] & 0x7FU) != exact[1]))
+    {
+      Fuzz_Fail("malformed response");
+    }
+  }
+  free(exact);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  Fuzz_Run(data, size);
+  return 0;
+}
+
+#ifndef MODBUS_FUZZ_LIBFUZZER
+static uint8_t *Fuzz_Load(const char *path, size_t *size)
+{
+  FILE *in = fopen(path, "rb");
+  uint8_t *data = NULL;
+  long len;
+
+  if (in == NULL)
+  {
+    return NULL;
+  }
+  if ((fseek(in, 0, SEEK_END) == 0) && ((len = ftell(in)) >= 0) && (fseek(in, 0, SEEK_SET) == 0))
+  {
+    data = malloc((size_t)len + 1U);
+    if ((data != NULL) && (fread(data, 1, (size_t)len, in) != (size_t)len))
+    {
+      free(data);
+      data = NULL;
+    }
+    *size = (size_t)len;
+  }
+  fclose(in);
+  return data;
+}
+
+int main(int argc, char **argv)
+{
+  static const uint8_t functions[] = { 0x03U, 0x04U, 0x06U, 0x08U, 0x10U };
+  uint8_t frame[MODBUS_ADU_MAX + 8U];
+  unsigned long iterations = FUZZ_ITERATIONS;
+  unsigned long n;
+  uint32_t seed = 1U;
+  uint8_t *data;
+  size_t size;
+  size_t i;
+  int arg;
+
+  if ((argc > 1) && (strtoul(argv[1], NULL, 10) == 0UL))
+  {
+    for (arg = 1; arg < argc; arg++)
+    {
+      data = Fuzz_Load(argv[arg], &size);
+      if (data == NULL)
+      {
+        fprintf(stderr, "modbus_fuzz: cannot read %s\n", argv[arg]);
+        return 1;
+      }
+      Fuzz_Run(data, size);
+      free(data);
+    }
+    printf("modbus_fuzz: %d frames OK\n", argc - 1);
+    return 0;
+  }
+  if (argc > 1)
+  {
+    iterations = strtoul(argv[1], NULL, 10);
+  }
+
+  /* Well-formed headers with random fields, lengths and tails */
+  for (n = 0UL; n < iterations; n++)
+  {
+    seed = (seed * 1103515245U) + 12345U;
+    size = (seed >> 8) % sizeof(frame);
+    for (i = 0U; i < size; i++)
+    {
+      seed = (seed * 1103515245U) + 12345U;
+      frame[i] = (uint8_t)(seed >> 16);
+    }
+    if (size >= 2U)
+    {
+      frame[0] = ((n & 15UL) == 0UL) ? 0U : FUZZ_SLAVE;
+      frame[1] = functions[(seed >> 3) % sizeof(functions)];
+    }
+    if (((n & 1UL) != 0UL) && (size >= 6U))
+    {
+      frame[2] = ((n & 2UL) != 0UL) ? 0xFFU : 0x00U;
+      frame[4] = 0x00U;
+    }
+    Fuzz_Run(frame, size);
+  }
+  printf("modbus_fuzz: %lu frames OK\n", iterations);
+  return 0;
+}
+#endif /* MODBUS_FUZZ_LIBFUZZER */
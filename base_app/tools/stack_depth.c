@@ -0,0 +1,1279 @@
+/**
+  ******************************************************************************
+  * @file    stack_depth.c
+  * @brief   Worst-case stack depth from the compiler's stack usage and call
+  *          graph output, checked against a budget per stack.
+  ******************************************************************************
+  * A report reads:
+  *
+  *   msp: 1456 of 1920 bytes, 464 spare, 4 interrupt levels
+  *     main 712: main > printMsg > vsprintf?
+  *     isr 15 SysTick_Handler 96: SysTick_Handler > KERNEL_Tick
+  *   warning: vsprintf: unknown size
+  *
+  * "?" marks a function of unknown size on the worst path. Recursion is
+  * counted once, and a call through a pointer not described in the
+  * configuration not at all: the depth of a stack with warnings is a lower
+  * bound.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "stack_depth.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define STACK_DEPTH_HASH_SIZE   (2U * STACK_DEPTH_FUNCS_MAX)
+#define STACK_DEPTH_INDIRECT_TITLE "__indirect_call"
+
+/* Report lines */
+#define STACK_DEPTH_LINE_STACK  0U
+#define STACK_DEPTH_LINE_ENTRY  1U
+#define STACK_DEPTH_LINE_FUNC   2U
+
+/* Depth walk states */
+#define STACK_DEPTH_NEW         0U
+#define STACK_DEPTH_ON_PATH     1U
+#define STACK_DEPTH_DONE        2U
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t STACK_DEPTH_Hash(const char *name);
+static int32_t  STACK_DEPTH_Lookup(const STACK_DEPTH_GraphTypeDef *graph, const char *name);
+static int32_t  STACK_DEPTH_Intern(STACK_DEPTH_GraphTypeDef *graph, const char *name);
+static STACK_DEPTH_StatusTypeDef STACK_DEPTH_AddCall(STACK_DEPTH_GraphTypeDef *graph, uint32_t caller,
+                                                     uint32_t callee);
+static uint8_t  STACK_DEPTH_Field(const char *line, const char *key, char *out, uint32_t size);
+static uint8_t  STACK_DEPTH_Copy(char *out, const char *in, uint32_t len, uint32_t size);
+static uint8_t  STACK_DEPTH_Number(const char *text, uint32_t *value);
+static int32_t  STACK_DEPTH_StackIndex(const STACK_DEPTH_GraphTypeDef *graph, const char *name);
+static STACK_DEPTH_StatusTypeDef STACK_DEPTH_LinkPrefix(STACK_DEPTH_GraphTypeDef *graph,
+                                                        const STACK_DEPTH_LinkTypeDef *link, uint32_t len,
+                                                        const char **missing);
+static uint8_t  STACK_DEPTH_Problems(const STACK_DEPTH_FuncTypeDef *func);
+static void     STACK_DEPTH_Walk(STACK_DEPTH_GraphTypeDef *graph, uint32_t index);
+static const char *STACK_DEPTH_ShortName(const char *name);
+static uint32_t STACK_DEPTH_Length(int n, uint32_t size);
+static int      STACK_DEPTH_CompareSite(const void *a, const void *b);
+static int      STACK_DEPTH_CompareCall(const void *a, const void *b);
+static int      STACK_DEPTH_CompareImage(const void *a, const void *b);
+static uint32_t STACK_DEPTH_PushBytes(const char *list);
+static uint8_t  STACK_DEPTH_IsExtern(const STACK_DEPTH_GraphTypeDef *graph, const char *name);
+static STACK_DEPTH_StatusTypeDef STACK_DEPTH_ApplyImage(STACK_DEPTH_GraphTypeDef *graph);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Empty a graph, with the default exception frame size.
+  * @param  graph: Graph
+  * @retval None
+  */
+void STACK_DEPTH_Init(STACK_DEPTH_GraphTypeDef *graph)
+{
+  memset(graph, 0, sizeof(*graph));
+  graph->Frame = STACK_DEPTH_FRAME_DEFAULT;
+}
+
+/**
+  * @brief  Add one .su line: "file:line:col:name<TAB>bytes<TAB>kind".
+  * @param  graph: Graph
+  * @param  line: Line, with or without its terminator
+  * @retval STACK_DEPTH_OK, STACK_DEPTH_IGNORED for a blank line
+  */
+STACK_DEPTH_StatusTypeDef STACK_DEPTH_ParseUsage(STACK_DEPTH_GraphTypeDef *graph, const char *line)
+{
+  STACK_DEPTH_SiteTypeDef *site;
+  const char *tab = strchr(line, '\t');
+  const char *name;
+  char *end;
+
+  if (line[strspn(line, " \t\r\n")] == '\0')
+  {
+    return STACK_DEPTH_IGNORED;
+  }
+  if (tab == NULL)
+  {
+    return STACK_DEPTH_SYNTAX;
+  }
+  /* The location is everything before the name */
+  for (name = tab; (name > line) && (name[-1] != ':'); name--)
+  {
+  }
+  if (name <= line + 1)
+  {
+    return STACK_DEPTH_SYNTAX;
+  }
+  if (graph->UsageCount >= STACK_DEPTH_FUNCS_MAX)
+  {
+    return STACK_DEPTH_FULL;
+  }
+  site = &graph->Usage[graph->UsageCount];
+  if (STACK_DEPTH_Copy(site->Location, line, (uint32_t)(name - 1 - line), sizeof(site->Location)) == 0U)
+  {
+    return STACK_DEPTH_SYNTAX;
+  }
+  site->Value = (uint32_t)strtoul(tab + 1, &end, 10);
+  if (end == tab + 1)
+  {
+    return STACK_DEPTH_SYNTAX;
+  }
+  /* "dynamic,bounded" still has a known maximum */
+  site->Dynamic = ((strstr(end, "dynamic") != NULL) && (strstr(end, "bounded") == NULL)) ? 1U : 0U;
+  graph->UsageCount++;
+  return STACK_DEPTH_OK;
+}
+
+/**
+  * @brief  Add one .ci line: a node or an edge; anything else is ignored.
+  * @param  graph: Graph
+  * @param  line: Line
+  * @retval STACK_DEPTH_OK, STACK_DEPTH_IGNORED, or why it was not added
+  */
+STACK_DEPTH_StatusTypeDef STACK_DEPTH_ParseGraph(STACK_DEPTH_GraphTypeDef *graph, const char *line)
+{
+  STACK_DEPTH_SiteTypeDef *site;
+  char title[STACK_DEPTH_NAME_MAX];
+  char label[2U * STACK_DEPTH_NAME_MAX];
+  char target[STACK_DEPTH_NAME_MAX];
+  const char *location;
+  const char *end;
+  int32_t func;
+  int32_t callee;
+
+  if (strncmp(line, "node:", 5) == 0)
+  {
+    if ((STACK_DEPTH_Field(line, "title", title, sizeof(title)) == 0U) ||
+        (STACK_DEPTH_Field(line, "label", label, sizeof(label)) == 0U))
+    {
+      return STACK_DEPTH_SYNTAX;
+    }
+    func = STACK_DEPTH_Intern(graph, title);
+    if (func < 0)
+    {
+      return STACK_DEPTH_FULL;
+    }
+    /* "name\nfile:line:col\nN bytes (kind)" for a definition; a function
+       only referenced has no size and its location is the call site */
+    location = strstr(label, "\\n");
+    if ((location == NULL) || (strstr(label, " bytes (") == NULL))
+    {
+      return STACK_DEPTH_OK;
+    }
+    location += 2;
+    end = strstr(location, "\\n");
+    if (graph->DefCount >= STACK_DEPTH_FUNCS_MAX)
+    {
+      return STACK_DEPTH_FULL;
+    }
+    site = &graph->Defs[graph->DefCount];
+    if ((end == NULL) ||
+        (STACK_DEPTH_Copy(site->Location, location, (uint32_t)(end - location), sizeof(site->Location)) == 0U))
+    {
+      return STACK_DEPTH_SYNTAX;
+    }
+    site->Value = (uint32_t)func;
+    graph->DefCount++;
+    return STACK_DEPTH_OK;
+  }
+
+  if (strncmp(line, "edge:", 5) == 0)
+  {
+    if ((STACK_DEPTH_Field(line, "sourcename", title, sizeof(title)) == 0U) ||
+        (STACK_DEPTH_Field(line, "targetname", target, sizeof(target)) == 0U))
+    {
+      return STACK_DEPTH_SYNTAX;
+    }
+    func = STACK_DEPTH_Intern(graph, title);
+    if (func < 0)
+    {
+      return STACK_DEPTH_FULL;
+    }
+    if (strcmp(target, STACK_DEPTH_INDIRECT_TITLE) == 0)
+    {
+      graph->Funcs[func].Flags |= STACK_DEPTH_INDIRECT;
+      return STACK_DEPTH_OK;
+    }
+    callee = STACK_DEPTH_Intern(graph, target);
+    if (callee < 0)
+    {
+      return STACK_DEPTH_FULL;
+    }
+    return STACK_DEPTH_AddCall(graph, (uint32_t)func, (uint32_t)callee);
+  }
+  return STACK_DEPTH_IGNORED;
+}
+
+/**
+  * @brief  Add one line of the linked image's disassembly: a function label
+  *         "08000188 <memcpy>:" or an instruction " 8000188:\tpush\t{r4, lr}";
+  *         anything else is ignored.
+  * @note   The frame is every push and sp subtraction in the function added
+  *         up, an upper bound when its paths save different registers.
+  * @param  graph: Graph
+  * @param  line: Line of "objdump -d --no-show-raw-insn" output
+  * @retval STACK_DEPTH_OK, STACK_DEPTH_IGNORED, or why it was not added
+  */
+STACK_DEPTH_StatusTypeDef STACK_DEPTH_ParseImage(STACK_DEPTH_GraphTypeDef *graph, const char *line)
+{
+  STACK_DEPTH_ImageTypeDef *func;
+  const char *operands;
+  const char *target;
+  char mnemonic[16];
+  uint32_t address;
+  size_t len;
+  char *end;
+
+  address = (uint32_t)strtoul(line, &end, 16);
+  if ((end != line) && (line[0] != ' ') && (strncmp(end, " <", 2) == 0))
+  {
+    target = strstr(end, ">:");
+    if (target == NULL)
+    {
+      return STACK_DEPTH_SYNTAX;
+    }
+    if (graph->ImageCount >= STACK_DEPTH_FUNCS_MAX)
+    {
+      return STACK_DEPTH_FULL;
+    }
+    func = &graph->Image[graph->ImageCount];
+    memset(func, 0, sizeof(*func));
+    if (STACK_DEPTH_Copy(func->Name, end + 2, (uint32_t)(target - end - 2), sizeof(func->Name)) == 0U)
+    {
+      return STACK_DEPTH_SYNTAX;
+    }
+    func->Address = address;
+    func->FirstCall = graph->ImageCallCount;
+    graph->ImageCount++;
+    return STACK_DEPTH_OK;
+  }
+  if ((line[0] != ' ') || (end == line) || (*end != ':') || (graph->ImageCount == 0U))
+  {
+    return STACK_DEPTH_IGNORED;
+  }
+  func = &graph->Image[graph->ImageCount - 1U];
+  end += strspn(end + 1, " \t") + 1U;
+  len = strcspn(end, " \t\r\n");
+  if ((len == 0U) || (len >= sizeof(mnemonic)))
+  {
+    return STACK_DEPTH_IGNORED;
+  }
+  memcpy(mnemonic, end, len);
+  mnemonic[len] = '\0';
+  operands = end + len + strspn(end + len, " \t");
+
+  if ((strcmp(mnemonic, "push") == 0) || (strcmp(mnemonic, "push.w") == 0) ||
+      (strcmp(mnemonic, "vpush") == 0) ||
+      (((strncmp(mnemonic, "stmdb", 5) == 0) || (strncmp(mnemonic, "vstmdb", 6) == 0)) &&
+       (strncmp(operands, "sp!,", 4) == 0)))
+  {
+    func->Size += STACK_DEPTH_PushBytes(operands);
+  }
+  else if (((strcmp(mnemonic, "sub") == 0) || (strcmp(mnemonic, "sub.w") == 0) ||
+            (strcmp(mnemonic, "subw") == 0)) && (strncmp(operands, "sp, ", 4) == 0))
+  {
+    operands += (strncmp(operands, "sp, sp, ", 8) == 0) ? 8 : 4;
+    if (operands[0] == '#')
+    {
+      func->Size += (uint32_t)strtoul(operands + 1, NULL, 0);
+    }
+    else
+    {
+      func->Flags |= STACK_DEPTH_DYNAMIC;
+    }
+  }
+  else if ((strncmp(mnemonic, "str", 3) == 0) && (strstr(operands, "[sp, #-") != NULL) &&
+           (strchr(operands, '!') != NULL))
+  {
+    func->Size += (uint32_t)strtoul(strstr(operands, "[sp, #-") + 7, NULL, 0);
+  }
+  else if ((mnemonic[0] == 'b') && (strchr(operands, '<') != NULL))
+  {
+    /* bl, blx and b to another function's start: a call or a tail call.
+       Branches inside a function name it with an offset. */
+    target = strchr(operands, '<');
+    address = (uint32_t)strtoul(operands, &end, 16);
+    if ((end != operands) && (strcspn(target, "+>") == strcspn(target, ">")) &&
+        (address != func->Address))
+    {
+      if (graph->ImageCallCount >= STACK_DEPTH_CALLS_MAX)
+      {
+        return STACK_DEPTH_FULL;
+      }
+      graph->ImageCalls[graph->ImageCallCount++] = address;
+      func->CallCount++;
+    }
+  }
+  else if (((strcmp(mnemonic, "blx") == 0) || (strcmp(mnemonic, "bx") == 0)) &&
+           (strncmp(operands, "lr", 2) != 0))
+  {
+    func->Flags |= STACK_DEPTH_INDIRECT;
+  }
+  return STACK_DEPTH_OK;
+}
+
+/**
+  * @brief  Add one configuration line (see stack_depth.h); "#" starts a
+  *         comment.
+  * @param  graph: Graph
+  * @param  line: Line
+  * @retval STACK_DEPTH_OK, STACK_DEPTH_IGNORED for a blank line, or why it
+  *         was not added; a thread or isr needs its stack declared first
+  */
+STACK_DEPTH_StatusTypeDef STACK_DEPTH_ParseConfig(STACK_DEPTH_GraphTypeDef *graph, const char *line)
+{
+  char buffer[3U * STACK_DEPTH_NAME_MAX];
+  char *word[STACK_DEPTH_WORDS_MAX];
+  uint32_t count = 0U;
+  uint32_t value = 0U;
+  uint32_t i;
+  STACK_DEPTH_StackTypeDef *stack;
+  STACK_DEPTH_EntryTypeDef *entry;
+  STACK_DEPTH_LinkTypeDef *link;
+  int32_t index;
+  char *p;
+
+  if (STACK_DEPTH_Copy(buffer, line, (uint32_t)strcspn(line, "#\r\n"), sizeof(buffer)) == 0U)
+  {
+    return STACK_DEPTH_SYNTAX;
+  }
+  for (p = strtok(buffer, " \t"); p != NULL; p = strtok(NULL, " \t"))
+  {
+    if (count >= STACK_DEPTH_WORDS_MAX)
+    {
+      return STACK_DEPTH_SYNTAX;
+    }
+    word[count++] = p;
+  }
+  if (count == 0U)
+  {
+    return STACK_DEPTH_IGNORED;
+  }
+
+  if ((strcmp(word[0], "frame") == 0) && (count == 2U))
+  {
+    return (STACK_DEPTH_Number(word[1], &graph->Frame) != 0U) ? STACK_DEPTH_OK : STACK_DEPTH_SYNTAX;
+  }
+  if ((strcmp(word[0], "stack") == 0) && ((count == 3U) || (count == 4U)))
+  {
+    if (graph->StackCount >= STACK_DEPTH_STACKS_MAX)
+    {
+      return STACK_DEPTH_FULL;
+    }
+    stack = &graph->Stacks[graph->StackCount];
+    memset(stack, 0, sizeof(*stack));
+    if ((STACK_DEPTH_Copy(stack->Name, word[1], (uint32_t)strlen(word[1]), sizeof(stack->Name)) == 0U) ||
+        (STACK_DEPTH_Number(word[2], &stack->Budget) == 0U) ||
+        ((count == 4U) && (STACK_DEPTH_Number(word[3], &stack->Reserve) == 0U)))
+    {
+      return STACK_DEPTH_SYNTAX;
+    }
+    graph->StackCount++;
+    return STACK_DEPTH_OK;
+  }
+  if (((strcmp(word[0], "thread") == 0) && (count == 3U)) ||
+      ((strcmp(word[0], "isr") == 0) && (count == 4U)))
+  {
+    if (graph->EntryCount >= STACK_DEPTH_ENTRIES_MAX)
+    {
+      return STACK_DEPTH_FULL;
+    }
+    index = STACK_DEPTH_StackIndex(graph, word[1]);
+    if (index < 0)
+    {
+      return STACK_DEPTH_NOT_FOUND;
+    }
+    entry = &graph->Entries[graph->EntryCount];
+    memset(entry, 0, sizeof(*entry));
+    entry->Stack = (uint32_t)index;
+    entry->Func  = -1;
+    if (STACK_DEPTH_Copy(entry->Function, word[2], (uint32_t)strlen(word[2]), sizeof(entry->Function)) == 0U)
+    {
+      return STACK_DEPTH_SYNTAX;
+    }
+    if (count == 4U)
+    {
+      /* Signed: NMI is -2 */
+      entry->Isr = 1U;
+      entry->Priority = (int32_t)strtol(word[3], &p, 0);
+      if ((p == word[3]) || (*p != '\0'))
+      {
+        return STACK_DEPTH_SYNTAX;
+      }
+    }
+    graph->EntryCount++;
+    return STACK_DEPTH_OK;
+  }
+  if ((strcmp(word[0], "extern") == 0) && (count == 3U))
+  {
+    if (graph->LinkCount >= STACK_DEPTH_LINKS_MAX)
+    {
+      return STACK_DEPTH_FULL;
+    }
+    link = &graph->Links[graph->LinkCount];
+    memset(link, 0, sizeof(*link));
+    if ((STACK_DEPTH_Copy(link->Caller, word[1], (uint32_t)strlen(word[1]), sizeof(link->Caller)) == 0U) ||
+        (STACK_DEPTH_Number(word[2], &value) == 0U))
+    {
+      return STACK_DEPTH_SYNTAX;
+    }
+    link->Size = value;
+    graph->LinkCount++;
+    return STACK_DEPTH_OK;
+  }
+  if ((strcmp(word[0], "call") == 0) && (count >= 3U))
+  {
+    /* One link per callee */
+    if (graph->LinkCount + (count - 2U) > STACK_DEPTH_LINKS_MAX)
+    {
+      return STACK_DEPTH_FULL;
+    }
+    for (i = 2U; i < count; i++)
+    {
+      link = &graph->Links[graph->LinkCount];
+      memset(link, 0, sizeof(*link));
+      if ((STACK_DEPTH_Copy(link->Caller, word[1], (uint32_t)strlen(word[1]), sizeof(link->Caller)) == 0U) ||
+          (STACK_DEPTH_Copy(link->Callee, word[i], (uint32_t)strlen(word[i]), sizeof(link->Callee)) == 0U))
+      {
+        return STACK_DEPTH_SYNTAX;
+      }
+      graph->LinkCount++;
+    }
+    return STACK_DEPTH_OK;
+  }
+  return STACK_DEPTH_SYNTAX;
+}
+
+/**
+  * @brief  Join sizes to functions and apply the configuration once every
+  *         file has been parsed.
+  * @param  graph: Graph
+  * @param  missing: Receives the name a STACK_DEPTH_NOT_FOUND is about
+  * @param  size: Size of missing
+  * @retval STACK_DEPTH_OK, STACK_DEPTH_NOT_FOUND if the configuration names
+  *         a function the graph does not have, STACK_DEPTH_FULL
+  */
+STACK_DEPTH_StatusTypeDef STACK_DEPTH_Resolve(STACK_DEPTH_GraphTypeDef *graph, char *missing, uint32_t size)
+{
+  STACK_DEPTH_FuncTypeDef *func;
+  STACK_DEPTH_LinkTypeDef *link;
+  const STACK_DEPTH_SiteTypeDef *usage;
+  STACK_DEPTH_StatusTypeDef status;
+  const char *name = NULL;
+  int32_t caller;
+  int32_t callee;
+  size_t len;
+  uint32_t kept;
+  uint32_t i;
+
+  /* Definitions take their size from the .su line at the same place; a
+     title defined in more than one object takes the larger */
+  qsort(graph->Usage, graph->UsageCount, sizeof(graph->Usage[0]), STACK_DEPTH_CompareSite);
+  for (i = 0U; i < graph->DefCount; i++)
+  {
+    usage = bsearch(&graph->Defs[i], graph->Usage, graph->UsageCount, sizeof(graph->Usage[0]),
+                    STACK_DEPTH_CompareSite);
+    func = &graph->Funcs[graph->Defs[i].Value];
+    if (usage != NULL)
+    {
+      func->Flags |= (usage->Dynamic != 0U) ? (STACK_DEPTH_DEFINED | STACK_DEPTH_DYNAMIC) : STACK_DEPTH_DEFINED;
+      func->Size = (usage->Value > func->Size) ? usage->Value : func->Size;
+    }
+  }
+
+  /* A weak definition is titled like a file-local one. Callers elsewhere
+     reach it through its plain name; calls in its own file go to it even
+     when an override exists, so it also calls the override. Should it be a
+     genuine file-local namesake instead, this only overestimates. */
+  for (i = 0U; i < graph->FuncCount; i++)
+  {
+    func = &graph->Funcs[i];
+    caller = STACK_DEPTH_Lookup(graph, STACK_DEPTH_ShortName(func->Name));
+    if ((caller < 0) || ((uint32_t)caller == i) || ((func->Flags & STACK_DEPTH_DEFINED) == 0U))
+    {
+      continue;
+    }
+    if ((graph->Funcs[caller].Flags & STACK_DEPTH_DEFINED) != 0U)
+    {
+      status = STACK_DEPTH_AddCall(graph, i, (uint32_t)caller);
+    }
+    else
+    {
+      graph->Funcs[caller].Flags |= STACK_DEPTH_DEFINED;
+      status = STACK_DEPTH_AddCall(graph, (uint32_t)caller, i);
+    }
+    if (status != STACK_DEPTH_OK)
+    {
+      return status;
+    }
+  }
+
+  status = STACK_DEPTH_ApplyImage(graph);
+  if (status != STACK_DEPTH_OK)
+  {
+    return status;
+  }
+
+  for (i = 0U; (i < graph->LinkCount) && (name == NULL); i++)
+  {
+    link = &graph->Links[i];
+    len = strlen(link->Caller);
+    if ((link->Callee[0] != '\0') && (len > 1U) && (link->Caller[len - 1U] == '*'))
+    {
+      status = STACK_DEPTH_LinkPrefix(graph, link, (uint32_t)(len - 1U), &name);
+      if (status != STACK_DEPTH_OK)
+      {
+        return status;
+      }
+      continue;
+    }
+    caller = STACK_DEPTH_Find(graph, link->Caller);
+    if (link->Callee[0] == '\0')
+    {
+      /* A library function the build does not call is not an error */
+      if (caller >= 0)
+      {
+        graph->Funcs[caller].Size = link->Size;
+        graph->Funcs[caller].Flags |= STACK_DEPTH_DEFINED;
+      }
+      continue;
+    }
+    callee = STACK_DEPTH_Find(graph, link->Callee);
+    if (caller < 0)
+    {
+      name = link->Caller;
+    }
+    else if (callee < 0)
+    {
+      name = link->Callee;
+    }
+    else
+    {
+      status = STACK_DEPTH_AddCall(graph, (uint32_t)caller, (uint32_t)callee);
+      if (status != STACK_DEPTH_OK)
+      {
+        return status;
+      }
+      graph->Funcs[caller].Flags |= STACK_DEPTH_RESOLVED;
+    }
+  }
+  for (i = 0U; (i < graph->EntryCount) && (name == NULL); i++)
+  {
+    graph->Entries[i].Func = STACK_DEPTH_Find(graph, graph->Entries[i].Function);
+    if (graph->Entries[i].Func < 0)
+    {
+      name = graph->Entries[i].Function;
+    }
+  }
+  if (name != NULL)
+  {
+    (void)snprintf(missing, size, "%s", name);
+    return STACK_DEPTH_NOT_FOUND;
+  }
+
+  /* Calls grouped by caller, each call site pair once */
+  qsort(graph->Calls, graph->CallCount, sizeof(graph->Calls[0]), STACK_DEPTH_CompareCall);
+  kept = 0U;
+  for (i = 0U; i < graph->CallCount; i++)
+  {
+    if ((kept == 0U) || (STACK_DEPTH_CompareCall(&graph->Calls[i], &graph->Calls[kept - 1U]) != 0))
+    {
+      graph->Calls[kept++] = graph->Calls[i];
+    }
+  }
+  graph->CallCount = kept;
+  for (i = 0U; i < graph->FuncCount; i++)
+  {
+    graph->Funcs[i].CallCount = 0U;
+  }
+  for (i = graph->CallCount; i > 0U; i--)
+  {
+    func = &graph->Funcs[graph->Calls[i - 1U].Caller];
+    func->FirstCall = i - 1U;
+    func->CallCount++;
+  }
+  return STACK_DEPTH_OK;
+}
+
+/**
+  * @brief  Worst-case depth of every entry and stack, and the report lines.
+  * @param  graph: Resolved graph
+  * @retval Number of stacks over budget
+  */
+uint32_t STACK_DEPTH_Analyse(STACK_DEPTH_GraphTypeDef *graph)
+{
+  const STACK_DEPTH_EntryTypeDef *entry;
+  const STACK_DEPTH_FuncTypeDef *func;
+  STACK_DEPTH_StackTypeDef *stack;
+  uint32_t over = 0U;
+  uint32_t thread;
+  uint32_t level;
+  uint32_t s;
+  uint32_t i;
+  uint32_t j;
+  uint8_t handlers;
+  uint8_t seen;
+
+  for (i = 0U; i < graph->FuncCount; i++)
+  {
+    graph->Funcs[i].Visit = STACK_DEPTH_NEW;
+    graph->Funcs[i].Reached = 0U;
+  }
+  for (i = 0U; i < graph->EntryCount; i++)
+  {
+    STACK_DEPTH_Walk(graph, (uint32_t)graph->Entries[i].Func);
+  }
+
+  graph->LineCount = 0U;
+  for (s = 0U; s < graph->StackCount; s++)
+  {
+    stack = &graph->Stacks[s];
+    stack->Flags = 0U;
+    stack->Levels = 0U;
+    thread = 0U;
+    handlers = 0U;
+    stack->Depth = stack->Reserve;
+    graph->Lines[graph->LineCount].Kind = STACK_DEPTH_LINE_STACK;
+    graph->Lines[graph->LineCount++].Index = s;
+
+    for (i = 0U; i < graph->EntryCount; i++)
+    {
+      entry = &graph->Entries[i];
+      if (entry->Stack != s)
+      {
+        continue;
+      }
+      func = &graph->Funcs[entry->Func];
+      stack->Flags |= func->PathFlags;
+      graph->Lines[graph->LineCount].Kind = STACK_DEPTH_LINE_ENTRY;
+      graph->Lines[graph->LineCount++].Index = i;
+      if (entry->Isr == 0U)
+      {
+        thread = (func->Depth > thread) ? func->Depth : thread;
+        continue;
+      }
+      handlers = 1U;
+
+      /* Once per priority level, at its first handler: the deepest one */
+      seen = 0U;
+      for (j = 0U; j < i; j++)
+      {
+        if ((graph->Entries[j].Stack == s) && (graph->Entries[j].Isr != 0U) &&
+            (graph->Entries[j].Priority == entry->Priority))
+        {
+          seen = 1U;
+        }
+      }
+      if (seen != 0U)
+      {
+        continue;
+      }
+      level = 0U;
+      for (j = i; j < graph->EntryCount; j++)
+      {
+        if ((graph->Entries[j].Stack == s) && (graph->Entries[j].Isr != 0U) &&
+            (graph->Entries[j].Priority == entry->Priority) &&
+            (graph->Funcs[graph->Entries[j].Func].Depth > level))
+        {
+          level = graph->Funcs[graph->Entries[j].Func].Depth;
+        }
+      }
+      stack->Depth += level + graph->Frame;
+      stack->Levels++;
+    }
+    /* A thread stack without handlers still takes the frame of the
+       interrupt that preempts it */
+    stack->Depth += thread + (((handlers == 0U) && (thread != 0U)) ? graph->Frame : 0U);
+    if (stack->Depth > stack->Budget)
+    {
+      over++;
+    }
+  }
+
+  for (i = 0U; i < graph->FuncCount; i++)
+  {
+    if ((graph->Funcs[i].Reached != 0U) && (STACK_DEPTH_Problems(&graph->Funcs[i]) != 0U))
+    {
+      graph->Lines[graph->LineCount].Kind = STACK_DEPTH_LINE_FUNC;
+      graph->Lines[graph->LineCount++].Index = i;
+    }
+  }
+  return over;
+}
+
+/**
+  * @brief  Function by graph title or, for a file-local function, by its
+  *         name alone when only one file defines it.
+  * @param  graph: Graph
+  * @param  name: Name
+  * @retval Funcs[] index, -1 if absent or ambiguous
+  */
+int32_t STACK_DEPTH_Find(const STACK_DEPTH_GraphTypeDef *graph, const char *name)
+{
+  int32_t found = STACK_DEPTH_Lookup(graph, name);
+  size_t len = strlen(name);
+  size_t title;
+  uint32_t i;
+
+  if (found >= 0)
+  {
+    return found;
+  }
+  for (i = 0U; i < graph->FuncCount; i++)
+  {
+    title = strlen(graph->Funcs[i].Name);
+    if ((title > len) && (graph->Funcs[i].Name[title - len - 1U] == ':') &&
+        (strcmp(&graph->Funcs[i].Name[title - len], name) == 0))
+    {
+      if (found >= 0)
+      {
+        return -1;
+      }
+      found = (int32_t)i;
+    }
+  }
+  return found;
+}
+
+/**
+  * @brief  One line of the report, without line terminator.
+  * @param  graph: Analysed graph
+  * @param  line: Line number, from 0
+  * @param  out: Output buffer, STACK_DEPTH_LINE_MAX bytes; long paths are
+  *         cut short
+  * @param  size: Size of out
+  * @retval Number of characters written, 0 past the last line
+  */
+uint32_t STACK_DEPTH_FormatLine(const STACK_DEPTH_GraphTypeDef *graph, uint32_t line, char *out, uint32_t size)
+{
+  static const char *const problems[] = { "dynamic stack", "indirect call", "recursion", "unknown size" };
+  const STACK_DEPTH_StackTypeDef *stack;
+  const STACK_DEPTH_EntryTypeDef *entry;
+  const STACK_DEPTH_FuncTypeDef *func;
+  uint32_t len;
+  uint32_t i;
+  uint8_t flags;
+  int32_t next;
+
+  if ((line >= graph->LineCount) || (size == 0U))
+  {
+    if (size != 0U)
+    {
+      out[0] = '\0';
+    }
+    return 0U;
+  }
+  switch (graph->Lines[line].Kind)
+  {
+    case STACK_DEPTH_LINE_STACK:
+      stack = &graph->Stacks[graph->Lines[line].Index];
+      len = STACK_DEPTH_Length(snprintf(out, size, "%s: %lu of %lu bytes, ", stack->Name,
+                                        (unsigned long)stack->Depth, (unsigned long)stack->Budget), size);
+      if (stack->Depth > stack->Budget)
+      {
+        len += STACK_DEPTH_Length(snprintf(out + len, size - len, "OVER by %lu",
+                                           (unsigned long)(stack->Depth - stack->Budget)), size - len);
+      }
+      else
+      {
+        len += STACK_DEPTH_Length(snprintf(out + len, size - len, "%lu spare",
+                                           (unsigned long)(stack->Budget - stack->Depth)), size - len);
+      }
+      if (stack->Levels != 0U)
+      {
+        len += STACK_DEPTH_Length(snprintf(out + len, size - len, ", %lu interrupt levels",
+                                           (unsigned long)stack->Levels), size - len);
+      }
+      if ((stack->Flags & STACK_DEPTH_PROBLEMS) != 0U)
+      {
+        len += STACK_DEPTH_Length(snprintf(out + len, size - len, ", at least"), size - len);
+      }
+      return len;
+
+    case STACK_DEPTH_LINE_ENTRY:
+      entry = &graph->Entries[graph->Lines[line].Index];
+      func = &graph->Funcs[entry->Func];
+      if (entry->Isr != 0U)
+      {
+        len = STACK_DEPTH_Length(snprintf(out, size, "  isr %ld %s %lu:", (long)entry->Priority,
+                                          STACK_DEPTH_ShortName(func->Name), (unsigned long)func->Depth), size);
+      }
+      else
+      {
+        len = STACK_DEPTH_Length(snprintf(out, size, "  %s %lu:", STACK_DEPTH_ShortName(func->Name),
+                                          (unsigned long)func->Depth), size);
+      }
+      for (next = entry->Func, i = 0U; (next >= 0) && (i < graph->FuncCount); i++)
+      {
+        func = &graph->Funcs[next];
+        len += STACK_DEPTH_Length(snprintf(out + len, size - len, "%s%s%s", (i == 0U) ? " " : " > ",
+                                           STACK_DEPTH_ShortName(func->Name),
+                                           ((func->Flags & STACK_DEPTH_DEFINED) != 0U) ? "" : "?"),
+                                  size - len);
+        next = func->Next;
+      }
+      return len;
+
+    default:
+      func = &graph->Funcs[graph->Lines[line].Index];
+      flags = STACK_DEPTH_Problems(func);
+      next = 0;
+      len = STACK_DEPTH_Length(snprintf(out, size, "warning: %s:", STACK_DEPTH_ShortName(func->Name)), size);
+      for (i = 0U; i < 4U; i++)
+      {
+        if ((flags & (STACK_DEPTH_DYNAMIC << i)) != 0U)
+        {
+          len += STACK_DEPTH_Length(snprintf(out + len, size - len, "%s %s", (next != 0) ? "," : "",
+                                             problems[i]), size - len);
+          next = 1;
+        }
+      }
+      return len;
+  }
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Depth of a function and its callees, memoised. A callee already
+  *         on the path is recursion: flagged, and its edge not followed.
+  * @param  graph: Graph
+  * @param  index: Funcs[] index
+  * @retval None
+  */
+static void STACK_DEPTH_Walk(STACK_DEPTH_GraphTypeDef *graph, uint32_t index)
+{
+  STACK_DEPTH_FuncTypeDef *func = &graph->Funcs[index];
+  STACK_DEPTH_FuncTypeDef *callee;
+  uint32_t best = 0U;
+  uint32_t i;
+
+  if (func->Visit != STACK_DEPTH_NEW)
+  {
+    return;
+  }
+  func->Visit = STACK_DEPTH_ON_PATH;
+  func->Reached = 1U;
+  func->Next = -1;
+  if ((func->Flags & STACK_DEPTH_DEFINED) == 0U)
+  {
+    func->Flags |= STACK_DEPTH_UNKNOWN;
+  }
+  for (i = func->FirstCall; i < func->FirstCall + func->CallCount; i++)
+  {
+    callee = &graph->Funcs[graph->Calls[i].Callee];
+    if (callee->Visit == STACK_DEPTH_ON_PATH)
+    {
+      func->Flags |= STACK_DEPTH_RECURSION;
+      continue;
+    }
+    STACK_DEPTH_Walk(graph, graph->Calls[i].Callee);
+    func->PathFlags |= callee->PathFlags;
+    if ((callee->Depth > best) || (func->Next < 0))
+    {
+      best = callee->Depth;
+      func->Next = (int32_t)graph->Calls[i].Callee;
+    }
+  }
+  func->PathFlags |= STACK_DEPTH_Problems(func);
+  func->Depth = func->Size + best;
+  func->Visit = STACK_DEPTH_DONE;
+}
+
+/**
+  * @brief  Apply a config call from "prefix*": to every function with
+  *         indirect calls whose name starts with the prefix.
+  * @param  graph: Graph
+  * @param  link: Link
+  * @param  len: Prefix length
+  * @param  missing: Set to the callee name if it does not exist
+  * @retval STACK_DEPTH_OK, STACK_DEPTH_FULL
+  */
+static STACK_DEPTH_StatusTypeDef STACK_DEPTH_LinkPrefix(STACK_DEPTH_GraphTypeDef *graph,
+                                                        const STACK_DEPTH_LinkTypeDef *link, uint32_t len,
+                                                        const char **missing)
+{
+  int32_t callee = STACK_DEPTH_Find(graph, link->Callee);
+  uint32_t i;
+
+  if (callee < 0)
+  {
+    *missing = link->Callee;
+    return STACK_DEPTH_OK;
+  }
+  for (i = 0U; i < graph->FuncCount; i++)
+  {
+    if (((graph->Funcs[i].Flags & STACK_DEPTH_INDIRECT) != 0U) &&
+        (strncmp(STACK_DEPTH_ShortName(graph->Funcs[i].Name), link->Caller, len) == 0))
+    {
+      if (STACK_DEPTH_AddCall(graph, i, (uint32_t)callee) != STACK_DEPTH_OK)
+      {
+        return STACK_DEPTH_FULL;
+      }
+      graph->Funcs[i].Flags |= STACK_DEPTH_RESOLVED;
+    }
+  }
+  return STACK_DEPTH_OK;
+}
+
+/**
+  * @brief  Problems of a function itself; an indirect call the configuration
+  *         gives the targets of is not one.
+  * @param  func: Function
+  * @retval STACK_DEPTH_PROBLEMS bits
+  */
+static uint8_t STACK_DEPTH_Problems(const STACK_DEPTH_FuncTypeDef *func)
+{
+  uint8_t flags = func->Flags & STACK_DEPTH_PROBLEMS;
+
+  if ((func->Flags & STACK_DEPTH_RESOLVED) != 0U)
+  {
+    flags &= (uint8_t)~STACK_DEPTH_INDIRECT;
+  }
+  return flags;
+}
+
+/**
+  * @brief  Give the functions still without a size (C library, libgcc,
+  *         assembly) their frame and calls from the linked image. The
+  *         callees join the graph and get the same until nothing changes.
+  *         Functions with an extern line are left to it.
+  * @retval STACK_DEPTH_OK, STACK_DEPTH_FULL
+  */
+static STACK_DEPTH_StatusTypeDef STACK_DEPTH_ApplyImage(STACK_DEPTH_GraphTypeDef *graph)
+{
+  STACK_DEPTH_ImageTypeDef *image;
+  STACK_DEPTH_ImageTypeDef key;
+  const STACK_DEPTH_ImageTypeDef *target;
+  STACK_DEPTH_FuncTypeDef *func;
+  STACK_DEPTH_StatusTypeDef status;
+  uint8_t added;
+  int32_t index;
+  int32_t callee;
+  uint32_t i;
+  uint32_t j;
+
+  qsort(graph->Image, graph->ImageCount, sizeof(graph->Image[0]), STACK_DEPTH_CompareImage);
+  do
+  {
+    added = 0U;
+    for (i = 0U; i < graph->ImageCount; i++)
+    {
+      image = &graph->Image[i];
+      index = (image->Used == 0U) ? STACK_DEPTH_Lookup(graph, image->Name) : -1;
+      if (index < 0)
+      {
+        continue;
+      }
+      image->Used = 1U;
+      func = &graph->Funcs[index];
+      if (((func->Flags & STACK_DEPTH_DEFINED) != 0U) || (STACK_DEPTH_IsExtern(graph, image->Name) != 0U))
+      {
+        continue;
+      }
+      func->Size = image->Size;
+      func->Flags |= STACK_DEPTH_DEFINED | image->Flags;
+      for (j = image->FirstCall; j < image->FirstCall + image->CallCount; j++)
+      {
+        key.Address = graph->ImageCalls[j];
+        target = bsearch(&key, graph->Image, graph->ImageCount, sizeof(graph->Image[0]),
+                         STACK_DEPTH_CompareImage);
+        if (target == NULL)
+        {
+          continue;
+        }
+        callee = STACK_DEPTH_Intern(graph, target->Name);
+        if (callee < 0)
+        {
+          return STACK_DEPTH_FULL;
+        }
+        status = STACK_DEPTH_AddCall(graph, (uint32_t)index, (uint32_t)callee);
+        if (status != STACK_DEPTH_OK)
+        {
+          return status;
+        }
+        added = 1U;
+      }
+    }
+  } while (added != 0U);
+  return STACK_DEPTH_OK;
+}
+
+/**
+  * @brief  Whether the configuration sizes a function with an extern line.
+  * @retval 1 if it does
+  */
+static uint8_t STACK_DEPTH_IsExtern(const STACK_DEPTH_GraphTypeDef *graph, const char *name)
+{
+  uint32_t i;
+
+  for (i = 0U; i < graph->LinkCount; i++)
+  {
+    if ((graph->Links[i].Callee[0] == '\0') && (strcmp(graph->Links[i].Caller, name) == 0))
+    {
+      return 1U;
+    }
+  }
+  return 0U;
+}
+
+/**
+  * @brief  Stack taken by a push list, "{r4-r7, lr}" or "sp!, {d8-d15}".
+  * @param  list: Operands
+  * @retval Bytes
+  */
+static uint32_t STACK_DEPTH_PushBytes(const char *list)
+{
+  const char *item = strchr(list, '{');
+  uint32_t bytes = 0U;
+  uint32_t count;
+  uint32_t first;
+  uint32_t last;
+  char *end;
+
+  while ((item != NULL) && (*item != '}') && (*item != '\0'))
+  {
+    item += strspn(item + 1, " ") + 1U;
+    if ((*item == '}') || (*item == '\0'))
+    {
+      break;
+    }
+    first = (uint32_t)strtoul(item + 1, &end, 10);
+    if ((end != item + 1) && (*end == '-'))
+    {
+      last = (uint32_t)strtoul(end + 2, NULL, 10);
+      count = (last >= first) ? (last - first + 1U) : 1U;
+    }
+    else
+    {
+      count = 1U;
+    }
+    bytes += count * ((*item == 'd') ? 8U : 4U);
+    item += strcspn(item, ",}");
+  }
+  return bytes;
+}
+
+/**
+  * @brief  Add a call.
+  * @retval STACK_DEPTH_OK, STACK_DEPTH_FULL
+  */
+static STACK_DEPTH_StatusTypeDef STACK_DEPTH_AddCall(STACK_DEPTH_GraphTypeDef *graph, uint32_t caller,
+                                                     uint32_t callee)
+{
+  if (graph->CallCount >= STACK_DEPTH_CALLS_MAX)
+  {
+    return STACK_DEPTH_FULL;
+  }
+  graph->Calls[graph->CallCount].Caller = caller;
+  graph->Calls[graph->CallCount].Callee = callee;
+  graph->CallCount++;
+  return STACK_DEPTH_OK;
+}
+
+/**
+  * @brief  FNV-1a of a name, reduced to a hash table slot.
+  * @retval Slot
+  */
+static uint32_t STACK_DEPTH_Hash(const char *name)
+{
+  uint32_t hash = 2166136261U;
+
+  while (*name != '\0')
+  {
+    hash ^= (uint8_t)*name++;
+    hash *= 16777619U;
+  }
+  return hash % STACK_DEPTH_HASH_SIZE;
+}
+
+/**
+  * @brief  Function by exact graph title.
+  * @retval Funcs[] index, -1 if absent
+  */
+static int32_t STACK_DEPTH_Lookup(const STACK_DEPTH_GraphTypeDef *graph, const char *name)
+{
+  uint32_t slot = STACK_DEPTH_Hash(name);
+
+  while (graph->Hash[slot] != 0U)
+  {
+    if (strcmp(graph->Funcs[graph->Hash[slot] - 1U].Name, name) == 0)
+    {
+      return (int32_t)(graph->Hash[slot] - 1U);
+    }
+    slot = (slot + 1U) % STACK_DEPTH_HASH_SIZE;
+  }
+  return -1;
+}
+
+/**
+  * @brief  Function by exact graph title, added if new.
+  * @retval Funcs[] index, -1 if the table is full or the name too long
+  */
+static int32_t STACK_DEPTH_Intern(STACK_DEPTH_GraphTypeDef *graph, const char *name)
+{
+  STACK_DEPTH_FuncTypeDef *func;
+  int32_t found = STACK_DEPTH_Lookup(graph, name);
+  uint32_t slot;
+
+  if (found >= 0)
+  {
+    return found;
+  }
+  if (graph->FuncCount >= STACK_DEPTH_FUNCS_MAX)
+  {
+    return -1;
+  }
+  func = &graph->Funcs[graph->FuncCount];
+  memset(func, 0, sizeof(*func));
+  func->Next = -1;
+  if (STACK_DEPTH_Copy(func->Name, name, (uint32_t)strlen(name), sizeof(func->Name)) == 0U)
+  {
+    return -1;
+  }
+  /* The table is twice the function limit: there is always a free slot */
+  slot = STACK_DEPTH_Hash(name);
+  while (graph->Hash[slot] != 0U)
+  {
+    slot = (slot + 1U) % STACK_DEPTH_HASH_SIZE;
+  }
+  graph->Hash[slot] = (uint16_t)(graph->FuncCount + 1U);
+  return (int32_t)graph->FuncCount++;
+}
+
+/**
+  * @brief  Quoted value of a VCG attribute: key: "value".
+  * @param  line: Node or edge line
+  * @param  key: Attribute name
+  * @param  out: Receives the value
+  * @param  size: Size of out
+  * @retval 1 if found and it fits
+  */
+static uint8_t STACK_DEPTH_Field(const char *line, const char *key, char *out, uint32_t size)
+{
+  size_t len = strlen(key);
+  const char *p = line;
+  const char *end;
+
+  while ((p = strstr(p, key)) != NULL)
+  {
+    /* Whole attribute names only: "title" is also the end of "subtitle" */
+    if (((p == line) || (p[-1] == ' ') || (p[-1] == '{')) && (strncmp(p + len, ": \"", 3) == 0))
+    {
+      p += len + 3U;
+      end = strchr(p, '"');
+      return (end != NULL) ? STACK_DEPTH_Copy(out, p, (uint32_t)(end - p), size) : 0U;
+    }
+    p += len;
+  }
+  return 0U;
+}
+
+/**
+  * @brief  Copy len characters and terminate.
+  * @retval 1 if they fit in size
+  */
+static uint8_t STACK_DEPTH_Copy(char *out, const char *in, uint32_t len, uint32_t size)
+{
+  if (len >= size)
+  {
+    return 0U;
+  }
+  memcpy(out, in, len);
+  out[len] = '\0';
+  return 1U;
+}
+
+/**
+  * @brief  Decimal or 0x hexadecimal number, nothing after it.
+  * @retval 1 if valid
+  */
+static uint8_t STACK_DEPTH_Number(const char *text, uint32_t *value)
+{
+  char *end;
+
+  *value = (uint32_t)strtoul(text, &end, 0);
+  return ((end != text) && (*end == '\0') && (text[0] != '-')) ? 1U : 0U;
+}
+
+/**
+  * @brief  Stack by name.
+  * @retval Stacks[] index, -1 if not declared
+  */
+static int32_t STACK_DEPTH_StackIndex(const STACK_DEPTH_GraphTypeDef *graph, const char *name)
+{
+  uint32_t i;
+
+  for (i = 0U; i < graph->StackCount; i++)
+  {
+    if (strcmp(graph->Stacks[i].Name, name) == 0)
+    {
+      return (int32_t)i;
+    }
+  }
+  return -1;
+}
+
+/**
+  * @brief  Function name without the file of a file-local one.
+  * @retval Name
+  */
+static const char *STACK_DEPTH_ShortName(const char *name)
+{
+  const char *colon = strrchr(name, ':');
+
+  return (colon != NULL) ? colon + 1 : name;
+}
+
+/**
+  * @brief  Characters actually stored by a possibly truncated snprintf().
+  * @param  n: snprintf() return value
+  * @param  size: Buffer size passed to it
+  * @retval Length
+  */
+static uint32_t STACK_DEPTH_Length(int n, uint32_t size)
+{
+  if ((n < 0) || (size == 0U))
+  {
+    return 0U;
+  }
+  return ((uint32_t)n < size) ? (uint32_t)n : (size - 1U);
+}
+
+/**
+  * @brief  qsort()/bsearch() order of sites, by location.
+  */
+static int STACK_DEPTH_CompareSite(const void *a, const void *b)
+{
+  return strcmp(((const STACK_DEPTH_SiteTypeDef *)a)->Location, ((const STACK_DEPTH_SiteTypeDef *)b)->Location);
+}
+
+/**
+  * @brief  qsort()/bsearch() order of image functions, by address.
+  */
+static int STACK_DEPTH_CompareImage(const void *a, const void *b)
+{
+  uint32_t x = ((const STACK_DEPTH_ImageTypeDef *)a)->Address;
+  uint32_t y = ((const STACK_DEPTH_ImageTypeDef *)b)->Address;
+
+  return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+/**
+  * @brief  qsort() order of calls, by caller then callee.
+  */
+static int STACK_DEPTH_CompareCall(const void *a, const void *b)
+{
+  const STACK_DEPTH_CallTypeDef *x = a;
+  const STACK_DEPTH_CallTypeDef *y = b;
+
+  if (x->Caller != y->Caller)
+  {
+    return (x->Caller < y->Caller) ? -1 : 1;
+  }
+  if (x->Callee != y->Callee)
+  {
+    return (x->Callee < y->Callee) ? -1 : 1;
+  }
+  return 0;
+}
@@ -0,0 +1,208 @@
+/**
+  ******************************************************************************
+  * @file    stack_depth.h
+  * @brief   Header for stack_depth.c file.
+  *          Worst-case stack depth from the compiler's stack usage and call
+  *          graph output, checked against a budget per stack.
+  ******************************************************************************
+  * GCC writes, next to each object file:
+  *   <obj>.su  with -fstack-usage: "file:line:col:name<TAB>bytes<TAB>kind"
+  *   <obj>.ci  with -fcallgraph-info=su: a VCG graph with a node per
+  *             function (defined ones carry their location) and an edge per
+  *             call site; file-local functions are titled "file:name"
+  * Defined functions are joined to their stack usage by location. Functions
+  * only ever referenced (libraries, assembly) take their frame and calls
+  * from the linked image, disassembled with "objdump -d --no-show-raw-insn":
+  * the pushes and stack pointer subtractions after the label, and each
+  * branch to another function's start.
+  *
+  * The configuration (tools/stack.cfg), one directive per line:
+  *   frame  <bytes>                   exception frame pushed per interrupt
+  *   stack  <name> <budget> [reserve] a stack; reserve is always in use
+  *   thread <stack> <function>        thread mode code starting there
+  *   isr    <stack> <function> <prio> a handler at a preemption priority
+  *   call   <caller> <callee>...      calls the graph cannot see (assembly,
+  *                                    function pointers); "prefix*" as the
+  *                                    caller stands for every function
+  *                                    with indirect calls named so
+  *   extern <function> <bytes>        stack of a function with no .su
+  *                                    entry, callees included; overrides
+  *                                    the disassembly
+  * Functions are named as in the graph; a file-local one may also be named
+  * without its file when that is unambiguous. GCC titles weak definitions
+  * like file-local ones; they are linked to their plain name.
+  *
+  * A stack needs its reserve, plus its deepest thread, plus one frame per
+  * priority level with a handler on it, each level adding its deepest
+  * handler: handlers at one level never preempt each other. Thread stacks
+  * without handlers get the one frame an interrupt pushes on them.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STACK_DEPTH_H
+#define __STACK_DEPTH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define STACK_DEPTH_NAME_MAX      128U
+#define STACK_DEPTH_FUNCS_MAX     4096U
+#define STACK_DEPTH_CALLS_MAX     16384U
+#define STACK_DEPTH_STACKS_MAX    16U
+#define STACK_DEPTH_ENTRIES_MAX   64U
+#define STACK_DEPTH_LINKS_MAX     128U       /*!< config callees and externs     */
+#define STACK_DEPTH_WORDS_MAX     16U        /*!< Words on a config line         */
+#define STACK_DEPTH_LINES_MAX     (STACK_DEPTH_STACKS_MAX + STACK_DEPTH_ENTRIES_MAX + STACK_DEPTH_FUNCS_MAX)
+#define STACK_DEPTH_LINE_MAX      160U       /*!< Report line buffer size        */
+#define STACK_DEPTH_FRAME_DEFAULT 104U       /*!< Cortex-M4F frame with FP state */
+
+/** Function flags; the problems are also collected over each call tree */
+#define STACK_DEPTH_DEFINED       0x01U      /*!< Size known: .su, image, extern */
+#define STACK_DEPTH_DYNAMIC       0x02U      /*!< alloca or VLA, unbounded       */
+#define STACK_DEPTH_INDIRECT      0x04U      /*!< Calls through a pointer        */
+#define STACK_DEPTH_RECURSION     0x08U      /*!< Calls back into its own path   */
+#define STACK_DEPTH_UNKNOWN       0x10U      /*!< No size from any source        */
+#define STACK_DEPTH_RESOLVED      0x20U      /*!< Pointer targets in the config  */
+#define STACK_DEPTH_PROBLEMS      (STACK_DEPTH_DYNAMIC | STACK_DEPTH_INDIRECT | \
+                                   STACK_DEPTH_RECURSION | STACK_DEPTH_UNKNOWN)
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  STACK_DEPTH_OK        = 0x00U,
+  STACK_DEPTH_IGNORED   = 0x01U,    /*!< Line carries nothing of interest    */
+  STACK_DEPTH_SYNTAX    = 0x02U,    /*!< Malformed line                      */
+  STACK_DEPTH_FULL      = 0x03U,    /*!< A table is full                     */
+  STACK_DEPTH_NOT_FOUND = 0x04U     /*!< Configuration names a missing item  */
+} STACK_DEPTH_StatusTypeDef;
+
+typedef struct
+{
+  char     Name[STACK_DEPTH_NAME_MAX];      /*!< Graph title                  */
+  uint32_t Size;                            /*!< Own frame in bytes           */
+  uint32_t FirstCall;                       /*!< Calls[], after Resolve       */
+  uint32_t CallCount;
+  uint8_t  Flags;                           /*!< STACK_DEPTH_xxx              */
+  uint8_t  Visit;                           /*!< Depth walk state             */
+  uint8_t  Reached;                         /*!< On some entry's call tree    */
+  uint8_t  PathFlags;                       /*!< Problems anywhere below it   */
+  uint32_t Depth;                           /*!< Itself plus its worst callee */
+  int32_t  Next;                            /*!< Worst callee, -1 for none    */
+} STACK_DEPTH_FuncTypeDef;
+
+typedef struct
+{
+  uint32_t Caller;
+  uint32_t Callee;
+} STACK_DEPTH_CallTypeDef;
+
+/**
+  * @brief  A .su line, or a function definition seen in a .ci file: the two
+  *         are joined by Location
+  */
+typedef struct
+{
+  char     Location[STACK_DEPTH_NAME_MAX];  /*!< file:line:col               */
+  uint32_t Value;                           /*!< Bytes, or Funcs[] index      */
+  uint8_t  Dynamic;
+} STACK_DEPTH_SiteTypeDef;
+
+/**
+  * @brief  A config "call" (Size unused) or "extern" (Callee empty) line
+  */
+typedef struct
+{
+  char     Caller[STACK_DEPTH_NAME_MAX];
+  char     Callee[STACK_DEPTH_NAME_MAX];
+  uint32_t Size;
+} STACK_DEPTH_LinkTypeDef;
+
+/**
+  * @brief  A function of the linked image; its calls are ImageCalls[]
+  *         FirstCall on, by target address
+  */
+typedef struct
+{
+  char     Name[STACK_DEPTH_NAME_MAX];      /*!< Symbol                       */
+  uint32_t Address;
+  uint32_t Size;                            /*!< Pushes and sp subtractions   */
+  uint32_t FirstCall;
+  uint32_t CallCount;
+  uint8_t  Flags;                           /*!< DYNAMIC, INDIRECT            */
+  uint8_t  Used;                            /*!< Looked at by Resolve         */
+} STACK_DEPTH_ImageTypeDef;
+
+typedef struct
+{
+  char     Name[32];
+  uint32_t Budget;
+  uint32_t Reserve;
+  uint32_t Depth;                           /*!< Worst case, after Analyse    */
+  uint32_t Levels;                          /*!< Interrupt levels nesting     */
+  uint8_t  Flags;                           /*!< Problems on any of its paths */
+} STACK_DEPTH_StackTypeDef;
+
+typedef struct
+{
+  char     Function[STACK_DEPTH_NAME_MAX];  /*!< As written in the config     */
+  int32_t  Func;                            /*!< Funcs[] index after Resolve  */
+  uint32_t Stack;
+  uint8_t  Isr;
+  int32_t  Priority;
+} STACK_DEPTH_EntryTypeDef;
+
+typedef struct
+{
+  uint8_t  Kind;
+  uint32_t Index;
+} STACK_DEPTH_LineTypeDef;
+
+typedef struct
+{
+  STACK_DEPTH_FuncTypeDef  Funcs[STACK_DEPTH_FUNCS_MAX];
+  uint32_t                 FuncCount;
+  uint16_t                 Hash[2U * STACK_DEPTH_FUNCS_MAX];  /*!< Funcs index + 1 */
+  STACK_DEPTH_CallTypeDef  Calls[STACK_DEPTH_CALLS_MAX];
+  uint32_t                 CallCount;
+  STACK_DEPTH_SiteTypeDef  Usage[STACK_DEPTH_FUNCS_MAX];
+  uint32_t                 UsageCount;
+  STACK_DEPTH_SiteTypeDef  Defs[STACK_DEPTH_FUNCS_MAX];
+  uint32_t                 DefCount;
+  STACK_DEPTH_LinkTypeDef  Links[STACK_DEPTH_LINKS_MAX];
+  uint32_t                 LinkCount;
+  STACK_DEPTH_ImageTypeDef Image[STACK_DEPTH_FUNCS_MAX];
+  uint32_t                 ImageCount;
+  uint32_t                 ImageCalls[STACK_DEPTH_CALLS_MAX];  /*!< Target addresses */
+  uint32_t                 ImageCallCount;
+  STACK_DEPTH_StackTypeDef Stacks[STACK_DEPTH_STACKS_MAX];
+  uint32_t                 StackCount;
+  STACK_DEPTH_EntryTypeDef Entries[STACK_DEPTH_ENTRIES_MAX];
+  uint32_t                 EntryCount;
+  uint32_t                 Frame;
+  STACK_DEPTH_LineTypeDef  Lines[STACK_DEPTH_LINES_MAX];
+  uint32_t                 LineCount;
+} STACK_DEPTH_GraphTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void                      STACK_DEPTH_Init(STACK_DEPTH_GraphTypeDef *graph);
+STACK_DEPTH_StatusTypeDef STACK_DEPTH_ParseUsage(STACK_DEPTH_GraphTypeDef *graph, const char *line);
+STACK_DEPTH_StatusTypeDef STACK_DEPTH_ParseGraph(STACK_DEPTH_GraphTypeDef *graph, const char *line);
+STACK_DEPTH_StatusTypeDef STACK_DEPTH_ParseImage(STACK_DEPTH_GraphTypeDef *graph, const char *line);
+STACK_DEPTH_StatusTypeDef STACK_DEPTH_ParseConfig(STACK_DEPTH_GraphTypeDef *graph, const char *line);
+STACK_DEPTH_StatusTypeDef STACK_DEPTH_Resolve(STACK_DEPTH_GraphTypeDef *graph, char *missing, uint32_t size);
+uint32_t                  STACK_DEPTH_Analyse(STACK_DEPTH_GraphTypeDef *graph);
+int32_t                   STACK_DEPTH_Find(const STACK_DEPTH_GraphTypeDef *graph, const char *name);
+uint32_t                  STACK_DEPTH_FormatLine(const STACK_DEPTH_GraphTypeDef *graph, uint32_t line,
+                                                 char *out, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STACK_DEPTH_H */
@@ -0,0 +1,159 @@
+/**
+  ******************************************************************************
+  * @file    stackcheck.c
+  * @brief   Host checker for the worst-case depth of every stack.
+  ******************************************************************************
+  * Usage: stackcheck <config> <file.su|file.ci|file.dis>...
+  *
+  * Reads the configuration (tools/stack.cfg), the .su and .ci files the
+  * compiler wrote for each object and the disassembly of the linked image
+  * (.dis, "objdump -d --no-show-raw-insn") for the C library, libgcc and
+  * assembly functions, prints the report (stack_depth.c) and
+  * exits with 1 if a stack is over budget or reaches a function of unknown
+  * size, since its depth is then only a lower bound, 2 on bad input. "make"
+  * runs it after linking the firmware. Build with "make -f test.mk
+  * stackcheck".
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "stack_depth.h"
+
+/* Private define ------------------------------------------------------------*/
+#define STACKCHECK_LINE_MAX   1024U
+
+/* Private types -------------------------------------------------------------*/
+typedef STACK_DEPTH_StatusTypeDef (*StackCheck_ParserTypeDef)(STACK_DEPTH_GraphTypeDef *graph,
+                                                               const char *line);
+
+/* Private variables ---------------------------------------------------------*/
+static STACK_DEPTH_GraphTypeDef Graph;
+
+/* Private functions ---------------------------------------------------------*/
+
+static int StackCheck_Load(const char *path, StackCheck_ParserTypeDef parse)
+{
+  FILE *in = fopen(path, "r");
+  char line[STACKCHECK_LINE_MAX];
+  STACK_DEPTH_StatusTypeDef status;
+  unsigned number = 0U;
+
+  if (in == NULL)
+  {
+    fprintf(stderr, "stackcheck: cannot open %s\n", path);
+    return 0;
+  }
+  while (fgets(line, sizeof(line), in) != NULL)
+  {
+    number++;
+    status = parse(&Graph, line);
+    if ((status == STACK_DEPTH_SYNTAX) || (status == STACK_DEPTH_NOT_FOUND))
+    {
+      fprintf(stderr, "%s:%u: %s\n", path, number,
+              (status == STACK_DEPTH_SYNTAX) ? "not understood" : "stack not declared");
+      fclose(in);
+      return 0;
+    }
+    if (status == STACK_DEPTH_FULL)
+    {
+      fprintf(stderr, "%s:%u: too many functions, calls or entries (stack_depth.h)\n", path, number);
+      fclose(in);
+      return 0;
+    }
+  }
+  fclose(in);
+  return 1;
+}
+
+static const char *StackCheck_Extension(const char *path)
+{
+  const char *dot = strrchr(path, '.');
+
+  return (dot != NULL) ? dot : "";
+}
+
+/* Main ----------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+  char line[STACK_DEPTH_LINE_MAX];
+  char missing[STACK_DEPTH_NAME_MAX];
+  STACK_DEPTH_StatusTypeDef status;
+  uint32_t over;
+  uint32_t unknown = 0U;
+  uint32_t i;
+  int arg;
+
+  if (argc < 3)
+  {
+    fprintf(stderr, "usage: stackcheck <config> <file.su|file.ci|file.dis>...\n");
+    return 2;
+  }
+  STACK_DEPTH_Init(&Graph);
+  if (StackCheck_Load(argv[1], STACK_DEPTH_ParseConfig) == 0)
+  {
+    return 2;
+  }
+  for (arg = 2; arg < argc; arg++)
+  {
+    if (strcmp(StackCheck_Extension(argv[arg]), ".su") == 0)
+    {
+      if (StackCheck_Load(argv[arg], STACK_DEPTH_ParseUsage) == 0)
+      {
+        return 2;
+      }
+    }
+    else if (strcmp(StackCheck_Extension(argv[arg]), ".ci") == 0)
+    {
+      if (StackCheck_Load(argv[arg], STACK_DEPTH_ParseGraph) == 0)
+      {
+        return 2;
+      }
+    }
+    else if (strcmp(StackCheck_Extension(argv[arg]), ".dis") == 0)
+    {
+      if (StackCheck_Load(argv[arg], STACK_DEPTH_ParseImage) == 0)
+      {
+        return 2;
+      }
+    }
+    else
+    {
+      fprintf(stderr, "stackcheck: %s is not .su, .ci or .dis\n", argv[arg]);
+      return 2;
+    }
+  }
+  status = STACK_DEPTH_Resolve(&Graph, missing, sizeof(missing));
+  if (status == STACK_DEPTH_NOT_FOUND)
+  {
+    fprintf(stderr, "%s: no function %s in the call graph\n", argv[1], missing);
+    return 2;
+  }
+  if (status != STACK_DEPTH_OK)
+  {
+    fprintf(stderr, "stackcheck: too many calls (stack_depth.h)\n");
+    return 2;
+  }
+
+  over = STACK_DEPTH_Analyse(&Graph);
+  for (i = 0U; STACK_DEPTH_FormatLine(&Graph, i, line, sizeof(line)) != 0U; i++)
+  {
+    printf("%s\n", line);
+  }
+  for (i = 0U; i < Graph.StackCount; i++)
+  {
+    if ((Graph.Stacks[i].Flags & STACK_DEPTH_UNKNOWN) != 0U)
+    {
+      fprintf(stderr, "stackcheck: %s reaches functions of unknown size, pass the image .dis or give "
+              "them an extern line in %s\n", Graph.Stacks[i].Name, argv[1]);
+      unknown++;
+    }
+  }
+  if (over != 0U)
+  {
+    fprintf(stderr, "stackcheck: %lu stack(s) over budget\n", (unsigned long)over);
+  }
+  return ((over != 0U) || (unknown != 0U)) ? 1 : 0;
+}
@@ -0,0 +1,117 @@
+/**
+  ******************************************************************************
+  * @file    trace2json.c
+  * @brief   Host converter from a trace dump to Chrome trace JSON.
+  ******************************************************************************
+  * Usage: trace2json <capture> [output.json]
+  *
+  * The capture may be a raw UART log: everything before the dump magic, such
+  * as console text, is skipped. Open the result in ui.perfetto.dev or
+  * chrome://tracing. Build with "make -f test.mk trace2json".
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "trace.h"
+
+/* Private types -------------------------------------------------------------*/
+typedef struct
+{
+  FILE *Out;
+  TRACE_JsonTypeDef Json;
+} Trace2JsonTypeDef;
+
+/* Private functions ---------------------------------------------------------*/
+
+static void Trace2Json_Sink(void *context, const TRACE_EventTypeDef *event)
+{
+  Trace2JsonTypeDef *conv = (Trace2JsonTypeDef *)context;
+  char line[TRACE_JSON_MAX];
+
+  fwrite(line, 1, TRACE_JsonEvent(&conv->Json, event, line, sizeof(line)), conv->Out);
+}
+
+static uint8_t *Trace2Json_Load(const char *path, uint32_t *size)
+{
+  FILE *in = fopen(path, "rb");
+  uint8_t *data = NULL;
+  long len;
+
+  if (in == NULL)
+  {
+    return NULL;
+  }
+  if ((fseek(in, 0, SEEK_END) == 0) && ((len = ftell(in)) >= 0) && (fseek(in, 0, SEEK_SET) == 0))
+  {
+    data = malloc((size_t)len + 1U);
+    if ((data != NULL) && (fread(data, 1, (size_t)len, in) != (size_t)len))
+    {
+      free(data);
+      data = NULL;
+    }
+    *size = (uint32_t)len;
+  }
+  fclose(in);
+  return data;
+}
+
+/* Main ----------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+  Trace2JsonTypeDef conv;
+  TRACE_DumpHeaderTypeDef header;
+  char line[TRACE_JSON_MAX];
+  uint8_t *data;
+  uint32_t size = 0U;
+  uint32_t offset;
+
+  if ((argc < 2) || (argc > 3))
+  {
+    fprintf(stderr, "usage: %s <capture> [output.json]\n", argv[0]);
+    return 2;
+  }
+  data = Trace2Json_Load(argv[1], &size);
+  if (data == NULL)
+  {
+    perror(argv[1]);
+    return 1;
+  }
+
+  /* Find the first offset that holds a complete, valid dump */
+  for (offset = 0U; offset + TRACE_HEADER_SIZE <= size; offset++)
+  {
+    if (TRACE_Decode(data + offset, size - offset, &header, NULL, NULL) == TRACE_OK)
+    {
+      break;
+    }
+  }
+  if (offset + TRACE_HEADER_SIZE > size)
+  {
+    fprintf(stderr, "%s: no trace dump found\n", argv[1]);
+    free(data);
+    return 1;
+  }
+
+  conv.Out = (argc == 3) ? fopen(argv[2], "w") : stdout;
+  if (conv.Out == NULL)
+  {
+    perror(argv[2]);
+    free(data);
+    return 1;
+  }
+  fwrite(line, 1, TRACE_JsonBegin(&conv.Json, header.CpuHz, line, sizeof(line)), conv.Out);
+  (void)TRACE_Decode(data + offset, size - offset, NULL, Trace2Json_Sink, &conv);
+  fwrite(line, 1, TRACE_JsonEnd(&conv.Json, line, sizeof(line)), conv.Out);
+
+  fprintf(stderr, "%lu events at %lu Hz, %lu lost before the dump\n",
+          (unsigned long)header.Count, (unsigned long)header.CpuHz, (unsigned long)header.Lost);
+  if (conv.Out != stdout)
+  {
+    fclose(conv.Out);
+  }
+  free(data);
+  return 0;
+}